@@ -0,0 +1,20 @@
+# Writes a half resolution copy of each image in the mods, named like
+# "images/a.half.png" for "images/a.png", for the low_res_images setting.
+# Copies that are newer than their original are left alone.
+#
+# Usage: cmake -DMODS_DIR=<mods folder> -DCONVERT=<ImageMagick convert> -P MakeLowResImages.cmake
+
+File (GLOB_RECURSE IMAGES "${MODS_DIR}/*.png")
+
+Foreach (IMAGE ${IMAGES})
+	If (NOT IMAGE MATCHES "\\.half\\.png$")
+		String (REGEX REPLACE "\\.png$" ".half.png" LOW_RES_IMAGE "${IMAGE}")
+
+		If (NOT EXISTS "${LOW_RES_IMAGE}" OR "${IMAGE}" IS_NEWER_THAN "${LOW_RES_IMAGE}")
+			Execute_Process (COMMAND "${CONVERT}" "${IMAGE}" -resize 50% "${LOW_RES_IMAGE}" RESULT_VARIABLE RESULT)
+			If (NOT RESULT EQUAL 0)
+				Message (WARNING "Couldn't write ${LOW_RES_IMAGE}")
+			EndIf (NOT RESULT EQUAL 0)
+		EndIf (NOT EXISTS "${LOW_RES_IMAGE}" OR "${IMAGE}" IS_NEWER_THAN "${LOW_RES_IMAGE}")
+	EndIf (NOT IMAGE MATCHES "\\.half\\.png$")
+EndForeach (IMAGE)
@@ -16,6 +16,10 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
 	../../../../../../src/main.cpp \
 	../../../../../../src/BehaviorAlly.cpp \
 	../../../../../../src/Entity.cpp \
+	../../../../../../src/EntityGrid.cpp \
+	../../../../../../src/EntityRegistry.cpp \
+	../../../../../../src/EventGrid.cpp \
+	../../../../../../src/AllocTracker.cpp \
 	../../../../../../src/Animation.cpp \
 	../../../../../../src/AnimationManager.cpp \
 	../../../../../../src/AnimationSet.cpp \
@@ -27,6 +31,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
 	../../../../../../src/CombatText.cpp \
 	../../../../../../src/CursorManager.cpp \
 	../../../../../../src/DeviceList.cpp \
+	../../../../../../src/DevicePower.cpp \
 	../../../../../../src/EffectManager.cpp \
 	../../../../../../src/Enemy.cpp \
 	../../../../../../src/EnemyBehavior.cpp \
@@ -35,6 +40,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
 	../../../../../../src/EventManager.cpp \
 	../../../../../../src/FileParser.cpp \
 	../../../../../../src/FontEngine.cpp \
+	../../../../../../src/FramePacer.cpp \
 	../../../../../../src/GameSlotPreview.cpp \
 	../../../../../../src/GameState.cpp \
 	../../../../../../src/GameStateConfigBase.cpp \
@@ -48,16 +54,25 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
 	../../../../../../src/GetText.cpp \
 	../../../../../../src/Hazard.cpp \
 	../../../../../../src/HazardManager.cpp \
+	../../../../../../src/HotReload.cpp \
 	../../../../../../src/IconManager.cpp \
+	../../../../../../src/ImageDecoder.cpp \
+	../../../../../../src/InputReplay.cpp \
 	../../../../../../src/InputState.cpp \
 	../../../../../../src/ItemManager.cpp \
 	../../../../../../src/ItemStorage.cpp \
+	../../../../../../src/Logger.cpp \
 	../../../../../../src/Loot.cpp \
+	../../../../../../src/LootGrid.cpp \
 	../../../../../../src/LootManager.cpp \
 	../../../../../../src/Map.cpp \
 	../../../../../../src/MapBackground.cpp \
 	../../../../../../src/MapCollision.cpp \
+	../../../../../../src/MapFlowField.cpp \
+	../../../../../../src/MapPathHierarchy.cpp \
+	../../../../../../src/MapPreloader.cpp \
 	../../../../../../src/MapRenderer.cpp \
+	../../../../../../src/MemoryUsage.cpp \
 	../../../../../../src/Menu.cpp \
 	../../../../../../src/MenuActionBar.cpp \
 	../../../../../../src/MenuActiveEffects.cpp \
@@ -82,30 +97,45 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
 	../../../../../../src/MenuTalker.cpp \
 	../../../../../../src/MenuVendor.cpp \
 	../../../../../../src/MessageEngine.cpp \
+	../../../../../../src/ModArchive.cpp \
 	../../../../../../src/ModManager.cpp \
 	../../../../../../src/NPC.cpp \
 	../../../../../../src/NPCManager.cpp \
+	../../../../../../src/NullFontEngine.cpp \
+	../../../../../../src/NullRenderDevice.cpp \
+	../../../../../../src/NullSoundManager.cpp \
+	../../../../../../src/ParserCache.cpp \
+	../../../../../../src/PickBuffer.cpp \
 	../../../../../../src/PowerManager.cpp \
+	../../../../../../src/Profiler.cpp \
 	../../../../../../src/QuestLog.cpp \
+	../../../../../../src/RenderBenchmark.cpp \
+	../../../../../../src/Random.cpp \
 	../../../../../../src/RenderDevice.cpp \
 	../../../../../../src/SaveLoad.cpp \
+	../../../../../../src/SaveWriter.cpp \
 	../../../../../../src/SDLInputState.cpp \
 	../../../../../../src/SDLHardwareRenderDevice.cpp \
 	../../../../../../src/SDLSoftwareRenderDevice.cpp \
+	../../../../../../src/SDLFastSoftwareRenderDevice.cpp \
 	../../../../../../src/SDLSoundManager.cpp \
+	../../../../../../src/SoundDecoder.cpp \
 	../../../../../../src/SDLFontEngine.cpp \
 	../../../../../../src/Settings.cpp \
 	../../../../../../src/SharedGameResources.cpp \
 	../../../../../../src/SharedResources.cpp \
 	../../../../../../src/StatBlock.cpp \
 	../../../../../../src/Stats.cpp \
+	../../../../../../src/StressScene.cpp \
 	../../../../../../src/Subtitles.cpp \
+	../../../../../../src/TextureAtlas.cpp \
 	../../../../../../src/TileSet.cpp \
 	../../../../../../src/TooltipData.cpp \
 	../../../../../../src/Utils.cpp \
 	../../../../../../src/UtilsDebug.cpp \
 	../../../../../../src/UtilsFileSystem.cpp \
 	../../../../../../src/UtilsParsing.cpp \
+	../../../../../../src/VisualQuality.cpp \
 	../../../../../../src/Widget.cpp \
 	../../../../../../src/WidgetCheckBox.cpp \
 	../../../../../../src/WidgetButton.cpp \
@@ -118,7 +148,8 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
 	../../../../../../src/WidgetSlider.cpp \
 	../../../../../../src/WidgetSlot.cpp \
  	../../../../../../src/WidgetTabControl.cpp \
-	../../../../../../src/WidgetTooltip.cpp
+	../../../../../../src/WidgetTooltip.cpp \
+	../../../../../../src/WorkerPool.cpp
 
 LOCAL_SHARED_LIBRARIES := SDL2 SDL2_image SDL2_mixer SDL2_ttf
 
@@ -19,26 +19,64 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "AStarContainer.h"
 #include <cstring>
 #include <cfloat>
+#include <algorithm>
 
-AStarContainer::AStarContainer(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit)
-	: size(0)
-	, node_limit(_node_limit)
-	, map_width(_map_width)
-	, map_height(_map_height)
+AStar_Grid::AStar_Grid()
+	: map_width(0)
+	, generation(0)
 {
-	nodes.resize(node_limit, NULL);
+}
+
+void AStar_Grid::reset(unsigned int _map_width, unsigned int _map_height) {
+	map_width = _map_width;
+
+	size_t grid_size = static_cast<size_t>(_map_width) * _map_height;
+	if (values.size() < grid_size) {
+		values.resize(grid_size, -1);
+		generations.resize(grid_size, 0);
+	}
 
-	//initialise the map array. A -1 value will mean there is no node at that position
-	map_pos.resize(map_width);
-	for (unsigned i=0; i<map_width; ++i) {
-		map_pos[i].resize(map_height, -1);
+	// every entry stamped with an older generation now reads as -1
+	generation++;
+	if (generation == 0) {
+		std::fill(generations.begin(), generations.end(), 0);
+		generation = 1;
 	}
 }
 
+int AStar_Grid::get(int x, int y) const {
+	size_t i = static_cast<size_t>(y) * map_width + static_cast<size_t>(x);
+	return (generations[i] == generation) ? values[i] : -1;
+}
+
+void AStar_Grid::set(int x, int y, int value) {
+	size_t i = static_cast<size_t>(y) * map_width + static_cast<size_t>(x);
+	values[i] = value;
+	generations[i] = generation;
+}
+
+AStarContainer::AStarContainer()
+	: size(0)
+	, node_limit(0)
+	, map_width(0)
+	, map_height(0)
+{
+}
+
 AStarContainer::~AStarContainer() {
-	for(unsigned int i=0; i<size; i++)
-		delete nodes[i];
-	nodes.clear();
+	// nodes are owned by the AStarContext
+}
+
+void AStarContainer::reset(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit) {
+	size = 0;
+	node_limit = _node_limit;
+	map_width = _map_width;
+	map_height = _map_height;
+
+	if (nodes.size() < node_limit)
+		nodes.resize(node_limit, NULL);
+
+	map_pos.reset(map_width, map_height);
 }
 
 int AStarContainer::getSize() {
@@ -50,7 +88,7 @@ void AStarContainer::add(AStarNode* node) {
 
 	//add the new node at the end and update its index
 	nodes[size] = node;
-	map_pos[node->getX()][node->getY()] = static_cast<short>(size);
+	map_pos.set(node->getX(), node->getY(), static_cast<int>(size));
 
 	//reorder the heap based on f ordering, staring with thenewly added node and working up the tree from there
 	int m = size;
@@ -61,9 +99,9 @@ void AStarContainer::add(AStarNode* node) {
 		if(nodes[m]->getFinalCost() <= nodes[m/2]->getFinalCost()) {
 			temp = nodes[m/2];
 			nodes[m/2] = nodes[m];
-			map_pos[nodes[m/2]->getX()][nodes[m/2]->getY()] = static_cast<short>(m/2);
+			map_pos.set(nodes[m/2]->getX(), nodes[m/2]->getY(), static_cast<int>(m/2));
 			nodes[m] = temp;
-			map_pos[nodes[m]->getX()][nodes[m]->getY()] = static_cast<short>(m);
+			map_pos.set(nodes[m]->getX(), nodes[m]->getY(), static_cast<int>(m));
 			m=m/2;
 		}
 		else
@@ -78,16 +116,16 @@ AStarNode* AStarContainer::get_shortest_f() {
 
 void AStarContainer::remove(AStarNode* node) {
 
-	unsigned int heap_indexv = map_pos[node->getX()][node->getY()] + 1;
+	unsigned int heap_indexv = map_pos.get(node->getX(), node->getY()) + 1;
 
 	//swap the last node in the list with the node being deleted
 	nodes[heap_indexv-1] = nodes[size-1];
-	map_pos[nodes[heap_indexv-1]->getX()][nodes[heap_indexv-1]->getY()] = static_cast<short>(heap_indexv-1);
+	map_pos.set(nodes[heap_indexv-1]->getX(), nodes[heap_indexv-1]->getY(), static_cast<int>(heap_indexv-1));
 
 	size--;
 
 	if(size == 0) {
-		map_pos[node->getX()][node->getY()] = -1;
+		map_pos.set(node->getX(), node->getY(), -1);
 		return;
 	}
 
@@ -109,9 +147,9 @@ void AStarContainer::remove(AStarNode* node) {
 		if(heap_indexu != heap_indexv) { //If parent's F > one or both of its children, swap them
 			AStarNode* temp = nodes[heap_indexu-1];
 			nodes[heap_indexu-1] = nodes[heap_indexv-1];
-			map_pos[nodes[heap_indexu-1]->getX()][nodes[heap_indexu-1]->getY()] = static_cast<short>(heap_indexu-1);
+			map_pos.set(nodes[heap_indexu-1]->getX(), nodes[heap_indexu-1]->getY(), static_cast<int>(heap_indexu-1));
 			nodes[heap_indexv-1] = temp;
-			map_pos[nodes[heap_indexv-1]->getX()][nodes[heap_indexv-1]->getY()] = static_cast<short>(heap_indexv-1);
+			map_pos.set(nodes[heap_indexv-1]->getX(), nodes[heap_indexv-1]->getY(), static_cast<int>(heap_indexv-1));
 		}
 		else {
 			break;//if item <= both children, exit loop
@@ -119,15 +157,15 @@ void AStarContainer::remove(AStarNode* node) {
 	}//Repeat forever
 
 	//remove the node from the map pos index
-	map_pos[node->getX()][node->getY()] = -1;
+	map_pos.set(node->getX(), node->getY(), -1);
 }
 
 bool AStarContainer::exists(const Point& pos) {
-	return map_pos[pos.x][pos.y] != -1;
+	return map_pos.get(pos.x, pos.y) != -1;
 }
 
 AStarNode* AStarContainer::get(int x, int y) {
-	return nodes[map_pos[x][y]];
+	return nodes[map_pos.get(x, y)];
 }
 
 bool AStarContainer::isEmpty() {
@@ -139,16 +177,16 @@ void AStarContainer::updateParent(const Point& pos, const Point& parent_pos, flo
 	get(pos.x, pos.y)->setActualCost(score);
 
 	//reorder the heap based on the new f value of this node. starting at the updated node and working up the tree
-	int m = map_pos[pos.x][pos.y];
+	int m = map_pos.get(pos.x, pos.y);
 	AStarNode* temp = NULL;
 	while(m != 0) {
 		//if the current node has a lower f value than its parent in the heap, swap them
 		if(nodes[m]->getFinalCost() <= nodes[m/2]->getFinalCost()) {
 			temp = nodes[m/2];
 			nodes[m/2] = nodes[m];
-			map_pos[nodes[m/2]->getX()][nodes[m/2]->getY()] = static_cast<short>(m/2);
+			map_pos.set(nodes[m/2]->getX(), nodes[m/2]->getY(), static_cast<int>(m/2));
 			nodes[m] = temp;
-			map_pos[nodes[m]->getX()][nodes[m]->getY()] = static_cast<short>(m);
+			map_pos.set(nodes[m]->getX(), nodes[m]->getY(), static_cast<int>(m));
 			m=m/2;
 		}
 		else
@@ -156,25 +194,28 @@ void AStarContainer::updateParent(const Point& pos, const Point& parent_pos, flo
 	}
 }
 
-AStarCloseContainer::AStarCloseContainer(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit)
+AStarCloseContainer::AStarCloseContainer()
 	: size(0)
-	, node_limit(_node_limit)
-	, map_width(_map_width)
-	, map_height(_map_height)
+	, node_limit(0)
+	, map_width(0)
+	, map_height(0)
 {
-	nodes.resize(node_limit, NULL);
-
-	//initialise the map array. A -1 value will mean there is no node at that position
-	map_pos.resize(map_width);
-	for (unsigned i=0; i<map_width; ++i) {
-		map_pos[i].resize(map_height, -1);
-	}
 }
 
 AStarCloseContainer::~AStarCloseContainer() {
-	for(unsigned int i=0; i<size; i++)
-		delete nodes[i];
-	nodes.clear();
+	// nodes are owned by the AStarContext
+}
+
+void AStarCloseContainer::reset(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit) {
+	size = 0;
+	node_limit = _node_limit;
+	map_width = _map_width;
+	map_height = _map_height;
+
+	if (nodes.size() < node_limit)
+		nodes.resize(node_limit, NULL);
+
+	map_pos.reset(map_width, map_height);
 }
 
 int AStarCloseContainer::getSize() {
@@ -185,16 +226,16 @@ void AStarCloseContainer::add(AStarNode* node) {
 	if (size >= node_limit) return;
 
 	nodes[size] = node;
-	map_pos[node->getX()][node->getY()] = static_cast<short>(size);
+	map_pos.set(node->getX(), node->getY(), static_cast<int>(size));
 	size++;
 }
 
 bool AStarCloseContainer::exists(const Point& pos) {
-	return map_pos[pos.x][pos.y] != -1;
+	return map_pos.get(pos.x, pos.y) != -1;
 }
 
 AStarNode* AStarCloseContainer::get(int x, int y) {
-	return nodes[map_pos[x][y]];
+	return nodes[map_pos.get(x, y)];
 }
 
 AStarNode* AStarCloseContainer::get_shortest_h() {
@@ -208,3 +249,28 @@ AStarNode* AStarCloseContainer::get_shortest_h() {
 	}
 	return current;
 }
+
+AStarContext::AStarContext()
+	: pool_size(0)
+{
+}
+
+void AStarContext::reset(unsigned int map_width, unsigned int map_height, unsigned int node_limit) {
+	open.reset(map_width, map_height, node_limit);
+	close.reset(map_width, map_height, node_limit);
+
+	// every node is in either the open or the close container, so at most 2*node_limit nodes are used
+	size_t pool_limit = static_cast<size_t>(node_limit) * 2 + 1;
+	if (pool.size() < pool_limit)
+		pool.resize(pool_limit);
+
+	pool_size = 0;
+}
+
+AStarNode* AStarContext::createNode(const Point& pos) {
+	if (pool_size >= pool.size())
+		return NULL;
+
+	pool[pool_size] = AStarNode(pos);
+	return &pool[pool_size++];
+}
@@ -22,7 +22,24 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "AStarNode.h"
 
-typedef std::vector< std::vector<short> > AStar_Grid;
+/* A flat [map_width*map_height] index from map position to node position.
+*  Each entry is stamped with the generation in which it was written, so the
+*  whole grid can be invalidated by bumping the generation instead of clearing it.
+*/
+class AStar_Grid {
+public:
+	AStar_Grid();
+
+	void reset(unsigned int _map_width, unsigned int _map_height);
+	int get(int x, int y) const;
+	void set(int x, int y, int value);
+
+private:
+	unsigned int map_width;
+	unsigned int generation;
+	std::vector<int> values;
+	std::vector<unsigned int> generations;
+};
 
 /* Designed to be used for the Open nodes.
 *  Unsuitable for Closed nodes but a close node conatiner is declared below
@@ -31,10 +48,12 @@ typedef std::vector< std::vector<short> > AStar_Grid;
 */
 class AStarContainer {
 public:
-	AStarContainer(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit);
-	AStarContainer(const AStarContainer&); // copy constructor not yet implemented
-
+	AStarContainer();
 	~AStarContainer();
+
+	// empties the container so that it can be used for a new search
+	void reset(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit);
+
 	int getSize();
 	//assumes that the node is not already in the collection
 	void add(AStarNode* node);
@@ -74,11 +93,11 @@ private:
 	*/
 	std::vector<AStarNode*> nodes;
 
-	/* This is a 2d array of shorts ([map_width][map_height]) which acts as an index for the main node array.
-	*  Elements can be accessed using cartesian coordinates e.g. map_pos[x][y]
-	*  To access an AStarNode based on map position use: nodes[map_pos[x][y]]
+	/* This acts as an index for the main node array.
+	*  Elements can be accessed using cartesian coordinates e.g. map_pos.get(x, y)
+	*  To access an AStarNode based on map position use: nodes[map_pos.get(x, y)]
 	*
-	*  The data in this array is initialised as -1, which indicates hat there is no corresponding node for that position
+	*  A value of -1 indicates that there is no corresponding node for that position
 	*  This must be maintained when nodes are added, removed and re-ordered in the node array
 	*/
 	AStar_Grid map_pos;
@@ -89,10 +108,12 @@ private:
 */
 class AStarCloseContainer {
 public:
-	AStarCloseContainer(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit);
-	AStarCloseContainer(const AStarCloseContainer&); // copy constructor not yet implemented
+	AStarCloseContainer();
 	~AStarCloseContainer();
 
+	// empties the container so that it can be used for a new search
+	void reset(unsigned int _map_width, unsigned int _map_height, unsigned int _node_limit);
+
 	int getSize();
 	void add(AStarNode* node);
 	bool exists(const Point& pos);
@@ -109,4 +130,25 @@ private:
 
 };
 
+/* Holds everything a path search needs, so that repeated searches on the same map don't allocate.
+*  Nodes are taken from a pool owned by the context; the open and close containers only point to them.
+*/
+class AStarContext {
+public:
+	AStarContext();
+
+	// prepares the context for a new search
+	void reset(unsigned int map_width, unsigned int map_height, unsigned int node_limit);
+
+	// returns NULL if the node pool is exhausted
+	AStarNode* createNode(const Point& pos);
+
+	AStarContainer open;
+	AStarCloseContainer close;
+
+private:
+	std::vector<AStarNode> pool;
+	size_t pool_size;
+};
+
 #endif // ASTARCONTAINER_H
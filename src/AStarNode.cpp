@@ -44,6 +44,15 @@ AStarNode::AStarNode(const AStarNode& copy)
 	, parent(copy.parent) {
 }
 
+AStarNode& AStarNode::operator=(const AStarNode& other) {
+	x = other.x;
+	y = other.y;
+	g = other.g;
+	h = other.h;
+	parent = other.parent;
+	return *this;
+}
+
 int AStarNode::getX() const {
 	return x;
 }
@@ -64,51 +73,51 @@ void AStarNode::setParent(const Point& p) {
 	this->parent = p;
 }
 
-std::list<Point> AStarNode::getNeighbours(int limitX, int limitY) const {
+int AStarNode::getNeighbours(Point* neighbours, int limitX, int limitY) const {
 	Point toAdd;
-	std::list<Point> res;
+	int count = 0;
 	if (x>node_stride && y>node_stride) {
 		toAdd.x = x-node_stride;
 		toAdd.y = y-node_stride;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 	if (x>node_stride && (limitY==0 || y<limitY-node_stride)) {
 		toAdd.x = x-node_stride;
 		toAdd.y = y+node_stride;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 	if (y>node_stride && (limitX==0 || x<limitX-node_stride)) {
 		toAdd.x = x+node_stride;
 		toAdd.y = y-node_stride;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 	if ((limitX==0 || x<limitX-node_stride) && (limitY==0 || y<limitY-node_stride)) {
 		toAdd.x = x+node_stride;
 		toAdd.y = y+node_stride;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 	if (x>node_stride) {
 		toAdd.x = x-node_stride;
 		toAdd.y = y;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 	if (y>node_stride) {
 		toAdd.x = x;
 		toAdd.y = y-node_stride;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 	if (limitX==0 || x<limitX-node_stride) {
 		toAdd.x = x+node_stride;
 		toAdd.y = y;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 	if (limitY==0 || y<limitY-node_stride) {
 		toAdd.x = x;
 		toAdd.y = y+node_stride;
-		res.push_back(toAdd);
+		neighbours[count++] = toAdd;
 	}
 
-	return res;
+	return count;
 }
 
 
@@ -27,10 +27,10 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #ifndef ASTARNODE_H
 #define ASTARNODE_H
 
-#include <list>
 #include "Utils.h"
 
 const int node_stride = 1; // minimal stride between nodes
+const int node_neighbour_max = 8; // maximum number of neighbours of a node
 
 class AStarNode {
 protected:
@@ -49,6 +49,7 @@ public:
 	AStarNode();
 	explicit AStarNode(const Point &p);
 	AStarNode(const AStarNode& copy);
+	AStarNode& operator=(const AStarNode& other);
 
 	int getX() const;
 	int getY() const;
@@ -57,8 +58,9 @@ public:
 	Point getParent() const;
 	void setParent(const Point& p);
 
-	// return a list of coordinates of all neighbours
-	std::list<Point> getNeighbours(int limitX=0, int limitY=0) const;
+	// fill neighbours (which must hold node_neighbour_max points) with the coordinates of all neighbours
+	// returns the number of neighbours found
+	int getNeighbours(Point* neighbours, int limitX=0, int limitY=0) const;
 
 	float getActualCost() const;
 	void setActualCost(const float G);
@@ -0,0 +1,313 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "AllocTracker.h"
+#include "Utils.h"
+
+#ifdef ALLOC_TRACKING
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <new>
+#include <stdlib.h>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+// profiler zones are at most this deep
+const int ALLOC_ZONE_STACK_MAX = 8;
+
+static SDL_threadID main_thread = 0;
+
+// these are only touched by the main thread
+static int zone_stack[ALLOC_ZONE_STACK_MAX];
+static int zone_depth = 0;
+static int steady_depth = 0;
+static bool in_hook = false;
+static bool backtraces = false;
+static bool backtrace_logged = false;
+
+static unsigned frame_allocs[ALLOC_ZONE_COUNT];
+static unsigned frame_frees = 0;
+static SDL_atomic_t other_allocs;
+
+static unsigned history[PROFILE_HISTORY][ALLOC_ZONE_COUNT];
+static unsigned history_frees[PROFILE_HISTORY];
+static int history_pos = 0;
+static int history_count = 0;
+static unsigned last_other_allocs = 0;
+static uint64_t totals[ALLOC_ZONE_COUNT];
+
+static bool isMainThread() {
+	return main_thread != 0 && SDL_ThreadID() == main_thread;
+}
+
+/**
+ * The backtrace is written to stderr without allocating, so it may come out ahead of the log message
+ */
+static void logSteadyAlloc(size_t size) {
+	const char* zone = (zone_depth > 0 ? getProfileZoneName(static_cast<PROFILE_ZONE>(zone_stack[zone_depth-1])) : "none");
+	logInfo("AllocTracker: Frame %u allocated %u bytes in a steady state block (zone '%s').", getFrameCount(), static_cast<unsigned>(size), zone);
+
+#if defined(__GLIBC__)
+	void *frames[ALLOC_BACKTRACE_DEPTH];
+	int count = backtrace(frames, ALLOC_BACKTRACE_DEPTH);
+	backtrace_symbols_fd(frames, count, STDERR_FILENO);
+#endif
+}
+
+static void countAlloc(size_t size) {
+	if (!isMainThread()) {
+		SDL_AtomicIncRef(&other_allocs);
+		return;
+	}
+	if (in_hook)
+		return;
+
+	frame_allocs[ALLOC_ZONE_FRAME]++;
+	for (int i = 0; i < zone_depth; ++i) {
+		frame_allocs[zone_stack[i]]++;
+	}
+
+	if (steady_depth > 0 && backtraces && !backtrace_logged) {
+		in_hook = true;
+		backtrace_logged = true;
+		logSteadyAlloc(size);
+		in_hook = false;
+	}
+}
+
+static void countFree() {
+	if (isMainThread() && !in_hook)
+		frame_frees++;
+}
+
+static void* trackedAlloc(size_t size) {
+	void *p = malloc(size > 0 ? size : 1);
+	if (p)
+		countAlloc(size);
+	return p;
+}
+
+static void trackedFree(void *p) {
+	if (!p)
+		return;
+	countFree();
+	free(p);
+}
+
+#if __cplusplus >= 201103L
+#define ALLOC_THROW_BAD_ALLOC
+#define ALLOC_NO_THROW noexcept
+#else
+#define ALLOC_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define ALLOC_NO_THROW throw()
+#endif
+
+// exceptions are turned off, so running out of memory ends the game here instead of throwing std::bad_alloc
+void* operator new(std::size_t size) ALLOC_THROW_BAD_ALLOC {
+	void *p = trackedAlloc(size);
+	if (!p)
+		abort();
+	return p;
+}
+
+void* operator new[](std::size_t size) ALLOC_THROW_BAD_ALLOC {
+	void *p = trackedAlloc(size);
+	if (!p)
+		abort();
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) ALLOC_NO_THROW {
+	return trackedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) ALLOC_NO_THROW {
+	return trackedAlloc(size);
+}
+
+void operator delete(void* p) ALLOC_NO_THROW {
+	trackedFree(p);
+}
+
+void operator delete[](void* p) ALLOC_NO_THROW {
+	trackedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) ALLOC_NO_THROW {
+	trackedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) ALLOC_NO_THROW {
+	trackedFree(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, std::size_t) ALLOC_NO_THROW {
+	trackedFree(p);
+}
+
+void operator delete[](void* p, std::size_t) ALLOC_NO_THROW {
+	trackedFree(p);
+}
+#endif
+
+bool isAllocTrackingBuilt() {
+	return true;
+}
+
+void endAllocFrame() {
+	if (main_thread == 0)
+		main_thread = SDL_ThreadID();
+
+	for (int i = 0; i < ALLOC_ZONE_COUNT; ++i) {
+		history[history_pos][i] = frame_allocs[i];
+		totals[i] += frame_allocs[i];
+		frame_allocs[i] = 0;
+	}
+	history_frees[history_pos] = frame_frees;
+	frame_frees = 0;
+
+	history_pos = (history_pos + 1) % PROFILE_HISTORY;
+	history_count = std::min(history_count + 1, PROFILE_HISTORY);
+
+	last_other_allocs = static_cast<unsigned>(SDL_AtomicSet(&other_allocs, 0));
+	backtrace_logged = false;
+}
+
+float getAllocAverage(int zone) {
+	if (history_count == 0 || zone < 0 || zone >= ALLOC_ZONE_COUNT)
+		return 0;
+
+	unsigned total = 0;
+	for (int i = 0; i < history_count; ++i) {
+		total += history[i][zone];
+	}
+	return static_cast<float>(total) / static_cast<float>(history_count);
+}
+
+unsigned getAllocPeak(int zone) {
+	if (zone < 0 || zone >= ALLOC_ZONE_COUNT)
+		return 0;
+
+	unsigned peak = 0;
+	for (int i = 0; i < history_count; ++i) {
+		peak = std::max(peak, history[i][zone]);
+	}
+	return peak;
+}
+
+float getFreeAverage() {
+	if (history_count == 0)
+		return 0;
+
+	unsigned total = 0;
+	for (int i = 0; i < history_count; ++i) {
+		total += history_frees[i];
+	}
+	return static_cast<float>(total) / static_cast<float>(history_count);
+}
+
+unsigned getOtherThreadAllocs() {
+	return last_other_allocs;
+}
+
+uint64_t getAllocTotal(int zone) {
+	if (zone < 0 || zone >= ALLOC_ZONE_COUNT)
+		return 0;
+
+	return totals[zone];
+}
+
+void setAllocBacktraces(bool enabled) {
+	backtraces = enabled;
+}
+
+bool isAllocBacktraces() {
+	return backtraces;
+}
+
+bool enterAllocZone(int zone) {
+	if (!isMainThread() || zone_depth >= ALLOC_ZONE_STACK_MAX)
+		return false;
+
+	zone_stack[zone_depth++] = zone;
+	return true;
+}
+
+void leaveAllocZone() {
+	if (zone_depth > 0)
+		zone_depth--;
+}
+
+AllocSteadyScope::AllocSteadyScope() {
+	if (isMainThread())
+		steady_depth++;
+}
+
+AllocSteadyScope::~AllocSteadyScope() {
+	if (isMainThread() && steady_depth > 0)
+		steady_depth--;
+}
+
+#else // ALLOC_TRACKING
+
+bool isAllocTrackingBuilt() {
+	return false;
+}
+
+void endAllocFrame() {
+}
+
+float getAllocAverage(int) {
+	return 0;
+}
+
+unsigned getAllocPeak(int) {
+	return 0;
+}
+
+float getFreeAverage() {
+	return 0;
+}
+
+unsigned getOtherThreadAllocs() {
+	return 0;
+}
+
+uint64_t getAllocTotal(int) {
+	return 0;
+}
+
+void setAllocBacktraces(bool) {
+}
+
+bool isAllocBacktraces() {
+	return false;
+}
+
+AllocSteadyScope::AllocSteadyScope() {
+}
+
+AllocSteadyScope::~AllocSteadyScope() {
+}
+
+#endif // ALLOC_TRACKING
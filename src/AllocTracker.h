@@ -0,0 +1,88 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * Allocation tracker
+ *
+ * In builds with ALLOC_TRACKING defined (the ALLOC_TRACKING CMake option), the
+ * global operator new and delete count the heap allocations and frees of the
+ * main thread in each profiler zone. Like the zone times, nested zones are
+ * counted in their parent too. Allocations on other threads are only counted.
+ *
+ * Code that shouldn't allocate once the game is running, such as
+ * GameStatePlay::logic() and MapRenderer::render(), is wrapped in an
+ * AllocSteadyScope. With backtraces turned on, an allocation inside of one logs
+ * a backtrace, at most once per frame.
+ *
+ * Without ALLOC_TRACKING, nothing is counted and all of the counts are zero.
+ */
+
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include "Profiler.h"
+
+// the counts of the whole frame are kept after those of the zones
+const int ALLOC_ZONE_FRAME = PROFILE_ZONE_COUNT;
+const int ALLOC_ZONE_COUNT = PROFILE_ZONE_COUNT + 1;
+
+// the number of stack frames in a logged backtrace
+const int ALLOC_BACKTRACE_DEPTH = 32;
+
+bool isAllocTrackingBuilt();
+
+// called by endProfileFrame()
+void endAllocFrame();
+
+// per frame, over the last PROFILE_HISTORY frames; zone is a PROFILE_ZONE or ALLOC_ZONE_FRAME
+float getAllocAverage(int zone);
+unsigned getAllocPeak(int zone);
+float getFreeAverage();
+
+// in the last frame
+unsigned getOtherThreadAllocs();
+
+// since the start, over every frame
+uint64_t getAllocTotal(int zone);
+
+void setAllocBacktraces(bool enabled);
+bool isAllocBacktraces();
+
+/* ProfileScope counts the allocations in its zone with these. enterAllocZone()
+ * returns false, and nothing has to be left, if the zone isn't on the main thread.
+ */
+#ifdef ALLOC_TRACKING
+bool enterAllocZone(int zone);
+void leaveAllocZone();
+#else
+inline bool enterAllocZone(int) {
+	return false;
+}
+inline void leaveAllocZone() {
+}
+#endif
+
+/**
+ * Marks the enclosing block as one that shouldn't allocate
+ */
+class AllocSteadyScope {
+public:
+	AllocSteadyScope();
+	~AllocSteadyScope();
+};
+
+#endif // ALLOC_TRACKER_H
@@ -30,88 +30,139 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "Animation.h"
 
-Animation::Animation(const std::string &_name, const std::string &_type, Image *_sprite, uint8_t _blend_mode, uint8_t _alpha_mod, Color _color_mod)
-	: name(_name)
-	, type(	_type == "play_once" ? PLAY_ONCE :
-			_type == "back_forth" ? BACK_FORTH :
-			_type == "looped" ? LOOPED :
-			NONE)
+AnimationFrames::AnimationFrames(const std::string &_name, animation_type _type, Image *_sprite, uint8_t _blend_mode, uint8_t _alpha_mod, Color _color_mod)
+	: name(internString(_name))
+	, type(_type)
 	, sprite(_sprite)
 	, blend_mode(_blend_mode)
 	, alpha_mod(_alpha_mod)
 	, color_mod(_color_mod)
 	, number_frames(0)
+	, max_kinds(0)
+	, gfx()
+	, render_offset()
+	, frames()
+	, active_frames()
+	, frame_count(0)
+	, ref_count(1)
+	, bounds() {
+}
+
+void AnimationFrames::ref() {
+	ref_count++;
+}
+
+void AnimationFrames::unref() {
+	if (--ref_count == 0)
+		delete this;
+}
+
+void AnimationFrames::updateBounds() {
+	int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	for (size_t i = 0; i < gfx.size(); ++i) {
+		const int x = -render_offset[i].x;
+		const int y = -render_offset[i].y;
+		if (i == 0) {
+			x0 = x;
+			y0 = y;
+			x1 = x + gfx[i].w;
+			y1 = y + gfx[i].h;
+		}
+		else {
+			x0 = std::min(x0, x);
+			y0 = std::min(y0, y);
+			x1 = std::max(x1, x + gfx[i].w);
+			y1 = std::max(y1, y + gfx[i].h);
+		}
+	}
+	bounds.x = x0;
+	bounds.y = y0;
+	bounds.w = x1 - x0;
+	bounds.h = y1 - y0;
+}
+
+Animation::Animation(const std::string &_name, const std::string &_type, Image *_sprite, uint8_t _blend_mode, uint8_t _alpha_mod, Color _color_mod)
+	: data(new AnimationFrames(_name,
+							   _type == "play_once" ? PLAY_ONCE :
+							   _type == "back_forth" ? BACK_FORTH :
+							   _type == "looped" ? LOOPED :
+							   NONE,
+							   _sprite, _blend_mode, _alpha_mod, _color_mod))
 	, cur_frame(0)
 	, cur_frame_index(0)
 	, cur_frame_duration(0)
 	, cur_frame_index_f(0)
-	, max_kinds(0)
 	, additional_data(0)
 	, times_played(0)
-	, gfx()
-	, render_offset()
-	, frames()
-	, active_frames()
 	, active_frame_triggered(false)
 	, elapsed_frames(0)
-	, frame_count(0)
-	, speed(1.0f) {
-	if (type == NONE)
+	, speed(1.0f)
+	, pending_frames(0) {
+	if (data->type == NONE)
 		logError("Animation: Type %s is unknown", _type.c_str());
 }
 
 Animation::Animation(const Animation& a)
-	: name(a.name)
-	, type(a.type)
-	, sprite(a.sprite)
-	, blend_mode(a.blend_mode)
-	, alpha_mod(a.alpha_mod)
-	, color_mod(a.color_mod)
-	, number_frames(a.number_frames)
+	: data(a.data)
 	, cur_frame(0)
 	, cur_frame_index(a.cur_frame_index)
 	, cur_frame_duration(a.cur_frame_duration)
 	, cur_frame_index_f(a.cur_frame_index_f)
-	, max_kinds(a.max_kinds)
 	, additional_data(a.additional_data)
 	, times_played(0)
-	, gfx(std::vector<Rect>(a.gfx))
-	, render_offset(std::vector<Point>(a.render_offset))
-	, frames(std::vector<unsigned short>(a.frames))
-	, active_frames(std::vector<short>(a.active_frames))
 	, active_frame_triggered(false)
 	, elapsed_frames(0)
-	, frame_count(0)
-	, speed(a.speed) {
+	, speed(a.speed)
+	, pending_frames(a.pending_frames) {
+	data->ref();
+}
+
+Animation::Animation(AnimationFrames *_data)
+	: data(_data)
+	, cur_frame(0)
+	, cur_frame_index(0)
+	, cur_frame_duration(0)
+	, cur_frame_index_f(0)
+	, additional_data(_data->type == BACK_FORTH ? 1 : 0)
+	, times_played(0)
+	, active_frame_triggered(false)
+	, elapsed_frames(0)
+	, speed(1.0f)
+	, pending_frames(0) {
+}
+
+Animation::~Animation() {
+	data->unref();
 }
 
 void Animation::setupUncompressed(const Point& _render_size, const Point& _render_offset, unsigned short _position, unsigned short _frames, unsigned short _duration, unsigned short _maxkinds) {
 	setup(_frames, _duration, _maxkinds);
 
 	for (unsigned short i = 0 ; i < _frames; i++) {
-		int base_index = max_kinds*i;
-		for (unsigned short kind = 0 ; kind < max_kinds; kind++) {
-			gfx[base_index + kind].x = _render_size.x * (_position + i);
-			gfx[base_index + kind].y = _render_size.y * kind;
-			gfx[base_index + kind].w = _render_size.x;
-			gfx[base_index + kind].h = _render_size.y;
-			render_offset[base_index + kind].x = _render_offset.x;
-			render_offset[base_index + kind].y = _render_offset.y;
+		int base_index = data->max_kinds*i;
+		for (unsigned short kind = 0 ; kind < data->max_kinds; kind++) {
+			data->gfx[base_index + kind].x = _render_size.x * (_position + i);
+			data->gfx[base_index + kind].y = _render_size.y * kind;
+			data->gfx[base_index + kind].w = _render_size.x;
+			data->gfx[base_index + kind].h = _render_size.y;
+			data->render_offset[base_index + kind].x = _render_offset.x;
+			data->render_offset[base_index + kind].y = _render_offset.y;
 		}
 	}
+	data->updateBounds();
 }
 
 void Animation::setup(unsigned short _frames, unsigned short _duration, unsigned short _maxkinds) {
-	frame_count = _frames;
+	data->frame_count = _frames;
 
-	frames.clear();
+	data->frames.clear();
 
 	if (_frames > 0 && _duration % _frames == 0) {
 		// if we can evenly space frames among the duration, do it
 		const unsigned short divided = _duration/_frames;
 		for (unsigned short i = 0; i < _frames; ++i) {
 			for (unsigned j = 0; j < divided; ++j) {
-				frames.push_back(i);
+				data->frames.push_back(i);
 			}
 		}
 	}
@@ -128,7 +179,7 @@ void Animation::setup(unsigned short _frames, unsigned short _duration, unsigned
 
 		int D = 2*dy - dx;
 
-		frames.push_back(y0);
+		data->frames.push_back(y0);
 
 		int x = x0+1;
 		unsigned short y = y0;
@@ -136,70 +187,116 @@ void Animation::setup(unsigned short _frames, unsigned short _duration, unsigned
 		while (x<=x1) {
 			if (D > 0) {
 				y++;
-				frames.push_back(y);
+				data->frames.push_back(y);
 				D = D + ((2*dy)-(2*dx));
 			}
 			else {
-				frames.push_back(y);
+				data->frames.push_back(y);
 				D = D + (2*dy);
 			}
 			x++;
 		}
 	}
 
-	if (!frames.empty()) number_frames = static_cast<unsigned short>(frames.back()+1);
+	if (!data->frames.empty()) data->number_frames = static_cast<unsigned short>(data->frames.back()+1);
 
-	if (type == PLAY_ONCE) {
+	if (data->type == PLAY_ONCE) {
 		additional_data = 0;
 	}
-	else if (type == LOOPED) {
+	else if (data->type == LOOPED) {
 		additional_data = 0;
 	}
-	else if (type == BACK_FORTH) {
-		number_frames = static_cast<unsigned short>(2 * number_frames);
+	else if (data->type == BACK_FORTH) {
+		data->number_frames = static_cast<unsigned short>(2 * data->number_frames);
 		additional_data = 1;
 	}
 	cur_frame = 0;
 	cur_frame_index = 0;
 	cur_frame_index_f = 0;
-	max_kinds = _maxkinds;
+	data->max_kinds = _maxkinds;
 	times_played = 0;
 
-	active_frames.push_back(static_cast<unsigned short>(number_frames-1)/2);
+	data->active_frames.push_back(static_cast<unsigned short>(data->number_frames-1)/2);
 
-	unsigned i = max_kinds*_frames;
-	gfx.resize(i);
-	render_offset.resize(i);
+	unsigned i = data->max_kinds*_frames;
+	data->gfx.resize(i);
+	data->render_offset.resize(i);
 }
 
 void Animation::addFrame(unsigned short index, unsigned short kind, const Rect& rect, const Point& _render_offset) {
 
-	if (index >= gfx.size()/max_kinds) {
+	if (index >= data->gfx.size()/data->max_kinds) {
 		logError("Animation: Animation(%s) adding rect(%d, %d, %d, %d) to frame index(%u) out of bounds. must be in [0, %d]",
-				name.c_str(), rect.x, rect.y, rect.w, rect.h, index, static_cast<int>(gfx.size())/max_kinds);
+				getName().c_str(), rect.x, rect.y, rect.w, rect.h, index, static_cast<int>(data->gfx.size())/data->max_kinds);
 		return;
 	}
-	if (kind > max_kinds-1) {
+	if (kind > data->max_kinds-1) {
 		logError("Animation: Animation(%s) adding rect(%d, %d, %d, %d) to frame(%u) kind(%u) out of bounds. must be in [0, %d]",
-				name.c_str(), rect.x, rect.y, rect.w, rect.h, index, kind, max_kinds-1);
+				getName().c_str(), rect.x, rect.y, rect.w, rect.h, index, kind, data->max_kinds-1);
 		return;
 	}
 
-	unsigned i = max_kinds*index+kind;
-	gfx[i] = rect;
-	render_offset[i] = _render_offset;
+	unsigned i = data->max_kinds*index+kind;
+	data->gfx[i] = rect;
+	data->render_offset[i] = _render_offset;
 }
 
-void Animation::advanceFrame() {
-	if (frames.empty()) {
+/**
+ * Play the frames counted by advanceFrame()
+ */
+void Animation::update() {
+	if (pending_frames == 0)
+		return;
+
+	if (data->frames.empty()) {
 		cur_frame_index = 0;
 		cur_frame_index_f = 0;
-		times_played++;
+		times_played = static_cast<short>(times_played + pending_frames);
+		pending_frames = 0;
 		return;
 	}
 
-	unsigned short last_base_index = static_cast<unsigned short>(frames.size()-1);
-	switch(type) {
+	const unsigned short last_base_index = static_cast<unsigned short>(data->frames.size()-1);
+
+	// a finished one-shot animation stays on its last frame
+	if (data->type == NONE || (data->type == PLAY_ONCE && cur_frame_index >= last_base_index)) {
+		step();
+		pending_frames = 0;
+		return;
+	}
+
+	// every loop of a looped animation starts from the same state, so whole loops can be skipped
+	// The length of a loop is measured between the first two restarts.
+	unsigned loop_start = 0;
+	unsigned short loop_start_elapsed = 0;
+	bool loop_measured = false;
+
+	while (pending_frames > 0) {
+		const short prev_times_played = times_played;
+		step();
+		pending_frames--;
+
+		if (data->type != LOOPED || loop_measured || times_played == prev_times_played)
+			continue;
+
+		if (loop_start == 0) {
+			loop_start = pending_frames + 1;
+			loop_start_elapsed = elapsed_frames;
+		}
+		else {
+			const unsigned loop_frames = loop_start - pending_frames - 1;
+			const unsigned loops = pending_frames / loop_frames;
+			times_played = static_cast<short>(times_played + loops);
+			elapsed_frames = static_cast<unsigned short>(elapsed_frames + loops * static_cast<unsigned short>(elapsed_frames - loop_start_elapsed));
+			pending_frames -= loops * loop_frames;
+			loop_measured = true;
+		}
+	}
+}
+
+void Animation::step() {
+	unsigned short last_base_index = static_cast<unsigned short>(data->frames.size()-1);
+	switch(data->type) {
 		case PLAY_ONCE:
 
 			if (cur_frame_index < last_base_index) {
@@ -250,29 +347,35 @@ void Animation::advanceFrame() {
 	cur_frame_index = std::max<short>(0, cur_frame_index);
 	cur_frame_index = (cur_frame_index > last_base_index ? last_base_index : cur_frame_index);
 
-	if (cur_frame != frames[cur_frame_index]) elapsed_frames++;
-	cur_frame = frames[cur_frame_index];
+	if (cur_frame != data->frames[cur_frame_index]) elapsed_frames++;
+	cur_frame = data->frames[cur_frame_index];
 }
 
 Renderable Animation::getCurrentFrame(int kind) {
 	Renderable r;
-	if (!frames.empty()) {
-		const int index = (max_kinds*frames[cur_frame_index]) + kind;
-		r.src.x = gfx[index].x;
-		r.src.y = gfx[index].y;
-		r.src.w = gfx[index].w;
-		r.src.h = gfx[index].h;
-		r.offset.x = render_offset[index].x;
-		r.offset.y = render_offset[index].y;
-		r.image = sprite;
-		r.blend_mode = blend_mode;
-		r.color_mod = color_mod;
-		r.alpha_mod = alpha_mod;
-	}
+	getCurrentFrame(kind, r);
 	return r;
 }
 
+void Animation::getCurrentFrame(int kind, Renderable& r) {
+	update();
+	if (!data->frames.empty()) {
+		const int index = (data->max_kinds*data->frames[cur_frame_index]) + kind;
+		r.src.x = data->gfx[index].x;
+		r.src.y = data->gfx[index].y;
+		r.src.w = data->gfx[index].w;
+		r.src.h = data->gfx[index].h;
+		r.offset.x = data->render_offset[index].x;
+		r.offset.y = data->render_offset[index].y;
+		r.image = data->sprite;
+		r.blend_mode = data->blend_mode;
+		r.color_mod = data->color_mod;
+		r.alpha_mod = data->alpha_mod;
+	}
+}
+
 void Animation::reset() {
+	pending_frames = 0;
 	cur_frame = 0;
 	cur_frame_index = 0;
 	cur_frame_index_f = 0;
@@ -282,7 +385,15 @@ void Animation::reset() {
 	active_frame_triggered = false;
 }
 
-bool Animation::syncTo(const Animation *other) {
+void Animation::restart() {
+	reset();
+	cur_frame_duration = 0;
+	speed = 1.0f;
+}
+
+bool Animation::syncTo(Animation *other) {
+	other->update();
+	pending_frames = 0;
 	cur_frame = other->cur_frame;
 	cur_frame_index = other->cur_frame_index;
 	cur_frame_index_f = other->cur_frame_index_f;
@@ -290,16 +401,16 @@ bool Animation::syncTo(const Animation *other) {
 	additional_data = other->additional_data;
 	elapsed_frames = other->elapsed_frames;
 
-	if (cur_frame_index >= frames.size()) {
-		if (frames.empty()) {
-			logError("Animation: '%s' animation has no frames, but current frame index is greater than 0.", name.c_str());
+	if (cur_frame_index >= data->frames.size()) {
+		if (data->frames.empty()) {
+			logError("Animation: '%s' animation has no frames, but current frame index is greater than 0.", getName().c_str());
 			cur_frame_index = 0;
 			cur_frame_index_f = 0;
 			return false;
 		}
 		else {
-			logError("Animation: Current frame index (%d) was larger than the last frame index (%d) when syncing '%s' animation.", cur_frame_index, frames.size()-1, name.c_str());
-			cur_frame_index = static_cast<unsigned short>(frames.size()-1);
+			logError("Animation: Current frame index (%d) was larger than the last frame index (%d) when syncing '%s' animation.", cur_frame_index, data->frames.size()-1, getName().c_str());
+			cur_frame_index = static_cast<unsigned short>(data->frames.size()-1);
 			cur_frame_index_f = cur_frame_index;
 			return false;
 		}
@@ -310,24 +421,24 @@ bool Animation::syncTo(const Animation *other) {
 
 void Animation::setActiveFrames(const std::vector<short> &_active_frames) {
 	if (_active_frames.size() == 1 && _active_frames[0] == -1) {
-		active_frames.clear();
-		for (unsigned short i = 0; i < number_frames; ++i)
-			active_frames.push_back(i);
+		data->active_frames.clear();
+		for (unsigned short i = 0; i < data->number_frames; ++i)
+			data->active_frames.push_back(i);
 	}
 	else {
-		active_frames = std::vector<short>(_active_frames);
+		data->active_frames = std::vector<short>(_active_frames);
 	}
 
 	// verify that each active frame is not out of bounds
 	// this works under the assumption that frames are not dropped from the middle of animations
 	// if an animation has too many frames to display in a specified duration, they are dropped from the end of the frame list
-	bool have_last_frame = std::find(active_frames.begin(), active_frames.end(), number_frames-1) != active_frames.end();
-	for (unsigned i=0; i<active_frames.size(); ++i) {
-		if (active_frames[i] >= number_frames) {
+	bool have_last_frame = std::find(data->active_frames.begin(), data->active_frames.end(), data->number_frames-1) != data->active_frames.end();
+	for (unsigned i=0; i<data->active_frames.size(); ++i) {
+		if (data->active_frames[i] >= data->number_frames) {
 			if (have_last_frame)
-				active_frames.erase(active_frames.begin()+i);
+				data->active_frames.erase(data->active_frames.begin()+i);
 			else {
-				active_frames[i] = static_cast<short>(number_frames-1);
+				data->active_frames[i] = static_cast<short>(data->number_frames-1);
 				have_last_frame = true;
 			}
 		}
@@ -335,71 +446,96 @@ void Animation::setActiveFrames(const std::vector<short> &_active_frames) {
 }
 
 bool Animation::isFirstFrame() {
+	update();
 	return cur_frame_index == 0;
 }
 
 bool Animation::isLastFrame() {
-	return cur_frame_index == static_cast<short>(getLastFrameIndex(static_cast<short>(number_frames-1)));
+	update();
+	return cur_frame_index == static_cast<short>(getLastFrameIndex(static_cast<short>(data->number_frames-1)));
 }
 
 bool Animation::isSecondLastFrame() {
-	return cur_frame_index == static_cast<short>(getLastFrameIndex(static_cast<short>(number_frames-2)));
+	update();
+	return cur_frame_index == static_cast<short>(getLastFrameIndex(static_cast<short>(data->number_frames-2)));
 }
 
 bool Animation::isActiveFrame() {
-	if (type == BACK_FORTH) {
-		if (std::find(active_frames.begin(), active_frames.end(), elapsed_frames) != active_frames.end())
+	update();
+	if (data->type == BACK_FORTH) {
+		if (std::find(data->active_frames.begin(), data->active_frames.end(), elapsed_frames) != data->active_frames.end())
 			return cur_frame_index == getLastFrameIndex(cur_frame);
 	}
 	else {
-		if (std::find(active_frames.begin(), active_frames.end(), cur_frame) != active_frames.end()) {
+		if (std::find(data->active_frames.begin(), data->active_frames.end(), cur_frame) != data->active_frames.end()) {
 			if (cur_frame_index == getLastFrameIndex(cur_frame)) {
-				if (type == PLAY_ONCE)
+				if (data->type == PLAY_ONCE)
 					active_frame_triggered = true;
 
 				return true;
 			}
 		}
 	}
-	return (isLastFrame() && type == PLAY_ONCE && !active_frame_triggered && !active_frames.empty());
+	return (isLastFrame() && data->type == PLAY_ONCE && !active_frame_triggered && !data->active_frames.empty());
 }
 
 int Animation::getTimesPlayed() {
+	update();
 	return times_played;
 }
 
-std::string Animation::getName() {
-	return name;
+const std::string& Animation::getName() {
+	return getInternedString(data->name);
+}
+
+StringHandle Animation::getNameHandle() {
+	return data->name;
 }
 
 int Animation::getDuration() {
-	return static_cast<int>(static_cast<float>(frames.size()) / speed);
+	return static_cast<int>(static_cast<float>(data->frames.size()) / speed);
 }
 
 bool Animation::isCompleted() {
-	return (type == PLAY_ONCE && times_played > 0);
+	update();
+	return (data->type == PLAY_ONCE && times_played > 0);
 }
 
 unsigned short Animation::getLastFrameIndex(const short &frame) {
-	if (frames.empty() || frame < 0) return 0;
+	if (data->frames.empty() || frame < 0) return 0;
 
-	if (type == BACK_FORTH && additional_data == -1) {
+	if (data->type == BACK_FORTH && additional_data == -1) {
 		// since the animation is advancing backwards here, the first frame index is actually the last
-		for (unsigned short i=0; i<frames.size(); i++) {
-			if (frames[i] == frame) return i;
+		for (unsigned short i=0; i<data->frames.size(); i++) {
+			if (data->frames[i] == frame) return i;
 		}
 		return 0;
 	}
 	else {
 		// normal animation
-		for (size_t i=frames.size(); i>0; i--) {
-			if (frames[i-1] == frame)
+		for (size_t i=data->frames.size(); i>0; i--) {
+			if (data->frames[i-1] == frame)
 				return static_cast<unsigned short>(i-1);
 		}
-		return static_cast<unsigned short>(frames.size()-1);
+		return static_cast<unsigned short>(data->frames.size()-1);
 	}
 }
 
 void Animation::setSpeed(float val) {
+	// the frames so far were played at the old speed
+	update();
 	speed = val / 100.0f;
 }
+
+void Animation::setSprite(Image *_sprite, const Rect& bounds) {
+	data->sprite = _sprite;
+
+	// move the frames to where the sheet is, without letting them reach into its neighbors
+	for (size_t i = 0; i < data->gfx.size(); ++i) {
+		data->gfx[i].w = std::max(0, std::min(data->gfx[i].w, bounds.w - data->gfx[i].x));
+		data->gfx[i].h = std::max(0, std::min(data->gfx[i].h, bounds.h - data->gfx[i].y));
+		data->gfx[i].x += bounds.x;
+		data->gfx[i].y += bounds.y;
+	}
+	data->updateBounds();
+}
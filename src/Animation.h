@@ -41,11 +41,19 @@ enum animation_type {
 	BACK_FORTH = 3  // iterate from index=0 to maxframe and back again. keeps holding the first image afterwards.
 };
 
-class Animation {
-protected:
-	unsigned short getLastFrameIndex(const short &frame); // given a frame, gets the last index of frames that matches
+/**
+ * The frame data of an animation, as it was loaded from the animation file.
+ * It is shared by the Animation held in the AnimationSet and every copy of it,
+ * so that copies only need to keep their own playback state.
+ */
+class AnimationFrames {
+public:
+	AnimationFrames(const std::string &_name, animation_type _type, Image *_sprite, uint8_t _blend_mode, uint8_t _alpha_mod, Color _color_mod);
+
+	void ref();
+	void unref(); // deletes this when the last reference is released
 
-	const std::string name;
+	const StringHandle name;
 	const animation_type type;
 	Image *sprite;
 	uint8_t blend_mode;
@@ -53,14 +61,48 @@ protected:
 	Color color_mod;
 
 	unsigned short number_frames; // how many ticks this animation lasts.
+	unsigned short max_kinds;
+
+	// Frame data, all vectors must have the same length:
+	// These are indexed as 8*cur_frame_index + direction.
+	std::vector<Rect> gfx; // position on the spritesheet to be used.
+	std::vector<Point> render_offset; // "virtual point on the floor"
+	std::vector<unsigned short> frames; // a list of frames to play on each tick
+
+	std::vector<short> active_frames;	// which of the visible diffferent frames are active?
+	// This should contain indexes of the gfx vector.
+	// Assume it is sorted, one index occurs at max once.
+
+	unsigned frame_count; // the frame count as it appears in the data files (i.e. not converted to engine frames)
+
+	// the area covered by any of the frames, relative to the render position
+	// It is only worked out by updateBounds(), once the frames are loaded, so that the render jobs can read it at the same time.
+	const Rect& getBounds() const { return bounds; }
+	void updateBounds();
+
+private:
+	int ref_count;
+
+	Rect bounds;
+};
+
+class Animation {
+protected:
+	unsigned short getLastFrameIndex(const short &frame); // given a frame, gets the last index of frames that matches
+
+	// advanceFrame() only counts the frames; they are played when the state of the animation is needed
+	void update();
+	void step();
+
+	// shared with the other copies of this animation; only the AnimationSet sets it up
+	AnimationFrames *data;
+
 	unsigned short cur_frame;     // counts up until reaching number_frames.
 
 	unsigned short cur_frame_index; // which frame in this animation is currently being displayed? range: 0..gfx.size()-1
 	unsigned short cur_frame_duration;  // how many ticks is the current image being displayed yet? range: 0..duration[cur_frame]-1
 	float cur_frame_index_f; // more granular control over cur_frame_index
 
-	unsigned short max_kinds;
-
 	short additional_data;  // additional state depending on type:
 	// if type == BACK_FORTH then it is 1 for advancing, and -1 for going back, 0 at the end
 	// if type == LOOPED, then it is the number of loops to be played.
@@ -68,29 +110,26 @@ protected:
 
 	short times_played; // how often this animation was played (loop counter for type LOOPED)
 
-	// Frame data, all vectors must have the same length:
-	// These are indexed as 8*cur_frame_index + direction.
-	std::vector<Rect> gfx; // position on the spritesheet to be used.
-	std::vector<Point> render_offset; // "virtual point on the floor"
-	std::vector<unsigned short> frames; // a list of frames to play on each tick
-
-	std::vector<short> active_frames;	// which of the visible diffferent frames are active?
-	// This should contain indexes of the gfx vector.
-	// Assume it is sorted, one index occurs at max once.
 	bool active_frame_triggered;
 
 	unsigned short elapsed_frames; // counts the total number of frames for back-forth animations
 
-	unsigned frame_count; // the frame count as it appears in the data files (i.e. not converted to engine frames)
-
 	float speed; // how fast the animation plays
 
+	unsigned pending_frames; // frames advanced, but not yet played by update()
+
+	Animation& operator=(const Animation&); // not implemented
+
 public:
 	Animation(const std::string &_name, const std::string &_type, Image *_sprite, uint8_t _blend_mode, uint8_t _alpha_mod, Color _color_mod);
 
-	// returns a copy of this:
+	// returns a copy of this, which shares the frame data:
 	Animation(const Animation&);
 
+	// takes over the reference to frame data that is already set up, e.g. from a compiled animation file
+	explicit Animation(AnimationFrames *_data);
+	~Animation();
+
 	// Traditional way to create an animation.
 	// The frames are stored in a grid like fashion, so the individual frame
 	// position can be calculated based on a few things.
@@ -107,16 +146,20 @@ public:
 	void addFrame(unsigned short index, unsigned short kind, const Rect& rect, const Point& _render_offset);
 
 	// advance the animation one frame
-	void advanceFrame();
+	// This is cheap, so that animations that nobody looks at don't cost anything to keep running.
+	void advanceFrame() { ++pending_frames; }
 
 	// sets the frame counters to the same values as the given Animation.
 	// returns false on error. Error may occur when frame count of other is
 	// larger than this animation's
-	bool syncTo(const Animation *other);
+	bool syncTo(Animation *other);
 
 	// return the Renderable of the current frame
 	Renderable getCurrentFrame(int direction);
 
+	// the same, written into r; the parts of r that don't come from the frame are left alone
+	void getCurrentFrame(int direction, Renderable& r);
+
 	bool isFirstFrame();
 	bool isLastFrame();
 	bool isSecondLastFrame();
@@ -130,7 +173,11 @@ public:
 	// resets to beginning of the animation
 	void reset();
 
-	std::string getName();
+	// puts this copy back into the state it had when it was copied from the AnimationSet
+	void restart();
+
+	const std::string& getName();
+	StringHandle getNameHandle();
 	int getDuration();
 
 	// a vector of indexes of gfx passed into.
@@ -139,9 +186,23 @@ public:
 
 	bool isCompleted();
 
-	unsigned getFrameCount() { return frame_count; }
+	unsigned getFrameCount() { return data->frame_count; }
+
+	const AnimationFrames* getFrameData() const { return data; }
+
+	// the area covered by any of the frames, relative to the render position
+	// Renderers can use it to skip animations that are off screen without looking up their current frame.
+	const Rect& getBounds() const { return data->getBounds(); }
+
+	// works out the bounds again after frames were added with addFrame()
+	void updateBounds() { data->updateBounds(); }
 
 	void setSpeed(float val);
+
+	// The sprite-sheet is assigned after parsing, so that it can be decoded in the meantime.
+	// bounds is the area of the sheet within _sprite, which may be a shared atlas page.
+	// Since the frame data is shared, this applies to every copy of the animation.
+	void setSprite(Image *_sprite, const Rect& bounds);
 };
 
 #endif
@@ -17,18 +17,27 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 */
 
 #include "CommonIncludes.h"
+#include "MemoryUsage.h"
 #include "SharedResources.h"
+#include "Settings.h"
 
 #include <cassert>
 
-AnimationSet *AnimationManager::getAnimationSet(const std::string& filename) {
-	std::vector<std::string>::iterator found = find(names.begin(), names.end(), filename);
-	if (found != names.end()) {
-		size_t index = static_cast<size_t>(distance(names.begin(), found));
-		if (sets[index] == 0) {
-			sets[index] = new AnimationSet(filename);
+void AnimationSetCache::freeResource(AnimationSet *set) {
+	delete set;
+}
+
+AnimationSet *AnimationManager::getAnimationSet(const std::string& filename, bool defer_sprite) {
+	AnimationSetCache::Entry *entry = sets.get(filename);
+	if (entry) {
+		if (entry->resource == NULL) {
+			entry->resource = new AnimationSet(filename);
 		}
-		return sets[index];
+		if (defer_sprite)
+			entry->resource->deferSprite();
+		else
+			entry->resource->requireSprite();
+		return entry->resource;
 	}
 	else {
 		logError("AnimationManager::getAnimationSet: %s not found", filename.c_str());
@@ -42,38 +51,36 @@ AnimationManager::AnimationManager() {
 }
 
 AnimationManager::~AnimationManager() {
-	cleanUp();
 // NDEBUG is used by posix to disable assertions, so use the same MACRO.
 #ifndef NDEBUG
-	if (!names.empty()) {
-		logError("AnimationManager: Still holding these animations:");
-		for (size_t i = 0; i < names.size(); i++) {
-			logError("%s %d", names[i].c_str(), counts[i]);
+	bool in_use = false;
+	for (AnimationSetCache::const_iterator it = sets.begin(); it != sets.end(); ++it) {
+		if (it->second.refs > 0) {
+			if (!in_use)
+				logError("AnimationManager: Still holding these animations:");
+			logError("%s %d", it->first.c_str(), it->second.refs);
+			in_use = true;
 		}
 	}
-	assert(names.size() == 0);
+	assert(!in_use);
 #endif
+	sets.clear();
 }
 
 void AnimationManager::increaseCount(const std::string &name) {
-	std::vector<std::string>::iterator found = find(names.begin(), names.end(), name);
-	if (found != names.end()) {
-		size_t index = static_cast<size_t>(distance(names.begin(), found));
-		counts[index]++;
-	}
-	else {
-		sets.push_back(0);
-		names.push_back(name);
-		counts.push_back(1);
-	}
+	AnimationSetCache::Entry *entry = sets.add(name, NULL, 0);
+	entry->refs++;
+	if (entry->resource)
+		sets.setBytes(entry, entry->resource->getByteSize());
 }
 
 void AnimationManager::decreaseCount(const std::string &name) {
-
-	std::vector<std::string>::iterator found = find(names.begin(), names.end(), name);
-	if (found != names.end()) {
-		size_t index = static_cast<size_t>(distance(names.begin(), found));
-		counts[index]--;
+	AnimationSetCache::Entry *entry = sets.get(name);
+	if (entry) {
+		entry->refs--;
+		// the set has most likely been loaded by now
+		if (entry->resource)
+			sets.setBytes(entry, entry->resource->getByteSize());
 	}
 	else {
 		logError("AnimationManager::decreaseCount: %s not found", name.c_str());
@@ -82,14 +89,19 @@ void AnimationManager::decreaseCount(const std::string &name) {
 }
 
 void AnimationManager::cleanUp() {
-	int i = static_cast<int>(sets.size()) - 1;
-	while (i >= 0) {
-		if (counts[i] <= 0) {
-			delete sets[i];
-			counts.erase(counts.begin()+i);
-			sets.erase(sets.begin()+i);
-			names.erase(names.begin()+i);
-		}
-		--i;
+	sets.trim(static_cast<size_t>(TEXTURE_CACHE_MB) * 1024 * 1024);
+}
+
+void AnimationManager::freeUnused() {
+	sets.trim(0);
+}
+
+size_t AnimationManager::getCacheBytes() const {
+	return sets.getTotalBytes();
+}
+
+void AnimationManager::getMemoryUsage(MemoryUsage& usage) const {
+	for (AnimationSetCache::const_iterator it = sets.begin(); it != sets.end(); ++it) {
+		usage.add(it->first, it->second.bytes);
 	}
 }
@@ -21,12 +21,18 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "AnimationSet.h"
 #include "CommonIncludes.h"
+#include "ResourceCache.h"
+
+class MemoryUsage;
+
+class AnimationSetCache : public ResourceCache<std::string, AnimationSet*> {
+protected:
+	void freeResource(AnimationSet *set);
+};
 
 class AnimationManager {
 private:
-	std::vector<AnimationSet*> sets;
-	std::vector<std::string> names;
-	std::vector<int> counts;
+	AnimationSetCache sets;
 
 public:
 	AnimationManager();
@@ -34,12 +40,24 @@ public:
 
 	/**
 	 * @param name: the filename of what to load starting below the animations folder.
+	 * @param defer_sprite: if true, the sprite-sheet is left for AnimationSet::prepareSprite() to load.
+	 * Otherwise, it is loaded along with the animations, even if a previous caller deferred it.
 	 */
-	AnimationSet *getAnimationSet(const std::string &name);
+	AnimationSet *getAnimationSet(const std::string &name, bool defer_sprite = false);
 
 	void decreaseCount(const std::string &name);
 	void increaseCount(const std::string &name);
+
+	// frees unused animation sets once they go over TEXTURE_CACHE_MB, least recently used first
 	void cleanUp();
+
+	// frees every unused animation set, regardless of the budget
+	void freeUnused();
+
+	// size of the cached animation sets, in bytes
+	size_t getCacheBytes() const;
+
+	void getMemoryUsage(MemoryUsage& usage) const;
 };
 
 #endif // __ANIMATION_MANAGER__
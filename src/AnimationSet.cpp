@@ -23,20 +23,106 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "AnimationManager.h"
 
 #include "FileParser.h"
+#include "ModArchive.h"
 #include "SharedResources.h"
 #include "Settings.h"
 #include "Utils.h"
 #include "UtilsParsing.h"
 
 #include <cassert>
+#include <cstring>
+#include <fstream>
+
+static const char ANIMATION_COMPILED_MAGIC[8] = {'F', 'L', 'A', 'R', 'E', 'A', 'N', 'I'};
+
+// written as a native integer, so that files compiled on a platform with another byte order aren't used
+static const uint32_t ANIMATION_COMPILED_BYTE_ORDER = 0x01020304;
+
+/**
+ * Reader over a compiled animation held in memory
+ * Reading past the end of the data clears ok instead of failing immediately.
+ */
+class CompiledAnimationReader {
+public:
+	CompiledAnimationReader(const std::vector<char>& _data)
+		: data(_data)
+		, pos(0)
+		, ok(true) {
+	}
+
+	template <typename T>
+	void get(T& value) {
+		if (pos + sizeof(T) > data.size()) {
+			ok = false;
+			return;
+		}
+		memcpy(&value, &data[0] + pos, sizeof(T));
+		pos += sizeof(T);
+	}
+
+	uint32_t getUnsigned() {
+		uint32_t value = 0;
+		get(value);
+		return value;
+	}
+
+	std::string getString() {
+		size_t length = getUnsigned();
+		if (!ok || pos + length > data.size()) {
+			ok = false;
+			return "";
+		}
+		std::string value(&data[0] + pos, length);
+		pos += length;
+		return value;
+	}
+
+	template <typename T>
+	void getArray(std::vector<T>& list) {
+		const size_t count = getUnsigned();
+		if (!ok || pos + count * sizeof(T) > data.size()) {
+			ok = false;
+			return;
+		}
+		list.resize(count);
+		if (count > 0)
+			memcpy(&list[0], &data[0] + pos, count * sizeof(T));
+		pos += count * sizeof(T);
+	}
+
+	const std::vector<char>& data;
+	size_t pos;
+	bool ok;
+};
+
+template <typename T>
+static void putValue(std::ofstream& outfile, const T& value) {
+	outfile.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void putString(std::ofstream& outfile, const std::string& value) {
+	putValue(outfile, static_cast<uint32_t>(value.length()));
+	outfile.write(value.c_str(), value.length());
+}
+
+template <typename T>
+static void putArray(std::ofstream& outfile, const std::vector<T>& list) {
+	putValue(outfile, static_cast<uint32_t>(list.size()));
+	if (!list.empty())
+		outfile.write(reinterpret_cast<const char*>(&list[0]), list.size() * sizeof(T));
+}
 
 Animation *AnimationSet::getAnimation(const std::string &_name) {
+	return getAnimation(internString(_name));
+}
+
+Animation *AnimationSet::getAnimation(StringHandle _name) {
 	if (!loaded)
 		load();
 
-	if (!_name.empty()) {
+	if (_name != 0) {
 		for (size_t i = 0; i < animations.size(); i++) {
-			if (animations[i]->getName() == _name)
+			if (animations[i]->getNameHandle() == _name)
 				return new Animation(*animations[i]);
 		}
 	}
@@ -44,6 +130,30 @@ Animation *AnimationSet::getAnimation(const std::string &_name) {
 	return new Animation(*defaultAnimation);
 }
 
+int AnimationSet::getAnimationID(StringHandle _name) {
+	if (!loaded)
+		load();
+
+	if (_name != 0) {
+		for (size_t i = 0; i < animations.size(); i++) {
+			if (animations[i]->getNameHandle() == _name)
+				return static_cast<int>(i);
+		}
+	}
+
+	return ANIMATION_DEFAULT_ID;
+}
+
+Animation *AnimationSet::getAnimationByID(int id) {
+	if (!loaded)
+		load();
+
+	if (id >= 0 && static_cast<size_t>(id) < animations.size())
+		return new Animation(*animations[id]);
+
+	return new Animation(*defaultAnimation);
+}
+
 unsigned AnimationSet::getAnimationFrames(const std::string &_name) {
 	if (!loaded)
 		load();
@@ -57,6 +167,10 @@ AnimationSet::AnimationSet(const std::string &animationname)
 	: name(animationname)
 	, loaded(false)
 	, parent(NULL)
+	, sprite_bounds()
+	, defer_sprite(false)
+	, sprite_required(false)
+	, sprite_requested(false)
 	, animations()
 	, sprite(NULL) {
 	defaultAnimation = new Animation("default", "play_once", NULL, RENDERABLE_BLEND_NORMAL, 255, Color(255,255,255));
@@ -67,10 +181,46 @@ void AnimationSet::load() {
 	assert(!loaded);
 	loaded = true;
 
+	std::string starting_animation = "";
+
+	// a compiled animation is only used when it is at least as new as every copy of the text file
+	const std::string compiled_file = mods->locateCompiled(name, ANIMATION_COMPILED_EXTENSION);
+	if (!compiled_file.empty() && loadCompiled(compiled_file, starting_animation)) {
+		if (!defer_sprite && !imagefile.empty()) {
+			render_device->requestImage(imagefile);
+			sprite_requested = true;
+		}
+	}
+	else {
+		if (!compiled_file.empty()) {
+			logError("AnimationSet: Compiled animation '%s' can't be used. Falling back to the text file.", compiled_file.c_str());
+			clearAnimations();
+			starting_animation.clear();
+		}
+
+		if (!loadText(starting_animation))
+			return;
+	}
+
+	// the bounds are read by the render jobs in parallel, so they are worked out here rather than on first use
+	for (size_t i = 0; i < animations.size(); ++i)
+		animations[i]->updateBounds();
+
+	if (!defer_sprite)
+		loadSprite();
+
+	if (starting_animation != "") {
+		Animation *a = getAnimation(starting_animation);
+		delete defaultAnimation;
+		defaultAnimation = a;
+	}
+}
+
+bool AnimationSet::loadText(std::string& starting_animation) {
 	FileParser parser;
 	// @CLASS AnimationSet|Description of animations in animations/
 	if (!parser.open(name, true, "Error loading animation definition: " + name))
-		return;
+		return false;
 
 	std::string _name = "";
 	unsigned short position = 0;
@@ -82,7 +232,6 @@ void AnimationSet::load() {
 	Point render_size;
 	Point render_offset;
 	std::string type = "";
-	std::string starting_animation = "";
 	bool first_section=true;
 	bool compressed_loading=false; // is reset every section to false, set by frame keyword
 	Animation *newanim = NULL;
@@ -95,7 +244,7 @@ void AnimationSet::load() {
 		// create the animation if finished parsing a section
 		if (parser.new_section) {
 			if (!first_section && !compressed_loading) {
-				Animation *a = new Animation(_name, type, sprite, blend_mode, alpha_mod, color_mod);
+				Animation *a = new Animation(_name, type, NULL, blend_mode, alpha_mod, color_mod);
 				a->setupUncompressed(render_size, render_offset, position, frames, duration);
 				if (!active_frames.empty())
 					a->setActiveFrames(active_frames);
@@ -112,13 +261,18 @@ void AnimationSet::load() {
 		if (parser.section.empty()) {
 			if (parser.key == "image") {
 				// @ATTR image|filename|Filename of sprite-sheet image.
-				if (sprite != NULL) {
+				if (!imagefile.empty()) {
 					parser.error("AnimationSet: Multiple images specified. Dragons be here!");
 					mods->resetModConfig();
 					Exit(128);
 				}
 
-				sprite = render_device->loadImage(parser.val);
+				// decoding starts now, the image is loaded once the frames are parsed
+				imagefile = parser.val;
+				if (!defer_sprite) {
+					render_device->requestImage(imagefile);
+					sprite_requested = true;
+				}
 			}
 			else if (parser.key == "render_size") {
 				// @ATTR render_size|int, int : Width, Height|Width and height of animation.
@@ -193,7 +347,7 @@ void AnimationSet::load() {
 			else if (parser.key == "frame") {
 				// @ATTR animation.frame|int, int, int, int, int, int, int, int : Index, Direction, X, Y, Width, Height, X offset, Y offset|A single frame of a compressed animation.
 				if (compressed_loading == false) { // first frame statement in section
-					newanim = new Animation(_name, type, sprite, blend_mode, alpha_mod, color_mod);
+					newanim = new Animation(_name, type, NULL, blend_mode, alpha_mod, color_mod);
 					newanim->setup(frames, duration);
 					if (!active_frames.empty())
 						newanim->setActiveFrames(active_frames);
@@ -229,7 +383,7 @@ void AnimationSet::load() {
 
 	if (!compressed_loading) {
 		// add final animation
-		Animation *a = new Animation(_name, type, sprite, blend_mode, alpha_mod, color_mod);
+		Animation *a = new Animation(_name, type, NULL, blend_mode, alpha_mod, color_mod);
 		a->setupUncompressed(render_size, render_offset, position, frames, duration);
 		if (!active_frames.empty())
 			a->setActiveFrames(active_frames);
@@ -237,17 +391,278 @@ void AnimationSet::load() {
 		animations.push_back(a);
 	}
 
-	if (starting_animation != "") {
-		Animation *a = getAnimation(starting_animation);
-		delete defaultAnimation;
-		defaultAnimation = a;
+	return true;
+}
+
+/**
+ * Load an animation written by saveCompiled()
+ * The frame tables are stored in the layout of AnimationFrames, so they are copied straight out of the buffer.
+ */
+bool AnimationSet::loadCompiled(const std::string& fname, std::string& starting_animation) {
+	ModFileStream infile;
+	infile.open(fname, std::ios::in | std::ios::binary);
+	if (!infile.is_open())
+		return false;
+
+	infile.seekg(0, std::ios::end);
+	const std::streamoff file_size = infile.tellg();
+	infile.seekg(0, std::ios::beg);
+	if (file_size < static_cast<std::streamoff>(sizeof(ANIMATION_COMPILED_MAGIC)))
+		return false;
+
+	std::vector<char> data(static_cast<size_t>(file_size));
+	infile.read(&data[0], file_size);
+	if (!infile.good())
+		return false;
+	infile.close();
+
+	if (memcmp(&data[0], ANIMATION_COMPILED_MAGIC, sizeof(ANIMATION_COMPILED_MAGIC)) != 0)
+		return false;
+
+	CompiledAnimationReader reader(data);
+	reader.pos = sizeof(ANIMATION_COMPILED_MAGIC);
+
+	// the tables are in the memory layout of the platform that compiled them
+	if (reader.getUnsigned() != ANIMATION_COMPILED_VERSION ||
+		reader.getUnsigned() != ANIMATION_COMPILED_BYTE_ORDER ||
+		reader.getUnsigned() != sizeof(Rect) ||
+		reader.getUnsigned() != sizeof(Point))
+		return false;
+
+	imagefile = reader.getString();
+	starting_animation = reader.getString();
+
+	const size_t animation_count = reader.getUnsigned();
+	for (size_t i = 0; i < animation_count && reader.ok; ++i) {
+		const std::string _name = reader.getString();
+		const uint32_t type = reader.getUnsigned();
+		uint8_t blend_mode = RENDERABLE_BLEND_NORMAL;
+		uint8_t alpha_mod = 255;
+		Color color_mod;
+		reader.get(blend_mode);
+		reader.get(alpha_mod);
+		reader.get(color_mod);
+		if (type > BACK_FORTH)
+			return false;
+
+		AnimationFrames *frames = new AnimationFrames(_name, static_cast<animation_type>(type), NULL, blend_mode, alpha_mod, color_mod);
+		animations.push_back(new Animation(frames));
+
+		reader.get(frames->number_frames);
+		reader.get(frames->max_kinds);
+		reader.get(frames->frame_count);
+		reader.getArray(frames->gfx);
+		reader.getArray(frames->render_offset);
+		reader.getArray(frames->frames);
+		reader.getArray(frames->active_frames);
+
+		if (frames->gfx.size() != frames->render_offset.size())
+			return false;
+
+		// the text file reports the mismatch, and takes the frame count of the parent
+		if (parent && frames->frame_count != parent->getAnimationFrames(_name))
+			return false;
+	}
+
+	return reader.ok && reader.pos == data.size();
+}
+
+/**
+ * Write the animations in the compiled format
+ * This must be called before the sprite-sheet is loaded, since that moves the frames onto the atlas page.
+ */
+bool AnimationSet::saveCompiled(const std::string& fname, const std::string& starting_animation) {
+	std::ofstream outfile(fname.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!outfile.is_open()) {
+		logError("AnimationSet: Could not write compiled animation '%s'.", fname.c_str());
+		return false;
+	}
+
+	outfile.write(ANIMATION_COMPILED_MAGIC, sizeof(ANIMATION_COMPILED_MAGIC));
+	putValue(outfile, ANIMATION_COMPILED_VERSION);
+	putValue(outfile, ANIMATION_COMPILED_BYTE_ORDER);
+	putValue(outfile, static_cast<uint32_t>(sizeof(Rect)));
+	putValue(outfile, static_cast<uint32_t>(sizeof(Point)));
+
+	putString(outfile, imagefile);
+	putString(outfile, starting_animation);
+
+	putValue(outfile, static_cast<uint32_t>(animations.size()));
+	for (size_t i = 0; i < animations.size(); ++i) {
+		const AnimationFrames *frames = animations[i]->getFrameData();
+
+		putString(outfile, animations[i]->getName());
+		putValue(outfile, static_cast<uint32_t>(frames->type));
+		putValue(outfile, frames->blend_mode);
+		putValue(outfile, frames->alpha_mod);
+		putValue(outfile, frames->color_mod);
+
+		putValue(outfile, frames->number_frames);
+		putValue(outfile, frames->max_kinds);
+		putValue(outfile, frames->frame_count);
+		putArray(outfile, frames->gfx);
+		putArray(outfile, frames->render_offset);
+		putArray(outfile, frames->frames);
+		putArray(outfile, frames->active_frames);
+	}
+
+	outfile.close();
+	return !outfile.fail();
+}
+
+/**
+ * Parse the text file and write its compiled version next to it
+ * The sprite-sheet isn't loaded, and the AnimationSet can't be used for anything else afterwards.
+ */
+bool AnimationSet::compile() {
+	if (loaded)
+		return false;
+	loaded = true;
+	defer_sprite = true;
+
+	std::string starting_animation = "";
+	if (!loadText(starting_animation))
+		return false;
+
+	std::vector<std::string> text_files = mods->list(name);
+	if (text_files.empty())
+		return false;
+
+	return saveCompiled(text_files.back() + ANIMATION_COMPILED_EXTENSION, starting_animation);
+}
+
+void AnimationSet::clearAnimations() {
+	for (size_t i = 0; i < animations.size(); ++i)
+		delete animations[i];
+	animations.clear();
+	imagefile.clear();
+}
+
+void AnimationSet::loadSprite() {
+	if (sprite || imagefile.empty())
+		return;
+
+	defer_sprite = false;
+	sprite = render_device->loadAtlasImage(imagefile, sprite_bounds);
+	if (!sprite) {
+		// don't try again
+		imagefile.clear();
+		return;
+	}
+
+	// getByteSize() already counts the sprite-sheet in AnimationManager's budget
+	render_device->pinImage(sprite);
+
+	// copies of these animations, including the default one, share their frame data
+	for (size_t i = 0; i < animations.size(); ++i)
+		animations[i]->setSprite(sprite, sprite_bounds);
+}
+
+void AnimationSet::deferSprite() {
+	if (!loaded && !sprite_required)
+		defer_sprite = true;
+}
+
+void AnimationSet::requireSprite() {
+	sprite_required = true;
+	defer_sprite = false;
+	if (loaded)
+		loadSprite();
+}
+
+bool AnimationSet::prepareSprite() {
+	if (!loaded)
+		load();
+
+	if (sprite || imagefile.empty())
+		return true;
+
+	if (!sprite_requested) {
+		render_device->requestImage(imagefile);
+		sprite_requested = true;
 	}
+
+	if (render_device->isImagePending(imagefile))
+		return false;
+
+	loadSprite();
+	return true;
+}
+
+size_t AnimationSet::getByteSize() const {
+	if (!sprite)
+		return 0;
+	return static_cast<size_t>(sprite_bounds.w) * static_cast<size_t>(sprite_bounds.h) * 4;
 }
 
 AnimationSet::~AnimationSet() {
-	if (sprite) sprite->unref();
+	if (sprite) {
+		render_device->unpinImage(sprite);
+		sprite->unref();
+	}
 	for (unsigned i = 0; i < animations.size(); ++i)
 		delete animations[i];
 	delete defaultAnimation;
 }
 
+AnimationStates::AnimationStates()
+	: set(NULL)
+	, states()
+	, active(NULL) {
+}
+
+AnimationStates::AnimationStates(const AnimationStates& other)
+	: set(other.set)
+	, states(other.states.size(), NULL)
+	, active(NULL) {
+	for (size_t i = 0; i < other.states.size(); ++i) {
+		if (!other.states[i])
+			continue;
+
+		states[i] = new Animation(*other.states[i]);
+		if (other.states[i] == other.active)
+			active = states[i];
+	}
+}
+
+AnimationStates::~AnimationStates() {
+	clear();
+}
+
+Animation *AnimationStates::setAnimationSet(AnimationSet *_set) {
+	clear();
+	set = _set;
+	return play(ANIMATION_DEFAULT_ID);
+}
+
+Animation *AnimationStates::play(int id) {
+	if (!set)
+		return NULL;
+
+	size_t index = (id >= 0) ? static_cast<size_t>(id) + 1 : 0;
+	if (index >= states.size())
+		states.resize(index + 1, NULL);
+
+	if (!states[index])
+		states[index] = set->getAnimationByID(id);
+	else
+		states[index]->restart();
+
+	active = states[index];
+	return active;
+}
+
+Animation *AnimationStates::play(StringHandle name) {
+	if (!set)
+		return NULL;
+
+	return play(set->getAnimationID(name));
+}
+
+void AnimationStates::clear() {
+	for (size_t i = 0; i < states.size(); ++i)
+		delete states[i];
+	states.clear();
+	active = NULL;
+	set = NULL;
+}
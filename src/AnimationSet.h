@@ -24,6 +24,14 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 class Animation;
 
+const int ANIMATION_DEFAULT_ID = -1;
+
+// compiled animations are stored next to their text file, with this appended to the filename
+const std::string ANIMATION_COMPILED_EXTENSION = ".bin";
+
+// bumped whenever the layout of compiled animations changes
+const unsigned ANIMATION_COMPILED_VERSION = 1;
+
 /**
  * The animation set contains all animations of one entity, hence it
  * they are all using the same spritesheet.
@@ -37,8 +45,19 @@ private:
 	Animation *defaultAnimation; // has always a non-null animation, in case of successfull load it contains the first animation in the animation file.
 	bool loaded;
 	AnimationSet *parent;
+	Rect sprite_bounds;
+
+	// a deferred sprite-sheet is only loaded once prepareSprite() or requireSprite() is called
+	bool defer_sprite;
+	bool sprite_required;
+	bool sprite_requested;
 
 	void load();
+	bool loadText(std::string& starting_animation);
+	bool loadCompiled(const std::string& fname, std::string& starting_animation);
+	bool saveCompiled(const std::string& fname, const std::string& starting_animation);
+	void clearAnimations();
+	void loadSprite();
 	unsigned getAnimationFrames(const std::string &_name);
 
 public:
@@ -57,14 +76,77 @@ public:
 	 * a default animation is returned.
 	 */
 	Animation *getAnimation(const std::string &name);
+	Animation *getAnimation(StringHandle name);
+
+	// the index of the named animation in this set, or ANIMATION_DEFAULT_ID if it isn't in the set
+	int getAnimationID(StringHandle name);
+
+	// callee is responsible to free the returned animation.
+	// ANIMATION_DEFAULT_ID, or any other id outside the set, returns the default animation
+	Animation *getAnimationByID(int id);
 
 	const std::string &getName() {
 		return name;
 	}
 
+	// writes a compiled copy of the animation file next to it, see --compile-animations
+	bool compile();
+
+	// rough size of the sprite-sheet in memory, in bytes
+	size_t getByteSize() const;
+
+	// skips loading the sprite-sheet when the animations are loaded, unless it is already required
+	void deferSprite();
+
+	// loads the sprite-sheet along with the animations, or right away if they are already loaded
+	void requireSprite();
+
+	// starts decoding a deferred sprite-sheet in the background
+	// returns true once the sprite-sheet is loaded, or if there is none
+	bool prepareSprite();
+
 	void setParent(AnimationSet *other) {
 		parent = other;
 	}
 };
 
+/**
+ * The playback state of one entity for the animations of an AnimationSet.
+ *
+ * Animation names are resolved to the integer ids of the set, and each
+ * animation is copied from the set the first time it is played. After that,
+ * switching animations only moves the cursor to the kept copy and rewinds it,
+ * so state changes don't allocate or compare strings.
+ */
+class AnimationStates {
+private:
+	AnimationSet *set;
+	std::vector<Animation*> states; // indexed by id+1, so that the default animation comes first
+	Animation *active;
+
+	AnimationStates& operator=(const AnimationStates&); // not implemented
+
+public:
+	AnimationStates();
+	AnimationStates(const AnimationStates& other); // copies the playback state too
+	~AnimationStates();
+
+	// drops the kept animations and starts on the default animation of _set
+	Animation *setAnimationSet(AnimationSet *_set);
+
+	// switches to the animation with the given id and rewinds it
+	Animation *play(int id);
+	Animation *play(StringHandle name);
+
+	Animation *getActive() {
+		return active;
+	}
+
+	AnimationSet *getAnimationSet() {
+		return set;
+	}
+
+	void clear();
+};
+
 #endif // __ANIMATION_SET__
@@ -43,6 +43,9 @@ Avatar::Avatar()
 	: Entity()
 	, lockAttack(false)
 	, attack_cursor(false)
+	, composite_image(NULL)
+	, has_pending_layers(false)
+	, attack_anim(0)
 	, hero_stats(NULL)
 	, charmed_stats(NULL)
 	, act_target()
@@ -50,18 +53,18 @@ Avatar::Avatar()
 	, respawn(false)
 	, close_menus(false)
 	, allow_movement(true)
-	, enemy_pos(FPoint(-1,-1)) {
+	, enemy_pos(FPoint(-1,-1))
+	, step_fx_loaded("") {
 
 	init();
 
 	// load the hero's animations from hero definition file
 	anim->increaseCount("animations/hero.txt");
-	animationSet = anim->getAnimationSet("animations/hero.txt");
-	activeAnimation = animationSet->getAnimation("");
+	setAnimationSet(anim->getAnimationSet("animations/hero.txt"));
 
 	// set cooldown_hit to duration of hit animation if undefined
 	if (stats.cooldown_hit == -1) {
-		Animation *hit_anim = animationSet->getAnimation("hit");
+		Animation *hit_anim = animationSet->getAnimation(ANIM_HIT);
 		if (hit_anim) {
 			stats.cooldown_hit = hit_anim->getDuration();
 			delete hit_anim;
@@ -201,34 +204,127 @@ void Avatar::loadLayerDefinitions() {
 	// then the layer_def[3] looks like (3,1,2,0)
 }
 
-void Avatar::loadGraphics(std::vector<Layer_gfx> _img_gfx) {
+bool Avatar::isLayerShown(size_t index, const std::string& name) {
+	if (index >= animsets.size())
+		return false;
+	return animsets[index] ? (animsets[index]->getName() == name) : name.empty();
+}
 
-	for (unsigned int i=0; i<animsets.size(); i++) {
-		if (animsets[i])
-			anim->decreaseCount(animsets[i]->getName());
-		delete anims[i];
-	}
-	animsets.clear();
-	anims.clear();
+/**
+ * The sprite-sheets of the layers that changed are decoded in the background, all at the same time.
+ * Until they are ready, the hero keeps the layers that are shown now, see updatePendingGraphics().
+ */
+void Avatar::loadGraphics(std::vector<Layer_gfx> _img_gfx) {
+	// a change that wasn't shown yet is replaced by this one
+	releasePendingGraphics();
 
 	for (unsigned int i=0; i<_img_gfx.size(); i++) {
-		if (_img_gfx[i].gfx != "") {
-			std::string name = "animations/avatar/"+stats.gfx_base+"/"+_img_gfx[i].gfx+".txt";
+		std::string name;
+		if (_img_gfx[i].gfx != "")
+			name = "animations/avatar/"+stats.gfx_base+"/"+_img_gfx[i].gfx+".txt";
+		pending_layers.push_back(name);
+
+		if (!name.empty() && !isLayerShown(i, name)) {
 			anim->increaseCount(name);
+			pending_sets.push_back(anim->getAnimationSet(name, true));
+			pending_sets.back()->prepareSprite();
+		}
+	}
+	has_pending_layers = true;
+
+	// without layers to show in the meantime, such as when the game is loaded, there is nothing to wait for
+	if (animsets.empty() || pending_sets.empty())
+		commitGraphics();
+}
+
+void Avatar::updatePendingGraphics() {
+	if (!has_pending_layers)
+		return;
+
+	for (size_t i=0; i<pending_sets.size(); i++) {
+		if (!pending_sets[i]->prepareSprite())
+			return;
+	}
+	commitGraphics();
+}
+
+void Avatar::releasePendingGraphics() {
+	for (size_t i=0; i<pending_sets.size(); i++) {
+		anim->decreaseCount(pending_sets[i]->getName());
+	}
+	pending_sets.clear();
+	pending_layers.clear();
+	has_pending_layers = false;
+}
+
+void Avatar::commitGraphics() {
+	// layers that didn't change keep their animations, so swapping one item only loads that item's layer
+	composite_layers.clear();
+
+	std::vector<AnimationSet*> prev_animsets;
+	std::vector<Animation*> prev_anims;
+	std::vector<AnimationStates*> prev_anim_states;
+	prev_animsets.swap(animsets);
+	prev_anims.swap(anims);
+	prev_anim_states.swap(anim_states);
+
+	std::vector<size_t> loaded_layers;
+
+	for (unsigned int i=0; i<pending_layers.size(); i++) {
+		const std::string& name = pending_layers[i];
+
+		if (i < prev_animsets.size()) {
+			bool same_layer = prev_animsets[i] ? (prev_animsets[i]->getName() == name) : name.empty();
+			if (same_layer) {
+				animsets.push_back(prev_animsets[i]);
+				anims.push_back(prev_anims[i]);
+				anim_states.push_back(prev_anim_states[i]);
+				prev_animsets[i] = NULL;
+				prev_anims[i] = NULL;
+				prev_anim_states[i] = NULL;
+				continue;
+			}
+		}
+
+		if (!name.empty()) {
+			// the reference was taken by loadGraphics()
 			animsets.push_back(anim->getAnimationSet(name));
 			animsets.back()->setParent(animationSet);
-			anims.push_back(animsets.back()->getAnimation(activeAnimation->getName()));
-			setAnimation("stance");
-			if(!anims.back()->syncTo(activeAnimation)) {
-				logError("Avatar: Error syncing animation in '%s' to 'animations/hero.txt'.", animsets.back()->getName().c_str());
-			}
+			anim_states.push_back(new AnimationStates());
+			anim_states.back()->setAnimationSet(animsets.back());
+			anims.push_back(anim_states.back()->play(activeAnimation->getNameHandle()));
+			loaded_layers.push_back(anims.size()-1);
 		}
 		else {
 			animsets.push_back(NULL);
 			anims.push_back(NULL);
+			anim_states.push_back(NULL);
 		}
 	}
-	anim->cleanUp();
+
+	// release the layers that were replaced
+	for (unsigned int i=0; i<prev_animsets.size(); i++) {
+		if (prev_animsets[i])
+			anim->decreaseCount(prev_animsets[i]->getName());
+		delete prev_anim_states[i];
+	}
+
+	if (!loaded_layers.empty()) {
+		setAnimation(ANIM_STANCE);
+		for (size_t i=0; i<loaded_layers.size(); i++) {
+			Animation *layer_anim = anims[loaded_layers[i]];
+			if (layer_anim && !layer_anim->syncTo(activeAnimation)) {
+				logError("Avatar: Error syncing animation in '%s' to 'animations/hero.txt'.", animsets[loaded_layers[i]]->getName().c_str());
+			}
+		}
+	}
+
+	pending_sets.clear();
+	pending_layers.clear();
+	has_pending_layers = false;
+
+	if (!prev_animsets.empty() || !loaded_layers.empty())
+		anim->cleanUp();
 }
 
 /**
@@ -240,6 +336,12 @@ void Avatar::loadStepFX(const std::string& stepname) {
 		filename = stepname;
 	}
 
+	// equipment changes call this even when the feet slot wasn't touched
+	if (filename == step_fx_loaded)
+		return;
+
+	step_fx_loaded = filename;
+
 	// clear previous sounds
 	for (unsigned i=0; i<sound_steps.size(); i++) {
 		snd->unload(sound_steps[i]);
@@ -407,7 +509,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 		switch(stats.cur_state) {
 			case AVATAR_STANCE:
 
-				setAnimation("stance");
+				setAnimation(ANIM_STANCE);
 
 				// allowed to move or use powers?
 				if (MOUSE_MOVE) {
@@ -443,10 +545,10 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 
 			case AVATAR_RUN:
 
-				setAnimation("run");
+				setAnimation(ANIM_RUN);
 
 				if (!sound_steps.empty()) {
-					int stepfx = rand() % static_cast<int>(sound_steps.size());
+					int stepfx = randInt(static_cast<int>(sound_steps.size()), RANDOM_VISUAL);
 
 					if (activeAnimation->isFirstFrame() || activeAnimation->isActiveFrame())
 						snd->play(sound_steps[stepfx]);
@@ -473,7 +575,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 					break;
 				}
 
-				if (activeAnimation->getName() != "run")
+				if (activeAnimation->getNameHandle() != ANIM_RUN)
 					stats.cur_state = AVATAR_STANCE;
 
 				break;
@@ -491,7 +593,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 				if (activeAnimation->isFirstFrame()) {
 					float attack_speed = (stats.effects.getAttackSpeed(attack_anim) * powers->powers[current_power].attack_speed) / 100.0f;
 					activeAnimation->setSpeed(attack_speed);
-					playAttackSound(attack_anim);
+					playAttackSound(getInternedString(attack_anim));
 					power_cast_duration[current_power] = activeAnimation->getDuration();
 					power_cast_ticks[current_power] = power_cast_duration[current_power];
 				}
@@ -509,7 +611,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 						stats.hold_state = true;
 				}
 
-				if ((activeAnimation->isLastFrame() && stats.state_ticks == 0) || activeAnimation->getName() != attack_anim) {
+				if ((activeAnimation->isLastFrame() && stats.state_ticks == 0) || activeAnimation->getNameHandle() != attack_anim) {
 					stats.cur_state = AVATAR_STANCE;
 					stats.cooldown_ticks = stats.cooldown;
 					allowed_to_use_power = false;
@@ -520,7 +622,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 
 			case AVATAR_BLOCK:
 
-				setAnimation("block");
+				setAnimation(ANIM_BLOCK);
 
 				stats.blocking = false;
 
@@ -528,7 +630,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 
 			case AVATAR_HIT:
 
-				setAnimation("hit");
+				setAnimation(ANIM_HIT);
 
 				if (activeAnimation->isFirstFrame()) {
 					stats.effects.triggered_hit = true;
@@ -539,7 +641,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 					}
 				}
 
-				if (activeAnimation->getTimesPlayed() >= 1 || activeAnimation->getName() != "hit") {
+				if (activeAnimation->getTimesPlayed() >= 1 || activeAnimation->getNameHandle() != ANIM_HIT) {
 					stats.cur_state = AVATAR_STANCE;
 				}
 
@@ -555,7 +657,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 					untransform();
 				}
 
-				setAnimation("die");
+				setAnimation(ANIM_DIE);
 
 				if (!stats.corpse && activeAnimation->isFirstFrame() && activeAnimation->getTimesPlayed() < 1) {
 					stats.effects.clearEffects();
@@ -586,7 +688,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 						inpt->lock[MAIN1] = true;
 				}
 
-				if (activeAnimation->getTimesPlayed() >= 1 || activeAnimation->getName() != "die") {
+				if (activeAnimation->getTimesPlayed() >= 1 || activeAnimation->getNameHandle() != ANIM_DIE) {
 					stats.corpse = true;
 				}
 
@@ -657,7 +759,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 					if (power.new_state != POWSTATE_INSTANT) {
 						current_power = action.power;
 						act_target = target;
-						attack_anim = power.attack_anim;
+						attack_anim = power.attack_anim_name;
 					}
 
 					if (power.state_duration > 0)
@@ -668,7 +770,7 @@ void Avatar::logic(std::vector<ActionData> &action_queue, bool restrict_power_us
 
 					stats.prevent_interrupt = power.prevent_interrupt;
 
-					if (power.pre_power > 0 && percentChance(power.pre_power_chance)) {
+					if (power.pre_power > 0 && percentChance(power.pre_power_chance, RANDOM_COMBAT)) {
 						powers->activate(power.pre_power, &stats, target);
 					}
 
@@ -745,8 +847,9 @@ void Avatar::transform() {
 	Enemy_Level el = enemyg->getRandomEnemy(stats.transform_type, 0, 0);
 
 	if (el.type != "") {
+		// the creature was loaded along with the transform power, so its stats are already parsed
 		charmed_stats = new StatBlock();
-		charmed_stats->load(el.type);
+		*charmed_stats = enemies->getEnemyDefinition(el.type)->stats;
 	}
 	else {
 		logError("Avatar: Could not transform into creature type '%s'", stats.transform_type.c_str());
@@ -779,9 +882,7 @@ void Avatar::transform() {
 
 	anim->decreaseCount("animations/hero.txt");
 	anim->increaseCount(charmed_stats->animations);
-	animationSet = anim->getAnimationSet(charmed_stats->animations);
-	delete activeAnimation;
-	activeAnimation = animationSet->getAnimation("");
+	setAnimationSet(anim->getAnimationSet(charmed_stats->animations));
 	stats.cur_state = AVATAR_STANCE;
 
 	// base stats
@@ -790,8 +891,9 @@ void Avatar::transform() {
 	}
 
 	// resistances
-	for (unsigned int i=0; i<stats.vulnerable.size(); i++) {
-		stats.vulnerable[i] = std::min(stats.vulnerable[i], charmed_stats->vulnerable[i]);
+	// these are set on the base values, since applyEffects() works out the current ones from them
+	for (unsigned int i=0; i<stats.vulnerable_base.size(); i++) {
+		stats.vulnerable_base[i] = std::min(stats.vulnerable_base[i], charmed_stats->vulnerable_base[i]);
 	}
 
 	loadSounds(charmed_stats);
@@ -843,21 +945,19 @@ void Avatar::untransform() {
 
 	anim->increaseCount("animations/hero.txt");
 	anim->decreaseCount(charmed_stats->animations);
-	animationSet = anim->getAnimationSet("animations/hero.txt");
-	delete activeAnimation;
-	activeAnimation = animationSet->getAnimation("");
+	setAnimationSet(anim->getAnimationSet("animations/hero.txt"));
 	stats.cur_state = AVATAR_STANCE;
 
 	// This is a bit of a hack.
 	// In order to switch to the stance animation, we can't already be in a stance animation
-	setAnimation("run");
+	setAnimation(ANIM_RUN);
 
 	for (unsigned int i=0; i<STAT_COUNT; ++i) {
 		stats.starting[i] = hero_stats->starting[i];
 	}
 
-	for (unsigned int i=0; i<stats.vulnerable.size(); i++) {
-		stats.vulnerable[i] = hero_stats->vulnerable[i];
+	for (unsigned int i=0; i<stats.vulnerable_base.size(); i++) {
+		stats.vulnerable_base[i] = hero_stats->vulnerable_base[i];
 	}
 
 	loadSounds();
@@ -880,17 +980,18 @@ void Avatar::checkTransform() {
 		untransform();
 }
 
-void Avatar::setAnimation(std::string name) {
-	if (name == activeAnimation->getName())
+void Avatar::setAnimation(const std::string& name) {
+	setAnimation(internString(name));
+}
+
+void Avatar::setAnimation(StringHandle name) {
+	if (name == activeAnimation->getNameHandle())
 		return;
 
 	Entity::setAnimation(name);
-	for (unsigned i=0; i < animsets.size(); i++) {
-		delete anims[i];
-		if (animsets[i])
-			anims[i] = animsets[i]->getAnimation(name);
-		else
-			anims[i] = 0;
+	for (unsigned i=0; i < anim_states.size(); i++) {
+		if (anim_states[i])
+			anims[i] = anim_states[i]->play(name);
 	}
 }
 
@@ -902,38 +1003,130 @@ void Avatar::resetActiveAnimation() {
 }
 
 void Avatar::addRenders(std::vector<Renderable> &r) {
+	const FPoint render_pos = calcInterpolatedPos(stats.prev_pos, stats.pos);
+
 	if (!stats.transformed) {
+		layer_buf.clear();
 		for (unsigned i = 0; i < layer_def[stats.direction].size(); ++i) {
 			unsigned index = layer_def[stats.direction][i];
 			if (anims[index]) {
-				Renderable ren = anims[index]->getCurrentFrame(stats.direction);
-				ren.map_pos = stats.pos;
+				layer_buf.push_back(Renderable());
+				Renderable &ren = layer_buf.back();
+				anims[index]->getCurrentFrame(stats.direction, ren);
+				ren.map_pos = render_pos;
 				ren.prio = i+1;
 				stats.effects.getCurrentColor(ren.color_mod);
 				stats.effects.getCurrentAlpha(ren.alpha_mod);
-				r.push_back(ren);
 			}
 		}
+
+		if (COMPOSITE_AVATAR && layer_buf.size() > 1 && compositeLayers(layer_buf)) {
+			Renderable ren;
+			ren.image = composite_image;
+			ren.src = composite_src;
+			ren.offset = composite_offset;
+			ren.map_pos = render_pos;
+			ren.prio = 1;
+			stats.effects.getCurrentColor(ren.color_mod);
+			stats.effects.getCurrentAlpha(ren.alpha_mod);
+			r.push_back(ren);
+		}
+		else {
+			r.insert(r.end(), layer_buf.begin(), layer_buf.end());
+		}
 	}
 	else {
-		Renderable ren = activeAnimation->getCurrentFrame(stats.direction);
-		ren.map_pos = stats.pos;
+		r.push_back(Renderable());
+		Renderable &ren = r.back();
+		activeAnimation->getCurrentFrame(stats.direction, ren);
+		ren.map_pos = render_pos;
 		stats.effects.getCurrentColor(ren.color_mod);
 		stats.effects.getCurrentAlpha(ren.alpha_mod);
-		r.push_back(ren);
 	}
 	// add effects
 	for (unsigned i = 0; i < stats.effects.effect_list.size(); ++i) {
 		if (stats.effects.effect_list[i].animation && !stats.effects.effect_list[i].animation->isCompleted()) {
-			Renderable ren = stats.effects.effect_list[i].animation->getCurrentFrame(0);
-			ren.map_pos = stats.pos;
+			r.push_back(Renderable());
+			Renderable &ren = r.back();
+			stats.effects.effect_list[i].animation->getCurrentFrame(0, ren);
+			ren.map_pos = render_pos;
 			if (stats.effects.effect_list[i].render_above) ren.prio = layer_def[stats.direction].size()+1;
 			else ren.prio = 0;
-			r.push_back(ren);
 		}
 	}
 }
 
+/**
+ * Draws the layers of the current frame into composite_image, unless it already holds them.
+ * Animation frames last several logic frames, so the flattened image is usually reused,
+ * and the world pass gets one sprite for the hero instead of one per equipment layer.
+ * Returns false if the layers have to be drawn separately.
+ */
+bool Avatar::compositeLayers(const std::vector<Renderable>& layers) {
+	bool same_layers = composite_image && layers.size() == composite_layers.size();
+	for (size_t i = 0; same_layers && i < layers.size(); ++i) {
+		const Renderable& a = layers[i];
+		const Renderable& b = composite_layers[i];
+		same_layers = a.image == b.image && a.offset.x == b.offset.x && a.offset.y == b.offset.y
+			&& a.src.x == b.src.x && a.src.y == b.src.y && a.src.w == b.src.w && a.src.h == b.src.h;
+	}
+	if (same_layers)
+		return true;
+
+	composite_layers.clear();
+
+	// the area covered by all layers, relative to the hero's feet
+	int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+	for (size_t i = 0; i < layers.size(); ++i) {
+		if (!layers[i].image || layers[i].blend_mode != RENDERABLE_BLEND_NORMAL)
+			return false;
+
+		int x = -layers[i].offset.x;
+		int y = -layers[i].offset.y;
+		if (i == 0 || x < min_x) min_x = x;
+		if (i == 0 || y < min_y) min_y = y;
+		if (i == 0 || x + layers[i].src.w > max_x) max_x = x + layers[i].src.w;
+		if (i == 0 || y + layers[i].src.h > max_y) max_y = y + layers[i].src.h;
+	}
+
+	int width = max_x - min_x;
+	int height = max_y - min_y;
+	if (width <= 0 || height <= 0)
+		return false;
+
+	// the image only grows, so it is created once for most heroes
+	if (!composite_image || composite_image->getWidth() < width || composite_image->getHeight() < height) {
+		int image_w = composite_image ? std::max(width, composite_image->getWidth()) : width;
+		int image_h = composite_image ? std::max(height, composite_image->getHeight()) : height;
+		if (composite_image)
+			composite_image->unref();
+		composite_image = render_device->createImage(image_w, image_h);
+		if (!composite_image)
+			return false;
+	}
+	else {
+		composite_image->fillWithColor(Color(0,0,0,0));
+	}
+
+	for (size_t i = 0; i < layers.size(); ++i) {
+		Rect src = layers[i].src;
+		Rect dest;
+		dest.x = -layers[i].offset.x - min_x;
+		dest.y = -layers[i].offset.y - min_y;
+		render_device->renderToImage(layers[i].image, src, composite_image, dest);
+	}
+
+	composite_src.x = 0;
+	composite_src.y = 0;
+	composite_src.w = width;
+	composite_src.h = height;
+	composite_offset.x = -min_x;
+	composite_offset.y = -min_y;
+	composite_layers = layers;
+
+	return true;
+}
+
 void Avatar::logMsg(const std::string& str, bool prevent_spam) {
 	log_msg.push(std::pair<std::string, bool>(str, prevent_spam));
 }
@@ -949,10 +1142,14 @@ Avatar::~Avatar() {
 	for (unsigned int i=0; i<animsets.size(); i++) {
 		if (animsets[i])
 			anim->decreaseCount(animsets[i]->getName());
-		delete anims[i];
+		delete anim_states[i];
 	}
+	releasePendingGraphics();
 	anim->cleanUp();
 
+	if (composite_image)
+		composite_image->unref();
+
 	delete charmed_stats;
 	delete hero_stats;
 
@@ -73,7 +73,8 @@ private:
 	void set_direction();
 	void transform();
 	void untransform();
-	void setAnimation(std::string name);
+	void setAnimation(const std::string& name);
+	void setAnimation(StringHandle name);
 
 	bool lockAttack;
 
@@ -83,6 +84,7 @@ private:
 
 	std::vector<AnimationSet*> animsets; // hold the animations for all equipped items in the right order of drawing.
 	std::vector<Animation*> anims; // hold the animations for all equipped items in the right order of drawing.
+	std::vector<AnimationStates*> anim_states; // owns the animations in anims
 
 	short body;
 
@@ -91,6 +93,24 @@ private:
 
 	bool attack_cursor;
 
+	bool compositeLayers(const std::vector<Renderable>& layers);
+
+	// the equipment layers of the current frame flattened into one image, see addRenders()
+	Image *composite_image;
+	Rect composite_src;
+	Point composite_offset;
+	std::vector<Renderable> composite_layers; // the layers composite_image was built from
+	std::vector<Renderable> layer_buf;
+
+	// the equipment layers of the last loadGraphics(), shown once the sprite-sheets in pending_sets are decoded
+	std::vector<std::string> pending_layers;
+	std::vector<AnimationSet*> pending_sets;
+	bool has_pending_layers;
+
+	bool isLayerShown(size_t index, const std::string& name);
+	void commitGraphics();
+	void releasePendingGraphics();
+
 protected:
 	virtual void resetActiveAnimation();
 
@@ -100,6 +120,7 @@ public:
 
 	void init();
 	void loadGraphics(std::vector<Layer_gfx> _img_gfx);
+	void updatePendingGraphics();
 	void loadStepFX(const std::string& stepname);
 
 	void logic(std::vector<ActionData> &action_queue, bool restrict_power_use, bool npc);
@@ -119,7 +140,7 @@ public:
 
 	std::queue<std::pair<std::string, bool> > log_msg;
 
-	std::string attack_anim;
+	StringHandle attack_anim;
 	bool setPowers;
 	bool revertPowers;
 	int untransform_power;
@@ -141,6 +162,7 @@ public:
 	std::vector<int> power_cast_ticks;
 	std::vector<int> power_cast_duration;
 	FPoint enemy_pos; // positon of the highlighted enemy
+	std::string step_fx_loaded; // the footstep set that sound_steps was loaded from
 };
 
 #endif
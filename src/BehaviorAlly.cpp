@@ -26,9 +26,22 @@ const float ALLY_FOLLOW_DISTANCE_WALK = 5.5;
 const float ALLY_FOLLOW_DISTANCE_STOP = 5;
 const float ALLY_TELEPORT_DISTANCE = 40;
 
+// allies this close to the hero walk to their party slot, see EnemyManager::updateParty()
+const float ALLY_PARTY_DISTANCE = 8;
+const float ALLY_SLOT_DISTANCE_WALK = 1.5;
+const float ALLY_SLOT_DISTANCE_STOP = 0.5;
+
 const unsigned short BLOCK_TICKS = 10;
 
-BehaviorAlly::BehaviorAlly(Enemy *_e) : BehaviorStandard(_e) {
+static bool isHostileInCombat(const Entity *e) {
+	return e->stats.in_combat && !e->stats.hero_ally;
+}
+
+BehaviorAlly::BehaviorAlly(Enemy *_e)
+	: BehaviorStandard(_e)
+	, follow_dist(0)
+	, follow_walk(ALLY_FOLLOW_DISTANCE_WALK)
+	, follow_stop(ALLY_FOLLOW_DISTANCE_STOP) {
 }
 
 BehaviorAlly::~BehaviorAlly() {
@@ -54,26 +67,15 @@ void BehaviorAlly::findTarget() {
 	}
 
 	bool enemies_in_combat = false;
-	//enter combat because enemy is targeting the player or a summon
-	for (unsigned int i=0; i < enemies->enemies.size(); i++) {
-		if(enemies->enemies[i]->stats.in_combat && !enemies->enemies[i]->stats.hero_ally) {
-			Enemy* enemy = enemies->enemies[i];
-
-			//now work out the distance to the enemy and compare it to the distance to the current targer (we want to target the closest enemy)
-			if(enemies_in_combat) {
-				float enemy_dist = calcDist(e->stats.pos, enemy->stats.pos);
-				if (enemy_dist < target_dist) {
-					pursue_pos.x = enemy->stats.pos.x;
-					pursue_pos.y = enemy->stats.pos.y;
-					target_dist = enemy_dist;
-				}
-			}
-			else {
-				//minion is not already chasig another enemy so chase this one
-				pursue_pos.x = enemy->stats.pos.x;
-				pursue_pos.y = enemy->stats.pos.y;
-				target_dist = calcDist(e->stats.pos, enemy->stats.pos);
-			}
+	//enter combat because enemy is targeting the player or a summon, and chase the closest one
+	if (enemies->hostiles_in_combat > 0) {
+		float max_dist = static_cast<float>(mapr->w + mapr->h);
+		mapr->entity_grid.getNearest(e->stats.pos, max_dist, ENTITY_MASK_HOSTILE | ENTITY_MASK_CORPSE, 1, nearby, isHostileInCombat);
+		if (!nearby.empty()) {
+			const Entity *enemy = nearby[0];
+			pursue_pos.x = enemy->stats.pos.x;
+			pursue_pos.y = enemy->stats.pos.y;
+			target_dist = calcDist(e->stats.pos, enemy->stats.pos);
 
 			e->stats.in_combat = true;
 			enemies_in_combat = true;
@@ -89,15 +91,32 @@ void BehaviorAlly::findTarget() {
 	if (e->stats.combat_style == COMBAT_AGGRESSIVE)
 		e->stats.in_combat = true;
 
+	follow_dist = hero_dist;
+	follow_walk = ALLY_FOLLOW_DISTANCE_WALK;
+	follow_stop = ALLY_FOLLOW_DISTANCE_STOP;
+
 	//the default target is the player
 	if(!e->stats.in_combat) {
 		pursue_pos.x = pc->stats.pos.x;
 		pursue_pos.y = pc->stats.pos.y;
 		target_dist = hero_dist;
+
+		// near the hero, walk to our place in the party instead
+		// if the way there is blocked, follow the hero, since all allies share one flow field towards the hero
+		if (e->party_slot >= 0 && hero_dist < ALLY_PARTY_DISTANCE) {
+			const FPoint& slot = enemies->party_slots[e->party_slot];
+			if (mapr->collider.line_of_movement(e->stats.pos.x, e->stats.pos.y, slot.x, slot.y, e->stats.movement_type)) {
+				pursue_pos = slot;
+				target_dist = calcDist(e->stats.pos, slot);
+				follow_dist = target_dist;
+				follow_walk = ALLY_SLOT_DISTANCE_WALK;
+				follow_stop = ALLY_SLOT_DISTANCE_STOP;
+			}
+		}
 	}
 
-	// check line-of-sight
-	if (target_dist < e->stats.threat_range && pc->stats.alive)
+	// check line-of-sight; allies only attack in combat, so the others don't need it
+	if (e->stats.in_combat && target_dist < e->stats.threat_range && pc->stats.alive)
 		los = mapr->collider.line_of_sight(e->stats.pos.x, e->stats.pos.y, pursue_pos.x, pursue_pos.y);
 	else
 		los = false;
@@ -126,7 +145,7 @@ void BehaviorAlly::findTarget() {
 			e->stats.cur_state == ENEMY_STANCE &&
 			!move_to_safe_dist && hero_dist < e->stats.flee_range &&
 			hero_dist >= e->stats.melee_range &&
-			percentChance(e->stats.chance_flee) &&
+			percentChance(e->stats.chance_flee, RANDOM_AI) &&
 			flee_cooldown == 0
 		)
 	{
@@ -164,7 +183,7 @@ void BehaviorAlly::findTarget() {
 			fleeing = false;
 		}
 		else {
-			int index = randBetween(0, static_cast<int>(flee_dirs.size())-1);
+			int index = randBetween(0, static_cast<int>(flee_dirs.size())-1, RANDOM_AI);
 			pursue_pos = calcVector(e->stats.pos, flee_dirs[index], 1);
 
 			if (flee_ticks == 0) {
@@ -182,7 +201,7 @@ void BehaviorAlly::checkMoveStateStance() {
 	// try to move to the target if we're either:
 	// 1. too far away and chance_pursue roll succeeds
 	// 2. within range, but lack line-of-sight (required to attack)
-	bool should_move_to_target = (target_dist > e->stats.melee_range && percentChance(e->stats.chance_pursue)) || (target_dist <= e->stats.melee_range && !los) || (hero_dist > ALLY_FOLLOW_DISTANCE_WALK);
+	bool should_move_to_target = (target_dist > e->stats.melee_range && percentChance(e->stats.chance_pursue, RANDOM_AI)) || (target_dist <= e->stats.melee_range && !los) || (follow_dist > follow_walk);
 
 	if (should_move_to_target || fleeing) {
 		if(e->stats.in_combat && target_dist > e->stats.melee_range) {
@@ -190,7 +209,7 @@ void BehaviorAlly::checkMoveStateStance() {
 				e->stats.cur_state = ENEMY_MOVE;
 		}
 
-		if((!e->stats.in_combat && hero_dist > ALLY_FOLLOW_DISTANCE_WALK) || fleeing) {
+		if((!e->stats.in_combat && follow_dist > follow_walk) || fleeing) {
 			if (e->move()) {
 				e->stats.cur_state = ENEMY_MOVE;
 			}
@@ -216,16 +235,10 @@ void BehaviorAlly::checkMoveStateMove() {
 		can_attack = false;
 	}
 	else {
-		can_attack = false;
-		for (size_t i = 0; i < e->stats.powers_ai.size(); ++i) {
-			if (e->stats.powers_ai[i].ticks == 0) {
-				can_attack = true;
-				break;
-			}
-		}
+		can_attack = e->stats.hasReadyAIPower();
 	}
 	// in order to prevent infinite fleeing, we re-roll our chance to flee after a certain duration
-	bool stop_fleeing = can_attack && fleeing && flee_ticks == 0 && !percentChance(e->stats.chance_flee);
+	bool stop_fleeing = can_attack && fleeing && flee_ticks == 0 && !percentChance(e->stats.chance_flee, RANDOM_AI);
 
 	if (!stop_fleeing && flee_ticks == 0) {
 		// if the roll to continue fleeing succeeds, but the flee duration has expired, we don't want to reset the duration to the full amount
@@ -235,7 +248,7 @@ void BehaviorAlly::checkMoveStateMove() {
 	}
 
 	//if close enough to hero, stop miving
-	if((hero_dist < ALLY_FOLLOW_DISTANCE_STOP && !e->stats.in_combat && !fleeing)
+	if((follow_dist < follow_stop && !e->stats.in_combat && !fleeing)
 			|| (target_dist < e->stats.melee_range && e->stats.in_combat && !fleeing)
 			|| (move_to_safe_dist && target_dist >= e->stats.threat_range/2)
 			|| stop_fleeing)
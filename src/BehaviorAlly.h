@@ -27,6 +27,11 @@ public:
 	virtual ~BehaviorAlly();
 protected:
 private:
+	// the distance to the hero or to the ally's party slot, and when to start and stop walking there
+	float follow_dist;
+	float follow_walk;
+	float follow_stop;
+
 	virtual void findTarget();
 	virtual void checkMoveStateStance();
 	virtual void checkMoveStateMove();
@@ -29,7 +29,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 BehaviorStandard::BehaviorStandard(Enemy *_e)
 	: EnemyBehavior(_e)
 	, path()
-	, prev_target()
+	, path_target()
 	, collided(false)
 	, path_found(false)
 	, chance_calc_path(0)
@@ -41,9 +41,51 @@ BehaviorStandard::BehaviorStandard(Enemy *_e)
 	, move_to_safe_dist(false)
 	, flee_ticks(0)
 	, flee_cooldown(0)
+	, nearby()
+	, decided(false)
+	, decided_hero_dist(0)
+	, decided_ally_known(false)
+	, decided_ally(NULL)
+	, decided_los_known(false)
+	, decided_los(false)
+	, nearest_buf()
+	, lod_ticks(_e->runtime_index)
 {
 }
 
+BehaviorStandard::~BehaviorStandard() {
+	if (mapr)
+		mapr->collider.cancel_path(this);
+}
+
+/**
+ * The targeting queries of findTarget(), made from the state at the start of the frame
+ * EnemyManager runs these for all creatures in parallel. Anything that changes the game,
+ * or that depends on what other creatures do this frame, is left to logic().
+ */
+void BehaviorStandard::decide() {
+	decided = false;
+	decided_ally_known = false;
+	decided_los_known = false;
+
+	// teleporting creatures move in doUpkeep(), before they look for a target
+	// allies look for their targets in BehaviorAlly::findTarget() instead
+	if (e->stats.corpse || e->stats.hero_ally || !e->stats.encountered || e->stats.effects.stun || e->stats.teleportation)
+		return;
+
+	decided = true;
+	decided_hero_dist = pc->stats.alive ? calcDist(e->stats.pos, pc->stats.pos) : 0;
+
+	if (e->stats.in_combat || e->stats.join_combat || e->stats.combat_style == COMBAT_AGGRESSIVE) {
+		mapr->entity_grid.getNearest(e->stats.pos, decided_hero_dist, ENTITY_MASK_ALLY, 1, nearby, nearest_buf);
+		decided_ally = nearby.empty() ? NULL : nearby[0];
+		decided_ally_known = true;
+	}
+
+	if (pc->stats.alive)
+		decided_los_known = mapr->collider.get_cached_line_of_sight(e->stats.pos, pc->stats.pos, decided_los);
+}
+
 /**
  * One frame of logic for this behavior
  */
@@ -64,13 +106,59 @@ void BehaviorStandard::logic() {
 			return;
 	}
 
+	const int detail = getDetailLevel();
+	if (detail == AI_DETAIL_SLEEP)
+		return;
+
 	doUpkeep();
-	findTarget();
-	checkPower();
-	checkMove();
+
+	// distant creatures only make decisions every few frames, and otherwise keep doing what they were doing
+	if (detail == AI_DETAIL_FULL || (++lod_ticks % AI_THROTTLE_INTERVAL) == 0) {
+		findTarget();
+		checkPower();
+		checkMove();
+	}
+	else {
+		coast();
+	}
 	updateState();
 
 	fleeing = false;
+	decided = false;
+}
+
+/**
+ * Creatures far away from both the hero and the camera get less work.
+ * Allies and anything in combat always get the full logic.
+ */
+int BehaviorStandard::getDetailLevel() {
+	if (e->stats.hero_ally || e->stats.in_combat || e->stats.join_combat)
+		return AI_DETAIL_FULL;
+
+	if (AI_THROTTLE_DISTANCE <= 0 && AI_SLEEP_DISTANCE <= 0)
+		return AI_DETAIL_FULL;
+
+	const float dist = std::min(calcDist(e->stats.pos, pc->stats.pos), calcDist(e->stats.pos, mapr->cam));
+
+	if (AI_SLEEP_DISTANCE > 0 && dist > AI_SLEEP_DISTANCE)
+		return AI_DETAIL_SLEEP;
+	else if (AI_THROTTLE_DISTANCE > 0 && dist > AI_THROTTLE_DISTANCE)
+		return AI_DETAIL_THROTTLED;
+
+	return AI_DETAIL_FULL;
+}
+
+/**
+ * Keep moving in the current direction between throttled decisions
+ */
+void BehaviorStandard::coast() {
+	if (e->stats.cur_state != ENEMY_MOVE || e->stats.effects.stun)
+		return;
+
+	mapr->collider.unblock(e->stats.pos.x, e->stats.pos.y);
+	if (!e->move())
+		e->stats.cur_state = ENEMY_STANCE;
+	mapr->collider.block(e->stats.pos.x, e->stats.pos.y, e->stats.hero_ally);
 }
 
 /**
@@ -145,7 +233,9 @@ void BehaviorStandard::findTarget() {
 	if (e->stats.effects.stun) return;
 
 	// check distance and line of sight between enemy and hero
-	if (pc->stats.alive)
+	if (decided)
+		hero_dist = decided_hero_dist;
+	else if (pc->stats.alive)
 		hero_dist = calcDist(e->stats.pos, pc->stats.pos);
 	else
 		hero_dist = 0;
@@ -199,15 +289,21 @@ void BehaviorStandard::findTarget() {
 
 	//if there are player allies closer than the hero, target an ally instead
 	if(e->stats.in_combat) {
-		for (unsigned int i=0; i < enemies->enemies.size(); i++) {
-			if(!enemies->enemies[i]->stats.corpse && enemies->enemies[i]->stats.hero_ally) {
-				//now work out the distance to the minion and compare it to the distance to the current targer (we want to target the closest ally)
-				float ally_dist = calcDist(e->stats.pos, enemies->enemies[i]->stats.pos);
-				if (ally_dist < target_dist) {
-					pursue_pos.x = enemies->enemies[i]->stats.pos.x;
-					pursue_pos.y = enemies->enemies[i]->stats.pos.y;
-					target_dist = ally_dist;
-				}
+		const Entity *ally = NULL;
+		if (decided && decided_ally_known) {
+			ally = decided_ally;
+		}
+		else {
+			mapr->entity_grid.getNearest(e->stats.pos, target_dist, ENTITY_MASK_ALLY, 1, nearby);
+			if (!nearby.empty())
+				ally = nearby[0];
+		}
+		if (ally) {
+			float ally_dist = calcDist(e->stats.pos, ally->stats.pos);
+			if (ally_dist < target_dist) {
+				pursue_pos.x = ally->stats.pos.x;
+				pursue_pos.y = ally->stats.pos.y;
+				target_dist = ally_dist;
 			}
 		}
 	}
@@ -227,8 +323,12 @@ void BehaviorStandard::findTarget() {
 	}
 
 	// check line-of-sight
-	if (target_dist < e->stats.threat_range && pc->stats.alive)
-		los = mapr->collider.line_of_sight(e->stats.pos.x, e->stats.pos.y, pc->stats.pos.x, pc->stats.pos.y);
+	if (target_dist < e->stats.threat_range && pc->stats.alive) {
+		if (decided && decided_los_known)
+			los = decided_los;
+		else
+			los = mapr->collider.line_of_sight(e->stats.pos.x, e->stats.pos.y, pc->stats.pos.x, pc->stats.pos.y);
+	}
 	else
 		los = false;
 
@@ -239,7 +339,7 @@ void BehaviorStandard::findTarget() {
 			e->stats.cur_state == ENEMY_STANCE &&
 			!move_to_safe_dist && hero_dist < e->stats.flee_range &&
 			hero_dist >= e->stats.melee_range &&
-			percentChance(e->stats.chance_flee) &&
+			percentChance(e->stats.chance_flee, RANDOM_AI) &&
 			flee_cooldown == 0
 		)
 	{
@@ -277,7 +377,7 @@ void BehaviorStandard::findTarget() {
 			fleeing = false;
 		}
 		else {
-			int index = randBetween(0, static_cast<int>(flee_dirs.size())-1);
+			int index = randBetween(0, static_cast<int>(flee_dirs.size())-1, RANDOM_AI);
 			pursue_pos = calcVector(e->stats.pos, flee_dirs[index], 1);
 
 			if (flee_ticks == 0) {
@@ -367,54 +467,65 @@ void BehaviorStandard::checkMove() {
 			// if blocked, face in pathfinder direction instead
 			if (!mapr->collider.line_of_movement(e->stats.pos.x, e->stats.pos.y, pursue_pos.x, pursue_pos.y, e->stats.movement_type)) {
 
-				// if a path is returned, target first waypoint
-
-				bool recalculate_path = false;
+				// enemies chasing the hero share one flow field instead of each computing a path
+				FPoint flow_step;
+				bool chasing_hero = !fleeing && pursue_pos.x == pc->stats.pos.x && pursue_pos.y == pc->stats.pos.y;
+				if (chasing_hero && mapr->collider.compute_flow_step(e->stats.pos, pursue_pos, flow_step, e->stats.movement_type)) {
+					path.clear();
+					mapr->collider.cancel_path(this);
+					pursue_pos = flow_step;
+				}
+				else {
+					// a path asked for earlier has been computed
+					mapr->collider.take_path(this, path, path_found);
 
-				//if theres no path, it needs to be calculated
-				if(path.empty())
-					recalculate_path = true;
+					bool recalculate_path = false;
 
-				//if the target moved more than 1 tile away, recalculate
-				if(calcDist(map_to_collision(prev_target), map_to_collision(pursue_pos)) > 1.f)
-					recalculate_path = true;
+					//if theres no path, it needs to be calculated
+					if(path.empty())
+						recalculate_path = true;
 
-				//if a collision ocurred then recalculate
-				if(collided)
-					recalculate_path = true;
+					//if the target moved too far from where the path leads, recalculate
+					if(calcDist(map_to_collision(path_target), map_to_collision(pursue_pos)) > PATH_REUSE_DISTANCE)
+						recalculate_path = true;
 
-				//add a 5% chance to recalculate on every frame. This prevents reclaulating lots of entities in the same frame
-				chance_calc_path += 5;
+					//if a collision ocurred then recalculate
+					if(collided)
+						recalculate_path = true;
 
-				if(percentChance(chance_calc_path))
-					recalculate_path = true;
+					//add a 5% chance to recalculate on every frame. This prevents reclaulating lots of entities in the same frame
+					chance_calc_path += 5;
 
-				//dont recalculate if we were blocked and no path was found last time
-				//this makes sure that pathfinding calculation is not spammed when the target is unreachable and the entity is as close as its going to get
-				if(!path_found && collided && !percentChance(chance_calc_path))
-					recalculate_path = false;
-				else//reset the collision flag only if we dont want the cooldown in place
-					collided = false;
+					if(percentChance(chance_calc_path, RANDOM_AI))
+						recalculate_path = true;
 
-				prev_target = pursue_pos;
+					//dont recalculate if we were blocked and no path was found last time
+					//this makes sure that pathfinding calculation is not spammed when the target is unreachable and the entity is as close as its going to get
+					if(!path_found && collided && !percentChance(chance_calc_path, RANDOM_AI))
+						recalculate_path = false;
+					else//reset the collision flag only if we dont want the cooldown in place
+						collided = false;
 
-				// target first waypoint
-				if(recalculate_path) {
-					chance_calc_path = -100;
-					path.clear();
-					path_found = mapr->collider.compute_path(e->stats.pos, pursue_pos, path, e->stats.movement_type);
-				}
+					// the old path, or a straight line if there is none, is followed until the new one is ready
+					if(recalculate_path) {
+						chance_calc_path = -100;
+						path_target = pursue_pos;
+						mapr->collider.request_path(this, e->stats.pos, pursue_pos, e->stats.movement_type);
+					}
 
-				if(!path.empty()) {
-					pursue_pos = path.back();
+					// target first waypoint
+					if(!path.empty()) {
+						pursue_pos = path.back();
 
-					//if distance to node is lower than a tile size, the node is going to be passed and can be removed
-					if(calcDist(e->stats.pos, pursue_pos) <= 1.f)
-						path.pop_back();
+						//if distance to node is lower than a tile size, the node is going to be passed and can be removed
+						if(calcDist(e->stats.pos, pursue_pos) <= 1.f)
+							path.pop_back();
+					}
 				}
 			}
 			else {
 				path.clear();
+				mapr->collider.cancel_path(this);
 			}
 
 			if (e->stats.charge_speed == 0.0f) {
@@ -469,7 +580,7 @@ void BehaviorStandard::checkMoveStateStance() {
 	// try to move to the target if we're either:
 	// 1. too far away and chance_pursue roll succeeds
 	// 2. within range, but lack line-of-sight (required to attack)
-	bool should_move_to_target = (target_dist > e->stats.melee_range && percentChance(e->stats.chance_pursue)) || (target_dist <= e->stats.melee_range && !los);
+	bool should_move_to_target = (target_dist > e->stats.melee_range && percentChance(e->stats.chance_pursue, RANDOM_AI)) || (target_dist <= e->stats.melee_range && !los);
 
 	if (should_move_to_target || fleeing) {
 
@@ -498,16 +609,10 @@ void BehaviorStandard::checkMoveStateMove() {
 		can_attack = false;
 	}
 	else {
-		can_attack = false;
-		for (size_t i = 0; i < e->stats.powers_ai.size(); ++i) {
-			if (e->stats.powers_ai[i].ticks == 0) {
-				can_attack = true;
-				break;
-			}
-		}
+		can_attack = e->stats.hasReadyAIPower();
 	}
 	// in order to prevent infinite fleeing, we re-roll our chance to flee after a certain duration
-	bool stop_fleeing = can_attack && fleeing && flee_ticks == 0 && !percentChance(e->stats.chance_flee);
+	bool stop_fleeing = can_attack && fleeing && flee_ticks == 0 && !percentChance(e->stats.chance_flee, RANDOM_AI);
 
 	if (!stop_fleeing && flee_ticks == 0) {
 		// if the roll to continue fleeing succeeds, but the flee duration has expired, we don't want to reset the duration to the full amount
@@ -560,12 +665,12 @@ void BehaviorStandard::updateState() {
 
 		case ENEMY_STANCE:
 
-			e->setAnimation("stance");
+			e->setAnimation(ANIM_STANCE);
 			break;
 
 		case ENEMY_MOVE:
 
-			e->setAnimation("run");
+			e->setAnimation(ANIM_RUN);
 			break;
 
 		case ENEMY_POWER:
@@ -583,11 +688,11 @@ void BehaviorStandard::updateState() {
 			if (power_state == POWSTATE_INSTANT)
 				e->instant_power = true;
 			else if (power_state == POWSTATE_ATTACK)
-				e->setAnimation(powers->powers[power_id].attack_anim);
+				e->setAnimation(powers->powers[power_id].attack_anim_name);
 
 			// sound effect based on power type
 			if (e->activeAnimation->isFirstFrame()) {
-				float attack_speed = (e->stats.effects.getAttackSpeed(powers->powers[power_id].attack_anim) * powers->powers[power_id].attack_speed) / 100.0f;
+				float attack_speed = (e->stats.effects.getAttackSpeed(powers->powers[power_id].attack_anim_name) * powers->powers[power_id].attack_speed) / 100.0f;
 				e->activeAnimation->setSpeed(attack_speed);
 				e->playAttackSound(powers->powers[power_id].attack_anim);
 
@@ -607,7 +712,7 @@ void BehaviorStandard::updateState() {
 				// set cooldown for all ai powers with the same power id
 				for (size_t i = 0; i < e->stats.powers_ai.size(); ++i) {
 					if (e->stats.activated_power->id == e->stats.powers_ai[i].id) {
-						e->stats.powers_ai[i].ticks = powers->powers[power_id].cooldown;
+						e->stats.setAIPowerCooldown(i, powers->powers[power_id].cooldown);
 					}
 				}
 
@@ -621,7 +726,7 @@ void BehaviorStandard::updateState() {
 
 			// animation is finished
 			if ((e->activeAnimation->isLastFrame() && e->stats.state_ticks == 0) ||
-			    (power_state == POWSTATE_ATTACK && e->activeAnimation->getName() != powers->powers[power_id].attack_anim) ||
+			    (power_state == POWSTATE_ATTACK && e->activeAnimation->getNameHandle() != powers->powers[power_id].attack_anim_name) ||
 			    e->instant_power)
 			{
 				if (!e->instant_power)
@@ -637,32 +742,32 @@ void BehaviorStandard::updateState() {
 
 		case ENEMY_SPAWN:
 
-			e->setAnimation("spawn");
+			e->setAnimation(ANIM_SPAWN);
 			//the second check is needed in case the entity does not have a spawn animation
-			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getName() != "spawn") {
+			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getNameHandle() != ANIM_SPAWN) {
 				e->stats.cur_state = ENEMY_STANCE;
 			}
 			break;
 
 		case ENEMY_BLOCK:
 
-			e->setAnimation("block");
+			e->setAnimation(ANIM_BLOCK);
 			break;
 
 		case ENEMY_HIT:
 
-			e->setAnimation("hit");
+			e->setAnimation(ANIM_HIT);
 			if (e->activeAnimation->isFirstFrame()) {
 				e->stats.effects.triggered_hit = true;
 			}
-			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getName() != "hit")
+			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getNameHandle() != ANIM_HIT)
 				e->stats.cur_state = ENEMY_STANCE;
 			break;
 
 		case ENEMY_DEAD:
 			if (e->stats.effects.triggered_death) break;
 
-			e->setAnimation("die");
+			e->setAnimation(ANIM_DIE);
 			if (e->activeAnimation->isFirstFrame()) {
 				snd->play(e->sound_die);
 				e->stats.corpse_ticks = CORPSE_TIMEOUT;
@@ -673,7 +778,7 @@ void BehaviorStandard::updateState() {
 				if (ai_power != NULL)
 					powers->activate(ai_power->id, &e->stats, e->stats.pos);
 			}
-			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getName() != "die") {
+			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getNameHandle() != ANIM_DIE) {
 				// puts renderable under object layer
 				e->stats.corpse = true;
 
@@ -693,7 +798,7 @@ void BehaviorStandard::updateState() {
 
 		case ENEMY_CRITDEAD:
 
-			e->setAnimation("critdie");
+			e->setAnimation(ANIM_CRITDIE);
 			if (e->activeAnimation->isFirstFrame()) {
 				snd->play(e->sound_critdie);
 				e->stats.corpse_ticks = CORPSE_TIMEOUT;
@@ -704,7 +809,7 @@ void BehaviorStandard::updateState() {
 				if (ai_power != NULL)
 					powers->activate(ai_power->id, &e->stats, e->stats.pos);
 			}
-			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getName() != "critdie") {
+			if (e->activeAnimation->isLastFrame() || e->activeAnimation->getNameHandle() != ANIM_CRITDIE) {
 				// puts renderable under object layer
 				e->stats.corpse = true;
 
@@ -728,16 +833,24 @@ void BehaviorStandard::updateState() {
 		e->stats.charge_speed = 0.0f;
 }
 
+/**
+ * Picks a random reachable tile of the wander area. Tiles taken by other entities are
+ * passed over, since the enemy would never get close enough to them to pick the next one.
+ */
 FPoint BehaviorStandard::getWanderPoint() {
-	FPoint waypoint;
-	waypoint.x = static_cast<float>(e->stats.wander_area.x) + static_cast<float>(rand() % (e->stats.wander_area.w)) + 0.5f;
-	waypoint.y = static_cast<float>(e->stats.wander_area.y) + static_cast<float>(rand() % (e->stats.wander_area.h)) + 0.5f;
+	const std::vector<Point>& tiles = mapr->collider.get_wander_tiles(e->stats.wander_area, e->stats.movement_type);
 
-	if (mapr->collider.is_valid_position(waypoint.x, waypoint.y, e->stats.movement_type, e->stats.hero)) {
-		return waypoint;
-	}
-	else {
-		// didn't get a valid waypoint, so keep our current position
-		return e->stats.pos;
+	if (!tiles.empty()) {
+		const size_t first = randIndex(tiles.size(), RANDOM_AI);
+		for (size_t i = 0; i < tiles.size(); ++i) {
+			const Point& tile = tiles[(first + i) % tiles.size()];
+			FPoint waypoint(static_cast<float>(tile.x) + 0.5f, static_cast<float>(tile.y) + 0.5f);
+
+			if (mapr->collider.is_valid_position(waypoint.x, waypoint.y, e->stats.movement_type, e->stats.hero))
+				return waypoint;
+		}
 	}
+
+	// the whole area is blocked, so keep our current position
+	return e->stats.pos;
 }
@@ -25,10 +25,20 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 class Enemy;
 class Point;
 
+// how much work the AI of a creature gets, depending on how far away it is
+const int AI_DETAIL_FULL = 0;
+const int AI_DETAIL_THROTTLED = 1;
+const int AI_DETAIL_SLEEP = 2;
+
+// a path is kept while the target is within this many collision tiles of where the path was asked for
+const float PATH_REUSE_DISTANCE = 2.f;
+
 class BehaviorStandard : public EnemyBehavior {
 private:
 
 	// logic steps
+	int getDetailLevel();
+	void coast();
 	void doUpkeep();
 	virtual void findTarget();
 	void checkPower();
@@ -41,7 +51,7 @@ private:
 protected:
 	//variables for patfinding
 	std::vector<FPoint> path;
-	FPoint prev_target;
+	FPoint path_target; // pursue_pos when the path was asked for
 	bool collided;
 	bool path_found;
 	int chance_calc_path;
@@ -57,8 +67,26 @@ protected:
 	int flee_ticks;
 	int flee_cooldown;
 
+	// results of EntityGrid queries
+	std::vector<Entity*> nearby;
+
+	// found by decide() at the start of the frame, for findTarget()
+	// decided_ally is only set if the nearest ally was looked for, and decided_los if the line of sight was cached
+	bool decided;
+	float decided_hero_dist;
+	bool decided_ally_known;
+	Entity *decided_ally;
+	bool decided_los_known;
+	bool decided_los;
+	std::vector<std::pair<float, Entity*> > nearest_buf;
+
+	// counts frames for throttled decisions; starts at a different value for each creature to spread the work
+	unsigned lod_ticks;
+
 public:
 	explicit BehaviorStandard(Enemy *_e);
+	~BehaviorStandard();
+	virtual void decide();
 	void logic();
 
 };
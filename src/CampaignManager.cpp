@@ -26,6 +26,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "CampaignManager.h"
 #include "CommonIncludes.h"
+#include "EventManager.h"
 #include "Menu.h"
 #include "MenuManager.h"
 #include "MenuInventory.h"
@@ -36,7 +37,10 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsParsing.h"
 
 CampaignManager::CampaignManager()
-	: status()
+	: status_flags()
+	, status_revision(1)
+	, status_changes()
+	, status()
 	, bonus_xp(0.0) {
 }
 
@@ -59,7 +63,7 @@ std::string CampaignManager::getAll() {
 	std::stringstream ss;
 	ss.str("");
 	for (unsigned int i=0; i < status.size(); i++) {
-		ss << status[i];
+		ss << getInternedString(status[i]);
 		if (i < status.size()-1) ss << ',';
 	}
 	return ss.str();
@@ -70,10 +74,12 @@ bool CampaignManager::checkStatus(const std::string& s) {
 	// avoid searching empty statuses
 	if (s == "") return false;
 
-	for (unsigned int i=0; i < status.size(); i++) {
-		if (status[i] == s) return true;
-	}
-	return false;
+	return checkStatus(internString(s));
+}
+
+bool CampaignManager::checkStatus(StringHandle s) {
+	// handle 0 is the empty string, which is never set
+	return s < status_flags.size() && status_flags[s];
 }
 
 void CampaignManager::setStatus(const std::string& s) {
@@ -81,10 +87,24 @@ void CampaignManager::setStatus(const std::string& s) {
 	// avoid adding empty statuses
 	if (s == "") return;
 
+	setStatus(internString(s));
+}
+
+void CampaignManager::setStatus(StringHandle s) {
+
+	// avoid adding empty statuses
+	if (s == 0) return;
+
 	// if it's already set, don't add it again
 	if (checkStatus(s)) return;
 
+	if (s >= status_flags.size())
+		status_flags.resize(s + 1, false);
+
+	status_flags[s] = true;
 	status.push_back(s);
+	status_revision++;
+	status_changes.push_back(s);
 	pc->stats.check_title = true;
 }
 
@@ -93,16 +113,34 @@ void CampaignManager::unsetStatus(const std::string& s) {
 	// avoid searching empty statuses
 	if (s == "") return;
 
-	std::vector<std::string>::iterator it;
+	unsetStatus(internString(s));
+}
+
+void CampaignManager::unsetStatus(StringHandle s) {
+
+	if (!checkStatus(s)) return;
+
+	status_flags[s] = false;
+	status_revision++;
+	status_changes.push_back(s);
+
+	std::vector<StringHandle>::iterator it;
 	// see http://stackoverflow.com/a/223405
 	for (it = status.end(); it != status.begin();) {
 		--it;
 		if ((*it) == s) {
 			it = status.erase(it);
-			return;
+			break;
 		}
-		pc->stats.check_title = true;
 	}
+	pc->stats.check_title = true;
+}
+
+void CampaignManager::clearStatus() {
+	status_changes.insert(status_changes.end(), status.begin(), status.end());
+	status.clear();
+	status_flags.clear();
+	status_revision++;
 }
 
 bool CampaignManager::checkCurrency(int quantity) {
@@ -226,11 +264,11 @@ bool CampaignManager::checkAllRequirements(const Event_Component& ec) {
 			return true;
 	}
 	else if (ec.type == EC_REQUIRES_CLASS) {
-		if (pc->stats.character_class == ec.s)
+		if (pc->stats.character_class == ec.getString())
 			return true;
 	}
 	else if (ec.type == EC_REQUIRES_NOT_CLASS) {
-		if (pc->stats.character_class != ec.s)
+		if (pc->stats.character_class != ec.getString())
 			return true;
 	}
 	else {
@@ -243,5 +281,105 @@ bool CampaignManager::checkAllRequirements(const Event_Component& ec) {
 	return false;
 }
 
+/**
+ * Moves the list of statuses that were set or unset since the last call into changes
+ * Used by QuestLog to only re-check the quests that depend on them
+ */
+unsigned CampaignManager::getStatusRevision() const {
+	return status_revision;
+}
+
+void CampaignManager::takeStatusChanges(std::vector<StringHandle>& changes) {
+	changes.clear();
+	changes.swap(status_changes);
+}
+
+/**
+ * Splits the requirement components into status checks, whose result is cached, and the rest
+ */
+void CampaignManager::compileRequirements(const std::vector<Event_Component>& components, Event_Requirements& req) {
+	req.status_checks.clear();
+	req.other_checks.clear();
+
+	for (size_t i = 0; i < components.size(); ++i) {
+		const Event_Component &ec = components[i];
+		Event_Requirement r;
+		r.type = ec.type;
+		r.x = ec.x;
+
+		if (ec.type == EC_REQUIRES_STATUS || ec.type == EC_REQUIRES_NOT_STATUS) {
+			r.s = ec.s;
+			req.status_checks.push_back(r);
+		}
+		else if (ec.type == EC_REQUIRES_CLASS || ec.type == EC_REQUIRES_NOT_CLASS) {
+			r.s = ec.s;
+			req.other_checks.push_back(r);
+		}
+		else if (ec.type == EC_REQUIRES_CURRENCY || ec.type == EC_REQUIRES_NOT_CURRENCY ||
+		         ec.type == EC_REQUIRES_ITEM || ec.type == EC_REQUIRES_NOT_ITEM ||
+		         ec.type == EC_REQUIRES_LEVEL || ec.type == EC_REQUIRES_NOT_LEVEL) {
+			req.other_checks.push_back(r);
+		}
+	}
+
+	req.component_count = components.size();
+	req.compiled = true;
+	req.status_revision = 0;
+}
+
+bool CampaignManager::checkRequirement(const Event_Requirement& r) {
+	switch (r.type) {
+		case EC_REQUIRES_CURRENCY:
+			return checkCurrency(r.x);
+		case EC_REQUIRES_NOT_CURRENCY:
+			return !checkCurrency(r.x);
+		case EC_REQUIRES_ITEM:
+			return checkItem(r.x);
+		case EC_REQUIRES_NOT_ITEM:
+			return !checkItem(r.x);
+		case EC_REQUIRES_LEVEL:
+			return pc->stats.level >= r.x;
+		case EC_REQUIRES_NOT_LEVEL:
+			return pc->stats.level < r.x;
+		case EC_REQUIRES_CLASS:
+			return pc->stats.character_class == getInternedString(r.s);
+		case EC_REQUIRES_NOT_CLASS:
+			return pc->stats.character_class != getInternedString(r.s);
+		default:
+			return true;
+	}
+}
+
+/**
+ * Same as calling checkAllRequirements() on each component, but the requirements are compiled
+ * into req the first time, and status checks are only re-evaluated after a status changed
+ */
+bool CampaignManager::checkRequirements(const std::vector<Event_Component>& components, Event_Requirements& req) {
+	if (!req.compiled || req.component_count != components.size())
+		compileRequirements(components, req);
+
+	if (req.status_revision != status_revision) {
+		req.status_met = true;
+		for (size_t i = 0; i < req.status_checks.size(); ++i) {
+			const Event_Requirement &r = req.status_checks[i];
+			if (checkStatus(r.s) != (r.type == EC_REQUIRES_STATUS)) {
+				req.status_met = false;
+				break;
+			}
+		}
+		req.status_revision = status_revision;
+	}
+
+	if (!req.status_met)
+		return false;
+
+	for (size_t i = 0; i < req.other_checks.size(); ++i) {
+		if (!checkRequirement(req.other_checks[i]))
+			return false;
+	}
+
+	return true;
+}
+
 CampaignManager::~CampaignManager() {
 }
@@ -29,9 +29,23 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "CommonIncludes.h"
 #include "ItemManager.h"
 
+class Event_Requirement;
+class Event_Requirements;
 class StatBlock;
 
 class CampaignManager {
+private:
+	bool checkRequirement(const Event_Requirement& r);
+
+	// indexed by interned status string, true if that status is set
+	std::vector<bool> status_flags;
+
+	// incremented whenever a status is set or unset
+	unsigned status_revision;
+
+	// statuses set or unset since the last call to takeStatusChanges()
+	std::vector<StringHandle> status_changes;
+
 public:
 	CampaignManager();
 	~CampaignManager();
@@ -39,8 +53,12 @@ public:
 	void setAll(const std::string& s);
 	std::string getAll();
 	bool checkStatus(const std::string& s);
+	bool checkStatus(StringHandle s);
 	void setStatus(const std::string& s);
+	void setStatus(StringHandle s);
 	void unsetStatus(const std::string& s);
+	void unsetStatus(StringHandle s);
+	void clearStatus();
 	bool checkCurrency(int quantity);
 	bool checkItem(int item_id);
 	void removeCurrency(int quantity);
@@ -50,8 +68,15 @@ public:
 	void rewardXP(int amount, bool show_message);
 	void restoreHPMP(const std::string& s);
 	bool checkAllRequirements(const Event_Component& ec);
+	bool checkRequirements(const std::vector<Event_Component>& components, Event_Requirements& req);
+	void compileRequirements(const std::vector<Event_Component>& components, Event_Requirements& req);
+	void takeStatusChanges(std::vector<StringHandle>& changes);
+
+	// changes whenever a status is set or unset
+	unsigned getStatusRevision() const;
 
-	std::vector<std::string> status;
+	// statuses in the order they were set, as written to the save file
+	std::vector<StringHandle> status;
 	std::queue<ItemStack> drop_stack;
 
 	float bonus_xp;		// Fractional XP points not yet awarded (e.g. killing 1 XP enemies with a +25% ring)
@@ -32,26 +32,42 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Settings.h"
 #include "SharedResources.h"
 #include "UtilsParsing.h"
+#include "VisualQuality.h"
+
+#include <cstring>
+#include <stdio.h>
+
+static const char COMBAT_TEXT_GLYPH_CHARS[COMBAT_TEXT_GLYPHS + 1] = "0123456789-";
 
 Combat_Text_Item::Combat_Text_Item()
 	: label(NULL)
 	, lifespan(0)
 	, pos(FPoint())
+	, scr_pos(Point())
 	, floating_offset(0)
 	, text("")
 	, displaytype(0)
+	, is_number(false)
+	, number_width(0)
 {}
 
 Combat_Text_Item::~Combat_Text_Item() {
 }
 
-CombatText::CombatText() {
+CombatText::CombatText()
+	: combat_text(COMBAT_TEXT_MAX)
+	, first(0)
+	, count(0)
+	, glyphs_created(false) {
 	msg_color[COMBAT_MESSAGE_GIVEDMG] = font->getColor("combat_givedmg");
 	msg_color[COMBAT_MESSAGE_TAKEDMG] = font->getColor("combat_takedmg");
 	msg_color[COMBAT_MESSAGE_CRIT] = font->getColor("combat_crit");
 	msg_color[COMBAT_MESSAGE_BUFF] = font->getColor("combat_buff");
 	msg_color[COMBAT_MESSAGE_MISS] = font->getColor("combat_miss");
 
+	for (int i = 0; i < 5; ++i)
+		number_glyphs[i] = NULL;
+
 	duration = MAX_FRAMES_PER_SEC; // 1 second
 	speed = 60.f / MAX_FRAMES_PER_SEC;
 	offset = 48; // average height of flare-game enemies, so a sensible default
@@ -82,70 +98,186 @@ CombatText::CombatText() {
 }
 
 CombatText::~CombatText() {
-	// delete all messages
-	while (combat_text.size() > 0) {
-		delete combat_text.begin()->label;
-		combat_text.erase(combat_text.begin());
+	clearGlyphCache();
+}
+
+/**
+ * Takes the next item of the ring buffer, replacing the oldest one if it is full
+ */
+Combat_Text_Item& CombatText::addItem(const FPoint& location, int displaytype) {
+	if (count == COMBAT_TEXT_MAX) {
+		first = (first + 1) % COMBAT_TEXT_MAX;
+		count--;
 	}
+
+	Combat_Text_Item& c = combat_text[(first + count) % COMBAT_TEXT_MAX];
+	count++;
+
+	c.pos = location;
+	c.floating_offset = static_cast<float>(offset);
+	c.scr_pos = map_to_screen(location.x, location.y, cam.x, cam.y);
+	c.scr_pos.y -= offset;
+	c.lifespan = duration;
+	c.displaytype = displaytype;
+
+	return c;
 }
 
+/**
+ * Labels are only re-rendered when their text or color differs from the last use of the item
+ */
 void CombatText::addString(const std::string& message, const FPoint& location, int displaytype) {
 	if (COMBAT_TEXT) {
-		Combat_Text_Item *c = new Combat_Text_Item();
-		WidgetLabel *label = new WidgetLabel();
-		c->pos.x = location.x;
-		c->pos.y = location.y;
-		c->floating_offset = static_cast<float>(offset);
-		c->label = label;
-		c->text = message;
-		c->lifespan = duration;
-		c->displaytype = displaytype;
-
-		c->label->set(static_cast<int>(c->pos.x), static_cast<int>(c->pos.y), JUSTIFY_CENTER, VALIGN_BOTTOM, c->text, msg_color[c->displaytype]);
-		combat_text.push_back(*c);
-		delete c;
+		Combat_Text_Item& c = addItem(location, displaytype);
+		c.is_number = false;
+		c.text = message;
+
+		if (!c.label)
+			c.label = new WidgetLabel();
+		c.label->set(static_cast<int>(c.pos.x), static_cast<int>(c.pos.y), JUSTIFY_CENTER, VALIGN_BOTTOM, c.text, msg_color[c.displaytype]);
 	}
 }
 
 void CombatText::addInt(int num, const FPoint& location, int displaytype) {
 	if (COMBAT_TEXT) {
-		std::stringstream ss;
-		ss << num;
-		addString(ss.str(), location, displaytype);
+		char buf[16];
+		snprintf(buf, sizeof(buf), "%d", num);
+
+		Combat_Text_Item& c = addItem(location, displaytype);
+		c.is_number = true;
+		c.text = buf;
+
+		c.number_width = 0;
+		for (size_t i = 0; i < c.text.length(); ++i) {
+			const char *glyph = strchr(COMBAT_TEXT_GLYPH_CHARS, c.text[i]);
+			if (glyph)
+				c.number_width += glyph_bounds[glyph - COMBAT_TEXT_GLYPH_CHARS].w;
+		}
+	}
+}
+
+/**
+ * The number glyphs are rendered in one row for each display type, and numbers are
+ * drawn from parts of it. Needs the render device, so it is done on first use.
+ */
+void CombatText::createNumberGlyphs() {
+	glyphs_created = true;
+
+	font->setFont("font_regular");
+	const std::string chars = COMBAT_TEXT_GLYPH_CHARS;
+	const int height = font->getFontHeight();
+
+	int x = 0;
+	for (int i = 0; i < COMBAT_TEXT_GLYPHS; ++i) {
+		int next_x = font->calc_width(chars.substr(0, i + 1));
+		glyph_bounds[i].x = x;
+		glyph_bounds[i].y = 0;
+		glyph_bounds[i].w = next_x - x;
+		glyph_bounds[i].h = height;
+		x = next_x;
+	}
+
+	for (int i = 0; i < 5; ++i) {
+		Image *image = render_device->createImage(x, height);
+		if (!image)
+			continue;
+
+		font->renderShadowed(chars, 0, 0, JUSTIFY_LEFT, image, 0, msg_color[i]);
+		number_glyphs[i] = image->createSprite();
+		image->unref();
+	}
+}
+
+void CombatText::renderNumber(const Combat_Text_Item& item) {
+	Sprite *glyphs = number_glyphs[item.displaytype];
+	if (!glyphs)
+		return;
+
+	// same placement as a label with JUSTIFY_CENTER and VALIGN_BOTTOM
+	int x = item.scr_pos.x - item.number_width / 2;
+	const int y = item.scr_pos.y - glyph_bounds[0].h;
+
+	for (size_t i = 0; i < item.text.length(); ++i) {
+		const char *glyph = strchr(COMBAT_TEXT_GLYPH_CHARS, item.text[i]);
+		if (!glyph)
+			continue;
+
+		const Rect& bounds = glyph_bounds[glyph - COMBAT_TEXT_GLYPH_CHARS];
+		glyphs->setClip(bounds);
+		glyphs->setDest(x, y);
+		render_device->render(glyphs);
+		x += bounds.w;
 	}
 }
 
 void CombatText::logic(const FPoint& _cam) {
 	cam = _cam;
 
-	for(std::vector<Combat_Text_Item>::iterator it = combat_text.begin(); it != combat_text.end(); ++it) {
-		it->lifespan--;
-		it->floating_offset += speed;
+	ScreenTransform view;
+	view.setCamera(cam);
+
+	for (size_t i = 0; i < count; ++i) {
+		Combat_Text_Item& c = combat_text[(first + i) % COMBAT_TEXT_MAX];
+		c.lifespan--;
+		c.floating_offset += speed;
 
-		Point scr_pos;
-		scr_pos = map_to_screen(it->pos.x, it->pos.y, cam.x, cam.y);
-		scr_pos.y -= static_cast<int>(it->floating_offset);
+		c.scr_pos = view.mapToScreen(c.pos.x, c.pos.y);
+		c.scr_pos.y -= static_cast<int>(c.floating_offset);
 
-		it->label->setX(scr_pos.x);
-		it->label->setY(scr_pos.y);
+		if (!c.is_number) {
+			c.label->setX(c.scr_pos.x);
+			c.label->setY(c.scr_pos.y);
+		}
 	}
 
-	// delete expired messages
-	while (combat_text.size() && combat_text.begin()->lifespan <= 0) {
-		delete combat_text.begin()->label;
-		combat_text.erase(combat_text.begin());
+	// drop expired messages
+	while (count > 0 && combat_text[first].lifespan <= 0) {
+		first = (first + 1) % COMBAT_TEXT_MAX;
+		count--;
 	}
 }
 
 void CombatText::render() {
 	if (!SHOW_HUD) return;
 
-	for(std::vector<Combat_Text_Item>::iterator it = combat_text.begin(); it != combat_text.end(); ++it) {
-		if (it->lifespan > 0)
-			it->label->render();
+	if (count > 0 && !glyphs_created)
+		createNumberGlyphs();
+
+	// under load, only the newest items are drawn
+	size_t shown = count;
+	if (getVisualQuality() == VISUAL_QUALITY_REDUCED)
+		shown = std::min<size_t>(count, COMBAT_TEXT_REDUCED_MAX);
+	else if (getVisualQuality() == VISUAL_QUALITY_LOW)
+		shown = std::min<size_t>(count, COMBAT_TEXT_LOW_MAX);
+
+	for (size_t i = count - shown; i < count; ++i) {
+		const Combat_Text_Item& c = combat_text[(first + i) % COMBAT_TEXT_MAX];
+		if (c.lifespan <= 0)
+			continue;
+
+		if (c.is_number)
+			renderNumber(c);
+		else
+			c.label->render();
 	}
 }
 
 void CombatText::clear() {
-	combat_text.clear();
+	first = 0;
+	count = 0;
+}
+
+void CombatText::clearGlyphCache() {
+	clear();
+
+	for (size_t i = 0; i < combat_text.size(); ++i) {
+		delete combat_text[i].label;
+		combat_text[i].label = NULL;
+	}
+
+	for (int i = 0; i < 5; ++i) {
+		delete number_glyphs[i];
+		number_glyphs[i] = NULL;
+	}
+	glyphs_created = false;
 }
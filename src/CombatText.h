@@ -38,6 +38,13 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #define COMBAT_MESSAGE_MISS 3
 #define COMBAT_MESSAGE_BUFF 4
 
+// the most combat text items shown at once; when there are more, the oldest one is replaced
+const size_t COMBAT_TEXT_MAX = 128;
+
+// the characters that numbers are drawn with
+const int COMBAT_TEXT_GLYPHS = 11;
+
+class Sprite;
 class WidgetLabel;
 
 class Combat_Text_Item {
@@ -45,17 +52,21 @@ public:
 	Combat_Text_Item();
 	~Combat_Text_Item();
 
-	WidgetLabel *label;
+	WidgetLabel *label; // only used by text items; kept when the item is reused
 	int lifespan;
 	FPoint pos;
+	Point scr_pos;
 	float floating_offset;
 	std::string text;
 	int displaytype;
+	bool is_number; // drawn from the number glyphs instead of the label
+	int number_width;
 };
 
 class CombatText {
 public:
 	CombatText();
+	CombatText(const CombatText&); // not implemented
 	~CombatText();
 
 	void logic(const FPoint& _cam);
@@ -64,9 +75,25 @@ public:
 	void addInt(int num, const FPoint& location, int displaytype);
 	void clear();
 
+	// frees the rendered text; must be called before the render context is recreated
+	void clearGlyphCache();
+
 private:
+	Combat_Text_Item& addItem(const FPoint& location, int displaytype);
+	void createNumberGlyphs();
+	void renderNumber(const Combat_Text_Item& item);
+
 	FPoint cam;
+
+	// ring buffer of COMBAT_TEXT_MAX items. All items have the same lifespan, so they expire in order
 	std::vector<Combat_Text_Item> combat_text;
+	size_t first;
+	size_t count;
+
+	// the glyphs of every number, pre-rendered once for each display type
+	Sprite *number_glyphs[5];
+	Rect glyph_bounds[COMBAT_TEXT_GLYPHS];
+	bool glyphs_created;
 
 	Color msg_color[5];
 	int duration;
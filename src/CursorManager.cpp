@@ -18,6 +18,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "CursorManager.h"
 #include "FileParser.h"
+#include "Platform.h"
 #include "Settings.h"
 #include "SharedResources.h"
 #include "UtilsParsing.h"
@@ -28,48 +29,31 @@ CursorManager::CursorManager()
 	, cursor_interact(NULL)
 	, cursor_talk(NULL)
 	, cursor_attack(NULL)
-	, cursor_current(NULL)
-	, offset_current(NULL) {
-	Image *graphics;
+	, hardware_normal(-1)
+	, hardware_interact(-1)
+	, hardware_talk(-1)
+	, hardware_attack(-1)
+	, cursor_type(CURSOR_NORMAL)
+	, hardware_current(-1) {
 	FileParser infile;
 	// @CLASS CursorManager|Description of engine/mouse_cursor.txt
 	if (infile.open("engine/mouse_cursor.txt", true, "")) {
 		while (infile.next()) {
 			if (infile.key == "normal") {
-				// @ATTR normal|filename|Filename of an image for the normal cursor.
-				graphics = render_device->loadImage(popFirstString(infile.val));
-				if (graphics) {
-					cursor_normal = graphics->createSprite();
-					graphics->unref();
-				}
-				offset_normal = toPoint(infile.val);
+				// @ATTR normal|filename, point : Image file, Offset|Filename of an image for the normal cursor.
+				loadCursor(infile.val, cursor_normal, offset_normal, hardware_normal);
 			}
 			else if (infile.key == "interact") {
-				// @ATTR interact|filename|Filename of an image for the object interaction cursor.
-				graphics = render_device->loadImage(popFirstString(infile.val));
-				if (graphics) {
-					cursor_interact = graphics->createSprite();
-					graphics->unref();
-				}
-				offset_interact = toPoint(infile.val);
+				// @ATTR interact|filename, point : Image file, Offset|Filename of an image for the object interaction cursor.
+				loadCursor(infile.val, cursor_interact, offset_interact, hardware_interact);
 			}
 			else if (infile.key == "talk") {
-				// @ATTR talk|filename|Filename of an image for the NPC interaction cursor.
-				graphics = render_device->loadImage(popFirstString(infile.val));
-				if (graphics) {
-					cursor_talk = graphics->createSprite();
-					graphics->unref();
-				}
-				offset_talk = toPoint(infile.val);
+				// @ATTR talk|filename, point : Image file, Offset|Filename of an image for the NPC interaction cursor.
+				loadCursor(infile.val, cursor_talk, offset_talk, hardware_talk);
 			}
 			else if (infile.key == "attack") {
-				// @ATTR attack|filename|Filename of an image for the cursor when attacking enemies.
-				graphics = render_device->loadImage(popFirstString(infile.val));
-				if (graphics) {
-					cursor_attack = graphics->createSprite();
-					graphics->unref();
-				}
-				offset_attack = toPoint(infile.val);
+				// @ATTR attack|filename, point : Image file, Offset|Filename of an image for the cursor when attacking enemies.
+				loadCursor(infile.val, cursor_attack, offset_attack, hardware_attack);
 			}
 			else {
 				infile.error("CursorManager: '%s' is not a valid key.", infile.key.c_str());
@@ -86,70 +70,88 @@ CursorManager::~CursorManager() {
 	if (cursor_attack) delete cursor_attack;
 }
 
-void CursorManager::logic() {
-	if (!show_cursor)
-		return;
-
-	if (HARDWARE_CURSOR) {
-		inpt->showCursor();
-		return;
+/**
+ * Loads a cursor image as a sprite, and as an OS cursor so that it can follow the mouse
+ * without waiting for the next frame. The sprite is still used if the OS cursor can't be made.
+ */
+void CursorManager::loadCursor(std::string val, Sprite*& sprite, Point& offset, int& hardware_cursor) {
+	std::string filename = popFirstString(val);
+	offset = toPoint(val);
+
+	Image *graphics = render_device->loadImage(filename);
+	if (graphics) {
+		sprite = graphics->createSprite();
+		graphics->unref();
 	}
 
-	cursor_current = NULL;
-	offset_current = NULL;
-
-	if (cursor_normal) {
-		inpt->hideCursor();
-		cursor_current = cursor_normal;
-		offset_current = &offset_normal;
-	}
-	else {
-		// system cursor
-		inpt->showCursor();
+	// touch screens don't show a pointer, so they keep using the system cursor as before
+	if (sprite && !PlatformOptions.is_mobile_device) {
+		// the sprite is drawn at the mouse position plus the offset, so the hotspot is the opposite
+		hardware_cursor = inpt->createHardwareCursor(filename, Point(-offset.x, -offset.y));
 	}
 }
 
-void CursorManager::render() {
-	if (HARDWARE_CURSOR || !show_cursor) return;
-
-	if (cursor_current != NULL) {
-		if (offset_current != NULL) {
-			cursor_current->setDest(inpt->mouse.x+offset_current->x, inpt->mouse.y+offset_current->y);
-		}
-		else {
-			cursor_current->setDest(inpt->mouse.x, inpt->mouse.y);
-		}
+void CursorManager::logic() {
+	if (!show_cursor)
+		return;
 
-		render_device->render(cursor_current);
-	}
+	cursor_type = CURSOR_NORMAL;
 }
 
-void CursorManager::setCursor(CURSOR_TYPE type) {
-	if (HARDWARE_CURSOR) return;
+void CursorManager::render() {
+	if (!show_cursor)
+		return;
 
-	if (type == CURSOR_INTERACT && cursor_interact) {
-		inpt->hideCursor();
+	Sprite *cursor_current = cursor_normal;
+	Point *offset_current = &offset_normal;
+	int hardware = hardware_normal;
+
+	if (cursor_type == CURSOR_INTERACT && cursor_interact) {
 		cursor_current = cursor_interact;
 		offset_current = &offset_interact;
+		hardware = hardware_interact;
 	}
-	else if (type == CURSOR_TALK && cursor_talk) {
-		inpt->hideCursor();
+	else if (cursor_type == CURSOR_TALK && cursor_talk) {
 		cursor_current = cursor_talk;
 		offset_current = &offset_talk;
+		hardware = hardware_talk;
 	}
-	else if (type == CURSOR_ATTACK && cursor_attack) {
-		inpt->hideCursor();
+	else if (cursor_type == CURSOR_ATTACK && cursor_attack) {
 		cursor_current = cursor_attack;
 		offset_current = &offset_attack;
+		hardware = hardware_attack;
+	}
+
+	// the OS cursor is only switched once per frame, so setCursor() can be called freely during logic
+	if (HARDWARE_CURSOR && hardware != -1) {
+		if (hardware != hardware_current) {
+			inpt->setHardwareCursor(hardware);
+			hardware_current = hardware;
+		}
+		inpt->showCursor();
+		return;
 	}
-	else if (cursor_normal) {
-		inpt->hideCursor();
-		cursor_current = cursor_normal;
-		offset_current = &offset_normal;
+
+	if (hardware_current != -1) {
+		inpt->setHardwareCursor(-1);
+		hardware_current = -1;
 	}
-	else {
+
+	if (HARDWARE_CURSOR || !cursor_current) {
 		// system cursor
-		cursor_current = NULL;
 		inpt->showCursor();
+		return;
 	}
+
+	inpt->hideCursor();
+
+	// sampled right before drawing, so the cursor doesn't lag behind by a logic frame
+	Point pos = inpt->getLatestMouse();
+	cursor_current->setDest(pos.x+offset_current->x, pos.y+offset_current->y);
+
+	render_device->render(cursor_current);
+}
+
+void CursorManager::setCursor(CURSOR_TYPE type) {
+	cursor_type = type;
 }
@@ -40,6 +40,8 @@ public:
 	bool show_cursor;
 
 private:
+	void loadCursor(std::string val, Sprite*& sprite, Point& offset, int& hardware_cursor);
+
 	Sprite *cursor_normal;
 	Sprite *cursor_interact;
 	Sprite *cursor_talk;
@@ -50,8 +52,14 @@ private:
 	Point offset_talk;
 	Point offset_attack;
 
-	Sprite *cursor_current;
-	Point* offset_current;
+	// the same images as OS cursors, -1 if they couldn't be created
+	int hardware_normal;
+	int hardware_interact;
+	int hardware_talk;
+	int hardware_attack;
+
+	CURSOR_TYPE cursor_type;
+	int hardware_current;
 };
 
 #endif
@@ -21,17 +21,24 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "DeviceList.h"
 
 #include "SDLSoftwareRenderDevice.h"
+#include "SDLFastSoftwareRenderDevice.h"
 #include "SDLHardwareRenderDevice.h"
+#include "NullRenderDevice.h"
 
 #include "SDLFontEngine.h"
 #include "SDLSoundManager.h"
 #include "SDLInputState.h"
 
+#include "NullFontEngine.h"
+#include "NullSoundManager.h"
+
 RenderDevice* getRenderDevice(const std::string& name) {
 	// "sdl" is the default
 	if (name != "") {
 		if (name == "sdl") return new SDLSoftwareRenderDevice();
 		else if (name == "sdl_hardware") return new SDLHardwareRenderDevice();
+		else if (name == "sdl_fast") return new SDLFastSoftwareRenderDevice();
+		else if (name == "null") return new NullRenderDevice();
 		else {
 			logError("DeviceList: Render device '%s' not found. Falling back to the default.", name.c_str());
 			return new SDLSoftwareRenderDevice();
@@ -42,11 +49,13 @@ RenderDevice* getRenderDevice(const std::string& name) {
 	}
 }
 
-FontEngine* getFontEngine() {
+FontEngine* getFontEngine(bool headless) {
+	if (headless) return new NullFontEngine();
 	return new SDLFontEngine();
 }
 
-SoundManager* getSoundManager() {
+SoundManager* getSoundManager(bool headless) {
+	if (headless) return new NullSoundManager();
 	return new SDLSoundManager();
 }
 
@@ -28,8 +28,9 @@ class InputState;
 
 RenderDevice* getRenderDevice(const std::string& name);
 
-FontEngine* getFontEngine();
-SoundManager* getSoundManager();
+// headless devices don't need a window or an audio device, and don't draw or play anything
+FontEngine* getFontEngine(bool headless = false);
+SoundManager* getSoundManager(bool headless = false);
 InputState* getInputManager();
 
 #endif
@@ -0,0 +1,84 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "DevicePower.h"
+#include "Platform.h"
+#include "Settings.h"
+#include "Utils.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+
+static bool polled = false;
+static Uint32 poll_ticks = 0;
+static int thermal_state = PLATFORM_THERMAL_NOMINAL;
+static bool power_saving = false;
+static bool on_battery = false;
+
+// the cap from the OS signals, kept to log when it changes
+static int power_cap = 0;
+
+static void pollPowerState() {
+	thermal_state = PlatformGetThermalState();
+
+	int percent = -1;
+	const SDL_PowerState state = SDL_GetPowerInfo(NULL, &percent);
+	on_battery = (state == SDL_POWERSTATE_ON_BATTERY);
+	power_saving = PlatformIsLowPowerMode() || (on_battery && percent >= 0 && percent < DEVICE_POWER_LOW_BATTERY_PERCENT);
+
+	int cap = 0;
+	if (thermal_state == PLATFORM_THERMAL_CRITICAL)
+		cap = DEVICE_POWER_THERMAL_CRITICAL_FPS;
+	else if (thermal_state == PLATFORM_THERMAL_SERIOUS)
+		cap = DEVICE_POWER_THERMAL_SERIOUS_FPS;
+	else if (thermal_state == PLATFORM_THERMAL_FAIR)
+		cap = DEVICE_POWER_THERMAL_FAIR_FPS;
+
+	if (power_saving && (cap == 0 || cap > DEVICE_POWER_SAVING_FPS))
+		cap = DEVICE_POWER_SAVING_FPS;
+
+	if (cap != power_cap) {
+		if (cap > 0)
+			logInfo("DevicePower: Drawing at most %d frames per second (thermal state %d, power saving %d).", cap, thermal_state, static_cast<int>(power_saving));
+		else
+			logInfo("DevicePower: Drawing at the full frame rate again.");
+		power_cap = cap;
+	}
+}
+
+int getDeviceRenderFPS(int render_fps, bool idle) {
+	const Uint32 now = SDL_GetTicks();
+	if (!polled || now - poll_ticks >= DEVICE_POWER_POLL_INTERVAL) {
+		pollPowerState();
+		poll_ticks = now;
+		polled = true;
+	}
+
+	int fps = render_fps;
+
+	if (BATTERY_SAVER_FPS > 0)
+		fps = std::min(fps, static_cast<int>(BATTERY_SAVER_FPS));
+
+	if (power_cap > 0)
+		fps = std::min(fps, power_cap);
+
+	if (idle && (PlatformOptions.is_mobile_device || on_battery))
+		fps = std::min(fps, DEVICE_POWER_IDLE_FPS);
+
+	return std::max(fps, 1);
+}
@@ -0,0 +1,51 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * Device power
+ *
+ * Phones slow themselves down hard once they get hot, so it is better to draw
+ * fewer frames before that happens. The frame rate is lowered in menus, dialogs
+ * and while paused on mobile devices and on battery, to the battery_saver_fps
+ * setting, and when the OS reports low power mode, a low battery or a hot device.
+ *
+ * Only the number of frames drawn changes. Logic still runs max_fps times per
+ * second, a few steps per drawn frame if needed.
+ */
+
+#ifndef DEVICE_POWER_H
+#define DEVICE_POWER_H
+
+// in menus, dialogs and while paused
+const int DEVICE_POWER_IDLE_FPS = 30;
+
+// in low power mode, or below DEVICE_POWER_LOW_BATTERY_PERCENT
+const int DEVICE_POWER_SAVING_FPS = 30;
+const int DEVICE_POWER_LOW_BATTERY_PERCENT = 20;
+
+// for each thermal state above PLATFORM_THERMAL_NOMINAL
+const int DEVICE_POWER_THERMAL_FAIR_FPS = 45;
+const int DEVICE_POWER_THERMAL_SERIOUS_FPS = 30;
+const int DEVICE_POWER_THERMAL_CRITICAL_FPS = 20;
+
+// how often the OS is asked about its power state, in milliseconds
+const unsigned DEVICE_POWER_POLL_INTERVAL = 5000;
+
+// returns how many frames to draw per second, given the number the settings ask for
+int getDeviceRenderFPS(int render_fps, bool idle);
+
+#endif // DEVICE_POWER_H
@@ -25,7 +25,10 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Settings.h"
 
 EffectManager::EffectManager()
-	: bonus(std::vector<int>(STAT_COUNT, 0))
+	: status_dirty(false)
+	, render_color_count(0)
+	, render_alpha_count(0)
+	, bonus(std::vector<int>(STAT_COUNT, 0))
 	, bonus_resist(std::vector<int>(ELEMENTS.size(), 0))
 	, bonus_primary(std::vector<int>(PRIMARY_STATS.size(), 0))
 	, triggered_others(false)
@@ -66,7 +69,11 @@ EffectManager& EffectManager::operator= (const EffectManager &emSource) {
 		effect_list[i].alpha_mod = emSource.effect_list[i].alpha_mod;
 		effect_list[i].attack_speed_anim = emSource.effect_list[i].attack_speed_anim;
 
-		if (emSource.effect_list[i].animation_name != "") {
+		if (emSource.effect_list[i].animation_set) {
+			effect_list[i].animation_set = emSource.effect_list[i].animation_set;
+			effect_list[i].animation = effect_list[i].animation_set->getAnimation(0);
+		}
+		else if (emSource.effect_list[i].animation_name != "") {
 			effect_list[i].animation_name = emSource.effect_list[i].animation_name;
 			anim->increaseCount(effect_list[i].animation_name);
 			effect_list[i].animation = loadAnimation(effect_list[i].animation_name);
@@ -111,6 +118,8 @@ EffectManager& EffectManager::operator= (const EffectManager &emSource) {
 	triggered_joincombat = emSource.triggered_joincombat;
 	triggered_death = emSource.triggered_death;
 	refresh_stats = emSource.refresh_stats;
+	status_dirty = true;
+	updateRenderMods();
 
 	return *this;
 }
@@ -152,11 +161,18 @@ void EffectManager::clearStatus() {
 }
 
 void EffectManager::logic() {
-	clearStatus();
+	// damage and healing over time only count for the frame their tick lands on
+	damage = 0;
+	damage_percent = 0;
+	hpot = 0;
+	hpot_percent = 0;
+	mpot = 0;
+	mpot_percent = 0;
+	death_sentence = false;
 
 	for (unsigned i=0; i<effect_list.size(); i++) {
 		// @CLASS EffectManager|Description of "type" in powers/effects.txt
-		// expire timed effects and total up magnitudes of active effects
+		// expire timed effects and total up magnitudes of effects that tick
 		if (effect_list[i].duration >= 0) {
 			if (effect_list[i].duration > 0) {
 				if (effect_list[i].ticks > 0) effect_list[i].ticks--;
@@ -170,73 +186,19 @@ void EffectManager::logic() {
 				}
 			}
 
-			// @TYPE damage|Damage per second
-			if (effect_list[i].type == EFFECT_DAMAGE && effect_list[i].ticks % MAX_FRAMES_PER_SEC == 1) damage += effect_list[i].magnitude;
-			// @TYPE damage_percent|Damage per second (percentage of max HP)
-			else if (effect_list[i].type == EFFECT_DAMAGE_PERCENT && effect_list[i].ticks % MAX_FRAMES_PER_SEC == 1) damage_percent += effect_list[i].magnitude;
-			// @TYPE hpot|HP restored per second
-			else if (effect_list[i].type == EFFECT_HPOT && effect_list[i].ticks % MAX_FRAMES_PER_SEC == 1) hpot += effect_list[i].magnitude;
-			// @TYPE hpot_percent|HP restored per second (percentage of max HP)
-			else if (effect_list[i].type == EFFECT_HPOT_PERCENT && effect_list[i].ticks % MAX_FRAMES_PER_SEC == 1) hpot_percent += effect_list[i].magnitude;
-			// @TYPE mpot|MP restored per second
-			else if (effect_list[i].type == EFFECT_MPOT && effect_list[i].ticks % MAX_FRAMES_PER_SEC == 1) mpot += effect_list[i].magnitude;
-			// @TYPE mpot_percent|MP restored per second (percentage of max MP)
-			else if (effect_list[i].type == EFFECT_MPOT_PERCENT && effect_list[i].ticks % MAX_FRAMES_PER_SEC == 1) mpot_percent += effect_list[i].magnitude;
-			// @TYPE speed|Changes movement speed. A magnitude of 100 is 100% speed (aka normal speed).
-			else if (effect_list[i].type == EFFECT_SPEED) speed = (static_cast<float>(effect_list[i].magnitude) * speed) / 100.f;
-			// @TYPE attack_speed|Changes attack speed. A magnitude of 100 is 100% speed (aka normal speed).
-			// attack speed is calculated when getAttackSpeed() is called
-
-			// @TYPE immunity|Applies all immunity effects. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY) {
-				immunity_damage = true;
-				immunity_slow = true;
-				immunity_stun = true;
-				immunity_hp_steal = true;
-				immunity_mp_steal = true;
-				immunity_knockback = true;
-				immunity_damage_reflect = true;
-				immunity_stat_debuff = true;
-			}
-			// @TYPE immunity_damage|Removes and prevents damage over time. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_DAMAGE) immunity_damage = true;
-			// @TYPE immunity_slow|Removes and prevents slow effects. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_SLOW) immunity_slow = true;
-			// @TYPE immunity_stun|Removes and prevents stun effects. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_STUN) immunity_stun = true;
-			// @TYPE immunity_hp_steal|Prevents HP stealing. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_HP_STEAL) immunity_hp_steal = true;
-			// @TYPE immunity_mp_steal|Prevents MP stealing. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_MP_STEAL) immunity_mp_steal = true;
-			// @TYPE immunity_knockback|Removes and prevents knockback effects. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_KNOCKBACK) immunity_knockback = true;
-			// @TYPE immunity_damage_reflect|Prevents damage reflection. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_DAMAGE_REFLECT) immunity_damage_reflect = true;
-			// @TYPE immunity_stat_debuff|Prevents stat value altering effects that have a magnitude less than 0. Magnitude is ignored.
-			else if (effect_list[i].type == EFFECT_IMMUNITY_STAT_DEBUFF) immunity_stat_debuff = true;
-
-			// @TYPE stun|Can't move or attack. Being attacked breaks stun.
-			else if (effect_list[i].type == EFFECT_STUN) stun = true;
-			// @TYPE revive|Revives the player. Typically attached to a power that triggers when the player dies.
-			else if (effect_list[i].type == EFFECT_REVIVE) revive = true;
-			// @TYPE convert|Causes an enemy or an ally to switch allegiance
-			else if (effect_list[i].type == EFFECT_CONVERT) convert = true;
-			// @TYPE fear|Causes enemies to run away
-			else if (effect_list[i].type == EFFECT_FEAR) fear = true;
-			// @TYPE knockback|Pushes the target away from the source caster. Speed is the given value divided by the framerate cap.
-			else if (effect_list[i].type == EFFECT_KNOCKBACK) knockback_speed = static_cast<float>(effect_list[i].magnitude)/static_cast<float>(MAX_FRAMES_PER_SEC);
-
-			// @TYPE ${STATNAME}|Increases ${STATNAME}, where ${STATNAME} is any of the base stats. Examples: hp, dmg_melee_min, xp_gain
-			else if (effect_list[i].type >= EFFECT_COUNT && effect_list[i].type < EFFECT_COUNT+STAT_COUNT) {
-				bonus[effect_list[i].type - EFFECT_COUNT] += effect_list[i].magnitude;
-			}
-			// @TYPE ${ELEMENT}_resist|Increase Resistance % to ${ELEMENT}, where ${ELEMENT} is any found in engine/elements.txt. Example: fire_resist
-			else if (effect_list[i].type >= EFFECT_COUNT + STAT_COUNT && effect_list[i].type < EFFECT_COUNT+STAT_COUNT+static_cast<int>(ELEMENTS.size())) {
-				bonus_resist[effect_list[i].type - EFFECT_COUNT - STAT_COUNT] += effect_list[i].magnitude;
-			}
-			// @TYPE ${PRIMARYSTAT}|Increases ${PRIMARYSTAT}, where ${PRIMARYSTAT} is any of the primary stats defined in engine/primary_stats.txt. Example: physical
-			else if (effect_list[i].type >= EFFECT_COUNT) {
-				bonus_primary[effect_list[i].type - EFFECT_COUNT - STAT_COUNT - ELEMENTS.size()] += effect_list[i].magnitude;
+			if (effect_list[i].type >= EFFECT_DAMAGE && effect_list[i].type <= EFFECT_MPOT_PERCENT && effect_list[i].ticks % MAX_FRAMES_PER_SEC == 1) {
+				// @TYPE damage|Damage per second
+				if (effect_list[i].type == EFFECT_DAMAGE) damage += effect_list[i].magnitude;
+				// @TYPE damage_percent|Damage per second (percentage of max HP)
+				else if (effect_list[i].type == EFFECT_DAMAGE_PERCENT) damage_percent += effect_list[i].magnitude;
+				// @TYPE hpot|HP restored per second
+				else if (effect_list[i].type == EFFECT_HPOT) hpot += effect_list[i].magnitude;
+				// @TYPE hpot_percent|HP restored per second (percentage of max HP)
+				else if (effect_list[i].type == EFFECT_HPOT_PERCENT) hpot_percent += effect_list[i].magnitude;
+				// @TYPE mpot|MP restored per second
+				else if (effect_list[i].type == EFFECT_MPOT) mpot += effect_list[i].magnitude;
+				// @TYPE mpot_percent|MP restored per second (percentage of max MP)
+				else if (effect_list[i].type == EFFECT_MPOT_PERCENT) mpot_percent += effect_list[i].magnitude;
 			}
 		}
 		// expire shield effects
@@ -264,10 +226,113 @@ void EffectManager::logic() {
 				effect_list[i].animation->advanceFrame();
 		}
 	}
+
+	if (status_dirty)
+		calcStatus();
+}
+
+/**
+ * Totals up the effects that apply for as long as they last. These only change when
+ * an effect is added or removed, so most frames skip this.
+ */
+void EffectManager::calcStatus() {
+	status_dirty = false;
+
+	speed = 100;
+	immunity_damage = false;
+	immunity_slow = false;
+	immunity_stun = false;
+	immunity_hp_steal = false;
+	immunity_mp_steal = false;
+	immunity_knockback = false;
+	immunity_damage_reflect = false;
+	immunity_stat_debuff = false;
+	stun = false;
+	revive = false;
+	convert = false;
+	fear = false;
+	knockback_speed = 0;
+
+	for (unsigned i=0; i<STAT_COUNT; i++) {
+		bonus[i] = 0;
+	}
+
+	for (unsigned i=0; i<bonus_resist.size(); i++) {
+		bonus_resist[i] = 0;
+	}
+
+	for (unsigned i=0; i<bonus_primary.size(); i++) {
+		bonus_primary[i] = 0;
+	}
+
+	for (unsigned i=0; i<effect_list.size(); i++) {
+		if (effect_list[i].duration < 0)
+			continue;
+
+		// @TYPE speed|Changes movement speed. A magnitude of 100 is 100% speed (aka normal speed).
+		if (effect_list[i].type == EFFECT_SPEED) speed = (static_cast<float>(effect_list[i].magnitude) * speed) / 100.f;
+		// @TYPE attack_speed|Changes attack speed. A magnitude of 100 is 100% speed (aka normal speed).
+		// attack speed is calculated when getAttackSpeed() is called
+
+		// @TYPE immunity|Applies all immunity effects. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY) {
+			immunity_damage = true;
+			immunity_slow = true;
+			immunity_stun = true;
+			immunity_hp_steal = true;
+			immunity_mp_steal = true;
+			immunity_knockback = true;
+			immunity_damage_reflect = true;
+			immunity_stat_debuff = true;
+		}
+		// @TYPE immunity_damage|Removes and prevents damage over time. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_DAMAGE) immunity_damage = true;
+		// @TYPE immunity_slow|Removes and prevents slow effects. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_SLOW) immunity_slow = true;
+		// @TYPE immunity_stun|Removes and prevents stun effects. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_STUN) immunity_stun = true;
+		// @TYPE immunity_hp_steal|Prevents HP stealing. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_HP_STEAL) immunity_hp_steal = true;
+		// @TYPE immunity_mp_steal|Prevents MP stealing. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_MP_STEAL) immunity_mp_steal = true;
+		// @TYPE immunity_knockback|Removes and prevents knockback effects. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_KNOCKBACK) immunity_knockback = true;
+		// @TYPE immunity_damage_reflect|Prevents damage reflection. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_DAMAGE_REFLECT) immunity_damage_reflect = true;
+		// @TYPE immunity_stat_debuff|Prevents stat value altering effects that have a magnitude less than 0. Magnitude is ignored.
+		else if (effect_list[i].type == EFFECT_IMMUNITY_STAT_DEBUFF) immunity_stat_debuff = true;
+
+		// @TYPE stun|Can't move or attack. Being attacked breaks stun.
+		else if (effect_list[i].type == EFFECT_STUN) stun = true;
+		// @TYPE revive|Revives the player. Typically attached to a power that triggers when the player dies.
+		else if (effect_list[i].type == EFFECT_REVIVE) revive = true;
+		// @TYPE convert|Causes an enemy or an ally to switch allegiance
+		else if (effect_list[i].type == EFFECT_CONVERT) convert = true;
+		// @TYPE fear|Causes enemies to run away
+		else if (effect_list[i].type == EFFECT_FEAR) fear = true;
+		// @TYPE knockback|Pushes the target away from the source caster. Speed is the given value divided by the framerate cap.
+		else if (effect_list[i].type == EFFECT_KNOCKBACK) knockback_speed = static_cast<float>(effect_list[i].magnitude)/static_cast<float>(MAX_FRAMES_PER_SEC);
+
+		// @TYPE ${STATNAME}|Increases ${STATNAME}, where ${STATNAME} is any of the base stats. Examples: hp, dmg_melee_min, xp_gain
+		else if (effect_list[i].type >= EFFECT_COUNT && effect_list[i].type < EFFECT_COUNT+STAT_COUNT) {
+			bonus[effect_list[i].type - EFFECT_COUNT] += effect_list[i].magnitude;
+		}
+		// @TYPE ${ELEMENT}_resist|Increase Resistance % to ${ELEMENT}, where ${ELEMENT} is any found in engine/elements.txt. Example: fire_resist
+		else if (effect_list[i].type >= EFFECT_COUNT + STAT_COUNT && effect_list[i].type < EFFECT_COUNT+STAT_COUNT+static_cast<int>(ELEMENTS.size())) {
+			bonus_resist[effect_list[i].type - EFFECT_COUNT - STAT_COUNT] += effect_list[i].magnitude;
+		}
+		// @TYPE ${PRIMARYSTAT}|Increases ${PRIMARYSTAT}, where ${PRIMARYSTAT} is any of the primary stats defined in engine/primary_stats.txt. Example: physical
+		else if (effect_list[i].type >= EFFECT_COUNT) {
+			bonus_primary[effect_list[i].type - EFFECT_COUNT - STAT_COUNT - ELEMENTS.size()] += effect_list[i].magnitude;
+		}
+	}
 }
 
 void EffectManager::addEffect(EffectDef &effect, int duration, int magnitude, bool item, int trigger, int passive_id, int source_type) {
-	int effect_type = getType(effect.type);
+	if (!effect.resolved)
+		resolveEffectDef(effect);
+
+	int effect_type = effect.effect_type;
 	refresh_stats = true;
 
 	// if we're already immune, don't add negative effects
@@ -294,9 +359,10 @@ void EffectManager::addEffect(EffectDef &effect, int duration, int magnitude, bo
 	bool insert_effect = false;
 	int stacks_applied = 0;
 	size_t insert_pos;
+	StringHandle effect_id = effect.id_handle;
 
 	for (size_t i=effect_list.size(); i>0; i--) {
-		if (effect_list[i-1].id == effect.id) {
+		if (effect_list[i-1].id == effect_id) {
 			if (trigger > -1 && effect_list[i-1].trigger == trigger)
 				return; // trigger effects can only be cast once per trigger
 
@@ -344,7 +410,7 @@ void EffectManager::addEffect(EffectDef &effect, int duration, int magnitude, bo
 
 	Effect e;
 
-	e.id = effect.id;
+	e.id = effect_id;
 	e.name = effect.name;
 	e.icon = effect.icon;
 	e.type = effect_type;
@@ -352,9 +418,13 @@ void EffectManager::addEffect(EffectDef &effect, int duration, int magnitude, bo
 	e.group_stack = effect.group_stack;
 	e.color_mod = effect.color_mod;
 	e.alpha_mod = effect.alpha_mod;
-	e.attack_speed_anim = effect.attack_speed_anim;
+	e.attack_speed_anim = effect.attack_speed_anim_handle;
 
-	if (effect.animation != "") {
+	if (effect.animation_set) {
+		e.animation_set = effect.animation_set;
+		e.animation = e.animation_set->getAnimation(0);
+	}
+	else if (effect.animation != "") {
 		anim->increaseCount(effect.animation);
 		e.animation = loadAnimation(effect.animation);
 		e.animation_name = effect.animation;
@@ -379,20 +449,27 @@ void EffectManager::addEffect(EffectDef &effect, int duration, int magnitude, bo
 		effect_list.insert(effect_list.begin() + insert_pos, e);
 	else
 		effect_list.push_back(e);
+
+	status_dirty = true;
+	updateRenderMods();
 }
 
 void EffectManager::removeEffect(size_t id) {
 	removeAnimation(id);
 	effect_list.erase(effect_list.begin()+id);
 	refresh_stats = true;
+	status_dirty = true;
+	updateRenderMods();
 }
 
 void EffectManager::removeAnimation(size_t id) {
-	if (effect_list[id].animation && effect_list[id].animation_name != "") {
-		anim->decreaseCount(effect_list[id].animation_name);
+	if (effect_list[id].animation) {
+		if (effect_list[id].animation_name != "")
+			anim->decreaseCount(effect_list[id].animation_name);
 		delete effect_list[id].animation;
 		effect_list[id].animation = NULL;
 		effect_list[id].animation_name = "";
+		effect_list[id].animation_set = NULL;
 	}
 }
 
@@ -408,7 +485,7 @@ void EffectManager::removeEffectPassive(int id) {
 	}
 }
 
-void EffectManager::removeEffectID(const std::vector< std::pair<std::string, int> >& remove_effects) {
+void EffectManager::removeEffectID(const std::vector< std::pair<StringHandle, int> >& remove_effects) {
 	for (size_t i = 0; i < remove_effects.size(); i++) {
 		int count = remove_effects[i].second;
 		bool remove_all = (count == 0 ? true : false);
@@ -527,13 +604,13 @@ int EffectManager::getType(const std::string& type) {
 			}
 		}
 
-		for (unsigned i=0; i<bonus_resist.size(); i++) {
+		for (unsigned i=0; i<ELEMENTS.size(); i++) {
 			if (type == ELEMENTS[i].id + "_resist") {
 				return EFFECT_COUNT+STAT_COUNT+i;
 			}
 		}
 
-		for (unsigned i=0; i<bonus_primary.size(); i++) {
+		for (unsigned i=0; i<PRIMARY_STATS.size(); i++) {
 			if (type == PRIMARY_STATS[i].id) {
 				return EFFECT_COUNT+STAT_COUNT+static_cast<int>(ELEMENTS.size())+i;
 			}
@@ -544,6 +621,17 @@ int EffectManager::getType(const std::string& type) {
 	return EFFECT_NONE;
 }
 
+/**
+ * Looks up the type and the interned strings of an effect definition once
+ * Definitions that are kept around (e.g. PowerManager::effects) are resolved when loaded
+ */
+void EffectManager::resolveEffectDef(EffectDef& effect) {
+	effect.effect_type = getType(effect.type);
+	effect.id_handle = internString(effect.id);
+	effect.attack_speed_anim_handle = internString(effect.attack_speed_anim);
+	effect.resolved = true;
+}
+
 bool EffectManager::isDebuffed() {
 	for (size_t i=effect_list.size(); i > 0; i--) {
 		if (effect_list[i-1].type == EFFECT_DAMAGE) return true;
@@ -556,37 +644,49 @@ bool EffectManager::isDebuffed() {
 	return false;
 }
 
-void EffectManager::getCurrentColor(Color& color_mod) {
-	Color default_color = color_mod;
-	Color no_color = Color(255, 255, 255);
+void EffectManager::updateRenderMods() {
+	const Color no_color = Color(255, 255, 255);
+	const uint8_t no_alpha = 255;
 
-	for (size_t i=effect_list.size(); i > 0; i--) {
-		if (effect_list[i-1].color_mod == no_color)
+	render_color_count = 0;
+	for (size_t i=effect_list.size(); i > 0 && render_color_count < 2; i--) {
+		const Color& color = effect_list[i-1].color_mod;
+		if (color == no_color || (render_color_count == 1 && color == render_colors[0]))
+			continue;
+		render_colors[render_color_count++] = color;
+	}
+
+	render_alpha_count = 0;
+	for (size_t i=effect_list.size(); i > 0 && render_alpha_count < 2; i--) {
+		const uint8_t alpha = effect_list[i-1].alpha_mod;
+		if (alpha == no_alpha || (render_alpha_count == 1 && alpha == render_alphas[0]))
 			continue;
+		render_alphas[render_alpha_count++] = alpha;
+	}
+}
 
-		if (effect_list[i-1].color_mod != default_color) {
-			color_mod = effect_list[i-1].color_mod;
+/**
+ * The latest effect color that differs from the one color_mod already has
+ */
+void EffectManager::getCurrentColor(Color& color_mod) {
+	for (int i = 0; i < render_color_count; ++i) {
+		if (render_colors[i] != color_mod) {
+			color_mod = render_colors[i];
 			return;
 		}
 	}
 }
 
 void EffectManager::getCurrentAlpha(uint8_t& alpha_mod) {
-	uint8_t default_alpha = alpha_mod;
-	uint8_t no_alpha = 255;
-
-	for (size_t i=effect_list.size(); i > 0; i--) {
-		if (effect_list[i-1].alpha_mod == no_alpha)
-			continue;
-
-		if (effect_list[i-1].alpha_mod != default_alpha) {
-			alpha_mod = effect_list[i-1].alpha_mod;
+	for (int i = 0; i < render_alpha_count; ++i) {
+		if (render_alphas[i] != alpha_mod) {
+			alpha_mod = render_alphas[i];
 			return;
 		}
 	}
 }
 
-bool EffectManager::hasEffect(const std::string& id, int req_count) {
+bool EffectManager::hasEffect(StringHandle id, int req_count) {
 	if (req_count <= 0)
 		return false;
 
@@ -600,14 +700,14 @@ bool EffectManager::hasEffect(const std::string& id, int req_count) {
 	return count >= req_count;
 }
 
-float EffectManager::getAttackSpeed(const std::string& anim_name) {
+float EffectManager::getAttackSpeed(StringHandle anim_name) {
 	float attack_speed = 100;
 
 	for (size_t i = 0; i < effect_list.size(); ++i) {
 		if (effect_list[i].type != EFFECT_ATTACK_SPEED)
 			continue;
 
-		if (effect_list[i].attack_speed_anim.empty() || (!effect_list[i].attack_speed_anim.empty() && effect_list[i].attack_speed_anim == anim_name)) {
+		if (effect_list[i].attack_speed_anim == 0 || effect_list[i].attack_speed_anim == anim_name) {
 			attack_speed = (static_cast<float>(effect_list[i].magnitude) * attack_speed) / 100.0f;
 		}
 	}
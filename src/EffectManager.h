@@ -66,7 +66,7 @@ enum EFFECT_TYPE {
 
 class Effect {
 public:
-	std::string id;
+	StringHandle id;
 	std::string name;
 	int icon;
 	int ticks;
@@ -76,6 +76,7 @@ public:
 	int magnitude_max;
 	std::string animation_name;
 	Animation* animation;
+	AnimationSet* animation_set; // shared with PowerManager; animation_name is only set when we hold our own reference
 	bool item;
 	int trigger;
 	bool render_above;
@@ -84,10 +85,10 @@ public:
 	bool group_stack;
 	Color color_mod;
 	uint8_t alpha_mod;
-	std::string attack_speed_anim;
+	StringHandle attack_speed_anim;
 
 	Effect()
-		: id("")
+		: id(0)
 		, name("")
 		, icon(-1)
 		, ticks(0)
@@ -97,6 +98,7 @@ public:
 		, magnitude_max(0)
 		, animation_name("")
 		, animation(NULL)
+		, animation_set(NULL)
 		, item(false)
 		, trigger(-1)
 		, render_above(false)
@@ -105,7 +107,7 @@ public:
 		, group_stack(false)
 		, color_mod(255, 255, 255)
 		, alpha_mod(255)
-		, attack_speed_anim("") {
+		, attack_speed_anim(0) {
 	}
 
 	~Effect() {
@@ -119,17 +121,31 @@ private:
 	void removeEffect(size_t id);
 	void removeAnimation(size_t id);
 	void clearStatus();
-	int getType(const std::string& type);
+	void calcStatus();
+
+	// set when effects are added or removed, so that calcStatus() runs on the next logic()
+	bool status_dirty;
+
+	// Finds the colors and alphas that getCurrentColor() and getCurrentAlpha() pick from, whenever effects are added or removed.
+	// That is the latest effect's value, and for renderables that already have it, the latest different one.
+	void updateRenderMods();
+	Color render_colors[2];
+	int render_color_count;
+	uint8_t render_alphas[2];
+	int render_alpha_count;
 
 public:
 	EffectManager();
 	~EffectManager();
+
+	static int getType(const std::string& type);
+	static void resolveEffectDef(EffectDef& effect);
 	EffectManager& operator= (const EffectManager &emSource);
 	void logic();
 	void addEffect(EffectDef &effect, int duration, int magnitude, bool item, int trigger, int passive_id, int source_type);
 	void removeEffectType(const int type);
 	void removeEffectPassive(int id);
-	void removeEffectID(const std::vector< std::pair<std::string, int> >& remove_effects);
+	void removeEffectID(const std::vector< std::pair<StringHandle, int> >& remove_effects);
 	void clearEffects();
 	void clearNegativeEffects(int type = -1);
 	void clearItemEffects();
@@ -138,8 +154,8 @@ public:
 	bool isDebuffed();
 	void getCurrentColor(Color& color_mod);
 	void getCurrentAlpha(uint8_t& alpha_mod);
-	bool hasEffect(const std::string& id, int req_count);
-	float getAttackSpeed(const std::string& anim_name);
+	bool hasEffect(StringHandle id, int req_count);
+	float getAttackSpeed(StringHandle anim_name);
 
 	std::vector<Effect> effect_list;
 
@@ -40,20 +40,28 @@ Enemy::Enemy() : Entity() {
 	stats.join_combat = false;
 
 	haz = NULL;
+	definition = NULL;
 
 	reward_xp = false;
+	resources_loaded = false;
 	instant_power = false;
 	kill_source_type = SOURCE_TYPE_NEUTRAL;
+	loot_dropped = false;
+	party_slot = -1;
 	eb = NULL;
 }
 
 Enemy::Enemy(const Enemy& e)
 	: Entity(e)
 	, type(e.type)
+	, definition(e.definition)
 	, haz(NULL) // do not copy hazard. This constructor is used during mapload, so no hazard should be active.
 	, reward_xp(e.reward_xp)
+	, resources_loaded(e.resources_loaded)
 	, instant_power(e.instant_power)
-	, kill_source_type(e.kill_source_type) {
+	, kill_source_type(e.kill_source_type)
+	, loot_dropped(e.loot_dropped)
+	, party_slot(-1) {
 	eb = new BehaviorStandard(this); // Putting a 'this' into the init list will make MSVS complain, hence it's in the body of the ctor
 	assert(e.haz == NULL);
 }
@@ -160,11 +168,9 @@ void Enemy::doRewards(int source_type) {
  * Map objects need to be drawn in Z order, so we allow a parent object (GameEngine)
  * to collect all mobile sprites each frame.
  */
-Renderable Enemy::getRender() {
-	Renderable r = activeAnimation->getCurrentFrame(stats.direction);
-	r.map_pos.x = stats.pos.x;
-	r.map_pos.y = stats.pos.y;
-	return r;
+void Enemy::getRender(Renderable& r) {
+	activeAnimation->getCurrentFrame(stats.direction, r);
+	r.map_pos = calcInterpolatedPos(stats.prev_pos, stats.pos);
 }
 
 Enemy::~Enemy() {
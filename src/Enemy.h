@@ -32,6 +32,18 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 class EnemyBehavior;
 class Hazard;
 
+/**
+ * The parts of an enemy type that are loaded once and shared by every enemy of that type
+ */
+class EnemyDefinition {
+public:
+	// enemies start out as a copy of these stats
+	StatBlock stats;
+
+	// only needed when an enemy dies, so it isn't copied into every enemy
+	std::vector<Event_Component> loot_table;
+};
+
 class Enemy : public Entity {
 
 public:
@@ -43,16 +55,22 @@ public:
 	virtual void doRewards(int source_type);
 
 	std::string type;
+	const EnemyDefinition *definition;
 
-	Renderable getRender();
+	void getRender(Renderable& r);
 
 	Hazard *haz;
 	EnemyBehavior *eb;
 
 	// other flags
 	bool reward_xp;
+	bool resources_loaded; // false until the sprite-sheet and sounds are loaded, see ENEMY_LOAD_DISTANCE
 	bool instant_power;
 	int kill_source_type;
+	bool loot_dropped;
+
+	// index into EnemyManager::party_slots, or -1 if this isn't an ally following the hero
+	int party_slot;
 
 };
 
@@ -29,6 +29,10 @@ EnemyBehavior::EnemyBehavior(Enemy *_e) {
 	e = _e;
 }
 
+void EnemyBehavior::decide() {
+
+}
+
 void EnemyBehavior::logic() {
 
 }
@@ -37,6 +37,9 @@ protected:
 public:
 	explicit EnemyBehavior(Enemy *_e);
 	virtual ~EnemyBehavior();
+
+	// runs on the worker threads before logic(), so it may only read the game state
+	virtual void decide();
 	virtual void logic();
 };
 
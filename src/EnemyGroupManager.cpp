@@ -19,6 +19,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "EnemyGroupManager.h"
 #include "FileParser.h"
+#include "Random.h"
 #include "Settings.h"
 #include "SharedGameResources.h"
 #include "SharedResources.h"
@@ -58,71 +59,102 @@ EnemyGroupManager::EnemyGroupManager() {
 				// @ATTR categories|list(predefined_string)|Comma separated list of enemy categories
 				std::string cat;
 				while ( (cat = popFirstString(infile.val)) != "") {
-					_categories[cat].push_back(new_enemy);
+					_categories[cat].enemies.push_back(new_enemy);
 				}
 			}
 		}
 		infile.close();
 	}
+
+	buildWeightTables();
+}
+
+/**
+ * Orders enemies by level, keeping the load order for equal levels
+ */
+static bool compareEnemyLevel(const Enemy_Level& a, const Enemy_Level& b) {
+	return a.level < b.level;
+}
+
+static bool compareLevelValue(const Enemy_Level& a, int level) {
+	return a.level < level;
+}
+
+static bool compareValueLevel(int level, const Enemy_Level& a) {
+	return level < a.level;
+}
+
+/**
+ * How many times more likely an enemy is picked than a "rare" one
+ */
+static int getRarityWeight(const Enemy_Level& enemy) {
+	if (enemy.rarity == "common")
+		return 6;
+	else if (enemy.rarity == "uncommon")
+		return 3;
+	else if (enemy.rarity == "rare")
+		return 1;
+
+	logError("EnemyGroupManager: 'rarity' property for enemy '%s' not valid (common|uncommon|rare): %s",
+			enemy.type.c_str(), enemy.rarity.c_str());
+	return 0;
+}
+
+void EnemyGroupManager::buildWeightTables() {
+	std::map<std::string, EnemyCategory>::iterator it;
+	for (it = _categories.begin(); it != _categories.end(); ++it) {
+		EnemyCategory& cat = it->second;
+
+		cat.by_level = cat.enemies;
+		std::stable_sort(cat.by_level.begin(), cat.by_level.end(), compareEnemyLevel);
+
+		cat.cumulative_weight.resize(cat.by_level.size());
+		int total = 0;
+		for (size_t i = 0; i < cat.by_level.size(); ++i) {
+			total += getRarityWeight(cat.by_level[i]);
+			cat.cumulative_weight[i] = total;
+		}
+	}
 }
 
 EnemyGroupManager::~EnemyGroupManager() {
 }
 
 Enemy_Level EnemyGroupManager::getRandomEnemy(const std::string& category, int minlevel, int maxlevel) const {
-	std::vector<Enemy_Level> enemyCategory;
-	std::map<std::string, std::vector<Enemy_Level> >::const_iterator it = _categories.find(category);
-	if (it != _categories.end()) {
-		enemyCategory = it->second;
-	}
-	else {
+	std::map<std::string, EnemyCategory>::const_iterator it = _categories.find(category);
+	if (it == _categories.end()) {
 		logError("EnemyGroupManager: Could not find enemy category %s, returning empty enemy", category.c_str());
 		return Enemy_Level();
 	}
-
-	// load only the data that fit the criteria
-	std::vector<Enemy_Level> enemyCandidates;
-	for (size_t i = 0; i < enemyCategory.size(); ++i) {
-		Enemy_Level new_enemy = enemyCategory[i];
-		if ((new_enemy.level >= minlevel && new_enemy.level <= maxlevel) || (minlevel == 0 && maxlevel == 0)) {
-			// add more than one time to increase chance of getting
-			// this enemy as result, "rarity" property
-			int add_times = 0;
-			if (new_enemy.rarity == "common") {
-				add_times = 6;
-			}
-			else if (new_enemy.rarity == "uncommon") {
-				add_times = 3;
-			}
-			else if (new_enemy.rarity == "rare") {
-				add_times = 1;
-			}
-			else {
-				logError("EnemyGroupManager: 'rarity' property for enemy '%s' not valid (common|uncommon|rare): %s",
-						new_enemy.type.c_str(), new_enemy.rarity.c_str());
-			}
-
-			// do add, the given number of times
-			for (int j = 0; j < add_times; ++j) {
-				enemyCandidates.push_back(new_enemy);
-			}
-		}
+	const EnemyCategory& cat = it->second;
+
+	// the range of enemies that fit the level criteria
+	size_t first = 0;
+	size_t last = cat.by_level.size();
+	if (minlevel != 0 || maxlevel != 0) {
+		first = static_cast<size_t>(std::lower_bound(cat.by_level.begin(), cat.by_level.end(), minlevel, compareLevelValue) - cat.by_level.begin());
+		last = static_cast<size_t>(std::upper_bound(cat.by_level.begin(), cat.by_level.end(), maxlevel, compareValueLevel) - cat.by_level.begin());
 	}
 
-	if (enemyCandidates.empty()) {
+	// the chance of getting an enemy depends on its "rarity" property
+	const int base = (first > 0 && first < last) ? cat.cumulative_weight[first-1] : 0;
+	const int total = (first < last) ? cat.cumulative_weight[last-1] - base : 0;
+
+	if (total <= 0) {
 		logError("EnemyGroupManager: Could not find a suitable enemy category for (%s, %d, %d)", category.c_str(), minlevel, maxlevel);
 		return Enemy_Level();
 	}
-	else {
-		return enemyCandidates[rand() % enemyCandidates.size()];
-	}
+
+	const int roll = base + randInt(total);
+	const std::vector<int>::const_iterator pick = std::upper_bound(cat.cumulative_weight.begin() + first, cat.cumulative_weight.begin() + last, roll);
+	return cat.by_level[pick - cat.cumulative_weight.begin()];
 }
 
 std::vector<Enemy_Level> EnemyGroupManager::getEnemiesInCategory(const std::string& category) const {
-	std::map<std::string, std::vector<Enemy_Level> >::const_iterator it = _categories.find(category);
+	std::map<std::string, EnemyCategory>::const_iterator it = _categories.find(category);
 	if (it == _categories.end()) {
 		logError("EnemyGroupManager: Could not find enemy category %s, returning empty enemy list", category.c_str());
 		return std::vector<Enemy_Level>();
 	}
-	return it->second;
+	return it->second.enemies;
 }
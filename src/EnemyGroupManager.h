@@ -31,6 +31,19 @@ public:
 
 };
 
+/**
+ * The enemies of one category, with the tables used to pick a random one
+ */
+class EnemyCategory {
+public:
+	// in the order they were loaded
+	std::vector<Enemy_Level> enemies;
+
+	// the same enemies sorted by level, with the running total of their rarity weights
+	std::vector<Enemy_Level> by_level;
+	std::vector<int> cumulative_weight;
+};
+
 /**
  * class EnemyGroupManager
  *
@@ -64,8 +77,11 @@ public:
 
 private:
 
+	/** Builds the level sorted weight tables of each category */
+	void buildWeightTables();
+
 	/** Container to store enemy data */
-	std::map <std::string, std::vector<Enemy_Level> > _categories;
+	std::map <std::string, EnemyCategory> _categories;
 };
 
 #endif
@@ -27,22 +27,41 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "EnemyBehavior.h"
 #include "BehaviorStandard.h"
 #include "BehaviorAlly.h"
+#include "Random.h"
 #include "SharedGameResources.h"
+#include "VisualQuality.h"
 
 #include <limits>
 
 EnemyManager::EnemyManager()
-	: enemies()
+	: party_direction(0)
+	, enemies()
 	, hero_stealth(0)
 	, player_blocked(false)
-	, player_blocked_ticks(0) {
+	, player_blocked_ticks(0)
+	, hostiles_in_combat(0) {
 	handleNewMap();
 }
 
 void EnemyManager::loadAnimations(Enemy *e) {
 	anim->increaseCount(e->stats.animations);
-	e->animationSet = anim->getAnimationSet(e->stats.animations);
-	e->activeAnimation = e->animationSet->getAnimation("");
+	e->setAnimationSet(anim->getAnimationSet(e->stats.animations, ENEMY_LOAD_DISTANCE > 0));
+}
+
+void EnemyManager::loadNearbyResources(const FPoint& center, bool wait) {
+	for (size_t i = 0; i < enemies.size() + corpses.size(); ++i) {
+		Enemy *e = (i < enemies.size()) ? enemies[i] : corpses[i - enemies.size()];
+		if (e->resources_loaded || calcDist(e->stats.pos, center) > ENEMY_LOAD_DISTANCE)
+			continue;
+
+		if (wait)
+			e->animationSet->requireSprite();
+		else if (!e->animationSet->prepareSprite())
+			continue;
+
+		e->loadSounds();
+		e->resources_loaded = true;
+	}
 }
 
 Enemy *EnemyManager::getEnemyPrototype(const std::string& type_id) {
@@ -51,6 +70,56 @@ Enemy *EnemyManager::getEnemyPrototype(const std::string& type_id) {
 	return e;
 }
 
+const EnemyDefinition* EnemyManager::getEnemyDefinition(const std::string& type_id) {
+	std::map<std::string, EnemyDefinition>::iterator it = definitions.find(type_id);
+	if (it != definitions.end())
+		return &it->second;
+
+	EnemyDefinition& def = definitions[type_id];
+
+	// start from the defaults of a new enemy, so that copying the stats is the same as loading them
+	Enemy e;
+	e.stats.load(type_id);
+	def.stats = e.stats;
+	def.loot_table.swap(def.stats.loot_table);
+
+	return &def;
+}
+
+/**
+ * The definition is replaced in place, since enemies point to it. Enemies that already exist keep their
+ * stats; the prototype is replaced, so that later spawns are made from the new definition.
+ */
+bool EnemyManager::reloadDefinition(const std::string& type_id) {
+	std::map<std::string, EnemyDefinition>::iterator it = definitions.find(type_id);
+	if (it == definitions.end())
+		return false;
+
+	EnemyDefinition& def = it->second;
+
+	Enemy e;
+	e.stats.load(type_id);
+	def.stats = e.stats;
+	def.loot_table.clear();
+	def.loot_table.swap(def.stats.loot_table);
+
+	// enemies can't be moved around the vector, so the old prototype is only left unused until the next map
+	for (size_t i = 0; i < prototypes.size(); i++) {
+		if (prototypes[i].type == type_id)
+			prototypes[i].type.clear();
+	}
+
+	return true;
+}
+
+void EnemyManager::getDefinitionTypes(std::vector<std::string>& types) const {
+	types.clear();
+	std::map<std::string, EnemyDefinition>::const_iterator it;
+	for (it = definitions.begin(); it != definitions.end(); ++it) {
+		types.push_back(it->first);
+	}
+}
+
 size_t EnemyManager::loadEnemyPrototype(const std::string& type_id) {
 	for (size_t i = 0; i < prototypes.size(); i++) {
 		if (prototypes[i].type == type_id) {
@@ -61,14 +130,20 @@ size_t EnemyManager::loadEnemyPrototype(const std::string& type_id) {
 	Enemy e = Enemy();
 
 	e.eb = new BehaviorStandard(&e);
-	e.stats.load(type_id);
+	e.definition = getEnemyDefinition(type_id);
+	e.stats = e.definition->stats;
 	e.type = type_id;
 
 	if (e.stats.animations == "")
 		logError("EnemyManager: No animation file specified for entity: %s", type_id.c_str());
 
 	loadAnimations(&e);
-	e.loadSounds();
+
+	// with ENEMY_LOAD_DISTANCE, each enemy loads its sounds once it gets close
+	if (ENEMY_LOAD_DISTANCE <= 0) {
+		e.loadSounds();
+		e.resources_loaded = true;
+	}
 
 	// set cooldown_hit to duration of hit animation if undefined
 	if (e.stats.cooldown_hit == -1) {
@@ -86,40 +161,134 @@ size_t EnemyManager::loadEnemyPrototype(const std::string& type_id) {
 	size_t prototype = prototypes.size() - 1;
 
 	for (size_t i = 0; i < e.stats.powers_ai.size(); i++) {
-		int power_index = e.stats.powers_ai[i].id;
-		const std::string& spawn_type = powers->powers[power_index].spawn_type;
-		if (power_index != 0 && spawn_type != "" && spawn_type != "untransform") {
-			std::vector<Enemy_Level> spawn_enemies = enemyg->getEnemiesInCategory(spawn_type);
-			for (size_t j = 0; j < spawn_enemies.size(); j++) {
-				loadEnemyPrototype(spawn_enemies[j].type);
-			}
-		}
+		loadPowerCreatures(e.stats.powers_ai[i].id);
 	}
 
+	// the powers used by the hero while transformed into this creature
+	loadPowerCreatures(e.stats.powers_list);
+	loadPowerCreatures(e.stats.powers_passive);
+
 	return prototype;
 }
 
+/**
+ * Load the prototypes of the creatures that a power can summon or transform into,
+ * so that using the power doesn't have to load them first
+ */
+void EnemyManager::loadPowerCreatures(int power_index) {
+	if (power_index <= 0 || static_cast<size_t>(power_index) >= powers->powers.size())
+		return;
+
+	const std::string& spawn_type = powers->powers[power_index].spawn_type;
+	if (spawn_type == "" || spawn_type == "untransform")
+		return;
+
+	std::vector<Enemy_Level> spawn_enemies = enemyg->getEnemiesInCategory(spawn_type);
+	for (size_t i = 0; i < spawn_enemies.size(); i++) {
+		loadEnemyPrototype(spawn_enemies[i].type);
+	}
+}
+
+void EnemyManager::loadPowerCreatures(const std::vector<int>& power_list) {
+	for (size_t i = 0; i < power_list.size(); i++) {
+		loadPowerCreatures(power_list[i]);
+	}
+}
+
 /**
  * When loading a new map, we eliminate existing enemies and load the new ones.
  * The map will have loaded Entity blocks into an array; retrieve the Enemies and init them
  */
+/**
+ * Orders map enemies from the furthest to the nearest
+ */
+class CompareEnemyDistance {
+public:
+	explicit CompareEnemyDistance(const FPoint& _center) : center(_center) {}
+	bool operator()(const Map_Enemy& a, const Map_Enemy& b) const {
+		return calcDist(a.pos, center) > calcDist(b.pos, center);
+	}
+private:
+	FPoint center;
+};
+
+/**
+ * Moves the waiting map enemies in the chunks within the map's populate_range
+ * of the hero to pending_enemies. Only checked when the hero enters another
+ * chunk, unless force is set.
+ */
+void EnemyManager::wakeNearbyEnemies(bool force) {
+	const Point hero_chunk(static_cast<int>(pc->stats.pos.x) / ENEMY_CHUNK_SIZE, static_cast<int>(pc->stats.pos.y) / ENEMY_CHUNK_SIZE);
+	if (!force && hero_chunk.x == waiting_check_chunk.x && hero_chunk.y == waiting_check_chunk.y)
+		return;
+	waiting_check_chunk = hero_chunk;
+
+	const int range = (mapr->populate_range + ENEMY_CHUNK_SIZE - 1) / ENEMY_CHUNK_SIZE;
+	const size_t first_new = pending_enemies.size();
+
+	for (int cy = hero_chunk.y - range; cy <= hero_chunk.y + range; ++cy) {
+		for (int cx = hero_chunk.x - range; cx <= hero_chunk.x + range; ++cx) {
+			std::map<std::pair<int, int>, std::vector<Map_Enemy> >::iterator it = waiting_enemies.find(std::make_pair(cx, cy));
+			if (it == waiting_enemies.end())
+				continue;
+
+			pending_enemies.insert(pending_enemies.end(), it->second.begin(), it->second.end());
+			waiting_enemies.erase(it);
+		}
+	}
+
+	if (pending_enemies.size() != first_new)
+		std::sort(pending_enemies.begin(), pending_enemies.end(), CompareEnemyDistance(pc->stats.pos));
+}
+
+void EnemyManager::populateEnemy(const Map_Enemy& me) {
+	Enemy *e = getEnemyPrototype(me.type);
+
+	e->stats.waypoints = me.waypoints;
+	e->stats.pos.x = me.pos.x;
+	e->stats.pos.y = me.pos.y;
+	e->stats.direction = static_cast<unsigned char>(me.direction);
+	e->stats.wander = me.wander_radius > 0;
+	e->stats.setWanderArea(me.wander_radius);
+	if (e->stats.wander)
+		mapr->collider.get_wander_tiles(e->stats.wander_area, e->stats.movement_type);
+
+	enemies.push_back(e);
+	mapr->entity_grid.add(e);
+	mapr->entity_registry.add(e, ENTITY_IS_ENEMY);
+
+	mapr->collider.block(me.pos.x, me.pos.y, false);
+}
+
 void EnemyManager::handleNewMap () {
 
 	Map_Enemy me;
 	std::queue<Enemy *> allies;
 
+	// the pick buffer points at the enemies that are about to be deleted
+	mapr->pick_buffer.clear();
+
 	// delete existing enemies
 	for (unsigned int i=0; i < enemies.size(); i++) {
-		anim->decreaseCount(enemies[i]->animationSet->getName());
-		if(enemies[i]->stats.hero_ally && !enemies[i]->stats.corpse && enemies[i]->stats.cur_state != ENEMY_DEAD && enemies[i]->stats.cur_state != ENEMY_CRITDEAD && enemies[i]->stats.speed > 0.0f)
+		if(enemies[i]->stats.hero_ally && !enemies[i]->stats.corpse && enemies[i]->stats.cur_state != ENEMY_DEAD && enemies[i]->stats.cur_state != ENEMY_CRITDEAD && enemies[i]->stats.speed > 0.0f) {
+			anim->decreaseCount(enemies[i]->animationSet->getName());
+			mapr->entity_grid.remove(enemies[i]);
 			allies.push(enemies[i]);
+		}
 		else {
-			enemies[i]->unloadSounds();
-			delete enemies[i];
+			deleteEnemy(enemies[i]);
 		}
 	}
 	enemies.clear();
 
+	for (size_t i = 0; i < corpses.size(); ++i)
+		deleteEnemy(corpses[i]);
+	corpses.clear();
+
+	for (size_t i = 0; i < expired_corpses.size(); ++i)
+		deleteEnemy(expired_corpses[i]);
+	expired_corpses.clear();
+
 
 	for (unsigned int i=0; i < prototypes.size(); i++) {
 		anim->decreaseCount(prototypes[i].animationSet->getName());
@@ -128,6 +297,9 @@ void EnemyManager::handleNewMap () {
 	prototypes.clear();
 
 	// load new enemies
+	// The ones near the hero are created right away, the others are left for logic()
+	pending_enemies.clear();
+	waiting_enemies.clear();
 	while (!mapr->enemies.empty()) {
 		me = mapr->enemies.front();
 		mapr->enemies.pop();
@@ -151,20 +323,25 @@ void EnemyManager::handleNewMap () {
 		if(!status_reqs_met)
 			continue;
 
+		if (mapr->populate_range > 0) {
+			const Point chunk(static_cast<int>(me.pos.x) / ENEMY_CHUNK_SIZE, static_cast<int>(me.pos.y) / ENEMY_CHUNK_SIZE);
+			waiting_enemies[std::make_pair(chunk.x, chunk.y)].push_back(me);
+		}
+		else if (calcDist(me.pos, pc->stats.pos) > ENEMY_POPULATE_DISTANCE)
+			pending_enemies.push_back(me);
+		else
+			populateEnemy(me);
+	}
+	if (!waiting_enemies.empty()) {
+		wakeNearbyEnemies(true);
 
-		Enemy *e = getEnemyPrototype(me.type);
-
-		e->stats.waypoints = me.waypoints;
-		e->stats.pos.x = me.pos.x;
-		e->stats.pos.y = me.pos.y;
-		e->stats.direction = static_cast<unsigned char>(me.direction);
-		e->stats.wander = me.wander_radius > 0;
-		e->stats.setWanderArea(me.wander_radius);
-
-		enemies.push_back(e);
-
-		mapr->collider.block(me.pos.x, me.pos.y, false);
+		// the ones right next to the hero are created with the map, like on other maps
+		while (!pending_enemies.empty() && calcDist(pending_enemies.back().pos, pc->stats.pos) <= ENEMY_POPULATE_DISTANCE) {
+			populateEnemy(pending_enemies.back());
+			pending_enemies.pop_back();
+		}
 	}
+	std::sort(pending_enemies.begin(), pending_enemies.end(), CompareEnemyDistance(pc->stats.pos));
 
 	FPoint spawn_pos = mapr->collider.get_random_neighbor(FPointToPoint(pc->stats.pos), 1, false);
 	while (!allies.empty()) {
@@ -180,41 +357,34 @@ void EnemyManager::handleNewMap () {
 		e->stats.direction = pc->stats.direction;
 
 		enemies.push_back(e);
+		mapr->entity_grid.add(e);
+		mapr->entity_registry.update(e);
 
 		mapr->collider.block(e->stats.pos.x, e->stats.pos.y, true);
 	}
 
-	// load enemies that can be spawn by avatar's powers
-	for (size_t i = 0; i < pc->stats.powers_list.size(); i++) {
-		int power_index = pc->stats.powers_list[i];
-		const std::string& spawn_type = powers->powers[power_index].spawn_type;
-		if (spawn_type != "" && spawn_type != "untransform") {
-			std::vector<Enemy_Level> spawn_enemies = enemyg->getEnemiesInCategory(spawn_type);
-			for (size_t j = 0; j < spawn_enemies.size(); j++) {
-				loadEnemyPrototype(spawn_enemies[j].type);
-			}
-		}
+	// enemies around the starting position are loaded right away
+	// Decoding of all their sprite-sheets is started first, so that they are decoded in parallel.
+	if (ENEMY_LOAD_DISTANCE > 0) {
+		loadNearbyResources(pc->stats.pos, false);
+		loadNearbyResources(pc->stats.pos, true);
 	}
 
+	// load enemies that can be spawned or transformed into by avatar's powers, including those of equipped items
+	loadPowerCreatures(pc->stats.powers_list);
+	loadPowerCreatures(pc->stats.powers_list_items);
+	loadPowerCreatures(pc->stats.powers_passive);
+
 	// load enemies that can be spawn by powers in the action bar
 	if (menu_act != NULL) {
-		for (size_t i = 0; i < menu_act->hotkeys.size(); i++) {
-			int power_index = menu_act->hotkeys[i];
-			const std::string& spawn_type = powers->powers[power_index].spawn_type;
-			if (power_index != 0 && spawn_type != "" && spawn_type != "untransform") {
-				std::vector<Enemy_Level> spawn_enemies = enemyg->getEnemiesInCategory(spawn_type);
-				for (size_t j = 0; j < spawn_enemies.size(); j++) {
-					loadEnemyPrototype(spawn_enemies[j].type);
-				}
-			}
-		}
+		loadPowerCreatures(menu_act->hotkeys);
 	}
 
 	// load enemies that can be spawn by map events
 	for (size_t i = 0; i < mapr->events.size(); i++) {
 		for (size_t j = 0; j < mapr->events[i].components.size(); j++) {
 			if (mapr->events[i].components[j].type == EC_SPAWN) {
-				std::vector<Enemy_Level> spawn_enemies = enemyg->getEnemiesInCategory(mapr->events[i].components[j].s);
+				std::vector<Enemy_Level> spawn_enemies = enemyg->getEnemiesInCategory(mapr->events[i].components[j].getString());
 				for (size_t k = 0; k < spawn_enemies.size(); k++) {
 					loadEnemyPrototype(spawn_enemies[k].type);
 				}
@@ -244,6 +414,19 @@ void EnemyManager::handleSpawn() {
 		else
 			e->eb = new BehaviorStandard(e);
 
+		Enemy_Level el = enemyg->getRandomEnemy(espawn.type, 0, 0);
+		e->type = el.type;
+
+		if (el.type != "") {
+			e->definition = getEnemyDefinition(el.type);
+			e->stats = e->definition->stats;
+		}
+		else {
+			logError("EnemyManager: Could not spawn creature type '%s'", espawn.type.c_str());
+			delete e;
+			return;
+		}
+
 		e->stats.hero_ally = espawn.hero_ally;
 		e->stats.enemy_ally = espawn.enemy_ally;
 		e->stats.summoned = true;
@@ -256,31 +439,18 @@ void EnemyManager::handleSpawn() {
 
 		e->stats.direction = static_cast<unsigned char>(espawn.direction);
 
-		Enemy_Level el = enemyg->getRandomEnemy(espawn.type, 0, 0);
-		e->type = el.type;
-
-		if (el.type != "") {
-			e->stats.load(el.type);
-		}
-		else {
-			logError("EnemyManager: Could not spawn creature type '%s'", espawn.type.c_str());
-			delete e;
-			return;
-		}
-
 		if (e->stats.animations != "") {
 			// load the animation file if specified
 			anim->increaseCount(e->stats.animations);
-			e->animationSet = anim->getAnimationSet(e->stats.animations);
-			if (e->animationSet)
-				e->activeAnimation = e->animationSet->getAnimation("");
-			else
+			e->setAnimationSet(anim->getAnimationSet(e->stats.animations));
+			if (!e->animationSet)
 				logError("EnemyManager: Animations file could not be loaded for %s", espawn.type.c_str());
 		}
 		else {
 			logError("EnemyManager: No animation file specified for entity: %s", espawn.type.c_str());
 		}
 		e->loadSounds();
+		e->resources_loaded = true;
 
 		//Set level
 		if(e->stats.summoned_power_index != 0) {
@@ -354,6 +524,8 @@ void EnemyManager::handleSpawn() {
 		}
 
 		enemies.push_back(e);
+		mapr->entity_grid.add(e);
+		mapr->entity_registry.add(e, ENTITY_IS_ENEMY);
 
 		mapr->collider.block(espawn.pos.x, espawn.pos.y, e->stats.hero_ally);
 	}
@@ -368,6 +540,15 @@ bool EnemyManager::checkPartyMembers() {
 	return false;
 }
 
+/**
+ * Runs on the worker threads; see EnemyBehavior::decide()
+ */
+static void decide_job(void *data, size_t begin, size_t end) {
+	Enemy **list = static_cast<Enemy**>(data);
+	for (size_t i = begin; i < end; ++i)
+		list[i]->eb->decide();
+}
+
 /**
  * perform logic() for all enemies
  */
@@ -381,61 +562,206 @@ void EnemyManager::logic() {
 
 	handleSpawn();
 
+	if (!waiting_enemies.empty())
+		wakeNearbyEnemies(false);
+
+	// create a few of the far map enemies each frame, nearest first
+	for (size_t i = 0; i < ENEMY_POPULATE_PER_FRAME && !pending_enemies.empty(); ++i) {
+		populateEnemy(pending_enemies.back());
+		pending_enemies.pop_back();
+	}
+
+	if (ENEMY_LOAD_DISTANCE > 0)
+		loadNearbyResources(mapr->cam, false);
+
+	// enemies look for the hero first, so check all of their lines of sight in one go
+	los_sources.clear();
+	hostiles_in_combat = 0;
+	const EntityRegistry& registry = mapr->entity_registry;
+	for (size_t i = 0; i < registry.size(); ++i) {
+		const unsigned char flags = registry.flags[i];
+		if (!(flags & ENTITY_IS_ENEMY) || (flags & ENTITY_CORPSE))
+			continue;
+		if ((flags & ENTITY_ALIVE) && calcDist(registry.pos[i], pc->stats.pos) < registry.threat_range[i])
+			los_sources.push_back(registry.pos[i]);
+		if ((flags & ENTITY_IN_COMBAT) && !(flags & ENTITY_HERO_ALLY))
+			hostiles_in_combat++;
+	}
+	mapr->collider.cache_line_of_sight(los_sources, pc->stats.pos);
+
+	updateParty();
+
+	// the creatures decide where to go in parallel, from the state at the start of the frame
+	// logic() then acts on those decisions one creature at a time, in the same order as before
+	if (!enemies.empty())
+		workers->parallelFor(decide_job, &enemies[0], enemies.size(), 16);
+
 	std::vector<Enemy*>::iterator it;
 	for (it = enemies.begin(); it != enemies.end(); ++it) {
 		// new actions this round
 		(*it)->stats.hero_stealth = hero_stealth;
 		(*it)->logic();
+
+		// catch position changes that don't go through Entity::move(), e.g. knockback or teleports
+		mapr->entity_grid.update(*it);
+		mapr->entity_registry.update(*it);
 	}
+
+	updateCorpses();
+	moveCorpses();
 }
 
-Enemy* EnemyManager::enemyFocus(const Point& mouse, const FPoint& cam, bool alive_only) {
-	Point p;
-	Rect r;
-	for(unsigned int i = 0; i < enemies.size(); i++) {
-		if(alive_only && (enemies[i]->stats.cur_state == ENEMY_DEAD || enemies[i]->stats.cur_state == ENEMY_CRITDEAD)) {
+/**
+ * Like MapCollision::line_of_movement(), but other entities on the line don't block it
+ */
+static bool isStaticLineClear(const FPoint& start, const FPoint& end, MOVEMENTTYPE movement_type) {
+	const int steps = static_cast<int>(calcDist(start, end) * 2) + 1;
+	for (int i = 1; i <= steps; ++i) {
+		const float t = static_cast<float>(i) / static_cast<float>(steps);
+		const float x = start.x + (end.x - start.x) * t;
+		const float y = start.y + (end.y - start.y) * t;
+		if (x < 0 || y < 0 || !mapr->collider.is_static_walkable(int(x), int(y), movement_type))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * The allies that follow the hero are given places in rows behind the hero, in the order they were summoned.
+ * Each ally walks to its own place, instead of every ally finding its way to the hero itself.
+ * Places in walls, or that can't be walked to from the hero in a straight line, are left out.
+ */
+void EnemyManager::updateParty() {
+	party_slots.clear();
+
+	// only turn the formation once the hero walks somewhere, so that allies don't run around a hero that stands still
+	if (calcDist(party_anchor, pc->stats.pos) > PARTY_TURN_DISTANCE) {
+		party_direction = calcDirection(party_anchor.x, party_anchor.y, pc->stats.pos.x, pc->stats.pos.y);
+		party_anchor = pc->stats.pos;
+	}
+
+	const int back = (party_direction + 4) % 8;
+	const int side = (party_direction + 2) % 8;
+	const int ROW_SIZE = 5;
+
+	int candidate = 0;
+	for (size_t i = 0; i < enemies.size(); ++i) {
+		Enemy *e = enemies[i];
+		e->party_slot = -1;
+
+		if (!e->stats.hero_ally || !e->stats.alive || e->stats.in_combat || e->stats.speed == 0.0f || !pc->stats.alive)
 			continue;
-		}
-		p = map_to_screen(enemies[i]->stats.pos.x, enemies[i]->stats.pos.y, cam.x, cam.y);
 
-		Renderable ren = enemies[i]->getRender();
-		r.w = ren.src.w;
-		r.h = ren.src.h;
-		r.x = p.x - ren.offset.x;
-		r.y = p.y - ren.offset.y;
+		// rows of ROW_SIZE start two tiles behind the hero, centered on the hero's path
+		// There are at most 2 * ROW_SIZE tries per ally, so a blocked area can't stall the loop.
+		const int last_candidate = candidate + ROW_SIZE * 2;
+		for (; candidate < last_candidate; ++candidate) {
+			const int row = candidate / ROW_SIZE;
+			const int column = candidate % ROW_SIZE;
+			const float lateral = static_cast<float>((column + 1) / 2) * (column % 2 == 0 ? 1.f : -1.f);
+
+			FPoint slot = calcVector(pc->stats.pos, back, static_cast<float>(row + 2));
+			slot = calcVector(slot, side, lateral);
+
+			if (!isStaticLineClear(pc->stats.pos, slot, e->stats.movement_type))
+				continue;
 
-		if (isWithinRect(r, mouse)) {
-			Enemy *enemy = enemies[i];
-			return enemy;
+			e->party_slot = static_cast<int>(party_slots.size());
+			party_slots.push_back(slot);
+			++candidate;
+			break;
 		}
 	}
-	return NULL;
 }
 
-Enemy* EnemyManager::getNearestEnemy(const FPoint& pos, bool get_corpse, float *saved_distance) {
-	Enemy* nearest = NULL;
-	float best_distance = std::numeric_limits<float>::max();
+/**
+ * Moves the enemies that are done dying from the enemies list to the corpses
+ */
+void EnemyManager::moveCorpses() {
+	size_t living = 0;
+	for (size_t i = 0; i < enemies.size(); ++i) {
+		if (enemies[i]->stats.corpse)
+			corpses.push_back(enemies[i]);
+		else
+			enemies[living++] = enemies[i];
+	}
+	enemies.resize(living);
+}
 
-	for (unsigned i=0; i<enemies.size(); i++) {
-		if(!get_corpse && (enemies[i]->stats.cur_state == ENEMY_DEAD || enemies[i]->stats.cur_state == ENEMY_CRITDEAD)) {
-			continue;
+/**
+ * Counts down the time left for the corpses, and hides the ones that ran out of time
+ */
+void EnemyManager::updateCorpses() {
+	// past the limit, the oldest corpses disappear early
+	if (CORPSE_LIMIT > 0 && corpses.size() > static_cast<size_t>(CORPSE_LIMIT)) {
+		for (size_t i = 0; i < corpses.size() - static_cast<size_t>(CORPSE_LIMIT); ++i)
+			corpses[i]->stats.corpse_ticks = 0;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < corpses.size(); ++i) {
+		Enemy *e = corpses[i];
+		if (e->stats.corpse_ticks > 0)
+			e->stats.corpse_ticks--;
+
+		if (e->stats.corpse_ticks == 0) {
+			mapr->entity_grid.remove(e);
+			mapr->entity_registry.remove(e);
+			expired_corpses.push_back(e);
 		}
-		if (get_corpse && !enemies[i]->stats.corpse) {
-			continue;
+		else {
+			corpses[kept++] = e;
 		}
+	}
+	corpses.resize(kept);
+}
 
-		float distance = calcDist(pos, enemies[i]->stats.pos);
-		if (distance < best_distance) {
-			best_distance = distance;
-			nearest = enemies[i];
+void EnemyManager::deleteEnemy(Enemy *e) {
+	anim->decreaseCount(e->animationSet->getName());
+	mapr->entity_grid.remove(e);
+	mapr->entity_registry.remove(e);
+	e->unloadSounds();
+	delete e;
+}
+
+Enemy* EnemyManager::enemyFocus(const Point& mouse, const FPoint& cam, bool alive_only) {
+	// only the enemies in the last render lists can be under the cursor
+	mapr->pick_buffer.query(mouse, cam, picked);
+
+	for (size_t i = 0; i < picked.size(); i++) {
+		Enemy *enemy = static_cast<Enemy*>(picked[i]);
+		if (alive_only && (enemy->stats.cur_state == ENEMY_DEAD || enemy->stats.cur_state == ENEMY_CRITDEAD)) {
+			continue;
 		}
+		return enemy;
 	}
+	return NULL;
+}
+
+static bool isNotDying(const Entity *e) {
+	return e->stats.cur_state != ENEMY_DEAD && e->stats.cur_state != ENEMY_CRITDEAD;
+}
 
-	if (nearest && saved_distance)
-		*saved_distance = best_distance;
+static bool isCorpse(const Entity *e) {
+	return e->stats.corpse;
+}
 
-	if (!saved_distance && best_distance > INTERACT_RANGE)
-		nearest = NULL;
+Enemy* EnemyManager::getNearestEnemy(const FPoint& pos, bool get_corpse, float *saved_distance) {
+	// without saved_distance, only enemies within the interact range are wanted
+	// otherwise, the search area grows until the nearest enemy is found or the whole map was searched
+	float max_radius = (saved_distance ? static_cast<float>(std::max(mapr->w, mapr->h)) : INTERACT_RANGE);
+
+	if (get_corpse)
+		mapr->entity_grid.getNearest(pos, max_radius, ENTITY_MASK_CORPSE, 1, nearby, isCorpse);
+	else
+		mapr->entity_grid.getNearest(pos, max_radius, ENTITY_MASK_HOSTILE | ENTITY_MASK_ALLY, 1, nearby, isNotDying);
+
+	if (nearby.empty())
+		return NULL;
+
+	Enemy *nearest = static_cast<Enemy*>(nearby[0]);
+	if (saved_distance)
+		*saved_distance = calcDist(pos, nearest->stats.pos);
 
 	return nearest;
 }
@@ -458,10 +784,14 @@ void EnemyManager::checkEnemiesforXP() {
 }
 
 bool EnemyManager::isCleared() {
+	// map enemies that haven't been created yet are alive
+	if (!pending_enemies.empty() || !waiting_enemies.empty()) return false;
+
 	if (enemies.empty()) return true;
 
-	for (unsigned int i=0; i < enemies.size(); i++) {
-		if (enemies[i]->stats.alive && !enemies[i]->stats.hero_ally)
+	const EntityRegistry& registry = mapr->entity_registry;
+	for (size_t i = 0; i < registry.size(); ++i) {
+		if ((registry.flags[i] & (ENTITY_IS_ENEMY | ENTITY_ALIVE | ENTITY_HERO_ALLY)) == (ENTITY_IS_ENEMY | ENTITY_ALIVE))
 			return false;
 	}
 
@@ -475,7 +805,7 @@ void EnemyManager::spawn(const std::string& enemy_type, const Point& target) {
 	espawn.pos = target;
 
 	// quick spawns start facing a random direction
-	espawn.direction = rand() % 8;
+	espawn.direction = randInt(8);
 
 	powers->map_enemies.push(espawn);
 }
@@ -486,28 +816,58 @@ void EnemyManager::spawn(const std::string& enemy_type, const Point& target) {
  * to collect all mobile sprites each frame.
  */
 void EnemyManager::addRenders(std::vector<Renderable> &r, std::vector<Renderable> &r_dead) {
-	std::vector<Enemy*>::iterator it;
-	for (it = enemies.begin(); it != enemies.end(); ++it) {
-		bool dead = (*it)->stats.corpse;
-		if (!dead || (*it)->stats.corpse_ticks > 0) {
-			Renderable re = (*it)->getRender();
-			re.prio = 1;
-			(*it)->stats.effects.getCurrentColor(re.color_mod);
-			(*it)->stats.effects.getCurrentAlpha(re.alpha_mod);
-
-			// draw corpses below objects so that floor loot is more visible
-			(dead ? r_dead : r).push_back(re);
-
-			// add effects
-			for (unsigned i = 0; i < (*it)->stats.effects.effect_list.size(); ++i) {
-				if ((*it)->stats.effects.effect_list[i].animation) {
-					Renderable ren = (*it)->stats.effects.effect_list[i].animation->getCurrentFrame(0);
-					ren.map_pos = (*it)->stats.pos;
-					if ((*it)->stats.effects.effect_list[i].render_above) ren.prio = 2;
-					else ren.prio = 0;
-					r.push_back(ren);
-				}
-			}
+	for (size_t i = 0; i < enemies.size(); ++i)
+		addRender(enemies[i], r, r_dead);
+
+	// corpses that ran out of time have already been moved to expired_corpses
+	for (size_t i = 0; i < corpses.size(); ++i)
+		addRender(corpses[i], r, r_dead);
+}
+
+void EnemyManager::addRender(Enemy *e, std::vector<Renderable> &r, std::vector<Renderable> &r_dead) {
+	// enemies are left out until their sprite-sheet is loaded
+	if (!e->resources_loaded)
+		return;
+
+	bool dead = e->stats.corpse;
+	if (dead && e->stats.corpse_ticks == 0)
+		return;
+
+	// animations that are certainly off screen are skipped before looking up their frame, so that they don't have to play it
+	const FPoint map_pos = calcInterpolatedPos(e->stats.prev_pos, e->stats.pos);
+
+	// draw corpses below objects so that floor loot is more visible
+	// The renderable is written straight into the list, and taken out again if it's off screen.
+	if (mapr->isOnScreen(map_pos, e->activeAnimation->getBounds())) {
+		std::vector<Renderable> &dest = dead ? r_dead : r;
+		dest.push_back(Renderable());
+		Renderable &re = dest.back();
+		e->getRender(re);
+		re.prio = 1;
+		e->stats.effects.getCurrentColor(re.color_mod);
+		e->stats.effects.getCurrentAlpha(re.alpha_mod);
+
+		if (mapr->isOnScreen(re))
+			mapr->pick_buffer.add(re, e);
+		else
+			dest.pop_back();
+	}
+
+	// under heavy load, the effects of distant enemies are left out
+	if (getVisualQuality() == VISUAL_QUALITY_LOW && calcDist(e->stats.pos, pc->stats.pos) > VISUAL_QUALITY_EFFECT_DISTANCE)
+		return;
+
+	// add effects
+	for (unsigned i = 0; i < e->stats.effects.effect_list.size(); ++i) {
+		if (e->stats.effects.effect_list[i].animation && mapr->isOnScreen(map_pos, e->stats.effects.effect_list[i].animation->getBounds())) {
+			r.push_back(Renderable());
+			Renderable &ren = r.back();
+			e->stats.effects.effect_list[i].animation->getCurrentFrame(0, ren);
+			ren.map_pos = map_pos;
+			if (e->stats.effects.effect_list[i].render_above) ren.prio = 2;
+			else ren.prio = 0;
+			if (!mapr->isOnScreen(ren))
+				r.pop_back();
 		}
 	}
 }
@@ -518,6 +878,12 @@ EnemyManager::~EnemyManager() {
 		enemies[i]->unloadSounds();
 		delete enemies[i];
 	}
+	corpses.insert(corpses.end(), expired_corpses.begin(), expired_corpses.end());
+	for (size_t i=0; i < corpses.size(); i++) {
+		anim->decreaseCount(corpses[i]->animationSet->getName());
+		corpses[i]->unloadSounds();
+		delete corpses[i];
+	}
 	for (unsigned int i=0; i < prototypes.size(); i++) {
 		anim->decreaseCount(prototypes[i].animationSet->getName());
 		prototypes[i].unloadSounds();
@@ -30,12 +30,29 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Enemy.h"
 #include "Utils.h"
 #include "CampaignManager.h"
+#include "Map.h"
+
+// map enemies further than this from the hero are created over the frames after the map was loaded
+const float ENEMY_POPULATE_DISTANCE = 16.0f;
+
+// the number of far map enemies created each frame
+const size_t ENEMY_POPULATE_PER_FRAME = 16;
+
+// the size in tiles of the map areas the waiting enemies of maps with a populate_range are kept in
+const int ENEMY_CHUNK_SIZE = 16;
+
+// the party formation turns with the hero once the hero has walked this far
+const float PARTY_TURN_DISTANCE = 1.5f;
 
 class EnemyManager {
 private:
 
 	void loadAnimations(Enemy *e);
 
+	// loads the sprite-sheets and sounds of the enemies within ENEMY_LOAD_DISTANCE of center
+	// Without wait, enemies whose sprite-sheet is still being decoded are left for a later call.
+	void loadNearbyResources(const FPoint& center, bool wait);
+
 	std::vector<std::string> anim_prefixes;
 	std::vector<std::vector<Animation*> > anim_entities;
 
@@ -45,8 +62,47 @@ private:
 	Enemy *getEnemyPrototype(const std::string& type_id);
 	size_t loadEnemyPrototype(const std::string& type_id);
 
+	std::map<std::string, EnemyDefinition> definitions;
+
 	std::vector<Enemy> prototypes;
 
+	// creates the enemy of a map enemy definition
+	void populateEnemy(const Map_Enemy& me);
+
+	// far map enemies that haven't been created yet, the nearest one last
+	std::vector<Map_Enemy> pending_enemies;
+
+	// map enemies outside the map's populate_range, by the chunk they are in
+	// They move to pending_enemies once the hero comes within range of their chunk.
+	std::map<std::pair<int, int>, std::vector<Map_Enemy> > waiting_enemies;
+	Point waiting_check_chunk;
+	void wakeNearbyEnemies(bool force);
+
+	// results of EntityGrid queries
+	std::vector<Entity*> nearby;
+
+	// results of PickBuffer queries
+	std::vector<Entity*> picked;
+
+	// enemies that are dead and done animating, oldest first
+	// They are kept apart from enemies, so that the loops over the living ones don't need to skip them.
+	std::vector<Enemy*> corpses;
+
+	// corpses that have disappeared; other objects may still point to them, so they are only deleted with the map
+	std::vector<Enemy*> expired_corpses;
+
+	void moveCorpses();
+	void updateCorpses();
+	void addRender(Enemy *e, std::vector<Renderable> &r, std::vector<Renderable> &r_dead);
+	void deleteEnemy(Enemy *e);
+
+	std::vector<FPoint> los_sources;
+
+	// gives each ally that follows the hero one of the party_slots
+	void updateParty();
+	FPoint party_anchor;
+	int party_direction;
+
 public:
 	EnemyManager();
 	~EnemyManager();
@@ -61,12 +117,30 @@ public:
 	Enemy *enemyFocus(const Point& mouse, const FPoint& cam, bool alive_only);
 	Enemy* getNearestEnemy(const FPoint& pos, bool get_corpse = false, float *saved_distance = NULL);
 
+	// enemy files are parsed once per game, instead of once per map and spawn
+	const EnemyDefinition* getEnemyDefinition(const std::string& type_id);
+
+	// parses an enemy file again, for changes made while the game runs; returns false if it wasn't loaded
+	bool reloadDefinition(const std::string& type_id);
+	void getDefinitionTypes(std::vector<std::string>& types) const;
+
+	// loads the creatures that powers can summon or transform into
+	void loadPowerCreatures(int power_index);
+	void loadPowerCreatures(const std::vector<int>& power_list);
+
 	// vars
-	std::vector<Enemy*> enemies;
+	std::vector<Enemy*> enemies; // living and dying enemies; corpses are kept separately
+
 	int hero_stealth;
 
 	bool player_blocked;
 	int player_blocked_ticks;
+
+	// hostile creatures that were in combat at the start of this frame
+	size_t hostiles_in_combat;
+
+	// the places behind the hero that the allies walk to when they aren't fighting, see Enemy::party_slot
+	std::vector<FPoint> party_slots;
 };
 
 
@@ -43,6 +43,41 @@ const int directionDeltaX[8] =   {-1, -1, -1,  0,  1,  1,  1,  0};
 const int directionDeltaY[8] =   { 1,  0, -1, -1, -1,  0,  1,  1};
 const float speedMultiplyer[8] = { static_cast<float>(1.0/M_SQRT2), 1.0f, static_cast<float>(1.0/M_SQRT2), 1.0f, static_cast<float>(1.0/M_SQRT2), 1.0f, static_cast<float>(1.0/M_SQRT2), 1.0f};
 
+const StringHandle ANIM_STANCE = internString("stance");
+const StringHandle ANIM_RUN = internString("run");
+const StringHandle ANIM_SPAWN = internString("spawn");
+const StringHandle ANIM_BLOCK = internString("block");
+const StringHandle ANIM_HIT = internString("hit");
+const StringHandle ANIM_DIE = internString("die");
+const StringHandle ANIM_CRITDIE = internString("critdie");
+
+/**
+ * Runtime indices of destroyed entities, handed out again before new ones are
+ * created, so that the indices stay compact.
+ */
+static std::vector<unsigned>& getFreeRuntimeIndices() {
+	static std::vector<unsigned> free_indices;
+	return free_indices;
+}
+
+// indices of entities destroyed since the last recycleRuntimeIndices()
+static std::vector<unsigned>& getReleasedIndices() {
+	static std::vector<unsigned> released_indices;
+	return released_indices;
+}
+
+static unsigned acquireRuntimeIndex() {
+	static unsigned next_index = 0;
+
+	std::vector<unsigned>& free_indices = getFreeRuntimeIndices();
+	if (free_indices.empty())
+		return next_index++;
+
+	unsigned index = free_indices.back();
+	free_indices.pop_back();
+	return index;
+}
+
 Entity::Entity()
 	: sprites(NULL)
 	, sound_attack()
@@ -52,7 +87,11 @@ Entity::Entity()
 	, sound_block(0)
 	, sound_levelup(0)
 	, activeAnimation(NULL)
-	, animationSet(NULL) {
+	, animationSet(NULL)
+	, animation_states()
+	, grid_cell(-1)
+	, grid_faction(0)
+	, runtime_index(acquireRuntimeIndex()) {
 }
 
 Entity::Entity(const Entity &e)
@@ -63,9 +102,14 @@ Entity::Entity(const Entity &e)
 	, sound_critdie(e.sound_critdie)
 	, sound_block(e.sound_block)
 	, sound_levelup(e.sound_levelup)
-	, activeAnimation(new Animation(*e.activeAnimation))
+	, activeAnimation(NULL)
 	, animationSet(e.animationSet)
-	, stats(StatBlock(e.stats)) {
+	, animation_states(e.animation_states)
+	, stats(StatBlock(e.stats))
+	, grid_cell(-1)
+	, grid_faction(0)
+	, runtime_index(acquireRuntimeIndex()) {
+	activeAnimation = animation_states.getActive();
 }
 
 void Entity::loadSounds(StatBlock *src_stats) {
@@ -179,6 +223,7 @@ bool Entity::move() {
 	float dy = speed * static_cast<float>(directionDeltaY[stats.direction]);
 
 	bool full_move = mapr->collider.move(stats.pos.x, stats.pos.y, dx, dy, stats.movement_type, stats.hero);
+	mapr->entity_grid.update(this);
 
 	return full_move;
 }
@@ -189,14 +234,93 @@ bool Entity::move() {
  *
  * Returns false on miss
  */
+HitContext::HitContext()
+	: haz(NULL)
+	, power(NULL)
+	, accuracy(0)
+	, crit_chance(0)
+	, hp_steal(0)
+	, mp_steal(0)
+	, perfect_accuracy(false)
+	, miss_text("")
+	, hp_stolen(0)
+	, mp_stolen(0)
+	, dmg_returned(0) {
+}
+
+void HitContext::set(Hazard *_haz) {
+	haz = _haz;
+	power = &powers->powers[haz->power_index];
+
+	accuracy = haz->accuracy;
+	if (power->mod_accuracy_mode == STAT_MODIFIER_MODE_MULTIPLY)
+		accuracy = (accuracy * power->mod_accuracy_value) / 100;
+	else if (power->mod_accuracy_mode == STAT_MODIFIER_MODE_ADD)
+		accuracy += power->mod_accuracy_value;
+	else if (power->mod_accuracy_mode == STAT_MODIFIER_MODE_ABSOLUTE)
+		accuracy = power->mod_accuracy_value;
+
+	crit_chance = haz->crit_chance;
+	if (power->mod_crit_mode == STAT_MODIFIER_MODE_MULTIPLY)
+		crit_chance = crit_chance * power->mod_crit_value / 100;
+	else if (power->mod_crit_mode == STAT_MODIFIER_MODE_ADD)
+		crit_chance += power->mod_crit_value;
+	else if (power->mod_crit_mode == STAT_MODIFIER_MODE_ABSOLUTE)
+		crit_chance = power->mod_crit_value;
+
+	hp_steal = haz->hp_steal + haz->src_stats->get(STAT_HP_STEAL);
+	mp_steal = haz->mp_steal + haz->src_stats->get(STAT_MP_STEAL);
+	perfect_accuracy = haz->src_stats->perfect_accuracy;
+
+	if (miss_text.empty())
+		miss_text = msg->get("miss");
+
+	hp_stolen = 0;
+	mp_stolen = 0;
+	dmg_returned = 0;
+}
+
+/**
+ * Shows the combined combat text for the caster
+ */
+void HitContext::finish() {
+	if (!haz)
+		return;
+
+	if (hp_stolen != 0)
+		comb->addString(msg->get("+%d HP", hp_stolen), haz->src_stats->pos, COMBAT_MESSAGE_BUFF);
+	if (mp_stolen != 0)
+		comb->addString(msg->get("+%d MP", mp_stolen), haz->src_stats->pos, COMBAT_MESSAGE_BUFF);
+	if (dmg_returned != 0)
+		comb->addInt(dmg_returned, haz->src_stats->pos, COMBAT_MESSAGE_GIVEDMG);
+
+	hp_stolen = 0;
+	mp_stolen = 0;
+	dmg_returned = 0;
+}
+
 bool Entity::takeHit(Hazard &h) {
+	HitContext hit;
+	hit.set(&h);
+	bool result = takeHit(hit);
+	hit.finish();
+	return result;
+}
+
+/**
+ * Applies one hit of hit.haz to this entity. Used directly by HazardManager when a
+ * hazard can hit several entities, so the terms in HitContext are only worked out once.
+ */
+bool Entity::takeHit(HitContext &hit) {
+	Hazard &h = *hit.haz;
+	const Power &power = *hit.power;
 
 	//check if this enemy should be affected by this hazard based on the category
-	if(!powers->powers[h.power_index].target_categories.empty() && !stats.hero) {
+	if(!power.target_categories.empty() && !stats.hero) {
 		//the power has a target category requirement, so if it doesnt match, dont continue
 		bool match_found = false;
 		for (unsigned int i=0; i<stats.categories.size(); i++) {
-			if(std::find(powers->powers[h.power_index].target_categories.begin(), powers->powers[h.power_index].target_categories.end(), stats.categories[i]) != powers->powers[h.power_index].target_categories.end()) {
+			if(std::find(power.target_categories.begin(), power.target_categories.end(), stats.categories[i]) != power.target_categories.end()) {
 				match_found = true;
 			}
 		}
@@ -238,12 +362,12 @@ bool Entity::takeHit(Hazard &h) {
 	}
 
 	// exit if it was a beacon (to prevent stats.targeted from being set)
-	if (powers->powers[h.power_index].beacon) return false;
+	if (power.beacon) return false;
 
 	// prepare the combat text
 	CombatText *combat_text = comb;
 
-	if (h.missile && percentChance(stats.get(STAT_REFLECT))) {
+	if (h.missile && percentChance(stats.get(STAT_REFLECT), RANDOM_COMBAT)) {
 		// reflect the missile 180 degrees
 		h.setAngle(h.angle+static_cast<float>(M_PI));
 
@@ -257,7 +381,7 @@ bool Entity::takeHit(Hazard &h) {
 		// reset the hazard ticks
 		h.lifespan = h.base_lifespan;
 
-		if (activeAnimation->getName() == "block") {
+		if (activeAnimation->getNameHandle() == ANIM_BLOCK) {
 			snd->play(sound_block);
 		}
 
@@ -265,37 +389,29 @@ bool Entity::takeHit(Hazard &h) {
 	}
 
 	// if it's a miss, do nothing
-	int accuracy = h.accuracy;
-	if(powers->powers[h.power_index].mod_accuracy_mode == STAT_MODIFIER_MODE_MULTIPLY)
-		accuracy = (accuracy * powers->powers[h.power_index].mod_accuracy_value) / 100;
-	else if(powers->powers[h.power_index].mod_accuracy_mode == STAT_MODIFIER_MODE_ADD)
-		accuracy += powers->powers[h.power_index].mod_accuracy_value;
-	else if(powers->powers[h.power_index].mod_accuracy_mode == STAT_MODIFIER_MODE_ABSOLUTE)
-		accuracy = powers->powers[h.power_index].mod_accuracy_value;
-
 	int avoidance = 0;
-	if(!powers->powers[h.power_index].trait_avoidance_ignore) {
+	if(!power.trait_avoidance_ignore) {
 		avoidance = stats.get(STAT_AVOIDANCE);
 	}
 
-	int true_avoidance = 100 - (accuracy - avoidance);
-	bool is_overhit = (true_avoidance < 0 && !h.src_stats->perfect_accuracy) ? percentChance(abs(true_avoidance)) : false;
+	int true_avoidance = 100 - (hit.accuracy - avoidance);
+	bool is_overhit = (true_avoidance < 0 && !hit.perfect_accuracy) ? percentChance(abs(true_avoidance), RANDOM_COMBAT) : false;
 	true_avoidance = std::min(std::max(true_avoidance, MIN_AVOIDANCE), MAX_AVOIDANCE);
 
 	bool missed = false;
-	if (!h.src_stats->perfect_accuracy && percentChance(true_avoidance)) {
+	if (!hit.perfect_accuracy && percentChance(true_avoidance, RANDOM_COMBAT)) {
 		missed = true;
 	}
 
 	// calculate base damage
-	int dmg = randBetween(h.dmg_min, h.dmg_max);
+	int dmg = randBetween(h.dmg_min, h.dmg_max, RANDOM_COMBAT);
 
-	if(powers->powers[h.power_index].mod_damage_mode == STAT_MODIFIER_MODE_MULTIPLY)
-		dmg = dmg * powers->powers[h.power_index].mod_damage_value_min / 100;
-	else if(powers->powers[h.power_index].mod_damage_mode == STAT_MODIFIER_MODE_ADD)
-		dmg += powers->powers[h.power_index].mod_damage_value_min;
-	else if(powers->powers[h.power_index].mod_damage_mode == STAT_MODIFIER_MODE_ABSOLUTE)
-		dmg = randBetween(powers->powers[h.power_index].mod_damage_value_min, powers->powers[h.power_index].mod_damage_value_max);
+	if(power.mod_damage_mode == STAT_MODIFIER_MODE_MULTIPLY)
+		dmg = dmg * power.mod_damage_value_min / 100;
+	else if(power.mod_damage_mode == STAT_MODIFIER_MODE_ADD)
+		dmg += power.mod_damage_value_min;
+	else if(power.mod_damage_mode == STAT_MODIFIER_MODE_ABSOLUTE)
+		dmg = randBetween(power.mod_damage_value_min, power.mod_damage_value_max, RANDOM_COMBAT);
 
 	// apply elemental resistance
 	if (h.trait_elemental >= 0 && unsigned(h.trait_elemental) < stats.vulnerable.size()) {
@@ -310,7 +426,7 @@ bool Entity::takeHit(Hazard &h) {
 
 	if (!h.trait_armor_penetration) { // armor penetration ignores all absorption
 		// subtract absorption from armor
-		int absorption = randBetween(stats.get(STAT_ABS_MIN), stats.get(STAT_ABS_MAX));
+		int absorption = randBetween(stats.get(STAT_ABS_MIN), stats.get(STAT_ABS_MAX), RANDOM_COMBAT);
 
 		if (absorption > 0 && dmg > 0) {
 			int abs = absorption;
@@ -336,7 +452,7 @@ bool Entity::takeHit(Hazard &h) {
 		dmg = dmg - absorption;
 		if (dmg <= 0) {
 			dmg = 0;
-			if (!powers->powers[h.power_index].ignore_zero_damage) {
+			if (!power.ignore_zero_damage) {
 				if (h.trait_elemental < 0) {
 					if (stats.effects.triggered_block && MAX_BLOCK < 100) dmg = 1;
 					else if (!stats.effects.triggered_block && MAX_ABSORB < 100) dmg = 1;
@@ -344,7 +460,7 @@ bool Entity::takeHit(Hazard &h) {
 				else {
 					if (MAX_RESIST < 100) dmg = 1;
 				}
-				if (activeAnimation->getName() == "block") {
+				if (activeAnimation->getNameHandle() == ANIM_BLOCK) {
 					snd->play(sound_block);
 					resetActiveAnimation();
 				}
@@ -353,38 +469,31 @@ bool Entity::takeHit(Hazard &h) {
 	}
 
 	// check for crits
-	int true_crit_chance = h.crit_chance;
-
-	if(powers->powers[h.power_index].mod_crit_mode == STAT_MODIFIER_MODE_MULTIPLY)
-		true_crit_chance = true_crit_chance * powers->powers[h.power_index].mod_crit_value / 100;
-	else if(powers->powers[h.power_index].mod_crit_mode == STAT_MODIFIER_MODE_ADD)
-		true_crit_chance += powers->powers[h.power_index].mod_crit_value;
-	else if(powers->powers[h.power_index].mod_crit_mode == STAT_MODIFIER_MODE_ABSOLUTE)
-		true_crit_chance = powers->powers[h.power_index].mod_crit_value;
+	int true_crit_chance = hit.crit_chance;
 
 	if (stats.effects.stun || stats.effects.speed < 100)
 		true_crit_chance += h.trait_crits_impaired;
 
-	bool crit = percentChance(true_crit_chance);
+	bool crit = percentChance(true_crit_chance, RANDOM_COMBAT);
 	if (crit) {
 		// default is dmg * 2
-		dmg = (dmg * randBetween(MIN_CRIT_DAMAGE, MAX_CRIT_DAMAGE)) / 100;
+		dmg = (dmg * randBetween(MIN_CRIT_DAMAGE, MAX_CRIT_DAMAGE, RANDOM_COMBAT)) / 100;
 		if(!stats.hero)
 			mapr->shaky_cam_ticks = MAX_FRAMES_PER_SEC/2;
 	}
 	else if (is_overhit) {
-		dmg = (dmg * randBetween(MIN_OVERHIT_DAMAGE, MAX_OVERHIT_DAMAGE)) / 100;
+		dmg = (dmg * randBetween(MIN_OVERHIT_DAMAGE, MAX_OVERHIT_DAMAGE, RANDOM_COMBAT)) / 100;
 		// Should we use shakycam for overhits?
 	}
 
 	// misses cause reduced damage
 	if (missed) {
-		dmg = (dmg * randBetween(MIN_MISS_DAMAGE, MAX_MISS_DAMAGE)) / 100;
+		dmg = (dmg * randBetween(MIN_MISS_DAMAGE, MAX_MISS_DAMAGE, RANDOM_COMBAT)) / 100;
 	}
 
-	if (!powers->powers[h.power_index].ignore_zero_damage) {
+	if (!power.ignore_zero_damage) {
 		if (dmg == 0) {
-			combat_text->addString(msg->get("miss"), stats.pos, COMBAT_MESSAGE_MISS);
+			combat_text->addString(hit.miss_text, stats.pos, COMBAT_MESSAGE_MISS);
 			return false;
 		}
 		else if(stats.hero)
@@ -409,7 +518,7 @@ bool Entity::takeHit(Hazard &h) {
 	stats.takeDamage(dmg);
 
 	// after effects
-	if (dmg > 0 || powers->powers[h.power_index].ignore_zero_damage) {
+	if (dmg > 0 || power.ignore_zero_damage) {
 
 		// damage always breaks stun
 		stats.effects.removeEffectType(EFFECT_STUN);
@@ -420,18 +529,16 @@ bool Entity::takeHit(Hazard &h) {
 
 		// HP/MP steal is cumulative between stat bonus and power bonus
 		// TODO should hp_steal and mp_steal be capped at 100?
-		int hp_steal = h.hp_steal + h.src_stats->get(STAT_HP_STEAL);
-		if (!stats.effects.immunity_hp_steal && hp_steal != 0) {
-			int steal_amt = (std::min(dmg, prev_hp) * hp_steal) / 100;
+		if (!stats.effects.immunity_hp_steal && hit.hp_steal != 0) {
+			int steal_amt = (std::min(dmg, prev_hp) * hit.hp_steal) / 100;
 			if (steal_amt == 0) steal_amt = 1;
-			combat_text->addString(msg->get("+%d HP",steal_amt), h.src_stats->pos, COMBAT_MESSAGE_BUFF);
+			hit.hp_stolen += steal_amt;
 			h.src_stats->hp = std::min(h.src_stats->hp + steal_amt, h.src_stats->get(STAT_HP_MAX));
 		}
-		int mp_steal = h.mp_steal + h.src_stats->get(STAT_MP_STEAL);
-		if (!stats.effects.immunity_mp_steal && mp_steal != 0) {
-			int steal_amt = (std::min(dmg, prev_hp) * mp_steal) / 100;
+		if (!stats.effects.immunity_mp_steal && hit.mp_steal != 0) {
+			int steal_amt = (std::min(dmg, prev_hp) * hit.mp_steal) / 100;
 			if (steal_amt == 0) steal_amt = 1;
-			combat_text->addString(msg->get("+%d MP",steal_amt), h.src_stats->pos, COMBAT_MESSAGE_BUFF);
+			hit.mp_stolen += steal_amt;
 			h.src_stats->mp = std::min(h.src_stats->mp + steal_amt, h.src_stats->get(STAT_MP_MAX));
 		}
 
@@ -443,23 +550,23 @@ bool Entity::takeHit(Hazard &h) {
 				dmg_return = 1;
 
 			h.src_stats->takeDamage(dmg_return);
-			comb->addInt(dmg_return, h.src_stats->pos, COMBAT_MESSAGE_GIVEDMG);
+			hit.dmg_returned += dmg_return;
 		}
 	}
 
-	if (dmg > 0 || powers->powers[h.power_index].ignore_zero_damage) {
+	if (dmg > 0 || power.ignore_zero_damage) {
 		// remove effect by ID
-		stats.effects.removeEffectID(powers->powers[h.power_index].remove_effects);
+		stats.effects.removeEffectID(power.remove_effects);
 
 		// post power
-		if (h.post_power > 0 && percentChance(h.post_power_chance)) {
+		if (h.post_power > 0 && percentChance(h.post_power_chance, RANDOM_COMBAT)) {
 			powers->activate(h.post_power, h.src_stats, stats.pos);
 		}
 	}
 
 	// interrupted to new state
 	if (dmg > 0) {
-		bool chance_poise = percentChance(stats.get(STAT_POISE));
+		bool chance_poise = percentChance(stats.get(STAT_POISE), RANDOM_COMBAT);
 
 		if(stats.hp <= 0) {
 			stats.effects.triggered_death = true;
@@ -534,21 +641,40 @@ void Entity::resetActiveAnimation() {
  * Set the entity's current animation by name
  */
 bool Entity::setAnimation(const std::string& animationName) {
+	return setAnimation(internString(animationName));
+}
+
+bool Entity::setAnimation(StringHandle animationName) {
 
 	// if the animation is already the requested one do nothing
-	if (activeAnimation != NULL && activeAnimation->getName() == animationName)
+	if (activeAnimation != NULL && activeAnimation->getNameHandle() == animationName)
 		return true;
 
-	delete activeAnimation;
-	activeAnimation = animationSet->getAnimation(animationName);
+	activeAnimation = animation_states.play(animationName);
 
 	if (activeAnimation == NULL)
-		logError("Entity::setAnimation(%s): not found", animationName.c_str());
+		logError("Entity::setAnimation(%s): not found", getInternedString(animationName).c_str());
 
 	return activeAnimation == NULL;
 }
 
+void Entity::setAnimationSet(AnimationSet *set) {
+	animationSet = set;
+	activeAnimation = animation_states.setAnimationSet(set);
+}
+
 Entity::~Entity () {
-	delete activeAnimation;
+	getReleasedIndices().push_back(runtime_index);
+}
+
+const std::vector<unsigned>& Entity::getReleasedRuntimeIndices() {
+	return getReleasedIndices();
+}
+
+void Entity::recycleRuntimeIndices() {
+	std::vector<unsigned>& released = getReleasedIndices();
+	std::vector<unsigned>& free_indices = getFreeRuntimeIndices();
+	free_indices.insert(free_indices.end(), released.begin(), released.end());
+	released.clear();
 }
 
@@ -27,12 +27,41 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #ifndef ENTITY_H
 #define ENTITY_H
 
+#include "AnimationSet.h"
 #include "CommonIncludes.h"
 #include "SoundManager.h"
 #include "StatBlock.h"
 
 class Animation;
-class AnimationSet;
+class Hazard;
+class Power;
+
+/**
+ * The parts of a hit that only depend on the hazard, worked out once for all the
+ * entities it hits in a frame. The HP/MP that is stolen and the damage that is
+ * returned to the caster add up over those hits and are shown as one combat text
+ * each by finish().
+ */
+class HitContext {
+public:
+	HitContext();
+	void set(Hazard *_haz);
+	void finish();
+
+	Hazard *haz;
+	const Power *power;
+
+	int accuracy;
+	int crit_chance;
+	int hp_steal;
+	int mp_steal;
+	bool perfect_accuracy;
+	std::string miss_text;
+
+	int hp_stolen;
+	int mp_stolen;
+	int dmg_returned;
+};
 
 class Entity {
 protected:
@@ -51,6 +80,7 @@ public:
 	void playAttackSound(const std::string& attack_name);
 	bool move();
 	bool takeHit(Hazard &h);
+	bool takeHit(HitContext &hit);
 	virtual void doRewards(int) {}
 
 	// sound effects
@@ -62,15 +92,42 @@ public:
 	SoundManager::SoundID sound_levelup;
 
 	bool setAnimation(const std::string& animation);
-	Animation *activeAnimation;
+	bool setAnimation(StringHandle animation);
+
+	// switches to another animation set, starting on its default animation
+	void setAnimationSet(AnimationSet *set);
+
+	Animation *activeAnimation; // owned by animation_states
 	AnimationSet *animationSet;
+	AnimationStates animation_states;
 
 	StatBlock stats;
+
+	// index of the EntityGrid cell that holds this entity, -1 if it isn't in the grid
+	int grid_cell;
+	int grid_faction;
+
+	// a small number that is unique among the living entities, used by hazards to track hits
+	const unsigned runtime_index;
+
+	// The indices of destroyed entities aren't handed out again until recycleRuntimeIndices() is called,
+	// so that HazardManager can first forget which of them its hazards have hit.
+	static const std::vector<unsigned>& getReleasedRuntimeIndices();
+	static void recycleRuntimeIndices();
 };
 
 extern const int directionDeltaX[];
 extern const int directionDeltaY[];
 extern const float speedMultiplyer[];
 
+// interned names of the animations used by the engine itself
+extern const StringHandle ANIM_STANCE;
+extern const StringHandle ANIM_RUN;
+extern const StringHandle ANIM_SPAWN;
+extern const StringHandle ANIM_BLOCK;
+extern const StringHandle ANIM_HIT;
+extern const StringHandle ANIM_DIE;
+extern const StringHandle ANIM_CRITDIE;
+
 #endif
 
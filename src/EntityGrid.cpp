@@ -0,0 +1,176 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "EntityGrid.h"
+#include "Entity.h"
+
+EntityGrid::EntityGrid()
+	: cell_count(1, 1) {
+	for (int i = 0; i < ENTITY_FACTION_COUNT; ++i)
+		cells[i].resize(1);
+}
+
+EntityGrid::~EntityGrid() {
+}
+
+/**
+ * Positions outside of the map are clamped to the nearest border cell
+ */
+int EntityGrid::getCell(const FPoint& pos) const {
+	int x = std::max(0, std::min(static_cast<int>(pos.x) / ENTITY_GRID_CELL_SIZE, cell_count.x - 1));
+	int y = std::max(0, std::min(static_cast<int>(pos.y) / ENTITY_GRID_CELL_SIZE, cell_count.y - 1));
+	return y * cell_count.x + x;
+}
+
+void EntityGrid::getCellRange(const FPoint& pos, float radius, Point& first, Point& last) const {
+	first.x = std::max(0, static_cast<int>(pos.x - radius) / ENTITY_GRID_CELL_SIZE);
+	first.y = std::max(0, static_cast<int>(pos.y - radius) / ENTITY_GRID_CELL_SIZE);
+	last.x = std::min(cell_count.x - 1, static_cast<int>(pos.x + radius) / ENTITY_GRID_CELL_SIZE);
+	last.y = std::min(cell_count.y - 1, static_cast<int>(pos.y + radius) / ENTITY_GRID_CELL_SIZE);
+}
+
+void EntityGrid::reset(const Point& map_size) {
+	cell_count.x = std::max(1, (map_size.x + ENTITY_GRID_CELL_SIZE - 1) / ENTITY_GRID_CELL_SIZE);
+	cell_count.y = std::max(1, (map_size.y + ENTITY_GRID_CELL_SIZE - 1) / ENTITY_GRID_CELL_SIZE);
+
+	for (int i = 0; i < ENTITY_FACTION_COUNT; ++i) {
+		cells[i].clear();
+		cells[i].resize(cell_count.x * cell_count.y);
+	}
+}
+
+int EntityGrid::getFaction(const Entity *e) {
+	if (e->stats.corpse)
+		return ENTITY_FACTION_CORPSE;
+	else if (e->stats.hero_ally)
+		return ENTITY_FACTION_ALLY;
+	return ENTITY_FACTION_HOSTILE;
+}
+
+void EntityGrid::add(Entity *e) {
+	if (!e)
+		return;
+
+	e->grid_cell = getCell(e->stats.pos);
+	e->grid_faction = getFaction(e);
+	cells[e->grid_faction][e->grid_cell].push_back(e);
+}
+
+void EntityGrid::remove(Entity *e) {
+	if (!e || e->grid_cell < 0 || static_cast<size_t>(e->grid_cell) >= cells[e->grid_faction].size())
+		return;
+
+	// the entity may have been added before the grid was last reset
+	std::vector<Entity*> &cell = cells[e->grid_faction][e->grid_cell];
+	for (size_t i = 0; i < cell.size(); ++i) {
+		if (cell[i] == e) {
+			cell[i] = cell.back();
+			cell.pop_back();
+			break;
+		}
+	}
+
+	e->grid_cell = -1;
+}
+
+void EntityGrid::update(Entity *e) {
+	if (!e || e->grid_cell < 0)
+		return;
+
+	int cell = getCell(e->stats.pos);
+	int faction = getFaction(e);
+	if (cell == e->grid_cell && faction == e->grid_faction)
+		return;
+
+	remove(e);
+	e->grid_cell = cell;
+	e->grid_faction = faction;
+	cells[faction][cell].push_back(e);
+}
+
+void EntityGrid::query(const FPoint& pos, float radius, std::vector<Entity*>& result, int faction_mask) const {
+	result.clear();
+
+	Point first, last;
+	getCellRange(pos, radius, first, last);
+
+	for (int y = first.y; y <= last.y; ++y) {
+		for (int x = first.x; x <= last.x; ++x) {
+			for (int i = 0; i < ENTITY_FACTION_COUNT; ++i) {
+				if (!(faction_mask & (1 << i)))
+					continue;
+
+				const std::vector<Entity*> &cell = cells[i][y * cell_count.x + x];
+				result.insert(result.end(), cell.begin(), cell.end());
+			}
+		}
+	}
+}
+
+static bool compareNearest(const std::pair<float, Entity*>& a, const std::pair<float, Entity*>& b) {
+	return a.first < b.first;
+}
+
+void EntityGrid::getNearest(const FPoint& pos, float max_radius, int faction_mask, size_t k, std::vector<Entity*>& result, EntityFilter filter) {
+	getNearest(pos, max_radius, faction_mask, k, result, nearest_buf, filter);
+}
+
+void EntityGrid::getNearest(const FPoint& pos, float max_radius, int faction_mask, size_t k, std::vector<Entity*>& result, std::vector<std::pair<float, Entity*> >& buf, EntityFilter filter) const {
+	result.clear();
+	if (k == 0 || max_radius < 0)
+		return;
+
+	float radius = std::min(max_radius, static_cast<float>(ENTITY_GRID_CELL_SIZE));
+
+	while (true) {
+		buf.clear();
+
+		Point first, last;
+		getCellRange(pos, radius, first, last);
+
+		for (int y = first.y; y <= last.y; ++y) {
+			for (int x = first.x; x <= last.x; ++x) {
+				for (int i = 0; i < ENTITY_FACTION_COUNT; ++i) {
+					if (!(faction_mask & (1 << i)))
+						continue;
+
+					const std::vector<Entity*> &cell = cells[i][y * cell_count.x + x];
+					for (size_t j = 0; j < cell.size(); ++j) {
+						if (filter && !filter(cell[j]))
+							continue;
+
+						// only entities inside the circle are certain to be nearer than the ones outside of it
+						float dist = calcDist(pos, cell[j]->stats.pos);
+						if (dist <= radius)
+							buf.push_back(std::pair<float, Entity*>(dist, cell[j]));
+					}
+				}
+			}
+		}
+
+		if (buf.size() >= k || radius >= max_radius)
+			break;
+
+		radius = std::min(radius * 2, max_radius);
+	}
+
+	size_t count = std::min(k, buf.size());
+	std::partial_sort(buf.begin(), buf.begin() + count, buf.end(), compareNearest);
+
+	for (size_t i = 0; i < count; ++i)
+		result.push_back(buf[i].second);
+}
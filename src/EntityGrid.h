@@ -0,0 +1,91 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class EntityGrid
+ *
+ * A uniform grid of map cells, used as a broadphase for entity queries.
+ * Instead of checking every entity on the map, queries only look at the
+ * entities in the cells that overlap the search area.
+ *
+ * Each faction has its own cells, so that targeting queries only look
+ * at the entities they could pick.
+ */
+
+#ifndef ENTITY_GRID_H
+#define ENTITY_GRID_H
+
+#include "CommonIncludes.h"
+#include "Utils.h"
+
+class Entity;
+
+// width and height of a grid cell, in map tiles
+const int ENTITY_GRID_CELL_SIZE = 4;
+
+const int ENTITY_FACTION_HOSTILE = 0;
+const int ENTITY_FACTION_ALLY = 1; // allies of the hero
+const int ENTITY_FACTION_CORPSE = 2;
+const int ENTITY_FACTION_COUNT = 3;
+
+// bit masks of the factions, used to select which factions a query looks at
+const int ENTITY_MASK_HOSTILE = 1 << ENTITY_FACTION_HOSTILE;
+const int ENTITY_MASK_ALLY = 1 << ENTITY_FACTION_ALLY;
+const int ENTITY_MASK_CORPSE = 1 << ENTITY_FACTION_CORPSE;
+const int ENTITY_MASK_ALL = (1 << ENTITY_FACTION_COUNT) - 1;
+
+// returns false for entities a query should skip
+typedef bool (*EntityFilter)(const Entity *e);
+
+class EntityGrid {
+private:
+	int getCell(const FPoint& pos) const;
+	void getCellRange(const FPoint& pos, float radius, Point& first, Point& last) const;
+
+	Point cell_count;
+	std::vector<std::vector<Entity*> > cells[ENTITY_FACTION_COUNT];
+
+	std::vector<std::pair<float, Entity*> > nearest_buf;
+
+public:
+	EntityGrid();
+	~EntityGrid();
+
+	// removes all entities and resizes the grid for a new map
+	void reset(const Point& map_size);
+
+	void add(Entity *e);
+	void remove(Entity *e);
+
+	// moves the entity to the cell of its current position and faction
+	void update(Entity *e);
+
+	static int getFaction(const Entity *e);
+
+	// gets all the entities in the cells overlapping the circle
+	// results may include entities outside the radius, so callers should still check the distance
+	void query(const FPoint& pos, float radius, std::vector<Entity*>& result, int faction_mask = ENTITY_MASK_ALL) const;
+
+	// gets up to k entities within max_radius of pos, nearest first
+	// The search starts in the cells around pos and only grows while fewer than k entities were found.
+	void getNearest(const FPoint& pos, float max_radius, int faction_mask, size_t k, std::vector<Entity*>& result, EntityFilter filter = NULL);
+
+	// the same, with a scratch buffer of the caller's, so that several threads can query at once
+	void getNearest(const FPoint& pos, float max_radius, int faction_mask, size_t k, std::vector<Entity*>& result, std::vector<std::pair<float, Entity*> >& buf, EntityFilter filter = NULL) const;
+};
+
+#endif // ENTITY_GRID_H
@@ -0,0 +1,66 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "EntityRegistry.h"
+#include "Entity.h"
+
+EntityRegistry::EntityRegistry() {
+}
+
+EntityRegistry::~EntityRegistry() {
+}
+
+void EntityRegistry::add(Entity *e, unsigned char kind) {
+	if (!e)
+		return;
+
+	const size_t index = e->runtime_index;
+	if (index >= entities.size()) {
+		entities.resize(index + 1, NULL);
+		pos.resize(index + 1);
+		threat_range.resize(index + 1, 0);
+		flags.resize(index + 1, 0);
+	}
+
+	entities[index] = e;
+	flags[index] = kind;
+	update(e);
+}
+
+void EntityRegistry::remove(Entity *e) {
+	if (!e || e->runtime_index >= entities.size() || entities[e->runtime_index] != e)
+		return;
+
+	entities[e->runtime_index] = NULL;
+	flags[e->runtime_index] = 0;
+}
+
+void EntityRegistry::update(const Entity *e) {
+	const size_t index = e->runtime_index;
+	if (index >= entities.size() || entities[index] != e)
+		return;
+
+	unsigned char f = flags[index] & (ENTITY_IS_ENEMY | ENTITY_IS_NPC);
+	if (e->stats.alive) f |= ENTITY_ALIVE;
+	if (e->stats.corpse) f |= ENTITY_CORPSE;
+	if (e->stats.hero_ally) f |= ENTITY_HERO_ALLY;
+	if (e->stats.in_combat) f |= ENTITY_IN_COMBAT;
+
+	flags[index] = f;
+	pos[index] = e->stats.pos;
+	threat_range[index] = e->stats.threat_range;
+}
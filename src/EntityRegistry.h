@@ -0,0 +1,67 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class EntityRegistry
+ *
+ * Keeps the few fields of enemies and NPCs that the loops over all of them
+ * look at in parallel arrays, indexed by Entity::runtime_index. Those loops
+ * read the compact arrays, instead of pulling every entity and its StatBlock
+ * into the cache.
+ *
+ * The arrays are copies of the entity's own fields. They are updated after
+ * each enemy's logic and after each hit, so they can be behind by what else
+ * changed since then in the same frame.
+ */
+
+#ifndef ENTITY_REGISTRY_H
+#define ENTITY_REGISTRY_H
+
+#include "CommonIncludes.h"
+#include "Utils.h"
+
+class Entity;
+
+// bits of EntityRegistry::flags; free slots have none of them set
+const unsigned char ENTITY_IS_ENEMY = 1 << 0;
+const unsigned char ENTITY_IS_NPC = 1 << 1;
+const unsigned char ENTITY_ALIVE = 1 << 2;
+const unsigned char ENTITY_CORPSE = 1 << 3;
+const unsigned char ENTITY_HERO_ALLY = 1 << 4;
+const unsigned char ENTITY_IN_COMBAT = 1 << 5;
+
+class EntityRegistry {
+public:
+	EntityRegistry();
+	~EntityRegistry();
+
+	// kind is ENTITY_IS_ENEMY or ENTITY_IS_NPC
+	void add(Entity *e, unsigned char kind);
+	void remove(Entity *e);
+
+	// copies the fields of e into its slot; does nothing for entities that aren't registered
+	void update(const Entity *e);
+
+	size_t size() const { return entities.size(); }
+
+	std::vector<Entity*> entities; // NULL for free slots
+	std::vector<FPoint> pos;
+	std::vector<float> threat_range;
+	std::vector<unsigned char> flags;
+};
+
+#endif // ENTITY_REGISTRY_H
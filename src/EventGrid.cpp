@@ -0,0 +1,134 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "EventGrid.h"
+#include "EventManager.h"
+
+static Rect makeRect(int x, int y, int w, int h) {
+	Rect r;
+	r.x = x;
+	r.y = y;
+	r.w = w;
+	r.h = h;
+	return r;
+}
+
+EventGrid::EventGrid()
+	: cell_count(1, 1)
+	, event_count(0)
+	, valid(false) {
+}
+
+EventGrid::~EventGrid() {
+}
+
+/**
+ * Returns the range of cells overlapping the area, as x,y of the first cell and w,h of the last
+ * Areas outside of the map are clamped to the nearest border cells
+ */
+Rect EventGrid::getCellRange(const Rect& area) const {
+	Rect r;
+	r.x = std::max(0, std::min(area.x / EVENT_GRID_CELL_SIZE, cell_count.x - 1));
+	r.y = std::max(0, std::min(area.y / EVENT_GRID_CELL_SIZE, cell_count.y - 1));
+	r.w = std::max(0, std::min((area.x + std::max(area.w, 1) - 1) / EVENT_GRID_CELL_SIZE, cell_count.x - 1));
+	r.h = std::max(0, std::min((area.y + std::max(area.h, 1) - 1) / EVENT_GRID_CELL_SIZE, cell_count.y - 1));
+	return r;
+}
+
+void EventGrid::addRect(unsigned index, const Rect& area, std::vector<std::vector<unsigned> >& cells) {
+	Rect range = getCellRange(area);
+	for (int y = range.y; y <= range.h; ++y) {
+		for (int x = range.x; x <= range.w; ++x) {
+			cells[y * cell_count.x + x].push_back(index);
+		}
+	}
+}
+
+void EventGrid::build(std::vector<Event>& events, const Point& map_size) {
+	cell_count.x = std::max(1, (map_size.x + EVENT_GRID_CELL_SIZE - 1) / EVENT_GRID_CELL_SIZE);
+	cell_count.y = std::max(1, (map_size.y + EVENT_GRID_CELL_SIZE - 1) / EVENT_GRID_CELL_SIZE);
+
+	const size_t cell_total = static_cast<size_t>(cell_count.x * cell_count.y);
+	location_cells.assign(cell_total, std::vector<unsigned>());
+	hotspot_cells.assign(cell_total, std::vector<unsigned>());
+	center_cells.assign(cell_total, std::vector<unsigned>());
+	location_always.clear();
+	hotspot_always.clear();
+	center_always.clear();
+
+	for (unsigned i = 0; i < events.size(); ++i) {
+		Event &evnt = events[i];
+
+		// these don't depend on the hero being inside the event area
+		if (evnt.activate_type == EVENT_STATIC || evnt.activate_type == EVENT_ON_CLEAR || evnt.activate_type == EVENT_ON_LEAVE)
+			location_always.push_back(i);
+		else
+			addRect(i, evnt.location, location_cells);
+
+		// NPC hotspots are checked against the NPC's sprite, which can be anywhere near the NPC
+		if (evnt.getComponent(EC_NPC_HOTSPOT))
+			hotspot_always.push_back(i);
+		else if (evnt.hotspot.w > 0 && evnt.hotspot.h > 0)
+			addRect(i, evnt.hotspot, hotspot_cells);
+
+		addRect(i, makeRect(static_cast<int>(evnt.center.x), static_cast<int>(evnt.center.y), 1, 1), center_cells);
+	}
+
+	event_count = events.size();
+	valid = true;
+}
+
+void EventGrid::invalidate() {
+	valid = false;
+}
+
+bool EventGrid::isValid(size_t _event_count) const {
+	return valid && event_count == _event_count;
+}
+
+void EventGrid::query(const Rect& area, const std::vector<std::vector<unsigned> >& cells, const std::vector<unsigned>& always, std::vector<unsigned>& result) const {
+	result.clear();
+	result.insert(result.end(), always.begin(), always.end());
+
+	Rect range = getCellRange(area);
+	for (int y = range.y; y <= range.h; ++y) {
+		for (int x = range.x; x <= range.w; ++x) {
+			const std::vector<unsigned> &cell = cells[y * cell_count.x + x];
+			result.insert(result.end(), cell.begin(), cell.end());
+		}
+	}
+
+	std::sort(result.begin(), result.end(), std::greater<unsigned>());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+void EventGrid::queryLocation(const Point& pos, std::vector<unsigned>& result) const {
+	query(makeRect(pos.x, pos.y, 1, 1), location_cells, location_always, result);
+}
+
+void EventGrid::queryHotspots(const Rect& area, std::vector<unsigned>& result) const {
+	query(area, hotspot_cells, hotspot_always, result);
+}
+
+void EventGrid::queryCenters(const FPoint& pos, float radius, std::vector<unsigned>& result) const {
+	Rect area;
+	area.x = static_cast<int>(pos.x - radius);
+	area.y = static_cast<int>(pos.y - radius);
+	area.w = static_cast<int>(radius * 2) + 2;
+	area.h = area.w;
+	query(area, center_cells, center_always, result);
+}
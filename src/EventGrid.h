@@ -0,0 +1,81 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class EventGrid
+ *
+ * A uniform grid of map cells over the events of a map, so that the per-frame
+ * event checks only look at events near the hero or the cursor.
+ * Events are referred to by their index in Map::events, so the grid has to be
+ * rebuilt whenever an event is added or erased.
+ */
+
+#ifndef EVENT_GRID_H
+#define EVENT_GRID_H
+
+#include "CommonIncludes.h"
+#include "Utils.h"
+
+class Event;
+
+// width and height of a grid cell, in map tiles
+const int EVENT_GRID_CELL_SIZE = 8;
+
+class EventGrid {
+private:
+	Rect getCellRange(const Rect& area) const;
+	void addRect(unsigned index, const Rect& area, std::vector<std::vector<unsigned> >& cells);
+	void query(const Rect& area, const std::vector<std::vector<unsigned> >& cells, const std::vector<unsigned>& always, std::vector<unsigned>& result) const;
+
+	Point cell_count;
+	size_t event_count;
+	bool valid;
+
+	// trigger areas, hotspots and centers of the events
+	std::vector<std::vector<unsigned> > location_cells;
+	std::vector<std::vector<unsigned> > hotspot_cells;
+	std::vector<std::vector<unsigned> > center_cells;
+
+	// events that have to be checked regardless of position
+	std::vector<unsigned> location_always;
+	std::vector<unsigned> hotspot_always;
+	std::vector<unsigned> center_always;
+
+public:
+	EventGrid();
+	~EventGrid();
+
+	void build(std::vector<Event>& events, const Point& map_size);
+
+	// must be called after adding or erasing events
+	void invalidate();
+	bool isValid(size_t _event_count) const;
+
+	// Every query returns event indices in descending order, without duplicates,
+	// so that callers can erase events while walking the result.
+
+	// events whose trigger area might contain pos, plus static, on_clear and on_leave events
+	void queryLocation(const Point& pos, std::vector<unsigned>& result) const;
+
+	// events with a hotspot that overlaps the area, plus NPC hotspots
+	void queryHotspots(const Rect& area, std::vector<unsigned>& result) const;
+
+	// events with a center within the square around pos
+	void queryCenters(const FPoint& pos, float radius, std::vector<unsigned>& result) const;
+};
+
+#endif // EVENT_GRID_H
@@ -37,7 +37,9 @@ Event::Event()
 	, cooldown_ticks(0)
 	, keep_after_trigger(true)
 	, center(FPoint(-1, -1))
-	, reachable_from(Rect()) {
+	, reachable_from(Rect())
+	, requirements()
+	, actions() {
 }
 
 Event::~Event() {
@@ -67,6 +69,8 @@ void Event::deleteAllComponents(const EVENT_COMPONENT_TYPE &_type) {
 /**
  * Class: EventManager
  */
+std::map<std::string, std::vector<Event> > EventManager::script_cache;
+
 EventManager::EventManager() {
 }
 
@@ -178,7 +182,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.tooltip|string|Tooltip for event
 		e->type = EC_TOOLTIP;
 
-		e->s = msg->get(val);
+		e->setString(msg->get(val));
 	}
 	else if (key == "power_path") {
 		// @ATTR event.power_path|["hero", point]|Event power path
@@ -191,7 +195,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 
 		std::string dest = popFirstString(val);
 		if (dest == "hero") {
-			e->s = "hero";
+			e->setString("hero");
 		}
 		else {
 			e->a = toInt(dest);
@@ -210,7 +214,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.intermap|filename, int, int : Map file, X, Y|Jump to specific map at location specified.
 		e->type = EC_INTERMAP;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 		e->x = -1;
 		e->y = -1;
 
@@ -240,7 +244,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.mapmod|list(predefined_string, int, int, int) : Layer, X, Y, Tile ID|Modify map tiles
 		e->type = EC_MAPMOD;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 		e->x = popFirstInt(val);
 		e->y = popFirstInt(val);
 		e->z = popFirstInt(val);
@@ -252,7 +256,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 				evnt->components.push_back(Event_Component());
 				e = &evnt->components.back();
 				e->type = EC_MAPMOD;
-				e->s = repeat_val;
+				e->setString(repeat_val);
 				e->x = popFirstInt(val);
 				e->y = popFirstInt(val);
 				e->z = popFirstInt(val);
@@ -265,7 +269,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.soundfx|filename, int, int, bool : Sound file, X, Y, loop|Filename of a sound to play. Optionally, it can be played at a specific location and/or looped.
 		e->type = EC_SOUNDFX;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 		e->x = e->y = -1;
 		e->z = static_cast<int>(false);
 
@@ -299,7 +303,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.msg|string|Adds a message to be displayed for the event.
 		e->type = EC_MSG;
 
-		e->s = msg->get(val);
+		e->setString(msg->get(val));
 	}
 	else if (key == "shakycam") {
 		// @ATTR event.shakycam|duration|Makes the camera shake for this duration in 'ms' or 's'.
@@ -311,7 +315,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.requires_status|list(string)|Event requires list of statuses
 		e->type = EC_REQUIRES_STATUS;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 
 		// add repeating requires_status
 		if (evnt) {
@@ -320,7 +324,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 				evnt->components.push_back(Event_Component());
 				e = &evnt->components.back();
 				e->type = EC_REQUIRES_STATUS;
-				e->s = repeat_val;
+				e->setString(repeat_val);
 
 				repeat_val = popFirstString(val);
 			}
@@ -330,7 +334,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.requires_not_status|list(string)|Event requires not list of statuses
 		e->type = EC_REQUIRES_NOT_STATUS;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 
 		// add repeating requires_not
 		if (evnt) {
@@ -339,7 +343,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 				evnt->components.push_back(Event_Component());
 				e = &evnt->components.back();
 				e->type = EC_REQUIRES_NOT_STATUS;
-				e->s = repeat_val;
+				e->setString(repeat_val);
 
 				repeat_val = popFirstString(val);
 			}
@@ -411,19 +415,19 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.requires_class|predefined_string|Event requires this base class
 		e->type = EC_REQUIRES_CLASS;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 	}
 	else if (key == "requires_not_class") {
 		// @ATTR event.requires_not_class|predefined_string|Event requires not this base class
 		e->type = EC_REQUIRES_NOT_CLASS;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 	}
 	else if (key == "set_status") {
 		// @ATTR event.set_status|list(string)|Sets specified statuses
 		e->type = EC_SET_STATUS;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 
 		// add repeating set_status
 		if (evnt) {
@@ -432,7 +436,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 				evnt->components.push_back(Event_Component());
 				e = &evnt->components.back();
 				e->type = EC_SET_STATUS;
-				e->s = repeat_val;
+				e->setString(repeat_val);
 
 				repeat_val = popFirstString(val);
 			}
@@ -442,7 +446,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.unset_status|list(string)|Unsets specified statuses
 		e->type = EC_UNSET_STATUS;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 
 		// add repeating unset_status
 		if (evnt) {
@@ -451,7 +455,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 				evnt->components.push_back(Event_Component());
 				e = &evnt->components.back();
 				e->type = EC_UNSET_STATUS;
-				e->s = repeat_val;
+				e->setString(repeat_val);
 
 				repeat_val = popFirstString(val);
 			}
@@ -505,7 +509,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.restore|["hp", "mp", "hpmp", "status", "all"]|Restore the hero's HP, MP, and/or status.
 		e->type = EC_RESTORE;
 
-		e->s = val;
+		e->setString(val);
 	}
 	else if (key == "power") {
 		// @ATTR event.power|power_id|Specify power coupled with event.
@@ -517,7 +521,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.spawn|list(predefined_string, int, int) : Enemy category, X, Y|Spawn an enemy from this category at location
 		e->type = EC_SPAWN;
 
-		e->s = popFirstString(val);
+		e->setString(popFirstString(val));
 		e->x = popFirstInt(val);
 		e->y = popFirstInt(val);
 
@@ -529,7 +533,7 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 				e = &evnt->components.back();
 				e->type = EC_SPAWN;
 
-				e->s = repeat_val;
+				e->setString(repeat_val);
 				e->x = popFirstInt(val);
 				e->y = popFirstInt(val);
 
@@ -547,19 +551,19 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.npc|filename|Filename of an NPC to start dialog with.
 		e->type = EC_NPC;
 
-		e->s = val;
+		e->setString(val);
 	}
 	else if (key == "music") {
 		// @ATTR event.music|filename|Change background music to specified file.
 		e->type = EC_MUSIC;
 
-		e->s = val;
+		e->setString(val);
 	}
 	else if (key == "cutscene") {
 		// @ATTR event.cutscene|filename|Show specified cutscene by filename.
 		e->type = EC_CUTSCENE;
 
-		e->s = val;
+		e->setString(val);
 	}
 	else if (key == "repeat") {
 		// @ATTR event.repeat|bool|If true, the event to be triggered again.
@@ -577,13 +581,13 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 		// @ATTR event.book|filename|Opens a book by filename.
 		e->type = EC_BOOK;
 
-		e->s = val;
+		e->setString(val);
 	}
 	else if (key == "script") {
 		// @ATTR event.script|filename|Loads and executes an Event from a file.
 		e->type = EC_SCRIPT;
 
-		e->s = val;
+		e->setString(val);
 	}
 	else if (key == "chance_exec") {
 		// @ATTR event.chance_exec|int|Percentage chance that this event will execute when triggered.
@@ -598,279 +602,435 @@ bool EventManager::loadEventComponentString(std::string &key, std::string &val,
 	return true;
 }
 
-/**
- * A particular event has been triggered.
- * Process all of this events components.
- *
- * @param The triggered event
- * @return Returns true if the event shall not be run again.
- */
-bool EventManager::executeEvent(Event &ev) {
-	// skip executing events that are on cooldown
-	if (ev.cooldown_ticks > 0) return false;
+// the mapmod operand of collision changes, which aren't on a layer
+static const int MAPMOD_COLLISION = -1;
 
-	// set cooldown
-	ev.cooldown_ticks = ev.cooldown;
+typedef void (*EventHandler)(Event& ev, Event_Component& ec, int operand);
 
-	// if chance_exec roll fails, don't execute the event
-	// we respect the value of "repeat", even if the event doesn't execute
-	Event_Component *ec_chance_exec = ev.getComponent(EC_CHANCE_EXEC);
-	if (ec_chance_exec && !percentChance(ec_chance_exec->x)) {
-		Event_Component *ec_repeat = ev.getComponent(EC_REPEAT);
-		if (ec_repeat) {
-			ev.keep_after_trigger = static_cast<bool>(ec_repeat->x);
+static void executeSetStatus(Event&, Event_Component& ec, int) {
+	camp->setStatus(ec.s);
+}
+
+static void executeUnsetStatus(Event&, Event_Component& ec, int) {
+	camp->unsetStatus(ec.s);
+}
+
+/**
+ * The operand is 1 if the destination map exists
+ */
+static void executeIntermap(Event& ev, Event_Component& ec, int operand) {
+	if (operand) {
+		mapr->teleportation = true;
+		mapr->teleport_mapname = ec.getString();
+
+		if (ec.x == -1 && ec.y == -1) {
+			// the teleport destination will be set to the map's hero_pos once the map is loaded
+			mapr->teleport_destination.x = -1;
+			mapr->teleport_destination.y = -1;
+		}
+		else {
+			mapr->teleport_destination.x = static_cast<float>(ec.x) + 0.5f;
+			mapr->teleport_destination.y = static_cast<float>(ec.y) + 0.5f;
 		}
-		return !ev.keep_after_trigger;
 	}
+	else {
+		ev.keep_after_trigger = false;
+		pc->logMsg(msg->get("Unknown destination"), false);
+	}
+}
 
-	Event_Component *ec;
-
-	for (unsigned i = 0; i < ev.components.size(); ++i) {
-		ec = &ev.components[i];
+static void executeIntramap(Event&, Event_Component& ec, int) {
+	mapr->teleportation = true;
+	mapr->teleport_mapname = "";
+	mapr->teleport_destination.x = static_cast<float>(ec.x) + 0.5f;
+	mapr->teleport_destination.y = static_cast<float>(ec.y) + 0.5f;
+}
 
-		if (ec->type == EC_SET_STATUS) {
-			camp->setStatus(ec->s);
+/**
+ * The operand is the index of the layer, or MAPMOD_COLLISION
+ */
+static void executeMapmod(Event&, Event_Component& ec, int operand) {
+	if (operand == MAPMOD_COLLISION) {
+		if (ec.x >= 0 && ec.x < mapr->w && ec.y >= 0 && ec.y < mapr->h) {
+			mapr->collider.setStaticTile(ec.x, ec.y, static_cast<unsigned short>(ec.z));
+			mapr->map_change = true;
 		}
-		else if (ec->type == EC_UNSET_STATUS) {
-			camp->unsetStatus(ec->s);
+		else
+			logError("EventManager: Mapmod at position (%d, %d) is out of bounds 0-255.", ec.x, ec.y);
+	}
+	else {
+		const size_t index = static_cast<size_t>(operand);
+		if (!mapr->isValidTile(ec.z))
+			logError("EventManager: Mapmod at position (%d, %d) contains invalid tile id (%d).", ec.x, ec.y, ec.z);
+		else if (index >= mapr->layers.size())
+			logError("EventManager: Mapmod at position (%d, %d) is on an invalid layer.", ec.x, ec.y);
+		else if (ec.x >= 0 && ec.x < mapr->w && ec.y >= 0 && ec.y < mapr->h) {
+			mapr->setTile(index, ec.x, ec.y, static_cast<unsigned short>(ec.z));
 		}
-		else if (ec->type == EC_INTERMAP) {
+		else
+			logError("EventManager: Mapmod at position (%d, %d) is out of bounds 0-255.", ec.x, ec.y);
+	}
+}
 
-			if (fileExists(mods->locate(ec->s))) {
-				mapr->teleportation = true;
-				mapr->teleport_mapname = ec->s;
+static void executeSoundFX(Event& ev, Event_Component& ec, int) {
+	FPoint pos(0,0);
+	bool loop = false;
 
-				if (ec->x == -1 && ec->y == -1) {
-					// the teleport destination will be set to the map's hero_pos once the map is loaded
-					mapr->teleport_destination.x = -1;
-					mapr->teleport_destination.y = -1;
-				}
-				else {
-					mapr->teleport_destination.x = static_cast<float>(ec->x) + 0.5f;
-					mapr->teleport_destination.y = static_cast<float>(ec->y) + 0.5f;
-				}
-			}
-			else {
-				ev.keep_after_trigger = false;
-				pc->logMsg(msg->get("Unknown destination"), false);
-			}
+	if (ec.x != -1 && ec.y != -1) {
+		if (ec.x != 0 && ec.y != 0) {
+			pos.x = static_cast<float>(ec.x) + 0.5f;
+			pos.y = static_cast<float>(ec.y) + 0.5f;
 		}
-		else if (ec->type == EC_INTRAMAP) {
-			mapr->teleportation = true;
-			mapr->teleport_mapname = "";
-			mapr->teleport_destination.x = static_cast<float>(ec->x) + 0.5f;
-			mapr->teleport_destination.y = static_cast<float>(ec->y) + 0.5f;
-		}
-		else if (ec->type == EC_MAPMOD) {
-			if (ec->s == "collision") {
-				if (ec->x >= 0 && ec->x < mapr->w && ec->y >= 0 && ec->y < mapr->h) {
-					mapr->collider.colmap[ec->x][ec->y] = static_cast<unsigned short>(ec->z);
-					mapr->map_change = true;
-				}
-				else
-					logError("EventManager: Mapmod at position (%d, %d) is out of bounds 0-255.", ec->x, ec->y);
-			}
-			else {
-				size_t index = static_cast<size_t>(distance(mapr->layernames.begin(), find(mapr->layernames.begin(), mapr->layernames.end(), ec->s)));
-				if (!mapr->isValidTile(ec->z))
-					logError("EventManager: Mapmod at position (%d, %d) contains invalid tile id (%d).", ec->x, ec->y, ec->z);
-				else if (index >= mapr->layers.size())
-					logError("EventManager: Mapmod at position (%d, %d) is on an invalid layer.", ec->x, ec->y);
-				else if (ec->x >= 0 && ec->x < mapr->w && ec->y >= 0 && ec->y < mapr->h)
-					mapr->layers[index][ec->x][ec->y] = static_cast<unsigned short>(ec->z);
-				else
-					logError("EventManager: Mapmod at position (%d, %d) is out of bounds 0-255.", ec->x, ec->y);
-			}
-		}
-		else if (ec->type == EC_SOUNDFX) {
-			FPoint pos(0,0);
-			bool loop = false;
+	}
+	else if (ev.location.x != 0 && ev.location.y != 0) {
+		pos.x = static_cast<float>(ev.location.x) + 0.5f;
+		pos.y = static_cast<float>(ev.location.y) + 0.5f;
+	}
 
-			if (ec->x != -1 && ec->y != -1) {
-				if (ec->x != 0 && ec->y != 0) {
-					pos.x = static_cast<float>(ec->x) + 0.5f;
-					pos.y = static_cast<float>(ec->y) + 0.5f;
-				}
-			}
-			else if (ev.location.x != 0 && ev.location.y != 0) {
-				pos.x = static_cast<float>(ev.location.x) + 0.5f;
-				pos.y = static_cast<float>(ev.location.y) + 0.5f;
-			}
+	if (ev.activate_type == EVENT_ON_LOAD || static_cast<bool>(ec.z) == true)
+		loop = true;
 
-			if (ev.activate_type == EVENT_ON_LOAD || static_cast<bool>(ec->z) == true)
-				loop = true;
+	SoundManager::SoundID sid = snd->load(ec.getString(), "MapRenderer background soundfx");
 
-			SoundManager::SoundID sid = snd->load(ec->s, "MapRenderer background soundfx");
+	snd->play(sid, GLOBAL_VIRTUAL_CHANNEL, pos, loop);
+	mapr->sids.push_back(sid);
+}
 
-			snd->play(sid, GLOBAL_VIRTUAL_CHANNEL, pos, loop);
-			mapr->sids.push_back(sid);
-		}
-		else if (ec->type == EC_LOOT) {
-			Event_Component *ec_lootcount = ev.getComponent(EC_LOOT_COUNT);
-			if (ec_lootcount) {
-				mapr->loot_count.x = ec_lootcount->x;
-				mapr->loot_count.y = ec_lootcount->y;
-			}
-			else {
-				mapr->loot_count.x = 0;
-				mapr->loot_count.y = 0;
-			}
+/**
+ * The operand is the index of the loot_count component, or -1
+ */
+static void executeLoot(Event& ev, Event_Component& ec, int operand) {
+	if (operand != -1) {
+		mapr->loot_count.x = ev.components[operand].x;
+		mapr->loot_count.y = ev.components[operand].y;
+	}
+	else {
+		mapr->loot_count.x = 0;
+		mapr->loot_count.y = 0;
+	}
 
-			ec->x = ev.hotspot.x;
-			ec->y = ev.hotspot.y;
-			mapr->loot.push_back(*ec);
-		}
-		else if (ec->type == EC_MSG) {
-			pc->logMsg(ec->s, false);
-		}
-		else if (ec->type == EC_SHAKYCAM) {
-			mapr->shaky_cam_ticks = ec->x;
-		}
-		else if (ec->type == EC_REMOVE_CURRENCY) {
-			camp->removeCurrency(ec->x);
-		}
-		else if (ec->type == EC_REMOVE_ITEM) {
-			camp->removeItem(ec->x);
-		}
-		else if (ec->type == EC_REWARD_XP) {
-			camp->rewardXP(ec->x, true);
-		}
-		else if (ec->type == EC_REWARD_CURRENCY) {
-			camp->rewardCurrency(ec->x);
-		}
-		else if (ec->type == EC_REWARD_ITEM) {
-			ItemStack istack;
-			istack.item = ec->x;
-			istack.quantity = ec->y;
-			camp->rewardItem(istack);
-		}
-		else if (ec->type == EC_RESTORE) {
-			camp->restoreHPMP(ec->s);
-		}
-		else if (ec->type == EC_SPAWN) {
-			Point spawn_pos;
-			spawn_pos.x = ec->x;
-			spawn_pos.y = ec->y;
-			enemies->spawn(ec->s, spawn_pos);
-		}
-		else if (ec->type == EC_POWER) {
-			Event_Component *ec_path = ev.getComponent(EC_POWER_PATH);
-			FPoint target;
+	ec.x = ev.hotspot.x;
+	ec.y = ev.hotspot.y;
+	mapr->loot.push_back(ec);
+}
 
-			if (ec_path) {
-				// targets hero option
-				if (ec_path->s == "hero") {
-					target.x = mapr->cam.x;
-					target.y = mapr->cam.y;
-				}
-				// targets fixed path option
-				else {
-					target.x = static_cast<float>(ec_path->a) + 0.5f;
-					target.y = static_cast<float>(ec_path->b) + 0.5f;
-				}
-			}
-			// no path specified, targets self location
-			else {
-				target.x = static_cast<float>(ev.location.x) + 0.5f;
-				target.y = static_cast<float>(ev.location.y) + 0.5f;
-			}
+static void executeMsg(Event&, Event_Component& ec, int) {
+	pc->logMsg(ec.getString(), false);
+}
 
-			// ec->x is power id
-			// ec->y is statblock index
-			mapr->activatePower(ec->x, ec->y, target);
-		}
-		else if (ec->type == EC_STASH) {
-			mapr->stash = static_cast<bool>(ec->x);
-			if (mapr->stash) {
-				mapr->stash_pos.x = static_cast<float>(ev.location.x) + 0.5f;
-				mapr->stash_pos.y = static_cast<float>(ev.location.y) + 0.5f;
-			}
-		}
-		else if (ec->type == EC_NPC) {
-			mapr->event_npc = ec->s;
-		}
-		else if (ec->type == EC_MUSIC) {
-			mapr->music_filename = ec->s;
-			mapr->loadMusic();
+static void executeShakycam(Event&, Event_Component& ec, int) {
+	mapr->shaky_cam_ticks = ec.x;
+}
+
+static void executeRemoveCurrency(Event&, Event_Component& ec, int) {
+	camp->removeCurrency(ec.x);
+}
+
+static void executeRemoveItem(Event&, Event_Component& ec, int) {
+	camp->removeItem(ec.x);
+}
+
+static void executeRewardXP(Event&, Event_Component& ec, int) {
+	camp->rewardXP(ec.x, true);
+}
+
+static void executeRewardCurrency(Event&, Event_Component& ec, int) {
+	camp->rewardCurrency(ec.x);
+}
+
+static void executeRewardItem(Event&, Event_Component& ec, int) {
+	ItemStack istack;
+	istack.item = ec.x;
+	istack.quantity = ec.y;
+	camp->rewardItem(istack);
+}
+
+static void executeRestore(Event&, Event_Component& ec, int) {
+	camp->restoreHPMP(ec.getString());
+}
+
+static void executeSpawn(Event&, Event_Component& ec, int) {
+	Point spawn_pos;
+	spawn_pos.x = ec.x;
+	spawn_pos.y = ec.y;
+	enemies->spawn(ec.getString(), spawn_pos);
+}
+
+/**
+ * The operand is the index of the power_path component, or -1
+ */
+static void executePower(Event& ev, Event_Component& ec, int operand) {
+	FPoint target;
+
+	if (operand != -1) {
+		const Event_Component &ec_path = ev.components[operand];
+
+		// targets hero option
+		if (ec_path.getString() == "hero") {
+			target.x = mapr->cam.x;
+			target.y = mapr->cam.y;
 		}
-		else if (ec->type == EC_CUTSCENE) {
-			mapr->cutscene = true;
-			mapr->cutscene_file = ec->s;
+		// targets fixed path option
+		else {
+			target.x = static_cast<float>(ec_path.a) + 0.5f;
+			target.y = static_cast<float>(ec_path.b) + 0.5f;
 		}
-		else if (ec->type == EC_REPEAT) {
-			ev.keep_after_trigger = static_cast<bool>(ec->x);
+	}
+	// no path specified, targets self location
+	else {
+		target.x = static_cast<float>(ev.location.x) + 0.5f;
+		target.y = static_cast<float>(ev.location.y) + 0.5f;
+	}
+
+	// ec.x is power id
+	// ec.y is statblock index
+	mapr->activatePower(ec.x, ec.y, target);
+}
+
+static void executeStash(Event& ev, Event_Component& ec, int) {
+	mapr->stash = static_cast<bool>(ec.x);
+	if (mapr->stash) {
+		mapr->stash_pos.x = static_cast<float>(ev.location.x) + 0.5f;
+		mapr->stash_pos.y = static_cast<float>(ev.location.y) + 0.5f;
+	}
+}
+
+static void executeNPC(Event&, Event_Component& ec, int) {
+	mapr->event_npc = ec.getString();
+}
+
+static void executeMusic(Event&, Event_Component& ec, int) {
+	mapr->music_filename = ec.getString();
+	mapr->loadMusic();
+}
+
+static void executeCutscene(Event&, Event_Component& ec, int) {
+	mapr->cutscene = true;
+	mapr->cutscene_file = ec.getString();
+}
+
+static void executeRepeat(Event& ev, Event_Component& ec, int) {
+	ev.keep_after_trigger = static_cast<bool>(ec.x);
+}
+
+static void executeSaveGame(Event&, Event_Component& ec, int) {
+	mapr->save_game = static_cast<bool>(ec.x);
+}
+
+static void executeNPCID(Event&, Event_Component& ec, int) {
+	mapr->npc_id = ec.x;
+}
+
+static void executeBook(Event&, Event_Component& ec, int) {
+	mapr->show_book = ec.getString();
+}
+
+static void executeEventScript(Event& ev, Event_Component& ec, int) {
+	if (ev.center.x != -1 && ev.center.y != -1)
+		EventManager::executeScript(ec.getString(), ev.center.x, ev.center.y);
+	else
+		EventManager::executeScript(ec.getString(), pc->stats.pos.x, pc->stats.pos.y);
+}
+
+// indexed by component type; NULL for components that don't do anything when the event runs
+static EventHandler event_handlers[EC_COUNT];
+
+static void initEventHandlers() {
+	event_handlers[EC_SET_STATUS] = executeSetStatus;
+	event_handlers[EC_UNSET_STATUS] = executeUnsetStatus;
+	event_handlers[EC_INTERMAP] = executeIntermap;
+	event_handlers[EC_INTRAMAP] = executeIntramap;
+	event_handlers[EC_MAPMOD] = executeMapmod;
+	event_handlers[EC_SOUNDFX] = executeSoundFX;
+	event_handlers[EC_LOOT] = executeLoot;
+	event_handlers[EC_MSG] = executeMsg;
+	event_handlers[EC_SHAKYCAM] = executeShakycam;
+	event_handlers[EC_REMOVE_CURRENCY] = executeRemoveCurrency;
+	event_handlers[EC_REMOVE_ITEM] = executeRemoveItem;
+	event_handlers[EC_REWARD_XP] = executeRewardXP;
+	event_handlers[EC_REWARD_CURRENCY] = executeRewardCurrency;
+	event_handlers[EC_REWARD_ITEM] = executeRewardItem;
+	event_handlers[EC_RESTORE] = executeRestore;
+	event_handlers[EC_SPAWN] = executeSpawn;
+	event_handlers[EC_POWER] = executePower;
+	event_handlers[EC_STASH] = executeStash;
+	event_handlers[EC_NPC] = executeNPC;
+	event_handlers[EC_MUSIC] = executeMusic;
+	event_handlers[EC_CUTSCENE] = executeCutscene;
+	event_handlers[EC_REPEAT] = executeRepeat;
+	event_handlers[EC_SAVE_GAME] = executeSaveGame;
+	event_handlers[EC_NPC_ID] = executeNPCID;
+	event_handlers[EC_BOOK] = executeBook;
+	event_handlers[EC_SCRIPT] = executeEventScript;
+}
+
+static int findComponent(const Event& ev, EVENT_COMPONENT_TYPE type) {
+	for (size_t i = 0; i < ev.components.size(); ++i) {
+		if (ev.components[i].type == type)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+/**
+ * Map events are compiled against the current map, which they belong to.
+ * Scripts are run on fresh copies, so they are compiled against the map they are run on.
+ */
+void EventManager::compileActions(Event& ev) {
+	if (!event_handlers[EC_SET_STATUS])
+		initEventHandlers();
+
+	Event_Actions &ea = ev.actions;
+	ea.actions.clear();
+	ea.chance_exec = findComponent(ev, EC_CHANCE_EXEC);
+	ea.repeat = findComponent(ev, EC_REPEAT);
+
+	for (size_t i = 0; i < ev.components.size(); ++i) {
+		const Event_Component &ec = ev.components[i];
+		if (ec.type >= EC_COUNT || !event_handlers[ec.type])
+			continue;
+
+		Event_Action action;
+		action.type = ec.type;
+		action.component = static_cast<unsigned>(i);
+
+		if (ec.type == EC_INTERMAP) {
+			action.operand = mods->locate(ec.getString()).empty() ? 0 : 1;
 		}
-		else if (ec->type == EC_SAVE_GAME) {
-			mapr->save_game = static_cast<bool>(ec->x);
+		else if (ec.type == EC_MAPMOD) {
+			if (ec.getString() == "collision")
+				action.operand = MAPMOD_COLLISION;
+			else
+				action.operand = static_cast<int>(std::find(mapr->layernames.begin(), mapr->layernames.end(), ec.getString()) - mapr->layernames.begin());
 		}
-		else if (ec->type == EC_NPC_ID) {
-			mapr->npc_id = ec->x;
+		else if (ec.type == EC_LOOT) {
+			action.operand = findComponent(ev, EC_LOOT_COUNT);
 		}
-		else if (ec->type == EC_BOOK) {
-			mapr->show_book = ec->s;
+		else if (ec.type == EC_POWER) {
+			action.operand = findComponent(ev, EC_POWER_PATH);
 		}
-		else if (ec->type == EC_SCRIPT) {
-			if (ev.center.x != -1 && ev.center.y != -1)
-				executeScript(ec->s, ev.center.x, ev.center.y);
-			else
-				executeScript(ec->s, pc->stats.pos.x, pc->stats.pos.y);
+
+		ea.actions.push_back(action);
+	}
+
+	ea.component_count = ev.components.size();
+	ea.compiled = true;
+}
+
+/**
+ * A particular event has been triggered.
+ * Process all of this events components.
+ *
+ * @param The triggered event
+ * @return Returns true if the event shall not be run again.
+ */
+bool EventManager::executeEvent(Event &ev) {
+	// skip executing events that are on cooldown
+	if (ev.cooldown_ticks > 0) return false;
+
+	// set cooldown
+	ev.cooldown_ticks = ev.cooldown;
+
+	if (!ev.actions.compiled || ev.actions.component_count != ev.components.size())
+		compileActions(ev);
+
+	// if chance_exec roll fails, don't execute the event
+	// we respect the value of "repeat", even if the event doesn't execute
+	if (ev.actions.chance_exec != -1 && !percentChance(ev.components[ev.actions.chance_exec].x)) {
+		if (ev.actions.repeat != -1) {
+			ev.keep_after_trigger = static_cast<bool>(ev.components[ev.actions.repeat].x);
 		}
+		return !ev.keep_after_trigger;
+	}
+
+	for (size_t i = 0; i < ev.actions.actions.size(); ++i) {
+		const Event_Action &action = ev.actions.actions[i];
+		event_handlers[action.type](ev, ev.components[action.component], action.operand);
 	}
 	return !ev.keep_after_trigger;
 }
 
 
-bool EventManager::isActive(const Event &e) {
-	for (size_t i=0; i < e.components.size(); i++) {
-		if (!camp->checkAllRequirements(e.components[i]))
-			return false;
-	}
-	return true;
+bool EventManager::isActive(Event &e) {
+	return camp->checkRequirements(e.components, e.requirements);
 }
 
+/**
+ * Scripts are parsed once, and each run works on a copy of the parsed events placed at (x, y)
+ */
 void EventManager::executeScript(const std::string& filename, float x, float y) {
-	FileParser script_file;
-	std::queue<Event> script_evnt;
-
-	if (script_file.open(filename)) {
-		while (script_file.next()) {
-			if (script_file.new_section && script_file.section == "event") {
-				Event tmp_evnt;
-				tmp_evnt.location.x = tmp_evnt.hotspot.x = static_cast<int>(x);
-				tmp_evnt.location.y = tmp_evnt.hotspot.y = static_cast<int>(y);
-				tmp_evnt.location.w = tmp_evnt.hotspot.w = 1;
-				tmp_evnt.location.h = tmp_evnt.hotspot.h = 1;
-				tmp_evnt.center.x = static_cast<float>(tmp_evnt.location.x) + 0.5f;
-				tmp_evnt.center.y = static_cast<float>(tmp_evnt.location.y) + 0.5f;
-
-				script_evnt.push(tmp_evnt);
-			}
+	std::vector<Event> uncached;
+	const std::vector<Event> *script;
 
-			if (script_evnt.empty())
-				continue;
+	std::map<std::string, std::vector<Event> >::iterator it = script_cache.find(filename);
+	if (it != script_cache.end()) {
+		script = &it->second;
+	}
+	else if (loadScript(filename, uncached)) {
+		// nested scripts may add to the cache while this one runs, which doesn't move the existing entries
+		std::vector<Event>& cached = script_cache[filename];
+		cached.swap(uncached);
+		script = &cached;
+	}
+	else {
+		script = &uncached;
+	}
 
-			if (script_file.key == "script" && script_file.val == filename) {
-				script_file.error("EventManager: Calling a script from within itself is not allowed.");
-				continue;
-			}
+	for (size_t i = 0; i < script->size(); ++i) {
+		Event script_evnt = (*script)[i];
+		script_evnt.location.x = script_evnt.hotspot.x = static_cast<int>(x);
+		script_evnt.location.y = script_evnt.hotspot.y = static_cast<int>(y);
+		script_evnt.location.w = script_evnt.hotspot.w = 1;
+		script_evnt.location.h = script_evnt.hotspot.h = 1;
+		script_evnt.center.x = static_cast<float>(script_evnt.location.x) + 0.5f;
+		script_evnt.center.y = static_cast<float>(script_evnt.location.y) + 0.5f;
+
+		// create StatBlocks if we need them
+		Event_Component *ec_power = script_evnt.getComponent(EC_POWER);
+		if (ec_power) {
+			ec_power->y = mapr->addEventStatBlock(script_evnt);
+		}
 
-			loadEventComponent(script_file, &script_evnt.back(), NULL);
+		if (isActive(script_evnt)) {
+			executeEvent(script_evnt);
 		}
-		script_file.close();
+	}
+}
 
-		while (!script_evnt.empty()) {
-			// create StatBlocks if we need them
-			Event_Component *ec_power = script_evnt.front().getComponent(EC_POWER);
-			if (ec_power) {
-				ec_power->y = mapr->addEventStatBlock(script_evnt.front());
-			}
+bool EventManager::loadScript(const std::string& filename, std::vector<Event>& script) {
+	FileParser script_file;
+	bool cacheable = true;
 
-			if (isActive(script_evnt.front())) {
-				executeEvent(script_evnt.front());
-			}
-			script_evnt.pop();
+	// a missing script is cached too, so that it is only reported once
+	if (!script_file.open(filename))
+		return true;
+
+	while (script_file.next()) {
+		if (script_file.new_section && script_file.section == "event") {
+			script.push_back(Event());
+		}
+
+		if (script.empty())
+			continue;
+
+		if (script_file.key == "script" && script_file.val == filename) {
+			script_file.error("EventManager: Calling a script from within itself is not allowed.");
+			continue;
 		}
+
+		// the map is picked when the component is loaded, so it has to be loaded again for every run
+		if (script_file.key == "intermap_random")
+			cacheable = false;
+
+		loadEventComponent(script_file, &script.back(), NULL);
 	}
+	script_file.close();
+
+	return cacheable;
+}
+
+void EventManager::clearScriptCache() {
+	script_cache.clear();
 }
 
 Event_Component EventManager::getRandomMapFromFile(const std::string& fname) {
@@ -883,8 +1043,8 @@ Event_Component EventManager::getRandomMapFromFile(const std::string& fname) {
 			// @ATTR map|filename, int, int : Map file, X, Y|Adds a map and optional spawn position to the random list of maps to teleport to.
 			if (infile.key == "map") {
 				Event_Component ec;
-				ec.s = popFirstString(infile.val);
-				if (ec.s != mapr->getFilename()) {
+				ec.setString(popFirstString(infile.val));
+				if (ec.getString() != mapr->getFilename()) {
 					ec.x = -1;
 					ec.y = -1;
 
@@ -905,5 +1065,5 @@ Event_Component EventManager::getRandomMapFromFile(const std::string& fname) {
 	if (ec_list.empty())
 		return Event_Component();
 	else
-		return ec_list[rand() % ec_list.size()];
+		return ec_list[randIndex(ec_list.size())];
 }
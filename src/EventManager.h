@@ -35,6 +35,77 @@ enum EVENT_ACTIVATE_TYPE {
 	EVENT_STATIC = 5
 };
 
+class Event_Requirement {
+public:
+	EVENT_COMPONENT_TYPE type;
+	StringHandle s;
+	int x;
+
+	Event_Requirement()
+		: type(EC_NONE)
+		, s(0)
+		, x(0) {
+	}
+};
+
+/**
+ * The requirement components of an event or quest, compiled by CampaignManager::checkRequirements()
+ * Status checks are cached until a campaign status changes, the others are checked every time.
+ */
+class Event_Requirements {
+public:
+	std::vector<Event_Requirement> status_checks;
+	std::vector<Event_Requirement> other_checks;
+	size_t component_count;
+	bool compiled;
+	unsigned status_revision;
+	bool status_met;
+
+	Event_Requirements()
+		: component_count(0)
+		, compiled(false)
+		, status_revision(0)
+		, status_met(false) {
+	}
+
+	bool empty() const {
+		return status_checks.empty() && other_checks.empty();
+	}
+};
+
+class Event_Action {
+public:
+	EVENT_COMPONENT_TYPE type;
+	unsigned component; // index into Event::components
+	int operand; // what the component refers to, looked up once by EventManager::compileActions()
+
+	Event_Action()
+		: type(EC_NONE)
+		, component(0)
+		, operand(0) {
+	}
+};
+
+/**
+ * The components of an event that do something when it runs, compiled by EventManager::compileActions()
+ * Components that only describe the event, such as requirements, are left out.
+ */
+class Event_Actions {
+public:
+	std::vector<Event_Action> actions;
+	int chance_exec; // index of the chance_exec component, or -1
+	int repeat; // index of the first repeat component, or -1
+	size_t component_count;
+	bool compiled;
+
+	Event_Actions()
+		: chance_exec(-1)
+		, repeat(-1)
+		, component_count(0)
+		, compiled(false) {
+	}
+};
+
 class Event {
 public:
 	std::string type;
@@ -47,6 +118,8 @@ public:
 	bool keep_after_trigger; // if this event has been triggered once, should this event be kept? If so, this event can be triggered multiple times.
 	FPoint center;
 	Rect reachable_from;
+	Event_Requirements requirements;
+	Event_Actions actions;
 
 	Event();
 	~Event();
@@ -64,12 +137,24 @@ public:
 	static bool loadEventComponentString(std::string &key, std::string &val, Event* evnt, Event_Component* ec);
 
 	static bool executeEvent(Event &e);
-	static bool isActive(const Event &e);
+	static bool isActive(Event &e);
 	static void executeScript(const std::string& filename, float x, float y);
 
+	// drops the parsed scripts, needed when the enabled mods change
+	static void clearScriptCache();
+
 private:
+	// looks up the handler and operand of each component once, instead of on every run
+	static void compileActions(Event& ev);
+
 	static Event_Component getRandomMapFromFile(const std::string& fname);
 
+	// returns false if the script can't be kept in script_cache, because it picks something at random while loading
+	static bool loadScript(const std::string& filename, std::vector<Event>& script);
+
+	// the events of each script file, with their location left for executeScript() to fill in
+	static std::map<std::string, std::vector<Event> > script_cache;
+
 };
 
 
@@ -20,14 +20,28 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsParsing.h"
 #include "UtilsFileSystem.h"
 #include "SharedResources.h"
+#include "Settings.h"
 
 #include <stdarg.h>
+#include <cstring>
+
+static bool rangeEquals(const char* begin, const char* end, const char* s) {
+	size_t length = strlen(s);
+	return static_cast<size_t>(end - begin) == length && strncmp(begin, s, length) == 0;
+}
 
 FileParser::FileParser()
 	: current_index(0)
+	, cursor(NULL)
+	, data_end(NULL)
+	, file_open(false)
 	, line("")
 	, line_number(0)
 	, include_fp(NULL)
+	, recording(NULL)
+	, file_offset(0)
+	, replay(NULL)
+	, replay_pos(0)
 	, new_section(false)
 	, section("")
 	, key("")
@@ -46,6 +60,12 @@ bool FileParser::open(const std::string& _filename, bool locateFileName, const s
 	line_number = 0;
 	this->errormessage = _errormessage;
 
+	if (recording) {
+		recording->names.push_back(_filename);
+		file_offset = recording->files.size();
+		recording->files.insert(recording->files.end(), filenames.begin(), filenames.end());
+	}
+
 	if (filenames.empty() && !errormessage.empty()) {
 		logError("FileParser: %s: %s: No such file or directory!", _filename.c_str(), errormessage.c_str());
 		return false;
@@ -55,46 +75,133 @@ bool FileParser::open(const std::string& _filename, bool locateFileName, const s
 
 	// Cycle through all filenames from the end, stopping when a file is to overwrite all further files.
 	for (size_t i=filenames.size(); i>0; i--) {
-		infile.open(filenames[i-1].c_str(), std::ios::in);
-		ret = infile.is_open();
+		ret = openFile(filenames[i-1]);
 
 		if (ret) {
 			// This will be the first file to be parsed. Seek to the start of the file and leave it open.
-			if (infile.good() && trim(getLine(infile)) != "APPEND") {
-				std::string test_line;
-
-				// get the first non-comment, non blank line
-				while (infile.good()) {
-					test_line = trim(getLine(infile));
-					if (test_line.length() == 0) continue;
-					else if (test_line.at(0) == '#') continue;
-					else break;
-				}
-
-				if (test_line != "APPEND") {
-					current_index = static_cast<unsigned>(i)-1;
-					infile.clear(); // reset flags
-					infile.seekg(0, std::ios::beg);
-					break;
-				}
+			const char *file_begin = cursor;
+			if (!isAppendFile()) {
+				current_index = static_cast<unsigned>(i)-1;
+				cursor = file_begin;
+				break;
 			}
 
 			// don't close the final file if it's the only one with an "APPEND" line
 			if (i > 1) {
-				infile.close();
-				infile.clear();
+				closeFile();
+			}
+			else {
+				cursor = file_begin;
 			}
 		}
 		else {
 			if (!errormessage.empty())
 				logError("FileParser: %s: %s", errormessage.c_str(), filenames[i-1].c_str());
-			infile.clear();
 		}
 	}
 
 	return ret;
 }
 
+bool FileParser::openCached(const std::string& _filename, const std::string &_errormessage) {
+	close();
+
+	if (PARSER_CACHE && mods) {
+		const ParserCacheEntry *entry = mods->parser_cache.get(_filename);
+		if (entry) {
+			replay = entry;
+			replay_pos = 0;
+			filenames = entry->files;
+			current_index = 0;
+			line_number = 0;
+			errormessage = _errormessage;
+			return true;
+		}
+
+		recorded.clear();
+		recording = &recorded;
+	}
+
+	return open(_filename, true, _errormessage);
+}
+
+/**
+ * Reads the whole file into memory, or points at it directly if it is inside a mounted archive
+ */
+bool FileParser::openFile(const std::string& filename) {
+	closeFile();
+
+	size_t size = 0;
+	const char *data = mods ? mods->getArchiveData(filename, size) : NULL;
+
+	if (!data) {
+		if (!readFile(filename, file_data))
+			return false;
+
+		data = file_data.data();
+		size = file_data.size();
+	}
+
+	cursor = data;
+	data_end = data + size;
+	file_open = true;
+	return true;
+}
+
+void FileParser::closeFile() {
+	// the file_data keeps its capacity for the next file
+	file_data.clear();
+	cursor = NULL;
+	data_end = NULL;
+	file_open = false;
+}
+
+/**
+ * Checks if the current file starts with an "APPEND" line. Moves the cursor.
+ */
+bool FileParser::isAppendFile() {
+	const char *line_begin, *line_end;
+
+	if (!nextLine(line_begin, line_end))
+		return false;
+
+	trim_range(line_begin, line_end);
+	if (rangeEquals(line_begin, line_end, "APPEND"))
+		return true;
+
+	// get the first non-comment, non blank line
+	while (nextLine(line_begin, line_end)) {
+		trim_range(line_begin, line_end);
+		if (line_begin == line_end) continue;
+		else if (*line_begin == '#') continue;
+		else return rangeEquals(line_begin, line_end, "APPEND");
+	}
+
+	return false;
+}
+
+bool FileParser::nextLine(const char*& line_begin, const char*& line_end) {
+	if (!file_open || cursor >= data_end)
+		return false;
+
+	line_begin = cursor;
+	const char *line_break = static_cast<const char*>(memchr(cursor, '\n', static_cast<size_t>(data_end - cursor)));
+	if (line_break) {
+		line_end = line_break;
+		cursor = line_break + 1;
+	}
+	else {
+		line_end = data_end;
+		cursor = data_end;
+	}
+
+	// strip carriage return if exists
+	if (line_end > line_begin && *(line_end-1) == '\r')
+		--line_end;
+
+	return true;
+}
+
 void FileParser::close() {
 	if (include_fp) {
 		include_fp->close();
@@ -102,9 +209,11 @@ void FileParser::close() {
 		include_fp = NULL;
 	}
 
-	if (infile.is_open())
-		infile.close();
-	infile.clear();
+	closeFile();
+
+	recording = NULL;
+	replay = NULL;
+	replay_pos = 0;
 }
 
 /**
@@ -115,11 +224,27 @@ void FileParser::close() {
  */
 bool FileParser::next() {
 
-	std::string starts_with;
+	const char *line_begin, *line_end;
 	new_section = false;
 
+	if (replay) {
+		if (replay_pos >= replay->records.size())
+			return false;
+
+		const ParserCacheRecord& record = replay->records[replay_pos++];
+		new_section = record.new_section;
+		section = record.section;
+		key = record.key;
+		val = record.val;
+
+		// used for error messages
+		current_index = record.file;
+		line_number = record.line_number;
+		return true;
+	}
+
 	while (current_index < filenames.size()) {
-		while (infile.good()) {
+		while (file_open) {
 			if (include_fp) {
 				if (include_fp->next()) {
 					new_section = include_fp->new_section;
@@ -136,65 +261,84 @@ bool FileParser::next() {
 				}
 			}
 
-			line = trim(getLine(infile));
+			if (!nextLine(line_begin, line_end))
+				break;
+
+			trim_range(line_begin, line_end);
 			line_number++;
 
 			// skip ahead if this line is empty
-			if (line.length() == 0) continue;
-
-			starts_with = line.at(0);
+			if (line_begin == line_end) continue;
 
 			// skip ahead if this line is a comment
-			if (starts_with == "#") continue;
+			if (*line_begin == '#') continue;
 
 			// set new section if this line is a section declaration
-			if (starts_with == "[") {
+			if (*line_begin == '[') {
 				new_section = true;
-				section = parse_section_title(line);
+				const char *bracket = std::find(line_begin, line_end, ']');
+				if (bracket == line_end)
+					section.clear(); // not found
+				else
+					section.assign(line_begin+1, bracket);
 
 				// keep searching for a key-pair
 				continue;
 			}
 
 			// skip the string used to combine files
-			if (line == "APPEND") continue;
+			if (rangeEquals(line_begin, line_end, "APPEND")) continue;
 
 			// read from a separate file
-			std::size_t first_space = line.find(' ');
+			const char *first_space = std::find(line_begin, line_end, ' ');
 
-			if (first_space != std::string::npos) {
-				std::string directive = line.substr(0, first_space);
+			if (first_space != line_end && rangeEquals(line_begin, first_space, "INCLUDE")) {
+				std::string tmp(first_space+1, line_end);
 
-				if (directive == "INCLUDE") {
-					std::string tmp = line.substr(first_space+1);
-
-					include_fp = new FileParser();
-					if (!include_fp || !include_fp->open(tmp)) {
-						delete include_fp;
-						include_fp = NULL;
-					}
-					continue;
+				include_fp = new FileParser();
+				if (include_fp)
+					include_fp->recording = recording;
+				if (!include_fp || !include_fp->open(tmp)) {
+					delete include_fp;
+					include_fp = NULL;
 				}
+				continue;
 			}
 
 			// this is a keypair. Perform basic parsing and return
-			parse_key_pair(line, key, val);
+			parse_key_pair(line_begin, line_end, key, val);
+
+			if (recording) {
+				recording->records.push_back(ParserCacheRecord());
+				ParserCacheRecord& record = recording->records.back();
+				record.new_section = new_section;
+				record.section = section;
+				record.key = key;
+				record.val = val;
+				record.file = static_cast<unsigned>(file_offset + current_index);
+				record.line_number = line_number;
+			}
 			return true;
 		}
 
-		infile.close();
-		infile.clear();
+		closeFile();
 
 		current_index++;
-		if (current_index == filenames.size()) return false;
+		if (current_index == filenames.size()) {
+			// every file was parsed, so the recorded key pairs are complete
+			if (recording == &recorded) {
+				mods->parser_cache.store(recorded.names.front(), recorded);
+				recorded.clear();
+				recording = NULL;
+			}
+			return false;
+		}
 
 		line_number = 0;
 		const std::string current_filename = filenames[current_index];
-		infile.open(current_filename.c_str(), std::ios::in);
-		if (!infile.is_open()) {
+		if (!openFile(current_filename)) {
 			if (!errormessage.empty())
 				logError("FileParser: %s: %s", errormessage.c_str(), current_filename.c_str());
-			infile.clear();
 			return false;
 		}
 		// a new file starts a new section
@@ -209,14 +353,24 @@ bool FileParser::next() {
  * Get an unparsed, unfiltered line from the input file
  */
 std::string FileParser::getRawLine() {
-	line = "";
+	const char *line_begin, *line_end;
+
+	if (nextLine(line_begin, line_end))
+		line.assign(line_begin, line_end);
+	else
+		line.clear();
 
-	if (infile.good()) {
-		line = getLine(infile);
-	}
 	return line;
 }
 
+bool FileParser::getRawLine(const char*& line_begin, const char*& line_end) {
+	if (nextLine(line_begin, line_end))
+		return true;
+
+	line_begin = line_end = NULL;
+	return false;
+}
+
 void FileParser::error(const char* format, ...) {
 	char buffer[4096];
 	va_list args;
@@ -26,22 +26,46 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #define FILE_PARSER_H
 
 #include "CommonIncludes.h"
+#include "ParserCache.h"
 
 class FileParser {
 private:
 	void errorBuf(const char* buffer);
 
+	bool openFile(const std::string& filename);
+	void closeFile();
+	bool isAppendFile();
+
+	// finds the bounds of the next line, without the line break
+	bool nextLine(const char*& line_begin, const char*& line_end);
+
 	std::vector<std::string> filenames;
 	unsigned current_index;
 	std::string errormessage;
 
-	std::ifstream infile;
+	// the whole current file is read at once; cursor points at the start of the next line
+	// files inside a mod archive are read in place, without copying them into file_data
+	std::string file_data;
+	const char *cursor;
+	const char *data_end;
+	bool file_open;
+
 	std::string line;
 
 	unsigned line_number;
 
 	FileParser* include_fp;
 
+	// key pairs are added to recording while it is set; it points to the
+	// recorded entry of the parser that was opened with openCached()
+	ParserCacheEntry recorded;
+	ParserCacheEntry *recording;
+	size_t file_offset;
+
+	// key pairs are read from a cache entry instead of the files while it is set
+	const ParserCacheEntry *replay;
+	size_t replay_pos;
+
 public:
 	FileParser();
 	~FileParser();
@@ -68,9 +92,22 @@ public:
 	 */
 	bool open(const std::string& filename, bool locateFileName = true, const std::string &errormessage = "Could not open text file");
 
+	/**
+	 * @brief openCached
+	 * Same as open(), but the key pairs are read from the ModManager's parser
+	 * cache if the located files haven't changed since they were last parsed.
+	 * Otherwise, the files are parsed and the cache is updated once next()
+	 * reaches the end. getRawLine() can't be used with cached files.
+	 */
+	bool openCached(const std::string& filename, const std::string &errormessage = "Could not open text file");
+
 	void close();
 	bool next();
 	std::string getRawLine();
+
+	// like getRawLine(), but points into the file data instead of copying the line
+	// The pointers are valid until the parser moves on to the next file.
+	bool getRawLine(const char*& line_begin, const char*& line_end);
 	void error(const char* format, ...);
 	void incrementLineNum();
 
@@ -24,14 +24,93 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  */
 
 #include "FontEngine.h"
+#include "SharedResources.h"
 #include "UtilsParsing.h"
 
 FontStyle::FontStyle() : name(""), path(""), ptsize(0), blend(true), line_height(0), font_height(0) {
 }
 
+LabelImageKey::LabelImageKey(const std::string& _font_style, const Color& _color, int _max_width, const std::string& _text)
+	: font_style(_font_style)
+	, color((static_cast<Uint32>(_color.r) << 16) | (static_cast<Uint32>(_color.g) << 8) | static_cast<Uint32>(_color.b))
+	, max_width(_max_width)
+	, text(_text) {
+}
+
+bool LabelImageKey::operator<(const LabelImageKey& other) const {
+	if (color != other.color) return color < other.color;
+	if (max_width != other.max_width) return max_width < other.max_width;
+	if (font_style != other.font_style) return font_style < other.font_style;
+	return text < other.text;
+}
+
+bool LabelImageCache::isIdle(const Entry& entry) const {
+	return entry.resource.image->getRefCount() <= 1;
+}
+
+void LabelImageCache::freeResource(LabelImage resource) {
+	resource.image->unref();
+}
+
+TextLayoutKey::TextLayoutKey(const FontStyle *_font, int _width, const std::string& _text)
+	: font(_font)
+	, width(_width)
+	, text(_text) {
+}
+
+bool TextLayoutKey::operator<(const TextLayoutKey& other) const {
+	if (width != other.width) return width < other.width;
+	if (font != other.font) return font < other.font;
+	return text < other.text;
+}
+
 FontEngine::FontEngine() : cursor_y(0) {
 }
 
+FontEngine::~FontEngine() {
+	label_cache.clear();
+	layout_cache.clear();
+}
+
+Image* FontEngine::renderLabel(const std::string& text, const std::string& font_style, const Color& color, int max_width, int& w, int& h) {
+	const LabelImageKey key(font_style, color, max_width, text);
+
+	LabelImageCache::Entry *entry = label_cache.get(key);
+	if (entry) {
+		entry->resource.image->ref();
+		w = entry->resource.w;
+		h = entry->resource.h;
+		return entry->resource.image;
+	}
+
+	std::string temp_text = text;
+
+	setFont(font_style);
+	w = calc_width(temp_text);
+	h = getFontHeight();
+
+	if (max_width > 0 && w > max_width) {
+		temp_text = trimTextToWidth(text, max_width, true);
+		w = calc_width(temp_text);
+	}
+
+	Image *image = render_device->createImage(w, h);
+	if (!image) return NULL;
+
+	renderShadowed(temp_text, 0, 0, JUSTIFY_LEFT, image, 0, color);
+
+	// the cache keeps its own reference, so the image outlives its last label
+	LabelImage label;
+	label.image = image;
+	label.w = w;
+	label.h = h;
+	image->ref();
+	label_cache.add(key, label, static_cast<size_t>(w) * static_cast<size_t>(h) * 4);
+	label_cache.trim(LABEL_CACHE_BYTES);
+
+	return image;
+}
+
 Color FontEngine::getColor(const std::string& _color) {
 	std::map<std::string,Color>::iterator it,end;
 	for (it=color_map.begin(), end=color_map.end(); it!=end; ++it) {
@@ -41,75 +120,112 @@ Color FontEngine::getColor(const std::string& _color) {
 	return FONT_WHITE;
 }
 
-/**
- * Using the given wrap width, calculate the width and height necessary to display this text
- */
-Point FontEngine::calc_size(const std::string& text_with_newlines, int width) {
-	char newline = 10;
-
-	std::string text = text_with_newlines;
+int FontEngine::getWordWidth(const std::string& word) {
+	const FontStyle *font_before = getActiveFont();
+	std::map<std::string, int>& widths = word_widths[font_before];
 
-	// if this contains newlines, recurse
-	size_t check_newline = text.find_first_of(newline);
-	if (check_newline != std::string::npos) {
-		Point p1 = calc_size(text.substr(0, check_newline), width);
-		Point p2 = calc_size(text.substr(check_newline+1, text.length()), width);
-		Point p3;
+	std::map<std::string, int>::iterator it = widths.find(word);
+	if (it != widths.end())
+		return it->second;
 
-		if (p1.x > p2.x) p3.x = p1.x;
-		else p3.x = p2.x;
+	int w = calc_width(word);
 
-		p3.y = p1.y + p2.y;
-		return p3;
+	// words that made calc_width() switch to a fallback font are measured again each time, so that the switch still happens
+	if (getActiveFont() == font_before) {
+		if (widths.size() >= WORD_WIDTH_CACHE_MAX)
+			widths.clear();
+		widths[word] = w;
 	}
 
-	int height = 0;
-	int max_width = 0;
+	return w;
+}
+
+/**
+ * Greedy word wrap of a single line, using the cached width of each word
+ * The width of a line is taken to be the sum of its words and the spaces between them.
+ */
+void FontEngine::layoutParagraph(const std::string& text, int width, TextLayout& layout) {
+	const int space_width = getWordWidth(" ");
+
+	std::string line;
+	int line_width = 0;
+	bool line_started = false;
+
+	size_t start = 0;
+	while (start <= text.length()) {
+		size_t end = text.find(' ', start);
+		if (end == std::string::npos)
+			end = text.length();
+
+		const std::string word = text.substr(start, end - start);
+		const int word_width = word.empty() ? 0 : getWordWidth(word);
+
+		if (!line_started) {
+			line = word;
+			line_width = word_width;
+			line_started = true;
+		}
+		else if (width > 0 && line_width + space_width + word_width > width) {
+			// this word can't fit on this line, so word wrap
+			layout.lines.push_back(line);
+			layout.size.x = std::max(layout.size.x, line_width);
+			line = word;
+			line_width = word_width;
+		}
+		else {
+			line += ' ';
+			line += word;
+			line_width += space_width + word_width;
+		}
 
-	std::string next_word;
-	std::stringstream builder;
-	std::stringstream builder_prev;
-	char space = 32;
-	size_t cursor = 0;
-	std::string fulltext = text + " ";
+		start = end + 1;
+	}
 
-	builder.str("");
-	builder_prev.str("");
+	layout.lines.push_back(line);
+	layout.size.x = std::max(layout.size.x, line_width);
+}
 
-	next_word = getNextToken(fulltext, cursor, space);
+const TextLayout& FontEngine::getLayout(const std::string& text, int width) {
+	const TextLayoutKey key(getActiveFont(), std::max(width, 0), text);
 
-	while(cursor != std::string::npos) {
-		builder << next_word;
+	TextLayoutCache::Entry *entry = layout_cache.get(key);
+	if (entry) {
+		// repeat the fallback font switch that measuring the text would have done
+		if (entry->resource.used_fallback)
+			calc_width(text);
+		return entry->resource;
+	}
 
-		if (calc_width(builder.str()) > width) {
+	TextLayout layout;
 
-			// this word can't fit on this line, so word wrap
-			height = height + getLineHeight();
-			if (calc_width(builder_prev.str()) > max_width) {
-				max_width = calc_width(builder_prev.str());
-			}
+	size_t start = 0;
+	while (start <= text.length()) {
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos)
+			end = text.length();
 
-			builder_prev.str("");
-			builder.str("");
+		layoutParagraph(text.substr(start, end - start), key.width, layout);
+		start = end + 1;
+	}
 
-			builder << next_word << " ";
-		}
-		else {
-			builder <<  " ";
-			builder_prev.str(builder.str());
-		}
+	layout.used_fallback = getActiveFont() != key.font;
+	layout.size.y = static_cast<int>(layout.lines.size()) * getLineHeight();
 
-		next_word = getNextToken(fulltext, cursor, space); // get next word
+	size_t bytes = sizeof(TextLayout) + text.length();
+	for (size_t i = 0; i < layout.lines.size(); ++i) {
+		bytes += sizeof(std::string) + layout.lines[i].length();
 	}
 
-	height = height + getLineHeight();
-	builder.str(trim(builder.str())); //removes whitespace that shouldn't be included in the size
-	if (calc_width(builder.str()) > max_width) max_width = calc_width(builder.str());
+	// trim first, so that the entry being returned is never evicted
+	layout_cache.trim(TEXT_LAYOUT_CACHE_BYTES);
+	return layout_cache.add(key, layout, bytes)->resource;
+}
 
-	Point size;
-	size.x = max_width;
-	size.y = height;
-	return size;
+/**
+ * Using the given wrap width, calculate the width and height necessary to display this text
+ */
+Point FontEngine::calc_size(const std::string& text_with_newlines, int width) {
+	return getLayout(text_with_newlines, width).size;
 }
 
 Rect FontEngine::position(const std::string& text, int x, int y, int justify) {
@@ -146,42 +262,13 @@ void FontEngine::render(const std::string& text, int x, int y, int justify, Imag
 		return;
 	}
 
-	std::string fulltext = text + " ";
-	cursor_y = y;
-	std::string next_word;
-	std::stringstream builder;
-	std::stringstream builder_prev;
-	char space = 32;
-	size_t cursor = 0;
-
-	builder.str("");
-	builder_prev.str("");
-
-	next_word = getNextToken(fulltext, cursor, space);
-
-	while(cursor != std::string::npos) {
-
-		builder << next_word;
+	const TextLayout& layout = getLayout(text, width);
 
-		if (calc_width(builder.str()) > width) {
-			renderInternal(builder_prev.str(), x, cursor_y, justify, target, color);
-			cursor_y += getLineHeight();
-			builder_prev.str("");
-			builder.str("");
-
-			builder << next_word << " ";
-		}
-		else {
-			builder << " ";
-			builder_prev.str(builder.str());
-		}
-
-		next_word = getNextToken(fulltext, cursor, space); // next word
+	cursor_y = y;
+	for (size_t i = 0; i < layout.lines.size(); ++i) {
+		renderInternal(layout.lines[i], x, cursor_y, justify, target, color);
+		cursor_y += getLineHeight();
 	}
-
-	renderInternal(builder.str(), x, cursor_y, justify, target, color);
-	cursor_y += getLineHeight();
-
 }
 
 void FontEngine::renderShadowed(const std::string& text, int x, int y, int justify, Image *target, int width, const Color& color) {
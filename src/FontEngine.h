@@ -22,6 +22,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #define FONT_ENGINE_H
 
 #include "CommonIncludes.h"
+#include "ResourceCache.h"
 #include "Utils.h"
 #include <map>
 
@@ -32,6 +33,17 @@ const int JUSTIFY_CENTER = 2;
 const Color FONT_WHITE = Color(255,255,255);
 const Color FONT_BLACK = Color(0,0,0);
 
+// unused label images are kept until they take up more than this
+const size_t LABEL_CACHE_BYTES = 4 * 1024 * 1024;
+
+// wrapped text layouts are kept until their text takes up more than this
+const size_t TEXT_LAYOUT_CACHE_BYTES = 512 * 1024;
+
+// the measured widths of words are forgotten once a font has this many
+const size_t WORD_WIDTH_CACHE_MAX = 8192;
+
+class Image;
+
 class FontStyle {
 public:
 	std::string name;
@@ -45,6 +57,85 @@ public:
 	virtual ~FontStyle() {};
 };
 
+/**
+ * Everything that decides how a label is rasterized
+ */
+class LabelImageKey {
+public:
+	std::string font_style;
+	Uint32 color;
+	int max_width;
+	std::string text;
+
+	LabelImageKey(const std::string& _font_style, const Color& _color, int _max_width, const std::string& _text);
+	bool operator<(const LabelImageKey& other) const;
+};
+
+/**
+ * A rendered label and the bounds it was made with, which may differ from the size reported by the image
+ */
+class LabelImage {
+public:
+	Image *image;
+	int w;
+	int h;
+
+	LabelImage()
+		: image(NULL)
+		, w(0)
+		, h(0) {
+	}
+
+	bool operator==(const LabelImage& other) const {
+		return image == other.image;
+	}
+};
+
+/**
+ * Label images by font, color, width and text. The cache holds its own
+ * reference to each image, so an image is unused when that is the only one left.
+ */
+class LabelImageCache : public ResourceCache<LabelImageKey, LabelImage> {
+protected:
+	bool isIdle(const Entry& entry) const;
+	void freeResource(LabelImage resource);
+};
+
+/**
+ * The font, wrap width and text a layout was made for
+ */
+class TextLayoutKey {
+public:
+	const FontStyle *font;
+	int width;
+	std::string text;
+
+	TextLayoutKey(const FontStyle *_font, int _width, const std::string& _text);
+	bool operator<(const TextLayoutKey& other) const;
+};
+
+/**
+ * The lines a text is broken into at a wrap width, and the size they take up
+ */
+class TextLayout {
+public:
+	std::vector<std::string> lines;
+	Point size;
+
+	// measuring the text switched to a fallback font
+	bool used_fallback;
+
+	TextLayout()
+		: size()
+		, used_fallback(false) {
+	}
+};
+
+class TextLayoutCache : public ResourceCache<TextLayoutKey, TextLayout> {
+protected:
+	void freeResource(TextLayout) {}
+};
+
 /**
  *
  * class FontEngine
@@ -55,7 +146,7 @@ class FontEngine {
 
 public:
 	FontEngine();
-	virtual ~FontEngine() {};
+	virtual ~FontEngine();
 
 	Color getColor(const std::string& _color);
 
@@ -71,14 +162,38 @@ public:
 	virtual int calc_width(const std::string& text) = 0;
 	virtual std::string trimTextToWidth(const std::string& text, const int width, const bool use_ellipsis) = 0;
 
+	// frees cached glyph images; must be called before the render context is recreated
+	virtual void clearGlyphCache() = 0;
+
+	/* Breaks text into lines that fit width with the current font, at spaces and newlines. A width of 0 or less only breaks at newlines.
+	 * Layouts are cached, so the result is only valid until the next call.
+	 */
+	const TextLayout& getLayout(const std::string& text, int width);
+
+	/* Renders a single line with a shadow, trimmed with an ellipsis if it is wider than max_width (when above 0).
+	 * Labels that look the same share one image. The caller gets its own reference, and w and h are set to the bounds of the text.
+	 */
+	Image* renderLabel(const std::string& text, const std::string& font_style, const Color& color, int max_width, int& w, int& h);
+
 	int cursor_y;
 
 protected:
 	Rect position(const std::string& text, int x, int y, int justify);
 	virtual void renderInternal(const std::string& text, int x, int y, int justify, Image *target, const Color& color) = 0;
 
+	// identifies the font that calc_width() currently measures with; NULL if there is none
+	virtual const FontStyle* getActiveFont() = 0;
+
 	std::map<std::string,Color> color_map;
 
+private:
+	// calc_width() of a single word, measured once per font
+	int getWordWidth(const std::string& word);
+	void layoutParagraph(const std::string& text, int width, TextLayout& layout);
+
+	LabelImageCache label_cache;
+	TextLayoutCache layout_cache;
+	std::map<const FontStyle*, std::map<std::string, int> > word_widths;
 };
 
 #endif
@@ -0,0 +1,102 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "FrameArena.h"
+
+#include <cstdlib>
+
+/**
+ * The arena is a list of blocks, newest first. A frame that doesn't fit in the
+ * current block starts a new one. On the next reset, the blocks are merged into
+ * a single one big enough for that frame, so the arena stops growing once it
+ * has seen the busiest frame.
+ *
+ * Blocks come from malloc() rather than operator new, so that the allocation
+ * tracker doesn't report the rare growth of the arena as a per-frame allocation.
+ */
+class FrameBlock {
+public:
+	FrameBlock *next;
+	size_t size;
+};
+
+// the block header is padded so that the memory after it stays aligned
+static const size_t FRAME_BLOCK_HEADER = ((sizeof(FrameBlock) + FRAME_ARENA_ALIGN - 1) / FRAME_ARENA_ALIGN) * FRAME_ARENA_ALIGN;
+
+static FrameBlock *arena_blocks = NULL;
+static size_t arena_offset = 0;
+static size_t arena_used = 0;
+static size_t arena_capacity = 0;
+
+static char* getBlockData(FrameBlock *block) {
+	return reinterpret_cast<char*>(block) + FRAME_BLOCK_HEADER;
+}
+
+static void addFrameBlock(size_t size) {
+	FrameBlock *block = static_cast<FrameBlock*>(malloc(FRAME_BLOCK_HEADER + size));
+	if (!block)
+		abort();
+
+	block->next = arena_blocks;
+	block->size = size;
+	arena_blocks = block;
+	arena_offset = 0;
+	arena_capacity += size;
+}
+
+void* frameAlloc(size_t size) {
+	size = ((size + FRAME_ARENA_ALIGN - 1) / FRAME_ARENA_ALIGN) * FRAME_ARENA_ALIGN;
+	if (size == 0)
+		size = FRAME_ARENA_ALIGN;
+
+	if (!arena_blocks || arena_offset + size > arena_blocks->size) {
+		size_t block_size = arena_blocks ? arena_blocks->size * 2 : FRAME_ARENA_BLOCK_SIZE;
+		while (block_size < size)
+			block_size *= 2;
+		addFrameBlock(block_size);
+	}
+
+	void *p = getBlockData(arena_blocks) + arena_offset;
+	arena_offset += size;
+	arena_used += size;
+	return p;
+}
+
+void resetFrameArena() {
+	// a frame that needed several blocks gets a single block as large as all of them
+	if (arena_blocks && arena_blocks->next) {
+		size_t capacity = arena_capacity;
+		while (arena_blocks) {
+			FrameBlock *next = arena_blocks->next;
+			free(arena_blocks);
+			arena_blocks = next;
+		}
+		arena_capacity = 0;
+		addFrameBlock(capacity);
+	}
+
+	arena_offset = 0;
+	arena_used = 0;
+}
+
+size_t getFrameArenaUsed() {
+	return arena_used;
+}
+
+size_t getFrameArenaCapacity() {
+	return arena_capacity;
+}
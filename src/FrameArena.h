@@ -0,0 +1,122 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * Frame arena
+ *
+ * Scratch memory for data that only lives until the end of the frame. Memory
+ * is handed out by bumping a pointer and is never freed on its own; the whole
+ * arena is reset at the top of each main loop iteration instead.
+ *
+ * Containers use it through FrameAllocator, for example:
+ *   std::vector<int, FrameAllocator<int> > ids;
+ * Since nothing is given back until the reset, a container that grows leaves
+ * its old buffers behind, so reserve() the expected size where it is known.
+ *
+ * The arena is only for the main thread, and nothing allocated from it may be
+ * kept past the end of the frame.
+ */
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+// the size of the first block; the arena grows to fit the busiest frame
+const size_t FRAME_ARENA_BLOCK_SIZE = 256 * 1024;
+
+// every allocation is aligned to this
+const size_t FRAME_ARENA_ALIGN = 16;
+
+void* frameAlloc(size_t size);
+
+// called at the top of each main loop iteration
+void resetFrameArena();
+
+// bytes handed out since the last reset, and bytes reserved in total
+size_t getFrameArenaUsed();
+size_t getFrameArenaCapacity();
+
+/**
+ * STL allocator that takes its memory from the frame arena
+ */
+template <class T>
+class FrameAllocator {
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind {
+		typedef FrameAllocator<U> other;
+	};
+
+	FrameAllocator() {
+	}
+
+	template <class U>
+	FrameAllocator(const FrameAllocator<U>&) {
+	}
+
+	pointer address(reference x) const {
+		return &x;
+	}
+
+	const_pointer address(const_reference x) const {
+		return &x;
+	}
+
+	pointer allocate(size_type n, const void* = 0) {
+		return static_cast<pointer>(frameAlloc(n * sizeof(T)));
+	}
+
+	void deallocate(pointer, size_type) {
+	}
+
+	size_type max_size() const {
+		return static_cast<size_type>(-1) / sizeof(T);
+	}
+
+	void construct(pointer p, const T& val) {
+		new(static_cast<void*>(p)) T(val);
+	}
+
+	void destroy(pointer p) {
+		p->~T();
+	}
+};
+
+template <class T, class U>
+inline bool operator==(const FrameAllocator<T>&, const FrameAllocator<U>&) {
+	return true;
+}
+
+template <class T, class U>
+inline bool operator!=(const FrameAllocator<T>&, const FrameAllocator<U>&) {
+	return false;
+}
+
+typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char> > FrameString;
+
+#endif // FRAME_ARENA_H
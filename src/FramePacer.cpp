@@ -0,0 +1,65 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "FramePacer.h"
+#include "Platform.h"
+
+#include <SDL.h>
+
+FramePacer::FramePacer()
+	: frame_ticks(SDL_GetPerformanceCounter())
+	, oversleep(0)
+	, missed_frames(0) {
+}
+
+void FramePacer::startFrame() {
+	frame_ticks = SDL_GetPerformanceCounter();
+}
+
+void FramePacer::wait(float seconds_per_frame, bool vsync_paced) {
+	if (getElapsed(frame_ticks) > seconds_per_frame + FRAME_PACER_MISS_MARGIN)
+		missed_frames++;
+
+	if (vsync_paced)
+		return;
+
+	while (true) {
+		float request = seconds_per_frame - getElapsed(frame_ticks) - oversleep;
+		if (request <= 0)
+			break;
+
+		uint64_t sleep_ticks = SDL_GetPerformanceCounter();
+		PlatformSleep(request);
+
+		// keep a moving average of how much longer the sleeps take than requested
+		oversleep += ((getElapsed(sleep_ticks) - request) - oversleep) * 0.1f;
+		if (oversleep < 0)
+			oversleep = 0;
+		else if (oversleep > FRAME_PACER_OVERSLEEP_MAX)
+			oversleep = FRAME_PACER_OVERSLEEP_MAX;
+	}
+}
+
+unsigned FramePacer::takeMissedFrames() {
+	unsigned count = missed_frames;
+	missed_frames = 0;
+	return count;
+}
+
+float FramePacer::getElapsed(uint64_t since) {
+	return static_cast<float>(SDL_GetPerformanceCounter() - since) / static_cast<float>(SDL_GetPerformanceFrequency());
+}
@@ -0,0 +1,59 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class FramePacer
+ *
+ * Waits out the rest of each frame by sleeping instead of spinning the CPU.
+ * Each sleep is shortened by how much recent sleeps overshot what they asked
+ * for, so that frames still end close to their deadline when the platform
+ * only sleeps in coarse steps.
+ */
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdint.h>
+
+// a frame that takes this many seconds longer than it should is counted as missed
+const float FRAME_PACER_MISS_MARGIN = 0.002f;
+
+// the most that a sleep is shortened by, in seconds
+const float FRAME_PACER_OVERSLEEP_MAX = 0.004f;
+
+class FramePacer {
+public:
+	FramePacer();
+
+	void startFrame();
+
+	// returns once seconds_per_frame has passed since startFrame()
+	// if vsync_paced is true, presenting the frame already waited for the display, so there is no sleep
+	void wait(float seconds_per_frame, bool vsync_paced);
+
+	// returns the number of missed frames since the last call
+	unsigned takeMissedFrames();
+
+private:
+	float getElapsed(uint64_t since);
+
+	uint64_t frame_ticks;
+	float oversleep;
+	unsigned missed_frames;
+};
+
+#endif // FRAME_PACER_H
@@ -61,6 +61,19 @@ bool GameState::isPaused() {
 	return false;
 }
 
+/**
+ * Most game states are menus
+ */
+bool GameState::isIdle() {
+	return true;
+}
+
+/**
+ * Widgets redraw themselves as the window_resized flag is set
+ */
+void GameState::restoreGraphics() {
+}
+
 void GameState::showLoading() {
 	if (!loading_tip)
 		return;
@@ -40,6 +40,12 @@ public:
 	}
 	void setLoadingFrame();
 	virtual bool isPaused();
+
+	// true while nothing on screen needs the full frame rate, so fewer frames can be drawn on mobile devices
+	virtual bool isIdle();
+
+	// draws the images that were drawn into again, after the renderer lost them
+	virtual void restoreGraphics();
 	void showLoading();
 
 	bool hasMusic;
@@ -28,6 +28,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  */
 
 #include "CommonIncludes.h"
+#include "EventManager.h"
 #include "FileParser.h"
 #include "GameStateConfigBase.h"
 #include "GameStateTitle.h"
@@ -44,6 +45,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "WidgetTabControl.h"
 #include "WidgetTooltip.h"
 
+#include <algorithm>
 #include <limits.h>
 #include <iomanip>
 
@@ -110,28 +112,8 @@ GameStateConfigBase::GameStateConfigBase (bool do_init)
 
 	language_lstb->can_deselect = false;
 
-	// Finish Mods ListBoxes setup
 	activemods_lstb->multi_select = true;
-	for (unsigned int i = 0; i < mods->mod_list.size() ; i++) {
-		if (mods->mod_list[i].name != FALLBACK_MOD)
-			activemods_lstb->append(mods->mod_list[i].name,createModTooltip(&mods->mod_list[i]));
-	}
-
 	inactivemods_lstb->multi_select = true;
-	for (unsigned int i = 0; i<mods->mod_dirs.size(); i++) {
-		bool skip_mod = false;
-		for (unsigned int j = 0; j<mods->mod_list.size(); j++) {
-			if (mods->mod_dirs[i] == mods->mod_list[j].name) {
-				skip_mod = true;
-				break;
-			}
-		}
-		if (!skip_mod && mods->mod_dirs[i] != FALLBACK_MOD) {
-			Mod temp_mod = mods->loadMod(mods->mod_dirs[i]);
-			inactivemods_lstb->append(mods->mod_dirs[i],createModTooltip(&temp_mod));
-		}
-	}
-	inactivemods_lstb->sort();
 
 	if (do_init) {
 		init();
@@ -165,7 +147,8 @@ void GameStateConfigBase::init() {
 
 	refreshWidgets();
 
-	update();
+	tab_built.assign(3, false);
+	buildTab(tab_control->getActiveTab());
 }
 
 void GameStateConfigBase::readConfig() {
@@ -454,18 +437,48 @@ void GameStateConfigBase::setupTabList() {
 	tablist_mods.lock();
 }
 
+/**
+ * Tabs are filled in the first time they are shown, from the settings at that time
+ */
+void GameStateConfigBase::buildTab(int tab) {
+	if (tab < 0 || static_cast<unsigned>(tab) >= tab_built.size() || tab_built[tab])
+		return;
+
+	tab_built[tab] = true;
+	createTabContents(tab);
+	updateTab(tab);
+}
+
+void GameStateConfigBase::createTabContents(int tab) {
+	if (tab == MODS_TAB)
+		createMods();
+}
+
 void GameStateConfigBase::update() {
-	updateAudio();
-	updateInterface();
-	updateMods();
+	if (AUDIO) {
+		snd->setVolumeMusic(MUSIC_VOLUME);
+		snd->setVolumeSFX(SOUND_VOLUME);
+	}
+
+	for (unsigned i = 0; i < tab_built.size(); ++i) {
+		if (tab_built[i])
+			updateTab(static_cast<int>(i));
+	}
+}
+
+void GameStateConfigBase::updateTab(int tab) {
+	if (tab == AUDIO_TAB)
+		updateAudio();
+	else if (tab == INTERFACE_TAB)
+		updateInterface();
+	else if (tab == MODS_TAB)
+		updateMods();
 }
 
 void GameStateConfigBase::updateAudio() {
 	if (AUDIO) {
 		music_volume_sl->set(0,128,MUSIC_VOLUME);
-		snd->setVolumeMusic(MUSIC_VOLUME);
 		sound_volume_sl->set(0,128,SOUND_VOLUME);
-		snd->setVolumeSFX(SOUND_VOLUME);
 	}
 	else {
 		music_volume_sl->set(0,128,0);
@@ -525,6 +538,7 @@ void GameStateConfigBase::logic() {
 
 	// tab contents
 	active_tab = tab_control->getActiveTab();
+	buildTab(active_tab);
 
 	if (active_tab == AUDIO_TAB) {
 		tablist.setNextTabList(&tablist_audio);
@@ -602,13 +616,21 @@ void GameStateConfigBase::logicAccept() {
 	msg = new MessageEngine();
 	inpt->saveKeyBindings();
 	inpt->setKeybindNames();
-	if (setMods()) {
+	if (tab_built[MODS_TAB] && setMods()) {
 		snd->unloadMusic();
 		reload_music = true;
 		reload_backgrounds = true;
+		// the decoder threads open files through mods, so they must be idle before it goes away
+		render_device->cancelImageRequests();
+		snd->finishLoads();
 		delete mods;
 		mods = new ModManager(NULL);
 		loadTilesetSettings();
+
+		// cached resources may come from mods that are no longer enabled
+		anim->freeUnused();
+		render_device->freeUnusedImages();
+		EventManager::clearScriptCache();
 	}
 	loadMiscSettings();
 	setStatNames();
@@ -624,6 +646,9 @@ void GameStateConfigBase::logicAccept() {
 		delete loading_tip;
 		loading_tip = NULL;
 	}
+	// cached glyphs live in images owned by the current render context
+	font->clearGlyphCache();
+	comb->clearGlyphCache();
 
 	render_device->createContext();
 	saveSettings();
@@ -706,6 +731,8 @@ void GameStateConfigBase::logicInterface() {
 }
 
 void GameStateConfigBase::logicMods() {
+	loadPendingMods();
+
 	if (activemods_lstb->checkClick()) {
 		//do nothing
 	}
@@ -851,6 +878,47 @@ void GameStateConfigBase::refreshFont() {
 	comb = new CombatText();
 }
 
+/**
+ * The active mods are already loaded. Reading the settings of the others is left to loadPendingMods().
+ */
+void GameStateConfigBase::createMods() {
+	for (unsigned int i = 0; i < mods->mod_list.size() ; i++) {
+		if (mods->mod_list[i].name != FALLBACK_MOD)
+			activemods_lstb->append(mods->mod_list[i].name,createModTooltip(&mods->mod_list[i]));
+	}
+
+	mods_pending.clear();
+	for (unsigned int i = 0; i<mods->mod_dirs.size(); i++) {
+		bool skip_mod = false;
+		for (unsigned int j = 0; j<mods->mod_list.size(); j++) {
+			if (mods->mod_dirs[i] == mods->mod_list[j].name) {
+				skip_mod = true;
+				break;
+			}
+		}
+		if (!skip_mod && mods->mod_dirs[i] != FALLBACK_MOD)
+			mods_pending.push_back(mods->mod_dirs[i]);
+	}
+
+	// loaded from the back, so that they show up in order
+	std::sort(mods_pending.rbegin(), mods_pending.rend());
+	loadPendingMods();
+}
+
+void GameStateConfigBase::loadPendingMods() {
+	if (mods_pending.empty())
+		return;
+
+	for (unsigned i = 0; i < CONFIG_MODS_PER_FRAME && !mods_pending.empty(); ++i) {
+		Mod temp_mod = mods->loadMod(mods_pending.back());
+		inactivemods_lstb->append(mods_pending.back(), createModTooltip(&temp_mod));
+		mods_pending.pop_back();
+	}
+
+	// mods disabled in the meantime are mixed in
+	inactivemods_lstb->sort();
+}
+
 void GameStateConfigBase::enableMods() {
 	for (int i=0; i<inactivemods_lstb->getSize(); i++) {
 		if (inactivemods_lstb->isSelected(i)) {
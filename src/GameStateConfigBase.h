@@ -43,6 +43,9 @@ class WidgetSlider;
 class WidgetTabControl;
 class WidgetTooltip;
 
+// the number of inactive mods read from disk per frame while the mods tab is shown
+const unsigned CONFIG_MODS_PER_FRAME = 4;
+
 class GameStateConfigBase : public GameState {
 public:
 	short AUDIO_TAB;
@@ -60,7 +63,12 @@ public:
 	void addChildWidgets();
 	virtual void setupTabList();
 
+	void buildTab(int tab);
+	virtual void createTabContents(int tab);
+
+	// only the tabs that have been built are updated
 	virtual void update();
+	virtual void updateTab(int tab);
 	void updateAudio();
 	void updateInterface();
 	void updateMods();
@@ -85,6 +93,8 @@ public:
 	void refreshLanguages();
 	void refreshFont();
 
+	void createMods();
+	void loadPendingMods();
 	void enableMods();
 	void disableMods();
 	bool setMods();
@@ -147,6 +157,10 @@ public:
 	TooltipData         tip_buf;
 
 	int active_tab;
+	std::vector<bool> tab_built;
+
+	// the names of inactive mods that haven't been added to inactivemods_lstb yet
+	std::vector<std::string> mods_pending;
 
 	Rect frame;
 	std::vector<std::string> language_ISO;
@@ -80,17 +80,15 @@ GameStateConfigDesktop::GameStateConfigDesktop()
 	, key_count(0)
 	, scrollpane_contents(0)
 {
-	// Allocate KeyBindings
+	// Allocate KeyBindings; the buttons are created along with the tab
 	for (int i = 0; i < inpt->key_count; i++) {
 		keybinds_lb.push_back(new WidgetLabel());
 		keybinds_lb[i]->set(inpt->binding_name[i]);
 		keybinds_lb[i]->setJustify(JUSTIFY_RIGHT);
 	}
-	for (int i = 0; i < inpt->key_count * 3; i++) {
-		keybinds_btn.push_back(new WidgetButton());
-	}
 
-	key_count = static_cast<unsigned>(keybinds_btn.size()/3);
+	key_count = static_cast<unsigned>(keybinds_lb.size());
+	keybinds_pos.resize(key_count);
 
 	init();
 }
@@ -125,25 +123,14 @@ void GameStateConfigDesktop::init() {
 	input_scrollbox->transparent = false;
 	input_scrollbox->resize(scrollpane.w, scrollpane_contents);
 
-	// Set positions of secondary key bindings
-	for (unsigned int i = key_count; i < key_count*2; i++) {
-		keybinds_btn[i]->pos.x = keybinds_btn[i-key_count]->pos.x + secondary_offset.x;
-		keybinds_btn[i]->pos.y = keybinds_btn[i-key_count]->pos.y + secondary_offset.y;
-	}
-
-	// Set positions of joystick bindings
-	for (unsigned int i = key_count*2; i < keybinds_btn.size(); i++) {
-		keybinds_btn[i]->pos.x = keybinds_btn[i-(key_count*2)]->pos.x + (secondary_offset.x*2);
-		keybinds_btn[i]->pos.y = keybinds_btn[i-(key_count*2)]->pos.y + (secondary_offset.y*2);
-	}
-
 	addChildWidgets();
 	addChildWidgetsDesktop();
 	setupTabList();
 
 	refreshWidgets();
 
-	update();
+	tab_built.assign(6, false);
+	buildTab(tab_control->getActiveTab());
 }
 
 void GameStateConfigDesktop::readConfig() {
@@ -344,12 +331,11 @@ bool GameStateConfigDesktop::parseKeyDesktop(FileParser &infile, int &x1, int &y
 
 	else return false;
 
-	if (keybind_num > -1 && static_cast<unsigned>(keybind_num) < keybinds_lb.size() && static_cast<unsigned>(keybind_num) < keybinds_btn.size()) {
+	if (keybind_num > -1 && static_cast<unsigned>(keybind_num) < keybinds_lb.size() && static_cast<unsigned>(keybind_num) < keybinds_pos.size()) {
 		//keybindings
 		keybinds_lb[keybind_num]->setX(x1);
 		keybinds_lb[keybind_num]->setY(y1);
-		keybinds_btn[keybind_num]->pos.x = x2;
-		keybinds_btn[keybind_num]->pos.y = y2;
+		keybinds_pos[keybind_num] = Point(x2, y2);
 	}
 
 	return true;
@@ -385,8 +371,18 @@ void GameStateConfigDesktop::addChildWidgetsDesktop() {
 	addChildWidget(joystick_device_lstb, INPUT_TAB);
 	addChildWidget(joystick_device_lb, INPUT_TAB);
 	addChildWidget(handheld_note_lb, INPUT_TAB);
+}
 
-	for (unsigned int i = 0; i < keybinds_btn.size(); i++) {
+/**
+ * Each key binding has a button for the primary, secondary and joystick binding, in their own columns
+ */
+void GameStateConfigDesktop::createKeybinds() {
+	for (unsigned int i = 0; i < key_count * 3; i++) {
+		Point col_offset(secondary_offset.x * static_cast<int>(i / key_count), secondary_offset.y * static_cast<int>(i / key_count));
+
+		keybinds_btn.push_back(new WidgetButton());
+		keybinds_btn[i]->pos.x = keybinds_pos[i % key_count].x + col_offset.x;
+		keybinds_btn[i]->pos.y = keybinds_pos[i % key_count].y + col_offset.y;
 		input_scrollbox->addChildWidget(keybinds_btn[i]);
 	}
 }
@@ -456,12 +452,22 @@ void GameStateConfigDesktop::setupTabList() {
 	tablist_mods.lock();
 }
 
-void GameStateConfigDesktop::update() {
-	GameStateConfigBase::update();
+void GameStateConfigDesktop::createTabContents(int tab) {
+	if (tab == KEYBINDS_TAB)
+		createKeybinds();
+	else
+		GameStateConfigBase::createTabContents(tab);
+}
 
-	updateVideo();
-	updateInput();
-	updateKeybinds();
+void GameStateConfigDesktop::updateTab(int tab) {
+	if (tab == VIDEO_TAB)
+		updateVideo();
+	else if (tab == INPUT_TAB)
+		updateInput();
+	else if (tab == KEYBINDS_TAB)
+		updateKeybinds();
+	else
+		GameStateConfigBase::updateTab(tab);
 }
 
 void GameStateConfigDesktop::updateVideo() {
@@ -546,6 +552,7 @@ void GameStateConfigDesktop::logic() {
 
 	// tab contents
 	active_tab = tab_control->getActiveTab();
+	buildTab(active_tab);
 
 	if (active_tab == VIDEO_TAB) {
 		tablist.setNextTabList(&tablist_video);
@@ -56,9 +56,11 @@ private:
 	void readConfig();
 	bool parseKeyDesktop(FileParser &infile, int &x1, int &y1, int &x2, int &y2);
 	void addChildWidgetsDesktop();
+	void createKeybinds();
 	void setupTabList();
 
-	void update();
+	void createTabContents(int tab);
+	void updateTab(int tab);
 	void updateVideo();
 	void updateInput();
 	void updateKeybinds();
@@ -121,6 +123,7 @@ private:
 
 	std::vector<WidgetLabel *> keybinds_lb;
 	std::vector<WidgetButton *> keybinds_btn;
+	std::vector<Point> keybinds_pos;
 
 	WidgetScrollBox     * input_scrollbox;
 	MenuConfirm         * input_confirm;
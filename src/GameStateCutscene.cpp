@@ -37,6 +37,7 @@ Scene::Scene(const CutsceneSettings& _settings, short _cutscene_type)
 	, done(false)
 	, vscroll_offset(0)
 	, vscroll_ticks(0)
+	, preloaded(false)
 	, cutscene_type(_cutscene_type)
 {
 }
@@ -45,8 +46,11 @@ Scene::~Scene() {
 	if (art) delete art;
 	if (art_scaled) delete art_scaled;
 	delete caption_box;
-	while(!components.empty()) {
-		components.pop();
+	components.clear();
+
+	// sounds that were never played are released along with the scene
+	for (size_t i = 0; i < preloaded_sounds.size(); ++i) {
+		snd->unload(preloaded_sounds[i]);
 	}
 
 	for (size_t i = 0; i < vscroll_components.size(); ++i) {
@@ -57,6 +61,28 @@ Scene::~Scene() {
 	}
 }
 
+/**
+ * Start decoding the images and sounds of this scene, so that reaching them doesn't stall
+ */
+void Scene::preload() {
+	if (preloaded)
+		return;
+
+	preloaded = true;
+
+	for (size_t i = 0; i < components.size(); ++i) {
+		if (components[i].type == "image") {
+			render_device->requestImage(components[i].s);
+		}
+		else if (components[i].type == "soundfx") {
+			// the reference is kept until the scene is deleted, so the sound stays cached until it is played
+			SoundManager::SoundID preload_sid = snd->load(components[i].s, "Cutscenes");
+			if (preload_sid != 0)
+				preloaded_sounds.push_back(preload_sid);
+		}
+	}
+}
+
 bool Scene::logic() {
 	if (done) return false;
 
@@ -88,6 +114,10 @@ bool Scene::logic() {
 				caption = components.front().s;
 			}
 			else if (components.front().type == "image") {
+				// keep showing the current image until the next one has been decoded
+				if (art && render_device->isImagePending(components.front().s))
+					return true;
+
 				if (art) {
 					delete art;
 					art = NULL;
@@ -112,7 +142,7 @@ bool Scene::logic() {
 				snd->play(sid);
 			}
 
-			components.pop();
+			components.pop_front();
 		}
 
 		/* check if current scene has reached the end */
@@ -122,7 +152,7 @@ bool Scene::logic() {
 		/* setup frame pausing */
 		frame_counter = 0;
 		pause_frames = components.front().x;
-		components.pop();
+		components.pop_front();
 
 		refreshWidgets();
 	}
@@ -170,7 +200,7 @@ bool Scene::logic() {
 
 				vscroll_components.push_back(vsc);
 			}
-			components.pop();
+			components.pop_front();
 		}
 
 		vscroll_offset = static_cast<int>(static_cast<float>(vscroll_ticks) * (settings.vscroll_speed * MAX_FRAMES_PER_SEC) / VIEW_H);
@@ -196,6 +226,14 @@ bool Scene::logic() {
 	return true;
 }
 
+void Scene::renderCaption(void *data, Image *target, int y) {
+	Scene *scene = static_cast<Scene*>(data);
+	int caption_width = VIEW_W - static_cast<int>(VIEW_W * (scene->settings.caption_margins.x * 2.0f));
+
+	font->setFont("font_captions");
+	font->renderShadowed(scene->caption, VIEW_W / 2, -y, JUSTIFY_CENTER, target, caption_width, FONT_WHITE);
+}
+
 void Scene::refreshWidgets() {
 	if (cutscene_type ==  CUTSCENE_STATIC) {
 		if (!caption.empty()) {
@@ -206,6 +244,7 @@ void Scene::refreshWidgets() {
 			if (!caption_box) {
 				caption_box = new WidgetScrollBox(VIEW_W, caption_size.y);
 				caption_box->setBasePos(0, 0, ALIGN_BOTTOM);
+				caption_box->setRenderer(renderCaption, this);
 			}
 			else {
 				caption_box->pos.h = caption_size.y;
@@ -213,12 +252,6 @@ void Scene::refreshWidgets() {
 			}
 
 			caption_box->setPos(0, static_cast<int>(static_cast<float>(VIEW_H) * settings.caption_margins.y) * (-1));
-
-			font->renderShadowed(caption, VIEW_W / 2, 0,
-								 JUSTIFY_CENTER,
-								 caption_box->contents->getGraphics(),
-								 caption_width,
-								 FONT_WHITE);
 		}
 
 		if (art) {
@@ -226,14 +259,12 @@ void Scene::refreshWidgets() {
 			if (settings.scale_graphics) {
 				art_dest = resizeToScreen(art_size.x, art_size.y, false, ALIGN_CENTER);
 
-				art->getGraphics()->ref(); // resize unref's our image (which we want to keep), so counter that here
-				Image *resized = art->getGraphics()->resize(art_dest.w, art_dest.h);
-				if (resized != NULL) {
+				Sprite *scaled = render_device->createScaledSprite(art->getGraphics(), art_dest.w, art_dest.h);
+				if (scaled != NULL) {
 					if (art_scaled) {
 						delete art_scaled;
 					}
-					art_scaled = resized->createSprite();
-					resized->unref();
+					art_scaled = scaled;
 				}
 
 				if (art_scaled)
@@ -331,9 +362,24 @@ void GameStateCutscene::logic() {
 		return;
 	}
 
+	bool scene_done = false;
 	while (!scenes.empty() && !scenes.front()->logic()) {
 		delete scenes.front();
-		scenes.pop();
+		scenes.pop_front();
+		scene_done = true;
+	}
+
+	if (scene_done)
+		preloadScenes();
+}
+
+/**
+ * Keep the images and sounds of the upcoming scenes decoding while the current one is shown.
+ * Scenes further ahead are left alone, so that long cutscenes don't hold everything in memory.
+ */
+void GameStateCutscene::preloadScenes() {
+	for (size_t i = 0; i < scenes.size() && i <= CUTSCENE_PRELOAD_SCENES; ++i) {
+		scenes[i]->preload();
 	}
 }
 
@@ -355,13 +401,13 @@ bool GameStateCutscene::load(const std::string& filename) {
 
 		if (infile.new_section) {
 			if (infile.section == "scene") {
-				scenes.push(new Scene(settings, CUTSCENE_STATIC));
+				scenes.push_back(new Scene(settings, CUTSCENE_STATIC));
 			}
 			else if (infile.section == "vscroll") {
 				// if the previous scene was also a vertical scroller, don't create a new scene
 				// instead, the previous scene will be extended
 				if (scenes.empty() || scenes.front()->cutscene_type != CUTSCENE_VSCROLL) {
-					scenes.push(new Scene(settings, CUTSCENE_VSCROLL));
+					scenes.push_back(new Scene(settings, CUTSCENE_VSCROLL));
 				}
 			}
 		}
@@ -416,7 +462,7 @@ bool GameStateCutscene::load(const std::string& filename) {
 			}
 
 			if (sc.type != "")
-				scenes.back()->components.push(sc);
+				scenes.back()->components.push_back(sc);
 
 		}
 		else if (infile.section == "vscroll") {
@@ -442,7 +488,7 @@ bool GameStateCutscene::load(const std::string& filename) {
 			}
 
 			if (sc.type != "")
-				scenes.back()->components.push(sc);
+				scenes.back()->components.push_back(sc);
 
 		}
 		else {
@@ -458,6 +504,8 @@ bool GameStateCutscene::load(const std::string& filename) {
 		return false;
 	}
 
+	preloadScenes();
+
 	return true;
 }
 
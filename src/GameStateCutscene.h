@@ -28,6 +28,9 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsParsing.h"
 #include "WidgetLabel.h"
 
+// the images and sounds of the current scene and this many upcoming scenes are decoded in the background
+const size_t CUTSCENE_PRELOAD_SCENES = 2;
+
 enum {
 	CUTSCENE_STATIC = 0,
 	CUTSCENE_VSCROLL = 1
@@ -77,6 +80,8 @@ public:
 
 class Scene {
 private:
+	static void renderCaption(void *data, Image *target, int y);
+
 	CutsceneSettings settings;
 	int frame_counter;
 	int pause_frames;
@@ -89,16 +94,19 @@ private:
 	bool done;
 	int vscroll_offset;
 	int vscroll_ticks;
+	bool preloaded;
+	std::vector<SoundManager::SoundID> preloaded_sounds;
 
 public:
 	Scene(const CutsceneSettings& _settings, short _cutscene_type);
 	~Scene();
 	void refreshWidgets();
+	void preload();
 	bool logic();
 	void render();
 
 	short cutscene_type;
-	std::queue<SceneComponent> components;
+	std::deque<SceneComponent> components;
 	std::vector<VScrollComponent> vscroll_components;
 };
 
@@ -108,7 +116,9 @@ private:
 	std::string dest_map;
 	Point dest_pos;
 
-	std::queue<Scene*> scenes;
+	std::deque<Scene*> scenes;
+
+	void preloadScenes();
 
 public:
 	explicit GameStateCutscene(GameState *game_state);
@@ -47,7 +47,8 @@ bool compareSaveDirs(const std::string& dir1, const std::string& dir2) {
 
 GameSlot::GameSlot()
 	: id(0)
-	, preview_turn_ticks(GAMESLOT_PREVIEW_TURN_DURATION) {
+	, preview_turn_ticks(GAMESLOT_PREVIEW_TURN_DURATION)
+	, preview_loaded(false) {
 }
 
 GameSlot::~GameSlot() {
@@ -69,8 +70,10 @@ GameStateLoad::GameStateLoad() : GameState()
 	, game_slot_max(4)
 	, text_trim_boundary(0) {
 
-	if (items == NULL)
+	if (items == NULL) {
 		items = new ItemManager();
+		items->loadSounds();
+	}
 
 	label_loading = new WidgetLabel();
 
@@ -266,6 +269,8 @@ void GameStateLoad::readGameSlots() {
 	std::stringstream filename;
 	std::vector<std::string> save_dirs;
 
+	save_load->waitForSave();
+
 	getDirList(PATH_USER + "saves/" + SAVE_PREFIX, save_dirs);
 	std::sort(save_dirs.begin(), save_dirs.end(), compareSaveDirs);
 	game_slots.resize(save_dirs.size(), NULL);
@@ -277,6 +282,20 @@ void GameStateLoad::readGameSlots() {
 		filename.str("");
 		filename << PATH_USER << "saves/" << SAVE_PREFIX << "/" << save_dirs[i] << "/avatar.txt";
 
+		if (!fileExists(filename.str())) continue;
+
+		// newer saves have a summary that is much faster to read
+		std::stringstream preview_filename;
+		preview_filename << PATH_USER << "saves/" << SAVE_PREFIX << "/" << save_dirs[i] << "/preview.dat";
+
+		SavePreview save_preview;
+		if (save_preview.read(preview_filename.str())) {
+			game_slots[i] = new GameSlot();
+			game_slots[i]->id = toInt(save_dirs[i]);
+			readSavePreview(game_slots[i], save_preview);
+			continue;
+		}
+
 		if (!infile.open(filename.str(),false)) continue;
 
 		game_slots[i] = new GameSlot();
@@ -322,8 +341,49 @@ void GameStateLoad::readGameSlots() {
 		game_slots[i]->stats.recalc();
 		game_slots[i]->stats.direction = 6;
 		game_slots[i]->preview.setStatBlock(&(game_slots[i]->stats));
+	}
+}
+
+void GameStateLoad::readSavePreview(GameSlot* slot, const SavePreview& save_preview) {
+	slot->stats.name = save_preview.name;
+	slot->stats.character_class = save_preview.character_class;
+	slot->stats.character_subclass = save_preview.character_subclass;
+	slot->stats.xp = save_preview.xp;
+
+	for (size_t j = 0; j < PRIMARY_STATS.size() && j < save_preview.primary.size(); ++j) {
+		slot->stats.primary[j] = save_preview.primary[j];
+	}
+
+	slot->equipped = save_preview.equipped;
+	slot->stats.gfx_base = save_preview.gfx_base;
+	slot->stats.gfx_head = save_preview.gfx_head;
+	slot->stats.gfx_portrait = save_preview.gfx_portrait;
+	slot->stats.permadeath = save_preview.permadeath;
+
+	if (!save_preview.map_title.empty())
+		slot->current_map = save_preview.map_title;
+	else
+		slot->current_map = getMapName(save_preview.spawn_map);
 
-		loadPreview(game_slots[i]);
+	slot->stats.recalc();
+	slot->stats.direction = 6;
+	slot->preview.setStatBlock(&(slot->stats));
+}
+
+/**
+ * The hero graphics of a slot are only loaded once the slot has been scrolled into view
+ */
+void GameStateLoad::loadVisiblePreviews() {
+	for (int i = scroll_offset; i < scroll_offset + visible_slots && i < static_cast<int>(game_slots.size()); ++i) {
+		GameSlot *slot = game_slots[i];
+		if (!slot || slot->preview_loaded)
+			continue;
+
+		loadPreview(slot);
+		slot->preview_loaded = true;
+
+		if (i == selected_slot)
+			slot->preview.setAnimation("run");
 	}
 }
 
@@ -349,7 +409,7 @@ void GameStateLoad::loadPreview(GameSlot* slot) {
 
 	// fall back to default if it exists
 	for (unsigned int i=0; i<preview_layer.size(); i++) {
-		bool exists = fileExists(mods->locate("animations/avatar/" + slot->stats.gfx_base + "/default_" + preview_layer[i] + ".txt"));
+		bool exists = !mods->locate("animations/avatar/" + slot->stats.gfx_base + "/default_" + preview_layer[i] + ".txt").empty();
 		if (exists) {
 			img_gfx.push_back("default_" + preview_layer[i]);
 		}
@@ -383,6 +443,8 @@ void GameStateLoad::logic() {
 	if (inpt->window_resized)
 		refreshWidgets();
 
+	loadVisiblePreviews();
+
 	for (size_t i = 0; i < game_slots.size(); ++i) {
 		if (static_cast<int>(i) == selected_slot) {
 			if (game_slots[i]->preview_turn_ticks > 0)
@@ -499,6 +561,7 @@ void GameStateLoad::logic() {
 	else if (confirm->visible) {
 		confirm->logic();
 		if (confirm->confirmClicked) {
+			save_load->waitForSave();
 			removeSaveDir(game_slots[selected_slot]->id);
 
 			delete game_slots[selected_slot];
@@ -538,7 +601,7 @@ void GameStateLoad::updateButtons() {
 	loadPortrait(selected_slot);
 
 	// check status of New Game button
-	if (!fileExists(mods->locate("maps/spawn.txt"))) {
+	if (mods->locate("maps/spawn.txt").empty()) {
 		button_new->enabled = false;
 		tablist.remove(button_new);
 		button_new->tooltip = msg->get("Enable a story mod to continue");
@@ -559,7 +622,7 @@ void GameStateLoad::updateButtons() {
 
 		button_load->label = msg->get("Load Game");
 		if (game_slots[selected_slot]->current_map == "") {
-			if (!fileExists(mods->locate("maps/spawn.txt"))) {
+			if (mods->locate("maps/spawn.txt").empty()) {
 				button_load->enabled = false;
 				tablist.remove(button_load);
 				button_load->tooltip = msg->get("Enable a story mod to continue");
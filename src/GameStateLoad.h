@@ -37,6 +37,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 class ItemManager;
 class MenuConfirm;
+class SavePreview;
 class WidgetButton;
 class WidgetLabel;
 class WidgetScrollBar;
@@ -53,6 +54,7 @@ public:
 	std::vector<int> equipped;
 	GameSlotPreview preview;
 	int preview_turn_ticks;
+	bool preview_loaded;
 
 	WidgetLabel label_name;
 	WidgetLabel label_level;
@@ -74,6 +76,8 @@ private:
 	void refreshWidgets();
 	void logicLoading();
 	void readGameSlots();
+	void readSavePreview(GameSlot* slot, const SavePreview& save_preview);
+	void loadVisiblePreviews();
 	void loadPreview(GameSlot *slot);
 
 	void scrollUp();
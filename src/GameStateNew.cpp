@@ -199,7 +199,7 @@ GameStateNew::GameStateNew()
 	if (portrait.empty()) portrait.push_back("");
 	if (name.empty()) name.push_back("");
 
-	loadPortrait(portrait[0]);
+	updatePortraits();
 	setName(name[0]);
 
 	// Set up tab list
@@ -224,20 +224,57 @@ void GameStateNew::loadGraphics() {
 	}
 }
 
-void GameStateNew::loadPortrait(const std::string& portrait_filename) {
+/**
+ * The portraits of the current option and the ones next to it are decoded in the background
+ * and kept loaded, so that the screen opens and browses without waiting for files.
+ * Until the current one is ready, the previous portrait stays on screen.
+ */
+void GameStateNew::updatePortraits() {
+	unsigned count = static_cast<unsigned>(portrait.size());
+	unsigned current = static_cast<unsigned>(current_option);
+
+	std::vector<std::string> nearby;
+	nearby.push_back(portrait[current]);
+	nearby.push_back(portrait[(current + 1) % count]);
+	nearby.push_back(portrait[(current + count - 1) % count]);
+
+	std::map<std::string, Image*>::iterator it = portrait_cache.begin();
+	while (it != portrait_cache.end()) {
+		if (std::find(nearby.begin(), nearby.end(), it->first) == nearby.end()) {
+			if (it->second)
+				it->second->unref();
+			portrait_cache.erase(it++);
+		}
+		else {
+			++it;
+		}
+	}
 
-	Image *graphics;
+	for (unsigned i = 0; i < nearby.size(); ++i) {
+		if (nearby[i].empty() || portrait_cache.find(nearby[i]) != portrait_cache.end())
+			continue;
+
+		render_device->requestImage(nearby[i]);
+		if (!render_device->isImagePending(nearby[i]))
+			portrait_cache[nearby[i]] = render_device->loadImage(nearby[i]);
+	}
+
+	if (portrait[current] == portrait_shown)
+		return;
+
+	it = portrait_cache.find(portrait[current]);
+	if (it == portrait_cache.end() && !portrait[current].empty())
+		return;
 
 	if (portrait_image)
 		delete portrait_image;
-
 	portrait_image = NULL;
-	graphics = render_device->loadImage(portrait_filename);
-	if (graphics) {
-		portrait_image = graphics->createSprite();
+
+	if (it != portrait_cache.end() && it->second) {
+		portrait_image = it->second->createSprite();
 		portrait_image->setDest(portrait_pos);
-		graphics->unref();
 	}
+	portrait_shown = portrait[current];
 }
 
 /**
@@ -329,16 +366,16 @@ void GameStateNew::logic() {
 	if (button_next->checkClick()) {
 		current_option++;
 		if (static_cast<unsigned>(current_option) == portrait.size()) current_option = 0;
-		loadPortrait(portrait[current_option]);
 		setName(name[current_option]);
 	}
 	else if (button_prev->checkClick()) {
 		current_option--;
 		if (current_option == -1) current_option = static_cast<int>(portrait.size())-1;
-		loadPortrait(portrait[current_option]);
 		setName(name[current_option]);
 	}
 
+	updatePortraits();
+
 	input_name->logic();
 
 	if (input_name->getText() != name[current_option]) modified_name = true;
@@ -427,6 +464,11 @@ GameStateNew::~GameStateNew() {
 	if (portrait_image)
 		delete portrait_image;
 
+	for (std::map<std::string, Image*>::iterator it = portrait_cache.begin(); it != portrait_cache.end(); ++it) {
+		if (it->second)
+			it->second->unref();
+	}
+
 	if (portrait_border)
 		delete portrait_border;
 
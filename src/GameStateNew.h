@@ -43,7 +43,7 @@ class GameStateNew : public GameState {
 private:
 
 	void loadGraphics();
-	void loadPortrait(const std::string& portrait_filename);
+	void updatePortraits();
 	void loadOptions(const std::string& option_filename);
 	std::string getClassTooltip(int index);
 	void setName(const std::string& default_name);
@@ -55,6 +55,10 @@ private:
 	std::vector<std::string> name;
 	int current_option;
 
+	// loaded portraits near the current option, by filename; NULL if the file couldn't be loaded
+	std::map<std::string, Image*> portrait_cache;
+	std::string portrait_shown;
+
 	Sprite *portrait_image;
 	Sprite *portrait_border;
 	WidgetButton *button_exit;
@@ -27,6 +27,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  * Also handles message passing between child objects, often to avoid circular dependencies.
  */
 
+#include "AllocTracker.h"
 #include "Avatar.h"
 #include "CampaignManager.h"
 #include "EnemyManager.h"
@@ -36,6 +37,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "GameStateCutscene.h"
 #include "Hazard.h"
 #include "HazardManager.h"
+#include "HotReload.h"
 #include "Menu.h"
 #include "MenuActionBar.h"
 #include "MenuCharacter.h"
@@ -53,7 +55,9 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "MenuVendor.h"
 #include "NPC.h"
 #include "NPCManager.h"
+#include "Profiler.h"
 #include "QuestLog.h"
+#include "RenderBenchmark.h"
 #include "WidgetLabel.h"
 #include "SharedGameResources.h"
 #include "SharedResources.h"
@@ -63,6 +67,71 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "MenuPowers.h"
 #include "SaveLoad.h"
 
+// the jobs run by startup_job()
+enum {
+	STARTUP_JOB_ITEMS = 0,
+	STARTUP_JOB_POWERS = 1,
+	STARTUP_JOB_ENEMY_GROUPS = 2,
+	STARTUP_JOB_COUNT = 3
+};
+
+/**
+ * Runs on the worker threads, so only parsing is done here.
+ * Sounds and animations are loaded afterwards on the main thread.
+ */
+static void startup_job(void *data, size_t begin, size_t end) {
+	const bool load_items = *static_cast<bool*>(data);
+
+	for (size_t i = begin; i < end; ++i) {
+		if (i == STARTUP_JOB_ITEMS && load_items)
+			items = new ItemManager();
+		else if (i == STARTUP_JOB_POWERS)
+			powers = new PowerManager();
+		else if (i == STARTUP_JOB_ENEMY_GROUPS)
+			enemyg = new EnemyGroupManager();
+	}
+}
+
+// the managers collected by render_job(), in the order that their lists are merged
+enum {
+	RENDER_JOB_ENEMIES = 0,
+	RENDER_JOB_NPCS = 1,
+	RENDER_JOB_LOOT = 2,
+	RENDER_JOB_HAZARDS = 3,
+	RENDER_JOB_COUNT = 4
+};
+
+/**
+ * Runs on the worker threads. Each manager writes to its own list and to the playback state
+ * of its own animations. The frame data shared between copies of an animation, such as
+ * its bounds, is only read. The enemies are the only ones that add to the pick buffer.
+ */
+static void render_job(void *data, size_t begin, size_t end) {
+	RenderJobContext *context = static_cast<RenderJobContext*>(data);
+
+	for (size_t i = begin; i < end; ++i) {
+		RenderJobList &list = context->lists[i];
+		list.r.clear();
+		list.r_dead.clear();
+
+		if (i == RENDER_JOB_ENEMIES)
+			context->enemies->addRenders(list.r, list.r_dead);
+		else if (i == RENDER_JOB_NPCS)
+			context->npcs->addRenders(list.r); // npcs cannot be dead
+		else if (i == RENDER_JOB_LOOT)
+			context->loot->addRenders(list.r, list.r_dead);
+		else if (i == RENDER_JOB_HAZARDS)
+			context->hazards->addRenders(list.r, list.r_dead);
+	}
+}
+
+/**
+ * With RENDER_PIPELINE, runs all of the render jobs as one background task
+ */
+static void render_task_run(void *data) {
+	render_job(data, 0, RENDER_JOB_COUNT);
+}
+
 GameStatePlay::GameStatePlay()
 	: GameState()
 	, enemy(NULL)
@@ -70,25 +139,39 @@ GameStatePlay::GameStatePlay()
 	, npc_from_map(true)
 	, nearest_npc(-1)
 	, menu_enemy_timeout(MAX_FRAMES_PER_SEC*10)
+	, render_back(0)
+	, render_task(0)
 {
 	hasMusic = true;
 	has_background = false;
 	// GameEngine scope variables
 
-	if (items == NULL)
-		items = new ItemManager();
+	// the item, power and enemy group definitions don't depend on each other, so they are parsed in parallel
+	bool load_items = (items == NULL);
+	workers->parallelFor(startup_job, &load_items, STARTUP_JOB_COUNT, 1);
+
+	if (load_items)
+		items->loadSounds();
+	powers->loadResources();
 
 	loot = new LootManager();
-	powers = new PowerManager();
 	camp = new CampaignManager();
 	mapr = new MapRenderer();
 	pc = new Avatar();
 	enemies = new EnemyManager();
-	enemyg = new EnemyGroupManager();
 	hazards = new HazardManager();
 	menu = new MenuManager(&pc->stats);
 	npcs = new NPCManager(&pc->stats);
 	quests = new QuestLog(menu->questlog);
+	stress = new StressScene();
+	hot_reload = new HotReload();
+	benchmark = new RenderBenchmark();
+
+	render_jobs.lists.resize(RENDER_JOB_COUNT);
+	render_jobs.enemies = enemies;
+	render_jobs.npcs = npcs;
+	render_jobs.loot = loot;
+	render_jobs.hazards = hazards;
 
 	// LootManager needs hero StatBlock
 	loot->hero = &pc->stats;
@@ -109,7 +192,7 @@ void GameStatePlay::refreshWidgets() {
 void GameStatePlay::resetGame() {
 	mapr->load("maps/spawn.txt");
 	setLoadingFrame();
-	camp->status.clear();
+	camp->clearStatus();
 	pc->init();
 	pc->stats.currency = 0;
 	menu->act->clear();
@@ -265,6 +348,7 @@ void GameStatePlay::checkTeleport() {
 
 	// both map events and player powers can cause teleportation
 	if (mapr->teleportation || pc->stats.teleportation) {
+		addProfileMarker("teleport");
 
 		mapr->collider.unblock(pc->stats.pos.x, pc->stats.pos.y);
 
@@ -297,8 +381,19 @@ void GameStatePlay::checkTeleport() {
 			inpt->lock_all = (teleport_mapname == "maps/spawn.txt");
 			mapr->executeOnMapExitEvents();
 			showLoading();
-			mapr->load(teleport_mapname);
+			if (teleport_mapname == STRESS_SCENE_MAP)
+				stress->generateMap();
+			else
+				mapr->load(teleport_mapname);
 			setLoadingFrame();
+
+			// use the default hero spawn position for this map
+			// this is done first, so that the enemies near the hero are known when they are loaded
+			if (mapr->teleport_destination.x == -1 && mapr->teleport_destination.y == -1) {
+				mapr->cam.x = pc->stats.pos.x = mapr->hero_pos.x;
+				mapr->cam.y = pc->stats.pos.y = mapr->hero_pos.y;
+			}
+
 			enemies->handleNewMap();
 			hazards->handleNewMap();
 			loot->handleNewMap();
@@ -310,19 +405,16 @@ void GameStatePlay::checkTeleport() {
 			menu->mini->prerender(&mapr->collider, mapr->w, mapr->h);
 			npc_id = nearest_npc = -1;
 
-			// use the default hero spawn position for this map
-			if (mapr->teleport_destination.x == -1 && mapr->teleport_destination.y == -1) {
-				mapr->cam.x = pc->stats.pos.x = mapr->hero_pos.x;
-				mapr->cam.y = pc->stats.pos.y = mapr->hero_pos.y;
-			}
-
 			// store this as the new respawn point (provided the tile is open)
-			if (mapr->collider.is_valid_position(pc->stats.pos.x, pc->stats.pos.y, MOVEMENT_NORMAL, true)) {
-				mapr->respawn_map = teleport_mapname;
-				mapr->respawn_point = pc->stats.pos;
-			}
-			else {
-				logError("GameStatePlay: Spawn position (%d, %d) is blocked.", static_cast<int>(pc->stats.pos.x), static_cast<int>(pc->stats.pos.y));
+			// the generated stress scene map can't be loaded again, so it is skipped
+			if (teleport_mapname != STRESS_SCENE_MAP) {
+				if (mapr->collider.is_valid_position(pc->stats.pos.x, pc->stats.pos.y, MOVEMENT_NORMAL, true)) {
+					mapr->respawn_map = teleport_mapname;
+					mapr->respawn_point = pc->stats.pos;
+				}
+				else {
+					logError("GameStatePlay: Spawn position (%d, %d) is blocked.", static_cast<int>(pc->stats.pos.x), static_cast<int>(pc->stats.pos.y));
+				}
 			}
 
 			// return to title (permadeath) OR auto-save
@@ -489,6 +581,9 @@ void GameStatePlay::checkTitle() {
 }
 
 void GameStatePlay::checkEquipmentChange() {
+	// gear from an earlier change is shown once its sprite-sheets are decoded
+	pc->updatePendingGraphics();
+
 	// force the actionbar to update when we change gear
 	if (menu->inv->changed_equipment) {
 		menu->act->updated = true;
@@ -519,7 +614,7 @@ void GameStatePlay::checkEquipmentChange() {
 			}
 			// fall back to default if it exists
 			if (gfx.gfx == "") {
-				bool exists = fileExists(mods->locate("animations/avatar/" + pc->stats.gfx_base + "/default_" + gfx.type + ".txt"));
+				bool exists = !mods->locate("animations/avatar/" + pc->stats.gfx_base + "/default_" + gfx.type + ".txt").empty();
 				if (exists) gfx.gfx = "default_" + gfx.type;
 			}
 			img_gfx.push_back(gfx);
@@ -798,14 +893,36 @@ void GameStatePlay::updateActionBar(unsigned index) {
  * Process all actions for a single frame
  * This includes some message passing between child object
  */
+/**
+ * Remember where things were before this logic frame moves them, so that render() can draw between frames
+ */
+void GameStatePlay::savePrevPositions() {
+	pc->stats.prev_pos = pc->stats.pos;
+	mapr->prev_cam = mapr->cam;
+
+	for (size_t i=0; i<enemies->enemies.size(); i++) {
+		enemies->enemies[i]->stats.prev_pos = enemies->enemies[i]->stats.pos;
+	}
+	for (size_t i=0; i<hazards->h.size(); i++) {
+		hazards->h[i]->prev_pos = hazards->h[i]->pos;
+	}
+}
+
 void GameStatePlay::logic() {
+	AllocSteadyScope steady;
+
+	savePrevPositions();
+
 	if (inpt->window_resized)
 		refreshWidgets();
 
 	checkCutscene();
 
 	// check menus first (top layer gets mouse click priority)
-	menu->logic();
+	{
+		ProfileScope scope(PROFILE_LOGIC_MENUS);
+		menu->logic();
+	}
 
 	if (!isPaused()) {
 
@@ -820,7 +937,10 @@ void GameStatePlay::logic() {
 		checkTitle();
 
 		menu->act->checkAction(action_queue);
-		pc->logic(action_queue, restrictPowerUse(), npc_id != -1);
+		{
+			ProfileScope scope(PROFILE_LOGIC_PLAYER);
+			pc->logic(action_queue, restrictPowerUse(), npc_id != -1);
+		}
 
 		// Transform powers change the actionbar layout,
 		// so we need to prevent accidental clicks if a new power is placed under the slot we clicked on.
@@ -833,15 +953,33 @@ void GameStatePlay::logic() {
 		if (pc->stats.get(STAT_STEALTH) > 100) enemies->hero_stealth = 100;
 		else enemies->hero_stealth = pc->stats.get(STAT_STEALTH);
 
-		enemies->logic();
-		hazards->logic();
-		loot->logic();
+		if (!DEV_SKIP_AI) {
+			ProfileScope scope(PROFILE_LOGIC_ENEMIES);
+			enemies->logic();
+		}
+		if (!DEV_SKIP_HAZARDS) {
+			ProfileScope scope(PROFILE_LOGIC_HAZARDS);
+			hazards->logic();
+		}
+		if (!DEV_SKIP_LOOT) {
+			ProfileScope scope(PROFILE_LOGIC_LOOT);
+			loot->logic();
+		}
 		enemies->checkEnemiesforXP();
-		npcs->logic();
-
-		snd->logic(pc->stats.pos);
-
-		comb->logic(mapr->cam);
+		{
+			ProfileScope scope(PROFILE_LOGIC_NPCS);
+			npcs->logic();
+		}
+		if (!DEV_SKIP_SOUND) {
+			ProfileScope scope(PROFILE_LOGIC_SOUND);
+			snd->logic(pc->stats.pos);
+		}
+		{
+			ProfileScope scope(PROFILE_LOGIC_COMBAT_TEXT);
+			comb->logic(mapr->cam);
+		}
+		stress->logic();
+		benchmark->logic();
 	}
 
 	// close menus when the player dies, but still allow them to be reopened
@@ -851,6 +989,7 @@ void GameStatePlay::logic() {
 	}
 
 	// these actions occur whether the game is paused or not.
+	hot_reload->logic();
 	checkTeleport();
 	checkLootDrop();
 	checkLog();
@@ -862,7 +1001,10 @@ void GameStatePlay::logic() {
 	checkNotifications();
 	checkCancel();
 
-	mapr->logic();
+	{
+		ProfileScope scope(PROFILE_LOGIC_MAP);
+		mapr->logic();
+	}
 	mapr->enemies_cleared = enemies->isCleared();
 	quests->logic();
 
@@ -955,52 +1097,128 @@ void GameStatePlay::logic() {
 	}
 }
 
-
 /**
- * Render all graphics for a single frame
+ * Create a list of Renderables from all objects not already on the map.
+ * Split the list into the beings alive (may move) and dead beings (must not move)
+ * If pipelined, the managers are collected by a background task, and finishRenderLists() waits for it.
  */
-void GameStatePlay::render() {
+void GameStatePlay::startRenderLists(RenderFrame& frame, bool pipelined) {
+	releaseRenderFrame(frame);
+
+	// the hero may composite its layers with the render device, so it stays on the main thread
+	pc->addRenders(frame.r);
+
+	// enemies record where they are drawn, so that enemyFocus() doesn't have to place them again
+	mapr->pick_buffer.reset(mapr->getRenderCam());
+	mapr->prepareCulling();
+	frame.cam = mapr->getRenderCam();
+	frame.map = mapr->getFilename();
+
+	// the task and renderTooltips() both query the loot grid, so it must not need a rebuild
+	loot->updateGrid();
+
+	if (pipelined)
+		render_task = workers->addTask(render_task_run, NULL, &render_jobs);
+	else
+		workers->parallelFor(render_job, &render_jobs, RENDER_JOB_COUNT, 1);
+}
 
-	// Create a list of Renderables from all objects not already on the map.
-	// split the list into the beings alive (may move) and dead beings (must not move)
-	std::vector<Renderable> rens;
-	std::vector<Renderable> rens_dead;
+void GameStatePlay::finishRenderLists(RenderFrame& frame) {
+	if (render_task != 0) {
+		workers->waitForTask(render_task);
+		render_task = 0;
+	}
+
+	// merged in a fixed order, so that the sorters in MapRenderer::render() get the same order as the last frame
+	for (size_t i = 0; i < render_jobs.lists.size(); ++i) {
+		const RenderJobList &list = render_jobs.lists[i];
+		frame.r.insert(frame.r.end(), list.r.begin(), list.r.end());
+		frame.r_dead.insert(frame.r_dead.end(), list.r_dead.begin(), list.r_dead.end());
+	}
 
-	pc->addRenders(rens);
+	for (size_t i = 0; i < frame.r.size(); ++i)
+		if (frame.r[i].image) frame.r[i].image->ref();
+	for (size_t i = 0; i < frame.r_dead.size(); ++i)
+		if (frame.r_dead[i].image) frame.r_dead[i].image->ref();
 
-	enemies->addRenders(rens, rens_dead);
+	frame.valid = true;
+}
 
-	npcs->addRenders(rens); // npcs cannot be dead
+void GameStatePlay::releaseRenderFrame(RenderFrame& frame) {
+	if (frame.valid) {
+		for (size_t i = 0; i < frame.r.size(); ++i)
+			if (frame.r[i].image) frame.r[i].image->unref();
+		for (size_t i = 0; i < frame.r_dead.size(); ++i)
+			if (frame.r_dead[i].image) frame.r_dead[i].image->unref();
+	}
 
-	loot->addRenders(rens, rens_dead);
+	frame.r.clear();
+	frame.r_dead.clear();
+	frame.valid = false;
+}
+
+/**
+ * Render all graphics for a single frame
+ */
+void GameStatePlay::render() {
+	RenderFrame &back = render_frames[render_back];
+	RenderFrame &front = render_frames[1 - render_back];
 
-	hazards->addRenders(rens, rens_dead);
+	// With the pipeline, the sprites of this frame are collected on a worker thread while the last frame's are drawn.
+	// The last frame is only drawn if it was collected on the same map.
+	const bool pipelined = RENDER_PIPELINE && front.valid && front.map == mapr->getFilename();
 
+	startRenderLists(back, pipelined);
 
 	// render the static map layers plus the renderables
-	mapr->render(rens, rens_dead);
+	RenderFrame &drawn = pipelined ? front : back;
+	if (!pipelined)
+		finishRenderLists(back);
+	mapr->render(drawn.r, drawn.r_dead, drawn.cam);
 
-	// mouseover tooltips
-	loot->renderTooltips(mapr->cam);
+	// mouseover tooltips, placed with the same camera as the sprites they belong to
+	loot->renderTooltips(drawn.cam);
 
 	if (mapr->map_change) {
-		menu->mini->prerender(&mapr->collider, mapr->w, mapr->h);
+		menu->mini->update(&mapr->collider);
 		mapr->map_change = false;
 	}
-	menu->mini->setMapTitle(mapr->title);
-	menu->mini->render(pc->stats.pos);
-	menu->render();
 
-	// render combat text last - this should make it obvious you're being
-	// attacked, even if you have menus open
-	if (!isPaused())
-		comb->render();
+	{
+		ProfileScope scope(PROFILE_RENDER_MENUS);
+
+		menu->mini->setMapTitle(mapr->title);
+		menu->mini->render(pc->stats.pos);
+		menu->render();
+
+		// render combat text last - this should make it obvious you're being
+		// attacked, even if you have menus open
+		if (!isPaused())
+			comb->render();
+	}
+
+	// logic may not run until the worker is done with the game state
+	if (pipelined)
+		finishRenderLists(back);
+
+	render_back = 1 - render_back;
 }
 
 bool GameStatePlay::isPaused() {
 	return menu->pause;
 }
 
+bool GameStatePlay::isIdle() {
+	return isPaused() || menu->talker->visible;
+}
+
+void GameStatePlay::restoreGraphics() {
+	releaseRenderFrame(render_frames[0]);
+	releaseRenderFrame(render_frames[1]);
+	mapr->clearRenderCaches();
+	menu->mini->prerender(&mapr->collider, mapr->w, mapr->h);
+}
+
 void GameStatePlay::resetNPC() {
 	npc_id = -1;
 	npc_from_map = true;
@@ -1048,6 +1266,11 @@ bool GameStatePlay::checkPrimaryStat(const std::string& first, const std::string
 }
 
 GameStatePlay::~GameStatePlay() {
+	releaseRenderFrame(render_frames[0]);
+	releaseRenderFrame(render_frames[1]);
+
+	delete hot_reload;
+	delete benchmark;
 	delete quests;
 	delete npcs;
 	delete hazards;
@@ -1061,6 +1284,7 @@ GameStatePlay::~GameStatePlay() {
 	delete powers;
 
 	delete enemyg;
+	delete stress;
 
 	// NULL-ify shared game resources
 	menu_powers = NULL;
@@ -1073,5 +1297,6 @@ GameStatePlay::~GameStatePlay() {
 	items = NULL;
 	pc = NULL;
 	menu = NULL;
+	stress = NULL;
 }
 
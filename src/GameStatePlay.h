@@ -31,13 +31,18 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "GameState.h"
 #include "PowerManager.h"
 #include "Utils.h"
+#include "WorkerPool.h"
 
 class Avatar;
 class Enemy;
+class EnemyManager;
 class HazardManager;
+class HotReload;
+class LootManager;
 class MenuManager;
 class NPCManager;
 class QuestLog;
+class RenderBenchmark;
 class WidgetLabel;
 
 class ActionData;
@@ -63,6 +68,46 @@ public:
 	}
 };
 
+// the renderables collected by one of the render jobs of GameStatePlay::startRenderLists()
+class RenderJobList {
+public:
+	std::vector<Renderable> r;
+	std::vector<Renderable> r_dead;
+};
+
+// the data of the render jobs: one list per job, and the managers they collect from
+class RenderJobContext {
+public:
+	std::vector<RenderJobList> lists;
+	EnemyManager *enemies;
+	NPCManager *npcs;
+	LootManager *loot;
+	HazardManager *hazards;
+
+	RenderJobContext()
+		: enemies(NULL)
+		, npcs(NULL)
+		, loot(NULL)
+		, hazards(NULL) {
+	}
+};
+
+// the world render lists of one frame, and the camera and map they were collected for
+// The lists hold a reference to each of their images, so that a frame can still be drawn after logic freed them.
+class RenderFrame {
+public:
+	std::vector<Renderable> r;
+	std::vector<Renderable> r_dead;
+	FPoint cam;
+	std::string map;
+	bool valid;
+
+	RenderFrame()
+		: cam()
+		, valid(false) {
+	}
+};
+
 class GameStatePlay : public GameState {
 private:
 	Enemy *enemy;
@@ -70,6 +115,8 @@ private:
 	HazardManager *hazards;
 	NPCManager *npcs;
 	QuestLog *quests;
+	HotReload *hot_reload;
+	RenderBenchmark *benchmark;
 
 	bool restrictPowerUse();
 	void checkEnemyFocus();
@@ -87,6 +134,10 @@ private:
 	void checkStash();
 	void checkCutscene();
 	void checkSaveEvent();
+	void savePrevPositions();
+	void startRenderLists(RenderFrame& frame, bool pipelined);
+	void finishRenderLists(RenderFrame& frame);
+	void releaseRenderFrame(RenderFrame& frame);
 	void updateActionBar(unsigned index = 0);
 	void loadTitles();
 	void resetNPC();
@@ -103,12 +154,24 @@ private:
 
 	int menu_enemy_timeout;
 
+	// objects not already on the map, in the order they are collected; kept between frames to reuse their memory
+	// the lists are double-buffered: with RENDER_PIPELINE, the back one is filled while the front one is drawn
+	// Otherwise the back one is filled and drawn right away. They are kept between frames to reuse their memory.
+	RenderFrame render_frames[2];
+	unsigned render_back;
+	WorkerTaskID render_task;
+
+	// the lists of the managers that are collected in parallel, merged into the back frame
+	RenderJobContext render_jobs;
+
 public:
 	GameStatePlay();
 	~GameStatePlay();
 	void refreshWidgets();
 
 	bool isPaused();
+	bool isIdle();
+	void restoreGraphics();
 	void logic();
 	void render();
 	void resetGame();
@@ -35,6 +35,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "GameSwitcher.h"
 #include "GameStateTitle.h"
 #include "GameStateCutscene.h"
+#include "Random.h"
 #include "SharedResources.h"
 #include "Settings.h"
 #include "FileParser.h"
@@ -45,8 +46,13 @@ GameSwitcher::GameSwitcher()
 	: background(NULL)
 	, background_image(NULL)
 	, background_filename("")
+	, next_background_filename("")
+	, music_filename("")
+	, music_filename_loaded(false)
 	, fps_ticks(0)
 	, last_fps(0)
+	, missed_frames(0)
+	, slowed_frames(0)
 {
 
 	// The initial state is the intro cutscene and then title screen
@@ -75,19 +81,22 @@ void GameSwitcher::loadMusic() {
 	if (!AUDIO) return;
 
 	if (MUSIC_VOLUME > 0) {
-		std::string music_filename = "";
-		FileParser infile;
-		// @CLASS GameSwitcher: Default music|Description of engine/default_music.txt
-		if (infile.open("engine/default_music.txt", true, "")) {
-			while (infile.next()) {
-				// @ATTR music|filename|Filename of a music file to play during game states that don't already have music.
-				if (infile.key == "music") music_filename = infile.val;
-				else infile.error("GameSwitcher: '%s' is not a valid key.", infile.key.c_str());
+		if (!music_filename_loaded) {
+			FileParser infile;
+			// @CLASS GameSwitcher: Default music|Description of engine/default_music.txt
+			if (infile.open("engine/default_music.txt", true, "")) {
+				while (infile.next()) {
+					// @ATTR music|filename|Filename of a music file to play during game states that don't already have music.
+					if (infile.key == "music") music_filename = infile.val;
+					else infile.error("GameSwitcher: '%s' is not a valid key.", infile.key.c_str());
+				}
+				infile.close();
 			}
-			infile.close();
+			music_filename_loaded = true;
 		}
 
 		//load and play music
+		// the file is opened on the sound manager's loader thread
 		snd->loadMusic(music_filename);
 	}
 	else {
@@ -97,6 +106,7 @@ void GameSwitcher::loadMusic() {
 
 void GameSwitcher::loadBackgroundList() {
 	background_list.clear();
+	next_background_filename = "";
 	freeBackground();
 
 	FileParser infile;
@@ -116,25 +126,37 @@ void GameSwitcher::loadBackgroundImage() {
 
 	if (background_filename != "") return;
 
+	prefetchBackground();
+	background_filename = next_background_filename;
+	next_background_filename = "";
+
+	// if the image is still being decoded, logic() loads it once it's ready
+	if (render_device->isImagePending(background_filename))
+		return;
+
 	// load the background image
-	size_t index = static_cast<size_t>(rand()) % background_list.size();
-	background_filename = background_list[index];
 	background_image = render_device->loadImage(background_filename);
 	refreshBackground();
 }
 
+void GameSwitcher::prefetchBackground() {
+	if (background_list.empty() || next_background_filename != "") return;
+
+	size_t index = randIndex(background_list.size(), RANDOM_VISUAL);
+	next_background_filename = background_list[index];
+	render_device->requestImage(next_background_filename);
+}
+
 void GameSwitcher::refreshBackground() {
 	if (background_image) {
-		background_image->ref();
 		Rect dest = resizeToScreen(background_image->getWidth(), background_image->getHeight(), true, ALIGN_CENTER);
 
-		Image *resized = background_image->resize(dest.w, dest.h);
-		if (resized) {
+		Sprite *scaled = render_device->createScaledSprite(background_image, dest.w, dest.h);
+		if (scaled) {
 			if (background)
 				delete background;
 
-			background = resized->createSprite();
-			resized->unref();
+			background = scaled;
 		}
 
 		if (background)
@@ -158,6 +180,18 @@ void GameSwitcher::logic() {
 	// reset the mouse cursor
 	curs->logic();
 
+	// what was drawn into images is gone after the renderer lost its context
+	if (render_device->lostRenderTargets()) {
+		font->clearGlyphCache();
+		comb->clearGlyphCache();
+		currentState->restoreGraphics();
+	}
+
+	snd->updateMusic();
+
+	if (icons)
+		icons->logic();
+
 	// Check if a the game state is to be changed and change it if necessary, deleting the old state
 	GameState* newState = currentState->getRequestedGameState();
 	if (newState != NULL) {
@@ -177,10 +211,21 @@ void GameSwitcher::logic() {
 				loadMusic();
 
 		// if this game state shows a background image, load it here
+		// otherwise, the one for the next menu is decoded while this state runs
 		if (currentState->has_background)
 			loadBackgroundImage();
-		else
+		else {
 			freeBackground();
+			prefetchBackground();
+		}
+	}
+
+	// show the background image once it has been decoded
+	if (currentState->has_background && !background_image && background_filename != "" && !render_device->isImagePending(background_filename)) {
+		background_image = render_device->loadImage(background_filename);
+		if (!background_image)
+			background_filename = "";
+		refreshBackground();
 	}
 
 	// resize background image when window is resized
@@ -194,23 +239,34 @@ void GameSwitcher::logic() {
 	done = currentState->isExitRequested();
 
 	if (currentState->reload_music) {
+		// the mods may have changed
+		music_filename_loaded = false;
 		loadMusic();
 		currentState->reload_music = false;
 	}
 }
 
-void GameSwitcher::showFPS(float fps) {
+void GameSwitcher::showFPS(float fps, unsigned missed, unsigned slowed) {
 	if (SHOW_FPS && SHOW_HUD) {
 		if (!label_fps) label_fps = new WidgetLabel();
+		missed_frames += missed;
+		slowed_frames += slowed;
 		if (fps_ticks == 0) {
 			fps_ticks = MAX_FRAMES_PER_SEC / 4;
 
 			float avg_fps = (fps + last_fps) / 2.f;
 			last_fps = fps;
-			std::string sfps = floatToString(avg_fps, 2) + std::string (" fps");
+			std::stringstream sfps;
+			sfps << floatToString(avg_fps, 2) << " fps";
+			if (missed_frames > 0)
+				sfps << ", " << missed_frames << " missed";
+			missed_frames = 0;
+			if (slowed_frames > 0)
+				sfps << ", slow motion";
+			slowed_frames = 0;
 			Rect pos = fps_position;
 			alignToScreenEdge(fps_corner, &pos);
-			label_fps->set(pos.x, pos.y, JUSTIFY_LEFT, VALIGN_TOP, sfps, fps_color);
+			label_fps->set(pos.x, pos.y, JUSTIFY_LEFT, VALIGN_TOP, sfps.str(), fps_color);
 		}
 		label_fps->render();
 		fps_ticks--;
@@ -265,6 +321,10 @@ bool GameSwitcher::isPaused() {
 	return currentState->isPaused();
 }
 
+bool GameSwitcher::isIdle() {
+	return currentState->isIdle();
+}
+
 void GameSwitcher::render() {
 	// display background
 	if (background && currentState->has_background) {
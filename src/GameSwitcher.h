@@ -49,6 +49,9 @@ private:
 	void refreshBackground();
 	void freeBackground();
 
+	// picks the next background and starts decoding it in the background
+	void prefetchBackground();
+
 	GameState *currentState;
 
 	WidgetLabel *label_fps;
@@ -59,10 +62,17 @@ private:
 	Sprite *background;
 	Image *background_image;
 	std::string background_filename;
+	std::string next_background_filename;
 	std::vector<std::string> background_list;
 
+	// read from engine/default_music.txt once
+	std::string music_filename;
+	bool music_filename_loaded;
+
 	int fps_ticks;
 	float last_fps;
+	unsigned missed_frames; // frames that missed their deadline since the fps label was updated
+	unsigned slowed_frames; // logic frames that were dropped to keep up, since the fps label was updated
 
 public:
 	GameSwitcher();
@@ -74,9 +84,10 @@ public:
 	void loadFPS();
 	bool isLoadingFrame();
 	bool isPaused();
+	bool isIdle();
 	void logic();
 	void render();
-	void showFPS(float fps);
+	void showFPS(float fps, unsigned missed, unsigned slowed);
 	void saveUserSettings();
 	bool done;
 };
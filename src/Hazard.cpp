@@ -26,8 +26,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Animation.h"
 #include "AnimationSet.h"
 #include "AnimationManager.h"
+#include "Entity.h"
 #include "Hazard.h"
 #include "MapCollision.h"
+#include "MapRenderer.h"
+#include "SharedGameResources.h"
 #include "SharedResources.h"
 #include "StatBlock.h"
 #include "Settings.h"
@@ -36,6 +39,38 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <cmath>
 
+/**
+ * Slots that are available for new hazards. The blocks themselves are kept
+ * until the game exits, so the pool only grows to the peak number of hazards.
+ */
+static std::vector<void*>& getHazardFreeSlots() {
+	static std::vector<void*> free_slots;
+	return free_slots;
+}
+
+void* Hazard::operator new(size_t size) {
+	// derived classes are not pooled
+	if (size != sizeof(Hazard))
+		return ::operator new(size);
+
+	std::vector<void*>& free_slots = getHazardFreeSlots();
+	if (free_slots.empty()) {
+		char *block = static_cast<char*>(::operator new(sizeof(Hazard) * HAZARD_POOL_BLOCK_SIZE));
+		free_slots.reserve(free_slots.size() + HAZARD_POOL_BLOCK_SIZE);
+		for (size_t i = HAZARD_POOL_BLOCK_SIZE; i > 0; i--)
+			free_slots.push_back(block + sizeof(Hazard) * (i-1));
+	}
+
+	void *ptr = free_slots.back();
+	free_slots.pop_back();
+	return ptr;
+}
+
+void Hazard::operator delete(void* ptr) {
+	if (ptr)
+		getHazardFreeSlots().push_back(ptr);
+}
+
 Hazard::Hazard(MapCollision *_collider)
 	: collider(_collider)
 	, activeAnimation(NULL)
@@ -48,6 +83,7 @@ Hazard::Hazard(MapCollision *_collider)
 	, source_type(0)
 	, target_party(false)
 	, pos()
+	, prev_pos()
 	, speed()
 	, pos_offset()
 	, relative_pos(false)
@@ -104,9 +140,7 @@ Hazard::~Hazard() {
 			new_parent->children.push_back(children[i]);
 		}
 
-		for (size_t i = 0; i < entitiesCollided.size(); ++i) {
-			new_parent->addEntity(entitiesCollided[i]);
-		}
+		new_parent->hit_entities.swap(hit_entities);
 	}
 	else if (parent) {
 		// remove this hazard from the parent's list of children
@@ -119,21 +153,18 @@ Hazard::~Hazard() {
 	}
 
 	if (activeAnimation) {
-		anim->decreaseCount(animation_name);
+		if (animation_name != "")
+			anim->decreaseCount(animation_name);
 		delete activeAnimation;
 	}
 }
 
-void Hazard::logic() {
-
-	// if the hazard is on delay, take no action
-	if (delay_frames > 0) {
-		delay_frames--;
-		return;
-	}
-
-	// handle tickers
-	if (lifespan > 0) lifespan--;
+/**
+ * Called once per frame for a hazard that isn't on delay.
+ * HazardManager has already counted down delay_frames and lifespan, and it
+ * has moved the hazard by its speed.
+ */
+void Hazard::logic(const FPoint& start_pos) {
 
 	if (expire_with_caster && !src_stats->alive)
 		lifespan = 0;
@@ -142,64 +173,72 @@ void Hazard::logic() {
 		activeAnimation->advanceFrame();
 
 	// handle movement
-	bool check_collide = false;
 	if (!(speed.x == 0 && speed.y == 0)) {
-		pos.x += speed.x;
-		pos.y += speed.y;
-		check_collide = true;
+		// sweep the whole step, so that fast hazards can't pass through thin walls
+		const FPoint dest = pos;
+		FPoint normal;
+		if (!collider->sweep(start_pos, pos, movement_type, false, false, &normal)) {
+
+			hit_wall = true;
+
+			if (wall_reflect) {
+				this->reflect(normal);
+			}
+			else {
+				lifespan = 0;
+				if (collider->is_outside_map(int(dest.x), int(dest.y)))
+					remove_now = true;
+			}
+		}
 	}
 	else if (!(pos_offset.x == 0 && pos_offset.y == 0)) {
 		pos.x = src_stats->pos.x - pos_offset.x;
 		pos.y = src_stats->pos.y - pos_offset.y;
-		check_collide = true;
-	}
-	else if (relative_pos) {
-		pos.x = src_stats->pos.x;
-		pos.y = src_stats->pos.y;
-	}
 
-	if (check_collide) {
-		// very simplified collider, could skim around corners
-		// or even pass through thin walls if speed > tilesize
 		if (!collider->is_valid_position(pos.x, pos.y, movement_type, false, false)) {
 
 			hit_wall = true;
 
 			if (wall_reflect) {
-				this->reflect();
+				this->reflect(FPoint());
 			}
 			else {
 				lifespan = 0;
 				if (collider->is_outside_map(int(pos.x), int(pos.y)))
 					remove_now = true;
-		    }
+			}
 		}
 	}
+	else if (relative_pos) {
+		pos.x = src_stats->pos.x;
+		pos.y = src_stats->pos.y;
+	}
 }
 
-void Hazard::reflect() {
-  if (!collider->is_wall(pos.x - speed.x, pos.y)) {
-    speed.x *= -1;
-	pos.x += speed.x;
-  }
-  else if (!collider->is_wall(pos.x, pos.y - speed.y)) {
-    speed.y *= -1;
-	pos.y += speed.y;
-  }
-  else {
-    speed.x *= -1;
-	speed.y *= -1;
+/**
+ * Bounce off the wall that was hit
+ * normal points away from the wall; without one, the hazard reverses its direction
+ */
+void Hazard::reflect(const FPoint& normal) {
+	if (normal.x != 0 || normal.y != 0) {
+		if (normal.x != 0) speed.x *= -1;
+		if (normal.y != 0) speed.y *= -1;
+	}
+	else {
+		speed.x *= -1;
+		speed.y *= -1;
+	}
 	pos.x += speed.x;
 	pos.y += speed.y;
-  }
 
-  if (directional)
-	animationKind = calcDirection(pos.x, pos.y, pos.x + speed.x, pos.y + speed.y);
+	if (directional)
+		animationKind = calcDirection(pos.x, pos.y, pos.x + speed.x, pos.y + speed.y);
 }
 
 void Hazard::loadAnimation(const std::string &s) {
 	if (activeAnimation) {
-		anim->decreaseCount(animation_name);
+		if (animation_name != "")
+			anim->decreaseCount(animation_name);
 		delete activeAnimation;
 		activeAnimation = 0;
 	}
@@ -211,6 +250,15 @@ void Hazard::loadAnimation(const std::string &s) {
 	}
 }
 
+/**
+ * Use an animation set that is already loaded and referenced by someone else (PowerManager)
+ */
+void Hazard::setAnimation(AnimationSet *set) {
+	loadAnimation("");
+	if (set)
+		activeAnimation = set->getAnimation(0);
+}
+
 bool Hazard::isDangerousNow() {
 	return active && (delay_frames == 0) &&
 		   ( (activeAnimation != NULL && activeAnimation->isActiveFrame())
@@ -226,9 +274,10 @@ bool Hazard::hasEntity(Entity *ent) {
 		return parent->hasEntity(ent);
 	}
 	else {
-		for(std::vector<Entity*>::iterator it = entitiesCollided.begin(); it != entitiesCollided.end(); ++it)
-			if(*it == ent) return true;
-		return false;
+		size_t word = ent->runtime_index / 32;
+		if (word >= hit_entities.size())
+			return false;
+		return (hit_entities[word] & (1u << (ent->runtime_index % 32))) != 0;
 	}
 }
 
@@ -237,17 +286,33 @@ void Hazard::addEntity(Entity *ent) {
 		parent->addEntity(ent);
 	}
 	else {
-		entitiesCollided.push_back(ent);
+		size_t word = ent->runtime_index / 32;
+		if (word >= hit_entities.size())
+			hit_entities.resize(word + 1, 0);
+		hit_entities[word] |= (1u << (ent->runtime_index % 32));
 	}
 }
 
+void Hazard::removeEntity(unsigned runtime_index) {
+	size_t word = runtime_index / 32;
+	if (word < hit_entities.size())
+		hit_entities[word] &= ~(1u << (runtime_index % 32));
+}
+
 void Hazard::addRenderable(std::vector<Renderable> &r, std::vector<Renderable> &r_dead) {
 	if (delay_frames == 0 && activeAnimation) {
-		Renderable re = activeAnimation->getCurrentFrame(animationKind);
-		re.map_pos.x = pos.x;
-		re.map_pos.y = pos.y;
+		const FPoint map_pos = calcInterpolatedPos(prev_pos, pos);
+		if (!mapr->isOnScreen(map_pos, activeAnimation->getBounds()))
+			return;
+
+		std::vector<Renderable> &dest = on_floor ? r_dead : r;
+		dest.push_back(Renderable());
+		Renderable &re = dest.back();
+		activeAnimation->getCurrentFrame(animationKind, re);
+		re.map_pos = map_pos;
 		re.prio = (on_floor ? 0 : 2);
-		(on_floor ? r_dead : r).push_back(re);
+		if (!mapr->isOnScreen(re))
+			dest.pop_back();
 	}
 }
 
@@ -48,14 +48,17 @@ const int SCRIPT_TRIGGER_CAST = 0;
 const int SCRIPT_TRIGGER_HIT = 1;
 const int SCRIPT_TRIGGER_WALL = 2;
 
+// hazards are allocated from blocks of this many slots
+const size_t HAZARD_POOL_BLOCK_SIZE = 64;
+
 class Hazard {
 private:
 	const MapCollision *collider;
-	// Keeps track of entities already hit
-	std::vector<Entity*> entitiesCollided;
+	// Keeps track of entities already hit, one bit per Entity::runtime_index
+	std::vector<uint32_t> hit_entities;
 	Animation *activeAnimation;
 	std::string animation_name;
-    void reflect();
+	void reflect(const FPoint& normal);
 
 public:
 	explicit Hazard(MapCollision *_collider);
@@ -65,14 +68,24 @@ public:
 
 	~Hazard();
 
+	// Hazards are created and destroyed in large numbers, so their memory comes from a pool.
+	// Freed slots are reused, and a hazard never moves while it is alive.
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr);
+
 	StatBlock *src_stats;
 
-	void logic();
+	// start_pos is where the hazard was before HazardManager moved it this frame
+	void logic(const FPoint& start_pos);
 
 	bool hasEntity(Entity*);
 	void addEntity(Entity*);
 
+	// forgets a hit on the entity that had this runtime index, once that entity is destroyed
+	void removeEntity(unsigned runtime_index);
+
 	void loadAnimation(const std::string &s);
+	void setAnimation(AnimationSet *set);
 
 	void setAngle(const float& _angle);
 
@@ -84,6 +97,7 @@ public:
 	bool target_party;
 
 	FPoint pos;
+	FPoint prev_pos; // pos at the start of the current logic frame
 	FPoint speed;
 	FPoint pos_offset;
 	bool relative_pos;
@@ -32,6 +32,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "SharedGameResources.h"
 #include "SharedResources.h"
 #include "UtilsMath.h"
+#include "VisualQuality.h"
 
 HazardManager::HazardManager()
 	: last_enemy(NULL)
@@ -54,24 +55,60 @@ HazardManager::HazardManager()
 
 void HazardManager::logic() {
 
+	// entities destroyed since the last frame, such as expired corpses, may have been hit already
+	// Their indices can only go to new entities once no hazard remembers those hits.
+	const std::vector<unsigned>& released = Entity::getReleasedRuntimeIndices();
+	if (!released.empty()) {
+		for (size_t i = 0; i < released.size(); ++i) {
+			for (size_t j = 0; j < h.size(); ++j)
+				h[j]->removeEntity(released[i]);
+			schedule.removeEntity(released[i]);
+		}
+		Entity::recycleRuntimeIndices();
+	}
+
 	// remove all hazards with lifespan 0.  Most hazards still display their last frame.
 	for (size_t i=h.size(); i>0; i--) {
-		if (h[i-1]->lifespan == 0) {
-			delete h[i-1];
-			h.erase(h.begin()+(i-1));
-		}
+		if (h[i-1]->lifespan == 0)
+			removeHazard(i-1);
+	}
+
+	// bring in the delayed hazards that have one frame of delay left
+	due.clear();
+	schedule.advance(due);
+	for (size_t i = 0; i < due.size(); ++i) {
+		due[i]->delay_frames = 1;
+		due[i]->prev_pos = due[i]->pos;
+		h.push_back(due[i]);
 	}
 
 	checkNewHazards();
 
+	// handle delays, lifespans and movement of all hazards at once
+	sim.load(h);
+	sim.update();
+
 	// handle single-frame transforms
 	for (size_t i=h.size(); i>0; i--) {
-		h[i-1]->logic();
+		Hazard *haz = h[i-1];
+		const FPoint start_pos = haz->pos;
+		haz->pos.x = sim.pos_x[i-1];
+		haz->pos.y = sim.pos_y[i-1];
+		haz->lifespan = sim.lifespan[i-1];
+		haz->delay_frames = sim.delay_frames[i-1];
+
+		// if the hazard is on delay, take no action
+		if (sim.waiting[i-1]) {
+			sim.dangerous[i-1] = haz->isDangerousNow();
+			continue;
+		}
+
+		haz->logic(start_pos);
 
 		// remove all hazards that need to die immediately (e.g. exit the map)
-		if (h[i-1]->remove_now) {
-			delete h[i-1];
-			h.erase(h.begin()+(i-1));
+		if (haz->remove_now) {
+			removeHazard(i-1);
+			sim.remove(i-1);
 			continue;
 		}
 
@@ -82,7 +119,7 @@ void HazardManager::logic() {
 				EventManager::executeScript(h[i-1]->script, h[i-1]->pos.x, h[i-1]->pos.y);
 			}
 
-			if (h[i-1]->wall_power > 0 && percentChance(h[i-1]->wall_power_chance)) {
+			if (h[i-1]->wall_power > 0 && percentChance(h[i-1]->wall_power_chance, RANDOM_COMBAT)) {
 				powers->activate(h[i-1]->wall_power, h[i-1]->src_stats, h[i-1]->pos);
 
 				if (powers->powers[h[i-1]->wall_power].directional) {
@@ -94,26 +131,40 @@ void HazardManager::logic() {
 			h[i-1]->hit_wall = false;
 		}
 
+		// the position may have been changed by following the caster or reflecting off a wall
+		sim.pos_x[i-1] = haz->pos.x;
+		sim.pos_y[i-1] = haz->pos.y;
+		sim.dangerous[i-1] = haz->isDangerousNow();
 	}
 
 	bool hit;
 
 	// handle collisions
 	for (size_t i=0; i<h.size(); i++) {
-		if (h[i]->isDangerousNow()) {
+		if (sim.dangerous[i]) {
+			// the hazard's side of the hit only needs to be worked out once for everything it hits
+			hit_context.set(h[i]);
+
+			const FPoint hpos(sim.pos_x[i], sim.pos_y[i]);
+			const float hradius = sim.radius[i];
+
+			// only the entities near the hazard can be hit
+			mapr->entity_grid.query(hpos, hradius, nearby);
 
 			// process hazards that can hurt enemies
 			if (h[i]->source_type != SOURCE_TYPE_ENEMY) { //hero or neutral sources
-				for (unsigned int eindex = 0; eindex < enemies->enemies.size(); eindex++) {
+				for (size_t eindex = 0; eindex < nearby.size(); eindex++) {
+					Enemy *e = static_cast<Enemy*>(nearby[eindex]);
 
 					// only check living enemies
-					if (enemies->enemies[eindex]->stats.hp > 0 && h[i]->active && (enemies->enemies[eindex]->stats.hero_ally == h[i]->target_party)) {
-						if (isWithinRadius(h[i]->pos, h[i]->radius, enemies->enemies[eindex]->stats.pos)) {
-							if (!h[i]->hasEntity(enemies->enemies[eindex])) {
-								h[i]->addEntity(enemies->enemies[eindex]);
-								if (!h[i]->beacon) last_enemy = enemies->enemies[eindex];
+					if (e->stats.hp > 0 && h[i]->active && (e->stats.hero_ally == h[i]->target_party)) {
+						if (isWithinRadius(hpos, hradius, e->stats.pos)) {
+							if (!h[i]->hasEntity(e)) {
+								h[i]->addEntity(e);
+								if (!h[i]->beacon) last_enemy = e;
 								// hit!
-								hit = enemies->enemies[eindex]->takeHit(*h[i]);
+								hit = e->takeHit(hit_context);
+								mapr->entity_registry.update(e);
 								hitEntity(i, hit);
 							}
 						}
@@ -125,25 +176,28 @@ void HazardManager::logic() {
 			// process hazards that can hurt the hero
 			if (h[i]->source_type != SOURCE_TYPE_HERO && h[i]->source_type != SOURCE_TYPE_ALLY) { //enemy or neutral sources
 				if (pc->stats.hp > 0 && h[i]->active) {
-					if (isWithinRadius(h[i]->pos, h[i]->radius, pc->stats.pos)) {
+					if (isWithinRadius(hpos, hradius, pc->stats.pos)) {
 						if (!h[i]->hasEntity(pc)) {
 							h[i]->addEntity(pc);
 							// hit!
-							hit = pc->takeHit(*h[i]);
+							hit = pc->takeHit(hit_context);
 							hitEntity(i, hit);
 						}
 					}
 				}
 
 				//now process allies
-				for (unsigned int eindex = 0; eindex < enemies->enemies.size(); eindex++) {
+				for (size_t eindex = 0; eindex < nearby.size(); eindex++) {
+					Enemy *e = static_cast<Enemy*>(nearby[eindex]);
+
 					// only check living allies
-					if (enemies->enemies[eindex]->stats.hp > 0 && h[i]->active && enemies->enemies[eindex]->stats.hero_ally) {
-						if (isWithinRadius(h[i]->pos, h[i]->radius, enemies->enemies[eindex]->stats.pos)) {
-							if (!h[i]->hasEntity(enemies->enemies[eindex])) {
-								h[i]->addEntity(enemies->enemies[eindex]);
+					if (e->stats.hp > 0 && h[i]->active && e->stats.hero_ally) {
+						if (isWithinRadius(hpos, hradius, e->stats.pos)) {
+							if (!h[i]->hasEntity(e)) {
+								h[i]->addEntity(e);
 								// hit!
-								hit = enemies->enemies[eindex]->takeHit(*h[i]);
+								hit = e->takeHit(hit_context);
+								mapr->entity_registry.update(e);
 								hitEntity(i, hit);
 							}
 						}
@@ -152,10 +206,90 @@ void HazardManager::logic() {
 
 			}
 
+			hit_context.finish();
 		}
 	}
 }
 
+void HazardSimulation::load(const std::vector<Hazard*>& h) {
+	const size_t count = h.size();
+	pos_x.resize(count);
+	pos_y.resize(count);
+	speed_x.resize(count);
+	speed_y.resize(count);
+	radius.resize(count);
+	lifespan.resize(count);
+	delay_frames.resize(count);
+	waiting.resize(count);
+	dangerous.resize(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		const Hazard *haz = h[i];
+		pos_x[i] = haz->pos.x;
+		pos_y[i] = haz->pos.y;
+		speed_x[i] = haz->speed.x;
+		speed_y[i] = haz->speed.y;
+		radius[i] = haz->radius;
+		lifespan[i] = haz->lifespan;
+		delay_frames[i] = haz->delay_frames;
+	}
+}
+
+/**
+ * Counts down delays and lifespans and moves the hazards by their speed.
+ * A hazard that is still on delay does nothing else this frame.
+ */
+void HazardSimulation::update() {
+	const size_t count = pos_x.size();
+
+	for (size_t i = 0; i < count; ++i) {
+		const bool wait = delay_frames[i] > 0;
+		waiting[i] = wait;
+		delay_frames[i] -= wait;
+		lifespan[i] -= (!wait && lifespan[i] > 0);
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		const float step = waiting[i] ? 0.0f : 1.0f;
+		pos_x[i] += speed_x[i] * step;
+		pos_y[i] += speed_y[i] * step;
+	}
+}
+
+/**
+ * Mirrors HazardManager::removeHazard()
+ */
+void HazardSimulation::remove(size_t index) {
+	pos_x[index] = pos_x.back();
+	pos_x.pop_back();
+	pos_y[index] = pos_y.back();
+	pos_y.pop_back();
+	speed_x[index] = speed_x.back();
+	speed_x.pop_back();
+	speed_y[index] = speed_y.back();
+	speed_y.pop_back();
+	radius[index] = radius.back();
+	radius.pop_back();
+	lifespan[index] = lifespan.back();
+	lifespan.pop_back();
+	delay_frames[index] = delay_frames.back();
+	delay_frames.pop_back();
+	waiting[index] = waiting.back();
+	waiting.pop_back();
+	dangerous[index] = dangerous.back();
+	dangerous.pop_back();
+}
+
+/**
+ * Deletes a hazard by moving the last one into its place.
+ * When iterating backwards, the moved hazard has already been visited.
+ */
+void HazardManager::removeHazard(size_t index) {
+	delete h[index];
+	h[index] = h.back();
+	h.pop_back();
+}
+
 void HazardManager::hitEntity(size_t index, const bool hit) {
 	if (!hit) return;
 
@@ -173,6 +307,19 @@ void HazardManager::hitEntity(size_t index, const bool hit) {
 	}
 }
 
+/**
+ * Hazards with more than one frame of delay are scheduled instead of added to h.
+ * They are added on the frame their delay would have counted down to 1, so the last
+ * frame of the delay is handled the same way as before.
+ * Hazards without a lifespan are removed on the next frame anyway, so they aren't scheduled.
+ */
+void HazardManager::addHazard(Hazard* haz) {
+	if (haz->delay_frames > 1 && haz->lifespan > 0)
+		schedule.add(haz, haz->delay_frames - 1);
+	else
+		h.push_back(haz);
+}
+
 /**
  * Look for hazards generated this frame
  */
@@ -183,19 +330,19 @@ void HazardManager::checkNewHazards() {
 		Hazard *new_haz = powers->hazards.front();
 		powers->hazards.pop();
 
-		h.push_back(new_haz);
+		addHazard(new_haz);
 	}
 
 	// check hero hazards
 	if (pc->haz != NULL) {
-		h.push_back(pc->haz);
+		addHazard(pc->haz);
 		pc->haz = NULL;
 	}
 
 	// check monster hazards
 	for (unsigned int eindex = 0; eindex < enemies->enemies.size(); eindex++) {
 		if (enemies->enemies[eindex]->haz != NULL) {
-			h.push_back(enemies->enemies[eindex]->haz);
+			addHazard(enemies->enemies[eindex]->haz);
 			enemies->enemies[eindex]->haz = NULL;
 		}
 	}
@@ -209,6 +356,7 @@ void HazardManager::handleNewMap() {
 		delete h[i];
 	}
 	h.clear();
+	schedule.clear();
 	last_enemy = NULL;
 }
 
@@ -218,8 +366,19 @@ void HazardManager::handleNewMap() {
  * to collect all mobile sprites each frame.
  */
 void HazardManager::addRenders(std::vector<Renderable> &r, std::vector<Renderable> &r_dead) {
+	// under load, hazards of the same power on the same spot look like one, so only one of them is drawn
+	const bool skip_overlapping = getVisualQuality() >= VISUAL_QUALITY_REDUCED;
+	drawn_spots.clear();
+
 	for (unsigned int i=0; i<h.size(); i++) {
-		h[i]->addRenderable(r, r_dead);
+		bool overlapping = false;
+		if (skip_overlapping && h[i]->delay_frames == 0) {
+			const std::pair<int, int> spot(static_cast<int>(floorf(h[i]->pos.x * 2)), static_cast<int>(floorf(h[i]->pos.y * 2)));
+			overlapping = !drawn_spots.insert(std::make_pair(h[i]->power_index, spot)).second;
+		}
+
+		if (!overlapping)
+			h[i]->addRenderable(r, r_dead);
 
 		if (DEV_MODE && DEV_HUD && h[i]->delay_frames == 0) {
 			dev_marker.map_pos = h[i]->pos;
@@ -237,3 +396,69 @@ HazardManager::~HazardManager() {
 
 	dev_marker.image->unref();
 }
+
+HazardSchedule::HazardSchedule()
+	: slots(HAZARD_SCHEDULE_SLOTS)
+	, current(0)
+	, count(0) {
+}
+
+HazardSchedule::~HazardSchedule() {
+	clear();
+}
+
+void HazardSchedule::add(Hazard* haz, int frames) {
+	if (frames < 1)
+		frames = 1;
+
+	const size_t offset = static_cast<size_t>(frames);
+
+	Entry entry;
+	entry.haz = haz;
+	entry.turns = static_cast<int>((offset - 1) / HAZARD_SCHEDULE_SLOTS);
+	slots[(current + offset) % HAZARD_SCHEDULE_SLOTS].push_back(entry);
+	count++;
+}
+
+void HazardSchedule::advance(std::vector<Hazard*>& due) {
+	current = (current + 1) % HAZARD_SCHEDULE_SLOTS;
+	if (count == 0)
+		return;
+
+	// keep the order hazards were added in, so hazards spawned together are released together in order
+	std::vector<Entry>& slot = slots[current];
+	size_t kept = 0;
+	for (size_t i = 0; i < slot.size(); ++i) {
+		if (slot[i].turns == 0) {
+			due.push_back(slot[i].haz);
+			count--;
+		}
+		else {
+			slot[i].turns--;
+			slot[kept++] = slot[i];
+		}
+	}
+	slot.resize(kept);
+}
+
+void HazardSchedule::removeEntity(unsigned runtime_index) {
+	for (size_t i = 0; i < slots.size(); ++i) {
+		for (size_t j = 0; j < slots[i].size(); ++j) {
+			slots[i][j].haz->removeEntity(runtime_index);
+		}
+	}
+}
+
+void HazardSchedule::clear() {
+	for (size_t i = 0; i < slots.size(); ++i) {
+		for (size_t j = 0; j < slots[i].size(); ++j) {
+			delete slots[i][j].haz;
+		}
+		slots[i].clear();
+	}
+	count = 0;
+}
+
+size_t HazardSchedule::size() const {
+	return count;
+}
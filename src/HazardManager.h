@@ -26,16 +26,95 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #define HAZARD_MANAGER_H
 
 #include "CommonIncludes.h"
+#include "Entity.h"
 #include "Utils.h"
 
 class Avatar;
+class Entity;
 class Hazard;
 
+/**
+ * The state of all hazards that is touched every frame, kept in parallel arrays.
+ * Index i belongs to HazardManager::h[i]. The arrays are filled from the hazards
+ * at the start of each frame, so that ticking, movement and the overlap tests
+ * can run as simple loops over contiguous memory.
+ */
+class HazardSimulation {
+public:
+	std::vector<float> pos_x;
+	std::vector<float> pos_y;
+	std::vector<float> speed_x;
+	std::vector<float> speed_y;
+	std::vector<float> radius;
+	std::vector<int> lifespan;
+	std::vector<int> delay_frames;
+	std::vector<uint8_t> waiting;
+	std::vector<uint8_t> dangerous;
+
+	void load(const std::vector<Hazard*>& h);
+	void update();
+	void remove(size_t index);
+};
+
+const size_t HAZARD_SCHEDULE_SLOTS = 64;
+
+/**
+ * Hazards that are still on delay, kept out of HazardManager::h until they are due.
+ * This is a timing wheel: each frame moves to the next slot, and a hazard is put in
+ * the slot that will be current on the frame it is due. Hazards due more than one
+ * turn of the wheel away also count the turns that are left.
+ */
+class HazardSchedule {
+public:
+	HazardSchedule();
+	~HazardSchedule();
+
+	// haz will be returned by the frames-th call to advance() from now; frames must be at least 1
+	void add(Hazard* haz, int frames);
+
+	// moves to the next frame and appends the hazards that are due to 'due'
+	void advance(std::vector<Hazard*>& due);
+
+	// deletes all scheduled hazards
+	void clear();
+
+	// calls Hazard::removeEntity() on all scheduled hazards
+	void removeEntity(unsigned runtime_index);
+
+	size_t size() const;
+
+private:
+	class Entry {
+	public:
+		Hazard* haz;
+		int turns;
+	};
+
+	std::vector< std::vector<Entry> > slots;
+	size_t current;
+	size_t count;
+};
+
 class HazardManager {
 private:
 	void hitEntity(size_t index, const bool hit);
+	void removeHazard(size_t index);
+	void addHazard(Hazard* haz);
 	Renderable dev_marker;
 
+	// entities near the hazard being processed
+	std::vector<Entity*> nearby;
+	HitContext hit_context;
+
+	HazardSimulation sim;
+
+	// delayed hazards that aren't in h yet
+	HazardSchedule schedule;
+	std::vector<Hazard*> due;
+
+	// the powers and half tiles of the hazards drawn this frame, while overlapping ones are left out
+	std::set<std::pair<int, std::pair<int, int> > > drawn_spots;
+
 public:
 	HazardManager();
 	~HazardManager();
@@ -0,0 +1,137 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class HotReload
+ */
+
+#include "Avatar.h"
+#include "EnemyManager.h"
+#include "HotReload.h"
+#include "ItemManager.h"
+#include "MapRenderer.h"
+#include "Menu.h"
+#include "MenuInventory.h"
+#include "MenuManager.h"
+#include "ModManager.h"
+#include "PowerManager.h"
+#include "SharedGameResources.h"
+#include "SharedResources.h"
+#include "Settings.h"
+
+HotReload::HotReload()
+	: ticks(0) {
+}
+
+void HotReload::logic() {
+	if (!DEV_MODE)
+		return;
+
+	if (ticks > 0) {
+		ticks--;
+		return;
+	}
+	ticks = MAX_FRAMES_PER_SEC;
+
+	updateWatchList();
+
+	for (size_t i = 0; i < watched.size(); ++i) {
+		if (isChanged(watched[i]))
+			reload(watched[i]);
+	}
+}
+
+/**
+ * Enemy files are parsed as enemies are first met, and the map changes with teleports,
+ * so the list grows while the game runs
+ */
+void HotReload::updateWatchList() {
+	if (watched.empty()) {
+		addFile(HotReloadFile::TYPE_POWERS, "powers/powers.txt");
+		addFile(HotReloadFile::TYPE_ITEMS, "items/items.txt");
+	}
+
+	enemies->getDefinitionTypes(enemy_types);
+	for (size_t i = 0; i < enemy_types.size(); ++i) {
+		addFile(HotReloadFile::TYPE_ENEMY, enemy_types[i]);
+	}
+
+	const std::string map_filename = mapr->getFilename();
+	for (size_t i = 0; i < watched.size(); ++i) {
+		if (watched[i].type == HotReloadFile::TYPE_MAP && watched[i].filename != map_filename) {
+			watched.erase(watched.begin() + i);
+			break;
+		}
+	}
+	addFile(HotReloadFile::TYPE_MAP, map_filename);
+}
+
+void HotReload::addFile(int type, const std::string& filename) {
+	if (filename.empty())
+		return;
+
+	for (size_t i = 0; i < watched.size(); ++i) {
+		if (watched[i].type == type && watched[i].filename == filename)
+			return;
+	}
+
+	watched.push_back(HotReloadFile(type, filename));
+
+	// record the current state, so that only later changes cause a reload
+	isChanged(watched.back());
+}
+
+bool HotReload::isChanged(HotReloadFile& file) {
+	std::vector<std::string> files = mods->list(file.filename);
+	std::vector<time_t> modified(files.size());
+	for (size_t i = 0; i < files.size(); ++i) {
+		modified[i] = mods->getModifiedTime(files[i]);
+	}
+
+	if (files == file.files && modified == file.modified)
+		return false;
+
+	file.files.swap(files);
+	file.modified.swap(modified);
+	return true;
+}
+
+void HotReload::reload(const HotReloadFile& file) {
+	logInfo("HotReload: '%s' has changed, reloading it.", file.filename.c_str());
+
+	// the cached key pairs are only compared against the files once per game
+	mods->parser_cache.recheck(file.filename);
+
+	switch (file.type) {
+		case HotReloadFile::TYPE_POWERS:
+			powers->reloadPowers();
+			pc->stats.clearPowerRequirements();
+			break;
+		case HotReloadFile::TYPE_ITEMS:
+			items->reload();
+			menu->inv->changed_equipment = true;
+			break;
+		case HotReloadFile::TYPE_ENEMY:
+			enemies->reloadDefinition(file.filename);
+			break;
+		case HotReloadFile::TYPE_MAP:
+			mapr->reloadMap(pc->stats.pos);
+			break;
+	}
+
+	pc->logMsg(msg->get("Reloaded %s", file.filename), false);
+}
@@ -0,0 +1,78 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class HotReload
+ *
+ * With DEV_MODE, watches the definition files that were loaded and parses a
+ * file again once it changes on disk, so that content can be edited while the
+ * game runs. The files are polled about once per second, by comparing the
+ * modification times of every mod's copy of them.
+ *
+ * Powers, items, enemy definitions and the current map are reloaded. Files
+ * that are only INCLUDEd by them are not watched.
+ */
+
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include "CommonIncludes.h"
+
+#include <time.h>
+
+class HotReloadFile {
+public:
+	enum {
+		TYPE_POWERS = 0,
+		TYPE_ITEMS,
+		TYPE_ENEMY,
+		TYPE_MAP
+	};
+
+	int type;
+	std::string filename;
+
+	// the located copies of the file and their modification times, as of the last poll
+	std::vector<std::string> files;
+	std::vector<time_t> modified;
+
+	HotReloadFile(int _type, const std::string& _filename)
+		: type(_type)
+		, filename(_filename) {
+	}
+};
+
+class HotReload {
+private:
+	void updateWatchList();
+	void addFile(int type, const std::string& filename);
+	bool isChanged(HotReloadFile& file);
+	void reload(const HotReloadFile& file);
+
+	std::vector<HotReloadFile> watched;
+
+	// results of EnemyManager::getDefinitionTypes()
+	std::vector<std::string> enemy_types;
+
+	int ticks;
+
+public:
+	HotReload();
+	void logic();
+};
+
+#endif // HOT_RELOAD_H
@@ -23,14 +23,19 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 IconSet::IconSet()
 	: gfx(NULL)
+	, bounds()
 	, id_begin(0)
 	, id_end(0)
 	, columns(1)
+	, measured(false)
+	, missing(false)
+	, last_used(0)
 {
 }
 
 IconManager::IconManager()
 	: current_set(NULL)
+	, ticks(0)
 {
 	FileParser infile;
 
@@ -39,13 +44,9 @@ IconManager::IconManager()
 		while (infile.next()) {
 			if (infile.key == "icon_set") {
 				// @ATTR icon_set|repeatable(icon_id, filename) : First ID, Image file|Defines an icon graphics file to load, as well as the index of the first icon.
-				int first_id = popFirstInt(infile.val);
-				std::string filename = popFirstString(infile.val);
-
 				icon_sets.resize(icon_sets.size()+1);
-				if (!loadIconSet(icon_sets.back(), filename, first_id)) {
-					icon_sets.pop_back();
-				}
+				icon_sets.back().id_begin = popFirstInt(infile.val);
+				icon_sets.back().filename = popFirstString(infile.val);
 			}
 			else if (infile.key == "text_offset") {
 				// @ATTR text_offset|point|A pixel offset from the top-left to place item quantity text on icons.
@@ -58,9 +59,7 @@ IconManager::IconManager()
 	if (icon_sets.empty()) {
 		// no icons.txt file, so load icons.png legacy-style
 		icon_sets.resize(1);
-		if (!loadIconSet(icon_sets.back(), "images/icons/icons.png", 0)) {
-			icon_sets.pop_back();
-		}
+		icon_sets.back().filename = "images/icons/icons.png";
 	}
 }
 
@@ -70,56 +69,72 @@ IconManager::~IconManager() {
 	}
 }
 
-bool IconManager::loadIconSet(IconSet& iset, const std::string& filename, int first_id) {
-	if (!render_device || ICON_SIZE == 0)
+bool IconManager::loadIconSet(IconSet& iset) {
+	if (!render_device || ICON_SIZE == 0) {
+		iset.missing = true;
 		return false;
+	}
 
-	Image *graphics = render_device->loadImage(filename, "Couldn't load icon graphics file", false);
+	Image *graphics = render_device->loadAtlasImage(iset.filename, iset.bounds, "Couldn't load icon graphics file", false);
 	if (graphics) {
 		iset.gfx = graphics->createSprite();
 		graphics->unref();
 	}
 
-	if (iset.gfx) {
-		int rows = iset.gfx->getGraphicsHeight() / ICON_SIZE;
-		iset.columns = iset.gfx->getGraphicsWidth() / ICON_SIZE;
+	if (!iset.gfx) {
+		iset.missing = true;
+		return false;
+	}
+
+	if (!iset.measured) {
+		int rows = iset.bounds.h / ICON_SIZE;
+		iset.columns = iset.bounds.w / ICON_SIZE;
 
 		if (iset.columns == 0) {
 			// prevent divide-by-zero
 			iset.columns = 1;
 		}
 
-		iset.id_begin = first_id;
-		iset.id_end = first_id + (iset.columns * rows) - 1;
-
-		return true;
+		iset.id_end = iset.id_begin + (iset.columns * rows) - 1;
+		iset.measured = true;
 	}
 
-	return false;
+	return true;
 }
 
-void IconManager::setIcon(int icon_id, Point dest_pos) {
-	if (icon_sets.empty()) {
-		current_set = NULL;
-		return;
-	}
-
+/**
+ * Sets at the end of the list have priority when sets overlap, so a set that hasn't been
+ * measured yet is loaded as soon as it could hold icon_id. The loaded set stays paged in.
+ */
+IconSet* IconManager::findIconSet(int icon_id) {
 	for (size_t i = icon_sets.size(); i > 0; --i) {
-		// we iterate backwards through the set list, since sets at the end have priority when sets overlap
-		if (icon_id >= icon_sets[i-1].id_begin && icon_id <= icon_sets[i-1].id_end) {
-			current_set = &icon_sets[i-1];
-			break;
-		}
-		else if (i-1 == 0) {
-			// we've reached the end of the set list, but could not find our icon
-			current_set = NULL;
-			return;
+		IconSet& iset = icon_sets[i-1];
+		if (iset.missing || icon_id < iset.id_begin)
+			continue;
+
+		if (!iset.measured && !loadIconSet(iset))
+			continue;
+
+		if (icon_id <= iset.id_end) {
+			if (!iset.gfx && !loadIconSet(iset))
+				return NULL;
+
+			iset.last_used = ticks;
+			return &iset;
 		}
 	}
 
+	return NULL;
+}
+
+void IconManager::setIcon(int icon_id, Point dest_pos) {
+	current_set = findIconSet(icon_id);
+	if (!current_set)
+		return;
+
 	int offset_id = icon_id - current_set->id_begin;
-	current_src.x = (offset_id % current_set->columns) * ICON_SIZE;
-	current_src.y = (offset_id / current_set->columns) * ICON_SIZE;
+	current_src.x = current_set->bounds.x + (offset_id % current_set->columns) * ICON_SIZE;
+	current_src.y = current_set->bounds.y + (offset_id / current_set->columns) * ICON_SIZE;
 	current_src.w = current_src.h = ICON_SIZE;
 	current_set->gfx->setClip(current_src);
 
@@ -129,6 +144,45 @@ void IconManager::setIcon(int icon_id, Point dest_pos) {
 
 }
 
+void IconManager::prefetch(int icon_id) {
+	if (!render_device || icon_id < 0)
+		return;
+
+	for (size_t i = icon_sets.size(); i > 0; --i) {
+		IconSet& iset = icon_sets[i-1];
+		if (iset.missing || icon_id < iset.id_begin)
+			continue;
+
+		// without its size, the set may as well hold icon_id
+		if (!iset.measured || icon_id <= iset.id_end) {
+			if (!iset.gfx)
+				render_device->requestImage(iset.filename);
+			return;
+		}
+	}
+}
+
+/**
+ * A paged out set goes to the image cache of the render device, so it is only freed once
+ * TEXTURE_CACHE_MB is reached, and drawing it again soon doesn't have to decode it.
+ */
+void IconManager::logic() {
+	ticks++;
+	if (ticks % MAX_FRAMES_PER_SEC != 0)
+		return;
+
+	for (size_t i = 0; i < icon_sets.size(); ++i) {
+		IconSet& iset = icon_sets[i];
+		if (iset.gfx && ticks - iset.last_used >= ICON_SET_IDLE_SECONDS * MAX_FRAMES_PER_SEC) {
+			if (current_set == &iset)
+				current_set = NULL;
+
+			delete iset.gfx;
+			iset.gfx = NULL;
+		}
+	}
+}
+
 void IconManager::renderToImage(Image *img) {
 	if (!current_set)
 		return;
@@ -142,6 +196,6 @@ void IconManager::render() {
 	if (!current_set)
 		return;
 
-	render_device->render(current_set->gfx);
+	render_device->submit(current_set->gfx);
 }
 
@@ -21,14 +21,26 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "RenderDevice.h"
 #include "Utils.h"
 
+// icon sets that haven't been drawn for this long are paged out
+const int ICON_SET_IDLE_SECONDS = 30;
+
+/**
+ * Icon sets are loaded the first time one of their icons is drawn. The range of
+ * ids a set covers depends on the size of its image, so it is only known after that.
+ */
 class IconSet {
 public:
 	IconSet();
 
-	Sprite *gfx;
+	std::string filename;
+	Sprite *gfx; // NULL while paged out
+	Rect bounds; // area of the icon set within gfx, which may be a shared atlas page
 	int id_begin;
 	int id_end;
 	int columns;
+	bool measured; // id_end and columns are known
+	bool missing; // the image couldn't be loaded, so the set is skipped
+	int last_used;
 };
 
 class IconManager {
@@ -40,15 +52,23 @@ public:
 	void render();
 	void renderToImage(Image *img);
 
+	// starts decoding the set of icon_id in the background, if it is paged out
+	void prefetch(int icon_id);
+
+	// pages out the sets that have been idle for ICON_SET_IDLE_SECONDS
+	void logic();
+
 	Point text_offset;
 
 private:
-	bool loadIconSet(IconSet& icon_set, const std::string& filename, int first_id);
+	bool loadIconSet(IconSet& icon_set);
+	IconSet* findIconSet(int icon_id);
 
 	std::vector<IconSet> icon_sets;
 	IconSet *current_set;
 	Rect current_src;
 	Rect current_dest;
+	int ticks;
 };
 
 #endif
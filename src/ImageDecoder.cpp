@@ -0,0 +1,212 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "CommonIncludes.h"
+#include "ImageDecoder.h"
+#include "Profiler.h"
+#include "SharedResources.h"
+#include "Utils.h"
+
+#include <SDL_image.h>
+
+ImageDecoder::ImageDecoder()
+	: mutex(NULL)
+	, job_added(NULL)
+	, job_done(NULL)
+	, quit(false) {
+}
+
+ImageDecoder::~ImageDecoder() {
+	clear();
+	stopThreads();
+}
+
+/**
+ * Worker thread loop; decodes queued jobs until quit is set
+ */
+int ImageDecoder::run(void *data) {
+	ImageDecoder *decoder = static_cast<ImageDecoder*>(data);
+
+	SDL_LockMutex(decoder->mutex);
+	while (true) {
+		while (decoder->queue.empty() && !decoder->quit)
+			SDL_CondWait(decoder->job_added, decoder->mutex);
+
+		if (decoder->quit)
+			break;
+
+		ImageDecodeJob *job = decoder->queue.front();
+		decoder->queue.pop_front();
+		SDL_UnlockMutex(decoder->mutex);
+
+		SDL_Surface *surface;
+		std::string error;
+		{
+			ProfileScope scope(PROFILE_IMAGE_DECODE);
+			surface = IMG_Load_RW(mods->openRW(job->path), 1);
+			error = surface ? "" : IMG_GetError();
+		}
+
+		SDL_LockMutex(decoder->mutex);
+		job->surface = surface;
+		job->error = error;
+		job->done = true;
+		SDL_CondBroadcast(decoder->job_done);
+	}
+	SDL_UnlockMutex(decoder->mutex);
+
+	return 0;
+}
+
+void ImageDecoder::startThreads() {
+	if (!threads.empty())
+		return;
+
+	mutex = SDL_CreateMutex();
+	job_added = SDL_CreateCond();
+	job_done = SDL_CreateCond();
+	if (!mutex || !job_added || !job_done) {
+		logError("ImageDecoder: Could not create thread synchronization: %s", SDL_GetError());
+		return;
+	}
+
+	const int thread_count = std::min(std::max(SDL_GetCPUCount() - 1, 1), IMAGE_DECODER_THREADS_MAX);
+	for (int i = 0; i < thread_count; ++i) {
+		SDL_Thread *thread = SDL_CreateThread(run, "ImageDecoder", this);
+		if (!thread) {
+			logError("ImageDecoder: Could not create thread: %s", SDL_GetError());
+			break;
+		}
+		threads.push_back(thread);
+	}
+}
+
+void ImageDecoder::stopThreads() {
+	if (!threads.empty()) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(job_added);
+		SDL_UnlockMutex(mutex);
+
+		for (size_t i = 0; i < threads.size(); ++i) {
+			SDL_WaitThread(threads[i], NULL);
+		}
+		threads.clear();
+	}
+
+	if (job_done) SDL_DestroyCond(job_done);
+	if (job_added) SDL_DestroyCond(job_added);
+	if (mutex) SDL_DestroyMutex(mutex);
+	job_done = job_added = NULL;
+	mutex = NULL;
+}
+
+void ImageDecoder::request(const std::string& filename, const std::string& path) {
+	startThreads();
+
+	// without threads, images are decoded in take() as usual
+	if (threads.empty())
+		return;
+
+	SDL_LockMutex(mutex);
+	if (jobs.find(filename) == jobs.end()) {
+		ImageDecodeJob *job = new ImageDecodeJob();
+		job->path = path;
+		jobs[filename] = job;
+		queue.push_back(job);
+		SDL_CondSignal(job_added);
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+SDL_Surface* ImageDecoder::take(const std::string& filename, const std::string& path, std::string& error) {
+	ImageDecodeJob *job = NULL;
+
+	if (!threads.empty()) {
+		SDL_LockMutex(mutex);
+		std::map<std::string, ImageDecodeJob*>::iterator it = jobs.find(filename);
+		if (it != jobs.end()) {
+			job = it->second;
+			jobs.erase(it);
+
+			// if no worker has picked this job yet, decode it here instead of waiting
+			std::deque<ImageDecodeJob*>::iterator queued = std::find(queue.begin(), queue.end(), job);
+			if (queued != queue.end()) {
+				queue.erase(queued);
+				delete job;
+				job = NULL;
+			}
+			else {
+				while (!job->done)
+					SDL_CondWait(job_done, mutex);
+			}
+		}
+		SDL_UnlockMutex(mutex);
+	}
+
+	SDL_Surface *surface = NULL;
+	if (job) {
+		surface = job->surface;
+		error = job->error;
+		delete job;
+	}
+	else {
+		surface = IMG_Load_RW(mods->openRW(path), 1);
+		if (!surface)
+			error = IMG_GetError();
+	}
+
+	return surface;
+}
+
+bool ImageDecoder::isPending(const std::string& filename) {
+	if (threads.empty())
+		return false;
+
+	SDL_LockMutex(mutex);
+	std::map<std::string, ImageDecodeJob*>::iterator it = jobs.find(filename);
+	bool pending = (it != jobs.end() && !it->second->done);
+	SDL_UnlockMutex(mutex);
+
+	return pending;
+}
+
+void ImageDecoder::clear() {
+	if (threads.empty())
+		return;
+
+	SDL_LockMutex(mutex);
+
+	// jobs that no worker has picked up won't be started anymore
+	for (size_t i = 0; i < queue.size(); ++i) {
+		queue[i]->done = true;
+	}
+	queue.clear();
+
+	std::map<std::string, ImageDecodeJob*>::iterator it;
+	for (it = jobs.begin(); it != jobs.end(); ++it) {
+		ImageDecodeJob *job = it->second;
+		while (!job->done)
+			SDL_CondWait(job_done, mutex);
+
+		if (job->surface)
+			SDL_FreeSurface(job->surface);
+		delete job;
+	}
+	jobs.clear();
+	SDL_UnlockMutex(mutex);
+}
@@ -0,0 +1,90 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class ImageDecoder
+ *
+ * Decodes image files into SDL_Surfaces on a few worker threads.
+ * Images are requested ahead of time with request(), and collected with take().
+ * Turning the surface into something that can be rendered is left to the
+ * RenderDevice, since that has to happen on the main thread.
+ */
+
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <SDL.h>
+
+// the most worker threads used for decoding, regardless of the number of CPUs
+const int IMAGE_DECODER_THREADS_MAX = 4;
+
+class ImageDecodeJob {
+public:
+	std::string path;
+	SDL_Surface *surface;
+	std::string error;
+	bool done;
+
+	ImageDecodeJob()
+		: path("")
+		, surface(NULL)
+		, error("")
+		, done(false) {
+	}
+};
+
+class ImageDecoder {
+private:
+	static int run(void *data);
+	void startThreads();
+	void stopThreads();
+
+	std::vector<SDL_Thread*> threads;
+	SDL_mutex *mutex;
+	SDL_cond *job_added;
+	SDL_cond *job_done;
+	bool quit;
+
+	// jobs by filename; queue only holds the ones that haven't been started
+	std::map<std::string, ImageDecodeJob*> jobs;
+	std::deque<ImageDecodeJob*> queue;
+
+public:
+	ImageDecoder();
+	ImageDecoder(const ImageDecoder&); // not implemented
+	~ImageDecoder();
+
+	// starts decoding the file at path in the background; filename is used as the key for take()
+	void request(const std::string& filename, const std::string& path);
+
+	// returns the decoded surface, which the caller must free
+	// If filename wasn't requested, it is decoded right away on the calling thread.
+	SDL_Surface* take(const std::string& filename, const std::string& path, std::string& error);
+
+	// returns true if filename was requested and is still being decoded
+	bool isPending(const std::string& filename);
+
+	// waits for running jobs and drops every decoded surface that wasn't taken
+	void clear();
+};
+
+#endif // IMAGE_DECODER_H
@@ -0,0 +1,268 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "InputReplay.h"
+#include "InputState.h"
+#include "Random.h"
+#include "Settings.h"
+#include "UtilsParsing.h"
+
+#include <fstream>
+
+InputReplayFrame::InputReplayFrame()
+	: pressing(0)
+	, lock(0)
+	, mouse()
+	, scroll_up(false)
+	, scroll_down(false)
+	, last_is_joystick(false)
+	, done(false)
+	, inkeys("") {
+}
+
+bool InputReplayFrame::equals(const InputReplayFrame& other) const {
+	return pressing == other.pressing && lock == other.lock &&
+		mouse.x == other.mouse.x && mouse.y == other.mouse.y &&
+		scroll_up == other.scroll_up && scroll_down == other.scroll_down &&
+		last_is_joystick == other.last_is_joystick && done == other.done &&
+		inkeys == other.inkeys;
+}
+
+InputReplay::InputReplay()
+	: mode(REPLAY_NONE)
+	, filename("")
+	, fast(false)
+	, started(false)
+	, finished(false)
+	, seed(0)
+	, load_slot("")
+	, load_script("")
+	, frames_per_sec(0)
+	, view()
+	, play_index(0)
+	, play_repeat(0)
+	, frame_count(0)
+	, start_ticks(0) {
+}
+
+InputReplay::~InputReplay() {
+	stop();
+}
+
+void InputReplay::startRecording(const std::string& _filename) {
+	mode = REPLAY_RECORD;
+	filename = _filename;
+	seed = getRandomSeed();
+	load_slot = LOAD_SLOT;
+	load_script = LOAD_SCRIPT;
+	frames.clear();
+}
+
+bool InputReplay::startPlayback(const std::string& _filename, bool _fast) {
+	std::ifstream infile(_filename.c_str());
+	if (!infile.is_open()) {
+		logError("InputReplay: Could not open replay file '%s'.", _filename.c_str());
+		return false;
+	}
+
+	frames.clear();
+
+	std::string line;
+	while (std::getline(infile, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		size_t sep = line.find('=');
+		if (sep == std::string::npos)
+			continue;
+
+		std::string key = line.substr(0, sep);
+		std::string val = line.substr(sep + 1);
+
+		if (key == "seed") {
+			seed = static_cast<uint32_t>(strtoul(val.c_str(), NULL, 10));
+		}
+		else if (key == "load_slot") {
+			load_slot = val;
+		}
+		else if (key == "load_script") {
+			load_script = val;
+		}
+		else if (key == "frames_per_sec") {
+			frames_per_sec = toInt(val);
+		}
+		else if (key == "view") {
+			view.x = popFirstInt(val, ',');
+			view.y = popFirstInt(val, ',');
+		}
+		else if (key == "frame") {
+			// repeat,pressing,lock,mouse_x,mouse_y,flags,inkeys
+			std::pair<unsigned, InputReplayFrame> f;
+			f.first = static_cast<unsigned>(popFirstInt(val, ','));
+			f.second.pressing = static_cast<uint32_t>(popFirstInt(val, ','));
+			f.second.lock = static_cast<uint32_t>(popFirstInt(val, ','));
+			f.second.mouse.x = popFirstInt(val, ',');
+			f.second.mouse.y = popFirstInt(val, ',');
+
+			int flags = popFirstInt(val, ',');
+			f.second.scroll_up = (flags & 1) != 0;
+			f.second.scroll_down = (flags & 2) != 0;
+			f.second.last_is_joystick = (flags & 4) != 0;
+			f.second.done = (flags & 8) != 0;
+
+			// text input is last, since it may contain commas
+			f.second.inkeys = val;
+
+			if (f.first > 0)
+				frames.push_back(f);
+		}
+	}
+	infile.close();
+
+	mode = REPLAY_PLAY;
+	filename = _filename;
+	fast = _fast;
+	play_index = 0;
+	play_repeat = 0;
+
+	seedRandom(seed);
+	LOAD_SLOT = load_slot;
+	LOAD_SCRIPT = load_script;
+
+	logInfo("InputReplay: Playing '%s' with random seed %u.", filename.c_str(), seed);
+	return true;
+}
+
+void InputReplay::stop() {
+	if (mode == REPLAY_RECORD)
+		write();
+
+	mode = REPLAY_NONE;
+	frames.clear();
+}
+
+void InputReplay::write() {
+	std::ofstream outfile(filename.c_str());
+	if (!outfile.is_open()) {
+		logError("InputReplay: Could not write replay file '%s'.", filename.c_str());
+		return;
+	}
+
+	outfile << "# FLARE input replay\n";
+	outfile << "seed=" << seed << "\n";
+	outfile << "load_slot=" << load_slot << "\n";
+	outfile << "load_script=" << load_script << "\n";
+	outfile << "frames_per_sec=" << frames_per_sec << "\n";
+	outfile << "view=" << view.x << "," << view.y << "\n";
+
+	for (size_t i = 0; i < frames.size(); ++i) {
+		const InputReplayFrame &f = frames[i].second;
+		int flags = (f.scroll_up ? 1 : 0) | (f.scroll_down ? 2 : 0) | (f.last_is_joystick ? 4 : 0) | (f.done ? 8 : 0);
+
+		outfile << "frame=" << frames[i].first << "," << f.pressing << "," << f.lock << ",";
+		outfile << f.mouse.x << "," << f.mouse.y << "," << flags << "," << f.inkeys << "\n";
+	}
+
+	if (outfile.bad())
+		logError("InputReplay: Unable to write replay file '%s'. No write access or disk is full!", filename.c_str());
+	outfile.close();
+
+	logInfo("InputReplay: Recorded %u frames to '%s'.", frame_count, filename.c_str());
+}
+
+void InputReplay::update(InputState *input) {
+	if (mode == REPLAY_NONE || !input)
+		return;
+
+	if (!started) {
+		started = true;
+		start_ticks = SDL_GetPerformanceCounter();
+
+		if (mode == REPLAY_RECORD) {
+			frames_per_sec = MAX_FRAMES_PER_SEC;
+			view.x = VIEW_W;
+			view.y = VIEW_H;
+		}
+		else {
+			// the recorded mouse positions only hit the same widgets at the same view size
+			if (frames_per_sec != MAX_FRAMES_PER_SEC)
+				logError("InputReplay: Recorded at %d frames per second, but running at %d. The replay will diverge.", frames_per_sec, MAX_FRAMES_PER_SEC);
+			if (view.x != VIEW_W || view.y != VIEW_H)
+				logError("InputReplay: Recorded with a %dx%d view, but running with %dx%d. The replay may diverge.", view.x, view.y, VIEW_W, VIEW_H);
+		}
+	}
+
+	if (mode == REPLAY_RECORD) {
+		InputReplayFrame f;
+		for (int i = 0; i < InputState::key_count; ++i) {
+			if (input->pressing[i]) f.pressing |= (1u << i);
+			if (input->lock[i]) f.lock |= (1u << i);
+		}
+		f.mouse = input->mouse;
+		f.scroll_up = input->scroll_up;
+		f.scroll_down = input->scroll_down;
+		f.last_is_joystick = input->last_is_joystick;
+		f.done = input->done;
+		f.inkeys = input->inkeys;
+
+		if (!frames.empty() && frames.back().second.equals(f))
+			frames.back().first++;
+		else
+			frames.push_back(std::pair<unsigned, InputReplayFrame>(1, f));
+
+		frame_count++;
+	}
+	else if (mode == REPLAY_PLAY) {
+		if (play_index >= frames.size()) {
+			finishPlayback(input);
+			return;
+		}
+
+		const InputReplayFrame &f = frames[play_index].second;
+		for (int i = 0; i < InputState::key_count; ++i) {
+			input->pressing[i] = (f.pressing & (1u << i)) != 0;
+			input->lock[i] = (f.lock & (1u << i)) != 0;
+		}
+		input->mouse = f.mouse;
+		input->scroll_up = f.scroll_up;
+		input->scroll_down = f.scroll_down;
+		input->last_is_joystick = f.last_is_joystick;
+		input->inkeys = f.inkeys;
+
+		// closing the window still ends the replay
+		input->done = input->done || f.done;
+
+		frame_count++;
+		if (++play_repeat >= frames[play_index].first) {
+			play_repeat = 0;
+			play_index++;
+		}
+	}
+}
+
+void InputReplay::finishPlayback(InputState *input) {
+	// stays in playback mode until the game has quit, so that nothing is saved
+	input->done = true;
+	if (finished)
+		return;
+	finished = true;
+
+	float seconds = static_cast<float>(SDL_GetPerformanceCounter() - start_ticks) / static_cast<float>(SDL_GetPerformanceFrequency());
+	float ms_per_frame = frame_count > 0 ? (seconds * 1000.f) / static_cast<float>(frame_count) : 0;
+
+	logInfo("InputReplay: Replayed %u frames in %.2f seconds (%.3f ms per frame).", frame_count, seconds, ms_per_frame);
+}
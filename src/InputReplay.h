@@ -0,0 +1,111 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class InputReplay
+ *
+ * Records the input state of every logic frame to a file, along with the
+ * random seed and the save slot the session was started with, and plays such
+ * a recording back frame by frame in place of the real input.
+ *
+ * Since the game logic only depends on the input and the random streams, a
+ * replay goes through the same game as the recording, which makes recorded
+ * sessions usable for comparing the performance of different builds.
+ * Saving is disabled while replaying, so that the starting save is kept.
+ */
+
+#ifndef INPUT_REPLAY_H
+#define INPUT_REPLAY_H
+
+#include "CommonIncludes.h"
+#include "Utils.h"
+
+#include <stdint.h>
+
+class InputState;
+
+class InputReplayFrame {
+public:
+	// one bit per key; InputState has fewer than 32 of them
+	uint32_t pressing;
+	uint32_t lock;
+	Point mouse;
+	bool scroll_up;
+	bool scroll_down;
+	bool last_is_joystick;
+	bool done;
+	std::string inkeys;
+
+	InputReplayFrame();
+	bool equals(const InputReplayFrame& other) const;
+};
+
+class InputReplay {
+private:
+	enum REPLAY_MODE {
+		REPLAY_NONE = 0,
+		REPLAY_RECORD = 1,
+		REPLAY_PLAY = 2
+	};
+
+	void write();
+	void finishPlayback(InputState *input);
+
+	REPLAY_MODE mode;
+	std::string filename;
+	bool fast;
+	bool started;
+	bool finished;
+
+	// settings the recording was made with
+	uint32_t seed;
+	std::string load_slot;
+	std::string load_script;
+	int frames_per_sec;
+	Point view;
+
+	// frames with how many times in a row they repeat
+	std::vector<std::pair<unsigned, InputReplayFrame> > frames;
+	size_t play_index;
+	unsigned play_repeat;
+	unsigned frame_count;
+	uint64_t start_ticks;
+
+public:
+	InputReplay();
+	~InputReplay();
+
+	// starts recording to filename; must be called after the random streams are seeded
+	void startRecording(const std::string& _filename);
+
+	// loads filename and applies its random seed and save slot; returns false on failure
+	bool startPlayback(const std::string& _filename, bool _fast);
+
+	// writes the recording, if there is one
+	void stop();
+
+	// called every logic frame after InputState::handle()
+	void update(InputState *input);
+
+	bool isRecording() const { return mode == REPLAY_RECORD; }
+	bool isPlaying() const { return mode == REPLAY_PLAY; }
+
+	// true if the replay should run as fast as possible instead of in real time
+	bool isFast() const { return mode == REPLAY_PLAY && fast; }
+};
+
+#endif // INPUT_REPLAY_H
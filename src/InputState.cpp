@@ -52,6 +52,7 @@ InputState::InputState(void)
 	, window_minimized(false)
 	, window_restored(false)
 	, window_resized(false)
+	, window_exposed(false)
 	, pressing_up(false)
 	, pressing_down(false)
 	, joysticks_changed(false)
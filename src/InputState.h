@@ -118,6 +118,15 @@ public:
 	virtual int getNumJoysticks() = 0;
 	virtual bool usingMouse() = 0;
 
+	// the newest mouse position, which may be ahead of the one logic has seen; only meant for drawing the cursor
+	virtual Point getLatestMouse() { return mouse; }
+
+	// OS cursors made from images; returns -1 if the cursor couldn't be created
+	virtual int createHardwareCursor(const std::string& filename, const Point& hotspot) = 0;
+
+	// switches the OS cursor, or back to the system default if id is -1
+	virtual void setHardwareCursor(int id) = 0;
+
 	void enableEventLog();
 
 	bool pressing[key_count];
@@ -139,6 +148,7 @@ public:
 	bool window_minimized;
 	bool window_restored;
 	bool window_resized;
+	bool window_exposed; // the window contents need to be presented again
 	bool pressing_up;
 	bool pressing_down;
 	bool joysticks_changed;
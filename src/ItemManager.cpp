@@ -27,6 +27,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "CommonIncludes.h"
 #include "FileParser.h"
 #include "ItemManager.h"
+#include "MemoryUsage.h"
 #include "Settings.h"
 #include "SharedGameResources.h"
 #include "SharedResources.h"
@@ -40,6 +41,80 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <climits>
 #include <cstring>
 
+// the attributes of items/items.txt
+enum {
+	ITEM_KEY_ID,
+	ITEM_KEY_NAME,
+	ITEM_KEY_FLAVOR,
+	ITEM_KEY_LEVEL,
+	ITEM_KEY_ICON,
+	ITEM_KEY_BOOK,
+	ITEM_KEY_QUALITY,
+	ITEM_KEY_ITEM_TYPE,
+	ITEM_KEY_EQUIP_FLAGS,
+	ITEM_KEY_DMG_MELEE,
+	ITEM_KEY_DMG_RANGED,
+	ITEM_KEY_DMG_MENT,
+	ITEM_KEY_ABS,
+	ITEM_KEY_REQUIRES_LEVEL,
+	ITEM_KEY_REQUIRES_STAT,
+	ITEM_KEY_REQUIRES_CLASS,
+	ITEM_KEY_BONUS,
+	ITEM_KEY_SOUNDFX,
+	ITEM_KEY_GFX,
+	ITEM_KEY_LOOT_ANIMATION,
+	ITEM_KEY_POWER,
+	ITEM_KEY_REPLACE_POWER,
+	ITEM_KEY_POWER_DESC,
+	ITEM_KEY_PRICE,
+	ITEM_KEY_PRICE_PER_LEVEL,
+	ITEM_KEY_PRICE_SELL,
+	ITEM_KEY_MAX_QUANTITY,
+	ITEM_KEY_PICKUP_STATUS,
+	ITEM_KEY_STEPFX,
+	ITEM_KEY_DISABLE_SLOTS,
+	ITEM_KEY_QUEST_ITEM,
+	ITEM_KEYS_COUNT
+};
+
+static const char* const ITEM_KEYS[ITEM_KEYS_COUNT] = {
+	"id",
+	"name",
+	"flavor",
+	"level",
+	"icon",
+	"book",
+	"quality",
+	"item_type",
+	"equip_flags",
+	"dmg_melee",
+	"dmg_ranged",
+	"dmg_ment",
+	"abs",
+	"requires_level",
+	"requires_stat",
+	"requires_class",
+	"bonus",
+	"soundfx",
+	"gfx",
+	"loot_animation",
+	"power",
+	"replace_power",
+	"power_desc",
+	"price",
+	"price_per_level",
+	"price_sell",
+	"max_quantity",
+	"pickup_status",
+	"stepfx",
+	"disable_slots",
+	"quest_item"
+};
+
+static const ParserKeyTable item_keys(ITEM_KEYS, ITEM_KEYS_COUNT);
+
+const StringHandle ITEM_TYPE_CONSUMABLE = internString("consumable");
+
 bool compareItemStack(const ItemStack &stack1, const ItemStack &stack2) {
 	return stack1.item < stack2.item;
 }
@@ -62,6 +137,36 @@ ItemManager::ItemManager()
 	}
 }
 
+/**
+ * Parsing doesn't touch the sound manager, so that the items can be loaded on a worker thread
+ */
+void ItemManager::loadSounds() {
+	for (size_t i = 0; i < items.size(); ++i) {
+		if (!items[i].sfx.empty())
+			items[i].sfx_id = snd->load(items[i].sfx, "ItemManager");
+	}
+}
+
+/**
+ * Items that are carried keep their ids, even if they are no longer defined
+ */
+void ItemManager::reload() {
+	const size_t prev_count = items.size();
+
+	items.clear();
+	item_types.clear();
+	item_sets.clear();
+	item_qualities.clear();
+	tooltip_cache.clear();
+
+	loadAll();
+
+	if (items.size() < prev_count)
+		addUnknownItem(static_cast<unsigned>(prev_count - 1));
+
+	loadSounds();
+}
+
 /**
  * Load all items files in all mods
  */
@@ -88,11 +193,47 @@ void ItemManager::loadAll() {
 	if (item_sets.capacity() != item_sets.size())
 		item_sets.swap(item_sets);
 
+	indexItems();
+
 	// do we need to print these messages?
 	if (items.empty()) logInfo("ItemManager: No items were found.");
 	if (item_sets.empty()) logInfo("ItemManager: No item sets were found.");
 }
 
+/**
+ * Turns the type, quality and disabled slot strings of each item into ids,
+ * so that inventory checks and tooltips compare integers
+ */
+void ItemManager::indexItems() {
+	std::map<std::string, int> type_index;
+	for (size_t i = 0; i < item_types.size(); ++i) {
+		type_index.insert(std::pair<std::string, int>(item_types[i].id, static_cast<int>(i)));
+	}
+
+	std::map<std::string, int> quality_index;
+	for (size_t i = 0; i < item_qualities.size(); ++i) {
+		quality_index.insert(std::pair<std::string, int>(item_qualities[i].id, static_cast<int>(i)));
+	}
+
+	std::map<std::string, int>::iterator it;
+	for (size_t i = 0; i < items.size(); ++i) {
+		Item& item = items[i];
+
+		item.type_id = internString(item.type);
+
+		it = type_index.find(item.type);
+		item.type_index = (it != type_index.end()) ? it->second : -1;
+
+		it = quality_index.find(item.quality);
+		item.quality_index = (it != quality_index.end()) ? it->second : -1;
+
+		item.disable_slot_ids.clear();
+		for (size_t j = 0; j < item.disable_slots.size(); ++j) {
+			item.disable_slot_ids.push_back(internString(item.disable_slots[j]));
+		}
+	}
+}
+
 /**
  * Load a specific items file
  *
@@ -102,8 +243,13 @@ void ItemManager::loadItems(const std::string& filename, bool locateFileName) {
 	FileParser infile;
 
 	// @CLASS ItemManager: Items|Description about the class and it usage, items/items.txt...
-	if (!infile.open(filename, locateFileName))
+	if (locateFileName) {
+		if (!infile.openCached(filename))
+			return;
+	}
+	else if (!infile.open(filename, false)) {
 		return;
+	}
 
 	// used to clear vectors when overriding items
 	bool clear_req_stat = true;
@@ -114,7 +260,9 @@ void ItemManager::loadItems(const std::string& filename, bool locateFileName) {
 	int id = 0;
 	bool id_line = false;
 	while (infile.next()) {
-		if (infile.key == "id") {
+		const int key = item_keys.get(infile.key);
+
+		if (key == ITEM_KEY_ID) {
 			// @ATTR id|item_id|An uniq id of the item used as reference from other classes.
 			id_line = true;
 			id = toInt(infile.val);
@@ -135,181 +283,242 @@ void ItemManager::loadItems(const std::string& filename, bool locateFileName) {
 
 		assert(items.size() > std::size_t(id));
 
-		if (infile.key == "name") {
-			// @ATTR name|string|Item name displayed on long and short tooltips.
-			items[id].name = msg->get(infile.val);
-			items[id].has_name = true;
-		}
-		else if (infile.key == "flavor")
-			// @ATTR flavor|string|A description of the item.
-			items[id].flavor = msg->get(infile.val);
-		else if (infile.key == "level")
-			// @ATTR level|int|The item's level. Has no gameplay impact. (Deprecated?)
-			items[id].level = toInt(infile.val);
-		else if (infile.key == "icon") {
-			// @ATTR icon|icon_id|An id for the icon to display for this item.
-			items[id].icon = toInt(infile.val);
-		}
-		else if (infile.key == "book") {
-			// @ATTR book|filename|A book file to open when this item is activated.
-			items[id].book = infile.val;
-		}
-		else if (infile.key == "quality") {
-			// @ATTR quality|predefined_string|Item quality matching an id in items/qualities.txt
-			items[id].quality = infile.val;
-		}
-		else if (infile.key == "item_type") {
-			// @ATTR item_type|predefined_string|Equipment slot matching an id in items/types.txt
-			items[id].type = infile.val;
-		}
-		else if (infile.key == "equip_flags") {
-			// @ATTR equip_flags|list(predefined_string)|A comma separated list of flags to set when this item is equipped. See engine/equip_flags.txt.
-			items[id].equip_flags.clear();
-			std::string flag = popFirstString(infile.val);
-
-			while (flag != "") {
-				items[id].equip_flags.push_back(flag);
-				flag = popFirstString(infile.val);
+		switch (key) {
+			case ITEM_KEY_NAME: {
+				// @ATTR name|string|Item name displayed on long and short tooltips.
+				items[id].name = msg->get(infile.val);
+				items[id].has_name = true;
+				break;
 			}
-		}
-		else if (infile.key == "dmg_melee") {
-			// @ATTR dmg_melee|int, int : Min, Max|Defines the item melee damage, if only min is specified the melee damage is fixed.
-			items[id].dmg_melee_min = popFirstInt(infile.val);
-			if (infile.val.length() > 0)
-				items[id].dmg_melee_max = popFirstInt(infile.val);
-			else
-				items[id].dmg_melee_max = items[id].dmg_melee_min;
-		}
-		else if (infile.key == "dmg_ranged") {
-			// @ATTR dmg_ranged|int, int : Min, Max|Defines the item ranged damage, if only min is specified the ranged damage is fixed.
-			items[id].dmg_ranged_min = popFirstInt(infile.val);
-			if (infile.val.length() > 0)
-				items[id].dmg_ranged_max = popFirstInt(infile.val);
-			else
-				items[id].dmg_ranged_max = items[id].dmg_ranged_min;
-		}
-		else if (infile.key == "dmg_ment") {
-			// @ATTR dmg_ment|int, int : Min, Max|Defines the item mental damage, if only min is specified the ranged damage is fixed.
-			items[id].dmg_ment_min = popFirstInt(infile.val);
-			if (infile.val.length() > 0)
-				items[id].dmg_ment_max = popFirstInt(infile.val);
-			else
-				items[id].dmg_ment_max = items[id].dmg_ment_min;
-		}
-		else if (infile.key == "abs") {
-			// @ATTR abs|int, int : Min, Max|Defines the item absorb value, if only min is specified the absorb value is fixed.
-			items[id].abs_min = popFirstInt(infile.val);
-			if (infile.val.length() > 0)
-				items[id].abs_max = popFirstInt(infile.val);
-			else
-				items[id].abs_max = items[id].abs_min;
-		}
-		else if (infile.key == "requires_level") {
-			// @ATTR requires_level|int|The hero's level must match or exceed this value in order to equip this item.
-			items[id].requires_level = toInt(infile.val);
-		}
-		else if (infile.key == "requires_stat") {
-			// @ATTR requires_stat|repeatable(predefined_string, int) : Primary stat name, Value|Make item require specific stat level ex. requires_stat=physical,6 will require hero to have level 6 in physical stats
-			if (clear_req_stat) {
-				items[id].req_stat.clear();
-				items[id].req_val.clear();
-				clear_req_stat = false;
+
+			case ITEM_KEY_FLAVOR:
+				// @ATTR flavor|string|A description of the item.
+				items[id].flavor = msg->get(infile.val);
+				break;
+
+			case ITEM_KEY_LEVEL:
+				// @ATTR level|int|The item's level. Has no gameplay impact. (Deprecated?)
+				items[id].level = toInt(infile.val);
+				break;
+
+			case ITEM_KEY_ICON: {
+				// @ATTR icon|icon_id|An id for the icon to display for this item.
+				items[id].icon = toInt(infile.val);
+				break;
 			}
-			std::string s = popFirstString(infile.val);
-			size_t req_stat_index = getPrimaryStatIndex(s);
-			if (req_stat_index != PRIMARY_STATS.size())
-				items[id].req_stat.push_back(req_stat_index);
-			else
-				infile.error("ItemManager: '%s' is not a valid primary stat.", s.c_str());
-			items[id].req_val.push_back(popFirstInt(infile.val));
-		}
-		else if (infile.key == "requires_class") {
-			// @ATTR requires_class|predefined_string|The hero's base class (engine/classes.txt) must match for this item to be equipped.
-			items[id].requires_class = infile.val;
-		}
-		else if (infile.key == "bonus") {
-			// @ATTR bonus|repeatable(predefined_string, int) : Stat name, Value|Adds a bonus to the item by stat name, example: bonus=hp, 50
-			if (clear_bonus) {
-				items[id].bonus.clear();
-				clear_bonus = false;
+
+			case ITEM_KEY_BOOK: {
+				// @ATTR book|filename|A book file to open when this item is activated.
+				items[id].book = infile.val;
+				break;
 			}
-			BonusData bdata;
-			parseBonus(bdata, infile);
-			items[id].bonus.push_back(bdata);
-		}
-		else if (infile.key == "soundfx") {
-			// @ATTR soundfx|filename|Sound effect filename to play for the specific item.
-			items[id].sfx = infile.val;
-			items[id].sfx_id = snd->load(items[id].sfx, "ItemManager");
-		}
-		else if (infile.key == "gfx")
-			// @ATTR gfx|filename|Filename of an animation set to display when the item is equipped.
-			items[id].gfx = infile.val;
-		else if (infile.key == "loot_animation") {
-			// @ATTR loot_animation|repeatable(filename, int, int) : Loot image, Min quantity, Max quantity|Specifies the loot animation file for the item. The max quantity, or both quantity values, may be omitted.
-			if (clear_loot_anim) {
-				items[id].loot_animation.clear();
-				clear_loot_anim = false;
+
+			case ITEM_KEY_QUALITY: {
+				// @ATTR quality|predefined_string|Item quality matching an id in items/qualities.txt
+				items[id].quality = infile.val;
+				break;
 			}
-			LootAnimation la;
-			la.name = popFirstString(infile.val);
-			la.low = popFirstInt(infile.val);
-			la.high = popFirstInt(infile.val);
-			items[id].loot_animation.push_back(la);
-		}
-		else if (infile.key == "power") {
-			// @ATTR power|power_id|Adds a specific power to the item which makes it usable as a power and can be placed in action bar.
-			if (toInt(infile.val) > 0)
-				items[id].power = toInt(infile.val);
-			else
-				infile.error("ItemManager: Power index out of bounds 1-%d, skipping power.", INT_MAX);
-		}
-		else if (infile.key == "replace_power") {
-			// @ATTR replace_power|repeatable(int, int) : Old power, New power|Replaces the old power id with the new power id in the action bar when equipped.
-			if (clear_replace_power) {
-				items[id].replace_power.clear();
-				clear_replace_power = false;
+
+			case ITEM_KEY_ITEM_TYPE: {
+				// @ATTR item_type|predefined_string|Equipment slot matching an id in items/types.txt
+				items[id].type = infile.val;
+				break;
 			}
-			Point power_ids = toPoint(infile.val);
-			items[id].replace_power.push_back(power_ids);
-		}
-		else if (infile.key == "power_desc")
-			// @ATTR power_desc|string|A string describing the additional power.
-			items[id].power_desc = msg->get(infile.val);
-		else if (infile.key == "price")
-			// @ATTR price|int|The amount of currency the item costs, if set to 0 the item cannot be sold.
-			items[id].price = toInt(infile.val);
-		else if (infile.key == "price_per_level")
-			// @ATTR price_per_level|int|Additional price for each player level above 1
-			items[id].price_per_level = toInt(infile.val);
-		else if (infile.key == "price_sell")
-			// @ATTR price_sell|int|The amount of currency the item is sold for, if set to 0 the sell prices is prices*vendor_ratio.
-			items[id].price_sell = toInt(infile.val);
-		else if (infile.key == "max_quantity")
-			// @ATTR max_quantity|int|Max item count per stack.
-			items[id].max_quantity = toInt(infile.val);
-		else if (infile.key == "pickup_status")
-			// @ATTR pickup_status|string|Set a campaign status when item is picked up, this is used for quest items.
-			items[id].pickup_status = infile.val;
-		else if (infile.key == "stepfx")
-			// @ATTR stepfx|predefined_string|Sound effect when walking, this applies only to armors.
-			items[id].stepfx = infile.val;
-		else if (infile.key == "disable_slots") {
-			// @ATTR disable_slots|list(predefined_string)|A comma separated list of equip slot types to disable when this item is equipped.
-			items[id].disable_slots.clear();
-			std::string slot_type = popFirstString(infile.val);
-
-			while (slot_type != "") {
-				items[id].disable_slots.push_back(slot_type);
-				slot_type = popFirstString(infile.val);
+
+			case ITEM_KEY_EQUIP_FLAGS: {
+				// @ATTR equip_flags|list(predefined_string)|A comma separated list of flags to set when this item is equipped. See engine/equip_flags.txt.
+				items[id].equip_flags.clear();
+				std::string flag = popFirstString(infile.val);
+
+				while (flag != "") {
+					items[id].equip_flags.push_back(internString(flag));
+					flag = popFirstString(infile.val);
+				}
+				break;
 			}
-		}
-		else if (infile.key == "quest_item") {
-			// @ATTR quest_item|bool|If true, this item is a quest item and can not be dropped, stashed, or sold.
-			items[id].quest_item = toBool(infile.val);
-		}
-		else {
-			infile.error("ItemManager: '%s' is not a valid key.", infile.key.c_str());
+
+			case ITEM_KEY_DMG_MELEE: {
+				// @ATTR dmg_melee|int, int : Min, Max|Defines the item melee damage, if only min is specified the melee damage is fixed.
+				items[id].dmg_melee_min = popFirstInt(infile.val);
+				if (infile.val.length() > 0)
+					items[id].dmg_melee_max = popFirstInt(infile.val);
+				else
+					items[id].dmg_melee_max = items[id].dmg_melee_min;
+				break;
+			}
+
+			case ITEM_KEY_DMG_RANGED: {
+				// @ATTR dmg_ranged|int, int : Min, Max|Defines the item ranged damage, if only min is specified the ranged damage is fixed.
+				items[id].dmg_ranged_min = popFirstInt(infile.val);
+				if (infile.val.length() > 0)
+					items[id].dmg_ranged_max = popFirstInt(infile.val);
+				else
+					items[id].dmg_ranged_max = items[id].dmg_ranged_min;
+				break;
+			}
+
+			case ITEM_KEY_DMG_MENT: {
+				// @ATTR dmg_ment|int, int : Min, Max|Defines the item mental damage, if only min is specified the ranged damage is fixed.
+				items[id].dmg_ment_min = popFirstInt(infile.val);
+				if (infile.val.length() > 0)
+					items[id].dmg_ment_max = popFirstInt(infile.val);
+				else
+					items[id].dmg_ment_max = items[id].dmg_ment_min;
+				break;
+			}
+
+			case ITEM_KEY_ABS: {
+				// @ATTR abs|int, int : Min, Max|Defines the item absorb value, if only min is specified the absorb value is fixed.
+				items[id].abs_min = popFirstInt(infile.val);
+				if (infile.val.length() > 0)
+					items[id].abs_max = popFirstInt(infile.val);
+				else
+					items[id].abs_max = items[id].abs_min;
+				break;
+			}
+
+			case ITEM_KEY_REQUIRES_LEVEL: {
+				// @ATTR requires_level|int|The hero's level must match or exceed this value in order to equip this item.
+				items[id].requires_level = toInt(infile.val);
+				break;
+			}
+
+			case ITEM_KEY_REQUIRES_STAT: {
+				// @ATTR requires_stat|repeatable(predefined_string, int) : Primary stat name, Value|Make item require specific stat level ex. requires_stat=physical,6 will require hero to have level 6 in physical stats
+				if (clear_req_stat) {
+					items[id].req_stat.clear();
+					items[id].req_val.clear();
+					clear_req_stat = false;
+				}
+				std::string s = popFirstString(infile.val);
+				size_t req_stat_index = getPrimaryStatIndex(s);
+				if (req_stat_index != PRIMARY_STATS.size())
+					items[id].req_stat.push_back(req_stat_index);
+				else
+					infile.error("ItemManager: '%s' is not a valid primary stat.", s.c_str());
+				items[id].req_val.push_back(popFirstInt(infile.val));
+				break;
+			}
+
+			case ITEM_KEY_REQUIRES_CLASS: {
+				// @ATTR requires_class|predefined_string|The hero's base class (engine/classes.txt) must match for this item to be equipped.
+				items[id].requires_class = infile.val;
+				break;
+			}
+
+			case ITEM_KEY_BONUS: {
+				// @ATTR bonus|repeatable(predefined_string, int) : Stat name, Value|Adds a bonus to the item by stat name, example: bonus=hp, 50
+				if (clear_bonus) {
+					items[id].bonus.clear();
+					clear_bonus = false;
+				}
+				BonusData bdata;
+				parseBonus(bdata, infile);
+				items[id].bonus.push_back(bdata);
+				break;
+			}
+
+			case ITEM_KEY_SOUNDFX: {
+				// @ATTR soundfx|filename|Sound effect filename to play for the specific item.
+				items[id].sfx = infile.val;
+				break;
+			}
+
+			case ITEM_KEY_GFX:
+				// @ATTR gfx|filename|Filename of an animation set to display when the item is equipped.
+				items[id].gfx = infile.val;
+				break;
+
+			case ITEM_KEY_LOOT_ANIMATION: {
+				// @ATTR loot_animation|repeatable(filename, int, int) : Loot image, Min quantity, Max quantity|Specifies the loot animation file for the item. The max quantity, or both quantity values, may be omitted.
+				if (clear_loot_anim) {
+					items[id].loot_animation.clear();
+					clear_loot_anim = false;
+				}
+				LootAnimation la;
+				la.name = popFirstString(infile.val);
+				la.low = popFirstInt(infile.val);
+				la.high = popFirstInt(infile.val);
+				items[id].loot_animation.push_back(la);
+				break;
+			}
+
+			case ITEM_KEY_POWER: {
+				// @ATTR power|power_id|Adds a specific power to the item which makes it usable as a power and can be placed in action bar.
+				if (toInt(infile.val) > 0)
+					items[id].power = toInt(infile.val);
+				else
+					infile.error("ItemManager: Power index out of bounds 1-%d, skipping power.", INT_MAX);
+				break;
+			}
+
+			case ITEM_KEY_REPLACE_POWER: {
+				// @ATTR replace_power|repeatable(int, int) : Old power, New power|Replaces the old power id with the new power id in the action bar when equipped.
+				if (clear_replace_power) {
+					items[id].replace_power.clear();
+					clear_replace_power = false;
+				}
+				Point power_ids = toPoint(infile.val);
+				items[id].replace_power.push_back(power_ids);
+				break;
+			}
+
+			case ITEM_KEY_POWER_DESC:
+				// @ATTR power_desc|string|A string describing the additional power.
+				items[id].power_desc = msg->get(infile.val);
+				break;
+
+			case ITEM_KEY_PRICE:
+				// @ATTR price|int|The amount of currency the item costs, if set to 0 the item cannot be sold.
+				items[id].price = toInt(infile.val);
+				break;
+
+			case ITEM_KEY_PRICE_PER_LEVEL:
+				// @ATTR price_per_level|int|Additional price for each player level above 1
+				items[id].price_per_level = toInt(infile.val);
+				break;
+
+			case ITEM_KEY_PRICE_SELL:
+				// @ATTR price_sell|int|The amount of currency the item is sold for, if set to 0 the sell prices is prices*vendor_ratio.
+				items[id].price_sell = toInt(infile.val);
+				break;
+
+			case ITEM_KEY_MAX_QUANTITY:
+				// @ATTR max_quantity|int|Max item count per stack.
+				items[id].max_quantity = toInt(infile.val);
+				break;
+
+			case ITEM_KEY_PICKUP_STATUS:
+				// @ATTR pickup_status|string|Set a campaign status when item is picked up, this is used for quest items.
+				items[id].pickup_status = infile.val;
+				break;
+
+			case ITEM_KEY_STEPFX:
+				// @ATTR stepfx|predefined_string|Sound effect when walking, this applies only to armors.
+				items[id].stepfx = infile.val;
+				break;
+
+			case ITEM_KEY_DISABLE_SLOTS: {
+				// @ATTR disable_slots|list(predefined_string)|A comma separated list of equip slot types to disable when this item is equipped.
+				items[id].disable_slots.clear();
+				std::string slot_type = popFirstString(infile.val);
+
+				while (slot_type != "") {
+					items[id].disable_slots.push_back(slot_type);
+					slot_type = popFirstString(infile.val);
+				}
+				break;
+			}
+
+			case ITEM_KEY_QUEST_ITEM: {
+				// @ATTR quest_item|bool|If true, this item is a quest item and can not be dropped, stashed, or sold.
+				items[id].quest_item = toBool(infile.val);
+				break;
+			}
+
+			default:
+				infile.error("ItemManager: '%s' is not a valid key.", infile.key.c_str());
+				break;
 		}
 
 	}
@@ -427,12 +636,8 @@ Color ItemManager::getItemColor(unsigned id) {
 	if (items[id].set > 0) {
 		return item_sets[items[id].set].color;
 	}
-	else {
-		for (unsigned i=0; i<item_qualities.size(); ++i) {
-			if (item_qualities[i].id == items[id].quality) {
-				return item_qualities[i].color;
-			}
-		}
+	else if (items[id].quality_index != -1) {
+		return item_qualities[items[id].quality_index].color;
 	}
 
 	return color_normal;
@@ -567,12 +772,16 @@ void ItemManager::parseBonus(BonusData& bdata, FileParser& infile) {
 }
 
 void ItemManager::getBonusString(std::stringstream& ss, BonusData* bdata) {
+	static const StringHandle msg_speed = msg->getID("%d%% Speed");
+	static const StringHandle msg_attack_speed = msg->getID("%d%% Attack Speed");
+	static const StringHandle msg_resistance = msg->getID("%s Resistance");
+
 	if (bdata->is_speed) {
-		ss << msg->get("%d%% Speed", bdata->value);
+		ss << msg->get(msg_speed, bdata->value);
 		return;
 	}
 	else if (bdata->is_attack_speed) {
-		ss << msg->get("%d%% Attack Speed", bdata->value);
+		ss << msg->get(msg_attack_speed, bdata->value);
 		return;
 	}
 
@@ -588,7 +797,7 @@ void ItemManager::getBonusString(std::stringstream& ss, BonusData* bdata) {
 		ss << " " << STAT_NAME[bdata->stat_index];
 	}
 	else if (bdata->resist_index != -1) {
-		ss << "% " << msg->get("%s Resistance", ELEMENTS[bdata->resist_index].name.c_str());
+		ss << "% " << msg->get(msg_resistance, ELEMENTS[bdata->resist_index].name.c_str());
 	}
 	else if (bdata->base_index > -1 && static_cast<size_t>(bdata->base_index) < PRIMARY_STATS.size()) {
 		ss << " " << PRIMARY_STATS[bdata->base_index].name;
@@ -621,8 +830,79 @@ TooltipData ItemManager::getShortTooltip(ItemStack stack) {
 
 /**
  * Create detailed tooltip showing all relevant item info
+ * Tooltips are cached, since hovering across a full stash would otherwise build one per frame
  */
 TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int context) {
+	if (stack.empty() || !stats)
+		return buildTooltip(stack, stats, context);
+
+	ItemTooltipKey key(stack, context);
+	std::map<ItemTooltipKey, ItemTooltipCacheEntry>::iterator it = tooltip_cache.find(key);
+	if (it != tooltip_cache.end() && isTooltipCurrent(it->second, stats))
+		return it->second.tip;
+
+	if (it == tooltip_cache.end() && tooltip_cache.size() >= ITEM_TOOLTIP_CACHE_MAX)
+		tooltip_cache.clear();
+
+	ItemTooltipCacheEntry& entry = tooltip_cache[key];
+	entry.stats = stats;
+	entry.settings_revision = getSettingsRevision();
+	entry.level = stats->level;
+	entry.currency = stats->currency;
+	entry.character_class = stats->character_class;
+	entry.primary.resize(PRIMARY_STATS.size());
+	for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
+		entry.primary[i] = stats->get_primary(i);
+	}
+	entry.tip = buildTooltip(stack, stats, context);
+
+	return entry.tip;
+}
+
+/**
+ * The requirement and price colors depend on the hero, so a cached tooltip is rebuilt when those stats change
+ * Settings such as colorblind mode change the text too
+ */
+bool ItemManager::isTooltipCurrent(const ItemTooltipCacheEntry& entry, const StatBlock *stats) {
+	if (entry.stats != stats || entry.settings_revision != getSettingsRevision())
+		return false;
+
+	if (entry.level != stats->level || entry.currency != stats->currency)
+		return false;
+
+	if (entry.character_class != stats->character_class || entry.primary.size() != PRIMARY_STATS.size())
+		return false;
+
+	for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
+		if (entry.primary[i] != stats->get_primary(i))
+			return false;
+	}
+
+	return true;
+}
+
+TooltipData ItemManager::buildTooltip(ItemStack stack, StatBlock *stats, int context) {
+	static const StringHandle msg_quest_item = msg->getID("Quest Item");
+	static const StringHandle msg_level = msg->getID("Level %d");
+	static const StringHandle msg_quality = msg->getID("Quality: %s");
+	static const StringHandle msg_melee_damage_range = msg->getID("Melee damage: %d-%d");
+	static const StringHandle msg_melee_damage = msg->getID("Melee damage: %d");
+	static const StringHandle msg_ranged_damage_range = msg->getID("Ranged damage: %d-%d");
+	static const StringHandle msg_ranged_damage = msg->getID("Ranged damage: %d");
+	static const StringHandle msg_mental_damage_range = msg->getID("Mental damage: %d-%d");
+	static const StringHandle msg_mental_damage = msg->getID("Mental damage: %d");
+	static const StringHandle msg_absorb_range = msg->getID("Absorb: %d-%d");
+	static const StringHandle msg_absorb = msg->getID("Absorb: %d");
+	static const StringHandle msg_requires_level = msg->getID("Requires Level %d");
+	static const StringHandle msg_requires = msg->getID("Requires %s %d");
+	static const StringHandle msg_requires_class = msg->getID("Requires Class: %s");
+	static const StringHandle msg_buy_price = msg->getID("Buy Price: %d %s");
+	static const StringHandle msg_buy_price_each = msg->getID("Buy Price: %d %s each");
+	static const StringHandle msg_sell_price = msg->getID("Sell Price: %d %s");
+	static const StringHandle msg_sell_price_each = msg->getID("Sell Price: %d %s each");
+	static const StringHandle msg_set = msg->getID("Set: ");
+	static const StringHandle msg_items = msg->getID("%d items: ");
+
 	TooltipData tip;
 
 	if (stack.empty()) return tip;
@@ -639,7 +919,7 @@ TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int conte
 
 	// quest item
 	if (items[stack.item].quest_item) {
-		tip.addColoredText(msg->get("Quest Item"), color_bonus);
+		tip.addColoredText(msg->get(msg_quest_item), color_bonus);
 	}
 
 	// only show the name of the currency item
@@ -653,51 +933,49 @@ TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int conte
 
 	// level
 	if (items[stack.item].level != 0) {
-		tip.addText(msg->get("Level %d", items[stack.item].level));
+		tip.addText(msg->get(msg_level, items[stack.item].level));
 	}
 
 	// type
-	if (items[stack.item].type != "") {
-		tip.addText(msg->get(getItemType(items[stack.item].type)));
+	if (items[stack.item].type_index != -1) {
+		tip.addText(msg->get(item_types[items[stack.item].type_index].name));
+	}
+	else if (items[stack.item].type != "") {
+		tip.addText(msg->get(items[stack.item].type));
 	}
 
 	// item quality text for colorblind users
-	if (COLORBLIND && items[stack.item].quality != "") {
+	if (COLORBLIND && items[stack.item].quality_index != -1) {
 		color = color_normal;
-		for (size_t i=0; i<item_qualities.size(); ++i) {
-			if (item_qualities[i].id == items[stack.item].quality) {
-				tip.addColoredText(msg->get("Quality: %s", msg->get(item_qualities[i].name)), color);
-				break;
-			}
-		}
+		tip.addColoredText(msg->get(msg_quality, msg->get(item_qualities[items[stack.item].quality_index].name)), color);
 	}
 
 	// damage
 	if (items[stack.item].dmg_melee_max > 0) {
 		if (items[stack.item].dmg_melee_min < items[stack.item].dmg_melee_max)
-			tip.addText(msg->get("Melee damage: %d-%d", items[stack.item].dmg_melee_min, items[stack.item].dmg_melee_max));
+			tip.addText(msg->get(msg_melee_damage_range, items[stack.item].dmg_melee_min, items[stack.item].dmg_melee_max));
 		else
-			tip.addText(msg->get("Melee damage: %d", items[stack.item].dmg_melee_max));
+			tip.addText(msg->get(msg_melee_damage, items[stack.item].dmg_melee_max));
 	}
 	if (items[stack.item].dmg_ranged_max > 0) {
 		if (items[stack.item].dmg_ranged_min < items[stack.item].dmg_ranged_max)
-			tip.addText(msg->get("Ranged damage: %d-%d", items[stack.item].dmg_ranged_min, items[stack.item].dmg_ranged_max));
+			tip.addText(msg->get(msg_ranged_damage_range, items[stack.item].dmg_ranged_min, items[stack.item].dmg_ranged_max));
 		else
-			tip.addText(msg->get("Ranged damage: %d", items[stack.item].dmg_ranged_max));
+			tip.addText(msg->get(msg_ranged_damage, items[stack.item].dmg_ranged_max));
 	}
 	if (items[stack.item].dmg_ment_max > 0) {
 		if (items[stack.item].dmg_ment_min < items[stack.item].dmg_ment_max)
-			tip.addText(msg->get("Mental damage: %d-%d", items[stack.item].dmg_ment_min, items[stack.item].dmg_ment_max));
+			tip.addText(msg->get(msg_mental_damage_range, items[stack.item].dmg_ment_min, items[stack.item].dmg_ment_max));
 		else
-			tip.addText(msg->get("Mental damage: %d", items[stack.item].dmg_ment_max));
+			tip.addText(msg->get(msg_mental_damage, items[stack.item].dmg_ment_max));
 	}
 
 	// absorb
 	if (items[stack.item].abs_max > 0) {
 		if (items[stack.item].abs_min < items[stack.item].abs_max)
-			tip.addText(msg->get("Absorb: %d-%d", items[stack.item].abs_min, items[stack.item].abs_max));
+			tip.addText(msg->get(msg_absorb_range, items[stack.item].abs_min, items[stack.item].abs_max));
 		else
-			tip.addText(msg->get("Absorb: %d", items[stack.item].abs_max));
+			tip.addText(msg->get(msg_absorb, items[stack.item].abs_max));
 	}
 
 	// bonuses
@@ -734,7 +1012,7 @@ TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int conte
 	if (items[stack.item].requires_level > 0) {
 		if (stats->level < items[stack.item].requires_level) color = color_requirements_not_met;
 		else color = color_normal;
-		tip.addColoredText(msg->get("Requires Level %d", items[stack.item].requires_level), color);
+		tip.addColoredText(msg->get(msg_requires_level, items[stack.item].requires_level), color);
 	}
 
 	// base stat requirement
@@ -745,7 +1023,7 @@ TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int conte
 			else
 				color = color_normal;
 
-			tip.addColoredText(msg->get("Requires %s %d", items[stack.item].req_val[i], PRIMARY_STATS[items[stack.item].req_stat[i]].name.c_str()), color);
+			tip.addColoredText(msg->get(msg_requires, items[stack.item].req_val[i], PRIMARY_STATS[items[stack.item].req_stat[i]].name.c_str()), color);
 		}
 	}
 
@@ -753,7 +1031,7 @@ TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int conte
 	if (items[stack.item].requires_class != "") {
 		if (items[stack.item].requires_class != stats->character_class) color = color_requirements_not_met;
 		else color = color_normal;
-		tip.addColoredText(msg->get("Requires Class: %s", msg->get(items[stack.item].requires_class)), color);
+		tip.addColoredText(msg->get(msg_requires_class, msg->get(items[stack.item].requires_class)), color);
 	}
 
 	// buy or sell price
@@ -765,26 +1043,26 @@ TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int conte
 			if (stats->currency < price_per_unit) color = color_requirements_not_met;
 			else color = color_normal;
 			if (items[stack.item].max_quantity <= 1)
-				tip.addColoredText(msg->get("Buy Price: %d %s", price_per_unit, CURRENCY), color);
+				tip.addColoredText(msg->get(msg_buy_price, price_per_unit, CURRENCY), color);
 			else
-				tip.addColoredText(msg->get("Buy Price: %d %s each", price_per_unit, CURRENCY), color);
+				tip.addColoredText(msg->get(msg_buy_price_each, price_per_unit, CURRENCY), color);
 		}
 		else if (context == VENDOR_SELL) {
 			price_per_unit = items[stack.item].getSellPrice();
 			if (stats->currency < price_per_unit) color = color_requirements_not_met;
 			else color = color_normal;
 			if (items[stack.item].max_quantity <= 1)
-				tip.addColoredText(msg->get("Buy Price: %d %s", price_per_unit, CURRENCY), color);
+				tip.addColoredText(msg->get(msg_buy_price, price_per_unit, CURRENCY), color);
 			else
-				tip.addColoredText(msg->get("Buy Price: %d %s each", price_per_unit, CURRENCY), color);
+				tip.addColoredText(msg->get(msg_buy_price_each, price_per_unit, CURRENCY), color);
 		}
 		else if (context == PLAYER_INV) {
 			price_per_unit = items[stack.item].getSellPrice();
 			if (price_per_unit == 0) price_per_unit = 1;
 			if (items[stack.item].max_quantity <= 1)
-				tip.addText(msg->get("Sell Price: %d %s", price_per_unit, CURRENCY));
+				tip.addText(msg->get(msg_sell_price, price_per_unit, CURRENCY));
 			else
-				tip.addText(msg->get("Sell Price: %d %s each", price_per_unit, CURRENCY));
+				tip.addText(msg->get(msg_sell_price_each, price_per_unit, CURRENCY));
 		}
 	}
 
@@ -793,14 +1071,14 @@ TooltipData ItemManager::getTooltip(ItemStack stack, StatBlock *stats, int conte
 		ItemSet set = item_sets[items[stack.item].set];
 		bonus_counter = 0;
 
-		tip.addColoredText("\n" + msg->get("Set: ") + msg->get(item_sets[items[stack.item].set].name), set.color);
+		tip.addColoredText("\n" + msg->get(msg_set) + msg->get(item_sets[items[stack.item].set].name), set.color);
 
 		while (bonus_counter < set.bonus.size()) {
 			ss.str("");
 
 			Set_bonus* bdata = &set.bonus[bonus_counter];
 
-			ss << msg->get("%d items: ", bdata->requirement);
+			ss << msg->get(msg_items, bdata->requirement);
 
 			getBonusString(ss, bdata);
 			tip.addColoredText(ss.str(), set.color);
@@ -837,6 +1115,14 @@ bool ItemManager::requirementsMet(const StatBlock *stats, int item) {
 	return true;
 }
 
+void ItemManager::getMemoryUsage(MemoryUsage& usage) const {
+	usage.addTable(items.size(), items.capacity() * sizeof(Item));
+	usage.addTable(item_sets.size(), item_sets.capacity() * sizeof(ItemSet));
+	usage.addTable(item_types.size(), item_types.capacity() * sizeof(ItemType));
+	usage.addTable(item_qualities.size(), item_qualities.capacity() * sizeof(ItemQuality));
+	usage.addTable(tooltip_cache.size(), tooltip_cache.size() * sizeof(ItemTooltipCacheEntry));
+}
+
 ItemManager::~ItemManager() {
 }
 
@@ -36,8 +36,12 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #define VENDOR_SELL 1
 #define PLAYER_INV 2
 
+class MemoryUsage;
 class StatBlock;
 
+// the tooltip cache is emptied once it holds this many tooltips
+const size_t ITEM_TOOLTIP_CACHE_MAX = 512;
+
 class LootAnimation {
 public:
 	std::string name;
@@ -101,7 +105,7 @@ public:
 	int set;              // item can be attached to item set
 	std::string quality;  // should match an id from items/qualities.txt
 	std::string type;     // equipment slot or base item type
-	std::vector<std::string> equip_flags;   // common values include: melee, ranged, mental, shield
+	std::vector<StringHandle> equip_flags;   // common values include: melee, ranged, mental, shield
 	int icon;             // icon index on small pixel sheet
 	std::string book;     // book file location
 	int dmg_melee_min;    // minimum damage amount (melee)
@@ -133,6 +137,12 @@ public:
 	std::vector<std::string> disable_slots; // if this item is equipped, it will disable slots that match the types in the list
 	bool quest_item;
 
+	// the strings above as ids, filled in by ItemManager once all the item files are loaded
+	StringHandle type_id;
+	int type_index;       // index into ItemManager::item_types, -1 if the type has no entry
+	int quality_index;    // index into ItemManager::item_qualities, -1 if the quality has no entry
+	std::vector<StringHandle> disable_slot_ids;
+
 	int getPrice();
 	int getSellPrice();
 
@@ -166,7 +176,10 @@ public:
 		, max_quantity(1)
 		, pickup_status("")
 		, stepfx("")
-		, quest_item(false) {
+		, quest_item(false)
+		, type_id(0)
+		, type_index(-1)
+		, quality_index(-1) {
 	}
 
 	~Item() {
@@ -217,6 +230,45 @@ public:
 	std::string name;
 };
 
+class ItemTooltipKey {
+public:
+	int item;
+	int quantity;
+	int context;
+
+	ItemTooltipKey(const ItemStack& stack, int _context)
+		: item(stack.item)
+		, quantity(stack.quantity)
+		, context(_context) {
+	}
+
+	bool operator < (const ItemTooltipKey& other) const {
+		if (item != other.item) return item < other.item;
+		if (quantity != other.quantity) return quantity < other.quantity;
+		return context < other.context;
+	}
+};
+
+// a tooltip built by getTooltip(), along with the parts of the hero it depends on
+class ItemTooltipCacheEntry {
+public:
+	const StatBlock *stats;
+	unsigned settings_revision;
+	int level;
+	int currency;
+	std::string character_class;
+	std::vector<int> primary;
+	TooltipData tip;
+
+	ItemTooltipCacheEntry()
+		: stats(NULL)
+		, settings_revision(0)
+		, level(0)
+		, currency(0)
+		, character_class("") {
+	}
+};
+
 class ItemManager {
 protected:
 	void loadItems(const std::string& filename, bool locateFileName = true);
@@ -225,8 +277,13 @@ protected:
 	void loadQualities(const std::string& filename, bool locateFileName = true);
 private:
 	void loadAll();
+	void indexItems();
 	void parseBonus(BonusData& bdata, FileParser& infile);
 	void getBonusString(std::stringstream& ss, BonusData* bdata);
+	TooltipData buildTooltip(ItemStack stack, StatBlock *stats, int context);
+	bool isTooltipCurrent(const ItemTooltipCacheEntry& entry, const StatBlock *stats);
+
+	std::map<ItemTooltipKey, ItemTooltipCacheEntry> tooltip_cache;
 
 	Color color_normal;
 	Color color_low;
@@ -240,6 +297,12 @@ private:
 public:
 	ItemManager();
 	~ItemManager();
+
+	// loads the item sounds; must be called on the main thread
+	void loadSounds();
+
+	// parses the item files again, for changes made while the game runs
+	void reload();
 	void playSound(int item, const Point& pos = Point(0,0));
 	TooltipData getTooltip(ItemStack stack, StatBlock *stats, int context);
 	TooltipData getShortTooltip(ItemStack item);
@@ -248,6 +311,7 @@ public:
 	Color getItemColor(unsigned id);
 	void addUnknownItem(unsigned id);
 	bool requirementsMet(const StatBlock *stats, int item);
+	void getMemoryUsage(MemoryUsage& usage) const;
 
 	std::vector<Item> items;
 	std::vector<ItemType> item_types;
@@ -257,4 +321,7 @@ public:
 
 bool compareItemStack(const ItemStack &stack1, const ItemStack &stack2);
 
+// the item type of items that are used from the inventory or action bar
+extern const StringHandle ITEM_TYPE_CONSUMABLE;
+
 #endif
@@ -28,6 +28,12 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <limits.h>
 
+ItemStorage::ItemStorage()
+	: slot_number(0)
+	, quantities_changed(true)
+	, storage(NULL) {
+}
+
 void ItemStorage::init(int _slot_number) {
 	slot_number = _slot_number;
 
@@ -36,17 +42,39 @@ void ItemStorage::init(int _slot_number) {
 	for( int i=0; i<slot_number; i++) {
 		storage[i].clear();
 	}
+	quantities_changed = true;
 }
 
 ItemStack & ItemStorage::operator [] (int slot) {
+	quantities_changed = true;
 	return storage[slot];
 }
 
+void ItemStorage::setChanged() {
+	quantities_changed = true;
+}
+
+/**
+ * Counts the quantity of each item again if the slots were changed since the last time
+ */
+void ItemStorage::updateQuantities() {
+	if (!quantities_changed)
+		return;
+
+	quantities.clear();
+	for (int i=0; i<slot_number; i++) {
+		if (storage[i].item != 0 || storage[i].quantity != 0)
+			quantities[storage[i].item] += storage[i].quantity;
+	}
+	quantities_changed = false;
+}
+
 /**
  * Take the savefile CSV list of items id and convert to storage array
  */
 void ItemStorage::setItems(const std::string& s) {
 	std::string item_list = s + ',';
+	quantities_changed = true;
 	for (int i=0; i<slot_number; i++) {
 		storage[i].item = popFirstInt(item_list);
 		// check if such item exists to avoid crash if savegame was modified manually
@@ -66,6 +94,7 @@ void ItemStorage::setItems(const std::string& s) {
  */
 void ItemStorage::setQuantities(const std::string& s) {
 	std::string quantity_list = s + ',';
+	quantities_changed = true;
 	for (int i=0; i<slot_number; i++) {
 		storage[i].quantity = popFirstInt(quantity_list);
 		if (storage[i].quantity < 0) {
@@ -109,6 +138,7 @@ void ItemStorage::clear() {
 	for( int i=0; i<slot_number; i++) {
 		storage[i].clear();
 	}
+	quantities_changed = true;
 }
 
 /**
@@ -152,6 +182,7 @@ ItemStack ItemStorage::add( ItemStack stack, int slot) {
 		}
 		if (slot != -1) {
 			// Add
+			quantities_changed = true;
 			int quantity_added = std::min( stack.quantity, max_quantity - storage[slot].quantity);
 			storage[slot].item = stack.item;
 			storage[slot].quantity += quantity_added;
@@ -178,6 +209,7 @@ ItemStack ItemStorage::add( ItemStack stack, int slot) {
  * @param slot Slot number
  */
 void ItemStorage::subtract(int slot, int quantity) {
+	quantities_changed = true;
 	storage[slot].quantity -= quantity;
 	if (storage[slot].quantity <= 0) {
 		storage[slot].clear();
@@ -191,6 +223,9 @@ bool ItemStorage::remove(int item, int quantity) {
 	if (item == 0)
 		return false;
 
+	if (!contain(item, 1))
+		return false;
+
 	const int lowest_quantity = INT_MAX;
 
 	while (quantity > 0) {
@@ -256,33 +291,29 @@ bool ItemStorage::full(ItemStack stack) {
  * Get the number of the specified item carried (not equipped)
  */
 int ItemStorage::count(int item) {
-	int item_count=0;
-	for (int i=0; i<slot_number; i++) {
-		if (storage[i].item == item) {
-			item_count += storage[i].quantity;
-		}
-	}
-	return item_count;
+	updateQuantities();
+
+	std::map<int, int>::const_iterator it = quantities.find(item);
+	if (it == quantities.end())
+		return 0;
+	return it->second;
 }
 
 /**
  * Check to see if the given item is equipped
  */
 bool ItemStorage::contain(int item, int quantity) {
-	int total_quantity = 0;
-	for (int i=0; i<slot_number; i++) {
-		if (storage[i].item == item)
-			total_quantity += storage[i].quantity;
-		if (total_quantity >= quantity)
-			return true;
-	}
-	return false;
+	if (slot_number == 0)
+		return false;
+
+	return count(item) >= quantity;
 }
 
 /**
  * Clear slots that contain an item, but have a quantity of 0
  */
 void ItemStorage::clean() {
+	quantities_changed = true;
 	for (int i=0; i<slot_number; i++) {
 		if (storage[i].item > 0 && storage[i].quantity < 1) {
 			logInfo("ItemStorage: Removing item with id %d, which has a quantity of 0",storage[i].item);
@@ -32,12 +32,22 @@ class ItemStorage {
 protected:
 	int slot_number;
 
+	// item id -> total quantity in the slots, used by count() and contain()
+	std::map<int, int> quantities;
+	bool quantities_changed;
+	void updateQuantities();
+
 public:
+	ItemStorage();
 	void init(int _slot_number);
 	~ItemStorage();
 
+	// the slot may be changed through the returned reference, so it also counts as a change
 	ItemStack & operator [] (int slot);
 
+	// must be called after changing 'storage' directly
+	void setChanged();
+
 	void setItems(const std::string& s);
 	void setQuantities(const std::string& s);
 	int getSlotNumber();
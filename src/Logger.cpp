@@ -0,0 +1,210 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class Logger
+ */
+
+#include "Logger.h"
+
+#include <string.h>
+
+// positions in the ring buffer count up and wrap around, so they are compared as unsigned
+static int nextPos(int pos, int step) {
+	return static_cast<int>(static_cast<unsigned>(pos) + static_cast<unsigned>(step));
+}
+
+static int posDiff(int a, int b) {
+	return static_cast<int>(static_cast<unsigned>(a) - static_cast<unsigned>(b));
+}
+
+Logger::Logger()
+	: read_pos(0)
+	, quit(false)
+	, thread(NULL)
+	, added(NULL)
+	, last_repeats(-1)
+	, second_start(0)
+	, second_lines(0)
+	, suppressed(0) {
+	for (int i = 0; i < LOG_QUEUE_SIZE; ++i) {
+		SDL_AtomicSet(&entries[i].sequence, i);
+	}
+	SDL_AtomicSet(&write_pos, 0);
+	SDL_AtomicSet(&dropped, 0);
+	SDL_AtomicSet(&running, 0);
+}
+
+Logger::~Logger() {
+	stop();
+}
+
+void Logger::start() {
+	if (thread)
+		return;
+
+	added = SDL_CreateSemaphore(0);
+	if (!added) {
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Logger: Could not create semaphore: %s", SDL_GetError());
+		return;
+	}
+
+	quit = false;
+	SDL_AtomicSet(&running, 1);
+
+	thread = SDL_CreateThread(run, "Logger", this);
+	if (!thread) {
+		SDL_AtomicSet(&running, 0);
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Logger: Could not create thread: %s", SDL_GetError());
+	}
+}
+
+/**
+ * Messages added by other threads while stopping may be lost, so this is meant for when the other threads are gone
+ */
+void Logger::stop() {
+	if (thread) {
+		SDL_AtomicSet(&running, 0);
+		quit = true;
+		SDL_SemPost(added);
+		SDL_WaitThread(thread, NULL);
+		thread = NULL;
+
+		LogEntry entry;
+		while (pop(entry))
+			write(entry);
+		writeRepeats();
+	}
+
+	if (added) {
+		SDL_DestroySemaphore(added);
+		added = NULL;
+	}
+}
+
+/**
+ * Writer thread loop; wakes up at least once a second to write the repeat and rate limit counts
+ */
+int Logger::run(void *data) {
+	Logger *logger = static_cast<Logger*>(data);
+	LogEntry entry;
+
+	while (true) {
+		SDL_SemWaitTimeout(logger->added, 1000);
+
+		while (logger->pop(entry))
+			logger->write(entry);
+
+		const int dropped = SDL_AtomicSet(&logger->dropped, 0);
+		if (dropped > 0)
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Logger: %d messages did not fit into the log queue.", dropped);
+
+		if (SDL_GetTicks() - logger->second_start >= 1000) {
+			logger->writeRepeats();
+			if (logger->suppressed > 0)
+				SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Logger: %d messages were left out of the last second.", logger->suppressed);
+			logger->second_start = SDL_GetTicks();
+			logger->second_lines = 0;
+			logger->suppressed = 0;
+		}
+
+		if (logger->quit)
+			break;
+	}
+
+	return 0;
+}
+
+/**
+ * Any thread may add messages. The entry is claimed first and formatted in place,
+ * so that a full queue costs nothing but the attempt.
+ */
+void Logger::add(SDL_LogPriority priority, const char* format, va_list args) {
+	if (SDL_AtomicGet(&running) == 0) {
+		SDL_LogMessageV(SDL_LOG_CATEGORY_APPLICATION, priority, format, args);
+		return;
+	}
+
+	int pos = SDL_AtomicGet(&write_pos);
+	LogEntry *entry;
+	while (true) {
+		entry = &entries[pos & (LOG_QUEUE_SIZE - 1)];
+		const int diff = posDiff(SDL_AtomicGet(&entry->sequence), pos);
+
+		if (diff == 0) {
+			if (SDL_AtomicCAS(&write_pos, pos, nextPos(pos, 1)))
+				break;
+			pos = SDL_AtomicGet(&write_pos);
+		}
+		else if (diff < 0) {
+			// the writer hasn't gotten to this entry since the last turn of the ring buffer
+			SDL_AtomicIncRef(&dropped);
+			return;
+		}
+		else {
+			pos = SDL_AtomicGet(&write_pos);
+		}
+	}
+
+	entry->priority = priority;
+	SDL_vsnprintf(entry->text, LOG_LINE_MAX, format, args);
+	SDL_AtomicSet(&entry->sequence, nextPos(pos, 1));
+
+	SDL_SemPost(added);
+}
+
+bool Logger::pop(LogEntry& entry) {
+	LogEntry& next = entries[read_pos & (LOG_QUEUE_SIZE - 1)];
+	if (SDL_AtomicGet(&next.sequence) != nextPos(read_pos, 1))
+		return false;
+
+	entry.priority = next.priority;
+	memcpy(entry.text, next.text, LOG_LINE_MAX);
+
+	// the entry can be used again in the next turn of the ring buffer
+	SDL_AtomicSet(&next.sequence, nextPos(read_pos, LOG_QUEUE_SIZE));
+	read_pos = nextPos(read_pos, 1);
+	return true;
+}
+
+void Logger::write(const LogEntry& entry) {
+	if (last_repeats >= 0 && entry.priority == last.priority && strcmp(entry.text, last.text) == 0) {
+		last_repeats++;
+		return;
+	}
+
+	writeRepeats();
+
+	if (second_lines >= LOG_LINES_PER_SECOND) {
+		suppressed++;
+		return;
+	}
+	second_lines++;
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, entry.priority, "%s", entry.text);
+
+	last.priority = entry.priority;
+	memcpy(last.text, entry.text, LOG_LINE_MAX);
+	last_repeats = 0;
+}
+
+void Logger::writeRepeats() {
+	if (last_repeats > 0)
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, last.priority, "(last message repeated %d times)", last_repeats);
+	if (last_repeats >= 0)
+		last_repeats = 0;
+}
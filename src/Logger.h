@@ -0,0 +1,96 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class Logger
+ *
+ * Writes the messages of logInfo() and logError() on a background thread, since
+ * writing to the console can take milliseconds per line on some platforms.
+ * Messages are formatted into a fixed ring buffer that any thread can add to
+ * without locking. If the buffer is full, messages are dropped and counted.
+ *
+ * The writer thread collapses repeats of the same message and keeps to
+ * LOG_LINES_PER_SECOND, so that a mod with broken references can't flood the log.
+ * Until start() and after stop(), messages are written right away.
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdarg.h>
+
+#include <SDL.h>
+
+// the number of messages that can wait for the writer thread; must be a power of 2
+const int LOG_QUEUE_SIZE = 256;
+
+// longer messages are cut off
+const int LOG_LINE_MAX = 1024;
+
+// messages over this are left out, and only counted
+const int LOG_LINES_PER_SECOND = 200;
+
+class LogEntry {
+public:
+	SDL_atomic_t sequence; // which turn of the ring buffer this entry is ready for
+	SDL_LogPriority priority;
+	char text[LOG_LINE_MAX];
+};
+
+class Logger {
+private:
+	static int run(void *data);
+
+	bool pop(LogEntry& entry);
+
+	// collapses repeats and applies the rate limit; only on the writer thread
+	void write(const LogEntry& entry);
+	void writeRepeats();
+
+	LogEntry entries[LOG_QUEUE_SIZE];
+	SDL_atomic_t write_pos;
+	int read_pos;
+
+	// messages that didn't fit into the ring buffer, written as a count
+	SDL_atomic_t dropped;
+
+	SDL_atomic_t running;
+	bool quit;
+	SDL_Thread *thread;
+	SDL_sem *added;
+
+	// only used by the thread that writes the messages
+	LogEntry last;
+	int last_repeats;
+	Uint32 second_start;
+	int second_lines;
+	int suppressed;
+
+public:
+	Logger();
+	Logger(const Logger&); // not implemented
+	~Logger();
+
+	void start();
+
+	// writes the waiting messages and goes back to writing them right away
+	void stop();
+
+	void add(SDL_LogPriority priority, const char* format, va_list args);
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,106 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "LootGrid.h"
+#include "Loot.h"
+
+LootGrid::LootGrid()
+	: cell_count(1, 1)
+	, loot_count(0)
+	, valid(false) {
+}
+
+LootGrid::~LootGrid() {
+}
+
+int LootGrid::getCell(const FPoint& pos) const {
+	int x = std::max(0, std::min(static_cast<int>(pos.x) / LOOT_GRID_CELL_SIZE, cell_count.x - 1));
+	int y = std::max(0, std::min(static_cast<int>(pos.y) / LOOT_GRID_CELL_SIZE, cell_count.y - 1));
+	return y * cell_count.x + x;
+}
+
+/**
+ * Returns the range of cells overlapping the area, as x,y of the first cell and w,h of the last
+ * Areas outside of the map are clamped to the nearest border cells
+ */
+Rect LootGrid::getCellRange(const Rect& area) const {
+	Rect r;
+	r.x = std::max(0, std::min(area.x / LOOT_GRID_CELL_SIZE, cell_count.x - 1));
+	r.y = std::max(0, std::min(area.y / LOOT_GRID_CELL_SIZE, cell_count.y - 1));
+	r.w = std::max(0, std::min((area.x + std::max(area.w, 1) - 1) / LOOT_GRID_CELL_SIZE, cell_count.x - 1));
+	r.h = std::max(0, std::min((area.y + std::max(area.h, 1) - 1) / LOOT_GRID_CELL_SIZE, cell_count.y - 1));
+	return r;
+}
+
+void LootGrid::build(const std::vector<Loot>& loot, const Point& map_size) {
+	cell_count.x = std::max(1, (map_size.x + LOOT_GRID_CELL_SIZE - 1) / LOOT_GRID_CELL_SIZE);
+	cell_count.y = std::max(1, (map_size.y + LOOT_GRID_CELL_SIZE - 1) / LOOT_GRID_CELL_SIZE);
+
+	for (size_t i = 0; i < cells.size(); ++i) {
+		cells[i].clear();
+	}
+	cells.resize(static_cast<size_t>(cell_count.x * cell_count.y));
+
+	for (unsigned i = 0; i < loot.size(); ++i) {
+		cells[getCell(loot[i].pos)].push_back(i);
+	}
+
+	loot_count = loot.size();
+	valid = true;
+}
+
+void LootGrid::add(unsigned index, const FPoint& pos) {
+	if (!valid || index != loot_count) {
+		valid = false;
+		return;
+	}
+
+	cells[getCell(pos)].push_back(index);
+	loot_count++;
+}
+
+void LootGrid::invalidate() {
+	valid = false;
+}
+
+bool LootGrid::isValid(size_t _loot_count) const {
+	return valid && loot_count == _loot_count;
+}
+
+void LootGrid::query(const Rect& area, std::vector<unsigned>& result) const {
+	result.clear();
+
+	Rect range = getCellRange(area);
+	for (int y = range.y; y <= range.h; ++y) {
+		for (int x = range.x; x <= range.w; ++x) {
+			const std::vector<unsigned> &cell = cells[y * cell_count.x + x];
+			result.insert(result.end(), cell.begin(), cell.end());
+		}
+	}
+
+	// each piece of loot is in a single cell, so there are no duplicates
+	std::sort(result.begin(), result.end(), std::greater<unsigned>());
+}
+
+void LootGrid::query(const FPoint& pos, float radius, std::vector<unsigned>& result) const {
+	Rect area;
+	area.x = static_cast<int>(pos.x - radius);
+	area.y = static_cast<int>(pos.y - radius);
+	area.w = static_cast<int>(radius * 2) + 2;
+	area.h = area.w;
+	query(area, result);
+}
@@ -0,0 +1,70 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class LootGrid
+ *
+ * A uniform grid of map cells over the floor loot, so that pickups, tooltips
+ * and renders only look at the loot near the hero or the camera.
+ * Loot is referred to by its index in the LootManager's list. New loot can be
+ * added to the grid directly, but it has to be rebuilt when loot is removed.
+ */
+
+#ifndef LOOT_GRID_H
+#define LOOT_GRID_H
+
+#include "CommonIncludes.h"
+#include "Utils.h"
+
+class Loot;
+
+// width and height of a grid cell, in map tiles
+const int LOOT_GRID_CELL_SIZE = 4;
+
+class LootGrid {
+private:
+	int getCell(const FPoint& pos) const;
+	Rect getCellRange(const Rect& area) const;
+
+	Point cell_count;
+	size_t loot_count;
+	bool valid;
+	std::vector<std::vector<unsigned> > cells;
+
+public:
+	LootGrid();
+	~LootGrid();
+
+	void build(const std::vector<Loot>& loot, const Point& map_size);
+
+	// index must be the next one after the loot that is already in the grid
+	void add(unsigned index, const FPoint& pos);
+
+	// must be called after removing loot
+	void invalidate();
+	bool isValid(size_t _loot_count) const;
+
+	// Queries return loot indices in descending order, so that the most recently dropped loot comes first.
+
+	// loot in the cells overlapping the area, in map tiles
+	void query(const Rect& area, std::vector<unsigned>& result) const;
+
+	// loot in the cells overlapping the square around pos
+	void query(const FPoint& pos, float radius, std::vector<unsigned>& result) const;
+};
+
+#endif // LOOT_GRID_H
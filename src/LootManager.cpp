@@ -122,11 +122,73 @@ void LootManager::loadGraphics() {
 
 void LootManager::handleNewMap() {
 	loot.clear();
+	loot_grid.invalidate();
+	tip_candidates.clear();
+}
+
+void LootManager::updateGrid() {
+	if (!loot_grid.isValid(loot.size()))
+		loot_grid.build(loot, Point(mapr->w, mapr->h));
+}
+
+/**
+ * Gets the loot that might be on screen
+ * The visible part of the map is a diamond in isometric view, so this is its bounding box.
+ */
+void LootManager::queryView(const FPoint& cam, std::vector<unsigned>& result) {
+	const FPoint corners[4] = {
+		screen_to_map(0, 0, cam.x, cam.y),
+		screen_to_map(VIEW_W, 0, cam.x, cam.y),
+		screen_to_map(0, VIEW_H, cam.x, cam.y),
+		screen_to_map(VIEW_W, VIEW_H, cam.x, cam.y)
+	};
+
+	FPoint min_pos = corners[0];
+	FPoint max_pos = corners[0];
+	for (int i = 1; i < 4; ++i) {
+		min_pos.x = std::min(min_pos.x, corners[i].x);
+		min_pos.y = std::min(min_pos.y, corners[i].y);
+		max_pos.x = std::max(max_pos.x, corners[i].x);
+		max_pos.y = std::max(max_pos.y, corners[i].y);
+	}
+
+	// loot sprites and labels can reach outside of their tile
+	const int margin = 2;
+
+	Rect area;
+	area.x = static_cast<int>(min_pos.x) - margin;
+	area.y = static_cast<int>(min_pos.y) - margin;
+	area.w = static_cast<int>(max_pos.x - min_pos.x) + margin * 2 + 1;
+	area.h = static_cast<int>(max_pos.y - min_pos.y) + margin * 2 + 1;
+
+	updateGrid();
+	loot_grid.query(area, result);
+}
+
+/**
+ * Take the loot off the floor and return its item stack
+ */
+ItemStack LootManager::removeLoot(unsigned index) {
+	ItemStack stack = loot[index].stack;
+
+	loot.erase(loot.begin() + index);
+	loot_grid.invalidate();
+
+	// the indices of the shown tooltips have changed, so clear all of them
+	for (size_t i = 0; i < loot.size(); ++i) {
+		loot[i].tip_visible = false;
+	}
+	tip_candidates.clear();
+
+	return stack;
 }
 
 void LootManager::logic() {
 	std::vector<Loot>::iterator it;
 	for (it = loot.begin(); it != loot.end(); ++it) {
+		// loot that has landed and finished its animation has nothing left to do
+		if (it->sound_played && (!it->animation || it->animation->isCompleted()))
+			continue;
 
 		// animate flying loot
 		if (it->animation) {
@@ -163,12 +225,23 @@ void LootManager::renderTooltips(const FPoint& cam) {
 
 	Point dest;
 
-	std::vector<Loot>::iterator it;
-	for (it = loot.begin(); it != loot.end(); ) {
-		it->tip_visible = false;
+	for (size_t i = 0; i < tip_candidates.size(); ++i) {
+		loot[tip_candidates[i]].tip_visible = false;
+	}
+
+	// only the loot near the camera can have a visible tooltip
+	// the oldest loot is checked first, so that its tooltip is given priority when hovering
+	queryView(cam, tip_candidates);
+	std::reverse(tip_candidates.begin(), tip_candidates.end());
+
+	ScreenTransform view;
+	view.setCamera(cam);
+
+	for (size_t i = 0; i < tip_candidates.size(); ++i) {
+		Loot *it = &loot[tip_candidates[i]];
 
 		if (it->on_ground) {
-			Point p = map_to_screen(it->pos.x, it->pos.y, cam.x, cam.y);
+			Point p = view.mapToScreen(it->pos.x, it->pos.y);
 			dest.x = p.x;
 			dest.y = p.y + TILE_H_HALF;
 
@@ -200,8 +273,6 @@ void LootManager::renderTooltips(const FPoint& cam) {
 					break;
 			}
 		}
-
-		++it;
 	}
 }
 
@@ -213,6 +284,13 @@ void LootManager::checkEnemiesForLoot() {
 	for (unsigned i=0; i < enemiesDroppingLoot.size(); ++i) {
 		Enemy *e = enemiesDroppingLoot[i];
 
+		// the loot table of an enemy type is shared, so each enemy rolls on a copy of it, once
+		enemy_loot_table.swap(e->stats.loot_table);
+		e->stats.loot_table.clear();
+		if (e->definition && !e->loot_dropped)
+			enemy_loot_table.insert(enemy_loot_table.end(), e->definition->loot_table.begin(), e->definition->loot_table.end());
+		e->loot_dropped = true;
+
 		if (e->stats.quest_loot_id != 0) {
 			// quest loot
 			Event_Component ec;
@@ -221,23 +299,23 @@ void LootManager::checkEnemiesForLoot() {
 			ec.a = ec.b = 1;
 			ec.z = 0;
 
-			e->stats.loot_table.push_back(ec);
+			enemy_loot_table.push_back(ec);
 		}
 
-		if (!e->stats.loot_table.empty()) {
+		if (!enemy_loot_table.empty()) {
 			unsigned drops;
 			if (e->stats.loot_count.y != 0) {
-				drops = randBetween(e->stats.loot_count.x, e->stats.loot_count.y);
+				drops = randBetween(e->stats.loot_count.x, e->stats.loot_count.y, RANDOM_LOOT);
 			}
 			else {
-				drops = randBetween(1, drop_max);
+				drops = randBetween(1, drop_max, RANDOM_LOOT);
 			}
 
 			for (unsigned j=0; j<drops; ++j) {
-				checkLoot(e->stats.loot_table, &e->stats.pos);
+				checkLoot(enemy_loot_table, &e->stats.pos);
 			}
 
-			e->stats.loot_table.clear();
+			enemy_loot_table.clear();
 		}
 	}
 	enemiesDroppingLoot.clear();
@@ -250,10 +328,10 @@ void LootManager::checkMapForLoot() {
 	if (!mapr->loot.empty()) {
 		unsigned drops;
 		if (mapr->loot_count.y != 0) {
-			drops = randBetween(mapr->loot_count.x, mapr->loot_count.y);
+			drops = randBetween(mapr->loot_count.x, mapr->loot_count.y, RANDOM_LOOT);
 		}
 		else {
-			drops = randBetween(1, drop_max);
+			drops = randBetween(1, drop_max, RANDOM_LOOT);
 		}
 
 		for (unsigned i=0; i<drops; ++i) {
@@ -270,78 +348,95 @@ void LootManager::addEnemyLoot(Enemy *e) {
 	enemiesDroppingLoot.push_back(e);
 }
 
+static bool isFixedLoot(const Event_Component& ec) {
+	return ec.z == 0;
+}
+
+/**
+ * Drop the item of a loot table entry at pos, or at the position of the entry if pos is NULL
+ */
+void LootManager::dropLootEntry(const Event_Component *ec, const FPoint *pos, std::vector<ItemStack> *itemstack_vec) {
+	FPoint p;
+	ItemStack new_loot;
+
+	Point src;
+	if (pos) {
+		src = FPointToPoint(*pos);
+	}
+	else {
+		src.x = ec->x;
+		src.y = ec->y;
+	}
+	p.x = static_cast<float>(src.x) + 0.5f;
+	p.y = static_cast<float>(src.y) + 0.5f;
+
+	if (!mapr->collider.is_valid_position(p.x, p.y, MOVEMENT_NORMAL, false)) {
+		p = mapr->collider.get_random_neighbor(src, drop_radius);
+
+		if (!mapr->collider.is_valid_position(p.x, p.y, MOVEMENT_NORMAL, false)) {
+			p = hero->pos;
+		}
+		else {
+			if (src.x == static_cast<int>(p.x) && src.y == static_cast<int>(p.y))
+				p = hero->pos;
+
+			mapr->collider.block(p.x, p.y, false);
+			tiles_to_unblock.push_back(FPointToPoint(p));
+		}
+	}
+
+	new_loot.quantity = randBetween(ec->a,ec->b, RANDOM_LOOT);
+
+	// an item id of 0 means we should drop currency instead
+	if (ec->c == 0 || ec->c == CURRENCY_ID) {
+		new_loot.item = CURRENCY_ID;
+		new_loot.quantity = new_loot.quantity * (100 + hero->get(STAT_CURRENCY_FIND)) / 100;
+	}
+	else {
+		new_loot.item = ec->c;
+	}
+
+	if (itemstack_vec)
+		itemstack_vec->push_back(new_loot);
+	else
+		addLoot(new_loot, p);
+}
+
 void LootManager::checkLoot(std::vector<Event_Component> &loot_table, FPoint *pos, std::vector<ItemStack> *itemstack_vec) {
 	if (hero == NULL) {
 		logError("LootManager: checkLoot() failed, no hero.");
 		return;
 	}
 
-	FPoint p;
 	Event_Component *ec;
-	ItemStack new_loot;
-	std::vector<Event_Component*> possible_ids;
 
-	int chance = rand() % 100;
+	int chance = randInt(100, RANDOM_LOOT);
 
 	// first drop any 'fixed' (0% chance) items
+	// they only drop once, so they are removed from the table afterwards
+	bool has_fixed = false;
 	for (size_t i = loot_table.size(); i > 0; i--) {
 		ec = &loot_table[i-1];
 		if (ec->z == 0) {
-			Point src;
-			if (pos) {
-				src = FPointToPoint(*pos);
-			}
-			else {
-				src.x = ec->x;
-				src.y = ec->y;
-			}
-			p.x = static_cast<float>(src.x) + 0.5f;
-			p.y = static_cast<float>(src.y) + 0.5f;
-
-			if (!mapr->collider.is_valid_position(p.x, p.y, MOVEMENT_NORMAL, false)) {
-				p = mapr->collider.get_random_neighbor(src, drop_radius);
-
-				if (!mapr->collider.is_valid_position(p.x, p.y, MOVEMENT_NORMAL, false)) {
-					p = hero->pos;
-				}
-				else {
-					if (src.x == static_cast<int>(p.x) && src.y == static_cast<int>(p.y))
-						p = hero->pos;
-
-					mapr->collider.block(p.x, p.y, false);
-					tiles_to_unblock.push_back(FPointToPoint(p));
-				}
-			}
-
-			new_loot.quantity = randBetween(ec->a,ec->b);
-
-			// an item id of 0 means we should drop currency instead
-			if (ec->c == 0 || ec->c == CURRENCY_ID) {
-				new_loot.item = CURRENCY_ID;
-				new_loot.quantity = new_loot.quantity * (100 + hero->get(STAT_CURRENCY_FIND)) / 100;
-			}
-			else {
-				new_loot.item = ec->c;
-			}
-
-			if (itemstack_vec)
-				itemstack_vec->push_back(new_loot);
-			else
-				addLoot(new_loot, p);
-
-			loot_table.erase(loot_table.begin()+i-1);
+			dropLootEntry(ec, pos, itemstack_vec);
+			has_fixed = true;
 		}
 	}
+	if (has_fixed)
+		loot_table.erase(std::remove_if(loot_table.begin(), loot_table.end(), isFixedLoot), loot_table.end());
 
 	// now pick up to 1 random item to drop
-	int threshold = hero->get(STAT_ITEM_FIND) + 100;
+	const int item_find = hero->get(STAT_ITEM_FIND) + 100;
+	int threshold = item_find;
+	possible_ids.clear();
+
 	for (unsigned i = 0; i < loot_table.size(); i++) {
 		ec = &loot_table[i];
 
 		int real_chance = ec->z;
 
 		if (ec->c != 0 && ec->c != CURRENCY_ID) {
-			real_chance = static_cast<int>(static_cast<float>(ec->z) * static_cast<float>(hero->get(STAT_ITEM_FIND) + 100) / 100.f);
+			real_chance = static_cast<int>(static_cast<float>(ec->z) * static_cast<float>(item_find) / 100.f);
 		}
 
 		if (real_chance >= chance) {
@@ -361,51 +456,9 @@ void LootManager::checkLoot(std::vector<Event_Component> &loot_table, FPoint *po
 
 	if (!possible_ids.empty()) {
 		// if there was more than one item with the same chance, randomly pick one of them
-		size_t chosen_loot = static_cast<size_t>(rand()) % possible_ids.size();
-
-		ec = possible_ids[chosen_loot];
+		size_t chosen_loot = randIndex(possible_ids.size(), RANDOM_LOOT);
 
-		Point src;
-		if (pos) {
-			src = FPointToPoint(*pos);
-		}
-		else {
-			src.x = ec->x;
-			src.y = ec->y;
-		}
-		p.x = static_cast<float>(src.x) + 0.5f;
-		p.y = static_cast<float>(src.y) + 0.5f;
-
-		if (!mapr->collider.is_valid_position(p.x, p.y, MOVEMENT_NORMAL, false)) {
-			p = mapr->collider.get_random_neighbor(src, drop_radius);
-
-			if (!mapr->collider.is_valid_position(p.x, p.y, MOVEMENT_NORMAL, false)) {
-				p = hero->pos;
-			}
-			else {
-				if (src.x == static_cast<int>(p.x) && src.y == static_cast<int>(p.y))
-					p = hero->pos;
-
-				mapr->collider.block(p.x, p.y, false);
-				tiles_to_unblock.push_back(FPointToPoint(p));
-			}
-		}
-
-		new_loot.quantity = randBetween(ec->a,ec->b);
-
-		// an item id of 0 means we should drop currency instead
-		if (ec->c == 0 || ec->c == CURRENCY_ID) {
-			new_loot.item = CURRENCY_ID;
-			new_loot.quantity = new_loot.quantity * (100 + hero->get(STAT_CURRENCY_FIND)) / 100;
-		}
-		else {
-			new_loot.item = ec->c;
-		}
-
-		if (itemstack_vec)
-			itemstack_vec->push_back(new_loot);
-		else
-			addLoot(new_loot, p);
+		dropLootEntry(possible_ids[chosen_loot], pos, itemstack_vec);
 	}
 }
 
@@ -441,6 +494,7 @@ void LootManager::addLoot(ItemStack stack, const FPoint& pos, bool dropped_by_he
 	}
 
 	loot.push_back(ld);
+	loot_grid.add(static_cast<unsigned>(loot.size()-1), ld.pos);
 	snd->play(sfx_loot, GLOBAL_VIRTUAL_CHANNEL, pos, false);
 }
 
@@ -457,13 +511,18 @@ ItemStack LootManager::checkPickup(const Point& mouse, const FPoint& cam, const
 		// I'm starting at the end of the loot list so that more recently-dropped
 		// loot is picked up first.  If a player drops several loot in the same
 		// location, picking it back up will work like a stack.
-		std::vector<Loot>::iterator it;
-		for (it = loot.end(); it != loot.begin(); ) {
-			--it;
+		updateGrid();
+		loot_grid.query(hero_pos, INTERACT_RANGE, loot_candidates);
+
+		ScreenTransform view;
+		view.setCamera(cam);
+
+		for (size_t i = 0; i < loot_candidates.size(); ++i) {
+			Loot *it = &loot[loot_candidates[i]];
 
 			// loot close enough to pickup?
 			if (fabs(hero_pos.x - it->pos.x) < INTERACT_RANGE && fabs(hero_pos.y - it->pos.y) < INTERACT_RANGE && !it->isFlying()) {
-				Point p = map_to_screen(it->pos.x, it->pos.y, cam.x, cam.y);
+				Point p = view.mapToScreen(it->pos.x, it->pos.y);
 
 				r.x = p.x - TILE_W_HALF;
 				r.y = p.y - TILE_H_HALF;
@@ -476,9 +535,7 @@ ItemStack LootManager::checkPickup(const Point& mouse, const FPoint& cam, const
 					if (inpt->pressing[MAIN1] && !inpt->lock[MAIN1]) {
 						inpt->lock[MAIN1] = true;
 						if (!it->stack.empty()) {
-							loot_stack = it->stack;
-							it = loot.erase(it);
-							return loot_stack;
+							return removeLoot(loot_candidates[i]);
 						}
 					}
 				}
@@ -504,14 +561,17 @@ ItemStack LootManager::checkPickup(const Point& mouse, const FPoint& cam, const
 ItemStack LootManager::checkAutoPickup(const FPoint& hero_pos) {
 	ItemStack loot_stack;
 
-	std::vector<Loot>::iterator it;
-	for (it = loot.end(); it != loot.begin(); ) {
-		--it;
-		if (!it->dropped_by_hero && fabs(hero_pos.x - it->pos.x) < autopickup_range && fabs(hero_pos.y - it->pos.y) < autopickup_range && !it->isFlying()) {
-			if (it->stack.item == CURRENCY_ID && AUTOPICKUP_CURRENCY) {
-				loot_stack = it->stack;
-				it = loot.erase(it);
-				return loot_stack;
+	if (!AUTOPICKUP_CURRENCY || loot.empty())
+		return loot_stack;
+
+	updateGrid();
+	loot_grid.query(hero_pos, autopickup_range, loot_candidates);
+
+	for (size_t i = 0; i < loot_candidates.size(); ++i) {
+		Loot& ld = loot[loot_candidates[i]];
+		if (!ld.dropped_by_hero && fabs(hero_pos.x - ld.pos.x) < autopickup_range && fabs(hero_pos.y - ld.pos.y) < autopickup_range && !ld.isFlying()) {
+			if (ld.stack.item == CURRENCY_ID) {
+				return removeLoot(loot_candidates[i]);
 			}
 		}
 	}
@@ -523,37 +583,44 @@ ItemStack LootManager::checkNearestPickup(const FPoint& hero_pos) {
 
 	float best_distance = std::numeric_limits<float>::max();
 
-	std::vector<Loot>::iterator it;
-	std::vector<Loot>::iterator nearest = loot.end();
+	updateGrid();
+	loot_grid.query(hero_pos, INTERACT_RANGE, loot_candidates);
 
-	for (it = loot.end(); it != loot.begin(); ) {
-		--it;
+	size_t nearest = loot.size();
 
-		float distance = calcDist(hero_pos, it->pos);
+	for (size_t i = 0; i < loot_candidates.size(); ++i) {
+		float distance = calcDist(hero_pos, loot[loot_candidates[i]].pos);
 		if (distance < INTERACT_RANGE && distance < best_distance) {
 			best_distance = distance;
-			nearest = it;
+			nearest = loot_candidates[i];
 		}
 	}
 
-	if (nearest != loot.end() && !nearest->stack.empty()) {
-		loot_stack = nearest->stack;
-		loot.erase(nearest);
-		return loot_stack;
+	if (nearest != loot.size() && !loot[nearest].stack.empty()) {
+		return removeLoot(static_cast<unsigned>(nearest));
 	}
 
 	return loot_stack;
 }
 
 void LootManager::addRenders(std::vector<Renderable> &ren, std::vector<Renderable> &ren_dead) {
-	std::vector<Loot>::iterator it;
-	for (it = loot.begin(); it != loot.end(); ++it) {
+	if (loot.empty())
+		return;
+
+	queryView(mapr->cam, loot_candidates);
+
+	for (size_t i = loot_candidates.size(); i > 0; --i) {
+		const Loot *it = &loot[loot_candidates[i-1]];
 		if (it->animation) {
-			Renderable r = it->animation->getCurrentFrame(0);
+			std::vector<Renderable> &dest = it->animation->isLastFrame() ? ren_dead : ren;
+			dest.push_back(Renderable());
+			Renderable &r = dest.back();
+			it->animation->getCurrentFrame(0, r);
 			r.map_pos.x = it->pos.x;
 			r.map_pos.y = it->pos.y;
 
-			(it->animation->isLastFrame() ? ren_dead : ren).push_back(r);
+			if (!mapr->isOnScreen(r))
+				dest.pop_back();
 		}
 	}
 }
@@ -563,15 +630,15 @@ void LootManager::parseLoot(std::string &val, Event_Component *e, std::vector<Ev
 
 	std::string chance;
 	bool first_is_filename = false;
-	e->s = popFirstString(val);
+	e->setString(popFirstString(val));
 
-	if (e->s == "currency")
+	if (e->getString() == "currency")
 		e->c = CURRENCY_ID;
-	else if (toInt(e->s, -1) != -1)
-		e->c = toInt(e->s);
+	else if (toInt(e->getString(), -1) != -1)
+		e->c = toInt(e->getString());
 	else if (ec_list) {
 		// load entire loot table
-		std::string filename = e->s;
+		std::string filename = e->getString();
 
 		// remove the last event component, since getLootTable() will create a new one
 		if (e == &ec_list->back())
@@ -603,11 +670,11 @@ void LootManager::parseLoot(std::string &val, Event_Component *e, std::vector<Ev
 			Event_Component *ec = &ec_list->back();
 			ec->type = EC_LOOT;
 
-			ec->s = repeat_val;
-			if (ec->s == "currency")
+			ec->setString(repeat_val);
+			if (ec->getString() == "currency")
 				ec->c = CURRENCY_ID;
-			else if (toInt(ec->s, -1) != -1)
-				ec->c = toInt(ec->s);
+			else if (toInt(ec->getString(), -1) != -1)
+				ec->c = toInt(ec->getString());
 			else {
 				// remove the last event component, since getLootTable() will create a new one
 				ec_list->pop_back();
@@ -662,12 +729,12 @@ void LootManager::loadLootTables() {
 					continue;
 
 				if (infile.key == "id") {
-					ec->s = infile.val;
+					ec->setString(infile.val);
 
-					if (ec->s == "currency")
+					if (ec->getString() == "currency")
 						ec->c = CURRENCY_ID;
-					else if (toInt(ec->s, -1) != -1)
-						ec->c = toInt(ec->s);
+					else if (toInt(ec->getString(), -1) != -1)
+						ec->c = toInt(ec->getString());
 					else {
 						skip_to_next = true;
 						infile.error("LootManager: Invalid item id for loot.");
@@ -694,15 +761,9 @@ void LootManager::getLootTable(const std::string &filename, std::vector<Event_Co
 	if (!ec_list)
 		return;
 
-	std::map<std::string, std::vector<Event_Component> >::iterator it;
-	for (it = loot_tables.begin(); it != loot_tables.end(); ++it) {
-		if (it->first == filename) {
-			std::vector<Event_Component> *loot_defs = &it->second;
-			for (unsigned i=0; i<loot_defs->size(); ++i) {
-				ec_list->push_back((*loot_defs)[i]);
-			}
-			break;
-		}
+	std::map<std::string, std::vector<Event_Component> >::iterator it = loot_tables.find(filename);
+	if (it != loot_tables.end()) {
+		ec_list->insert(ec_list->end(), it->second.begin(), it->second.end());
 	}
 }
 
@@ -31,6 +31,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "FileParser.h"
 #include "ItemManager.h"
 #include "Loot.h"
+#include "LootGrid.h"
 #include "Settings.h"
 
 class Animation;
@@ -57,6 +58,11 @@ private:
 	void loadLootTables();
 	void getLootTable(const std::string &filename, std::vector<Event_Component> *ec_list);
 
+	void dropLootEntry(const Event_Component *ec, const FPoint *pos, std::vector<ItemStack> *itemstack_vec);
+
+	void queryView(const FPoint& cam, std::vector<unsigned>& result);
+	ItemStack removeLoot(unsigned index);
+
 	SoundManager::SoundID sfx_loot;
 
 	int drop_max;
@@ -65,13 +71,22 @@ private:
 
 	// loot refers to ItemManager indices
 	std::vector<Loot> loot;
+	LootGrid loot_grid;
+	std::vector<unsigned> loot_candidates;
+
+	// loot that had its tooltip shown in the last renderTooltips()
+	std::vector<unsigned> tip_candidates;
 
 	// enemies which should drop loot, but didnt yet.
 	std::vector<class Enemy*> enemiesDroppingLoot;
+	std::vector<Event_Component> enemy_loot_table;
 
 	// loot tables defined in files under "loot/"
 	std::map<std::string, std::vector<Event_Component> > loot_tables;
 
+	// reused by checkLoot(), which runs for every drop
+	std::vector<Event_Component*> possible_ids;
+
 	// to prevent dropping multiple loot stacks on the same tile,
 	// we block tiles that have loot dropped on them
 	std::vector<Point> tiles_to_unblock;
@@ -85,6 +100,10 @@ public:
 	void logic();
 	void renderTooltips(const FPoint& cam);
 
+	// the grid is rebuilt before a query if loot was removed since the last one
+	// Called before addRenders() runs on a worker, so that renderTooltips() doesn't rebuild it at the same time.
+	void updateGrid();
+
 	// called by enemy, who definitly wants to drop loot.
 	void addEnemyLoot(Enemy *e);
 	void addLoot(ItemStack stack, const FPoint& pos, bool dropped_by_hero = false);
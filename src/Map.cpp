@@ -22,18 +22,156 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Map.h"
 
 #include "FileParser.h"
+#include "SharedResources.h"
 #include "UtilsParsing.h"
 #include "Settings.h"
 
+#include <climits>
+#include <cstring>
+
+/**
+ * Little-endian reader over a compiled map held in memory
+ * Reading past the end of the data clears ok instead of failing immediately.
+ */
+class CompiledMapReader {
+public:
+	CompiledMapReader(const std::vector<char>& _data)
+		: data(_data)
+		, pos(0)
+		, ok(true) {
+	}
+
+	uint32_t getUnsigned() {
+		if (pos + 4 > data.size()) {
+			ok = false;
+			return 0;
+		}
+		uint32_t value = 0;
+		for (int i = 3; i >= 0; --i)
+			value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+		pos += 4;
+		return value;
+	}
+
+	int getInt() {
+		return static_cast<int>(getUnsigned());
+	}
+
+	float getFloat() {
+		uint32_t bits = getUnsigned();
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	bool getBool() {
+		return getUnsigned() != 0;
+	}
+
+	Rect getRect() {
+		Rect r;
+		r.x = getInt();
+		r.y = getInt();
+		r.w = getInt();
+		r.h = getInt();
+		return r;
+	}
+
+	std::string getString() {
+		size_t length = getUnsigned();
+		if (!ok || pos + length > data.size()) {
+			ok = false;
+			return "";
+		}
+		std::string value(&data[0] + pos, length);
+		pos += length;
+		return value;
+	}
+
+	void getStringList(std::vector<std::string>& list) {
+		size_t count = getUnsigned();
+		for (size_t i = 0; i < count && ok; ++i)
+			list.push_back(getString());
+	}
+
+	void getLayer(Map_Layer& layer, int w, int h) {
+		const size_t length = static_cast<size_t>(w * h) * 2;
+		if (pos + length > data.size()) {
+			ok = false;
+			return;
+		}
+		layer.resize(w, h);
+		const unsigned char *src = reinterpret_cast<const unsigned char*>(&data[0] + pos);
+		for (Map_Layer::iterator it = layer.begin(); it != layer.end(); ++it, src += 2)
+			*it = static_cast<unsigned short>(src[0] | (src[1] << 8));
+		pos += length;
+	}
+
+	const std::vector<char>& data;
+	size_t pos;
+	bool ok;
+};
+
+static void putUnsigned(std::ofstream& outfile, uint32_t value) {
+	char bytes[4];
+	for (int i = 0; i < 4; ++i)
+		bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+	outfile.write(bytes, 4);
+}
+
+static void putInt(std::ofstream& outfile, int value) {
+	putUnsigned(outfile, static_cast<uint32_t>(value));
+}
+
+static void putFloat(std::ofstream& outfile, float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	putUnsigned(outfile, bits);
+}
+
+static void putRect(std::ofstream& outfile, const Rect& r) {
+	putInt(outfile, r.x);
+	putInt(outfile, r.y);
+	putInt(outfile, r.w);
+	putInt(outfile, r.h);
+}
+
+static void putString(std::ofstream& outfile, const std::string& value) {
+	putUnsigned(outfile, static_cast<uint32_t>(value.length()));
+	outfile.write(value.c_str(), value.length());
+}
+
+static void putStringList(std::ofstream& outfile, const std::vector<std::string>& list) {
+	putUnsigned(outfile, static_cast<uint32_t>(list.size()));
+	for (size_t i = 0; i < list.size(); ++i)
+		putString(outfile, list[i]);
+}
+
+static void putLayer(std::ofstream& outfile, const Map_Layer& layer) {
+	std::vector<char> bytes;
+	bytes.reserve(static_cast<size_t>(layer.getWidth() * layer.getHeight()) * 2);
+	for (Map_Layer::const_iterator it = layer.begin(); it != layer.end(); ++it) {
+		bytes.push_back(static_cast<char>(*it & 0xFF));
+		bytes.push_back(static_cast<char>((*it >> 8) & 0xFF));
+	}
+	if (!bytes.empty())
+		outfile.write(&bytes[0], bytes.size());
+}
+
+static const char MAP_COMPILED_MAGIC[8] = {'F', 'L', 'A', 'R', 'E', 'M', 'A', 'P'};
+
 Map::Map()
-	: filename("")
+	: layer_format(MAP_LAYER_FORMAT_DEC)
+	, filename("")
 	, collision_layer(-1)
 	, layers()
 	, events()
+	, has_random_events(false)
 	, w(1)
 	, h(1)
 	, hero_pos_enabled(false)
-	, hero_pos() {
+	, hero_pos()
+	, populate_range(0) {
 }
 
 Map::~Map() {
@@ -41,10 +179,25 @@ Map::~Map() {
 }
 
 void Map::clearLayers() {
+	// maps are usually of a similar size, so the tile buffers are kept instead of freed
+	for (size_t i = 0; i < layers.size(); ++i) {
+		spare_layers.resize(spare_layers.size()+1);
+		spare_layers.back().swap(layers[i]);
+	}
+
 	layers.clear();
 	layernames.clear();
 }
 
+Map_Layer& Map::addLayer() {
+	layers.resize(layers.size()+1);
+	if (!spare_layers.empty()) {
+		layers.back().swap(spare_layers.back());
+		spare_layers.pop_back();
+	}
+	return layers.back();
+}
+
 void Map::clearQueues() {
 	enemies = std::queue<Map_Enemy>();
 	npcs = std::queue<Map_NPC>();
@@ -57,15 +210,23 @@ void Map::clearEvents() {
 
 void Map::removeLayer(unsigned index) {
 	layernames.erase(layernames.begin() + index);
-	layers.erase(layers.begin() + index);
-}
 
-int Map::load(const std::string& fname) {
-	FileParser infile;
+	// swap the layer to the end, so that the other layers aren't copied
+	for (size_t i = index; i+1 < layers.size(); ++i) {
+		layers[i].swap(layers[i+1]);
+	}
+	spare_layers.resize(spare_layers.size()+1);
+	spare_layers.back().swap(layers.back());
+	layers.pop_back();
+}
 
+void Map::clearMap() {
 	clearEvents();
 	clearLayers();
 	clearQueues();
+	enemy_groups = std::queue<Map_Group>();
+	layer_text.clear();
+	layer_format = MAP_LAYER_FORMAT_DEC;
 
 	music_filename = "";
 
@@ -75,13 +236,148 @@ int Map::load(const std::string& fname) {
 	hero_pos_enabled = false;
 	hero_pos.x = 0;
 	hero_pos.y = 0;
+	populate_range = 0;
+	has_random_events = false;
+}
 
-	// @CLASS Map|Description of maps/
-	if (!infile.open(fname))
+int Map::load(const std::string& fname) {
+	// a compiled map is only used when it is at least as new as every text file it may have been built from
+	if (!parse(fname, getCompiledFilename(fname)))
 		return 0;
 
+	finishLoad(fname);
+	return 0;
+}
+
+/**
+ * Read the map file into this Map, without creating anything that depends on the rest of the game
+ * This may run on a separate thread, provided compiled_file was looked up beforehand.
+ */
+bool Map::parse(const std::string& fname, const std::string& compiled_file) {
+	clearMap();
+
+	if (!compiled_file.empty()) {
+		if (loadCompiled(compiled_file))
+			return true;
+
+		logError("Map: Compiled map '%s' could not be loaded. Falling back to the text map.", compiled_file.c_str());
+		clearMap();
+	}
+
+	return loadText(fname);
+}
+
+/**
+ * Move the parsed contents of another Map into this one, leaving the other Map empty
+ */
+void Map::takeParsed(Map& other) {
+	layers.swap(other.layers);
+	layernames.swap(other.layernames);
+	events.swap(other.events);
+	std::swap(enemy_groups, other.enemy_groups);
+	std::swap(npcs, other.npcs);
+
+	title = other.title;
+	tileset = other.tileset;
+	music_filename = other.music_filename;
+	background_filename = other.background_filename;
+	collision_layer = other.collision_layer;
+	w = other.w;
+	h = other.h;
+	hero_pos_enabled = other.hero_pos_enabled;
+	hero_pos = other.hero_pos;
+	populate_range = other.populate_range;
+	has_random_events = other.has_random_events;
+
+	other.clearMap();
+}
+
+void Map::copyParsed(const Map& other) {
+	clearMap();
+
+	for (size_t i = 0; i < other.layers.size(); ++i) {
+		Map_Layer& layer = addLayer();
+		layer.resize(other.layers[i].getWidth(), other.layers[i].getHeight());
+		std::copy(other.layers[i].begin(), other.layers[i].end(), layer.begin());
+	}
+	layernames = other.layernames;
+	events = other.events;
+	enemy_groups = other.enemy_groups;
+	npcs = other.npcs;
+
+	title = other.title;
+	tileset = other.tileset;
+	music_filename = other.music_filename;
+	background_filename = other.background_filename;
+	collision_layer = other.collision_layer;
+	w = other.w;
+	h = other.h;
+	hero_pos_enabled = other.hero_pos_enabled;
+	hero_pos = other.hero_pos;
+	populate_range = other.populate_range;
+	has_random_events = other.has_random_events;
+}
+
+/**
+ * A rough size of what copyParsed() copies, for MapCache
+ */
+size_t Map::getParsedBytes() const {
+	size_t bytes = sizeof(Map);
+	for (size_t i = 0; i < layers.size(); ++i) {
+		bytes += layers[i].getByteSize();
+	}
+	bytes += events.capacity() * sizeof(Event);
+	for (size_t i = 0; i < events.size(); ++i) {
+		bytes += events[i].components.capacity() * sizeof(Event_Component);
+	}
+	bytes += enemy_groups.size() * sizeof(Map_Group);
+	bytes += npcs.size() * sizeof(Map_NPC);
+	return bytes;
+}
+
+/**
+ * The part of loading that follows parse() and has to happen on the main thread
+ */
+void Map::finishLoad(const std::string& fname) {
+	statblocks.clear();
 	this->filename = fname;
 
+	// StatBlocks are large, so avoid copying them when the vector grows
+	size_t power_events = 0;
+	for (unsigned i=0; i<events.size(); ++i) {
+		if (events[i].getComponent(EC_POWER))
+			power_events++;
+	}
+	statblocks.reserve(power_events);
+
+	// create StatBlocks for events that need powers
+	for (unsigned i=0; i<events.size(); ++i) {
+		Event_Component *ec_power = events[i].getComponent(EC_POWER);
+		if (ec_power) {
+			// store the index of this StatBlock so that we can find it when the event is activated
+			ec_power->y = addEventStatBlock(events[i]);
+		}
+	}
+
+	// ensure that our map contains a collision layer
+	if (std::find(layernames.begin(), layernames.end(), "collision") == layernames.end()) {
+		layernames.push_back("collision");
+		addLayer().resize(w, h, 0);
+		collision_layer = static_cast<int>(layers.size())-1;
+	}
+
+	if (!hero_pos_enabled) {
+		logError("Map: Hero spawn position (hero_pos) not defined in map header. Defaulting to (0,0).");
+	}
+}
+
+bool Map::loadText(const std::string& fname) {
+	FileParser infile;
+
+	// @CLASS Map|Description of maps/
+	if (!infile.open(fname))
+		return false;
+
 	while (infile.next()) {
 		if (infile.new_section) {
 
@@ -102,37 +398,319 @@ int Map::load(const std::string& fname) {
 			loadEnemyGroup(infile, &enemy_groups.back());
 		else if (infile.section == "npc")
 			loadNPC(infile);
-		else if (infile.section == "event")
+		else if (infile.section == "event") {
+			if (infile.key == "intermap_random")
+				has_random_events = true;
 			EventManager::loadEvent(infile, &events.back());
+		}
 	}
 
 	infile.close();
 
-	// create StatBlocks for events that need powers
-	for (unsigned i=0; i<events.size(); ++i) {
-		Event_Component *ec_power = events[i].getComponent(EC_POWER);
-		if (ec_power) {
-			// store the index of this StatBlock so that we can find it when the event is activated
-			ec_power->y = addEventStatBlock(events[i]);
+	decodeLayers();
+
+	return true;
+}
+
+/**
+ * Returns the compiled version of a map file, or an empty string if there is none that can be used
+ */
+std::string Map::getCompiledFilename(const std::string& fname) {
+	return mods->locateCompiled(fname, MAP_COMPILED_EXTENSION);
+}
+
+/**
+ * Load a map written by saveCompiled()
+ * The whole file is read at once, and layers are copied straight out of the buffer.
+ */
+bool Map::loadCompiled(const std::string& fname) {
+	ModFileStream infile;
+	infile.open(fname, std::ios::in | std::ios::binary);
+	if (!infile.is_open())
+		return false;
+
+	infile.seekg(0, std::ios::end);
+	const std::streamoff file_size = infile.tellg();
+	infile.seekg(0, std::ios::beg);
+	if (file_size < static_cast<std::streamoff>(sizeof(MAP_COMPILED_MAGIC)))
+		return false;
+
+	std::vector<char> data(static_cast<size_t>(file_size));
+	infile.read(&data[0], file_size);
+	if (!infile.good())
+		return false;
+	infile.close();
+
+	if (memcmp(&data[0], MAP_COMPILED_MAGIC, sizeof(MAP_COMPILED_MAGIC)) != 0)
+		return false;
+
+	CompiledMapReader reader(data);
+	reader.pos = sizeof(MAP_COMPILED_MAGIC);
+
+	if (reader.getUnsigned() != MAP_COMPILED_VERSION)
+		return false;
+
+	// translated strings are stored, so the map has to be compiled for the current language
+	if (reader.getString() != LANGUAGE)
+		return false;
+
+	// header
+	title = reader.getString();
+	w = static_cast<unsigned short>(std::max(reader.getInt(), 1));
+	h = static_cast<unsigned short>(std::max(reader.getInt(), 1));
+	tileset = reader.getString();
+	music_filename = reader.getString();
+	background_filename = reader.getString();
+	hero_pos_enabled = reader.getBool();
+	hero_pos.x = reader.getFloat();
+	hero_pos.y = reader.getFloat();
+	populate_range = reader.getInt();
+
+	// layers
+	const size_t layer_count = reader.getUnsigned();
+	for (size_t i = 0; i < layer_count && reader.ok; ++i) {
+		layernames.push_back(reader.getString());
+		if (layernames.back() == "collision")
+			collision_layer = static_cast<int>(layernames.size())-1;
+
+		reader.getLayer(addLayer(), w, h);
+	}
+
+	// enemy groups
+	const size_t group_count = reader.getUnsigned();
+	for (size_t i = 0; i < group_count && reader.ok; ++i) {
+		enemy_groups.push(Map_Group());
+		Map_Group &group = enemy_groups.back();
+
+		group.type = reader.getString();
+		group.category = reader.getString();
+		group.pos.x = reader.getInt();
+		group.pos.y = reader.getInt();
+		group.area.x = reader.getInt();
+		group.area.y = reader.getInt();
+		group.levelmin = reader.getInt();
+		group.levelmax = reader.getInt();
+		group.numbermin = reader.getInt();
+		group.numbermax = reader.getInt();
+		group.chance = reader.getFloat();
+		group.direction = reader.getInt();
+
+		const size_t waypoint_count = reader.getUnsigned();
+		for (size_t j = 0; j < waypoint_count && reader.ok; ++j) {
+			FPoint wp;
+			wp.x = reader.getFloat();
+			wp.y = reader.getFloat();
+			group.waypoints.push(wp);
 		}
+
+		group.wander_radius = reader.getInt();
+		reader.getStringList(group.requires_status);
+		reader.getStringList(group.requires_not_status);
 	}
 
-	// ensure that our map contains a collision layer
-	if (std::find(layernames.begin(), layernames.end(), "collision") == layernames.end()) {
-		layernames.push_back("collision");
-		layers.resize(layers.size()+1);
-		layers.back().resize(w);
-		for (size_t i=0; i<layers.back().size(); ++i) {
-			layers.back()[i].resize(h, 0);
+	// npcs
+	const size_t npc_count = reader.getUnsigned();
+	for (size_t i = 0; i < npc_count && reader.ok; ++i) {
+		npcs.push(Map_NPC());
+		Map_NPC &npc = npcs.back();
+
+		npc.type = reader.getString();
+		npc.id = reader.getString();
+		npc.pos.x = reader.getFloat();
+		npc.pos.y = reader.getFloat();
+		reader.getStringList(npc.requires_status);
+		reader.getStringList(npc.requires_not_status);
+	}
+
+	// events
+	const size_t event_count = reader.getUnsigned();
+	for (size_t i = 0; i < event_count && reader.ok; ++i) {
+		events.push_back(Event());
+		Event &evnt = events.back();
+
+		evnt.type = reader.getString();
+		evnt.activate_type = reader.getInt();
+		evnt.location = reader.getRect();
+		evnt.hotspot = reader.getRect();
+		evnt.cooldown = reader.getInt();
+		evnt.keep_after_trigger = reader.getBool();
+		evnt.center.x = reader.getFloat();
+		evnt.center.y = reader.getFloat();
+		evnt.reachable_from = reader.getRect();
+
+		const size_t component_count = reader.getUnsigned();
+		evnt.components.resize(component_count);
+		for (size_t j = 0; j < component_count && reader.ok; ++j) {
+			Event_Component &ec = evnt.components[j];
+			ec.type = static_cast<EVENT_COMPONENT_TYPE>(reader.getInt());
+			ec.setString(reader.getString());
+			ec.x = reader.getInt();
+			ec.y = reader.getInt();
+			ec.z = reader.getInt();
+			ec.a = reader.getInt();
+			ec.b = reader.getInt();
+			ec.c = reader.getInt();
 		}
-		collision_layer = static_cast<int>(layers.size())-1;
 	}
 
-	if (!hero_pos_enabled) {
-		logError("Map: Hero spawn position (hero_pos) not defined in map header. Defaulting to (0,0).");
+	return reader.ok && reader.pos == data.size();
+}
+
+/**
+ * Write the currently loaded map in the compiled format
+ * This must be called before load() adds anything of its own, e.g. before the event StatBlocks are created.
+ */
+bool Map::saveCompiled(const std::string& fname) {
+	std::ofstream outfile(fname.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!outfile.is_open()) {
+		logError("Map: Could not write compiled map '%s'.", fname.c_str());
+		return false;
 	}
 
-	return 0;
+	outfile.write(MAP_COMPILED_MAGIC, sizeof(MAP_COMPILED_MAGIC));
+	putUnsigned(outfile, MAP_COMPILED_VERSION);
+	putString(outfile, LANGUAGE);
+
+	// header
+	putString(outfile, title);
+	putInt(outfile, w);
+	putInt(outfile, h);
+	putString(outfile, tileset);
+	putString(outfile, music_filename);
+	putString(outfile, background_filename);
+	putUnsigned(outfile, hero_pos_enabled);
+	putFloat(outfile, hero_pos.x);
+	putFloat(outfile, hero_pos.y);
+	putInt(outfile, populate_range);
+
+	// layers
+	putUnsigned(outfile, static_cast<uint32_t>(layers.size()));
+	for (size_t i = 0; i < layers.size(); ++i) {
+		putString(outfile, layernames[i]);
+		putLayer(outfile, layers[i]);
+	}
+
+	// enemy groups
+	std::queue<Map_Group> groups = enemy_groups;
+	putUnsigned(outfile, static_cast<uint32_t>(groups.size()));
+	while (!groups.empty()) {
+		Map_Group &group = groups.front();
+
+		putString(outfile, group.type);
+		putString(outfile, group.category);
+		putInt(outfile, group.pos.x);
+		putInt(outfile, group.pos.y);
+		putInt(outfile, group.area.x);
+		putInt(outfile, group.area.y);
+		putInt(outfile, group.levelmin);
+		putInt(outfile, group.levelmax);
+		putInt(outfile, group.numbermin);
+		putInt(outfile, group.numbermax);
+		putFloat(outfile, group.chance);
+		putInt(outfile, group.direction);
+
+		putUnsigned(outfile, static_cast<uint32_t>(group.waypoints.size()));
+		while (!group.waypoints.empty()) {
+			putFloat(outfile, group.waypoints.front().x);
+			putFloat(outfile, group.waypoints.front().y);
+			group.waypoints.pop();
+		}
+
+		putInt(outfile, group.wander_radius);
+		putStringList(outfile, group.requires_status);
+		putStringList(outfile, group.requires_not_status);
+
+		groups.pop();
+	}
+
+	// npcs
+	std::queue<Map_NPC> npc_list = npcs;
+	putUnsigned(outfile, static_cast<uint32_t>(npc_list.size()));
+	while (!npc_list.empty()) {
+		const Map_NPC &npc = npc_list.front();
+
+		putString(outfile, npc.type);
+		putString(outfile, npc.id);
+		putFloat(outfile, npc.pos.x);
+		putFloat(outfile, npc.pos.y);
+		putStringList(outfile, npc.requires_status);
+		putStringList(outfile, npc.requires_not_status);
+
+		npc_list.pop();
+	}
+
+	// events
+	putUnsigned(outfile, static_cast<uint32_t>(events.size()));
+	for (size_t i = 0; i < events.size(); ++i) {
+		const Event &evnt = events[i];
+
+		putString(outfile, evnt.type);
+		putInt(outfile, evnt.activate_type);
+		putRect(outfile, evnt.location);
+		putRect(outfile, evnt.hotspot);
+		putInt(outfile, evnt.cooldown);
+		putUnsigned(outfile, evnt.keep_after_trigger);
+		putFloat(outfile, evnt.center.x);
+		putFloat(outfile, evnt.center.y);
+		putRect(outfile, evnt.reachable_from);
+
+		putUnsigned(outfile, static_cast<uint32_t>(evnt.components.size()));
+		for (size_t j = 0; j < evnt.components.size(); ++j) {
+			const Event_Component &ec = evnt.components[j];
+			putInt(outfile, ec.type);
+			putString(outfile, ec.getString());
+			putInt(outfile, ec.x);
+			putInt(outfile, ec.y);
+			putInt(outfile, ec.z);
+			putInt(outfile, ec.a);
+			putInt(outfile, ec.b);
+			putInt(outfile, ec.c);
+		}
+	}
+
+	outfile.close();
+	return !outfile.fail();
+}
+
+/**
+ * Parse a text map and write its compiled version next to it
+ * Maps that pick random destinations while loading can't be compiled, since the choice would be fixed.
+ */
+bool Map::compile(const std::string& fname) {
+	if (hasRandomEvents(fname)) {
+		logInfo("Map: Skipping '%s', it contains random intermap events.", fname.c_str());
+		return false;
+	}
+
+	clearMap();
+	if (!loadText(fname))
+		return false;
+
+	std::vector<std::string> text_files = mods->list(fname);
+	if (text_files.empty())
+		return false;
+
+	return saveCompiled(text_files.back() + MAP_COMPILED_EXTENSION);
+}
+
+/**
+ * Scans a text map for intermap_random events, without parsing it
+ */
+bool Map::hasRandomEvents(const std::string& fname) {
+	FileParser infile;
+	if (!infile.open(fname))
+		return false;
+
+	bool found = false;
+	while (infile.next()) {
+		if (infile.key == "intermap_random") {
+			found = true;
+			break;
+		}
+	}
+	infile.close();
+
+	return found;
 }
 
 void Map::loadHeader(FileParser &infile) {
@@ -166,6 +744,10 @@ void Map::loadHeader(FileParser &infile) {
 		// @ATTR background|filename|Filename of a parallax background definition.
 		background_filename = infile.val;
 	}
+	else if (infile.key == "populate_range") {
+		// @ATTR populate_range|int|Map enemies further than this many tiles from the hero are only created once the hero comes near them. Meant for very large maps. 0 creates all of them after the map is loaded.
+		populate_range = std::max(toInt(infile.val), 0);
+	}
 	else if (infile.key == "tilewidth") {
 		// @ATTR tilewidth|int|Inherited from Tiled map file. Unused by engine.
 	}
@@ -183,19 +765,20 @@ void Map::loadHeader(FileParser &infile) {
 void Map::loadLayer(FileParser &infile) {
 	if (infile.key == "type") {
 		// @ATTR layer.type|string|Map layer type.
-		layers.resize(layers.size()+1);
-		layers.back().resize(w);
-		for (size_t i=0; i<layers.back().size(); ++i) {
-			layers.back()[i].resize(h);
-		}
+		addLayer().resize(w, h);
 		layernames.push_back(infile.val);
 		if (infile.val == "collision")
 			collision_layer = static_cast<int>(layernames.size())-1;
+		layer_format = MAP_LAYER_FORMAT_DEC;
 	}
 	else if (infile.key == "format") {
-		// @ATTR layer.format|string|Format for map layer, must be 'dec'
-		if (infile.val != "dec") {
-			infile.error("Map: The format of a layer must be \"dec\"!");
+		// @ATTR layer.format|["dec", "rle"]|Format for map layer. With 'rle', a run of equal tiles can be written as "count*tile". Defaults to 'dec'.
+		if (infile.val == "dec")
+			layer_format = MAP_LAYER_FORMAT_DEC;
+		else if (infile.val == "rle")
+			layer_format = MAP_LAYER_FORMAT_RLE;
+		else {
+			infile.error("Map: The format of a layer must be \"dec\" or \"rle\"!");
 			mods->resetModConfig();
 			Exit(1);
 		}
@@ -203,27 +786,29 @@ void Map::loadLayer(FileParser &infile) {
 	else if (infile.key == "data") {
 		// @ATTR layer.data|raw|Raw map layer data
 		// layer map data handled as a special case
-		// The next h lines must contain layer data.
+		// The next h lines must contain layer data. They are only checked here, and decoded by decodeLayers().
+		layer_text.push_back(Map_LayerText());
+		Map_LayerText& text = layer_text.back();
+		text.layer = layers.size()-1;
+		text.rle = (layer_format == MAP_LAYER_FORMAT_RLE);
+		text.row_start.resize(h);
+
 		for (int j=0; j<h; j++) {
-			std::string val = infile.getRawLine();
+			const char *line_begin, *line_end;
+			infile.getRawLine(line_begin, line_end);
 			infile.incrementLineNum();
-			if (!val.empty() && val[val.length()-1] != ',') {
-				val += ',';
-			}
+
+			text.row_start[j] = text.data.size();
+			text.data.append(line_begin, line_end);
+			if (line_begin != line_end && *(line_end-1) != ',')
+				text.data += ',';
 
 			// verify the width of this row
-			int comma_count = 0;
-			for (unsigned i=0; i<val.length(); ++i) {
-				if (val[i] == ',') comma_count++;
-			}
-			if (comma_count != w) {
+			if (countLayerRow(text.data.c_str() + text.row_start[j], text.rle) != w) {
 				infile.error("Map: A row of layer data has a width not equal to %d.", w);
 				mods->resetModConfig();
 				Exit(1);
 			}
-
-			for (int i=0; i<w; i++)
-				layers.back()[i][j] = static_cast<unsigned short>(popFirstInt(val));
 		}
 	}
 	else {
@@ -231,6 +816,104 @@ void Map::loadLayer(FileParser &infile) {
 	}
 }
 
+/**
+ * Reads a value of layer data like popFirstInt(), without copying it out of the text.
+ * Leading blanks and a sign are skipped, and text stops at the first character that isn't a digit.
+ */
+static long parseLayerValue(const char *&text) {
+	while (*text == ' ' || *text == '\t')
+		++text;
+
+	bool negative = (*text == '-');
+	if (*text == '-' || *text == '+')
+		++text;
+
+	long value = 0;
+	while (*text >= '0' && *text <= '9') {
+		value = value * 10 + (*text - '0');
+		if (value > INT_MAX) {
+			value = 0;
+			while (*text >= '0' && *text <= '9')
+				++text;
+			break;
+		}
+		++text;
+	}
+
+	return negative ? -value : value;
+}
+
+/**
+ * Reads the run length in front of a "count*tile" value, or 1 for a single tile
+ */
+static long parseLayerRun(const char *&text) {
+	const char *start = text;
+	long count = parseLayerValue(text);
+	while (*text == ' ' || *text == '\t')
+		++text;
+
+	if (*text == '*') {
+		++text;
+		return std::max(count, 0L);
+	}
+
+	text = start;
+	return 1;
+}
+
+/**
+ * The number of tiles in a comma terminated row of layer data
+ */
+long Map::countLayerRow(const char *text, bool rle) {
+	long count = 0;
+	while (*text) {
+		count += rle ? parseLayerRun(text) : 1;
+		while (*text != ',')
+			++text;
+		++text;
+	}
+	return count;
+}
+
+/**
+ * Parses a comma terminated row of layer data, which has already been checked to hold w tiles
+ */
+static void decodeLayerRow(const char *text, unsigned short *row, int w, bool rle) {
+	int i = 0;
+	while (i < w) {
+		long count = rle ? parseLayerRun(text) : 1;
+		unsigned short tile = static_cast<unsigned short>(parseLayerValue(text));
+
+		// anything else before the separator is ignored
+		while (*text != ',')
+			++text;
+		++text;
+
+		for (long k = 0; k < count; ++k)
+			row[i++] = tile;
+	}
+}
+
+/**
+ * Decodes the rows in [begin, end), counting the rows of every layer in layer_text
+ */
+void Map::decodeLayerJob(void *data, size_t begin, size_t end) {
+	Map *map = static_cast<Map*>(data);
+	const size_t rows = map->h;
+
+	for (size_t i = begin; i < end; ++i) {
+		const Map_LayerText& text = map->layer_text[i / rows];
+		const size_t j = i % rows;
+		decodeLayerRow(text.data.c_str() + text.row_start[j], map->layers[text.layer].row(static_cast<int>(j)), map->w, text.rle);
+	}
+}
+
+void Map::decodeLayers() {
+	// large maps have several layers of hundreds of rows, so rows are the unit of work
+	workers->parallelFor(decodeLayerJob, this, layer_text.size() * h, 16);
+	layer_text.clear();
+}
+
 void Map::loadEnemyGroup(FileParser &infile, Map_Group *group) {
 	if (infile.key == "type") {
 		// @ATTR enemygroup.type|string|(IGNORED BY ENGINE) The "type" field, as used by Tiled and other mapping tools.
@@ -343,7 +1026,7 @@ void Map::loadNPC(FileParser &infile) {
 			unsigned tile_x = static_cast<unsigned>(npcs.back().pos.x);
 			unsigned tile_y = static_cast<unsigned>(npcs.back().pos.y);
 			if (tile_x < static_cast<unsigned>(w) && tile_y < static_cast<unsigned>(h)) {
-				short unsigned int& tile = layers[collision_layer][tile_x][tile_y];
+				short unsigned int& tile = layers[collision_layer].at(tile_x, tile_y);
 				if (tile == BLOCKS_NONE) {
 					logError("Map: NPC at (%d, %d) does not have a collision tile. Creating one now.", tile_x, tile_y);
 					tile = BLOCKS_MOVEMENT_HIDDEN;
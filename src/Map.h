@@ -27,9 +27,21 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "EventManager.h"
 #include "FileParser.h"
 #include "MapCollision.h"
+#include "Random.h"
+#include "ResourceCache.h"
 #include "StatBlock.h"
 #include "Utils.h"
 
+// compiled maps are stored next to their text file, with this appended to the filename
+const std::string MAP_COMPILED_EXTENSION = ".bin";
+
+// bumped whenever the layout of compiled maps changes
+const unsigned MAP_COMPILED_VERSION = 2;
+
+// the encodings of layer data in text maps
+const int MAP_LAYER_FORMAT_DEC = 0;
+const int MAP_LAYER_FORMAT_RLE = 1;
+
 class Map_Group {
 public:
 	std::string type;
@@ -99,7 +111,7 @@ public:
 	Map_Enemy(std::string _type="", FPoint _pos=FPoint())
 		: type(_type)
 		, pos(_pos)
-		, direction(rand() % 8)
+		, direction(randInt(8))
 		, waypoints(std::queue<FPoint>())
 		, wander_radius(4)
 		, hero_ally(false)
@@ -111,18 +123,57 @@ public:
 	}
 };
 
+/**
+ * The data of a map layer as it appears in the map file, one row after another.
+ * Every row ends with a comma. Layers in the "rle" format may write a run of
+ * equal tiles as "count*tile", otherwise there is one value per tile.
+ */
+class Map_LayerText {
+public:
+	size_t layer;
+	bool rle;
+	std::string data;
+	std::vector<size_t> row_start;
+
+	Map_LayerText()
+		: layer(0)
+		, rle(false) {
+	}
+};
+
 class Map {
 protected:
+	void clearMap();
+	bool loadText(const std::string& fname);
+	bool loadCompiled(const std::string& fname);
+	bool saveCompiled(const std::string& fname);
+	void finishLoad(const std::string& fname);
+
 	void loadHeader(FileParser &infile);
 	void loadLayer(FileParser &infile);
 	void loadEnemyGroup(FileParser &infile, Map_Group *group);
 	void loadNPC(FileParser &infile);
 
+	// fills the layers from layer_text, using the worker threads
+	void decodeLayers();
+	static void decodeLayerJob(void *data, size_t begin, size_t end);
+	static long countLayerRow(const char *text, bool rle);
+
 	void clearLayers();
 	void clearQueues();
 
+	// takes a layer buffer from the previous map if there is one, to avoid reallocating it
+	Map_Layer& addLayer();
+
 	std::vector<StatBlock> statblocks;
 
+	// the layer buffers of the previous map, kept for reuse by the next one
+	std::vector<Map_Layer> spare_layers;
+
+	// layer data read by loadLayer(), waiting for decodeLayers()
+	std::vector<Map_LayerText> layer_text;
+	int layer_format;
+
 	std::string filename;
 	std::string tileset;
 
@@ -136,6 +187,20 @@ public:
 	void removeLayer(unsigned index);
 
 	int load(const std::string& filename);
+	bool compile(const std::string& filename);
+
+	// true if the text map has intermap_random events, which pick their destination while parsing
+	// Such maps are neither compiled nor parsed by MapPreloader.
+	static bool hasRandomEvents(const std::string& fname);
+
+	// used to split load() so that parsing can happen on another thread, see MapPreloader
+	std::string getCompiledFilename(const std::string& fname);
+	bool parse(const std::string& fname, const std::string& compiled_file);
+	void takeParsed(Map& other);
+
+	// copies what parse() read from another Map, see MapCache
+	void copyParsed(const Map& other);
+	size_t getParsedBytes() const;
 
 	std::string music_filename;
 
@@ -156,6 +221,9 @@ public:
 	// map events
 	std::vector<Event> events;
 
+	// true if an intermap_random event picked its destination while the map was parsed
+	bool has_random_events;
+
 	// vars
 	std::string title;
 	unsigned short w;
@@ -164,6 +232,30 @@ public:
 	FPoint hero_pos;
 	std::string background_filename;
 
+	// map enemies further than this many tiles from the hero wait until the hero comes near; 0 to create them all after loading
+	int populate_range;
+
+};
+
+// the parsed copies of recently left maps are kept until they take up more than this
+const size_t MAP_CACHE_BYTES = 16 * 1024 * 1024;
+
+/**
+ * Maps as parse() left them, before anything changed them at runtime, keyed by filename.
+ * Going back to a recently left map copies it from here instead of parsing the file again.
+ * Everything that changes during play (mapmods, removed events, spawned enemies) is
+ * derived from the campaign statuses again, as with a map loaded from disk.
+ */
+class MapCache : public ResourceCache<std::string, Map*> {
+public:
+	~MapCache() {
+		clear();
+	}
+
+protected:
+	virtual void freeResource(Map* map) {
+		delete map;
+	}
 };
 
 #endif // MAP_H
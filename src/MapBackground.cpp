@@ -25,7 +25,20 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <math.h>
 #include <cassert>
 
-MapBackground::MapBackground() {
+static bool samePositions(const std::vector<Point>& a, const std::vector<Point>& b) {
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i].x != b[i].x || a[i].y != b[i].y)
+			return false;
+	}
+	return true;
+}
+
+MapBackground::MapBackground()
+	: composite(NULL)
+	, composite_valid(false) {
 }
 
 MapBackground::~MapBackground() {
@@ -39,6 +52,83 @@ void MapBackground::clear() {
 
 	sprites.clear();
 	speeds.clear();
+
+	clearCaches();
+}
+
+void MapBackground::clearCaches() {
+	for (size_t i = 0; i < caches.size(); ++i) {
+		delete caches[i];
+	}
+	caches.clear();
+
+	delete composite;
+	composite = NULL;
+	composite_valid = false;
+
+	composite_pos.clear();
+	prev_layer_pos.clear();
+	cache_view = Point();
+}
+
+/**
+ * Builds the caches for the current view size, if they haven't been already
+ */
+void MapBackground::updateCaches() {
+	if (cache_view.x == VIEW_W && cache_view.y == VIEW_H && caches.size() == sprites.size())
+		return;
+
+	clearCaches();
+
+	cache_view.x = VIEW_W;
+	cache_view.y = VIEW_H;
+
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		caches.push_back(sprites[i] ? createLayerCache(sprites[i]) : NULL);
+	}
+
+	if (sprites.size() > 1) {
+		Image *graphics = render_device->createImage(VIEW_W, VIEW_H);
+		if (graphics) {
+			composite = graphics->createSprite();
+			graphics->unref();
+		}
+	}
+}
+
+Sprite* MapBackground::createLayerCache(Sprite* sprite) {
+	const int width = sprite->getGraphicsWidth();
+	const int height = sprite->getGraphicsHeight();
+	if (width <= 0 || height <= 0)
+		return NULL;
+
+	// the layer is drawn starting up to one image left of and above the view
+	const int cols = VIEW_W / width + 2;
+	const int rows = VIEW_H / height + 2;
+
+	if (cols * rows < BACKGROUND_CACHE_MIN_TILES || cols * width > BACKGROUND_CACHE_MAX_SIZE || rows * height > BACKGROUND_CACHE_MAX_SIZE)
+		return NULL;
+
+	Image *graphics = render_device->createImage(cols * width, rows * height);
+	if (!graphics)
+		return NULL;
+
+	Rect src;
+	src.w = width;
+	src.h = height;
+
+	for (int x = 0; x < cols; ++x) {
+		for (int y = 0; y < rows; ++y) {
+			Rect dest;
+			dest.x = x * width;
+			dest.y = y * height;
+			render_device->copyToImage(sprite->getGraphics(), src, graphics, dest);
+		}
+	}
+
+	Sprite *cache = graphics->createSprite();
+	graphics->unref();
+	return cache;
 }
 
 void MapBackground::load(const std::string& filename) {
@@ -81,29 +171,47 @@ void MapBackground::setMapCenter(int x, int y) {
 	map_center.y = static_cast<float>(y) + 0.5f;
 }
 
-void MapBackground::render(const FPoint& cam) {
-	for (size_t i = 0; i < sprites.size(); ++i) {
-		int width = sprites[i]->getGraphicsWidth();
-		int height = sprites[i]->getGraphicsHeight();
+/**
+ * Returns the top-left position of the first image of layer i
+ */
+Point MapBackground::getLayerPos(size_t i, const FPoint& cam) {
+	int width = sprites[i]->getGraphicsWidth();
+	int height = sprites[i]->getGraphicsHeight();
+
+	FPoint dp;
+	dp.x = map_center.x - cam.x;
+	dp.y = map_center.y - cam.y;
 
-		FPoint dp;
-		dp.x = map_center.x - cam.x;
-		dp.y = map_center.y - cam.y;
+	Point center_tile = map_to_screen(map_center.x + (dp.x * speeds[i]), map_center.y + (dp.y * speeds[i]), cam.x, cam.y);
+	center_tile.x -= width/2;
+	center_tile.y -= height/2;
 
-		Point center_tile = map_to_screen(map_center.x + (dp.x * speeds[i]), map_center.y + (dp.y * speeds[i]), cam.x, cam.y);
-		center_tile.x -= width/2;
-		center_tile.y -= height/2;
+	Point draw_pos;
+	draw_pos.x = center_tile.x - static_cast<int>(ceil(static_cast<float>(VIEW_W_HALF + center_tile.x) / static_cast<float>(width))) * width;
+	draw_pos.y = center_tile.y - static_cast<int>(ceil(static_cast<float>(VIEW_H_HALF + center_tile.y) / static_cast<float>(height))) * height;
+	return draw_pos;
+}
 
-		Point draw_pos;
-		draw_pos.x = center_tile.x - static_cast<int>(ceil(static_cast<float>(VIEW_W_HALF + center_tile.x) / static_cast<float>(width))) * width;
-		draw_pos.y = center_tile.y - static_cast<int>(ceil(static_cast<float>(VIEW_H_HALF + center_tile.y) / static_cast<float>(height))) * height;
-		Point start_pos = draw_pos;
+void MapBackground::renderLayers() {
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		if (!sprites[i])
+			continue;
 
+		if (caches[i]) {
+			caches[i]->setDest(layer_pos[i]);
+			render_device->submit(caches[i]);
+			continue;
+		}
+
+		int width = sprites[i]->getGraphicsWidth();
+		int height = sprites[i]->getGraphicsHeight();
+
+		Point draw_pos = layer_pos[i];
 		while (draw_pos.x < VIEW_W) {
-			draw_pos.y = start_pos.y;
+			draw_pos.y = layer_pos[i].y;
 			while (draw_pos.y < VIEW_H) {
 				sprites[i]->setDest(draw_pos.x, draw_pos.y);
-				render_device->render(sprites[i]);
+				render_device->submit(sprites[i]);
 
 				draw_pos.y += height;
 			}
@@ -112,3 +220,43 @@ void MapBackground::render(const FPoint& cam) {
 	}
 }
 
+void MapBackground::render(const FPoint& cam) {
+	if (sprites.empty())
+		return;
+
+	updateCaches();
+
+	layer_pos.resize(sprites.size());
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		if (sprites[i])
+			layer_pos[i] = getLayerPos(i, cam);
+	}
+
+	if (composite) {
+		// once the layers have stopped moving, draw them together once and reuse that until they move again
+		if (!composite_valid || !samePositions(layer_pos, composite_pos)) {
+			composite_valid = false;
+
+			if (samePositions(layer_pos, prev_layer_pos)) {
+				// the background is the first thing drawn on the blank screen, so the layers are blended onto black here too
+				composite->getGraphics()->fillWithColor(Color(0,0,0,255));
+				render_device->setRenderTarget(composite->getGraphics());
+				renderLayers();
+				render_device->setRenderTarget(NULL);
+
+				composite_pos = layer_pos;
+				composite_valid = true;
+			}
+		}
+
+		if (composite_valid) {
+			composite->setDest(0, 0);
+			render_device->submit(composite);
+			return;
+		}
+
+		prev_layer_pos = layer_pos;
+	}
+
+	renderLayers();
+}
@@ -23,6 +23,12 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "RenderDevice.h"
 #include "Utils.h"
 
+// a layer is tiled into a cache image once if filling the view with it takes at least this many draws
+const int BACKGROUND_CACHE_MIN_TILES = 4;
+
+// caches larger than this in either dimension aren't created
+const int BACKGROUND_CACHE_MAX_SIZE = 4096;
+
 class MapBackground {
 public:
 	MapBackground();
@@ -32,10 +38,31 @@ public:
 	void setMapCenter(int x, int y);
 	void render(const FPoint& cam);
 
+	// the caches are built again on the next render()
+	void clearCaches();
+
 private:
+	void updateCaches();
+	Sprite* createLayerCache(Sprite* sprite);
+	Point getLayerPos(size_t i, const FPoint& cam);
+	void renderLayers();
+
 	std::vector<Sprite*> sprites;
 	std::vector<float> speeds;
 	FPoint map_center;
+
+	// for each layer, enough copies of its image to cover the view in one draw. NULL if not needed
+	std::vector<Sprite*> caches;
+	Point cache_view;
+
+	// all layers drawn together, reused while none of them move
+	Sprite* composite;
+	bool composite_valid;
+	std::vector<Point> composite_pos;
+
+	// where each layer is drawn this frame and the previous one
+	std::vector<Point> layer_pos;
+	std::vector<Point> prev_layer_pos;
 };
 
 #endif
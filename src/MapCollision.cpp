@@ -24,68 +24,123 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  * Handle collisions between objects and the map
  */
 
-#include "AStarNode.h"
 #include "MapCollision.h"
+#include "MapFlowField.h"
+#include "MapPathHierarchy.h"
+#include "Random.h"
 #include "Settings.h"
-#include "AStarContainer.h"
+#include "SharedResources.h"
 #include <cfloat>
 #include <math.h>
 #include <cassert>
 #include <cstring>
 
-MapCollision::MapCollision()
-	: map_size(Point())
-{
-	colmap.resize(1);
-	colmap[0].resize(1);
+CollisionLayer::CollisionLayer()
+	: width(0)
+	, row_words(0) {
 }
 
-void MapCollision::setmap(const Map_Layer& _colmap, unsigned short w, unsigned short h) {
-	colmap.resize(w);
-	for (unsigned i=0; i<w; ++i) {
-		colmap[i].resize(h);
-	}
-	for (unsigned i=0; i<w; i++)
-		for (unsigned j=0; j<h; j++)
-			colmap[i][j] = _colmap[i][j];
+void CollisionLayer::resize(int w, int h) {
+	width = w;
+	row_words = (w + 31) / 32;
+
+	const size_t tile_count = static_cast<size_t>(w * h);
+	const size_t word_count = static_cast<size_t>(row_words * h);
 
-	map_size.x = w;
-	map_size.y = h;
+	types.assign((tile_count + 1) / 2, 0);
+	sight_bits.assign(word_count, 0);
+	movement_bits.assign(word_count, 0);
 }
 
-int sgn(float f) {
-	if (f > 0)		return 1;
-	else if (f < 0)	return -1;
-	else			return 0;
+size_t CollisionLayer::getByteSize() const {
+	return types.capacity() + (sight_bits.capacity() + movement_bits.capacity()) * sizeof(uint32_t);
 }
 
-bool MapCollision::small_step(float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero) {
-	if (is_valid_position(x + step_x, y + step_y, movement_type, is_hero)) {
-		x += step_x;
-		y += step_y;
-		assert(is_valid_position(x,y,movement_type, is_hero));
-		return true;
-	}
-	else {
-		return false;
-	}
+void CollisionLayer::set(int x, int y, unsigned short type) {
+	const size_t i = static_cast<size_t>(y * width + x);
+	const int shift = static_cast<int>((i & 1) << 2);
+	types[i >> 1] = static_cast<unsigned char>((types[i >> 1] & ~(0xF << shift)) | ((type & 0xF) << shift));
+
+	setBit(sight_bits, x, y, type == BLOCKS_ALL || type == BLOCKS_ALL_HIDDEN);
+	setBit(movement_bits, x, y, !(type == BLOCKS_NONE || type == MAP_ONLY || type == MAP_ONLY_ALT));
 }
 
-bool MapCollision::small_step_forced_slide_along_grid(float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero) {
-	if (is_valid_position(x + step_x, y, movement_type, is_hero)) { // slide along wall
-		if (step_x == 0) return true;
-		x += step_x;
-		assert(is_valid_position(x,y,movement_type, is_hero));
+void CollisionLayer::setBit(std::vector<uint32_t>& plane, int x, int y, bool value) {
+	const uint32_t mask = static_cast<uint32_t>(1) << (x & 31);
+	uint32_t &word = plane[y * row_words + (x >> 5)];
+	if (value)
+		word |= mask;
+	else
+		word &= ~mask;
+}
+
+MapCollision::MapCollision()
+	: los_cache_generation(1)
+	, path_nodes(0)
+	, map_size(Point())
+{
+	colmap.resize(1, 1);
+	occupancy.resize(1, 1);
+
+	los_cache.resize(LOS_CACHE_SIZE);
+
+	path_hierarchy[MOVEMENT_NORMAL] = new MapPathHierarchy();
+	path_hierarchy[MOVEMENT_FLYING] = new MapPathHierarchy();
+
+	flow_field[MOVEMENT_NORMAL] = new MapFlowField();
+	flow_field[MOVEMENT_FLYING] = new MapFlowField();
+}
+
+void MapCollision::setmap(const Map_Layer& _colmap) {
+	map_size.x = _colmap.getWidth();
+	map_size.y = _colmap.getHeight();
+
+	colmap.resize(map_size.x, map_size.y);
+	for (int j=0; j<map_size.y; j++) {
+		const unsigned short *row = _colmap.row(j);
+		for (int i=0; i<map_size.x; i++)
+			colmap.set(i, j, row[i]);
 	}
-	else if (is_valid_position(x, y + step_y, movement_type, is_hero)) {
-		if (step_y == 0) return true;
-		y += step_y;
-		assert(is_valid_position(x,y,movement_type, is_hero));
+	occupancy.resize(map_size.x, map_size.y);
+
+	clear_line_of_sight_cache();
+	wander_tiles.clear();
+	path_requests.clear();
+
+	if (ENABLE_PATH_HIERARCHY) {
+		path_hierarchy[MOVEMENT_NORMAL]->build(&colmap, map_size, MOVEMENT_NORMAL);
+		path_hierarchy[MOVEMENT_FLYING]->build(&colmap, map_size, MOVEMENT_FLYING);
 	}
-	else {
-		return false;
+
+	flow_field[MOVEMENT_NORMAL]->reset(map_size);
+	flow_field[MOVEMENT_FLYING]->reset(map_size);
+}
+
+/**
+ * Change the static collision type of a tile, e.g. from a mapmod
+ */
+void MapCollision::setStaticTile(int x, int y, unsigned short value) {
+	if (is_outside_map(x, y))
+		return;
+
+	colmap.set(x, y, value);
+
+	clear_line_of_sight_cache();
+	wander_tiles.clear();
+
+	if (ENABLE_PATH_HIERARCHY) {
+		path_hierarchy[MOVEMENT_NORMAL]->updateTile(x, y);
+		path_hierarchy[MOVEMENT_FLYING]->updateTile(x, y);
 	}
-	return true;
+
+	flow_field[MOVEMENT_NORMAL]->invalidate();
+	flow_field[MOVEMENT_FLYING]->invalidate();
+}
+
+int sgn(float f) {
+	if (f > 0)		return 1;
+	else if (f < 0)	return -1;
+	else			return 0;
 }
 
 bool MapCollision::small_step_forced_slide(float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero) {
@@ -136,55 +191,162 @@ bool MapCollision::small_step_forced_slide(float &x, float &y, float step_x, flo
 }
 
 /**
- * Process movement for cardinal (90 degree) and ordinal (45 degree) directions
- * If we encounter an obstacle at 90 degrees, stop.
- * If we encounter an obstacle at 45 or 135 degrees, slide.
+ * Keeps a coordinate inside the given tile, so that int(value) == tile
+ */
+static float clampToTile(float value, int tile) {
+	return std::max(static_cast<float>(tile), std::min(value, static_cast<float>(tile + 1) - MIN_TILE_GAP));
+}
+
+/**
+ * Walks the tiles on the straight line from start to end, checking each tile once (grid DDA).
+ * If a tile isn't valid, end is moved to the last position in front of it and false is returned.
+ * contact_normal then points from the blocking tile back towards start; it is (0,0) if the
+ * start position itself isn't valid, or (+-1,+-1) when the line runs exactly through a blocked corner.
  */
-bool MapCollision::move(float &x, float &y, float _step_x, float _step_y, MOVEMENTTYPE movement_type, bool is_hero) {
-	// when trying to slide against a bottom or right wall, step_x or step_y can become 0
-	// this causes diag to become false, making this function return false
-	// we try to catch such a scenario and return true early
-	bool force_slide = (_step_x != 0 && _step_y != 0);
-
-	while (_step_x != 0 || _step_y != 0) {
-
-		float step_x = 0;
-		if (_step_x > 0) {
-			// find next interesting value, which is either the whole step, or the transition to the next tile
-			step_x = std::min(static_cast<float>(ceil(x)) - x, _step_x);
-			// if we are standing on the edge of a tile (ceil(x) - x == 0), we need to look one tile ahead
-			if (step_x <= MIN_TILE_GAP) step_x = std::min(1.f, _step_x);
+bool MapCollision::sweep(const FPoint& start, FPoint& end, MOVEMENTTYPE movement_type, bool is_hero, bool is_entity, FPoint *contact_normal) const {
+	if (contact_normal) *contact_normal = FPoint();
+
+	if (!is_valid_position(start.x, start.y, movement_type, is_hero, is_entity)) {
+		end = start;
+		return false;
+	}
+
+	const float dx = end.x - start.x;
+	const float dy = end.y - start.y;
+	const int dir_x = sgn(dx);
+	const int dir_y = sgn(dy);
+	int tile_x = int(start.x);
+	int tile_y = int(start.y);
+
+	// distance to the next tile border on each axis, as a fraction of the whole step
+	// moving backwards only leaves a tile once the border has been passed
+	const float delta_x = (dx != 0) ? 1.f / static_cast<float>(fabs(dx)) : FLT_MAX;
+	const float delta_y = (dy != 0) ? 1.f / static_cast<float>(fabs(dy)) : FLT_MAX;
+	float next_x = FLT_MAX;
+	float next_y = FLT_MAX;
+	if (dx > 0) next_x = (static_cast<float>(tile_x + 1) - start.x) * delta_x;
+	else if (dx < 0) next_x = (start.x - static_cast<float>(tile_x)) * delta_x;
+	if (dy > 0) next_y = (static_cast<float>(tile_y + 1) - start.y) * delta_y;
+	else if (dy < 0) next_y = (start.y - static_cast<float>(tile_y)) * delta_y;
+
+	while (true) {
+		bool cross_x = (dx > 0) ? (next_x <= 1) : (next_x < 1);
+		bool cross_y = (dy > 0) ? (next_y <= 1) : (next_y < 1);
+		if (!cross_x && !cross_y) break;
+
+		// only cross both borders at once when passing exactly through a corner
+		if (cross_x && cross_y) {
+			if (next_x < next_y) cross_y = false;
+			else if (next_y < next_x) cross_x = false;
 		}
-		else if (_step_x < 0) {
-			step_x = std::max(static_cast<float>(floor(x)) - x, _step_x);
-			if (step_x == 0) step_x = std::max(-1.f, _step_x);
+
+		const int next_tile_x = cross_x ? tile_x + dir_x : tile_x;
+		const int next_tile_y = cross_y ? tile_y + dir_y : tile_y;
+
+		if (!is_valid_tile(next_tile_x, next_tile_y, movement_type, is_hero, is_entity)) {
+			const float t = cross_x ? next_x : next_y;
+			end.x = start.x + dx * t;
+			end.y = start.y + dy * t;
+			if (contact_normal) {
+				contact_normal->x = cross_x ? static_cast<float>(-dir_x) : 0;
+				contact_normal->y = cross_y ? static_cast<float>(-dir_y) : 0;
+			}
+			if (dx != 0) end.x = clampToTile(end.x, tile_x);
+			if (dy != 0) end.y = clampToTile(end.y, tile_y);
+			return false;
 		}
 
-		float step_y = 0;
-		if (_step_y > 0) {
-			step_y = std::min(static_cast<float>(ceil(y)) - y, _step_y);
-			if (step_y <= MIN_TILE_GAP) step_y = std::min(1.f, _step_y);
+		tile_x = next_tile_x;
+		tile_y = next_tile_y;
+		if (cross_x) next_x += delta_x;
+		if (cross_y) next_y += delta_y;
+	}
+
+	// guard against rounding putting end into a tile that wasn't checked
+	if (dx != 0) end.x = clampToTile(end.x, tile_x);
+	if (dy != 0) end.y = clampToTile(end.y, tile_y);
+	return true;
+}
+
+/**
+ * Process movement for cardinal (90 degree) and ordinal (45 degree) directions
+ * If we encounter an obstacle at 90 degrees, stop (unless we can step around a single obstacle).
+ * If we encounter an obstacle at 45 or 135 degrees, slide.
+ * Each leg of the movement is resolved with a single sweep(), so steps longer than a tile can't pass through walls.
+ */
+bool MapCollision::move(float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero) {
+	const bool force_slide = (step_x != 0 && step_y != 0);
+
+	FPoint pos(x, y);
+	FPoint remaining(step_x, step_y);
+	FPoint normal;
+	bool success = true;
+
+	while (remaining.x != 0 || remaining.y != 0) {
+		const FPoint target(pos.x + remaining.x, pos.y + remaining.y);
+		FPoint contact = target;
+
+		if (sweep(pos, contact, movement_type, is_hero, true, &normal)) {
+			pos = contact;
+			break;
 		}
-		else if (_step_y < 0) {
-			step_y = std::max(static_cast<float>(floor(y)) - y, _step_y);
-			if (step_y == 0) step_y	= std::max(-1.f, _step_y);
+
+		remaining.x = target.x - contact.x;
+		remaining.y = target.y - contact.y;
+		pos = contact;
+
+		if (normal.x == 0 && normal.y == 0) {
+			// we're not in a valid position to begin with
+			success = false;
+			break;
 		}
 
-		_step_x -= step_x;
-		_step_y -= step_y;
+		if (force_slide) {
+			if (normal.x != 0 && normal.y != 0) {
+				// blocked at a corner, slide along whichever side is open
+				if (is_valid_tile(int(pos.x) + sgn(remaining.x), int(pos.y), movement_type, is_hero))
+					normal.x = 0;
+				else if (is_valid_tile(int(pos.x), int(pos.y) + sgn(remaining.y), movement_type, is_hero))
+					normal.y = 0;
+				else {
+					success = false;
+					break;
+				}
+			}
+
+			// slide along the wall by dropping the blocked part of the movement
+			if (normal.x != 0) remaining.x = 0;
+			if (normal.y != 0) remaining.y = 0;
 
-		if (!small_step(x, y, step_x, step_y, movement_type, is_hero)) {
-			if (force_slide) {
-				if (!small_step_forced_slide_along_grid(x, y, step_x, step_y, movement_type, is_hero))
-					return false;
+			if (remaining.x == 0 && remaining.y == 0) {
+				success = false;
+				break;
+			}
+		}
+		else {
+			// moving straight, try to step around the obstacle
+			if (remaining.x != 0) {
+				const float step = (remaining.x > 0) ? std::min(remaining.x, 1.f) : std::max(remaining.x, -1.f);
+				if (!small_step_forced_slide(pos.x, pos.y, step, 0, movement_type, is_hero)) {
+					success = false;
+					break;
+				}
+				remaining.x -= step;
 			}
 			else {
-				if (!small_step_forced_slide(x, y, step_x, step_y, movement_type, is_hero))
-					return false;
+				const float step = (remaining.y > 0) ? std::min(remaining.y, 1.f) : std::max(remaining.y, -1.f);
+				if (!small_step_forced_slide(pos.x, pos.y, 0, step, movement_type, is_hero)) {
+					success = false;
+					break;
+				}
+				remaining.y -= step;
 			}
 		}
 	}
-	return true;
+
+	x = pos.x;
+	y = pos.y;
+	return success;
 }
 
 /**
@@ -209,7 +371,7 @@ bool MapCollision::is_empty(const float& x, const float& y) const {
 	if (is_outside_map(tile_x, tile_y)) return false;
 
 	// collision type check
-	return (colmap[tile_x][tile_y] == BLOCKS_NONE || colmap[tile_x][tile_y] == MAP_ONLY || colmap[tile_x][tile_y] == MAP_ONLY_ALT);
+	return !colmap.blocksMovement(tile_x, tile_y) && !occupancy.hasEntity(tile_x, tile_y);
 }
 
 /**
@@ -223,7 +385,7 @@ bool MapCollision::is_wall(const float& x, const float& y) const {
 	if (is_outside_map(tile_x, tile_y)) return true;
 
 	// collision type check
-	return (colmap[tile_x][tile_y] == BLOCKS_ALL || colmap[tile_x][tile_y] == BLOCKS_ALL_HIDDEN);
+	return colmap.blocksSight(tile_x, tile_y);
 }
 
 /**
@@ -233,29 +395,26 @@ bool MapCollision::is_valid_tile(const int& tile_x, const int& tile_y, MOVEMENTT
 	// outside the map isn't valid
 	if (is_outside_map(tile_x,tile_y)) return false;
 
-	if (is_entity) {
-		if(is_hero) {
-			if(colmap[tile_x][tile_y] == BLOCKS_ENEMIES && !ENABLE_ALLY_COLLISION) return true;
-		}
-		else if(colmap[tile_x][tile_y] == BLOCKS_ENEMIES) return false;
+	const bool has_entity = occupancy.hasEntity(tile_x, tile_y);
+	if (is_entity && has_entity) {
+		if (occupancy.get(tile_x, tile_y) == BLOCKS_ENTITIES)
+			return false;
 
-		// occupied by an entity isn't valid
-		if (colmap[tile_x][tile_y] == BLOCKS_ENTITIES) return false;
+		// BLOCKS_ENEMIES: an ally is standing here
+		if (!is_hero)
+			return false;
+		else if (!ENABLE_ALLY_COLLISION)
+			return true;
 	}
 
 	// intangible creatures can be everywhere
 	if (movement_type == MOVEMENT_INTANGIBLE) return true;
 
 	// flying creatures can't be in walls
-	if (movement_type == MOVEMENT_FLYING) {
-		return (!(colmap[tile_x][tile_y] == BLOCKS_ALL || colmap[tile_x][tile_y] == BLOCKS_ALL_HIDDEN));
-	}
-
-	if (colmap[tile_x][tile_y] == MAP_ONLY || colmap[tile_x][tile_y] == MAP_ONLY_ALT)
-		return true;
+	if (movement_type == MOVEMENT_FLYING) return !colmap.blocksSight(tile_x, tile_y);
 
 	// normal creatures can only be in empty spaces
-	return (colmap[tile_x][tile_y] == BLOCKS_NONE);
+	return !colmap.blocksMovement(tile_x, tile_y) && !has_entity;
 }
 
 /**
@@ -314,8 +473,117 @@ bool MapCollision::line_check(const float& x1, const float& y1, const float& x2,
 	return true;
 }
 
+/**
+ * Sight is only blocked by static walls, so results are cached per pair of tiles
+ * Cached lines are checked between the tile centers
+ */
 bool MapCollision::line_of_sight(const float& x1, const float& y1, const float& x2, const float& y2) {
-	return line_check(x1, y1, x2, y2, CHECK_SIGHT, MOVEMENT_NORMAL);
+	if (is_outside_map(x1, y1) || is_outside_map(x2, y2))
+		return line_check(x1, y1, x2, y2, CHECK_SIGHT, MOVEMENT_NORMAL);
+
+	const int src = int(y1) * map_size.x + int(x1);
+	const int dest = int(y2) * map_size.x + int(x2);
+	const unsigned hash = (static_cast<unsigned>(src) * 2654435761u) ^ static_cast<unsigned>(dest);
+
+	LOSCacheEntry &entry = los_cache[hash & (LOS_CACHE_SIZE - 1)];
+	if (entry.generation == los_cache_generation && entry.src == src && entry.dest == dest)
+		return entry.result;
+
+	FPoint p1 = collision_to_map(Point(int(x1), int(y1)));
+	FPoint p2 = collision_to_map(Point(int(x2), int(y2)));
+
+	entry.src = src;
+	entry.dest = dest;
+	entry.generation = los_cache_generation;
+	entry.result = line_check(p1.x, p1.y, p2.x, p2.y, CHECK_SIGHT, MOVEMENT_NORMAL);
+
+	return entry.result;
+}
+
+/**
+ * Looks up a line of sight without tracing it; returns false if it isn't in the cache
+ * Nothing is written, so several threads can call this while nothing else changes the cache.
+ */
+bool MapCollision::get_cached_line_of_sight(const FPoint& start, const FPoint& end, bool& result) const {
+	if (is_outside_map(start.x, start.y) || is_outside_map(end.x, end.y))
+		return false;
+
+	const int src = int(start.y) * map_size.x + int(start.x);
+	const int dest = int(end.y) * map_size.x + int(end.x);
+	const unsigned hash = (static_cast<unsigned>(src) * 2654435761u) ^ static_cast<unsigned>(dest);
+
+	const LOSCacheEntry &entry = los_cache[hash & (LOS_CACHE_SIZE - 1)];
+	if (entry.generation != los_cache_generation || entry.src != src || entry.dest != dest)
+		return false;
+
+	result = entry.result;
+	return true;
+}
+
+/**
+ * Fill the line of sight cache for many sources looking at the same target
+ * Sources that share a tile are only checked once. The lines are traced in
+ * parallel, since they only read the static collision layer, and the results
+ * are then stored in the cache in order on the calling thread.
+ */
+void MapCollision::cache_line_of_sight(const std::vector<FPoint>& sources, const FPoint& target) {
+	// lines to a target outside the map aren't cached
+	if (is_outside_map(target.x, target.y))
+		return;
+
+	const int dest = int(target.y) * map_size.x + int(target.x);
+	los_target = Point(int(target.x), int(target.y));
+	los_pending.clear();
+
+	for (size_t i = 0; i < sources.size(); ++i) {
+		if (is_outside_map(sources[i].x, sources[i].y))
+			continue;
+
+		const int src = int(sources[i].y) * map_size.x + int(sources[i].x);
+		const unsigned hash = (static_cast<unsigned>(src) * 2654435761u) ^ static_cast<unsigned>(dest);
+
+		LOSCacheEntry &entry = los_cache[hash & (LOS_CACHE_SIZE - 1)];
+		if (entry.generation == los_cache_generation && entry.src == src && entry.dest == dest)
+			continue;
+
+		// claim the entry, so that other sources on this tile are skipped
+		entry.src = src;
+		entry.dest = dest;
+		entry.generation = los_cache_generation;
+		los_pending.push_back(Point(int(sources[i].x), int(sources[i].y)));
+	}
+
+	los_results.resize(los_pending.size());
+	workers->parallelFor(line_of_sight_job, this, los_pending.size(), 8);
+
+	for (size_t i = 0; i < los_pending.size(); ++i) {
+		const int src = los_pending[i].y * map_size.x + los_pending[i].x;
+		const unsigned hash = (static_cast<unsigned>(src) * 2654435761u) ^ static_cast<unsigned>(dest);
+
+		LOSCacheEntry &entry = los_cache[hash & (LOS_CACHE_SIZE - 1)];
+		entry.src = src;
+		entry.dest = dest;
+		entry.generation = los_cache_generation;
+		entry.result = (los_results[i] != 0);
+	}
+}
+
+void MapCollision::line_of_sight_job(void *data, size_t begin, size_t end) {
+	MapCollision *collider = static_cast<MapCollision*>(data);
+	const FPoint p2 = collision_to_map(collider->los_target);
+
+	for (size_t i = begin; i < end; ++i) {
+		const FPoint p1 = collision_to_map(collider->los_pending[i]);
+		collider->los_results[i] = collider->line_check(p1.x, p1.y, p2.x, p2.y, CHECK_SIGHT, MOVEMENT_NORMAL);
+	}
+}
+
+void MapCollision::clear_line_of_sight_cache() {
+	los_cache_generation++;
+	if (los_cache_generation == 0) {
+		los_cache.assign(LOS_CACHE_SIZE, LOSCacheEntry());
+		los_cache_generation = 1;
+	}
 }
 
 bool MapCollision::line_of_movement(const float& x1, const float& y1, const float& x2, const float& y2, MOVEMENTTYPE movement_type) {
@@ -327,16 +595,12 @@ bool MapCollision::line_of_movement(const float& x1, const float& y1, const floa
 	// if the target is blocking, clear it temporarily
 	int tile_x = int(x2);
 	int tile_y = int(y2);
-	bool target_blocks = false;
-	int target_blocks_type = colmap[tile_x][tile_y];
-	if (colmap[tile_x][tile_y] == BLOCKS_ENTITIES || colmap[tile_x][tile_y] == BLOCKS_ENEMIES) {
-		target_blocks = true;
-		unblock(x2,y2);
-	}
+	const unsigned char target_occupant = occupancy.get(tile_x, tile_y);
+	occupancy.set(tile_x, tile_y, BLOCKS_NONE);
 
 	bool has_movement = line_check(x1, y1, x2, y2, CHECK_MOVEMENT, movement_type);
 
-	if (target_blocks) block(x2,y2, target_blocks_type == BLOCKS_ENEMIES);
+	occupancy.set(tile_x, tile_y, target_occupant);
 	return has_movement;
 
 }
@@ -391,24 +655,164 @@ bool MapCollision::compute_path(const FPoint& start_pos, const FPoint& end_pos,
 	Point end = map_to_collision(end_pos);
 
 	// if the target square has an entity, temporarily clear it to compute the path
-	bool target_blocks = false;
-	int target_blocks_type = colmap[end.x][end.y];
-	if (colmap[end.x][end.y] == BLOCKS_ENTITIES || colmap[end.x][end.y] == BLOCKS_ENEMIES) {
-		target_blocks = true;
-		unblock(end_pos.x, end_pos.y);
+	// only the occupancy changes, so the static collision (and the path hierarchy built from it) stays as it is
+	const unsigned char target_occupant = occupancy.get(end.x, end.y);
+	occupancy.set(end.x, end.y, BLOCKS_NONE);
+
+	// long paths are planned on the cluster graph first, then refined one short leg at a time
+	bool use_hierarchy = false;
+	if (ENABLE_PATH_HIERARCHY && movement_type != MOVEMENT_INTANGIBLE && path_hierarchy[movement_type]->isLongRange(start, end)) {
+		use_hierarchy = path_hierarchy[movement_type]->findWaypoints(start, end, path_waypoints);
+	}
+
+	if (use_hierarchy) {
+		path_waypoints.insert(path_waypoints.begin(), start);
+		path_waypoints.push_back(end);
+
+		// the path is stored from end to start, so the last leg is refined first
+		for (size_t i = path_waypoints.size() - 1; i > 0; --i) {
+			const Point &leg_start = path_waypoints[i-1];
+			const Point &leg_end = path_waypoints[i];
+			if (leg_start.x == leg_end.x && leg_start.y == leg_end.y)
+				continue;
+
+			if (!compute_local_path(leg_start, leg_end, path_leg, movement_type, PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE)) {
+				use_hierarchy = false;
+				break;
+			}
+			path.insert(path.end(), path_leg.begin(), path_leg.end());
+		}
+	}
+
+	if (!use_hierarchy) {
+		path.clear();
+		compute_local_path(start, end, path, movement_type, limit);
+	}
+
+	// reblock target if needed
+	occupancy.set(end.x, end.y, target_occupant);
+
+	return !path.empty();
+}
+
+/**
+* Ask for a path to be computed by process_path_requests()
+* A request that is still waiting is updated in place, so it doesn't lose its turn
+*/
+void MapCollision::request_path(const void *owner, const FPoint& start, const FPoint& end, MOVEMENTTYPE movement_type) {
+	PathRequest *req = NULL;
+	for (size_t i = 0; i < path_requests.size(); ++i) {
+		if (path_requests[i].owner == owner) {
+			req = &path_requests[i];
+			break;
+		}
+	}
+
+	if (!req) {
+		path_requests.push_back(PathRequest());
+		req = &path_requests.back();
+		req->owner = owner;
+	}
+
+	req->start = start;
+	req->end = end;
+	req->movement_type = movement_type;
+	req->done = false;
+}
+
+/**
+* Replace path with the result of an earlier request_path()
+* @return false if there is no result yet
+*/
+bool MapCollision::take_path(const void *owner, std::vector<FPoint> &path, bool &found) {
+	for (size_t i = 0; i < path_requests.size(); ++i) {
+		if (path_requests[i].owner != owner)
+			continue;
+		if (!path_requests[i].done)
+			return false;
+
+		path.swap(path_requests[i].path);
+		found = path_requests[i].found;
+		path_requests.erase(path_requests.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+void MapCollision::cancel_path(const void *owner) {
+	for (size_t i = 0; i < path_requests.size(); ++i) {
+		if (path_requests[i].owner == owner) {
+			path_requests.erase(path_requests.begin() + i);
+			return;
+		}
+	}
+}
+
+/**
+* Compute waiting paths until PATH_NODE_BUDGET nodes have been expanded in this frame
+* At least one path is computed per frame, so that no request waits forever
+*/
+void MapCollision::process_path_requests() {
+	const unsigned start_nodes = path_nodes;
+
+	for (size_t i = 0; i < path_requests.size(); ++i) {
+		if (PATH_NODE_BUDGET > 0 && path_nodes - start_nodes >= static_cast<unsigned>(PATH_NODE_BUDGET))
+			break;
+
+		PathRequest &req = path_requests[i];
+		if (req.done)
+			continue;
+
+		req.found = compute_path(req.start, req.end, req.path, req.movement_type);
+		req.done = true;
 	}
+}
+
+/**
+* Get the next step towards the hero from the shared flow field
+* The field is only rebuilt when the hero moves to a different tile, so this is cheap for any number of callers
+* @return false if start is too far from the hero or if the way is blocked; use compute_path() instead
+*/
+bool MapCollision::compute_flow_step(const FPoint& start, const FPoint& hero_pos, FPoint& next, MOVEMENTTYPE movement_type) {
+	if (!ENABLE_FLOW_FIELD || movement_type == MOVEMENT_INTANGIBLE)
+		return false;
+
+	if (is_outside_map(start.x, start.y) || is_outside_map(hero_pos.x, hero_pos.y))
+		return false;
+
+	MapFlowField *field = flow_field[movement_type];
+	field->update(this, map_to_collision(hero_pos), movement_type);
+
+	Point step;
+	if (!field->getNextStep(this, map_to_collision(start), movement_type, step))
+		return false;
+
+	next = collision_to_map(step);
+	return true;
+}
+
+/**
+* Regular A* search between two tiles in MapCollision precision
+* If the end can't be reached, path leads to the closest explored tile
+* @return true if the end was reached
+*/
+bool MapCollision::compute_local_path(const Point& start, const Point& end, std::vector<FPoint> &path, MOVEMENTTYPE movement_type, unsigned int limit) {
+	path.clear();
+
+	astar.reset(map_size.x, map_size.y, limit);
+	AStarContainer &open = astar.open;
+	AStarCloseContainer &close = astar.close;
 
 	Point current = start;
-	AStarNode* node = new AStarNode(start);
+	AStarNode* node = astar.createNode(start);
 	node->setActualCost(0);
 	node->setEstimatedCost(static_cast<float>(calcDist(start,end)));
 	node->setParent(current);
 
-	AStarContainer open(map_size.x, map_size.y, limit);
-	AStarCloseContainer close(map_size.x, map_size.y, limit);
-
 	open.add(node);
 
+	Point neighbours[node_neighbour_max];
+
 	while (!open.isEmpty() && static_cast<unsigned>(close.getSize()) < limit) {
 		node = open.get_shortest_f();
 
@@ -421,11 +825,11 @@ bool MapCollision::compute_path(const FPoint& start_pos, const FPoint& end_pos,
 			break; //path found !
 
 		//limit evaluated nodes to the size of the map
-		std::list<Point> neighbours = node->getNeighbours(map_size.x, map_size.y);
+		int neighbour_count = node->getNeighbours(neighbours, map_size.x, map_size.y);
 
 		// for every neighbour of current node
-		for (std::list<Point>::iterator it=neighbours.begin(); it != neighbours.end(); ++it)	{
-			Point neighbour = *it;
+		for (int j=0; j<neighbour_count; ++j) {
+			Point neighbour = neighbours[j];
 
 			// do not exceed the node limit when adding nodes
 			if (static_cast<unsigned>(open.getSize()) >= limit) {
@@ -441,7 +845,10 @@ bool MapCollision::compute_path(const FPoint& start_pos, const FPoint& end_pos,
 
 			// if neighbour isn't inside open, add it as a new Node
 			if(!open.exists(neighbour)) {
-				AStarNode* newNode = new AStarNode(neighbour);
+				AStarNode* newNode = astar.createNode(neighbour);
+				if (!newNode)
+					break;
+
 				newNode->setActualCost(node->getActualCost() + static_cast<float>(calcDist(current,neighbour)));
 				newNode->setParent(current);
 				newNode->setEstimatedCost(static_cast<float>(calcDist(neighbour,end)));
@@ -459,7 +866,11 @@ bool MapCollision::compute_path(const FPoint& start_pos, const FPoint& end_pos,
 		}
 	}
 
-	if (!(current.x == end.x && current.y == end.y)) {
+	path_nodes += static_cast<unsigned>(close.getSize());
+
+	bool found = (current.x == end.x && current.y == end.y);
+
+	if (!found) {
 
 		//couldnt find the target so map a path to the closest node found
 		node = close.get_shortest_h();
@@ -479,21 +890,19 @@ bool MapCollision::compute_path(const FPoint& start_pos, const FPoint& end_pos,
 			current = close.get(current.x, current.y)->getParent();
 		}
 	}
-	// reblock target if needed
-	if (target_blocks) block(end_pos.x, end_pos.y, target_blocks_type == BLOCKS_ENEMIES);
-
-	return !path.empty();
+	return found;
 }
 
 void MapCollision::block(const float& map_x, const float& map_y, bool is_ally) {
 	const int tile_x = int(map_x);
 	const int tile_y = int(map_y);
 
-	if (colmap[tile_x][tile_y] == BLOCKS_NONE) {
+	// entities only block tiles that are otherwise empty
+	if (colmap.get(tile_x, tile_y) == BLOCKS_NONE && !occupancy.hasEntity(tile_x, tile_y)) {
 		if(is_ally)
-			colmap[tile_x][tile_y] = BLOCKS_ENEMIES;
+			occupancy.set(tile_x, tile_y, BLOCKS_ENEMIES);
 		else
-			colmap[tile_x][tile_y] = BLOCKS_ENTITIES;
+			occupancy.set(tile_x, tile_y, BLOCKS_ENTITIES);
 	}
 
 }
@@ -502,9 +911,7 @@ void MapCollision::unblock(const float& map_x, const float& map_y) {
 	const int tile_x = int(map_x);
 	const int tile_y = int(map_y);
 
-	if (colmap[tile_x][tile_y] == BLOCKS_ENTITIES || colmap[tile_x][tile_y] == BLOCKS_ENEMIES) {
-		colmap[tile_x][tile_y] = BLOCKS_NONE;
-	}
+	occupancy.set(tile_x, tile_y, BLOCKS_NONE);
 
 }
 
@@ -527,11 +934,76 @@ FPoint MapCollision::get_random_neighbor(const Point& target, int range, bool ig
 	}
 
 	if (!valid_tiles.empty())
-		return valid_tiles[rand() % valid_tiles.size()];
+		return valid_tiles[randIndex(valid_tiles.size())];
 	else
 		return target;
 }
 
 MapCollision::~MapCollision() {
+	delete path_hierarchy[MOVEMENT_NORMAL];
+	delete path_hierarchy[MOVEMENT_FLYING];
+	delete flow_field[MOVEMENT_NORMAL];
+	delete flow_field[MOVEMENT_FLYING];
+}
+
+/**
+ * Can a creature with this movement type stand on this tile, not counting other entities?
+ */
+bool MapCollision::is_static_walkable(int tile_x, int tile_y, MOVEMENTTYPE movement_type) const {
+	if (is_outside_map(tile_x, tile_y)) return false;
+	if (movement_type == MOVEMENT_INTANGIBLE) return true;
+	if (movement_type == MOVEMENT_FLYING) return !colmap.blocksSight(tile_x, tile_y);
+	return !colmap.blocksMovement(tile_x, tile_y);
+}
+
+/**
+ * Returns the tiles in a wander area that can be walked to from the center of the area
+ * The list is built once per area with a flood fill, so that picking a wander point never fails.
+ * It is empty if the center itself is blocked. It is rebuilt after the static collision changes.
+ */
+const std::vector<Point>& MapCollision::get_wander_tiles(const Rect& area, MOVEMENTTYPE movement_type) {
+	const WanderAreaKey key(area, movement_type);
+	std::map<WanderAreaKey, std::vector<Point> >::iterator it = wander_tiles.find(key);
+	if (it != wander_tiles.end())
+		return it->second;
+
+	std::vector<Point>& tiles = wander_tiles[key];
+	if (area.w <= 0 || area.h <= 0)
+		return tiles;
+
+	const Point center(area.x + area.w / 2, area.y + area.h / 2);
+	if (!is_static_walkable(center.x, center.y, movement_type))
+		return tiles;
+
+	std::vector<bool> visited(static_cast<size_t>(area.w * area.h), false);
+	visited[(center.y - area.y) * area.w + (center.x - area.x)] = true;
+	tiles.push_back(center);
+
+	// the list doubles as the queue of the flood fill
+	static const int offset_x[4] = { 1, -1, 0, 0 };
+	static const int offset_y[4] = { 0, 0, 1, -1 };
+	for (size_t i = 0; i < tiles.size(); ++i) {
+		const Point current = tiles[i];
+		for (int dir = 0; dir < 4; ++dir) {
+			const Point next(current.x + offset_x[dir], current.y + offset_y[dir]);
+			if (next.x < area.x || next.y < area.y || next.x >= area.x + area.w || next.y >= area.y + area.h)
+				continue;
+
+			const size_t index = static_cast<size_t>((next.y - area.y) * area.w + (next.x - area.x));
+			if (visited[index])
+				continue;
+			visited[index] = true;
+
+			if (is_static_walkable(next.x, next.y, movement_type))
+				tiles.push_back(next);
+		}
+	}
+
+	std::vector<Point>(tiles).swap(tiles);
+	return tiles;
+}
+
+size_t MapCollision::getByteSize() const {
+	return colmap.getByteSize() + occupancy.getByteSize() + los_cache.capacity() * sizeof(LOSCacheEntry);
 }
 
@@ -26,16 +26,68 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #ifndef MAP_COLLISION_H
 #define MAP_COLLISION_H
 
+#include "AStarContainer.h"
 #include "CommonIncludes.h"
 #include "Utils.h"
 
 #include <cstdlib>
 
-typedef std::vector< std::vector<unsigned short> > Map_Layer;
+class MapFlowField;
+class MapPathHierarchy;
+
+/**
+ * A layer of map tiles
+ *
+ * Tiles are stored row by row in a single buffer, so a row can be walked
+ * through with a pointer and a whole layer with an iterator.
+ */
+class Map_Layer {
+public:
+	typedef std::vector<unsigned short>::iterator iterator;
+	typedef std::vector<unsigned short>::const_iterator const_iterator;
+
+	Map_Layer()
+		: width(0)
+		, height(0) {
+	}
+
+	void resize(int w, int h, unsigned short value = 0) {
+		width = w;
+		height = h;
+		tiles.assign(static_cast<size_t>(w * h), value);
+	}
+
+	void swap(Map_Layer& other) {
+		std::swap(width, other.width);
+		std::swap(height, other.height);
+		tiles.swap(other.tiles);
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	size_t getByteSize() const { return tiles.capacity() * sizeof(unsigned short); }
+
+	unsigned short& at(int x, int y) { return tiles[y * width + x]; }
+	const unsigned short& at(int x, int y) const { return tiles[y * width + x]; }
+
+	// the first tile of row y, with the rest of the row following it
+	unsigned short* row(int y) { return &tiles[y * width]; }
+	const unsigned short* row(int y) const { return &tiles[y * width]; }
+
+	iterator begin() { return tiles.begin(); }
+	iterator end() { return tiles.end(); }
+	const_iterator begin() const { return tiles.begin(); }
+	const_iterator end() const { return tiles.end(); }
+
+private:
+	int width;
+	int height;
+	std::vector<unsigned short> tiles;
+};
 
 // collision tile types
 // The numbers 0..6 are the collision tiles as produced by tiled,
-// only 7 and 8 deal with entities on the map
+// only 7 and 8 deal with entities on the map, and are kept in the OccupancyLayer
 const int BLOCKS_NONE = 0;
 const int BLOCKS_ALL = 1;
 const int BLOCKS_MOVEMENT = 2;
@@ -61,26 +113,201 @@ typedef enum {
 // so if an entity has a position of (1-MIN_TILE_GAP, 0) and moves to the east, they will move to (1,0)
 const float MIN_TILE_GAP = 0.001f;
 
+// number of entries in the line of sight cache; must be a power of 2
+const unsigned LOS_CACHE_SIZE = 4096;
+
+/**
+ * A cached line of sight result between two tiles
+ */
+class LOSCacheEntry {
+public:
+	int src;
+	int dest;
+	unsigned generation;
+	bool result;
+
+	LOSCacheEntry()
+		: src(-1)
+		, dest(-1)
+		, generation(0)
+		, result(false) {
+	}
+};
+
+/**
+ * Identifies a wander area; enemies spawned on the same tile with the same radius share one
+ */
+class WanderAreaKey {
+public:
+	Rect area;
+	MOVEMENTTYPE movement_type;
+
+	WanderAreaKey(const Rect& _area, MOVEMENTTYPE _movement_type)
+		: area(_area)
+		, movement_type(_movement_type) {
+	}
+
+	bool operator<(const WanderAreaKey& other) const {
+		if (area.x != other.area.x) return area.x < other.area.x;
+		if (area.y != other.area.y) return area.y < other.area.y;
+		if (area.w != other.area.w) return area.w < other.area.w;
+		if (area.h != other.area.h) return area.h < other.area.h;
+		return movement_type < other.movement_type;
+	}
+};
+
+/**
+ * A path that an entity asked for, computed later by MapCollision::process_path_requests()
+ */
+class PathRequest {
+public:
+	const void *owner;
+	FPoint start;
+	FPoint end;
+	MOVEMENTTYPE movement_type;
+	bool done;
+	bool found;
+	std::vector<FPoint> path;
+
+	PathRequest()
+		: owner(NULL)
+		, movement_type(MOVEMENT_NORMAL)
+		, done(false)
+		, found(false) {
+	}
+};
+
+/**
+ * Packed static collision tiles of a map
+ *
+ * Tile types are stored as 4-bit values, two per byte. The questions asked most
+ * often (does this tile block sight or movement?) are answered from separate
+ * bitplanes of 32 tiles per word, so they don't need to decode the tile type at
+ * all. All of the accessors assume coordinates inside the layer.
+ *
+ * Entities are not part of this layer (see OccupancyLayer), so it only changes
+ * when a map is loaded or a mapmod changes a tile.
+ */
+class CollisionLayer {
+public:
+	CollisionLayer();
+
+	void resize(int w, int h);
+	void set(int x, int y, unsigned short type);
+
+	unsigned short get(int x, int y) const {
+		const size_t i = static_cast<size_t>(y * width + x);
+		return static_cast<unsigned short>((types[i >> 1] >> ((i & 1) << 2)) & 0xF);
+	}
+
+	// BLOCKS_ALL or BLOCKS_ALL_HIDDEN; this is also what stops flying movement
+	bool blocksSight(int x, int y) const {
+		return testBit(sight_bits, x, y);
+	}
+
+	// anything other than BLOCKS_NONE, MAP_ONLY and MAP_ONLY_ALT
+	bool blocksMovement(int x, int y) const {
+		return testBit(movement_bits, x, y);
+	}
+
+	size_t getByteSize() const;
+
+private:
+	bool testBit(const std::vector<uint32_t>& plane, int x, int y) const {
+		return ((plane[y * row_words + (x >> 5)] >> (x & 31)) & 1) != 0;
+	}
+	void setBit(std::vector<uint32_t>& plane, int x, int y, bool value);
+
+	int width;
+	int row_words;
+	std::vector<unsigned char> types;
+	std::vector<uint32_t> sight_bits;
+	std::vector<uint32_t> movement_bits;
+};
+
+/**
+ * The entities standing on a map, one per tile
+ *
+ * A tile is either free (BLOCKS_NONE), taken by the hero or an enemy
+ * (BLOCKS_ENTITIES) or taken by an ally (BLOCKS_ENEMIES). Callers don't always
+ * pair MapCollision::block() and unblock(), so a tile holds the first occupant
+ * that blocked it, until it is unblocked, rather than a count.
+ */
+class OccupancyLayer {
+public:
+	OccupancyLayer()
+		: width(0) {
+	}
+
+	void resize(int w, int h) {
+		width = w;
+		tiles.assign(static_cast<size_t>(w * h), BLOCKS_NONE);
+	}
+
+	unsigned char get(int x, int y) const { return tiles[y * width + x]; }
+	void set(int x, int y, unsigned char type) { tiles[y * width + x] = type; }
+
+	bool hasEntity(int x, int y) const { return tiles[y * width + x] != BLOCKS_NONE; }
+
+	size_t getByteSize() const { return tiles.capacity(); }
+
+private:
+	int width;
+	std::vector<unsigned char> tiles;
+};
+
 class MapCollision {
 private:
 
 	bool line_check(const float& x1, const float& y1, const float& x2, const float& y2, int check_type, MOVEMENTTYPE movement_type);
 
-	bool small_step_forced_slide_along_grid(
-		float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero);
 	bool small_step_forced_slide(
 		float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero);
-	bool small_step(
-		float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero);
 
 	bool is_valid_tile(const int& x, const int& y, MOVEMENTTYPE movement_type, bool is_hero, bool is_entity = true) const;
 
+	bool compute_local_path(const Point& start, const Point& end, std::vector<FPoint> &path, MOVEMENTTYPE movement_type, unsigned int limit);
+
+	// reused by every call to compute_path()
+	AStarContext astar;
+
+	// one hierarchy for each of MOVEMENT_NORMAL and MOVEMENT_FLYING; intangible movement doesn't need one
+	MapPathHierarchy *path_hierarchy[2];
+	std::vector<Point> path_waypoints;
+	std::vector<FPoint> path_leg;
+
+	// distance fields towards the hero, for MOVEMENT_NORMAL and MOVEMENT_FLYING
+	MapFlowField *flow_field[2];
+
+	// line of sight results between tiles, only valid while their generation matches
+	void clear_line_of_sight_cache();
+	std::vector<LOSCacheEntry> los_cache;
+	unsigned los_cache_generation;
+
+	// lines of sight from these tiles to los_target are checked on the worker threads
+	static void line_of_sight_job(void *data, size_t begin, size_t end);
+	std::vector<Point> los_pending;
+	std::vector<unsigned char> los_results;
+	Point los_target;
+
+	// tiles of each wander area that can be reached from its center, filled by get_wander_tiles()
+	std::map<WanderAreaKey, std::vector<Point> > wander_tiles;
+
+	// waiting and computed paths, in the order they were first asked for
+	std::vector<PathRequest> path_requests;
+
+	// A* nodes expanded so far, counted against PATH_NODE_BUDGET
+	unsigned path_nodes;
+
 public:
 	MapCollision();
+	MapCollision(const MapCollision&); // copy constructor not yet implemented
 	~MapCollision();
 
-	void setmap(const Map_Layer& _colmap, unsigned short w, unsigned short h);
+	void setmap(const Map_Layer& _colmap);
+	void setStaticTile(int x, int y, unsigned short value);
 	bool move(float &x, float &y, float step_x, float step_y, MOVEMENTTYPE movement_type, bool is_hero);
+	bool sweep(const FPoint& start, FPoint& end, MOVEMENTTYPE movement_type, bool is_hero, bool is_entity, FPoint *contact_normal = NULL) const;
 
 	bool is_outside_map(const int& tile_x, const int& tile_y) const;
 	bool is_outside_map(const float& tile_x, const float& tile_y) const;
@@ -88,20 +315,41 @@ public:
 	bool is_wall(const float& x, const float& y) const;
 
 	bool is_valid_position(const float& x, const float& y, MOVEMENTTYPE movement_type, bool is_hero, bool is_entity = true) const;
+	bool is_static_walkable(int tile_x, int tile_y, MOVEMENTTYPE movement_type) const;
 
 	bool line_of_sight(const float& x1, const float& y1, const float& x2, const float& y2);
+	bool get_cached_line_of_sight(const FPoint& start, const FPoint& end, bool& result) const;
+	void cache_line_of_sight(const std::vector<FPoint>& sources, const FPoint& target);
 	bool line_of_movement(const float& x1, const float& y1, const float& x2, const float& y2, MOVEMENTTYPE movement_type);
 
 	bool is_facing(const float& x1, const float& y1, char direction, const float& x2, const float& y2);
 
 	bool compute_path(const FPoint& start, const FPoint& end, std::vector<FPoint> &path, MOVEMENTTYPE movement_type, unsigned int limit = 0);
+	bool compute_flow_step(const FPoint& start, const FPoint& hero_pos, FPoint& next, MOVEMENTTYPE movement_type);
+
+	// paths asked for with request_path() are computed once per frame within PATH_NODE_BUDGET,
+	// so that many entities re-pathing at once don't all pay for it in the same frame
+	void request_path(const void *owner, const FPoint& start, const FPoint& end, MOVEMENTTYPE movement_type);
+	bool take_path(const void *owner, std::vector<FPoint> &path, bool &found);
+	void cancel_path(const void *owner);
+	void process_path_requests();
 
 	void block(const float& map_x, const float& map_y, bool is_ally);
 	void unblock(const float& map_x, const float& map_y);
 
 	FPoint get_random_neighbor(const Point& target, int range, bool ignore_blocked = false);
 
-	Map_Layer colmap;
+	const std::vector<Point>& get_wander_tiles(const Rect& area, MOVEMENTTYPE movement_type);
+
+	// the collision layers and the line of sight cache; the pathfinding data isn't counted
+	size_t getByteSize() const;
+
+	// static collision, only changed by setmap() and setStaticTile()
+	CollisionLayer colmap;
+
+	// entities, changed by block() and unblock()
+	OccupancyLayer occupancy;
+
 	Point map_size;
 };
 
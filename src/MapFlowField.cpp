@@ -0,0 +1,170 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "MapFlowField.h"
+
+#include <cfloat>
+#include <functional>
+
+// cost of a diagonal step, matching calcDist()
+const float FLOW_FIELD_DIAGONAL_COST = 1.4142135f;
+
+MapFlowField::MapFlowField()
+	: map_size()
+	, target(-1, -1)
+	, valid(false)
+	, generation(0) {
+}
+
+MapFlowField::~MapFlowField() {
+}
+
+int MapFlowField::getIndex(int x, int y) const {
+	return y * map_size.x + x;
+}
+
+/**
+ * Returns FLT_MAX for tiles that the field didn't reach
+ */
+float MapFlowField::getDist(int x, int y) const {
+	if (x < 0 || y < 0 || x >= map_size.x || y >= map_size.y)
+		return FLT_MAX;
+
+	int i = getIndex(x, y);
+	return (dist_generation[i] == generation) ? dist[i] : FLT_MAX;
+}
+
+void MapFlowField::reset(const Point& _map_size) {
+	map_size = _map_size;
+
+	size_t size = static_cast<size_t>(map_size.x * map_size.y);
+	dist.assign(size, FLT_MAX);
+	dist_generation.assign(size, 0);
+	generation = 0;
+
+	invalidate();
+}
+
+void MapFlowField::invalidate() {
+	valid = false;
+}
+
+void MapFlowField::update(const MapCollision *collider, const Point& _target, MOVEMENTTYPE movement_type) {
+	if (valid && target.x == _target.x && target.y == _target.y)
+		return;
+
+	target = _target;
+	valid = true;
+
+	// a new generation makes every tile unreached without clearing the field
+	generation++;
+	if (generation == 0) {
+		std::fill(dist_generation.begin(), dist_generation.end(), 0);
+		generation = 1;
+	}
+
+	if (target.x < 0 || target.y < 0 || target.x >= map_size.x || target.y >= map_size.y)
+		return;
+
+	std::greater<std::pair<float, int> > cmp;
+	heap.clear();
+
+	int start = getIndex(target.x, target.y);
+	dist[start] = 0;
+	dist_generation[start] = generation;
+	heap.push_back(std::pair<float, int>(0, start));
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), cmp);
+		float d = heap.back().first;
+		int cell = heap.back().second;
+		heap.pop_back();
+
+		if (d > dist[cell])
+			continue;
+
+		int cx = cell % map_size.x;
+		int cy = cell / map_size.x;
+
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dx == 0 && dy == 0)
+					continue;
+
+				int nx = cx + dx;
+				int ny = cy + dy;
+				float new_dist = d + ((dx != 0 && dy != 0) ? FLOW_FIELD_DIAGONAL_COST : 1.f);
+
+				if (new_dist > FLOW_FIELD_RANGE || new_dist >= getDist(nx, ny))
+					continue;
+
+				// entities move around too often to be part of the field, so only static collision is checked
+				// getNextStep() steps around the occupied tiles instead
+				if (!collider->is_static_walkable(nx, ny, movement_type))
+					continue;
+
+				int next = getIndex(nx, ny);
+				dist[next] = new_dist;
+				dist_generation[next] = generation;
+				heap.push_back(std::pair<float, int>(new_dist, next));
+				std::push_heap(heap.begin(), heap.end(), cmp);
+			}
+		}
+	}
+}
+
+/**
+ * Pick the neighbouring tile that is closest to the target and not occupied by an entity
+ * Returns false if the tile isn't covered by the field, or if all the way forward is blocked
+ */
+bool MapFlowField::getNextStep(const MapCollision *collider, const Point& from, MOVEMENTTYPE movement_type, Point& next) const {
+	if (!valid)
+		return false;
+
+	float best = getDist(from.x, from.y);
+	if (best == FLT_MAX)
+		return false;
+
+	bool found = false;
+
+	for (int dy = -1; dy <= 1; ++dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			if (dx == 0 && dy == 0)
+				continue;
+
+			int nx = from.x + dx;
+			int ny = from.y + dy;
+			float d = getDist(nx, ny);
+			if (d >= best)
+				continue;
+
+			// the target itself is usually occupied by whoever we are chasing
+			if (nx != target.x || ny != target.y) {
+				FPoint pos = collision_to_map(Point(nx, ny));
+				if (!collider->is_valid_position(pos.x, pos.y, movement_type, false, true))
+					continue;
+			}
+
+			best = d;
+			next.x = nx;
+			next.y = ny;
+			found = true;
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,67 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class MapFlowField
+ *
+ * A distance field (Dijkstra map) spreading out from a single target tile.
+ * Any number of entities chasing the same target can read their next step
+ * from it, instead of each computing their own path.
+ *
+ * Only static collision is used when building the field. Entities are
+ * avoided when picking the next step.
+ */
+
+#ifndef MAP_FLOW_FIELD_H
+#define MAP_FLOW_FIELD_H
+
+#include "CommonIncludes.h"
+#include "MapCollision.h"
+
+// the field doesn't spread further than this distance from the target, in tiles
+const float FLOW_FIELD_RANGE = 32;
+
+class MapFlowField {
+private:
+	int getIndex(int x, int y) const;
+	float getDist(int x, int y) const;
+
+	Point map_size;
+	Point target;
+	bool valid;
+
+	std::vector<float> dist;
+	std::vector<unsigned> dist_generation;
+	unsigned generation;
+	std::vector<std::pair<float, int> > heap;
+
+public:
+	MapFlowField();
+	~MapFlowField();
+
+	void reset(const Point& _map_size);
+
+	// forces a rebuild on the next update(), e.g. because the static collision has changed
+	void invalidate();
+
+	// rebuilds the field if the target has moved to a different tile
+	void update(const MapCollision *collider, const Point& _target, MOVEMENTTYPE movement_type);
+
+	bool getNextStep(const MapCollision *collider, const Point& from, MOVEMENTTYPE movement_type, Point& next) const;
+};
+
+#endif // MAP_FLOW_FIELD_H
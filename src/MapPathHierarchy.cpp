@@ -0,0 +1,399 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "MapPathHierarchy.h"
+
+#include <cfloat>
+#include <functional>
+
+// openings wider than this get a portal at each end instead of one in the middle
+const int PATH_WIDE_ENTRANCE = 6;
+
+// cost of a diagonal step, matching calcDist()
+const float PATH_DIAGONAL_COST = 1.4142135f;
+
+MapPathHierarchy::MapPathHierarchy()
+	: colmap(NULL)
+	, map_size()
+	, movement_type(MOVEMENT_NORMAL)
+	, cluster_count()
+	, generation(0) {
+}
+
+MapPathHierarchy::~MapPathHierarchy() {
+}
+
+/**
+ * Static collision check, ignoring entities
+ */
+bool MapPathHierarchy::isPassable(int x, int y) const {
+	if (x < 0 || y < 0 || x >= map_size.x || y >= map_size.y)
+		return false;
+
+	if (movement_type == MOVEMENT_INTANGIBLE)
+		return true;
+
+	if (movement_type == MOVEMENT_FLYING)
+		return !colmap->blocksSight(x, y);
+
+	return !colmap->blocksMovement(x, y);
+}
+
+int MapPathHierarchy::getCluster(int x, int y) const {
+	return (y / PATH_CLUSTER_SIZE) * cluster_count.x + (x / PATH_CLUSTER_SIZE);
+}
+
+Rect MapPathHierarchy::getClusterBounds(int cluster) const {
+	Rect bounds;
+	bounds.x = (cluster % cluster_count.x) * PATH_CLUSTER_SIZE;
+	bounds.y = (cluster / cluster_count.x) * PATH_CLUSTER_SIZE;
+	bounds.w = std::min(PATH_CLUSTER_SIZE, map_size.x - bounds.x);
+	bounds.h = std::min(PATH_CLUSTER_SIZE, map_size.y - bounds.y);
+	return bounds;
+}
+
+void MapPathHierarchy::build(const CollisionLayer *_colmap, const Point& _map_size, MOVEMENTTYPE _movement_type) {
+	colmap = _colmap;
+	map_size = _map_size;
+	movement_type = _movement_type;
+
+	cluster_count.x = (map_size.x + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	cluster_count.y = (map_size.y + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+
+	clusters.clear();
+	clusters.resize(cluster_count.x * cluster_count.y);
+
+	cell_dist.resize(PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE);
+	start_costs.resize(PATH_CLUSTER_PORTALS_MAX);
+	end_costs.resize(PATH_CLUSTER_PORTALS_MAX);
+
+	// one extra node is used for the end of the path
+	size_t node_count = clusters.size() * PATH_CLUSTER_PORTALS_MAX + 1;
+	node_g.assign(node_count, 0);
+	node_parent.assign(node_count, -1);
+	node_open.assign(node_count, 0);
+	node_closed.assign(node_count, 0);
+	generation = 0;
+
+	for (size_t i = 0; i < clusters.size(); ++i) {
+		buildCluster(static_cast<int>(i));
+	}
+}
+
+/**
+ * Only the cluster containing the tile needs new intra-cluster costs.
+ * If the tile is on a cluster border, the portals of the neighbouring cluster change too.
+ */
+void MapPathHierarchy::updateTile(int x, int y) {
+	if (clusters.empty() || x < 0 || y < 0 || x >= map_size.x || y >= map_size.y)
+		return;
+
+	int cluster = getCluster(x, y);
+	Rect bounds = getClusterBounds(cluster);
+
+	buildCluster(cluster);
+
+	if (x == bounds.x && x > 0)
+		buildCluster(getCluster(x-1, y));
+	if (x == bounds.x + bounds.w - 1 && x + 1 < map_size.x)
+		buildCluster(getCluster(x+1, y));
+	if (y == bounds.y && y > 0)
+		buildCluster(getCluster(x, y-1));
+	if (y == bounds.y + bounds.h - 1 && y + 1 < map_size.y)
+		buildCluster(getCluster(x, y+1));
+}
+
+/**
+ * Scan one border of a cluster for openings into the neighbouring cluster.
+ * Both clusters scan their shared border the same way, so their portals always pair up.
+ */
+void MapPathHierarchy::addBorderPortals(int cluster, const Point& start, const Point& step, const Point& across, int length) {
+	MapPathCluster &c = clusters[cluster];
+	int run_start = -1;
+
+	for (int i = 0; i <= length; ++i) {
+		bool open = false;
+		if (i < length) {
+			int x = start.x + step.x * i;
+			int y = start.y + step.y * i;
+			open = isPassable(x, y) && isPassable(x + across.x, y + across.y);
+		}
+
+		if (open && run_start == -1) {
+			run_start = i;
+		}
+		else if (!open && run_start != -1) {
+			int run_end = i - 1;
+			int offsets[2];
+			int offset_count = 0;
+
+			if (run_end - run_start + 1 < PATH_WIDE_ENTRANCE) {
+				offsets[offset_count++] = (run_start + run_end) / 2;
+			}
+			else {
+				offsets[offset_count++] = run_start;
+				offsets[offset_count++] = run_end;
+			}
+
+			for (int j = 0; j < offset_count; ++j) {
+				if (c.portals.size() >= static_cast<size_t>(PATH_CLUSTER_PORTALS_MAX))
+					return;
+
+				Point pos(start.x + step.x * offsets[j], start.y + step.y * offsets[j]);
+				c.portals.push_back(pos);
+				c.links.push_back(Point(pos.x + across.x, pos.y + across.y));
+			}
+
+			run_start = -1;
+		}
+	}
+}
+
+void MapPathHierarchy::buildCluster(int cluster) {
+	MapPathCluster &c = clusters[cluster];
+	Rect bounds = getClusterBounds(cluster);
+
+	c.portals.clear();
+	c.links.clear();
+
+	// west, east, north, south
+	if (bounds.x > 0)
+		addBorderPortals(cluster, Point(bounds.x, bounds.y), Point(0, 1), Point(-1, 0), bounds.h);
+	if (bounds.x + bounds.w < map_size.x)
+		addBorderPortals(cluster, Point(bounds.x + bounds.w - 1, bounds.y), Point(0, 1), Point(1, 0), bounds.h);
+	if (bounds.y > 0)
+		addBorderPortals(cluster, Point(bounds.x, bounds.y), Point(1, 0), Point(0, -1), bounds.w);
+	if (bounds.y + bounds.h < map_size.y)
+		addBorderPortals(cluster, Point(bounds.x, bounds.y + bounds.h - 1), Point(1, 0), Point(0, 1), bounds.w);
+
+	size_t count = c.portals.size();
+	c.costs.assign(count * count, FLT_MAX);
+
+	for (size_t i = 0; i < count; ++i) {
+		calcClusterDistances(cluster, c.portals[i]);
+		for (size_t j = 0; j < count; ++j) {
+			const Point &p = c.portals[j];
+			c.costs[i * count + j] = cell_dist[(p.y - bounds.y) * PATH_CLUSTER_SIZE + (p.x - bounds.x)];
+		}
+	}
+}
+
+/**
+ * Dijkstra search from a tile to every other tile of its cluster
+ * The results are stored in cell_dist
+ */
+void MapPathHierarchy::calcClusterDistances(int cluster, const Point& from) {
+	Rect bounds = getClusterBounds(cluster);
+	std::greater<std::pair<float, int> > cmp;
+
+	std::fill(cell_dist.begin(), cell_dist.end(), FLT_MAX);
+	cell_heap.clear();
+
+	int from_cell = (from.y - bounds.y) * PATH_CLUSTER_SIZE + (from.x - bounds.x);
+	cell_dist[from_cell] = 0;
+	cell_heap.push_back(std::pair<float, int>(0, from_cell));
+
+	while (!cell_heap.empty()) {
+		std::pop_heap(cell_heap.begin(), cell_heap.end(), cmp);
+		float dist = cell_heap.back().first;
+		int cell = cell_heap.back().second;
+		cell_heap.pop_back();
+
+		if (dist > cell_dist[cell])
+			continue;
+
+		int cx = cell % PATH_CLUSTER_SIZE;
+		int cy = cell / PATH_CLUSTER_SIZE;
+
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dx == 0 && dy == 0)
+					continue;
+
+				int nx = cx + dx;
+				int ny = cy + dy;
+				if (nx < 0 || ny < 0 || nx >= bounds.w || ny >= bounds.h)
+					continue;
+				if (!isPassable(bounds.x + nx, bounds.y + ny))
+					continue;
+
+				float new_dist = dist + ((dx != 0 && dy != 0) ? PATH_DIAGONAL_COST : 1.f);
+				int next = ny * PATH_CLUSTER_SIZE + nx;
+				if (new_dist < cell_dist[next]) {
+					cell_dist[next] = new_dist;
+					cell_heap.push_back(std::pair<float, int>(new_dist, next));
+					std::push_heap(cell_heap.begin(), cell_heap.end(), cmp);
+				}
+			}
+		}
+	}
+}
+
+int MapPathHierarchy::findPortal(int cluster, const Point& pos, const Point& link) const {
+	const MapPathCluster &c = clusters[cluster];
+	for (size_t i = 0; i < c.portals.size(); ++i) {
+		if (c.portals[i].x == pos.x && c.portals[i].y == pos.y && c.links[i].x == link.x && c.links[i].y == link.y)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+bool MapPathHierarchy::isLongRange(const Point& start, const Point& end) const {
+	if (clusters.empty())
+		return false;
+
+	if (getCluster(start.x, start.y) == getCluster(end.x, end.y))
+		return false;
+
+	return calcDist(FPoint(start), FPoint(end)) >= static_cast<float>(PATH_CLUSTER_SIZE);
+}
+
+bool MapPathHierarchy::findWaypoints(const Point& start, const Point& end, std::vector<Point>& waypoints) {
+	waypoints.clear();
+
+	if (clusters.empty())
+		return false;
+	if (start.x < 0 || start.y < 0 || start.x >= map_size.x || start.y >= map_size.y)
+		return false;
+	if (end.x < 0 || end.y < 0 || end.x >= map_size.x || end.y >= map_size.y)
+		return false;
+
+	const int start_cluster = getCluster(start.x, start.y);
+	const int end_cluster = getCluster(end.x, end.y);
+	const int end_node = static_cast<int>(clusters.size()) * PATH_CLUSTER_PORTALS_MAX;
+	const FPoint end_pos(end);
+
+	// temporarily connect start and end to the portals of their clusters
+	Rect bounds = getClusterBounds(start_cluster);
+	calcClusterDistances(start_cluster, start);
+	for (size_t i = 0; i < clusters[start_cluster].portals.size(); ++i) {
+		const Point &p = clusters[start_cluster].portals[i];
+		start_costs[i] = cell_dist[(p.y - bounds.y) * PATH_CLUSTER_SIZE + (p.x - bounds.x)];
+	}
+
+	bounds = getClusterBounds(end_cluster);
+	calcClusterDistances(end_cluster, end);
+	for (size_t i = 0; i < clusters[end_cluster].portals.size(); ++i) {
+		const Point &p = clusters[end_cluster].portals[i];
+		end_costs[i] = cell_dist[(p.y - bounds.y) * PATH_CLUSTER_SIZE + (p.x - bounds.x)];
+	}
+
+	generation++;
+	if (generation == 0) {
+		std::fill(node_open.begin(), node_open.end(), 0);
+		std::fill(node_closed.begin(), node_closed.end(), 0);
+		generation = 1;
+	}
+
+	std::greater<std::pair<float, int> > cmp;
+	node_heap.clear();
+
+	for (size_t i = 0; i < clusters[start_cluster].portals.size(); ++i) {
+		if (start_costs[i] == FLT_MAX)
+			continue;
+
+		int id = start_cluster * PATH_CLUSTER_PORTALS_MAX + static_cast<int>(i);
+		node_g[id] = start_costs[i];
+		node_parent[id] = -1;
+		node_open[id] = generation;
+		node_heap.push_back(std::pair<float, int>(start_costs[i] + calcDist(FPoint(clusters[start_cluster].portals[i]), end_pos), id));
+		std::push_heap(node_heap.begin(), node_heap.end(), cmp);
+	}
+
+	unsigned expanded = 0;
+	bool found = false;
+
+	while (!node_heap.empty() && expanded < PATH_ABSTRACT_NODE_LIMIT) {
+		std::pop_heap(node_heap.begin(), node_heap.end(), cmp);
+		int id = node_heap.back().second;
+		node_heap.pop_back();
+
+		if (node_closed[id] == generation)
+			continue;
+		node_closed[id] = generation;
+
+		if (id == end_node) {
+			found = true;
+			break;
+		}
+
+		expanded++;
+
+		const int cluster = id / PATH_CLUSTER_PORTALS_MAX;
+		const size_t index = static_cast<size_t>(id % PATH_CLUSTER_PORTALS_MAX);
+		const MapPathCluster &c = clusters[cluster];
+		const float g = node_g[id];
+
+		// each neighbour is stored as (node id, cost)
+		std::pair<int, float> edge;
+		const size_t count = c.portals.size();
+
+		for (size_t j = 0; j <= count + 1; ++j) {
+			if (j < count) {
+				// other portals of this cluster
+				if (j == index || c.costs[index * count + j] == FLT_MAX)
+					continue;
+				edge.first = cluster * PATH_CLUSTER_PORTALS_MAX + static_cast<int>(j);
+				edge.second = c.costs[index * count + j];
+			}
+			else if (j == count) {
+				// the paired portal across the border
+				int link_cluster = getCluster(c.links[index].x, c.links[index].y);
+				int link_index = findPortal(link_cluster, c.links[index], c.portals[index]);
+				if (link_index == -1)
+					continue;
+				edge.first = link_cluster * PATH_CLUSTER_PORTALS_MAX + link_index;
+				edge.second = calcDist(FPoint(c.portals[index]), FPoint(c.links[index]));
+			}
+			else {
+				// the end of the path
+				if (cluster != end_cluster || end_costs[index] == FLT_MAX)
+					continue;
+				edge.first = end_node;
+				edge.second = end_costs[index];
+			}
+
+			if (node_closed[edge.first] == generation)
+				continue;
+
+			float new_g = g + edge.second;
+			if (node_open[edge.first] != generation || new_g < node_g[edge.first]) {
+				node_g[edge.first] = new_g;
+				node_parent[edge.first] = id;
+				node_open[edge.first] = generation;
+
+				float h = 0;
+				if (edge.first != end_node) {
+					const MapPathCluster &next = clusters[edge.first / PATH_CLUSTER_PORTALS_MAX];
+					h = calcDist(FPoint(next.portals[edge.first % PATH_CLUSTER_PORTALS_MAX]), end_pos);
+				}
+				node_heap.push_back(std::pair<float, int>(new_g + h, edge.first));
+				std::push_heap(node_heap.begin(), node_heap.end(), cmp);
+			}
+		}
+	}
+
+	if (!found)
+		return false;
+
+	for (int id = node_parent[end_node]; id != -1; id = node_parent[id]) {
+		waypoints.push_back(clusters[id / PATH_CLUSTER_PORTALS_MAX].portals[id % PATH_CLUSTER_PORTALS_MAX]);
+	}
+	std::reverse(waypoints.begin(), waypoints.end());
+
+	return !waypoints.empty();
+}
@@ -0,0 +1,102 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class MapPathHierarchy
+ *
+ * Hierarchical pathfinding (HPA*) abstraction of the collision layer.
+ * The map is split into square clusters. Walkable openings between adjacent
+ * clusters become portal nodes, and the costs between portals of the same
+ * cluster are cached. Long paths are first searched on this small graph, and
+ * the resulting waypoints are then refined with regular A*.
+ *
+ * Only static collision is considered; tiles blocked by entities are treated as empty.
+ */
+
+#ifndef MAP_PATH_HIERARCHY_H
+#define MAP_PATH_HIERARCHY_H
+
+#include "CommonIncludes.h"
+#include "MapCollision.h"
+
+// width and height of a cluster, in collision tiles
+const int PATH_CLUSTER_SIZE = 16;
+
+// portals past this number are ignored
+const int PATH_CLUSTER_PORTALS_MAX = 64;
+
+// the abstract search gives up after expanding this many portals
+const unsigned PATH_ABSTRACT_NODE_LIMIT = 2048;
+
+class MapPathCluster {
+public:
+	std::vector<Point> portals;
+
+	// the tile on the other side of the cluster border for each portal
+	std::vector<Point> links;
+
+	// [portals.size() * portals.size()] costs between portals of this cluster, FLT_MAX if unreachable
+	std::vector<float> costs;
+};
+
+class MapPathHierarchy {
+private:
+	bool isPassable(int x, int y) const;
+	int getCluster(int x, int y) const;
+	Rect getClusterBounds(int cluster) const;
+
+	void addBorderPortals(int cluster, const Point& start, const Point& step, const Point& across, int length);
+	void buildCluster(int cluster);
+	void calcClusterDistances(int cluster, const Point& from);
+	int findPortal(int cluster, const Point& pos, const Point& link) const;
+
+	const CollisionLayer *colmap;
+	Point map_size;
+	MOVEMENTTYPE movement_type;
+	Point cluster_count;
+	std::vector<MapPathCluster> clusters;
+
+	// scratch data, reused between searches
+	std::vector<float> cell_dist;
+	std::vector<std::pair<float, int> > cell_heap;
+
+	std::vector<float> node_g;
+	std::vector<int> node_parent;
+	std::vector<unsigned> node_open;
+	std::vector<unsigned> node_closed;
+	std::vector<std::pair<float, int> > node_heap;
+	std::vector<float> start_costs;
+	std::vector<float> end_costs;
+	unsigned generation;
+
+public:
+	MapPathHierarchy();
+	~MapPathHierarchy();
+
+	void build(const CollisionLayer *_colmap, const Point& _map_size, MOVEMENTTYPE _movement_type);
+
+	// called when the static collision of a tile has changed
+	void updateTile(int x, int y);
+
+	// returns true if start and end are far enough apart to benefit from the abstract search
+	bool isLongRange(const Point& start, const Point& end) const;
+
+	// fills waypoints with portal positions from start to end (without either of them)
+	bool findWaypoints(const Point& start, const Point& end, std::vector<Point>& waypoints);
+};
+
+#endif // MAP_PATH_HIERARCHY_H
@@ -0,0 +1,104 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "MapPreloader.h"
+#include "Profiler.h"
+#include "SharedResources.h"
+
+MapPreloader::MapPreloader()
+	: filename("")
+	, compiled_file("")
+	, thread(NULL)
+	, parsed(false) {
+	SDL_AtomicSet(&done, 0);
+}
+
+MapPreloader::~MapPreloader() {
+	wait();
+}
+
+int MapPreloader::run(void *data) {
+	MapPreloader *preloader = static_cast<MapPreloader*>(data);
+	{
+		ProfileScope scope(PROFILE_MAP_PRELOAD);
+
+		// random intermap events draw from RANDOM_GENERAL while parsing, which only the main thread may do.
+		// Compiled maps never have them, and the others are left for MapRenderer::load() to parse.
+		if (preloader->compiled_file.empty() && Map::hasRandomEvents(preloader->filename))
+			preloader->parsed = false;
+		else
+			preloader->parsed = preloader->map.parse(preloader->filename, preloader->compiled_file);
+	}
+	SDL_AtomicSet(&preloader->done, 1);
+	return 0;
+}
+
+/**
+ * Block until the parsing thread has finished
+ */
+void MapPreloader::wait() {
+	if (thread) {
+		SDL_WaitThread(thread, NULL);
+		thread = NULL;
+	}
+}
+
+void MapPreloader::start(const std::string& fname) {
+	if (fname == filename || isBusy())
+		return;
+
+	wait();
+
+	filename = fname;
+	parsed = false;
+	SDL_AtomicSet(&done, 0);
+
+	// mods->locate() caches its results, so it is only called from the main thread
+	compiled_file = map.getCompiledFilename(fname);
+
+	thread = SDL_CreateThread(run, "MapPreloader", this);
+	if (!thread) {
+		logError("MapPreloader: Could not create thread: %s", SDL_GetError());
+		filename = "";
+	}
+}
+
+bool MapPreloader::isBusy() {
+	return thread && SDL_AtomicGet(&done) == 0;
+}
+
+std::string MapPreloader::getMusicFilename() {
+	if (!thread || isBusy() || !parsed)
+		return "";
+
+	return map.music_filename;
+}
+
+bool MapPreloader::take(const std::string& fname, Map *dest) {
+	if (!dest || filename.empty() || fname != filename)
+		return false;
+
+	// if the thread hasn't finished yet, waiting for it is still quicker than starting over
+	wait();
+	filename = "";
+
+	if (!parsed)
+		return false;
+
+	dest->takeParsed(map);
+	return true;
+}
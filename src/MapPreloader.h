@@ -0,0 +1,69 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class MapPreloader
+ *
+ * Parses a map on a background thread, so that it is ready by the time the
+ * hero walks into the teleport leading to it.
+ *
+ * Only parsing is done on the thread. Tileset images and enemy animations
+ * can only be loaded on the main thread, and are loaded as before once
+ * MapRenderer::load() takes the preloaded map. The music of the parsed map
+ * can be handed to SoundManager::preloadMusic().
+ */
+
+#ifndef MAP_PRELOADER_H
+#define MAP_PRELOADER_H
+
+#include "CommonIncludes.h"
+#include "Map.h"
+
+// preloading starts when the hero is this close to the center of an intermap event, in tiles
+const float MAP_PRELOAD_RANGE = 8;
+
+class MapPreloader {
+private:
+	static int run(void *data);
+	void wait();
+
+	Map map;
+	std::string filename;
+	std::string compiled_file;
+	SDL_Thread *thread;
+	SDL_atomic_t done;
+	bool parsed;
+
+public:
+	MapPreloader();
+	MapPreloader(const MapPreloader&); // not implemented
+	~MapPreloader();
+
+	// starts parsing fname unless it has already been preloaded
+	void start(const std::string& fname);
+
+	// true while a map is being parsed
+	bool isBusy();
+
+	// the music of the parsed map, or "" while it's still being parsed
+	std::string getMusicFilename();
+
+	// if fname was preloaded, moves it into dest and returns true
+	bool take(const std::string& fname, Map *dest);
+};
+
+#endif // MAP_PRELOADER_H
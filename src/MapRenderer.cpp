@@ -19,11 +19,15 @@ You should have received a copy of the GNU General Public License along with
 FLARE.  If not, see http://www.gnu.org/licenses/
 */
 
+#include "AllocTracker.h"
 #include "CampaignManager.h"
 #include "CommonIncludes.h"
 #include "EnemyGroupManager.h"
+#include "FrameArena.h"
 #include "MapRenderer.h"
+#include "MemoryUsage.h"
 #include "PowerManager.h"
+#include "Profiler.h"
 #include "SharedGameResources.h"
 #include "SharedResources.h"
 #include "StatBlock.h"
@@ -41,7 +45,11 @@ MapRenderer::MapRenderer()
 	, tip_pos()
 	, show_tooltip(false)
 	, shakycam()
+	, view()
+	, cull_view()
+	, chunk_frame(0)
 	, cam()
+	, prev_cam()
 	, map_change(false)
 	, teleportation(false)
 	, teleport_destination()
@@ -64,71 +72,56 @@ void MapRenderer::clearQueues() {
 	loot.clear();
 }
 
-bool MapRenderer::enemyGroupPlaceEnemy(float x, float y, Map_Group &g) {
-	if (collider.is_empty(x, y)) {
-		Enemy_Level enemy_lev = enemyg->getRandomEnemy(g.category, g.levelmin, g.levelmax);
-		if (!enemy_lev.type.empty()) {
-			Map_Enemy group_member = Map_Enemy(enemy_lev.type, FPoint(x, y));
+void MapRenderer::enemyGroupPlaceEnemy(float x, float y, Map_Group &g) {
+	Enemy_Level enemy_lev = enemyg->getRandomEnemy(g.category, g.levelmin, g.levelmax);
+	if (!enemy_lev.type.empty()) {
+		Map_Enemy group_member = Map_Enemy(enemy_lev.type, FPoint(x, y));
 
-			group_member.direction = (g.direction == -1 ? rand()%8 : g.direction);
-			group_member.wander_radius = g.wander_radius;
-			group_member.requires_status = g.requires_status;
-			group_member.requires_not_status = g.requires_not_status;
+		group_member.direction = (g.direction == -1 ? randInt(8) : g.direction);
+		group_member.wander_radius = g.wander_radius;
+		group_member.requires_status = g.requires_status;
+		group_member.requires_not_status = g.requires_not_status;
 
-			if (g.area.x == 1 && g.area.y == 1) {
-				// this is a single enemy
-				group_member.waypoints = g.waypoints;
-			}
-
-			enemies.push(group_member);
+		if (g.area.x == 1 && g.area.y == 1) {
+			// this is a single enemy
+			group_member.waypoints = g.waypoints;
 		}
-		return true;
+
+		enemies.push(group_member);
 	}
-	return false;
 }
 
 void MapRenderer::pushEnemyGroup(Map_Group &g) {
 	// activate at all?
-	float activate_chance = static_cast<float>(rand() % 100) / 100.0f;
+	float activate_chance = static_cast<float>(randInt(100)) / 100.0f;
 	if (activate_chance > g.chance) {
 		return;
 	}
 
-	// The algorithm tries to place the enemies at random locations.
-	// However if a location is not possible (unwalkable or there is already an entity),
-	// then try again.
-	// This could result in an infinite loop if there were more enemies than
-	// actual places, so have an upper bound of tries.
-
 	// random number of enemies
 	int enemies_to_spawn = randBetween(g.numbermin, g.numbermax);
 
-	// pick an upper bound, which is definitely larger than threetimes the enemy number to spawn.
-	int allowed_misses = 5 * g.numbermax;
-
-	while (enemies_to_spawn && allowed_misses) {
-
-		float x = (g.area.x == 0) ? (static_cast<float>(g.pos.x) + 0.5f) : (static_cast<float>(g.pos.x + (rand() % g.area.x))) + 0.5f;
-		float y = (g.area.y == 0) ? (static_cast<float>(g.pos.y) + 0.5f) : (static_cast<float>(g.pos.y + (rand() % g.area.y))) + 0.5f;
-
-		if (enemyGroupPlaceEnemy(x, y, g))
-			enemies_to_spawn--;
-		else
-			allowed_misses--;
-	}
-	if (enemies_to_spawn) {
-		// now that the fast method of spawning enemies doesn't work, but we
-		// still have enemies to place, do not place them randomly, but at the
-		// first free spot
-		for (int x = g.pos.x; x < g.pos.x + g.area.x && enemies_to_spawn; x++) {
-			for (int y = g.pos.y; y < g.pos.y + g.area.y && enemies_to_spawn; y++) {
-				float xpos = static_cast<float>(x) + 0.5f;
-				float ypos = static_cast<float>(y) + 0.5f;
-				if (enemyGroupPlaceEnemy(xpos, ypos, g))
-					enemies_to_spawn--;
-			}
+	// collect the empty tiles of the group area once
+	// an area size of 0 means the group is placed on a single row or column
+	const int area_w = std::max(g.area.x, 1);
+	const int area_h = std::max(g.area.y, 1);
+	group_free_tiles.clear();
+	for (int x = g.pos.x; x < g.pos.x + area_w; x++) {
+		for (int y = g.pos.y; y < g.pos.y + area_h; y++) {
+			if (collider.is_empty(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f))
+				group_free_tiles.push_back(Point(x, y));
 		}
+	}
 
+	// place the enemies on random tiles, so that no two of them share a tile
+	while (enemies_to_spawn && !group_free_tiles.empty()) {
+		const size_t index = randIndex(group_free_tiles.size());
+		const Point tile = group_free_tiles[index];
+		group_free_tiles[index] = group_free_tiles.back();
+		group_free_tiles.pop_back();
+
+		enemyGroupPlaceEnemy(static_cast<float>(tile.x) + 0.5f, static_cast<float>(tile.y) + 0.5f, g);
+		enemies_to_spawn--;
 	}
 	if (enemies_to_spawn) {
 		logError("MapRenderer: Could not spawn all enemies in group at %s (x=%d,y=%d,w=%d,h=%d), %d missing (min=%d max=%d)",
@@ -142,10 +135,132 @@ void MapRenderer::pushEnemyGroup(Map_Group &g) {
  */
 void MapRenderer::clearLayers() {
 	Map::clearLayers();
+	layer_extent.clear();
 	index_objectlayer = 0;
 }
 
 int MapRenderer::load(const std::string& fname) {
+	addProfileMarker("load map " + fname);
+
+	beginLoad();
+
+	MapCache::Entry *cached = parsed_maps.get(fname);
+	if (cached) {
+		copyParsed(*cached->resource);
+		finishLoad(fname);
+	}
+	else if (preloader.take(fname, this) || parse(fname, getCompiledFilename(fname))) {
+		cacheParsed(fname);
+		finishLoad(fname);
+	}
+
+	endLoad();
+
+	return 0;
+}
+
+/**
+ * The map is loaded again through a teleport, so that enemies, events and the minimap are set up as usual
+ */
+void MapRenderer::reloadMap(const FPoint& pos) {
+	parsed_maps.remove(filename);
+
+	teleportation = true;
+	teleport_mapname = filename;
+	teleport_destination = pos;
+}
+
+/**
+ * Keeps a copy of the map that was just parsed, for when the hero comes back to it
+ * Maps with random intermap events are parsed again each time, so that a new destination is picked.
+ */
+void MapRenderer::cacheParsed(const std::string& fname) {
+	if (has_random_events)
+		return;
+
+	Map *copy = new Map();
+	copy->copyParsed(*this);
+	parsed_maps.add(fname, copy, copy->getParsedBytes());
+	parsed_maps.trim(MAP_CACHE_BYTES);
+}
+
+/**
+ * Replace the map with a generated one, using the tiles of the current tileset
+ * Visible layers are a fully tiled background, followed by sparse layers, the last of which is the object layer.
+ * Object tiles also block movement, and the map is surrounded by walls.
+ */
+void MapRenderer::generate(const std::string& fname, const Point& size, int layer_count, unsigned seed) {
+	addProfileMarker("generate map " + fname);
+
+	std::vector<unsigned short> tile_ids;
+	for (size_t i = 1; i < tset.tiles.size(); ++i) {
+		if (tset.tiles[i].image)
+			tile_ids.push_back(static_cast<unsigned short>(i));
+	}
+	const std::string tileset_name = tileset;
+
+	beginLoad();
+	clearMap();
+
+	RandomStream rng;
+	rng.seed(seed);
+
+	tileset = tileset_name;
+	title = msg->get("Generated Map");
+	w = static_cast<unsigned short>(size.x);
+	h = static_cast<unsigned short>(size.y);
+	hero_pos_enabled = true;
+	hero_pos = FPoint(static_cast<float>(w/2) + 0.5f, static_cast<float>(h/2) + 0.5f);
+
+	layer_count = std::max(layer_count, 1);
+	for (int i = 0; i <= layer_count; ++i) {
+		addLayer();
+	}
+	for (int i = 0; i < layer_count; ++i) {
+		if (i == 0) layernames.push_back("background");
+		else if (i == layer_count-1) layernames.push_back("object");
+		else layernames.push_back("fringe");
+
+		layers[i].resize(w, h, 0);
+		if (tile_ids.empty())
+			continue;
+
+		// the background is fully covered, the other layers only here and there
+		const int coverage = (i == 0) ? 100 : 10;
+		for (Map_Layer::iterator it = layers[i].begin(); it != layers[i].end(); ++it) {
+			if (rng.nextInt(100) < coverage)
+				*it = tile_ids[static_cast<size_t>(rng.nextInt(static_cast<int>(tile_ids.size())))];
+		}
+	}
+
+	Map_Layer& collision = layers.back();
+	layernames.push_back("collision");
+	collision_layer = layer_count;
+	collision.resize(w, h, BLOCKS_NONE);
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			if (x == 0 || y == 0 || x == w-1 || y == h-1)
+				collision.at(x, y) = BLOCKS_ALL;
+			else if (layer_count > 1 && layers[layer_count-1].at(x, y) != 0)
+				collision.at(x, y) = BLOCKS_ALL;
+		}
+	}
+
+	// keep the spawn position open
+	const Point spawn = FPointToPoint(hero_pos);
+	collision.at(spawn.x, spawn.y) = BLOCKS_NONE;
+	if (layer_count > 1)
+		layers[layer_count-1].at(spawn.x, spawn.y) = 0;
+
+	finishLoad(fname);
+
+	endLoad();
+}
+
+/**
+ * Reset everything that belongs to the previous map
+ */
+void MapRenderer::beginLoad() {
 	// unload sounds
 	snd->reset();
 	while (!sids.empty()) {
@@ -164,20 +279,24 @@ int MapRenderer::load(const std::string& fname) {
 	show_tooltip = false;
 
 	background_filename = "";
+}
 
-	Map::load(fname);
+/**
+ * Set up the collision, enemies, tileset and background of the map that was just loaded
+ */
+void MapRenderer::endLoad() {
+	event_grid.invalidate();
 
 	loadMusic();
+	preloadSounds();
 
 	for (unsigned i = 0; i < layers.size(); ++i) {
 		if (layernames[i] == "collision") {
-			short width = static_cast<short>(layers[i].size());
-			if (width == 0) {
+			if (layers[i].getWidth() == 0) {
 				logError("MapRenderer: Map width is 0. Can't set collision layer.");
 				break;
 			}
-			short height = static_cast<short>(layers[i][0].size());
-			collider.setmap(layers[i], width, height);
+			collider.setmap(layers[i]);
 			removeLayer(i);
 		}
 	}
@@ -185,24 +304,29 @@ int MapRenderer::load(const std::string& fname) {
 		if (layernames[i] == "object")
 			index_objectlayer = i;
 
+	entity_grid.reset(Point(w, h));
+
 	while (!enemy_groups.empty()) {
 		pushEnemyGroup(enemy_groups.front());
 		enemy_groups.pop();
 	}
 
 	tset.load(this->tileset);
+	clearChunks();
 
 	std::vector<unsigned> corrupted;
+	layer_extent.assign(layers.size(), Point());
 	for (unsigned i = 0; i < layers.size(); ++i) {
-		for (unsigned x = 0; x < layers[i].size(); ++x) {
-			for (unsigned y = 0; y < layers[i][x].size(); ++y) {
-				const unsigned tile_id = layers[i][x][y];
-				if (tile_id > 0 && (tile_id >= tset.tiles.size() || tset.tiles[tile_id].tile == NULL)) {
-					if (std::find(corrupted.begin(), corrupted.end(), tile_id) == corrupted.end()) {
-						corrupted.push_back(tile_id);
-					}
-					layers[i][x][y] = 0;
+		for (Map_Layer::iterator it = layers[i].begin(); it != layers[i].end(); ++it) {
+			const unsigned tile_id = *it;
+			if (tile_id > 0 && (tile_id >= tset.tiles.size() || tset.tiles[tile_id].image == NULL)) {
+				if (std::find(corrupted.begin(), corrupted.end(), tile_id) == corrupted.end()) {
+					corrupted.push_back(tile_id);
 				}
+				*it = 0;
+			}
+			else if (tile_id > 0) {
+				growLayerExtent(i, static_cast<unsigned short>(tile_id));
 			}
 		}
 	}
@@ -217,8 +341,29 @@ int MapRenderer::load(const std::string& fname) {
 
 	map_background.load(background_filename);
 	map_background.setMapCenter(w/2, h/2);
+}
 
-	return 0;
+void MapRenderer::getMemoryUsage(MemoryUsage& usage) const {
+	for (size_t i = 0; i < layers.size(); ++i) {
+		usage.add("layer " + (i < layernames.size() ? layernames[i] : ""), layers[i].getByteSize());
+	}
+	for (size_t i = 0; i < spare_layers.size(); ++i) {
+		usage.add("spare layer", spare_layers[i].getByteSize());
+	}
+
+	const size_t chunk_bytes = static_cast<size_t>(MAP_CHUNK_SIZE) * static_cast<size_t>(MAP_CHUNK_SIZE) * 4;
+	usage.add("layer chunks", chunks.size() * chunk_bytes);
+
+	usage.add("collision", collider.getByteSize());
+
+	size_t event_bytes = events.capacity() * sizeof(Event);
+	for (size_t i = 0; i < events.size(); ++i) {
+		event_bytes += events[i].components.capacity() * sizeof(Event_Component);
+	}
+	usage.add("events", event_bytes);
+
+	usage.add("event stat blocks", statblocks.capacity() * sizeof(StatBlock));
+	usage.add("cached maps", parsed_maps.getTotalBytes());
 }
 
 void MapRenderer::loadMusic() {
@@ -233,6 +378,21 @@ void MapRenderer::loadMusic() {
 	}
 }
 
+/**
+ * Start decoding the sound effects of the map's events now, so that
+ * triggering one later doesn't have to load it from disk.
+ * The sounds are unloaded along with the others when the map changes.
+ */
+void MapRenderer::preloadSounds() {
+	for (size_t i = 0; i < events.size(); ++i) {
+		for (size_t j = 0; j < events[i].components.size(); ++j) {
+			const Event_Component &ec = events[i].components[j];
+			if (ec.type == EC_SOUNDFX && !ec.getString().empty())
+				sids.push_back(snd->load(ec.getString(), "MapRenderer background soundfx"));
+		}
+	}
+}
+
 void MapRenderer::logic() {
 
 	// handle camera shaking timer
@@ -241,6 +401,9 @@ void MapRenderer::logic() {
 	// handle tile set logic e.g. animations
 	tset.logic();
 
+	// paths that creatures asked for during their logic
+	collider.process_path_requests();
+
 	// handle statblock logic for map powers
 	for (unsigned i=0; i<statblocks.size(); ++i) {
 		statblocks[i].logic();
@@ -254,82 +417,267 @@ void MapRenderer::logic() {
 
 }
 
-bool priocompare(const Renderable &r1, const Renderable &r2) {
-	return r1.prio < r2.prio;
-}
-
 /**
  * Sort in the same order as the tiles are drawn
  * Depends upon the map implementation
  */
-void calculatePriosIso(std::vector<Renderable> &r) {
-	for (std::vector<Renderable>::iterator it = r.begin(); it != r.end(); ++it) {
-		const unsigned tilex = static_cast<const unsigned>(floor(it->map_pos.x));
-		const unsigned tiley = static_cast<const unsigned>(floor(it->map_pos.y));
-		const int commax = static_cast<const int>((it->map_pos.x - static_cast<float>(tilex)) * (2<<16));
-		const int commay = static_cast<const int>((it->map_pos.y - static_cast<float>(tiley)) * (2<<16));
-		it->prio += (static_cast<uint64_t>(tilex + tiley) << 54) + (static_cast<uint64_t>(tilex) << 42) + (static_cast<uint64_t>(commax + commay) << 16);
+static inline uint64_t calculatePrioIso(float x, float y, uint64_t prio) {
+	const unsigned tilex = static_cast<const unsigned>(floor(x));
+	const unsigned tiley = static_cast<const unsigned>(floor(y));
+	const int commax = static_cast<const int>((x - static_cast<float>(tilex)) * (2<<16));
+	const int commay = static_cast<const int>((y - static_cast<float>(tiley)) * (2<<16));
+	return prio + (static_cast<uint64_t>(tilex + tiley) << 54) + (static_cast<uint64_t>(tilex) << 42) + (static_cast<uint64_t>(commax + commay) << 16);
+}
+
+static inline uint64_t calculatePrioOrtho(float x, float y, uint64_t prio) {
+	const unsigned tilex = static_cast<const unsigned>(floor(x));
+	const unsigned tiley = static_cast<const unsigned>(floor(y));
+	const int commay = static_cast<const int>(1024 * y);
+	return prio + (static_cast<uint64_t>(tiley) << 48) + (static_cast<uint64_t>(tilex) << 32) + (static_cast<uint64_t>(commay) << 16);
+}
+
+void RenderableSorter::gather(std::vector<Renderable> &r, const ScreenTransform& view) {
+	const size_t count = r.size();
+
+	// gather the positions, so that the passes below are simple loops over arrays
+	pos_x.resize(count);
+	pos_y.resize(count);
+	screen_x.resize(count);
+	screen_y.resize(count);
+	for (size_t i=0; i<count; ++i) {
+		pos_x[i] = r[i].map_pos.x;
+		pos_y[i] = r[i].map_pos.y;
 	}
+
+	if (count > 0)
+		view.mapToScreen(&pos_x[0], &pos_y[0], count, &screen_x[0], &screen_y[0]);
 }
 
-void calculatePriosOrtho(std::vector<Renderable> &r) {
-	for (std::vector<Renderable>::iterator it = r.begin(); it != r.end(); ++it) {
-		const unsigned tilex = static_cast<const unsigned>(floor(it->map_pos.x));
-		const unsigned tiley = static_cast<const unsigned>(floor(it->map_pos.y));
-		const int commay = static_cast<const int>(1024 * it->map_pos.y);
-		it->prio += (static_cast<uint64_t>(tiley) << 48) + (static_cast<uint64_t>(tilex) << 32) + (static_cast<uint64_t>(commay) << 16);
+void RenderableSorter::calculateKeys(std::vector<Renderable> &r, bool iso) {
+	if (iso) {
+		for (size_t i=0; i<keys.size(); ++i) {
+			const unsigned index = keys[i].second;
+			keys[i].first = calculatePrioIso(pos_x[index], pos_y[index], r[index].prio);
+		}
 	}
+	else {
+		for (size_t i=0; i<keys.size(); ++i) {
+			const unsigned index = keys[i].second;
+			keys[i].first = calculatePrioOrtho(pos_x[index], pos_y[index], r[index].prio);
+		}
+	}
+}
+
+bool RenderableSorter::isVisible(const Renderable &ren, unsigned index) const {
+	const int x = screen_x[index] - ren.offset.x;
+	const int y = screen_y[index] - ren.offset.y;
+	return ren.image != NULL
+		&& x + ren.src.w + RENDERABLE_CULL_MARGIN > 0 && x - RENDERABLE_CULL_MARGIN < VIEW_W
+		&& y + ren.src.h + RENDERABLE_CULL_MARGIN > 0 && y - RENDERABLE_CULL_MARGIN < VIEW_H;
 }
 
-void MapRenderer::render(std::vector<Renderable> &r, std::vector<Renderable> &r_dead) {
+void RenderableSorter::output(std::vector<Renderable> &r) {
+	const size_t count = keys.size();
+	sorted.resize(count);
+	tile_x.resize(count);
+	tile_y.resize(count);
+	dest.resize(count);
+	visible.resize(count);
+	for (size_t i=0; i<count; ++i) {
+		const unsigned index = keys[i].second;
+		const Renderable &ren = r[index];
+		sorted[i] = &r[index];
+		tile_x[i] = static_cast<int>(pos_x[index]);
+		tile_y[i] = static_cast<int>(pos_y[index]);
+		dest[i] = Point(screen_x[index] - ren.offset.x, screen_y[index] - ren.offset.y);
+		visible[i] = isVisible(ren, index);
+	}
+}
+
+void RenderableSorter::sort(std::vector<Renderable> &r, bool iso, const ScreenTransform& view) {
+	const size_t count = r.size();
+
+	// renderables are collected in the same order every frame, so the previous order is kept while the count is unchanged
+	if (keys.size() != count) {
+		keys.resize(count);
+		for (size_t i=0; i<count; ++i)
+			keys[i].second = static_cast<unsigned>(i);
+	}
+
+	gather(r, view);
+	calculateKeys(r, iso);
+
+	// only a few renderables move past each other between frames, which insertion sort handles in linear time
+	const size_t max_moves = count * RENDERABLE_SORT_MOVES;
+	size_t moves = 0;
+	for (size_t i=1; i<count && moves <= max_moves; ++i) {
+		const std::pair<uint64_t, unsigned> key = keys[i];
+		size_t j = i;
+		while (j > 0 && key < keys[j-1]) {
+			keys[j] = keys[j-1];
+			--j;
+			++moves;
+		}
+		keys[j] = key;
+	}
+	if (moves > max_moves)
+		std::sort(keys.begin(), keys.end());
+
+	output(r);
+}
+
+void RenderableSorter::bucket(std::vector<Renderable> &r, bool iso, const ScreenTransform& view) {
+	const size_t count = r.size();
+	gather(r, view);
+
+	// renderables off screen are never drawn, so they are left out of the buckets
+	keys.clear();
+	Point area_min;
+	Point area_max;
+	for (size_t i=0; i<count; ++i) {
+		const unsigned index = static_cast<unsigned>(i);
+		if (!isVisible(r[i], index))
+			continue;
+
+		const Point tile(static_cast<int>(pos_x[i]), static_cast<int>(pos_y[i]));
+		if (keys.empty()) {
+			area_min = tile;
+			area_max = tile;
+		}
+		else {
+			area_min.x = std::min(area_min.x, tile.x);
+			area_min.y = std::min(area_min.y, tile.y);
+			area_max.x = std::max(area_max.x, tile.x);
+			area_max.y = std::max(area_max.y, tile.y);
+		}
+		keys.push_back(std::pair<uint64_t, unsigned>(0, index));
+	}
+	calculateKeys(r, iso);
+
+	bucket_area.x = area_min.x;
+	bucket_area.y = area_min.y;
+	bucket_area.w = keys.empty() ? 0 : area_max.x - area_min.x + 1;
+	bucket_area.h = keys.empty() ? 0 : area_max.y - area_min.y + 1;
+
+	// count the renderables of each tile, and turn the counts into starting positions
+	const size_t cells = static_cast<size_t>(bucket_area.w) * static_cast<size_t>(bucket_area.h);
+	bucket_start.assign(cells + 1, 0);
+	for (size_t i=0; i<keys.size(); ++i) {
+		const unsigned index = keys[i].second;
+		const int x = static_cast<int>(pos_x[index]) - bucket_area.x;
+		const int y = static_cast<int>(pos_y[index]) - bucket_area.y;
+		++bucket_start[static_cast<size_t>(y * bucket_area.w + x) + 1];
+	}
+	for (size_t i=1; i<=cells; ++i)
+		bucket_start[i] += bucket_start[i-1];
+
+	bucket_fill.assign(bucket_start.begin(), bucket_start.end());
+	bucket_keys.resize(keys.size());
+	for (size_t i=0; i<keys.size(); ++i) {
+		const unsigned index = keys[i].second;
+		const int x = static_cast<int>(pos_x[index]) - bucket_area.x;
+		const int y = static_cast<int>(pos_y[index]) - bucket_area.y;
+		bucket_keys[bucket_fill[static_cast<size_t>(y * bucket_area.w + x)]++] = keys[i];
+	}
+
+	// buckets hold a handful of renderables at most, so sorting them is cheap
+	for (size_t cell=0; cell<cells; ++cell) {
+		const size_t first = bucket_start[cell];
+		const size_t last = bucket_start[cell+1];
+		for (size_t i=first+1; i<last; ++i) {
+			const std::pair<uint64_t, unsigned> key = bucket_keys[i];
+			size_t j = i;
+			while (j > first && key < bucket_keys[j-1]) {
+				bucket_keys[j] = bucket_keys[j-1];
+				--j;
+			}
+			bucket_keys[j] = key;
+		}
+	}
+
+	keys.swap(bucket_keys);
+	output(r);
+}
+
+void RenderableSorter::getBucket(int x, int y, size_t& first, size_t& last) const {
+	x -= bucket_area.x;
+	y -= bucket_area.y;
+	if (x < 0 || y < 0 || x >= bucket_area.w || y >= bucket_area.h) {
+		first = last = 0;
+		return;
+	}
+
+	const size_t cell = static_cast<size_t>(y * bucket_area.w + x);
+	first = bucket_start[cell];
+	last = bucket_start[cell+1];
+}
+
+void MapRenderer::render(std::vector<Renderable> &r, std::vector<Renderable> &r_dead, const FPoint& render_cam) {
+	ProfileScope scope(PROFILE_RENDER_MAP);
+	AllocSteadyScope steady;
 
 	if (shaky_cam_ticks == 0) {
-		shakycam.x = cam.x;
-		shakycam.y = cam.y;
+		shakycam.x = render_cam.x;
+		shakycam.y = render_cam.y;
 	}
 	else {
-		shakycam.x = cam.x + static_cast<float>((rand() % 16 - 8)) * 0.0078125f;
-		shakycam.y = cam.y + static_cast<float>((rand() % 16 - 8)) * 0.0078125f;
+		shakycam.x = render_cam.x + static_cast<float>(randInt(16, RANDOM_VISUAL) - 8) * 0.0078125f;
+		shakycam.y = render_cam.y + static_cast<float>(randInt(16, RANDOM_VISUAL) - 8) * 0.0078125f;
 	}
+	view.setCamera(shakycam);
 
-	map_background.render(shakycam);
+	// the world may be drawn at a lower resolution than the menus
+	render_device->beginWorld();
 
-	if (TILESET_ORIENTATION == TILESET_ORTHOGONAL) {
-		calculatePriosOrtho(r);
-		calculatePriosOrtho(r_dead);
-		std::sort(r.begin(), r.end(), priocompare);
-		std::sort(r_dead.begin(), r_dead.end(), priocompare);
-		renderOrtho(r, r_dead);
+	// map tiles and renderables are queued so that draws sharing the same image can be grouped
+	render_device->beginBatch();
+
+	{
+		ProfileScope scope_background(PROFILE_RENDER_MAP_BACKGROUND);
+		map_background.render(shakycam);
 	}
-	else {
-		calculatePriosIso(r);
-		calculatePriosIso(r_dead);
-		std::sort(r.begin(), r.end(), priocompare);
-		std::sort(r_dead.begin(), r_dead.end(), priocompare);
-		renderIso(r, r_dead);
+
+	const bool iso = TILESET_ORIENTATION != TILESET_ORTHOGONAL;
+	{
+		ProfileScope scope_sort(PROFILE_RENDER_MAP_SORT);
+		sorter.bucket(r, iso, view);
+		sorter_dead.sort(r_dead, iso, view);
+	}
+	{
+		ProfileScope scope_objects(PROFILE_RENDER_MAP_OBJECTS);
+		if (iso)
+			renderIso(sorter, sorter_dead);
+		else
+			renderOrtho(sorter, sorter_dead);
 	}
+
+	ProfileScope scope_compose(PROFILE_RENDER_MAP_COMPOSE);
+	render_device->endWorld();
 }
 
-void MapRenderer::drawRenderable(std::vector<Renderable>::iterator r_cursor) {
-	if (r_cursor->image != NULL) {
+void MapRenderer::drawRenderable(const RenderableSorter &r, size_t index) {
+	if (r.visible[index]) {
 		Rect dest;
-		Point p = map_to_screen(r_cursor->map_pos.x, r_cursor->map_pos.y, shakycam.x, shakycam.y);
-		dest.x = p.x - r_cursor->offset.x;
-		dest.y = p.y - r_cursor->offset.y;
-		render_device->render(*r_cursor, dest);
+		dest.x = r.dest[index].x;
+		dest.y = r.dest[index].y;
+		render_device->submit(*r.sorted[index], dest);
 	}
 }
 
-void MapRenderer::renderIsoLayer(const Map_Layer& layerdata) {
+void MapRenderer::renderIsoLayer(const Map_Layer& layerdata, const Point& extent) {
+	// the layer has no tiles at all
+	if (extent.x == 0)
+		return;
+
 	int_fast16_t i; // first index of the map array
 	int_fast16_t j; // second index of the map array
 	Point dest;
 	const Point upperleft = FPointToPoint(screen_to_map(0, 0, shakycam.x, shakycam.y));
-	const int_fast16_t max_tiles_width =   static_cast<int_fast16_t>((VIEW_W / TILE_W) + 2*tset.max_size_x);
-	const int_fast16_t max_tiles_height = static_cast<int_fast16_t>((2 * VIEW_H / TILE_H) + 2*(tset.max_size_y+1));
+	const int_fast16_t max_tiles_width =   static_cast<int_fast16_t>((VIEW_W / TILE_W) + 2*extent.x);
+	const int_fast16_t max_tiles_height = static_cast<int_fast16_t>((2 * VIEW_H / TILE_H) + 2*(extent.y+1));
 
-	j = static_cast<int_fast16_t>(upperleft.y - tset.max_size_y/2 + tset.max_size_x);
-	i = static_cast<int_fast16_t>(upperleft.x - tset.max_size_y/2 - tset.max_size_x);
+	j = static_cast<int_fast16_t>(upperleft.y - extent.y/2 + extent.x);
+	i = static_cast<int_fast16_t>(upperleft.x - extent.y/2 - extent.x);
 
 	for (uint_fast16_t y = max_tiles_height ; y; --y) {
 		int_fast16_t tiles_width = 0;
@@ -353,8 +701,7 @@ void MapRenderer::renderIsoLayer(const Map_Layer& layerdata) {
 		// lower left (south west) corner is caught by having 0 in there, so j>0
 		const int_fast16_t j_end = std::max(static_cast<int_fast16_t>(j+i-w+1),	std::max(static_cast<int_fast16_t>(j - max_tiles_width), static_cast<int_fast16_t>(0)));
 
-		Point p = map_to_screen(float(i), float(j), shakycam.x, shakycam.y);
-		p = centerTile(p);
+		Point p = view.tileToScreen(static_cast<int>(i), static_cast<int>(j));
 
 		// draw one horizontal line
 		while (j > j_end) {
@@ -363,14 +710,11 @@ void MapRenderer::renderIsoLayer(const Map_Layer& layerdata) {
 			++tiles_width;
 			p.x += TILE_W;
 
-			if (const uint_fast16_t current_tile = layerdata[i][j]) {
-				const Tile_Def &tile = tset.tiles[current_tile];
+			if (const uint_fast16_t current_tile = layerdata.at(static_cast<int>(i), static_cast<int>(j))) {
+				const Tile_Def &tile = tset.getTile(static_cast<unsigned>(current_tile));
 				dest.x = p.x - tile.offset.x;
 				dest.y = p.y - tile.offset.y;
-				// no need to set w and h in dest, as it is ignored
-				// by SDL_BlitSurface
-				tile.tile->setDest(dest);
-				render_device->render(tile.tile);
+				render_device->submit(tile.image, tile.src, dest);
 			}
 		}
 		j = static_cast<int_fast16_t>(j + tiles_width);
@@ -383,29 +727,246 @@ void MapRenderer::renderIsoLayer(const Map_Layer& layerdata) {
 	}
 }
 
-void MapRenderer::renderIsoBackObjects(std::vector<Renderable> &r) {
-	std::vector<Renderable>::iterator it;
-	for (it = r.begin(); it != r.end(); ++it)
-		drawRenderable(it);
+/**
+ * Integer division that rounds towards negative infinity
+ */
+static int floorDiv(int a, int b) {
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/**
+ * The position of a tile in map pixel space, before centering
+ * Adding centerTile(map_to_screen(0, 0, cam)) gives the screen position.
+ */
+static Point tileToPixel(int x, int y) {
+	if (TILESET_ORIENTATION == TILESET_ORTHOGONAL)
+		return Point(x * TILE_W, y * TILE_H);
+	else
+		return Point((x - y) * TILE_W_HALF, (x + y) * TILE_H_HALF);
+}
+
+void MapRenderer::renderStaticLayers() {
+	if (index_objectlayer == 0 || index_objectlayer > layers.size())
+		return;
+
+	chunk_frame++;
+
+	const Point origin = view.tileToScreen(0, 0);
+	const int first_x = floorDiv(-origin.x, MAP_CHUNK_SIZE);
+	const int first_y = floorDiv(-origin.y, MAP_CHUNK_SIZE);
+	const int last_x = floorDiv(VIEW_W - 1 - origin.x, MAP_CHUNK_SIZE);
+	const int last_y = floorDiv(VIEW_H - 1 - origin.y, MAP_CHUNK_SIZE);
+
+	for (int cy = first_y; cy <= last_y; ++cy) {
+		for (int cx = first_x; cx <= last_x; ++cx) {
+			Map_Chunk &chunk = chunks[std::make_pair(cx, cy)];
+			chunk.last_visible = chunk_frame;
+
+			// redraw the chunk if any of its animated tiles have changed frames
+			for (size_t i = 0; i < chunk.anim_tiles.size(); ++i) {
+				if (tset.getAnimFrame(chunk.anim_tiles[i]) != chunk.anim_frames[i]) {
+					chunk.dirty = true;
+					break;
+				}
+			}
+
+			if (chunk.dirty)
+				buildChunk(chunk, Point(cx, cy));
+
+			if (chunk.sprite) {
+				chunk.sprite->setDest(cx * MAP_CHUNK_SIZE + origin.x, cy * MAP_CHUNK_SIZE + origin.y);
+				render_device->submit(chunk.sprite);
+			}
+		}
+	}
+
+	// free chunks that have scrolled off the screen
+	if (chunks.size() > MAP_CHUNK_CACHE_SIZE) {
+		std::map<std::pair<int, int>, Map_Chunk>::iterator it = chunks.begin();
+		while (it != chunks.end()) {
+			if (it->second.last_visible != chunk_frame) {
+				delete it->second.sprite;
+				chunks.erase(it++);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+}
+
+void MapRenderer::buildChunk(Map_Chunk& chunk, const Point& chunk_pos) {
+	chunk.dirty = false;
+	chunk.anim_tiles.clear();
+	chunk.anim_frames.clear();
+
+	Image *graphics = NULL;
+	if (chunk.sprite) {
+		graphics = chunk.sprite->getGraphics();
+		graphics->fillWithColor(Color(0,0,0,0));
+	}
+
+	const int x0 = chunk_pos.x * MAP_CHUNK_SIZE;
+	const int y0 = chunk_pos.y * MAP_CHUNK_SIZE;
+
+	bool has_tiles = false;
+
+	// Tiles are visited in the same order that renderIsoLayer() and renderOrthoLayer() draw them.
+	// (i, j) is stored in a flat list so that both orientations can share the drawing code below.
+	// The list is shared by the layers and reserved up front, since the frame arena can't reuse what it grows out of.
+	std::vector<Point, FrameAllocator<Point> > tile_order;
+
+	for (unsigned index = 0; index < index_objectlayer; ++index) {
+		const Map_Layer &layerdata = layers[index];
+		if (layer_extent[index].x == 0)
+			continue;
+
+		// tiles can extend beyond their logical position by up to the size of the largest tile on this layer
+		const int margin_x = (layer_extent[index].x + 1) * TILE_W;
+		const int margin_y = (layer_extent[index].y + 1) * TILE_H;
+		const int min_px = x0 - 2 * margin_x;
+		const int max_px = x0 + MAP_CHUNK_SIZE + margin_x;
+		const int min_py = y0 - 2 * margin_y;
+		const int max_py = y0 + MAP_CHUNK_SIZE + margin_y;
+
+		tile_order.clear();
+
+		if (TILESET_ORIENTATION == TILESET_ORTHOGONAL) {
+			const int min_i = std::max(0, floorDiv(min_px, TILE_W));
+			const int max_i = std::min(w - 1, floorDiv(max_px, TILE_W));
+			const int min_j = std::max(0, floorDiv(min_py, TILE_H));
+			const int max_j = std::min(h - 1, floorDiv(max_py, TILE_H));
+			if (max_i >= min_i && max_j >= min_j)
+				tile_order.reserve(static_cast<size_t>(max_i - min_i + 1) * static_cast<size_t>(max_j - min_j + 1));
+			for (int j = min_j; j <= max_j; ++j)
+				for (int i = min_i; i <= max_i; ++i)
+					tile_order.push_back(Point(i, j));
+		}
+		else {
+			// s = i+j is the row on screen, d = i-j is the column
+			const int min_s = std::max(0, floorDiv(min_py, TILE_H_HALF));
+			const int max_s = std::min(w + h - 2, floorDiv(max_py, TILE_H_HALF));
+			const int min_d = floorDiv(min_px, TILE_W_HALF);
+			const int max_d = floorDiv(max_px, TILE_W_HALF);
+			// each screen row has at most one tile for every other column
+			if (max_s >= min_s && max_d >= min_d)
+				tile_order.reserve(static_cast<size_t>(max_s - min_s + 1) * static_cast<size_t>((max_d - min_d) / 2 + 1));
+			for (int s = min_s; s <= max_s; ++s) {
+				const int min_i = std::max(std::max(0, s - (h - 1)), floorDiv(s + min_d + 1, 2));
+				const int max_i = std::min(std::min(w - 1, s), floorDiv(s + max_d, 2));
+				for (int i = min_i; i <= max_i; ++i)
+					tile_order.push_back(Point(i, s - i));
+			}
+		}
+
+		for (size_t k = 0; k < tile_order.size(); ++k) {
+			const unsigned short current_tile = layerdata.at(tile_order[k].x, tile_order[k].y);
+			if (!current_tile)
+				continue;
+
+			const Tile_Def &tile = tset.getTile(current_tile);
+			Rect clip = tile.src;
+			Point p = tileToPixel(tile_order[k].x, tile_order[k].y);
+
+			Rect dest;
+			dest.x = p.x - tile.offset.x - x0;
+			dest.y = p.y - tile.offset.y - y0;
+			if (dest.x >= MAP_CHUNK_SIZE || dest.y >= MAP_CHUNK_SIZE || dest.x + clip.w <= 0 || dest.y + clip.h <= 0)
+				continue;
+
+			if (!graphics) {
+				graphics = render_device->createImage(MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+				if (!graphics)
+					return;
+				chunk.sprite = graphics->createSprite();
+				graphics->unref();
+			}
+
+			render_device->renderToImage(tile.image, clip, graphics, dest);
+			has_tiles = true;
+
+			if (current_tile < tset.anim.size() && tset.anim[current_tile].frames > 0) {
+				if (std::find(chunk.anim_tiles.begin(), chunk.anim_tiles.end(), current_tile) == chunk.anim_tiles.end()) {
+					chunk.anim_tiles.push_back(current_tile);
+					chunk.anim_frames.push_back(tset.getAnimFrame(current_tile));
+				}
+			}
+		}
+	}
+
+	// nothing to draw here, so don't keep the image around
+	if (!has_tiles && chunk.sprite) {
+		delete chunk.sprite;
+		chunk.sprite = NULL;
+	}
+}
+
+void MapRenderer::clearChunks() {
+	std::map<std::pair<int, int>, Map_Chunk>::iterator it;
+	for (it = chunks.begin(); it != chunks.end(); ++it) {
+		delete it->second.sprite;
+	}
+	chunks.clear();
+}
+
+void MapRenderer::clearRenderCaches() {
+	clearChunks();
+	map_background.clearCaches();
+}
+
+void MapRenderer::growLayerExtent(size_t layer, unsigned short tile) {
+	const Point extent = tset.getTileExtent(tile);
+	layer_extent[layer].x = std::max(layer_extent[layer].x, extent.x);
+	layer_extent[layer].y = std::max(layer_extent[layer].y, extent.y);
+}
+
+void MapRenderer::setTile(size_t layer, int x, int y, unsigned short tile) {
+	layers[layer].at(x, y) = tile;
+	if (layer < layer_extent.size()) {
+		growLayerExtent(layer, tile);
+		invalidateTile(layer, x, y);
+	}
+}
+
+void MapRenderer::invalidateTile(size_t layer, int x, int y) {
+	// chunks only hold the layers below the object layer
+	if (layer >= index_objectlayer)
+		return;
+
+	const Point p = tileToPixel(x, y);
+	const int margin_x = (layer_extent[layer].x + 1) * TILE_W;
+	const int margin_y = (layer_extent[layer].y + 1) * TILE_H;
+	const int first_x = floorDiv(p.x - margin_x, MAP_CHUNK_SIZE);
+	const int first_y = floorDiv(p.y - margin_y, MAP_CHUNK_SIZE);
+	const int last_x = floorDiv(p.x + 2 * margin_x, MAP_CHUNK_SIZE);
+	const int last_y = floorDiv(p.y + 2 * margin_y, MAP_CHUNK_SIZE);
+
+	std::map<std::pair<int, int>, Map_Chunk>::iterator it;
+	for (it = chunks.begin(); it != chunks.end(); ++it) {
+		if (it->first.first >= first_x && it->first.first <= last_x && it->first.second >= first_y && it->first.second <= last_y)
+			it->second.dirty = true;
+	}
+}
+
+void MapRenderer::renderIsoBackObjects(const RenderableSorter &r) {
+	for (size_t index = 0; index < r.sorted.size(); ++index)
+		drawRenderable(r, index);
 }
 
-void MapRenderer::renderIsoFrontObjects(std::vector<Renderable> &r) {
+void MapRenderer::renderIsoFrontObjects(const RenderableSorter &r) {
 	Point dest;
 
 	const Point upperleft = FPointToPoint(screen_to_map(0, 0, shakycam.x, shakycam.y));
 	const int_fast16_t max_tiles_width = static_cast<int_fast16_t>((VIEW_W / TILE_W) + 2 * tset.max_size_x);
 	const int_fast16_t max_tiles_height = static_cast<int_fast16_t>(((VIEW_H / TILE_H) + 2 * tset.max_size_y)*2);
 
-	std::vector<Renderable>::iterator r_cursor = r.begin();
-	std::vector<Renderable>::iterator r_end = r.end();
+	size_t r_first;
+	size_t r_last;
 
 	// object layer
 	int_fast16_t j = static_cast<int_fast16_t>(upperleft.y - tset.max_size_y + tset.max_size_x);
 	int_fast16_t i = static_cast<int_fast16_t>(upperleft.x - tset.max_size_y - tset.max_size_x);
 
-	while (r_cursor != r_end && (static_cast<int>(r_cursor->map_pos.x) + static_cast<int>(r_cursor->map_pos.y) < i + j || static_cast<int>(r_cursor->map_pos.x) < i)) // implicit floor
-		++r_cursor;
-
 	if (index_objectlayer >= layers.size())
 		return;
 
@@ -427,8 +988,7 @@ void MapRenderer::renderIsoFrontObjects(std::vector<Renderable> &r) {
 		const int_fast16_t j_end = std::max(static_cast<int_fast16_t>(j+i-w+1), std::max(static_cast<int_fast16_t>(j - max_tiles_width), static_cast<int_fast16_t>(0)));
 
 		// draw one horizontal line
-		Point p = map_to_screen(float(i), float(j), shakycam.x, shakycam.y);
-		p = centerTile(p);
+		Point p = view.tileToScreen(static_cast<int>(i), static_cast<int>(j));
 		const Map_Layer &current_layer = layers[index_objectlayer];
 		while (j > j_end) {
 			--j;
@@ -436,19 +996,16 @@ void MapRenderer::renderIsoFrontObjects(std::vector<Renderable> &r) {
 			++tiles_width;
 			p.x += TILE_W;
 
-			if (const uint_fast16_t current_tile = current_layer[i][j]) {
-				const Tile_Def &tile = tset.tiles[current_tile];
+			if (const uint_fast16_t current_tile = current_layer.at(static_cast<int>(i), static_cast<int>(j))) {
+				const Tile_Def &tile = tset.getTile(static_cast<unsigned>(current_tile));
 				dest.x = p.x - tile.offset.x;
 				dest.y = p.y - tile.offset.y;
-				tile.tile->setDest(dest);
-				render_device->render(tile.tile);
+				render_device->submit(tile.image, tile.src, dest);
 			}
 
 			// some renderable entities go in this layer
-			while (r_cursor != r_end && (static_cast<int>(r_cursor->map_pos.x) == i && static_cast<int>(r_cursor->map_pos.y) == j)) { // implicit floor by int cast
-				drawRenderable(r_cursor);
-				++r_cursor;
-			}
+			for (r.getBucket(static_cast<int>(i), static_cast<int>(j), r_first, r_last); r_first != r_last; ++r_first)
+				drawRenderable(r, r_first);
 		}
 		j = static_cast<int_fast16_t>(j + tiles_width);
 		i = static_cast<int_fast16_t>(i - tiles_width);
@@ -456,71 +1013,80 @@ void MapRenderer::renderIsoFrontObjects(std::vector<Renderable> &r) {
 			i++;
 		else
 			j++;
-
-		while (r_cursor != r_end && (static_cast<int>(r_cursor->map_pos.x) + static_cast<int>(r_cursor->map_pos.y) < i + j || static_cast<int>(r_cursor->map_pos.x) <= i)) // implicit floor by int cast
-			++r_cursor;
 	}
 }
 
-void MapRenderer::renderIso(std::vector<Renderable> &r, std::vector<Renderable> &r_dead) {
+void MapRenderer::renderIso(const RenderableSorter &r, const RenderableSorter &r_dead) {
 	size_t index = 0;
-	while (index < index_objectlayer)
-		renderIsoLayer(layers[index++]);
+	if (DEV_SKIP_LAYERS) {
+		index = index_objectlayer;
+	}
+	else if (CACHE_MAP_LAYERS) {
+		renderStaticLayers();
+		index = index_objectlayer;
+	}
+	while (index < index_objectlayer) {
+		renderIsoLayer(layers[index], layer_extent[index]);
+		++index;
+	}
 
 	renderIsoBackObjects(r_dead);
 	renderIsoFrontObjects(r);
 
 	index++;
-	while (index < layers.size())
-		renderIsoLayer(layers[index++]);
+	while (!DEV_SKIP_LAYERS && index < layers.size()) {
+		renderIsoLayer(layers[index], layer_extent[index]);
+		++index;
+	}
 
+	render_device->flushBatch();
 	checkTooltip();
 }
 
-void MapRenderer::renderOrthoLayer(const Map_Layer& layerdata) {
+void MapRenderer::renderOrthoLayer(const Map_Layer& layerdata, const Point& extent) {
+	if (extent.x == 0)
+		return;
 
 	Point dest;
 	const Point upperleft = FPointToPoint(screen_to_map(0, 0, shakycam.x, shakycam.y));
 
 	short int startj = static_cast<short int>(std::max(0, upperleft.y));
 	short int starti = static_cast<short int>(std::max(0, upperleft.x));
-	const short max_tiles_width =  std::min(w, static_cast<short unsigned int>(starti + (VIEW_W / TILE_W) + 2 * tset.max_size_x));
-	const short max_tiles_height = std::min(h, static_cast<short unsigned int>(startj + (VIEW_H / TILE_H) + 2 * tset.max_size_y));
+	const short max_tiles_width =  std::min(w, static_cast<short unsigned int>(starti + (VIEW_W / TILE_W) + 2 * extent.x));
+	const short max_tiles_height = std::min(h, static_cast<short unsigned int>(startj + (VIEW_H / TILE_H) + 2 * extent.y));
 
 	short int i;
 	short int j;
 
 	for (j = startj; j < max_tiles_height; j++) {
-		Point p = map_to_screen(starti, j, shakycam.x, shakycam.y);
-		p = centerTile(p);
+		Point p = view.tileToScreen(starti, j);
+		const unsigned short *row = layerdata.row(j);
 		for (i = starti; i < max_tiles_width; i++) {
 
-			if (const unsigned short current_tile = layerdata[i][j]) {
-				const Tile_Def &tile = tset.tiles[current_tile];
+			if (const unsigned short current_tile = row[i]) {
+				const Tile_Def &tile = tset.getTile(current_tile);
 				dest.x = p.x - tile.offset.x;
 				dest.y = p.y - tile.offset.y;
-				tile.tile->setDest(dest);
-				render_device->render(tile.tile);
+				render_device->submit(tile.image, tile.src, dest);
 			}
 			p.x += TILE_W;
 		}
 	}
 }
 
-void MapRenderer::renderOrthoBackObjects(std::vector<Renderable> &r) {
+void MapRenderer::renderOrthoBackObjects(const RenderableSorter &r) {
 	// some renderables are drawn above the background and below the objects
-	std::vector<Renderable>::iterator it;
-	for (it = r.begin(); it != r.end(); ++it)
-		drawRenderable(it);
+	for (size_t index = 0; index < r.sorted.size(); ++index)
+		drawRenderable(r, index);
 }
 
-void MapRenderer::renderOrthoFrontObjects(std::vector<Renderable> &r) {
+void MapRenderer::renderOrthoFrontObjects(const RenderableSorter &r) {
 
 	short int i;
 	short int j;
 	Point dest;
-	std::vector<Renderable>::iterator r_cursor = r.begin();
-	std::vector<Renderable>::iterator r_end = r.end();
+	size_t r_first;
+	size_t r_last;
 
 	const Point upperleft = FPointToPoint(screen_to_map(0, 0, shakycam.x, shakycam.y));
 
@@ -529,50 +1095,55 @@ void MapRenderer::renderOrthoFrontObjects(std::vector<Renderable> &r) {
 	const short max_tiles_width  = std::min(w, static_cast<short unsigned int>(starti + (VIEW_W / TILE_W) + 2 * tset.max_size_x));
 	const short max_tiles_height = std::min(h, static_cast<short unsigned int>(startj + (VIEW_H / TILE_H) + 2 * tset.max_size_y));
 
-	while (r_cursor != r_end && static_cast<int>(r_cursor->map_pos.y) < startj)
-		++r_cursor;
-
 	if (index_objectlayer >= layers.size())
 		return;
 
+	const Map_Layer &current_layer = layers[index_objectlayer];
+
 	for (j = startj; j < max_tiles_height; j++) {
-		Point p = map_to_screen(starti, j, shakycam.x, shakycam.y);
-		p = centerTile(p);
+		Point p = view.tileToScreen(starti, j);
+		const unsigned short *row = current_layer.row(j);
 		for (i = starti; i<max_tiles_width; i++) {
 
-			if (const unsigned short current_tile = layers[index_objectlayer][i][j]) {
-				const Tile_Def &tile = tset.tiles[current_tile];
+			if (const unsigned short current_tile = row[i]) {
+				const Tile_Def &tile = tset.getTile(current_tile);
 				dest.x = p.x - tile.offset.x;
 				dest.y = p.y - tile.offset.y;
-				tile.tile->setDest(dest);
-				render_device->render(tile.tile);
+				render_device->submit(tile.image, tile.src, dest);
 			}
 			p.x += TILE_W;
 
-			while (r_cursor != r_end && static_cast<int>(r_cursor->map_pos.y) == j && static_cast<int>(r_cursor->map_pos.x) < i) // implicit floor
-				++r_cursor;
-
 			// some renderable entities go in this layer
-			while (r_cursor != r_end && static_cast<int>(r_cursor->map_pos.y) == j && static_cast<int>(r_cursor->map_pos.x) == i) // implicit floor
-				drawRenderable(r_cursor++);
+			for (r.getBucket(i, j, r_first, r_last); r_first != r_last; ++r_first)
+				drawRenderable(r, r_first);
 		}
-		while (r_cursor != r_end && static_cast<int>(r_cursor->map_pos.y) <= j) // implicit floor
-			++r_cursor;
 	}
 }
 
-void MapRenderer::renderOrtho(std::vector<Renderable> &r, std::vector<Renderable> &r_dead) {
+void MapRenderer::renderOrtho(const RenderableSorter &r, const RenderableSorter &r_dead) {
 	unsigned index = 0;
-	while (index < index_objectlayer)
-		renderOrthoLayer(layers[index++]);
+	if (DEV_SKIP_LAYERS) {
+		index = index_objectlayer;
+	}
+	else if (CACHE_MAP_LAYERS) {
+		renderStaticLayers();
+		index = index_objectlayer;
+	}
+	while (index < index_objectlayer) {
+		renderOrthoLayer(layers[index], layer_extent[index]);
+		++index;
+	}
 
 	renderOrthoBackObjects(r_dead);
 	renderOrthoFrontObjects(r);
 	index++;
 
-	while (index < layers.size())
-		renderOrthoLayer(layers[index++]);
+	while (!DEV_SKIP_LAYERS && index < layers.size()) {
+		renderOrthoLayer(layers[index], layer_extent[index]);
+		++index;
+	}
 
+	render_device->flushBatch();
 	checkTooltip();
 }
 
@@ -583,7 +1154,7 @@ void MapRenderer::executeOnLoadEvents() {
 		Event_Component ec;
 
 		ec.type = EC_SCRIPT;
-		ec.s = LOAD_SCRIPT;
+		ec.setString(LOAD_SCRIPT);
 		LOAD_SCRIPT.clear();
 
 		evnt.components.push_back(ec);
@@ -603,7 +1174,7 @@ void MapRenderer::executeOnLoadEvents() {
 
 		if ((*it).activate_type == EVENT_ON_LOAD) {
 			if (EventManager::executeEvent(*it))
-				it = events.erase(it);
+				it = eraseEvent(it);
 		}
 	}
 }
@@ -625,15 +1196,70 @@ void MapRenderer::executeOnMapExitEvents() {
 	}
 }
 
+/**
+ * Rebuilds the event grid if events were added or erased since it was last built
+ */
+void MapRenderer::updateEventGrid() {
+	if (!event_grid.isValid(events.size()))
+		event_grid.build(events, Point(w, h));
+}
+
+std::vector<Event>::iterator MapRenderer::eraseEvent(std::vector<Event>::iterator it) {
+	event_grid.invalidate();
+	return events.erase(it);
+}
+
+/**
+ * Start parsing the destination of the closest intermap event while the hero approaches it
+ */
+void MapRenderer::checkPreload(const FPoint& loc) {
+	if (preloader.isBusy())
+		return;
+
+	// open the music of the preloaded map while the current one is still playing
+	if (MUSIC_VOLUME > 0)
+		snd->preloadMusic(preloader.getMusicFilename());
+
+	float nearest_dist = MAP_PRELOAD_RANGE;
+	Event_Component *nearest = NULL;
+
+	updateEventGrid();
+	event_grid.queryCenters(loc, MAP_PRELOAD_RANGE, event_candidates);
+
+	for (size_t i = 0; i < event_candidates.size(); ++i) {
+		Event &evnt = events[event_candidates[i]];
+		if (!EventManager::isActive(evnt))
+			continue;
+
+		Event_Component *ec = evnt.getComponent(EC_INTERMAP);
+		if (!ec || ec->getString() == filename)
+			continue;
+
+		float dist = calcDist(loc, evnt.center);
+		if (dist < nearest_dist) {
+			nearest_dist = dist;
+			nearest = ec;
+		}
+	}
+
+	// maps that are still cached don't need to be parsed again
+	if (nearest && !parsed_maps.get(nearest->getString()))
+		preloader.start(nearest->getString());
+}
+
 void MapRenderer::checkEvents(const FPoint& loc) {
+	checkPreload(loc);
+
 	Point maploc;
 	maploc.x = int(loc.x);
 	maploc.y = int(loc.y);
-	std::vector<Event>::iterator it;
 
-	// loop in reverse because we may erase elements
-	for (it = events.end(); it != events.begin(); ) {
-		--it;
+	updateEventGrid();
+	event_grid.queryLocation(maploc, event_candidates);
+
+	// candidates are in descending order, so erasing one doesn't move the rest
+	for (size_t i = 0; i < event_candidates.size(); ++i) {
+		std::vector<Event>::iterator it = events.begin() + event_candidates[i];
 
 		// skip inactive events
 		if (!EventManager::isActive(*it)) continue;
@@ -641,13 +1267,13 @@ void MapRenderer::checkEvents(const FPoint& loc) {
 		// static events are run every frame without interaction from the player
 		if ((*it).activate_type == EVENT_STATIC) {
 			if (EventManager::executeEvent(*it))
-				it = events.erase(it);
+				eraseEvent(it);
 			continue;
 		}
 
 		if ((*it).activate_type == EVENT_ON_CLEAR) {
 			if (enemies_cleared && EventManager::executeEvent(*it))
-				it = events.erase(it);
+				eraseEvent(it);
 			continue;
 		}
 
@@ -667,14 +1293,14 @@ void MapRenderer::checkEvents(const FPoint& loc) {
 				if ((*it).getComponent(EC_WAS_INSIDE_EVENT_AREA)) {
 					(*it).deleteAllComponents(EC_WAS_INSIDE_EVENT_AREA);
 					if (EventManager::executeEvent(*it))
-						it = events.erase(it);
+						eraseEvent(it);
 				}
 			}
 		}
 		else {
 			if (inside)
 				if (EventManager::executeEvent(*it))
-					it = events.erase(it);
+					eraseEvent(it);
 		}
 	}
 }
@@ -693,12 +1319,21 @@ void MapRenderer::checkHotspots() {
 
 	show_tooltip = false;
 
-	std::vector<Event>::iterator it;
+	// only hotspots near the tile under the mouse can have a tile sprite under it
+	FPoint mouse_tile = screen_to_map(inpt->mouse.x, inpt->mouse.y, shakycam.x, shakycam.y);
+	const int margin = tset.max_size_x + tset.max_size_y + 1;
+	Rect area;
+	area.x = int(mouse_tile.x) - margin;
+	area.y = int(mouse_tile.y) - margin;
+	area.w = area.h = margin * 2 + 1;
+
+	updateEventGrid();
+	event_grid.queryHotspots(area, event_candidates);
 
 	// work backwards through events because events can be erased in the loop.
-	// this prevents the iterator from becoming invalid.
-	for (it = events.end(); it != events.begin(); ) {
-		--it;
+	// candidates are in descending order, so the iterator doesn't become invalid.
+	for (size_t i = 0; i < event_candidates.size(); ++i) {
+		std::vector<Event>::iterator it = events.begin() + event_candidates[i];
 
 		for (int x=it->hotspot.x; x < it->hotspot.x + it->hotspot.w; ++x) {
 			for (int y=it->hotspot.y; y < it->hotspot.y + it->hotspot.h; ++y) {
@@ -729,14 +1364,14 @@ void MapRenderer::checkHotspots() {
 						Point p = map_to_screen(float(x), float(y), shakycam.x, shakycam.y);
 						p = centerTile(p);
 
-						if (const short current_tile = layers[index][x][y]) {
+						if (const short current_tile = layers[index].at(x, y)) {
 							// first check if mouse pointer is in rectangle of that tile:
 							const Tile_Def &tile = tset.tiles[current_tile];
 							Rect dest;
 							dest.x = p.x - tile.offset.x;
 							dest.y = p.y - tile.offset.y;
-							dest.w = tile.tile->getClip().w;
-							dest.h = tile.tile->getClip().h;
+							dest.w = tile.src.w;
+							dest.h = tile.src.h;
 
 							if (isWithinRect(dest, inpt->mouse)) {
 								matched = true;
@@ -776,7 +1411,7 @@ void MapRenderer::checkHotspots() {
 
 						inpt->lock[MAIN1] = true;
 						if (EventManager::executeEvent(*it))
-							it = events.erase(it);
+							eraseEvent(it);
 					}
 					return;
 				}
@@ -789,13 +1424,14 @@ void MapRenderer::checkHotspots() {
 void MapRenderer::checkNearestEvent() {
 	if (!inpt->usingMouse()) show_tooltip = false;
 
-	std::vector<Event>::iterator it;
 	std::vector<Event>::iterator nearest = events.end();
 	float best_distance = std::numeric_limits<float>::max();
 
-	// loop in reverse because we may erase elements
-	for (it = events.end(); it != events.begin(); ) {
-		--it;
+	updateEventGrid();
+	event_grid.queryCenters(cam, INTERACT_RANGE, event_candidates);
+
+	for (size_t i = 0; i < event_candidates.size(); ++i) {
+		std::vector<Event>::iterator it = events.begin() + event_candidates[i];
 
 		// skip inactive events
 		if (!EventManager::isActive(*it)) continue;
@@ -832,7 +1468,7 @@ void MapRenderer::checkNearestEvent() {
 			if (inpt->pressing[ACCEPT]) inpt->lock[ACCEPT] = true;
 
 			if(EventManager::executeEvent(*nearest))
-				events.erase(nearest);
+				eraseEvent(nearest);
 		}
 	}
 }
@@ -843,11 +1479,11 @@ void MapRenderer::checkTooltip() {
 }
 
 void MapRenderer::createTooltip(Event_Component *ec) {
-	if (ec && !ec->s.empty() && TOOLTIP_CONTEXT != TOOLTIP_MENU) {
+	if (ec && !ec->getString().empty() && TOOLTIP_CONTEXT != TOOLTIP_MENU) {
 		show_tooltip = true;
-		if (!tip_buf.compareFirstLine(ec->s)) {
+		if (!tip_buf.compareFirstLine(ec->getString())) {
 			tip_buf.clear();
-			tip_buf.addText(ec->s);
+			tip_buf.addText(ec->getString());
 		}
 		TOOLTIP_CONTEXT = TOOLTIP_MAP;
 	}
@@ -867,8 +1503,8 @@ void MapRenderer::activatePower(int power_index, unsigned statblock_index, FPoin
 
 	if (statblock_index < statblocks.size()) {
 		// check power cooldown before activating
-		if (statblocks[statblock_index].powers_ai[0].ticks == 0) {
-			statblocks[statblock_index].powers_ai[0].ticks = powers->powers[power_index].cooldown;
+		if (statblocks[statblock_index].isAIPowerReady(0)) {
+			statblocks[statblock_index].setAIPowerCooldown(0, powers->powers[power_index].cooldown);
 			powers->activate(power_index, &statblocks[statblock_index], target);
 		}
 	}
@@ -884,7 +1520,7 @@ bool MapRenderer::isValidTile(const unsigned &tile) {
 	if (tile >= tset.tiles.size())
 		return false;
 
-	return tset.tiles[tile].tile != NULL;
+	return tset.tiles[tile].image != NULL;
 }
 
 Point MapRenderer::centerTile(const Point& p) {
@@ -899,8 +1535,43 @@ Point MapRenderer::centerTile(const Point& p) {
 	return r;
 }
 
+bool MapRenderer::isOnScreen(const Renderable& r) {
+	if (r.image == NULL)
+		return false;
+
+	Rect bounds;
+	bounds.x = -r.offset.x;
+	bounds.y = -r.offset.y;
+	bounds.w = r.src.w;
+	bounds.h = r.src.h;
+	return isOnScreen(r.map_pos, bounds);
+}
+
+bool MapRenderer::isOnScreen(const FPoint& map_pos, const Rect& bounds) {
+	const FPoint render_cam = getRenderCam();
+	if (!cull_view.isCurrent(render_cam))
+		cull_view.setCamera(render_cam);
+	const Point p = cull_view.mapToScreen(map_pos.x, map_pos.y);
+	const int x = p.x + bounds.x;
+	const int y = p.y + bounds.y;
+
+	return x + bounds.w + RENDERABLE_CULL_MARGIN > 0 && x - RENDERABLE_CULL_MARGIN < VIEW_W
+		&& y + bounds.h + RENDERABLE_CULL_MARGIN > 0 && y - RENDERABLE_CULL_MARGIN < VIEW_H;
+}
+
+void MapRenderer::prepareCulling() {
+	const FPoint render_cam = getRenderCam();
+	if (!cull_view.isCurrent(render_cam))
+		cull_view.setCamera(render_cam);
+}
+
+FPoint MapRenderer::getRenderCam() {
+	return calcInterpolatedPos(prev_cam, cam);
+}
+
 MapRenderer::~MapRenderer() {
 	tip_buf.clear();
+	clearChunks();
 	clearLayers();
 	clearEvents();
 	clearQueues();
@@ -33,6 +33,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Map.h"
 #include "MapBackground.h"
 #include "MapCollision.h"
+#include "MapPreloader.h"
+#include "EntityGrid.h"
+#include "EntityRegistry.h"
+#include "EventGrid.h"
+#include "PickBuffer.h"
 #include "Settings.h"
 #include "TileSet.h"
 #include "Utils.h"
@@ -40,8 +45,91 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "TooltipData.h"
 
 class FileParser;
+class MemoryUsage;
 class WidgetTooltip;
 
+// size in pixels of a pre-rendered block of static map layers
+const int MAP_CHUNK_SIZE = 512;
+
+// the number of chunks that are kept around when they are not on screen
+const size_t MAP_CHUNK_CACHE_SIZE = 64;
+
+/**
+ * A pre-rendered block of the layers below the object layer.
+ * Chunks are aligned to a grid in map pixel space. Animated tiles are tracked
+ * so that the chunk can be redrawn when one of them changes frame.
+ */
+class Map_Chunk {
+public:
+	Sprite *sprite;
+	std::vector<unsigned> anim_tiles;
+	std::vector<unsigned short> anim_frames;
+	bool dirty;
+	unsigned last_visible;
+
+	Map_Chunk()
+		: sprite(NULL)
+		, dirty(true)
+		, last_visible(0) {
+	}
+};
+
+// renderables this many pixels off screen are still drawn, so that the shaky cam doesn't show them popping in
+const int RENDERABLE_CULL_MARGIN = 16;
+
+// the insertion sort of renderables falls back to std::sort after this many moves per renderable
+const size_t RENDERABLE_SORT_MOVES = 4;
+
+/**
+ * Sorts renderables by draw order through an array of (priority, index) keys,
+ * so that the renderables themselves are never moved.
+ * The order of the previous frame is the starting point for the next one.
+ * The screen positions and culling of all renderables are worked out in the same pass.
+ *
+ * For the object layer, bucket() is used instead: the renderables on screen are
+ * grouped by tile with a counting pass and only the few sharing a tile are sorted,
+ * so that the tile walk can draw each tile's renderables directly.
+ */
+class RenderableSorter {
+public:
+	void sort(std::vector<Renderable> &r, bool iso, const ScreenTransform& view);
+	void bucket(std::vector<Renderable> &r, bool iso, const ScreenTransform& view);
+
+	// the entries of sorted on tile (x, y) are [first, last); only valid after bucket()
+	void getBucket(int x, int y, size_t& first, size_t& last) const;
+
+	// r in draw order, valid until r changes
+	std::vector<Renderable*> sorted;
+
+	// for each entry of sorted: its tile, its draw position and whether it's on screen
+	std::vector<int> tile_x;
+	std::vector<int> tile_y;
+	std::vector<Point> dest;
+	std::vector<uint8_t> visible;
+
+private:
+	void gather(std::vector<Renderable> &r, const ScreenTransform& view);
+	void calculateKeys(std::vector<Renderable> &r, bool iso);
+	bool isVisible(const Renderable &ren, unsigned index) const;
+
+	// fills sorted and the arrays that go with it in the order of keys
+	void output(std::vector<Renderable> &r);
+
+	std::vector<std::pair<uint64_t, unsigned> > keys;
+
+	// in the order of r
+	std::vector<float> pos_x;
+	std::vector<float> pos_y;
+	std::vector<int> screen_x;
+	std::vector<int> screen_y;
+
+	// the tiles with a renderable on screen, and where each tile starts in sorted
+	Rect bucket_area;
+	std::vector<unsigned> bucket_start;
+	std::vector<unsigned> bucket_fill;
+	std::vector<std::pair<uint64_t, unsigned> > bucket_keys;
+};
+
 class MapRenderer : public Map {
 private:
 
@@ -50,26 +138,41 @@ private:
 	Point tip_pos;
 	bool show_tooltip;
 
-	bool enemyGroupPlaceEnemy(float x, float y, Map_Group &g);
+	// the parts of loading that don't depend on where the map came from
+	void beginLoad();
+	void endLoad();
+
+	void enemyGroupPlaceEnemy(float x, float y, Map_Group &g);
 	void pushEnemyGroup(Map_Group &g);
 
+	// the empty tiles of the enemy group being placed, reused between groups
+	std::vector<Point> group_free_tiles;
+
 	void clearQueues();
 
-	void drawRenderable(std::vector<Renderable>::iterator r_cursor);
+	void drawRenderable(const RenderableSorter &r, size_t index);
 
-	void renderIsoLayer(const Map_Layer& layerdata);
+	void renderIsoLayer(const Map_Layer& layerdata, const Point& extent);
+
+	// renders the layers below the object layer from cached chunks
+	void renderStaticLayers();
+	void buildChunk(Map_Chunk& chunk, const Point& chunk_pos);
+	void clearChunks();
 
 	// renders only objects
-	void renderIsoBackObjects(std::vector<Renderable> &r);
+	void renderIsoBackObjects(const RenderableSorter &r);
 
 	// renders interleaved objects and layer
-	void renderIsoFrontObjects(std::vector<Renderable> &r);
-	void renderIso(std::vector<Renderable> &r, std::vector<Renderable> &r_dead);
+	void renderIsoFrontObjects(const RenderableSorter &r);
+	void renderIso(const RenderableSorter &r, const RenderableSorter &r_dead);
+
+	void renderOrthoLayer(const Map_Layer& layerdata, const Point& extent);
+	void renderOrthoBackObjects(const RenderableSorter &r);
+	void renderOrthoFrontObjects(const RenderableSorter &r);
+	void renderOrtho(const RenderableSorter &r, const RenderableSorter &r_dead);
 
-	void renderOrthoLayer(const Map_Layer& layerdata);
-	void renderOrthoBackObjects(std::vector<Renderable> &r);
-	void renderOrthoFrontObjects(std::vector<Renderable> &r);
-	void renderOrtho(std::vector<Renderable> &r, std::vector<Renderable> &r_dead);
+	RenderableSorter sorter;
+	RenderableSorter sorter_dead;
 
 	void clearLayers();
 
@@ -78,8 +181,39 @@ private:
 	FPoint shakycam;
 	TileSet tset;
 
+	// oversize of the largest tile placed on each layer, in number of tiles, so that
+	// a few big props don't widen the scan of every other layer to tset.max_size_x/y
+	std::vector<Point> layer_extent;
+	void growLayerExtent(size_t layer, unsigned short tile);
+
+	// marks cached chunks as dirty after a tile was modified
+	void invalidateTile(size_t layer, int x, int y);
+
+	// map_to_screen() for shakycam, set up at the start of render()
+	ScreenTransform view;
+
+	// the same for the camera isOnScreen() checks against
+	ScreenTransform cull_view;
+
 	MapBackground map_background;
 
+	std::map<std::pair<int, int>, Map_Chunk> chunks;
+	unsigned chunk_frame;
+
+	// parses the destination of a nearby intermap event in the background
+	void checkPreload(const FPoint& loc);
+	MapPreloader preloader;
+
+	// parsed copies of the maps that were loaded recently
+	MapCache parsed_maps;
+	void cacheParsed(const std::string& fname);
+
+	// events near a position, so that the per-frame checks don't loop over all of them
+	void updateEventGrid();
+	std::vector<Event>::iterator eraseEvent(std::vector<Event>::iterator it);
+	EventGrid event_grid;
+	std::vector<unsigned> event_candidates;
+
 public:
 	// functions
 	MapRenderer();
@@ -88,8 +222,13 @@ public:
 	MapRenderer(const MapRenderer &copy); // not implemented
 
 	int load(const std::string& filename);
+
+	// parses the current map file again, and puts the hero back at pos once it is loaded
+	void reloadMap(const FPoint& pos);
+	void generate(const std::string& fname, const Point& size, int layer_count, unsigned seed);
 	void logic();
-	void render(std::vector<Renderable> &r, std::vector<Renderable> &r_dead);
+	// render_cam is the camera the renderables were collected for, usually getRenderCam()
+	void render(std::vector<Renderable> &r, std::vector<Renderable> &r_dead, const FPoint& render_cam);
 
 	void checkEvents(const FPoint& loc);
 	void checkHotspots();
@@ -106,10 +245,30 @@ public:
 	void activatePower(int power_index, unsigned statblock_index, FPoint &target);
 
 	bool isValidTile(const unsigned &tile);
+
+	// changes a tile after the map was loaded, e.g. by a mapmod event
+	void setTile(size_t layer, int x, int y, unsigned short tile);
+
+	// drops the prerendered chunks and background layers, so that they are drawn again as they are needed
+	void clearRenderCaches();
+
 	Point centerTile(const Point& p);
 
+	// returns false if r would be drawn entirely off screen, so that it can be left out of the render lists
+	bool isOnScreen(const Renderable& r);
+
+	// the same, for an area relative to map_pos, such as Animation::getBounds()
+	bool isOnScreen(const FPoint& map_pos, const Rect& bounds);
+
+	// sets up the camera of isOnScreen() ahead of time, so that the render jobs can call it at the same time
+	void prepareCulling();
+
+	// the camera that render() will use, between prev_cam and cam
+	FPoint getRenderCam();
+
 	// cam(x,y) is where on the map the camera is pointing
 	FPoint cam;
+	FPoint prev_cam; // cam at the start of the current logic frame
 
 	// indicates that the map was changed by an event, so the GameStatePlay
 	// will tell the mini map to update.
@@ -117,6 +276,15 @@ public:
 
 	MapCollision collider;
 
+	// broadphase for entity queries, filled by the EnemyManager
+	EntityGrid entity_grid;
+
+	// the fields of enemies and NPCs that the loops over all of them need, filled by their managers
+	EntityRegistry entity_registry;
+
+	// screen rectangles of the enemies in the render lists, used for cursor picking
+	PickBuffer pick_buffer;
+
 	// event-created loot or items
 	std::vector<Event_Component> loot;
 	Point loot_count;
@@ -158,6 +326,10 @@ public:
 	std::string show_book;
 
 	void loadMusic();
+	void preloadSounds();
+
+	// adds the layers, cached chunks, collision and events of the current map to usage
+	void getMemoryUsage(MemoryUsage& usage) const;
 
 	/**
 	 * The index of the layer, which mixes with the objects on screen. Layers
@@ -0,0 +1,63 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "MemoryUsage.h"
+
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+MemoryUsage::MemoryUsage(const std::string& _name)
+	: name(_name)
+	, count(0)
+	, bytes(0) {
+}
+
+void MemoryUsage::add(const std::string& resource, size_t size) {
+	count++;
+	bytes += size;
+	if (!resource.empty())
+		resources.push_back(std::pair<size_t, std::string>(size, resource));
+}
+
+void MemoryUsage::addTable(size_t entries, size_t size) {
+	count += entries;
+	bytes += size;
+}
+
+void MemoryUsage::getLargest(size_t _count, std::vector<std::pair<size_t, std::string> >& largest) const {
+	largest = resources;
+
+	size_t n = std::min(_count, largest.size());
+	std::partial_sort(largest.begin(), largest.begin() + n, largest.end(), std::greater<std::pair<size_t, std::string> >());
+	largest.resize(n);
+}
+
+std::string MemoryUsage::formatBytes(size_t size) {
+	std::stringstream ss;
+	ss.setf(std::ios::fixed);
+	ss.precision(1);
+
+	if (size >= 1024 * 1024)
+		ss << static_cast<float>(size) / (1024.f * 1024.f) << " MB";
+	else if (size >= 1024)
+		ss << static_cast<float>(size) / 1024.f << " KB";
+	else
+		ss << size << " B";
+
+	return ss.str();
+}
@@ -0,0 +1,57 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class MemoryUsage
+ *
+ * Sizes of one kind of resource, for the memory report of the developer console.
+ * The sizes are estimates of the data that each resource holds, without the
+ * overhead of the allocator or the containers.
+ */
+
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class MemoryUsage {
+public:
+	explicit MemoryUsage(const std::string& _name);
+
+	// counts one resource; only named resources are listed by getLargest()
+	void add(const std::string& resource, size_t size);
+
+	// counts a table of entries that aren't worth listing one by one
+	void addTable(size_t entries, size_t size);
+
+	// fills largest with up to count of the biggest resources, biggest first
+	void getLargest(size_t count, std::vector<std::pair<size_t, std::string> >& largest) const;
+
+	// e.g. "1.5 MB"
+	static std::string formatBytes(size_t size);
+
+	std::string name;
+	size_t count;
+	size_t bytes;
+
+private:
+	std::vector<std::pair<size_t, std::string> > resources;
+};
+
+#endif // MEMORY_USAGE_H
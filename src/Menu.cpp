@@ -33,14 +33,18 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 Menu::Menu()
 	: visible(false)
+	, retained(false)
 	, alignment(ALIGN_TOPLEFT)
 	, sfx_open(0)
 	, sfx_close(0)
-	, background(NULL) {
+	, background(NULL)
+	, cache(NULL)
+	, dirty(true) {
 }
 
 Menu::~Menu() {
 	if (background) delete background;
+	freeCache();
 }
 
 void Menu::setBackground(const std::string& background_image) {
@@ -70,7 +74,56 @@ void Menu::setBackgroundClip(Rect &clip) {
 
 void Menu::render() {
 	if (background)
-		render_device->render(background);
+		render_device->submit(background);
+}
+
+void Menu::renderCached(bool refresh) {
+	if (!visible) {
+		// hidden menus don't need to keep a screen-sized image around
+		freeCache();
+		return;
+	}
+
+	Image *graphics = cache ? cache->getGraphics() : NULL;
+	if (graphics && (graphics->getWidth() != VIEW_W || graphics->getHeight() != VIEW_H)) {
+		freeCache();
+		graphics = NULL;
+	}
+
+	if (!graphics) {
+		graphics = render_device->createImage(VIEW_W, VIEW_H);
+		if (!graphics) {
+			render();
+			return;
+		}
+		cache = graphics->createSprite();
+		graphics->unref();
+		dirty = true;
+	}
+
+	if (dirty || refresh) {
+		graphics->fillWithColor(Color(0,0,0,0));
+		render_device->setRenderTarget(graphics);
+		render();
+		render_device->setRenderTarget(NULL);
+		dirty = false;
+	}
+
+	cache->setClip(window_area);
+	cache->setDest(window_area);
+	render_device->submit(cache);
+}
+
+void Menu::setDirty() {
+	dirty = true;
+}
+
+void Menu::freeCache() {
+	if (cache) {
+		delete cache;
+		cache = NULL;
+	}
+	dirty = true;
 }
 
 /**
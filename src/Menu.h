@@ -42,7 +42,13 @@ public:
 	virtual void render();
 	virtual void setWindowPos(int x, int y);
 
+	/* Draws the menu from a cached copy, which is only redrawn with render() when it is dirty or refresh is true */
+	void renderCached(bool refresh);
+	void setDirty();
+	void freeCache();
+
 	bool visible;
+	bool retained; // if true, MenuManager draws this menu with renderCached()
 	Rect window_area;
 	ALIGNMENT alignment;
 
@@ -55,9 +61,16 @@ public:
 	virtual TabList* getCurrentTabList();
 	virtual void defocusTabLists();
 
+	// called when the menu opens, so that the icon sets it draws can be decoded in parallel
+	virtual void prefetchIcons() {}
+
 private:
 	Sprite *background;
 	Point window_area_base;
+
+	// screen-sized, so that render() can draw at the usual screen positions
+	Sprite *cache;
+	bool dirty;
 };
 
 #endif
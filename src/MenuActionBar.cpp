@@ -325,7 +325,7 @@ void MenuActionBar::render() {
 		else {
 			if (sprite_emptyslot) {
 				sprite_emptyslot->setDest(slots[i]->pos);
-				render_device->render(sprite_emptyslot);
+				render_device->submit(sprite_emptyslot);
 			}
 		}
 
@@ -343,7 +343,7 @@ void MenuActionBar::render() {
 			if (sprite_disabled && clip.h > 0) {
 				sprite_disabled->setClip(clip);
 				sprite_disabled->setDest(slots[i]->pos);
-				render_device->render(sprite_disabled);
+				render_device->submit(sprite_disabled);
 			}
 		}
 
@@ -359,7 +359,7 @@ void MenuActionBar::render() {
 
 			if (sprite_attention) {
 				sprite_attention->setDest(menus[i]->pos);
-				render_device->render(sprite_attention);
+				render_device->submit(sprite_attention);
 			}
 
 			// put an asterisk on this icon if in colorblind mode
@@ -417,7 +417,7 @@ TooltipData MenuActionBar::checkTooltip(const Point& mouse) {
 	for (unsigned i = 0; i < slots_count; i++) {
 		if (slots[i] && isWithinRect(slots[i]->pos, mouse)) {
 			if (hotkeys_mod[i] != 0) {
-				tip.addText(powers->powers[hotkeys_mod[i]].name);
+				tip.addText(powers->power_text[hotkeys_mod[i]].name);
 			}
 			tip.addText(labels[i]);
 		}
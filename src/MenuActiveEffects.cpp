@@ -185,7 +185,7 @@ void MenuActiveEffects::render() {
 		if (timer) {
 			timer->setClip(effect_icons[i].overlay);
 			timer->setDest(effect_icons[i].pos);
-			render_device->render(timer);
+			render_device->submit(timer);
 		}
 
 		if(effect_icons[i].stacksLabel){
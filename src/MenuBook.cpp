@@ -246,10 +246,10 @@ void MenuBook::render() {
 
 	closeButton->render();
 	for (unsigned i=0; i<text.size(); i++) {
-		render_device->render(text[i]);
+		render_device->submit(text[i]);
 	}
 	for (unsigned i=0; i<image.size(); i++) {
-		render_device->render(image[i]);
+		render_device->submit(image[i]);
 	}
 }
 
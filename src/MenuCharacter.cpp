@@ -35,6 +35,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "WidgetListBox.h"
 
 MenuCharacter::MenuCharacter(StatBlock *_stats) {
+	retained = true;
+
 	stats = _stats;
 
 	// 2 is added here to account for CSTAT_NAME and CSTAT_LEVEL
@@ -48,6 +50,7 @@ MenuCharacter::MenuCharacter(StatBlock *_stats) {
 	}
 
 	skill_points = 0;
+	shown_xp = 0;
 
 	visible = false;
 
@@ -228,6 +231,9 @@ MenuCharacter::MenuCharacter(StatBlock *_stats) {
 void MenuCharacter::align() {
 	Menu::align();
 
+	// labels are placed by refreshStats(), so the next one has to redo all of them
+	shown_values.clear();
+
 	// close button
 	closeButton->setPos(window_area.x, window_area.y);
 
@@ -270,6 +276,21 @@ void MenuCharacter::refreshStats() {
 
 	stats->refresh_stats = false;
 
+	// effects set refresh_stats whenever they are added or removed, which often changes nothing shown here
+	getShownValues(current_values);
+	const std::string long_class = stats->getLongClass();
+	if (current_values == shown_values && stats->xp == shown_xp && stats->name == shown_name && long_class == shown_class)
+		return;
+
+	const bool rebuild_list = (current_values.size() != shown_values.size());
+	const size_t stat_offset = 2 + PRIMARY_STATS.size() * 4;
+
+	shown_values.swap(current_values);
+	shown_xp = stats->xp;
+	shown_name = stats->name;
+	shown_class = long_class;
+	setDirty();
+
 	std::stringstream ss;
 
 	// update stat text
@@ -295,6 +316,12 @@ void MenuCharacter::refreshStats() {
 	for (unsigned i=0; i<STAT_COUNT; ++i) {
 		if (!show_stat[i]) continue;
 
+		// only the rows whose value changed are formatted again
+		if (!rebuild_list && shown_values[stat_offset + i] == current_values[stat_offset + i]) {
+			stat_index++;
+			continue;
+		}
+
 		ss.str("");
 		ss << STAT_NAME[i] << ": " << stats->get((STAT)i);
 		if (STAT_PERCENT[i]) ss << "%";
@@ -313,6 +340,9 @@ void MenuCharacter::refreshStats() {
 
 	if (show_resists) {
 		for (unsigned int j=0; j<stats->vulnerable.size(); ++j) {
+			if (!rebuild_list && shown_values[stat_offset + STAT_COUNT + j] == current_values[stat_offset + STAT_COUNT + j])
+				continue;
+
 			ss.str("");
 			ss << msg->get("%s Resistance", ELEMENTS[j].name.c_str()) << ": " << (100 - stats->vulnerable[j]) << "%";
 			statList->set(j+stat_index, ss.str(),"");
@@ -321,7 +351,7 @@ void MenuCharacter::refreshStats() {
 
 	// update tool tips
 	cstat[CSTAT_NAME].tip.clear();
-	cstat[CSTAT_NAME].tip.addText(stats->getLongClass());
+	cstat[CSTAT_NAME].tip.addText(long_class);
 
 	cstat[CSTAT_LEVEL].tip.clear();
 	cstat[CSTAT_LEVEL].tip.addText(msg->get("XP: %d", stats->xp));
@@ -347,6 +377,33 @@ void MenuCharacter::refreshStats() {
 }
 
 
+/**
+ * Everything refreshStats() displays, apart from xp and the strings
+ * The layout is: level, skill points, 4 values per primary stat, every stat, then the resistances.
+ */
+void MenuCharacter::getShownValues(std::vector<int>& values) {
+	values.clear();
+	values.push_back(stats->level);
+	values.push_back(skill_points);
+
+	for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
+		values.push_back(stats->get_primary(i));
+		values.push_back(stats->primary_additional[i]);
+		values.push_back(*(base_stats[i]));
+		values.push_back(*(base_stats_add[i]));
+	}
+
+	for (unsigned i=0; i<STAT_COUNT; ++i) {
+		values.push_back(stats->get(static_cast<STAT>(i)));
+	}
+
+	if (show_resists) {
+		for (size_t j=0; j<stats->vulnerable.size(); ++j) {
+			values.push_back(stats->vulnerable[j]);
+		}
+	}
+}
+
 /**
  * Color-coding for positive/negative/no bonus
  */
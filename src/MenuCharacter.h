@@ -86,6 +86,14 @@ private:
 	std::vector<int*> base_stats_add;
 	std::vector< std::vector<int>* > base_bonus;
 
+	// the values shown by the last refreshStats(), so that it can skip the parts that didn't change
+	void getShownValues(std::vector<int>& values);
+	std::vector<int> shown_values;
+	std::vector<int> current_values;
+	unsigned long shown_xp;
+	std::string shown_name;
+	std::string shown_class;
+
 public:
 	explicit MenuCharacter(StatBlock *stats);
 	~MenuCharacter();
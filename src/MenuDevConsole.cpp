@@ -19,15 +19,21 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  * class MenuDevConsole
  */
 
+#include "AllocTracker.h"
+#include "EnemyGroupManager.h"
 #include "EnemyManager.h"
 #include "FileParser.h"
+#include "MemoryUsage.h"
 #include "MenuDevConsole.h"
+#include "Profiler.h"
 #include "SharedGameResources.h"
 #include "SharedResources.h"
 #include "Settings.h"
 #include "UtilsFileSystem.h"
 #include "UtilsParsing.h"
+#include "VisualQuality.h"
 
+#include <ctime>
 #include <limits>
 
 MenuDevConsole::MenuDevConsole()
@@ -224,6 +230,18 @@ void MenuDevConsole::execute() {
 	if (args[0] == "help") {
 		log_history->add("toggle_hud - " + msg->get("turns on/off all of the HUD elements"), false);
 		log_history->add("toggle_devhud - " + msg->get("turns on/off the developer hud"), false);
+		log_history->add("toggle_profiler - " + msg->get("turns on/off the frame profiler"), false);
+		log_history->add("mem_report - " + msg->get("prints the memory used by each kind of resource, along with the largest ones. The number of resources listed can be given as an argument"), false);
+		log_history->add("profile_start - " + msg->get("starts recording a trace of the frame profiler zones"), false);
+		log_history->add("profile_stop - " + msg->get("stops recording the trace and saves it to the configuration directory"), false);
+		log_history->add("profile_stats - " + msg->get("prints the frame time percentiles, and the average and peak time of each profiler zone while the profiler is on"), false);
+		log_history->add("alloc_backtrace - " + msg->get("turns on/off logging a backtrace when the game logic or map drawing allocates memory. Needs a build with ALLOC_TRACKING"), false);
+		log_history->add("toggle - " + msg->get("turns off/on a subsystem to see what it costs: ai, hazards, loot, sound, layers (the map layers apart from the object layer) or menus"), false);
+		log_history->add("ai_lod - " + msg->get("sets the distances at which enemy AI is throttled and put to sleep, and how often throttled enemies think"), false);
+		log_history->add("render_scale - " + msg->get("sets the resolution scale the world is drawn at, or 'auto' to let it follow the frame time"), false);
+		log_history->add("visual_quality - " + msg->get("turns on/off lowering the visual detail while frames take too long, and prints the current level"), false);
+		log_history->add("frame_cap - " + msg->get("sets the maximum number of frames drawn per second"), false);
+		log_history->add("stress_scene - " + msg->get("runs a timed scene on a generated map and reports the frame times. Takes size, layers, enemy (a category), enemies, power, hazards (per second), loot, time and seed as <key>=<val> arguments"), false);
 		log_history->add("respec - " + msg->get("resets the player to level 1, with no stat or skill points spent"), false);
 		log_history->add("list_maps - " + msg->get("Prints out all the map filenames located in the \"maps/\" directory."), false);
 		log_history->add("list_status - " + msg->get("Prints out the active campaign statuses that match a search term. No search term will list all active statuses"), false);
@@ -239,6 +257,232 @@ void MenuDevConsole::execute() {
 		DEV_HUD = !DEV_HUD;
 		log_history->add(msg->get("Toggled the developer hud"), false);
 	}
+	else if (args[0] == "toggle_profiler") {
+		setProfilerEnabled(!isProfilerEnabled());
+		log_history->add(msg->get("Toggled the frame profiler"), false);
+	}
+	else if (args[0] == "mem_report") {
+		size_t count = 5;
+		if (args.size() > 1)
+			count = static_cast<size_t>(std::max(toInt(args[1]), 0));
+
+		std::vector<MemoryUsage> usages;
+		usages.push_back(MemoryUsage(msg->get("Images")));
+		render_device->getMemoryUsage(usages.back());
+		usages.push_back(MemoryUsage(msg->get("Animations")));
+		anim->getMemoryUsage(usages.back());
+		usages.push_back(MemoryUsage(msg->get("Sounds")));
+		snd->getMemoryUsage(usages.back());
+		usages.push_back(MemoryUsage(msg->get("Powers")));
+		powers->getMemoryUsage(usages.back());
+		usages.push_back(MemoryUsage(msg->get("Items")));
+		items->getMemoryUsage(usages.back());
+		usages.push_back(MemoryUsage(msg->get("Map")));
+		mapr->getMemoryUsage(usages.back());
+
+		std::vector<std::string> lines;
+		std::stringstream ss;
+		size_t total = 0;
+
+		for (size_t i = 0; i < usages.size(); ++i) {
+			total += usages[i].bytes;
+
+			ss.str("");
+			ss << usages[i].name << ": " << MemoryUsage::formatBytes(usages[i].bytes) << " (" << usages[i].count << ")";
+			lines.push_back(ss.str());
+
+			std::vector<std::pair<size_t, std::string> > largest;
+			usages[i].getLargest(count, largest);
+			for (size_t j = 0; j < largest.size(); ++j) {
+				lines.push_back("    " + MemoryUsage::formatBytes(largest[j].first) + " " + largest[j].second);
+			}
+		}
+		lines.push_back(msg->get("Total: ") + MemoryUsage::formatBytes(total));
+
+		printLines(lines);
+	}
+	else if (args[0] == "profile_stats") {
+		std::vector<std::string> lines;
+		std::stringstream ss;
+		ss.setf(std::ios::fixed);
+		ss.precision(2);
+
+		if (isProfilerEnabled()) {
+			for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+				PROFILE_ZONE zone = static_cast<PROFILE_ZONE>(i);
+				ss.str("");
+				ss << std::string(getProfileZoneDepth(zone) * 2, ' ') << getProfileZoneName(zone) << ": " << getProfileAverage(zone) << " ms (" << msg->get("peak") << " " << getProfilePeak(zone) << " ms)";
+				lines.push_back(ss.str());
+			}
+			ss.str("");
+			ss << msg->get("Frame: ") << getProfileFrameAverage() << " ms";
+			lines.push_back(ss.str());
+		}
+		ss.str("");
+		ss << msg->get("Frame times: ") << "p50 " << getFrameTimePercentile(50) << " ms, p99 " << getFrameTimePercentile(99) << " ms, " << msg->get("max") << " " << getFrameTimeMax() << " ms";
+		lines.push_back(ss.str());
+
+		printLines(lines);
+		if (!isProfilerEnabled())
+			log_history->add(msg->get("HINT: Type toggle_profiler to also list the time taken by each zone"), false, &color_hint);
+	}
+	else if (args[0] == "toggle") {
+		bool *flag = NULL;
+		if (args.size() > 1) {
+			if (args[1] == "ai") flag = &DEV_SKIP_AI;
+			else if (args[1] == "hazards") flag = &DEV_SKIP_HAZARDS;
+			else if (args[1] == "loot") flag = &DEV_SKIP_LOOT;
+			else if (args[1] == "sound") flag = &DEV_SKIP_SOUND;
+			else if (args[1] == "layers") flag = &DEV_SKIP_LAYERS;
+		}
+
+		if (args.size() > 1 && args[1] == "menus") {
+			SHOW_HUD = !SHOW_HUD;
+			log_history->add(msg->get("Toggled the hud"), false);
+		}
+		else if (!flag) {
+			if (args.size() > 1)
+				log_history->add(msg->get("ERROR: '%s' is not a subsystem", args[1].c_str()), false, &color_error);
+			log_history->add(msg->get("HINT: ") + args[0] + msg->get(" <ai|hazards|loot|sound|layers|menus>"), false, &color_hint);
+		}
+		else {
+			*flag = !(*flag);
+			if (*flag)
+				log_history->add(msg->get("Turned off '%s'", args[1].c_str()), false);
+			else
+				log_history->add(msg->get("Turned on '%s'", args[1].c_str()), false);
+		}
+	}
+	else if (args[0] == "ai_lod") {
+		if (args.size() > 1)
+			AI_THROTTLE_DISTANCE = toFloat(args[1]);
+		if (args.size() > 2)
+			AI_SLEEP_DISTANCE = toFloat(args[2]);
+		if (args.size() > 3)
+			AI_THROTTLE_INTERVAL = std::max(toInt(args[3]), 1);
+
+		std::stringstream ss;
+		ss << msg->get("AI throttle distance: ") << AI_THROTTLE_DISTANCE << ", " << msg->get("sleep distance: ") << AI_SLEEP_DISTANCE << ", " << msg->get("throttle interval: ") << AI_THROTTLE_INTERVAL;
+		log_history->add(ss.str(), false);
+		if (args.size() == 1)
+			log_history->add(msg->get("HINT: ") + args[0] + msg->get(" <throttle distance> <sleep distance> <interval>. A distance of 0 turns that level off"), false, &color_hint);
+	}
+	else if (args[0] == "render_scale") {
+		if (args.size() > 1) {
+			if (args[1] == "auto") {
+				DYNAMIC_RENDER_SCALE = true;
+			}
+			else {
+				RENDER_SCALE = std::max(0.f, std::min(toFloat(args[1]), 1.f));
+				DYNAMIC_RENDER_SCALE = false;
+			}
+		}
+
+		std::stringstream ss;
+		ss << msg->get("Render scale: ") << RENDER_SCALE << (DYNAMIC_RENDER_SCALE ? msg->get(" (dynamic)") : "") << ", " << msg->get("currently drawn at ") << render_device->getWorldScale();
+		log_history->add(ss.str(), false);
+		if (args.size() == 1)
+			log_history->add(msg->get("HINT: ") + args[0] + msg->get(" <0-1|auto>"), false, &color_hint);
+	}
+	else if (args[0] == "visual_quality") {
+		if (args.size() > 1)
+			DYNAMIC_VISUAL_QUALITY = toBool(args[1]);
+
+		std::stringstream ss;
+		ss << msg->get("Visual quality: ") << (DYNAMIC_VISUAL_QUALITY ? msg->get("dynamic") : msg->get("full")) << ", " << msg->get("currently at level ") << getVisualQuality();
+		log_history->add(ss.str(), false);
+		if (args.size() == 1)
+			log_history->add(msg->get("HINT: ") + args[0] + msg->get(" <0|1>"), false, &color_hint);
+	}
+	else if (args[0] == "frame_cap") {
+		if (args.size() > 1)
+			MAX_RENDER_FPS = static_cast<unsigned short>(std::max(0, std::min(toInt(args[1]), static_cast<int>(std::numeric_limits<unsigned short>::max()))));
+
+		if (MAX_RENDER_FPS > MAX_FRAMES_PER_SEC)
+			log_history->add(msg->get("Drawing up to %d frames per second", MAX_RENDER_FPS), false);
+		else
+			log_history->add(msg->get("Drawing once per logic frame, %d frames per second", MAX_FRAMES_PER_SEC), false);
+		if (args.size() == 1)
+			log_history->add(msg->get("HINT: ") + args[0] + msg->get(" <fps>. 0 draws once per logic frame"), false, &color_hint);
+	}
+	else if (args[0] == "profile_start") {
+		startProfileCapture();
+		log_history->add(msg->get("Started recording a profiler trace"), false);
+	}
+	else if (args[0] == "profile_stop") {
+		if (!isProfileCapturing()) {
+			log_history->add(msg->get("ERROR: A profiler trace is not being recorded"), false, &color_error);
+			log_history->add(msg->get("HINT: Type profile_start"), false, &color_hint);
+		}
+		else {
+			char timestamp[32];
+			time_t now = time(NULL);
+			strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&now));
+			std::string filename = PATH_CONF + "trace-" + timestamp + ".json";
+
+			if (stopProfileCapture(filename))
+				log_history->add(msg->get("Saved the profiler trace to %s", filename.c_str()), false);
+			else
+				log_history->add(msg->get("ERROR: Could not write '%s'", filename.c_str()), false, &color_error);
+		}
+	}
+	else if (args[0] == "alloc_backtrace") {
+		if (!isAllocTrackingBuilt()) {
+			log_history->add(msg->get("ERROR: This build does not track allocations"), false, &color_error);
+			log_history->add(msg->get("HINT: Build with -DALLOC_TRACKING=ON"), false, &color_hint);
+		}
+		else {
+			setAllocBacktraces(!isAllocBacktraces());
+			if (isAllocBacktraces())
+				log_history->add(msg->get("Logging a backtrace for allocations in the game logic and map drawing"), false);
+			else
+				log_history->add(msg->get("Stopped logging allocation backtraces"), false);
+		}
+	}
+	else if (args[0] == "stress_scene") {
+		StressSceneConfig config;
+		bool valid = true;
+
+		for (size_t i = 1; i < args.size(); ++i) {
+			std::string key = popFirstString(args[i], '=');
+			std::string val = args[i];
+
+			if (key == "size") config.size = toInt(val);
+			else if (key == "layers") config.layers = toInt(val);
+			else if (key == "enemy") config.enemy_category = val;
+			else if (key == "enemies") config.enemy_count = toInt(val);
+			else if (key == "power") config.power_id = toInt(val);
+			else if (key == "hazards") config.hazards_per_second = toInt(val);
+			else if (key == "loot") config.loot_count = toInt(val);
+			else if (key == "time") config.seconds = toInt(val);
+			else if (key == "seed") config.seed = static_cast<unsigned>(toInt(val));
+			else {
+				log_history->add(msg->get("ERROR: '%s' is not a valid key", key.c_str()), false, &color_error);
+				valid = false;
+			}
+		}
+
+		if (config.enemy_count > 0 && enemyg->getEnemiesInCategory(config.enemy_category).empty()) {
+			log_history->add(msg->get("ERROR: '%s' is not a valid enemy category", config.enemy_category.c_str()), false, &color_error);
+			valid = false;
+		}
+		if (config.hazards_per_second > 0 && (config.power_id <= 0 || static_cast<size_t>(config.power_id) >= powers->powers.size())) {
+			log_history->add(msg->get("ERROR: '%d' is not a valid power id", config.power_id), false, &color_error);
+			valid = false;
+		}
+
+		if (!valid) {
+			log_history->add(msg->get("HINT: ") + args[0] + msg->get(" size=128 layers=2 enemy=<category> enemies=100 power=<id> hazards=10 loot=50 time=30"), false, &color_hint);
+		}
+		else if (!stress->start(config)) {
+			log_history->add(msg->get("ERROR: A stress scene is already running"), false, &color_error);
+		}
+		else {
+			log_history->add(msg->get("Started the stress scene, the results will be shown in the log"), false);
+			visible = false;
+			reset();
+		}
+	}
 	else if (args[0] == "toggle_hud") {
 		SHOW_HUD = !SHOW_HUD;
 		log_history->add(msg->get("Toggled the hud"), false);
@@ -271,7 +515,7 @@ void MenuDevConsole::execute() {
 		std::vector<size_t> matching_ids;
 
 		for (size_t i=0; i<camp->status.size(); ++i) {
-			if (!search_terms.empty() && stringFindCaseInsensitive(camp->status[i], search_terms) == std::string::npos)
+			if (!search_terms.empty() && stringFindCaseInsensitive(getInternedString(camp->status[i]), search_terms) == std::string::npos)
 				continue;
 
 			matching_ids.push_back(i);
@@ -281,7 +525,7 @@ void MenuDevConsole::execute() {
 			log_history->setMaxMessages(static_cast<unsigned>(matching_ids.size()));
 
 			for (size_t i=matching_ids.size(); i>0; i--) {
-				log_history->add(camp->status[matching_ids[i-1]]);
+				log_history->add(getInternedString(camp->status[matching_ids[i-1]]));
 			}
 
 			log_history->setMaxMessages(); // reset
@@ -393,3 +637,15 @@ void MenuDevConsole::execute() {
 		log_history->add(msg->get("HINT: Type help"), false, &color_hint);
 	}
 }
+
+void MenuDevConsole::printLines(const std::vector<std::string>& lines) {
+	log_history->setMaxMessages(static_cast<unsigned>(lines.size()));
+	for (size_t i = lines.size(); i > 0; i--) {
+		log_history->add(lines[i-1], false);
+	}
+	log_history->setMaxMessages(); // reset
+
+	for (size_t i = 0; i < lines.size(); ++i) {
+		logInfo("MenuDevConsole: %s", lines[i].c_str());
+	}
+}
@@ -34,6 +34,9 @@ protected:
 	void loadGraphics();
 	void execute();
 
+	// adds lines to the history in reading order, and to the log so that they can be attached to bug reports
+	void printLines(const std::vector<std::string>& lines);
+
 	WidgetButton *button_close;
 	WidgetButton *button_confirm;
 	WidgetInput *input_box;
@@ -19,6 +19,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  * class MenuDevHUD
  */
 
+#include "AllocTracker.h"
 #include "FileParser.h"
 #include "MenuDevHUD.h"
 #include "SharedGameResources.h"
@@ -27,7 +28,14 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsMath.h"
 #include "UtilsParsing.h"
 
-MenuDevHUD::MenuDevHUD() : Menu() {
+MenuDevHUD::MenuDevHUD()
+	: Menu()
+	, profile_bar(NULL)
+	, profile_ticks(0) {
+
+	for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+		profile_bar_w[i] = 0;
+	}
 
 	// Load config settings
 	FileParser infile;
@@ -75,10 +83,89 @@ void MenuDevHUD::align() {
 	Menu::align();
 }
 
+void MenuDevHUD::alignProfiler() {
+	std::stringstream ss;
+	int line_height = font->getLineHeight();
+	int indent = line_height;
+
+	// the zones are listed under the rest of the hud
+	int x = original_area.x;
+	int y = original_area.y;
+	if (visible)
+		y = window_area.y + window_area.h;
+
+	ss.str("");
+	ss.precision(2);
+	ss << std::fixed << msg->get("Frame: ") << getProfileFrameAverage() << " ms";
+	ss << " (p50 " << getFrameTimePercentile(50) << ", p95 " << getFrameTimePercentile(95);
+	ss << ", p99 " << getFrameTimePercentile(99) << ", max " << getFrameTimeMax() << ")";
+	if (isAllocTrackingBuilt()) {
+		ss << msg->get(", allocs: ") << getAllocAverage(ALLOC_ZONE_FRAME) << " / " << getAllocPeak(ALLOC_ZONE_FRAME);
+		ss << msg->get(", frees: ") << getFreeAverage() << msg->get(", other threads: ") << getOtherThreadAllocs();
+	}
+	profile_frame.set(x, y, JUSTIFY_LEFT, VALIGN_TOP, ss.str(), font->getColor("menu_normal"));
+
+	const float frame_budget = 1000.f / static_cast<float>(std::max(MAX_FRAMES_PER_SEC, MAX_RENDER_FPS));
+	int text_right = profile_frame.bounds.x + profile_frame.bounds.w;
+
+	for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+		PROFILE_ZONE zone = static_cast<PROFILE_ZONE>(i);
+		float average = getProfileAverage(zone);
+
+		ss.str("");
+		ss << getProfileZoneName(zone) << ": " << average << " / " << getProfilePeak(zone) << " ms";
+		if (isAllocTrackingBuilt())
+			ss << ", " << getAllocAverage(i) << " / " << getAllocPeak(i) << msg->get(" allocs");
+		profile_labels[i].set(x + getProfileZoneDepth(zone) * indent, y + line_height * (i+1), JUSTIFY_LEFT, VALIGN_TOP, ss.str(), font->getColor("menu_normal"));
+		text_right = std::max(text_right, profile_labels[i].bounds.x + profile_labels[i].bounds.w);
+
+		profile_bar_w[i] = std::min(static_cast<int>(average / frame_budget * static_cast<float>(PROFILE_BAR_WIDTH)), PROFILE_BAR_WIDTH);
+	}
+
+	profile_bar_pos.x = text_right + line_height/2;
+	profile_bar_pos.y = y + line_height;
+
+	if (!profile_bar) {
+		Image *graphics = render_device->createImage(PROFILE_BAR_WIDTH, std::max(line_height - 2, 1));
+		if (graphics) {
+			graphics->fillWithColor(Color(255, 160, 0, 192));
+			profile_bar = graphics->createSprite();
+			graphics->unref();
+		}
+	}
+}
+
 void MenuDevHUD::logic() {
 	if (visible) {
 		align();
 	}
+
+	if (isProfilerEnabled()) {
+		if (profile_ticks == 0)
+			alignProfiler();
+		profile_ticks = (profile_ticks + 1) % PROFILE_REFRESH_FRAMES;
+	}
+	else {
+		profile_ticks = 0;
+	}
+}
+
+void MenuDevHUD::renderProfiler() {
+	profile_frame.render();
+
+	int line_height = font->getLineHeight();
+	int indent = line_height;
+
+	for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+		profile_labels[i].render();
+
+		if (profile_bar && profile_bar_w[i] > 0) {
+			PROFILE_ZONE zone = static_cast<PROFILE_ZONE>(i);
+			profile_bar->setClip(0, 0, profile_bar_w[i], profile_bar->getGraphicsHeight());
+			profile_bar->setDest(profile_bar_pos.x + getProfileZoneDepth(zone) * indent, profile_bar_pos.y + line_height * i + 1);
+			render_device->submit(profile_bar);
+		}
+	}
 }
 
 void MenuDevHUD::render() {
@@ -90,8 +177,13 @@ void MenuDevHUD::render() {
 		mouse_pos.render();
 		target_pos.render();
 	}
+
+	if (isProfilerEnabled()) {
+		renderProfiler();
+	}
 }
 
 MenuDevHUD::~MenuDevHUD() {
+	delete profile_bar;
 }
 
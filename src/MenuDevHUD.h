@@ -24,8 +24,15 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "CommonIncludes.h"
 #include "Menu.h"
+#include "Profiler.h"
 #include "WidgetLabel.h"
 
+// width of a profiler bar that takes up the whole frame budget
+const int PROFILE_BAR_WIDTH = 100;
+
+// the profiler text is refreshed every this many logic frames
+const int PROFILE_REFRESH_FRAMES = 30;
+
 class MenuDevHUD : public Menu {
 protected:
 	void loadGraphics();
@@ -35,6 +42,16 @@ protected:
 	WidgetLabel mouse_pos;
 	WidgetLabel target_pos;
 
+	void alignProfiler();
+	void renderProfiler();
+
+	WidgetLabel profile_frame;
+	WidgetLabel profile_labels[PROFILE_MAIN_ZONE_COUNT];
+	int profile_bar_w[PROFILE_MAIN_ZONE_COUNT];
+	Point profile_bar_pos;
+	Sprite *profile_bar;
+	int profile_ticks;
+
 public:
 	MenuDevHUD();
 	~MenuDevHUD();
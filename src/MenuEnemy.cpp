@@ -126,7 +126,7 @@ void MenuEnemy::render() {
 		src.h = bar_pos.h;
 		bar_hp->setClip(src);
 		bar_hp->setDest(dest);
-		render_device->render(bar_hp);
+		render_device->submit(bar_hp);
 	}
 
 	std::stringstream ss;
@@ -116,7 +116,7 @@ void MenuHUDLog::render() {
 		if (msg_age[i-1] > 0 && dest.y > 64 && msg_buffer[i-1]) {
 			dest.y -= msg_buffer[i-1]->getGraphicsHeight() + paragraph_spacing;
 			msg_buffer[i-1]->setDest(dest);
-			render_device->render(msg_buffer[i-1]);
+			render_device->submit(msg_buffer[i-1]);
 		}
 		else return; // no more new messages
 	}
@@ -157,14 +157,14 @@ void MenuHUDLog::renderOverlay() {
 		}
 	}
 
-	render_device->render(overlay_bg);
+	render_device->submit(overlay_bg);
 
 	Rect dest;
 	dest.x = window_area.x + paragraph_spacing;
 	dest.y = window_area.y + window_area.h - msg_height + paragraph_spacing;
 
 	msg_buffer.back()->setDest(dest);
-	render_device->render(msg_buffer.back());
+	render_device->submit(msg_buffer.back());
 }
 
 
@@ -176,6 +176,10 @@ void MenuHUDLog::add(const std::string& s, bool prevent_spam) {
 
 	// Make sure we don't spam the same message repeatedly
 	if (log_msg.empty() || log_msg.back() != s || !prevent_spam) {
+		while (log_msg.size() >= MENU_HUD_LOG_MAX_MESSAGES) {
+			remove(0);
+		}
+
 		// add new message
 		log_msg.push_back(substituteVarsInString(s, pc));
 		msg_age.push_back(calcDuration(log_msg.back()));
@@ -27,6 +27,9 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "CommonIncludes.h"
 #include "Utils.h"
 
+// older messages are dropped, even if they haven't faded yet
+const unsigned MENU_HUD_LOG_MAX_MESSAGES = 50;
+
 class MenuHUDLog : public Menu {
 private:
 
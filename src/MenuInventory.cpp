@@ -25,9 +25,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  */
 
 #include "CommonIncludes.h"
+#include "EnemyManager.h"
 #include "FileParser.h"
 #include "Menu.h"
 #include "MenuInventory.h"
+#include "Random.h"
 #include "Settings.h"
 #include "SharedGameResources.h"
 #include "SharedResources.h"
@@ -49,6 +51,7 @@ MenuInventory::MenuInventory(StatBlock *_stats)
 	, show_book("")
 {
 	visible = false;
+	retained = true;
 
 	setBackground("images/menus/inventory.png");
 
@@ -78,6 +81,7 @@ MenuInventory::MenuInventory(StatBlock *_stats)
 				equipped_area.push_back(area);
 				equipped_pos.push_back(pos);
 				slot_type.push_back(popFirstString(infile.val));
+				slot_type_ids.push_back(internString(slot_type.back()));
 			}
 			// @ATTR carried_area|point|Position of the first normal inventory slot.
 			else if(infile.key == "carried_area") {
@@ -188,7 +192,7 @@ void MenuInventory::logic() {
 				}
 			}
 			if (!removable_items.empty()) {
-				size_t random_item = static_cast<size_t>(rand()) % removable_items.size();
+				size_t random_item = randIndex(removable_items.size());
 				remove(removable_items[random_item]);
 				death_message += msg->get("Lost %s.",items->getItemName(removable_items[random_item]));
 			}
@@ -241,6 +245,11 @@ void MenuInventory::render() {
 	inventory[CARRIED].render();
 }
 
+void MenuInventory::prefetchIcons() {
+	inventory[EQUIPMENT].prefetchIcons();
+	inventory[CARRIED].prefetchIcons();
+}
+
 int MenuInventory::areaOver(const Point& position) {
 	if (isWithinRect(carried_area, position)) {
 		return CARRIED;
@@ -396,7 +405,7 @@ bool MenuInventory::drop(const Point& position, ItemStack stack) {
 		// make sure the item is going to the correct slot
 		// we match slot_type to stack.item's type to place items in the proper slots
 		// also check to see if the hero meets the requirements
-		if (slot_type[slot] == items->items[stack.item].type && items->requirementsMet(stats, stack.item) && stats->humanoid && inventory[EQUIPMENT].slots[slot]->enabled) {
+		if (slot_type_ids[slot] == items->items[stack.item].type_id && items->requirementsMet(stats, stack.item) && stats->humanoid && inventory[EQUIPMENT].slots[slot]->enabled) {
 			if (inventory[area][slot].item == stack.item) {
 				// Merge the stacks
 				success = add(stack, area, slot, false, false);
@@ -468,7 +477,7 @@ bool MenuInventory::drop(const Point& position, ItemStack stack) {
 			else if(
 				inventory[EQUIPMENT][drag_prev_slot].empty()
 				&& inventory[CARRIED][slot].item != stack.item
-				&& items->items[inventory[CARRIED][slot].item].type == slot_type[drag_prev_slot]
+				&& items->items[inventory[CARRIED][slot].item].type_id == slot_type_ids[drag_prev_slot]
 				&& items->requirementsMet(stats, inventory[CARRIED][slot].item)
 			) { // The whole equipped stack is dropped on an empty carried slot or on a wearable item
 				// Swap the two stacks
@@ -519,7 +528,7 @@ void MenuInventory::activate(const Point& position) {
 	}
 	// use a consumable item
 	else if (!items->items[inventory[CARRIED][slot].item].quest_item &&
-             items->items[inventory[CARRIED][slot].item].type == "consumable" &&
+             items->items[inventory[CARRIED][slot].item].type_id == ITEM_TYPE_CONSUMABLE &&
 	         items->items[inventory[CARRIED][slot].item].power > 0) {
 
 		int power_id = items->items[inventory[CARRIED][slot].item].power;
@@ -561,7 +570,7 @@ void MenuInventory::activate(const Point& position) {
 
 	}
 	// equip an item
-	else if (stats->humanoid && items->items[inventory[CARRIED][slot].item].type != "") {
+	else if (stats->humanoid && items->items[inventory[CARRIED][slot].item].type_id != 0) {
 		int equip_slot = getEquipSlotFromItem(inventory[CARRIED].storage[slot].item, false);
 
 		if (equip_slot >= 0) {
@@ -614,6 +623,8 @@ bool MenuInventory::add(ItemStack stack, int area, int slot, bool play_sound, bo
 	if (stack.empty())
 		return true;
 
+	setDirty();
+
 	bool success = true;
 
 	if (play_sound)
@@ -668,7 +679,7 @@ bool MenuInventory::add(ItemStack stack, int area, int slot, bool play_sound, bo
 	}
 
 	// if this item has a power, place it on the action bar if possible
-	if (success && items->items[stack.item].type == "consumable" && items->items[stack.item].power > 0) {
+	if (success && items->items[stack.item].type_id == ITEM_TYPE_CONSUMABLE && items->items[stack.item].power > 0) {
 		menu_act->addPower(items->items[stack.item].power, 0);
 	}
 
@@ -681,6 +692,8 @@ bool MenuInventory::add(ItemStack stack, int area, int slot, bool play_sound, bo
  * Remove one given item from the player's inventory.
  */
 bool MenuInventory::remove(int item) {
+	setDirty();
+
 	if(!inventory[CARRIED].remove(item)) {
 		if (!inventory[EQUIPMENT].remove(item)) {
 			return false;
@@ -720,6 +733,7 @@ void MenuInventory::addCurrency(int count) {
  * Remove currency item
  */
 void MenuInventory::removeCurrency(int count) {
+	setDirty();
 	inventory[CARRIED].remove(CURRENCY_ID, count);
 }
 
@@ -807,6 +821,8 @@ void MenuInventory::applyEquipment() {
 	if (items->items.empty())
 		return;
 
+	setDirty();
+
 	int item_id;
 
 	// calculate bonuses to basic stats, added by items
@@ -866,6 +882,7 @@ void MenuInventory::applyEquipment() {
 			if (!items->requirementsMet(stats, inventory[EQUIPMENT].storage[i].item)) {
 				add(inventory[EQUIPMENT].storage[i], CARRIED, -1, true, false);
 				inventory[EQUIPMENT].storage[i].clear();
+				inventory[EQUIPMENT].setChanged();
 				checkRequired = true;
 			}
 		}
@@ -882,6 +899,7 @@ void MenuInventory::applyEquipment() {
 
 	// reset wielding vars
 	stats->equip_flags.clear();
+	stats->clearPowerRequirements();
 
 	// remove all effects and bonuses added by items
 	stats->effects.clearItemEffects();
@@ -897,11 +915,12 @@ void MenuInventory::applyEquipment() {
 	// disable any incompatible slots, unequipping items if neccessary
 	for (int i=0; i<MAX_EQUIPPED; ++i) {
 		int id = inventory[EQUIPMENT][i].item;
-		for (unsigned j=0; j<items->items[id].disable_slots.size(); ++j) {
+		for (unsigned j=0; j<items->items[id].disable_slot_ids.size(); ++j) {
 			for (int k=0; k<MAX_EQUIPPED; ++k) {
-				if (slot_type[k] == items->items[id].disable_slots[j]) {
+				if (slot_type_ids[k] == items->items[id].disable_slot_ids[j]) {
 					add(inventory[EQUIPMENT].storage[k], CARRIED, -1, true, false);
 					inventory[EQUIPMENT].storage[k].clear();
+					inventory[EQUIPMENT].setChanged();
 					inventory[EQUIPMENT].slots[k]->enabled = false;
 				}
 			}
@@ -953,6 +972,8 @@ void MenuInventory::applyItemStats() {
 		// add item powers
 		if (item.power > 0) {
 			stats->powers_list_items.push_back(item.power);
+			if (enemies)
+				enemies->loadPowerCreatures(item.power);
 			if (stats->effects.triggered_others)
 				powers->activateSinglePassive(stats,item.power);
 		}
@@ -1038,6 +1059,7 @@ void MenuInventory::fillEquipmentSlots() {
 	for (int i=0; i<slot_number; i++) {
 		inventory[EQUIPMENT].storage[i].clear();
 	}
+	inventory[EQUIPMENT].setChanged();
 
 	// fill slots with items
 	for (int i=0; i<slot_number; i++) {
@@ -1045,7 +1067,7 @@ void MenuInventory::fillEquipmentSlots() {
 		for (int j=0; j<slot_number; j++) {
 			// search for empty slot with needed type. If item is not NULL, put it there
 			if (equip_item[i] > 0 && inventory[EQUIPMENT].storage[j].empty()) {
-				if (items->items[equip_item[i]].type == slot_type[j]) {
+				if (items->items[equip_item[i]].type_id == slot_type_ids[j]) {
 					inventory[EQUIPMENT].storage[j].item = equip_item[i];
 					inventory[EQUIPMENT].storage[j].quantity = (equip_quantity[i] > 0) ? equip_quantity[i] : 1;
 					found_slot = true;
@@ -1082,7 +1104,7 @@ int MenuInventory::getEquipSlotFromItem(int item, bool only_empty_slots) {
 
 	// find first empty(or just first) slot for item to equip
 	for (int i = 0; i < MAX_EQUIPPED; i++) {
-		if (slot_type[i] == items->items[item].type) {
+		if (slot_type_ids[i] == items->items[item].type_id) {
 			if (inventory[EQUIPMENT].storage[i].empty()) {
 				// empty and matching, no need to search more
 				equip_slot = i;
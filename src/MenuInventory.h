@@ -78,6 +78,7 @@ public:
 
 	void logic();
 	void render();
+	void prefetchIcons();
 	TooltipData checkTooltip(const Point& position);
 	int areaOver(const Point& position);
 
@@ -112,6 +113,7 @@ public:
 	Rect carried_area;
 	std::vector<Rect> equipped_area;
 	std::vector<std::string> slot_type;
+	std::vector<StringHandle> slot_type_ids; // indexed like slot_type
 
 	MenuItemStorage inventory[2];
 	int currency;
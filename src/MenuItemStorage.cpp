@@ -71,6 +71,10 @@ void MenuItemStorage::initFromList(int _slot_number, const std::vector<Rect>& _a
 	}
 	nb_cols = 0;
 	slot_type = _slot_type;
+	slot_type_ids.resize(slot_type.size());
+	for (size_t i = 0; i < slot_type.size(); ++i) {
+		slot_type_ids[i] = internString(slot_type[i]);
+	}
 	highlight = new bool[_slot_number];
 	for (int i=0; i<_slot_number; i++) {
 		highlight[i] = false;
@@ -123,18 +127,28 @@ void MenuItemStorage::render() {
 			if (overlay_disabled) {
 				overlay_disabled->setClip(disabled_src);
 				overlay_disabled->setDest(slots[i]->pos);
-				render_device->render(overlay_disabled);
+				render_device->submit(overlay_disabled);
 			}
 		}
 		if (highlight[i] && !slots[i]->in_focus) {
 			if (highlight_image) {
 				highlight_image->setDest(slots[i]->pos);
-				render_device->render(highlight_image);
+				render_device->submit(highlight_image);
 			}
 		}
 	}
 }
 
+void MenuItemStorage::prefetchIcons() {
+	if (!icons)
+		return;
+
+	for (int i=0; i<slot_number; i++) {
+		if (storage[i].item > 0)
+			icons->prefetch(items->items[storage[i].item].icon);
+	}
+}
+
 int MenuItemStorage::slotOver(const Point& position) {
 	if (isWithinRect(grid_area, position) && nb_cols > 0) {
 		return (position.x - grid_area.x) / slots[0]->pos.w + (position.y - grid_area.y) / slots[0]->pos.w * nb_cols;
@@ -213,9 +227,9 @@ void MenuItemStorage::itemReturn(ItemStack stack) {
 	drag_prev_slot = -1;
 }
 
-void MenuItemStorage::highlightMatching(const std::string& type) {
+void MenuItemStorage::highlightMatching(StringHandle type) {
 	for (int i=0; i<slot_number; i++) {
-		if (slot_type[i] == type) highlight[i] = true;
+		if (slot_type_ids[i] == type) highlight[i] = true;
 	}
 }
 
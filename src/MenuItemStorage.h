@@ -48,14 +48,16 @@ public:
 
 	// rendering
 	void render();
+	void prefetchIcons();
 	int slotOver(const Point& position);
 	TooltipData checkTooltip(const Point& position, StatBlock *stats, int context);
 	ItemStack click(const Point& position);
 	void itemReturn(ItemStack stack);
-	void highlightMatching(const std::string& type);
+	void highlightMatching(StringHandle type);
 	void highlightClear();
 	void setPos(int x = 0, int y = 0);
 	std::vector<std::string> slot_type;
+	std::vector<StringHandle> slot_type_ids; // indexed like slot_type
 
 	int drag_prev_slot;
 	std::vector<WidgetSlot*> slots;
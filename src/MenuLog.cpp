@@ -35,6 +35,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 MenuLog::MenuLog() {
 	visible = false;
+	retained = true;
 
 	closeButton = new WidgetButton("images/menus/buttons/button_x.png");
 
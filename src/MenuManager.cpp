@@ -71,6 +71,10 @@ MenuManager::MenuManager(StatBlock *_stats)
 	, done(false)
 	, act_drag_hover(false)
 	, keydrag_pos(Point())
+	, cache_frame(0)
+	, xp_text("")
+	, xp_text_value(0)
+	, xp_text_level(0)
 /*std::vector<Menu*> menus;*/
 	, inv(NULL)
 	, pow(NULL)
@@ -148,6 +152,7 @@ MenuManager::MenuManager(StatBlock *_stats)
 	tip = new WidgetTooltip();
 
 	closeAll(); // make sure all togglable menus start closed
+	menus_visible.resize(menus.size(), false);
 
 	SHOW_HUD = true;
 }
@@ -166,7 +171,7 @@ void MenuManager::alignAll() {
 void MenuManager::renderIcon(int x, int y) {
 	if (drag_icon) {
 		drag_icon->setDest(x,y);
-		render_device->render(drag_icon);
+		render_device->submit(drag_icon);
 	}
 }
 
@@ -294,10 +299,20 @@ void MenuManager::logic() {
 	hp->update(stats->hp, stats->get(STAT_HP_MAX), inpt->mouse);
 	mp->update(stats->mp, stats->get(STAT_MP_MAX), inpt->mouse);
 
+	// the xp text is only translated again when it changes
+	if (stats->xp != xp_text_value || stats->level != xp_text_level || xp_text.empty()) {
+		xp_text_value = stats->xp;
+		xp_text_level = stats->level;
+		if (stats->level == static_cast<int>(stats->xp_table.size()))
+			xp_text = msg->get("XP: %d", stats->xp);
+		else
+			xp_text = msg->get("XP: %d/%d", stats->xp, stats->xp_table[stats->level]);
+	}
+
 	if (stats->level == static_cast<int>(stats->xp_table.size()))
-		xp->update((stats->xp - stats->xp_table[stats->level-1]), (stats->xp - stats->xp_table[stats->level-1]), inpt->mouse, msg->get("XP: %d", stats->xp));
+		xp->update((stats->xp - stats->xp_table[stats->level-1]), (stats->xp - stats->xp_table[stats->level-1]), inpt->mouse, xp_text);
 	else
-		xp->update((stats->xp - stats->xp_table[stats->level-1]), (stats->xp_table[stats->level] - stats->xp_table[stats->level-1]), inpt->mouse, msg->get("XP: %d/%d", stats->xp, stats->xp_table[stats->level]));
+		xp->update((stats->xp - stats->xp_table[stats->level-1]), (stats->xp_table[stats->level] - stats->xp_table[stats->level-1]), inpt->mouse, xp_text);
 
 	// when selecting item quantities, don't process other menus
 	if (num_picker->visible) {
@@ -724,7 +739,7 @@ void MenuManager::logic() {
 
 		// highlight matching inventory slots based on what we're dragging
 		if (inv->visible && (mouse_dragging || keyboard_dragging)) {
-			inv->inventory[EQUIPMENT].highlightMatching(items->items[drag_stack.item].type);
+			inv->inventory[EQUIPMENT].highlightMatching(items->items[drag_stack.item].type_id);
 		}
 
 		// handle dropping
@@ -1147,7 +1162,32 @@ void MenuManager::resetDrag() {
 	sticky_dragging = false;
 }
 
+bool MenuManager::inputChanged() {
+	bool changed = inpt->window_resized || inpt->scroll_up || inpt->scroll_down;
+
+	if (cache_mouse.x != inpt->mouse.x || cache_mouse.y != inpt->mouse.y) {
+		cache_mouse = inpt->mouse;
+		changed = true;
+	}
+
+	cache_pressing.resize(inpt->key_count, false);
+	for (int i=0; i<inpt->key_count; i++) {
+		if (cache_pressing[i] != inpt->pressing[i]) {
+			cache_pressing[i] = inpt->pressing[i];
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
 void MenuManager::render() {
+	for (size_t i=0; i<menus.size(); i++) {
+		if (menus[i]->visible && !menus_visible[i])
+			menus[i]->prefetchIcons();
+		menus_visible[i] = menus[i]->visible;
+	}
+
 	// render the devhud under other menus
 	if (DEV_MODE && SHOW_HUD) {
 		devhud->render();
@@ -1186,13 +1226,28 @@ void MenuManager::render() {
 		hudlog_overlapped = true;
 	}
 
+	// retained menus redraw their cache when hovering or clicking could have changed them
+	bool refresh_cache = inputChanged();
+	if (++cache_frame >= MENU_CACHE_REFRESH) {
+		refresh_cache = true;
+	}
+	if (refresh_cache) {
+		cache_frame = 0;
+	}
+
+	// icons and slot highlights are submitted as a batch
+	render_device->beginBatch();
 	for (size_t i=0; i<menus.size(); i++) {
 		if (menus[i] == hudlog && hudlog_overlapped && !hudlog->hide_overlay) {
 			continue;
 		}
 
-		menus[i]->render();
+		if (menus[i]->retained)
+			menus[i]->renderCached(refresh_cache);
+		else
+			menus[i]->render();
 	}
+	render_device->flushBatch();
 
 	if (hudlog_overlapped && !hudlog->hide_overlay) {
 		hudlog->renderOverlay();
@@ -58,6 +58,9 @@ const int DRAG_SRC_ACTIONBAR = 3;
 const int DRAG_SRC_VENDOR = 4;
 const int DRAG_SRC_STASH = 5;
 
+// retained menus that haven't been marked dirty are still redrawn after this many frames
+const int MENU_CACHE_REFRESH = 10;
+
 class MenuManager {
 private:
 
@@ -94,6 +97,21 @@ private:
 	void handleKeyboardNavigation();
 	void dragAndDropWithKeyboard();
 
+	// returns true if the input that retained menus react to has changed since the last frame
+	bool inputChanged();
+
+	Point cache_mouse;
+	std::vector<bool> cache_pressing;
+	int cache_frame;
+
+	// which menus were open when they were last drawn, to find the ones that just opened
+	std::vector<bool> menus_visible;
+
+	// the translated text of the xp bar, and the values it was made for
+	std::string xp_text;
+	unsigned long xp_text_value;
+	int xp_text_level;
+
 public:
 	explicit MenuManager(StatBlock *stats);
 	MenuManager(const MenuManager &copy); // not implemented
@@ -34,13 +34,19 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <cmath>
 
+const uint8_t MINIMAP_TILE_EMPTY = 0;
+const uint8_t MINIMAP_TILE_WALL = 1;
+const uint8_t MINIMAP_TILE_OBST = 2;
+
 MenuMiniMap::MenuMiniMap()
 	: color_wall(128,128,128,255)
 	, color_obst(64,64,64,255)
 	, color_hero(255,255,255,255)
-	, map_surface(NULL) {
+	, map_surface(NULL)
+	, hero_marker(NULL) {
 
 	createMapSurface();
+	createHeroMarker();
 
 	// Load config settings
 	FileParser infile;
@@ -95,6 +101,31 @@ void MenuMiniMap::createMapSurface() {
 	}
 }
 
+void MenuMiniMap::createHeroMarker() {
+	if (hero_marker) {
+		delete hero_marker;
+		hero_marker = NULL;
+	}
+
+	Image *graphics;
+	graphics = render_device->createImage(3, 3);
+	if (graphics) {
+		const uint32_t c = (static_cast<uint32_t>(color_hero.a) << 24) | (static_cast<uint32_t>(color_hero.r) << 16) | (static_cast<uint32_t>(color_hero.g) << 8) | color_hero.b;
+		const uint32_t marker[9] = {
+			0, c, 0,
+			c, c, c,
+			0, c, 0
+		};
+		Rect area;
+		area.w = 3;
+		area.h = 3;
+		graphics->setPixels(area, marker, 3);
+
+		hero_marker = graphics->createSprite();
+		graphics->unref();
+	}
+}
+
 void MenuMiniMap::render() {
 }
 
@@ -116,12 +147,24 @@ void MenuMiniMap::prerender(MapCollision *collider, int map_w, int map_h) {
 
 	map_size.x = map_w;
 	map_size.y = map_h;
-	map_surface->getGraphics()->fillWithColor(Color(0,0,0,0));
 
-	if (TILESET_ORIENTATION == TILESET_ISOMETRIC)
-		prerenderIso(collider);
-	else // TILESET_ORTHOGONAL
-		prerenderOrtho(collider);
+	pixels.assign(map_surface->getGraphicsWidth() * map_surface->getGraphicsHeight(), 0);
+	tiles.assign(map_size.x * map_size.y, MINIMAP_TILE_EMPTY);
+
+	updateTiles(collider, true);
+}
+
+/**
+ * Redraws the tiles that have changed since the last prerender().
+ * Used when events change the collision layer of the current map.
+ */
+void MenuMiniMap::update(MapCollision *collider) {
+	if (!map_surface) return;
+
+	if (static_cast<int>(tiles.size()) != map_size.x * map_size.y || pixels.empty())
+		prerender(collider, map_size.x, map_size.y);
+	else
+		updateTiles(collider, false);
 }
 
 /**
@@ -147,15 +190,10 @@ void MenuMiniMap::renderOrtho(const FPoint& hero_pos) {
 	if (map_surface) {
 		map_surface->setClip(clip);
 		map_surface->setDest(map_area);
-		render_device->render(map_surface);
+		render_device->submit(map_surface);
 	}
 
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2, window_area.y + pos.y + pos.h/2, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2 + 1, window_area.y + pos.y + pos.h/2, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2 - 1, window_area.y + pos.y + pos.h/2, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2, window_area.y + pos.y + pos.h/2 + 1, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2, window_area.y + pos.y + pos.h/2 - 1, color_hero);
-
+	renderHeroMarker();
 }
 
 /**
@@ -183,91 +221,128 @@ void MenuMiniMap::renderIso(const FPoint& hero_pos) {
 	if (map_surface) {
 		map_surface->setClip(clip);
 		map_surface->setDest(map_area);
-		render_device->render(map_surface);
+		render_device->submit(map_surface);
 	}
 
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2 + 1, window_area.y + pos.y + pos.h/2, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2 - 1, window_area.y + pos.y + pos.h/2, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2, window_area.y + pos.y + pos.h/2 + 1, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2, window_area.y + pos.y + pos.h/2 - 1, color_hero);
-	render_device->drawPixel(window_area.x + pos.x + pos.w/2, window_area.y + pos.y + pos.h/2, color_hero);
+	renderHeroMarker();
 }
 
-void MenuMiniMap::prerenderOrtho(MapCollision *collider) {
-	for (int i=0; i<std::min(map_surface->getGraphicsWidth(), map_size.x); i++) {
-		for (int j=0; j<std::min(map_surface->getGraphicsHeight(), map_size.y); j++) {
-			if (collider->colmap[i][j] == 1 || collider->colmap[i][j] == 5) {
-				map_surface->getGraphics()->drawPixel(i, j, color_wall);
-			}
-			else if (collider->colmap[i][j] == 2 || collider->colmap[i][j] == 6) {
-				map_surface->getGraphics()->drawPixel(i, j, color_obst);
-			}
-		}
-	}
-}
+void MenuMiniMap::renderHeroMarker() {
+	if (!hero_marker) return;
 
-void MenuMiniMap::prerenderIso(MapCollision *collider) {
-	// a 2x1 pixel area correlates to a tile, so we can traverse tiles using pixel counting
-	Color draw_color;
-	int tile_type;
+	// the marker is 3x3 pixels, centered on the minimap
+	hero_marker->setDest(window_area.x + pos.x + pos.w/2 - 1, window_area.y + pos.y + pos.h/2 - 1);
+	render_device->submit(hero_marker);
+}
 
-	Point tile_cursor;
-	tile_cursor.x = -std::max(map_size.x, map_size.y)/2;
-	tile_cursor.y = std::max(map_size.x, map_size.y)/2;
+uint32_t MenuMiniMap::getTileColor(uint8_t tile) {
+	Color c;
+	if (tile == MINIMAP_TILE_WALL) c = color_wall;
+	else if (tile == MINIMAP_TILE_OBST) c = color_obst;
+	else return 0;
 
-	bool odd_row = false;
+	return (static_cast<uint32_t>(c.a) << 24) | (static_cast<uint32_t>(c.r) << 16) | (static_cast<uint32_t>(c.g) << 8) | c.b;
+}
 
-	// for each pixel row
-	for (int j=0; j<map_surface->getGraphicsHeight(); j++) {
+/**
+ * Writes the pixels of the tile at (x, y) and grows area to include them
+ */
+void MenuMiniMap::drawTile(int x, int y, uint8_t tile, Rect& area) {
+	const int surface_w = map_surface->getGraphicsWidth();
+	const int surface_h = map_surface->getGraphicsHeight();
+
+	Point px;
+	int px_count;
+
+	if (TILESET_ORIENTATION == TILESET_ISOMETRIC) {
+		// a 2x1 pixel area correlates to a tile
+		// on even pixel rows, it starts one pixel to the left
+		const int row = x + y;
+		const int column = x + std::max(map_size.x, map_size.y)/2 - (row+1)/2;
+		if (column < 0 || column >= surface_w/2)
+			return;
+
+		px.x = (row % 2 == 1) ? column * 2 : column * 2 - 1;
+		px.y = row;
+		px_count = 2;
+	}
+	else { // TILESET_ORTHOGONAL
+		px.x = x;
+		px.y = y;
+		px_count = 1;
+	}
 
-		// for each 2-px wide column
-		for (int i=0; i<map_surface->getGraphicsWidth(); i+=2) {
+	if (px.y < 0 || px.y >= surface_h)
+		return;
 
-			// if this tile is the max map size
-			if (tile_cursor.x >= 0 && tile_cursor.y >= 0 && tile_cursor.x < map_size.x && tile_cursor.y < map_size.y) {
+	const int x0 = std::max(px.x, 0);
+	const int x1 = std::min(px.x + px_count, surface_w);
+	if (x0 >= x1)
+		return;
 
-				tile_type = collider->colmap[tile_cursor.x][tile_cursor.y];
-				bool draw_tile = true;
+	const uint32_t color = getTileColor(tile);
+	for (int i = x0; i < x1; ++i) {
+		pixels[px.y * surface_w + i] = color;
+	}
 
-				// walls and low obstacles show as different colors
-				if (tile_type == 1 || tile_type == 5) draw_color = color_wall;
-				else if (tile_type == 2 || tile_type == 6) draw_color = color_obst;
-				else draw_tile = false;
+	if (area.w == 0) {
+		area.x = x0;
+		area.y = px.y;
+		area.w = x1 - x0;
+		area.h = 1;
+	}
+	else {
+		const int right = std::max(area.x + area.w, x1);
+		const int bottom = std::max(area.y + area.h, px.y + 1);
+		area.x = std::min(area.x, x0);
+		area.y = std::min(area.y, px.y);
+		area.w = right - area.x;
+		area.h = bottom - area.y;
+	}
+}
 
-				if (draw_tile) {
-					if (odd_row) {
-						map_surface->getGraphics()->drawPixel(i, j, draw_color);
-						map_surface->getGraphics()->drawPixel(i+1, j, draw_color);
-					}
-					else {
-						map_surface->getGraphics()->drawPixel(i-1, j, draw_color);
-						map_surface->getGraphics()->drawPixel(i, j, draw_color);
-					}
-				}
+/**
+ * Draws the tiles that differ from the last update, or all of them if redraw is true,
+ * then uploads the changed part of the minimap
+ */
+void MenuMiniMap::updateTiles(MapCollision *collider, bool redraw) {
+	Rect area;
+
+	for (int j=0; j<map_size.y; j++) {
+		for (int i=0; i<map_size.x; i++) {
+			const unsigned short tile_type = collider->colmap.get(i, j);
+
+			// walls and low obstacles show as different colors
+			uint8_t tile = MINIMAP_TILE_EMPTY;
+			if (tile_type == 1 || tile_type == 5) tile = MINIMAP_TILE_WALL;
+			else if (tile_type == 2 || tile_type == 6) tile = MINIMAP_TILE_OBST;
+
+			uint8_t& prev_tile = tiles[j * map_size.x + i];
+			if (tile != prev_tile || (redraw && tile != MINIMAP_TILE_EMPTY)) {
+				prev_tile = tile;
+				drawTile(i, j, tile, area);
 			}
-
-			// moving screen-right in isometric is +x -y in map coordinates
-			tile_cursor.x++;
-			tile_cursor.y--;
 		}
+	}
 
-		// return tile cursor to next row of tiles
-		if (odd_row) {
-			odd_row = false;
-			tile_cursor.x -= map_surface->getGraphicsWidth()/2;
-			tile_cursor.y += (map_surface->getGraphicsWidth()/2 +1);
-		}
-		else {
-			odd_row = true;
-			tile_cursor.x -= (map_surface->getGraphicsWidth()/2 -1);
-			tile_cursor.y += map_surface->getGraphicsWidth()/2;
-		}
+	// a full redraw also has to clear what was left from the previous map
+	if (redraw) {
+		area.x = 0;
+		area.y = 0;
+		area.w = map_surface->getGraphicsWidth();
+		area.h = map_surface->getGraphicsHeight();
+	}
+
+	if (area.w > 0 && area.h > 0) {
+		map_surface->getGraphics()->setPixels(area, &pixels[area.y * map_surface->getGraphicsWidth() + area.x], map_surface->getGraphicsWidth());
 	}
 }
 
 MenuMiniMap::~MenuMiniMap() {
 	if (map_surface)
 		delete map_surface;
+	if (hero_marker)
+		delete hero_marker;
 
 	delete label;
 }
@@ -38,17 +38,27 @@ private:
 	Color color_hero;
 
 	Sprite *map_surface;
+	Sprite *hero_marker;
 	Point map_size;
 
+	// the minimap is drawn here, then uploaded to map_surface in one call
+	std::vector<uint32_t> pixels;
+
+	// what each collision tile was last drawn as, so that map changes only update the tiles that differ
+	std::vector<uint8_t> tiles;
+
 	Rect pos;
 	LabelInfo text_pos;
 	WidgetLabel *label;
 
 	void createMapSurface();
+	void createHeroMarker();
 	void renderIso(const FPoint& hero_pos);
 	void renderOrtho(const FPoint& hero_pos);
-	void prerenderOrtho(MapCollision *collider);
-	void prerenderIso(MapCollision *collider);
+	void renderHeroMarker();
+	uint32_t getTileColor(uint8_t tile);
+	void drawTile(int x, int y, uint8_t tile, Rect& area);
+	void updateTiles(MapCollision *collider, bool redraw);
 
 public:
 	MenuMiniMap();
@@ -58,6 +68,7 @@ public:
 	void render();
 	void render(const FPoint& hero_pos);
 	void prerender(MapCollision *collider, int map_w, int map_h);
+	void update(MapCollision *collider);
 	void setMapTitle(const std::string& map_title);
 };
 
@@ -388,7 +388,7 @@ void MenuNPCActions::render() {
 	if (!action_menu) return;
 
 	action_menu->setDest(window_area);
-	render_device->render(action_menu);
+	render_device->submit(action_menu);
 	for(size_t i=0; i<npc_actions.size(); i++) {
 		if (npc_actions[i].label) {
 			npc_actions[i].label->local_frame.x = window_area.x;
@@ -24,6 +24,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  */
 
 #include "CommonIncludes.h"
+#include "EnemyManager.h"
 #include "Menu.h"
 #include "MenuPowers.h"
 #include "Settings.h"
@@ -49,8 +50,13 @@ MenuPowers::MenuPowers(StatBlock *_stats, MenuActionBar *_action_bar)
 	, tab_control(NULL)
 	, tree_loaded(false)
 	, prev_powers_list_size(0)
+	, cache_level(0)
+	, cache_powers_list_size(0)
+	, cache_unlocked_size(0)
+	, cache_status_revision(0)
 	, newPowerNotification(false)
 {
+	retained = true;
 
 	closeButton = new WidgetButton("images/menus/buttons/button_x.png");
 
@@ -216,10 +222,21 @@ void MenuPowers::loadPowerTree(const std::string &filename) {
 		power_cell_all.push_back(power_cell_upgrade[i]);
 	}
 
+	// index the cells by power id, keeping the first cell of each power like getCellByPowerIndex()
+	power_cell_all_index.clear();
+	for (size_t i=power_cell_all.size(); i>0; --i) {
+		int id = power_cell_all[i-1].id;
+		if (id <= 0)
+			continue;
+		if (static_cast<size_t>(id) >= power_cell_all_index.size())
+			power_cell_all_index.resize(id + 1, -1);
+		power_cell_all_index[id] = static_cast<int>(i-1);
+	}
+
 	// save cell indexes for required powers
 	for (size_t i=0; i<power_cell_all.size(); ++i) {
 		for (size_t j=0; j<power_cell_all[i].requires_power.size(); ++j) {
-			int cell_index = getCellByPowerIndex(power_cell_all[i].requires_power[j], power_cell_all);
+			int cell_index = getAllCellByPowerIndex(power_cell_all[i].requires_power[j]);
 			power_cell_all[i].requires_power_cell.push_back(cell_index);
 		}
 	}
@@ -427,10 +444,74 @@ void MenuPowers::loadUpgrade(FileParser &infile) {
 	else infile.error("MenuPowers: '%s' is not a valid key.", infile.key.c_str());
 }
 
+/**
+ * The results of the check functions only depend on the hero's level, primary stats,
+ * unlocked powers and the campaign statuses, so they are kept until one of those changes.
+ */
+void MenuPowers::updateCellCache() {
+	bool changed = cache_level != stats->level
+		|| cache_powers_list_size != stats->powers_list.size()
+		|| cache_unlocked_size != power_cell_unlocked.size()
+		|| cache_status_revision != camp->getStatusRevision()
+		|| cell_visible.size() != power_cell_all.size()
+		|| cache_primary.size() != PRIMARY_STATS.size();
+
+	for (size_t i = 0; !changed && i < PRIMARY_STATS.size(); ++i) {
+		if (cache_primary[i] != stats->get_primary(i))
+			changed = true;
+	}
+
+	if (!changed)
+		return;
+
+	cache_level = stats->level;
+	cache_powers_list_size = stats->powers_list.size();
+	cache_unlocked_size = power_cell_unlocked.size();
+	cache_status_revision = camp->getStatusRevision();
+	cache_primary.resize(PRIMARY_STATS.size());
+	for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
+		cache_primary[i] = stats->get_primary(i);
+	}
+
+	cell_requirements.assign(power_cell_all.size(), -1);
+	cell_unlocked.assign(power_cell_all.size(), -1);
+	cell_visible.assign(power_cell_all.size(), -1);
+}
+
 bool MenuPowers::checkRequirements(int pci) {
 	if (pci == -1)
 		return false;
 
+	updateCellCache();
+	if (cell_requirements[pci] == -1)
+		cell_requirements[pci] = calcRequirements(pci);
+	return cell_requirements[pci] == 1;
+}
+
+bool MenuPowers::checkUnlocked(int pci) {
+	if (pci == -1)
+		return true;
+
+	updateCellCache();
+	if (cell_unlocked[pci] == -1)
+		cell_unlocked[pci] = calcUnlocked(pci);
+	return cell_unlocked[pci] == 1;
+}
+
+bool MenuPowers::checkCellVisible(int pci) {
+	if (pci == -1)
+		return true;
+
+	updateCellCache();
+	if (cell_visible[pci] == -1)
+		cell_visible[pci] = calcCellVisible(pci);
+	return cell_visible[pci] == 1;
+}
+
+bool MenuPowers::calcRequirements(int pci) {
+	if (pci == -1)
+		return false;
+
 	for (size_t i = 0; i < power_cell_all[pci].requires_power_cell.size(); ++i)
 		if (!checkUnlocked(power_cell_all[pci].requires_power_cell[i]))
 			return false;
@@ -446,7 +527,7 @@ bool MenuPowers::checkRequirements(int pci) {
 	return true;
 }
 
-bool MenuPowers::checkUnlocked(int pci) {
+bool MenuPowers::calcUnlocked(int pci) {
 	// If we didn't find power in power_menu, than it has no requirements
 	if (pci == -1) return true;
 
@@ -469,7 +550,7 @@ bool MenuPowers::checkUnlocked(int pci) {
 	return false;
 }
 
-bool MenuPowers::checkCellVisible(int pci) {
+bool MenuPowers::calcCellVisible(int pci) {
 	// If we didn't find power in power_menu, than it has no requirements
 	if (pci == -1) return true;
 
@@ -505,7 +586,7 @@ bool MenuPowers::checkUpgrade(int pci) {
 	if (points_left < 1)
 		return false;
 
-	int id = getCellByPowerIndex(power_cell[pci].id, power_cell_all);
+	int id = getAllCellByPowerIndex(power_cell[pci].id);
 	if (!checkUnlocked(id))
 		return false;
 
@@ -515,13 +596,20 @@ bool MenuPowers::checkUpgrade(int pci) {
 	if (!power_cell_upgrade[next_index].requires_point)
 		return false;
 
-	int id_upgrade = getCellByPowerIndex(power_cell_upgrade[next_index].id, power_cell_all);
+	int id_upgrade = getAllCellByPowerIndex(power_cell_upgrade[next_index].id);
 	if (!checkUnlock(id_upgrade))
 		return false;
 
 	return true;
 }
 
+int MenuPowers::getAllCellByPowerIndex(int power_index) {
+	if (power_index <= 0 || static_cast<size_t>(power_index) >= power_cell_all_index.size())
+		return -1;
+
+	return power_cell_all_index[power_index];
+}
+
 int MenuPowers::getCellByPowerIndex(int power_index, const std::vector<Power_Menu_Cell>& cell) {
 	// Powers can not have an id of 0
 	if (power_index == 0) return -1;
@@ -605,6 +693,9 @@ void MenuPowers::upgradePower(int pci) {
 		stats->check_title = true;
 	}
 	setUnlockedPowers();
+
+	if (enemies)
+		enemies->loadPowerCreatures(power_cell_upgrade[i].id);
 }
 
 void MenuPowers::setUnlockedPowers() {
@@ -650,7 +741,7 @@ void MenuPowers::setUnlockedPowers() {
 		}
 		else {
 			// power is unlocked, but not in the player's powers_list
-			int pci = getCellByPowerIndex(power_cell[i].id, power_cell_all);
+			int pci = getAllCellByPowerIndex(power_cell[i].id);
 			if (checkUnlocked(pci)) {
 				stats->powers_list.push_back(power_cell[i].id);
 			}
@@ -674,26 +765,71 @@ int MenuPowers::getPointsUsed() {
 }
 
 void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector<Power_Menu_Cell>& power_cells, bool show_unlock_prompt) {
+	static const StringHandle msg_level = msg->getID("Level %d");
+	static const StringHandle msg_costs_mp = msg->getID("Costs %d MP");
+	static const StringHandle msg_costs_hp = msg->getID("Costs %d HP");
+	static const StringHandle msg_cooldown = msg->getID("Cooldown:");
+	static const StringHandle msg_resistance = msg->getID("%s Resistance");
+	static const StringHandle msg_damage_per_second = msg->getID("Damage per second");
+	static const StringHandle msg_hp_per_second = msg->getID("HP per second");
+	static const StringHandle msg_mp_per_second = msg->getID("MP per second");
+	static const StringHandle msg_immobilize = msg->getID("Immobilize");
+	static const StringHandle msg_speed = msg->getID("%d%% Speed");
+	static const StringHandle msg_attack_speed = msg->getID("%d%% Attack Speed");
+	static const StringHandle msg_immunity = msg->getID("Immunity");
+	static const StringHandle msg_immunity_to_damage_over_time = msg->getID("Immunity to damage over time");
+	static const StringHandle msg_immunity_to_slow = msg->getID("Immunity to slow");
+	static const StringHandle msg_immunity_to_stun = msg->getID("Immunity to stun");
+	static const StringHandle msg_immunity_to_hp_steal = msg->getID("Immunity to HP steal");
+	static const StringHandle msg_immunity_to_mp_steal = msg->getID("Immunity to MP steal");
+	static const StringHandle msg_immunity_to_knockback = msg->getID("Immunity to knockback");
+	static const StringHandle msg_immunity_to_damage_reflection = msg->getID("Immunity to damage reflection");
+	static const StringHandle msg_stun = msg->getID("Stun");
+	static const StringHandle msg_automatic_revive_on_death = msg->getID("Automatic revive on death");
+	static const StringHandle msg_convert = msg->getID("Convert");
+	static const StringHandle msg_fear = msg->getID("Fear");
+	static const StringHandle msg_lifespan = msg->getID("Lifespan");
+	static const StringHandle msg_magical_shield = msg->getID("Magical Shield");
+	static const StringHandle msg_healing = msg->getID("Healing");
+	static const StringHandle msg_knockback = msg->getID("Knockback");
+	static const StringHandle msg_chance = msg->getID("%d%% chance");
+	static const StringHandle msg_damage = msg->getID("Damage");
+	static const StringHandle msg_melee_damage = msg->getID("Melee Damage");
+	static const StringHandle msg_ranged_damage = msg->getID("Ranged Damage");
+	static const StringHandle msg_mental_damage = msg->getID("Mental Damage");
+	static const StringHandle msg_base_accuracy = msg->getID("Base Accuracy");
+	static const StringHandle msg_base_critical_chance = msg->getID("Base Critical Chance");
+	static const StringHandle msg_ignores_absorbtion = msg->getID("Ignores Absorbtion");
+	static const StringHandle msg_ignores_avoidance = msg->getID("Ignores Avoidance");
+	static const StringHandle msg_chance_to_crit_slowed_targets = msg->getID("%d%% Chance to crit slowed targets");
+	static const StringHandle msg_elemental_damage = msg->getID("%s Elemental Damage");
+	static const StringHandle msg_requires_a = msg->getID("Requires a %s");
+	static const StringHandle msg_requires = msg->getID("Requires %s %d");
+	static const StringHandle msg_requires_level = msg->getID("Requires Level %d");
+	static const StringHandle msg_requires_power = msg->getID("Requires Power: %s");
+	static const StringHandle msg_click_to_unlock_uses_1_skill_point = msg->getID("Click to Unlock (uses 1 Skill Point)");
+	static const StringHandle msg_requires_1_skill_point = msg->getID("Requires 1 Skill Point");
+
 	if (power_cells[slot_num].upgrade_level > 0)
-		tip->addText(powers->powers[power_cells[slot_num].id].name + " (" + msg->get("Level %d", power_cells[slot_num].upgrade_level) + ")");
+		tip->addText(powers->power_text[power_cells[slot_num].id].name + " (" + msg->get(msg_level, power_cells[slot_num].upgrade_level) + ")");
 	else
-		tip->addText(powers->powers[power_cells[slot_num].id].name);
+		tip->addText(powers->power_text[power_cells[slot_num].id].name);
 
 	if (powers->powers[power_cells[slot_num].id].passive) tip->addText("Passive");
-	tip->addColoredText(substituteVarsInString(powers->powers[power_cells[slot_num].id].description, pc), color_flavor);
+	tip->addColoredText(substituteVarsInString(powers->power_text[power_cells[slot_num].id].description, pc), color_flavor);
 
 	// add mana cost
 	if (powers->powers[power_cells[slot_num].id].requires_mp > 0) {
-		tip->addText(msg->get("Costs %d MP", powers->powers[power_cells[slot_num].id].requires_mp));
+		tip->addText(msg->get(msg_costs_mp, powers->powers[power_cells[slot_num].id].requires_mp));
 	}
 	// add health cost
 	if (powers->powers[power_cells[slot_num].id].requires_hp > 0) {
-		tip->addText(msg->get("Costs %d HP", powers->powers[power_cells[slot_num].id].requires_hp));
+		tip->addText(msg->get(msg_costs_hp, powers->powers[power_cells[slot_num].id].requires_hp));
 	}
 	// add cooldown time
 	if (powers->powers[power_cells[slot_num].id].cooldown > 0) {
 		std::stringstream ss;
-		ss << msg->get("Cooldown:") << " " << getDurationString(powers->powers[power_cells[slot_num].id].cooldown);
+		ss << msg->get(msg_cooldown) << " " << getDurationString(powers->powers[power_cells[slot_num].id].cooldown);
 		tip->addText(ss.str());
 	}
 
@@ -723,7 +859,7 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 
 			for (size_t j=0; j<ELEMENTS.size(); ++j) {
 				if (pwr.post_effects[i].id == ELEMENTS[j].id + "_resist") {
-					ss << "% " << msg->get("%s Resistance", ELEMENTS[j].name.c_str());
+					ss << "% " << msg->get(msg_resistance, ELEMENTS[j].name.c_str());
 					break;
 				}
 			}
@@ -737,70 +873,70 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 		}
 		else {
 			if (effect_ptr->type == "damage") {
-				ss << pwr.post_effects[i].magnitude << " " << msg->get("Damage per second");
+				ss << pwr.post_effects[i].magnitude << " " << msg->get(msg_damage_per_second);
 			}
 			else if (effect_ptr->type == "damage_percent") {
-				ss << pwr.post_effects[i].magnitude << "% " << msg->get("Damage per second");
+				ss << pwr.post_effects[i].magnitude << "% " << msg->get(msg_damage_per_second);
 			}
 			else if (effect_ptr->type == "hpot") {
-				ss << pwr.post_effects[i].magnitude << " " << msg->get("HP per second");
+				ss << pwr.post_effects[i].magnitude << " " << msg->get(msg_hp_per_second);
 			}
 			else if (effect_ptr->type == "hpot_percent") {
-				ss << pwr.post_effects[i].magnitude << "% " << msg->get("HP per second");
+				ss << pwr.post_effects[i].magnitude << "% " << msg->get(msg_hp_per_second);
 			}
 			else if (effect_ptr->type == "mpot") {
-				ss << pwr.post_effects[i].magnitude << " " << msg->get("MP per second");
+				ss << pwr.post_effects[i].magnitude << " " << msg->get(msg_mp_per_second);
 			}
 			else if (effect_ptr->type == "mpot_percent") {
-				ss << pwr.post_effects[i].magnitude << "% " << msg->get("MP per second");
+				ss << pwr.post_effects[i].magnitude << "% " << msg->get(msg_mp_per_second);
 			}
 			else if (effect_ptr->type == "speed") {
 				if (pwr.post_effects[i].magnitude == 0)
-					ss << msg->get("Immobilize");
+					ss << msg->get(msg_immobilize);
 				else
-					ss << msg->get("%d%% Speed", pwr.post_effects[i].magnitude);
+					ss << msg->get(msg_speed, pwr.post_effects[i].magnitude);
 			}
 			else if (effect_ptr->type == "attack_speed") {
-				ss << msg->get("%d%% Attack Speed", pwr.post_effects[i].magnitude);
+				ss << msg->get(msg_attack_speed, pwr.post_effects[i].magnitude);
 			}
 			else if (effect_ptr->type == "immunity") {
-				ss << msg->get("Immunity");
+				ss << msg->get(msg_immunity);
 			}
 			else if (effect_ptr->type == "immunity_damage") {
-				ss << msg->get("Immunity to damage over time");
+				ss << msg->get(msg_immunity_to_damage_over_time);
 			}
 			else if (effect_ptr->type == "immunity_slow") {
-				ss << msg->get("Immunity to slow");
+				ss << msg->get(msg_immunity_to_slow);
 			}
 			else if (effect_ptr->type == "immunity_stun") {
-				ss << msg->get("Immunity to stun");
+				ss << msg->get(msg_immunity_to_stun);
 			}
 			else if (effect_ptr->type == "immunity_hp_steal") {
-				ss << msg->get("Immunity to HP steal");
+				ss << msg->get(msg_immunity_to_hp_steal);
 			}
 			else if (effect_ptr->type == "immunity_mp_steal") {
-				ss << msg->get("Immunity to MP steal");
+				ss << msg->get(msg_immunity_to_mp_steal);
 			}
 			else if (effect_ptr->type == "immunity_knockback") {
-				ss << msg->get("Immunity to knockback");
+				ss << msg->get(msg_immunity_to_knockback);
 			}
 			else if (effect_ptr->type == "immunity_damage_reflect") {
-				ss << msg->get("Immunity to damage reflection");
+				ss << msg->get(msg_immunity_to_damage_reflection);
 			}
 			else if (effect_ptr->type == "stun") {
-				ss << msg->get("Stun");
+				ss << msg->get(msg_stun);
 			}
 			else if (effect_ptr->type == "revive") {
-				ss << msg->get("Automatic revive on death");
+				ss << msg->get(msg_automatic_revive_on_death);
 			}
 			else if (effect_ptr->type == "convert") {
-				ss << msg->get("Convert");
+				ss << msg->get(msg_convert);
 			}
 			else if (effect_ptr->type == "fear") {
-				ss << msg->get("Fear");
+				ss << msg->get(msg_fear);
 			}
 			else if (effect_ptr->type == "death_sentence") {
-				ss << msg->get("Lifespan");
+				ss << msg->get(msg_lifespan);
 			}
 			else if (effect_ptr->type == "shield") {
 				if (pwr.mod_damage_mode == STAT_MODIFIER_MODE_MULTIPLY) {
@@ -821,7 +957,7 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 					ss << stats->get(STAT_DMG_MENT_MAX);
 				}
 
-				ss << " " << msg->get("Magical Shield");
+				ss << " " << msg->get(msg_magical_shield);
 			}
 			else if (effect_ptr->type == "heal") {
 				int mag_min = stats->get(STAT_DMG_MENT_MIN);
@@ -847,10 +983,10 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 					ss << mag_min << "-" << mag_max;
 				}
 
-				ss << " " << msg->get("Healing");
+				ss << " " << msg->get(msg_healing);
 			}
 			else if (effect_ptr->type == "knockback") {
-				ss << pwr.post_effects[i].magnitude << " " << msg->get("Knockback");
+				ss << pwr.post_effects[i].magnitude << " " << msg->get(msg_knockback);
 			}
 			else if (pwr.post_effects[i].magnitude == 0) {
 				// nothing
@@ -870,7 +1006,7 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 					ss << " ";
 			}
 			if (pwr.post_effects[i].chance != 100) {
-				ss << "(" << msg->get("%d%% chance", pwr.post_effects[i].chance) << ")";
+				ss << "(" << msg->get(msg_chance, pwr.post_effects[i].chance) << ")";
 			}
 
 			tip->addColoredText(ss.str(), color_bonus);
@@ -898,13 +1034,13 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 			ss << " ";
 
 			if (pwr.base_damage == BASE_DAMAGE_NONE)
-				ss << msg->get("Damage");
+				ss << msg->get(msg_damage);
 			else if (pwr.base_damage == BASE_DAMAGE_MELEE)
-				ss << msg->get("Melee Damage");
+				ss << msg->get(msg_melee_damage);
 			else if (pwr.base_damage == BASE_DAMAGE_RANGED)
-				ss << msg->get("Ranged Damage");
+				ss << msg->get(msg_ranged_damage);
 			else if (pwr.base_damage == BASE_DAMAGE_MENT)
-				ss << msg->get("Mental Damage");
+				ss << msg->get(msg_mental_damage);
 
 			if (pwr.count > 1 && pwr.type != POWTYPE_REPEATER)
 				ss << " (x" << pwr.count << ")";
@@ -927,7 +1063,7 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 			}
 			ss << " ";
 
-			ss << msg->get("Base Accuracy");
+			ss << msg->get(msg_base_accuracy);
 
 			if (!ss.str().empty())
 				tip->addColoredText(ss.str(), color_bonus);
@@ -947,7 +1083,7 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 			}
 			ss << " ";
 
-			ss << msg->get("Base Critical Chance");
+			ss << msg->get(msg_base_critical_chance);
 
 			if (!ss.str().empty())
 				tip->addColoredText(ss.str(), color_bonus);
@@ -955,31 +1091,31 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 
 		if (pwr.trait_armor_penetration) {
 			ss.str("");
-			ss << msg->get("Ignores Absorbtion");
+			ss << msg->get(msg_ignores_absorbtion);
 			tip->addColoredText(ss.str(), color_bonus);
 		}
 		if (pwr.trait_avoidance_ignore) {
 			ss.str("");
-			ss << msg->get("Ignores Avoidance");
+			ss << msg->get(msg_ignores_avoidance);
 			tip->addColoredText(ss.str(), color_bonus);
 		}
 		if (pwr.trait_crits_impaired > 0) {
 			ss.str("");
-			ss << msg->get("%d%% Chance to crit slowed targets", pwr.trait_crits_impaired);
+			ss << msg->get(msg_chance_to_crit_slowed_targets, pwr.trait_crits_impaired);
 			tip->addColoredText(ss.str(), color_bonus);
 		}
 		if (pwr.trait_elemental > -1) {
 			ss.str("");
-			ss << msg->get("%s Elemental Damage", ELEMENTS[pwr.trait_elemental].name.c_str());
+			ss << msg->get(msg_elemental_damage, ELEMENTS[pwr.trait_elemental].name.c_str());
 			tip->addColoredText(ss.str(), color_bonus);
 		}
 	}
 
-	std::set<std::string>::iterator it;
+	std::set<StringHandle>::iterator it;
 	for (it = powers->powers[power_cells[slot_num].id].requires_flags.begin(); it != powers->powers[power_cells[slot_num].id].requires_flags.end(); ++it) {
 		for (size_t i=0; i<EQUIP_FLAGS.size(); ++i) {
-			if ((*it) == EQUIP_FLAGS[i].id) {
-				tip->addText(msg->get("Requires a %s", msg->get(EQUIP_FLAGS[i].name)));
+			if (getInternedString(*it) == EQUIP_FLAGS[i].id) {
+				tip->addText(msg->get(msg_requires_a, msg->get(EQUIP_FLAGS[i].name)));
 			}
 		}
 	}
@@ -988,55 +1124,55 @@ void MenuPowers::createTooltip(TooltipData* tip, int slot_num, const std::vector
 	for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
 		if (power_cells[slot_num].requires_primary[i] > 0) {
 			if (stats->get_primary(i) < power_cells[slot_num].requires_primary[i])
-				tip->addColoredText(msg->get("Requires %s %d", power_cells[slot_num].requires_primary[i], PRIMARY_STATS[i].name.c_str()), color_penalty);
+				tip->addColoredText(msg->get(msg_requires, power_cells[slot_num].requires_primary[i], PRIMARY_STATS[i].name.c_str()), color_penalty);
 			else
-				tip->addText(msg->get("Requires %s %d", power_cells[slot_num].requires_primary[i], PRIMARY_STATS[i].name.c_str()));
+				tip->addText(msg->get(msg_requires, power_cells[slot_num].requires_primary[i], PRIMARY_STATS[i].name.c_str()));
 		}
 	}
 
 	// Draw required Level Tooltip
 	if ((power_cells[slot_num].requires_level > 0) && stats->level < power_cells[slot_num].requires_level) {
-		tip->addColoredText(msg->get("Requires Level %d", power_cells[slot_num].requires_level), color_penalty);
+		tip->addColoredText(msg->get(msg_requires_level, power_cells[slot_num].requires_level), color_penalty);
 	}
 	else if ((power_cells[slot_num].requires_level > 0) && stats->level >= power_cells[slot_num].requires_level) {
-		tip->addText(msg->get("Requires Level %d", power_cells[slot_num].requires_level));
+		tip->addText(msg->get(msg_requires_level, power_cells[slot_num].requires_level));
 	}
 
 	for (size_t j=0; j < power_cells[slot_num].requires_power.size(); ++j) {
 		if (power_cells[slot_num].requires_power[j] == 0) continue;
 
-		int req_index = getCellByPowerIndex(power_cells[slot_num].requires_power[j], power_cell_all);
+		int req_index = getAllCellByPowerIndex(power_cells[slot_num].requires_power[j]);
 		if (req_index == -1) continue;
 
 		std::string req_power_name;
 		if (power_cell_all[req_index].upgrade_level > 0)
-			req_power_name = powers->powers[power_cell_all[req_index].id].name + " (" + msg->get("Level %d", power_cell_all[req_index].upgrade_level) + ")";
+			req_power_name = powers->power_text[power_cell_all[req_index].id].name + " (" + msg->get(msg_level, power_cell_all[req_index].upgrade_level) + ")";
 		else
-			req_power_name = powers->powers[power_cell_all[req_index].id].name;
+			req_power_name = powers->power_text[power_cell_all[req_index].id].name;
 
 
 		// Required Power Tooltip
-		int req_cell_index = getCellByPowerIndex(power_cells[slot_num].requires_power[j], power_cell_all);
+		int req_cell_index = getAllCellByPowerIndex(power_cells[slot_num].requires_power[j]);
 		if (!checkUnlocked(req_cell_index)) {
-			tip->addColoredText(msg->get("Requires Power: %s", req_power_name), color_penalty);
+			tip->addColoredText(msg->get(msg_requires_power, req_power_name), color_penalty);
 		}
 		else {
-			tip->addText(msg->get("Requires Power: %s", req_power_name));
+			tip->addText(msg->get(msg_requires_power, req_power_name));
 		}
 
 	}
 
 	// Draw unlock power Tooltip
 	if (power_cells[slot_num].requires_point && !(std::find(stats->powers_list.begin(), stats->powers_list.end(), power_cells[slot_num].id) != stats->powers_list.end())) {
-		int unlock_id = getCellByPowerIndex(power_cells[slot_num].id, power_cell_all);
+		int unlock_id = getAllCellByPowerIndex(power_cells[slot_num].id);
 		if (show_unlock_prompt && points_left > 0 && checkUnlock(unlock_id)) {
-			tip->addColoredText(msg->get("Click to Unlock (uses 1 Skill Point)"), color_bonus);
+			tip->addColoredText(msg->get(msg_click_to_unlock_uses_1_skill_point), color_bonus);
 		}
 		else {
 			if (power_cells[slot_num].requires_point && points_left < 1)
-				tip->addColoredText(msg->get("Requires 1 Skill Point"), color_penalty);
+				tip->addColoredText(msg->get(msg_requires_1_skill_point), color_penalty);
 			else
-				tip->addText(msg->get("Requires 1 Skill Point"));
+				tip->addText(msg->get(msg_requires_1_skill_point));
 		}
 	}
 }
@@ -1053,7 +1189,7 @@ void MenuPowers::renderPowers(int tab_num) {
 		// Continue if slot is not filled with data
 		if (power_cell[i].tab != tab_num) continue;
 
-		int cell_index = getCellByPowerIndex(power_cell[i].id, power_cell_all);
+		int cell_index = getAllCellByPowerIndex(power_cell[i].id);
 		if (!checkCellVisible(cell_index)) continue;
 
 		if (std::find(stats->powers_list.begin(), stats->powers_list.end(), power_cell[i].id) != stats->powers_list.end()) power_in_vector = true;
@@ -1082,7 +1218,7 @@ void MenuPowers::renderPowers(int tab_num) {
 				if (power_cell[j].id == power_cell[i].id && powers_unlock && slots[j]) {
 					powers_unlock->setClip(src_unlock);
 					powers_unlock->setDest(slots[j]->pos);
-					render_device->render(powers_unlock);
+					render_device->submit(powers_unlock);
 				}
 			}
 		}
@@ -1090,7 +1226,7 @@ void MenuPowers::renderPowers(int tab_num) {
 			if (overlay_disabled && slots[i]) {
 				overlay_disabled->setClip(disabled_src);
 				overlay_disabled->setDest(slots[i]->pos);
-				render_device->render(overlay_disabled);
+				render_device->submit(overlay_disabled);
 			}
 		}
 
@@ -1111,7 +1247,7 @@ void MenuPowers::logic() {
 			bool unlocked_power = std::find(stats->powers_list.begin(), stats->powers_list.end(), power_cell_unlocked[i].id) != stats->powers_list.end();
 			std::vector<int>::iterator it = std::find(stats->powers_passive.begin(), stats->powers_passive.end(), power_cell_unlocked[i].id);
 
-			int cell_index = getCellByPowerIndex(power_cell_unlocked[i].id, power_cell_all);
+			int cell_index = getAllCellByPowerIndex(power_cell_unlocked[i].id);
 			bool is_current_upgrade_max = (getCellByPowerIndex(power_cell_unlocked[i].id, power_cell) != -1);
 
 			if (it != stats->powers_passive.end()) {
@@ -1212,7 +1348,7 @@ void MenuPowers::render() {
 				if (r) {
 					r->setClip(src);
 					r->setDest(dest);
-					render_device->render(r);
+					render_device->submit(r);
 				}
 
 				// power icons
@@ -1225,7 +1361,7 @@ void MenuPowers::render() {
 		if (r) {
 			r->setClip(src);
 			r->setDest(dest);
-			render_device->render(r);
+			render_device->submit(r);
 		}
 		renderPowers(0);
 	}
@@ -1252,6 +1388,16 @@ void MenuPowers::render() {
 	}
 }
 
+void MenuPowers::prefetchIcons() {
+	if (!icons)
+		return;
+
+	for (size_t i=0; i<power_cell.size(); i++) {
+		if (static_cast<size_t>(power_cell[i].id) < powers->powers.size())
+			icons->prefetch(powers->powers[power_cell[i].id].icon);
+	}
+}
+
 /**
  * Show mouseover descriptions of disciplines and powers
  */
@@ -1263,7 +1409,7 @@ TooltipData MenuPowers::checkTooltip(const Point& mouse) {
 
 		if (tab_control && (tab_control->getActiveTab() != power_cell[i].tab)) continue;
 
-		int cell_index = getCellByPowerIndex(power_cell[i].id, power_cell_all);
+		int cell_index = getAllCellByPowerIndex(power_cell[i].id);
 		if (!checkCellVisible(cell_index)) continue;
 
 		if (slots[i] && isWithinRect(slots[i]->pos, mouse)) {
@@ -1306,13 +1452,15 @@ int MenuPowers::click(const Point& mouse) {
 				}
 			}
 
-			int cell_index = getCellByPowerIndex(power_cell[i].id, power_cell_all);
+			int cell_index = getAllCellByPowerIndex(power_cell[i].id);
 			if (checkUnlock(cell_index) && points_left > 0 && power_cell[i].requires_point) {
 				// unlock power
 				stats->powers_list.push_back(power_cell[i].id);
 				stats->check_title = true;
 				setUnlockedPowers();
 				action_bar->addPower(power_cell[i].id, 0);
+				if (enemies)
+					enemies->loadPowerCreatures(power_cell[i].id);
 				return 0;
 			}
 			else if (checkUnlocked(cell_index) && !powers->powers[power_cell[i].id].passive) {
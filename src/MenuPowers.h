@@ -92,10 +92,15 @@ private:
 	bool checkRequirements(int pci);
 	bool checkUnlocked(int pci);
 	bool checkCellVisible(int pci);
+	bool calcRequirements(int pci);
+	bool calcUnlocked(int pci);
+	bool calcCellVisible(int pci);
+	void updateCellCache();
 	bool checkUnlock(int pci);
 	bool checkUpgrade(int pci);
 
 	int getCellByPowerIndex(int power_index, const std::vector<Power_Menu_Cell>& cell);
+	int getAllCellByPowerIndex(int power_index);
 	int getNextLevelCell(int pci);
 
 	void replaceCellWithUpgrade(int pci, int uci);
@@ -143,6 +148,21 @@ private:
 
 	size_t prev_powers_list_size;
 
+	// power id -> index of its first cell in power_cell_all, or -1
+	std::vector<int> power_cell_all_index;
+
+	// results of the check functions for each cell of power_cell_all, -1 if not known yet
+	std::vector<int> cell_requirements;
+	std::vector<int> cell_unlocked;
+	std::vector<int> cell_visible;
+
+	// the hero state that the cached results were found for
+	int cache_level;
+	std::vector<int> cache_primary;
+	size_t cache_powers_list_size;
+	size_t cache_unlocked_size;
+	unsigned cache_status_revision;
+
 public:
 	MenuPowers(StatBlock *_stats, MenuActionBar *_action_bar);
 	~MenuPowers();
@@ -152,6 +172,7 @@ public:
 
 	void logic();
 	void render();
+	void prefetchIcons();
 
 	TooltipData checkTooltip(const Point& mouse);
 	int click(const Point& mouse);
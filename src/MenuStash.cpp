@@ -40,6 +40,7 @@ MenuStash::MenuStash(StatBlock *_stats)
 	, stock()
 	, updated(false)
 {
+	retained = true;
 
 	setBackground("images/menus/stash.png");
 
@@ -142,6 +143,10 @@ void MenuStash::render() {
 	stock.render();
 }
 
+void MenuStash::prefetchIcons() {
+	stock.prefetchIcons();
+}
+
 /**
  * Dragging and dropping an item can be used to rearrange the stash
  */
@@ -191,6 +196,8 @@ bool MenuStash::add(ItemStack stack, int slot, bool play_sound) {
 		return true;
 	}
 
+	setDirty();
+
 	if (play_sound) {
 		items->playSound(stack.item);
 	}
@@ -52,6 +52,7 @@ public:
 
 	void logic();
 	void render();
+	void prefetchIcons();
 	ItemStack click(const Point& position);
 	void itemReturn(ItemStack stack);
 	bool add(ItemStack stack, int slot, bool play_sound);
@@ -44,6 +44,7 @@ MenuStatBar::MenuStatBar(const std::string& type)
 	, orientation(0) // horizontal
 	, custom_text_pos(false) // label will be placed in the middle of the bar
 	, custom_string("")
+	, text("0/0")
 	, bar_gfx("")
 	, bar_gfx_background("")
 {
@@ -110,10 +111,21 @@ void MenuStatBar::loadGraphics() {
 }
 
 void MenuStatBar::update(unsigned long _stat_cur, unsigned long _stat_max, const Point& _mouse, const std::string& _custom_string) {
-	if (_custom_string != "") custom_string = _custom_string;
 	mouse = _mouse;
+
+	if (_stat_cur == stat_cur && _stat_max == stat_max && (_custom_string == "" || _custom_string == custom_string))
+		return;
+
+	if (_custom_string != "") custom_string = _custom_string;
 	stat_cur = _stat_cur;
 	stat_max = _stat_max;
+
+	std::stringstream ss;
+	if (custom_string != "")
+		ss << custom_string;
+	else
+		ss << stat_cur << "/" << stat_max;
+	text = ss.str();
 }
 
 void MenuStatBar::render() {
@@ -159,23 +171,17 @@ void MenuStatBar::render() {
 	if (bar) {
 		bar->setClip(src);
 		bar->setDest(dest);
-		render_device->render(bar);
+		render_device->submit(bar);
 	}
 
 	// if mouseover, draw text
 	if (!text_pos.hidden) {
-		if (custom_text_pos)
-			label->set(bar_dest.x+text_pos.x, bar_dest.y+text_pos.y, text_pos.justify, text_pos.valign, "", color_normal, text_pos.font_style);
-		else
-			label->set(bar_dest.x+bar_pos.w/2, bar_dest.y+bar_pos.h/2, JUSTIFY_CENTER, VALIGN_CENTER, "", color_normal);
-
 		if (STATBAR_LABELS || (inpt->usingMouse() && isWithinRect(bar_dest,mouse))) {
-			std::stringstream ss;
-			if (custom_string != "")
-				ss << custom_string;
+			// the label only draws its text again when the text or position changed
+			if (custom_text_pos)
+				label->set(bar_dest.x+text_pos.x, bar_dest.y+text_pos.y, text_pos.justify, text_pos.valign, text, color_normal, text_pos.font_style);
 			else
-				ss << stat_cur << "/" << stat_max;
-			label->set(ss.str());
+				label->set(bar_dest.x+bar_pos.w/2, bar_dest.y+bar_pos.h/2, JUSTIFY_CENTER, VALIGN_CENTER, text, color_normal);
 			label->render();
 		}
 	}
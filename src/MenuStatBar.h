@@ -44,6 +44,7 @@ private:
 	bool orientation;
 	bool custom_text_pos;
 	std::string custom_string;
+	std::string text; // the label text, only formatted again when the values change
 	Color color_normal;
 	std::string bar_gfx;
 	std::string bar_gfx_background;
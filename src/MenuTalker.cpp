@@ -94,6 +94,7 @@ MenuTalker::MenuTalker(MenuNPCActions *_npc_menu)
 	label_name->setBasePos(text_pos.x + text_offset.x, text_pos.y + text_offset.y);
 
 	textbox = new WidgetScrollBox(text_pos.w, text_pos.h-(text_offset.y*2));
+	textbox->setRenderer(renderDialog, this);
 	textbox->setBasePos(text_pos.x, text_pos.y + text_offset.y);
 
 	align();
@@ -186,8 +187,6 @@ void MenuTalker::createBuffer() {
 	if (static_cast<unsigned>(dialog_node) >= npc->dialog.size() || event_cursor >= npc->dialog[dialog_node].size())
 		return;
 
-	std::string line;
-
 	// speaker name
 	EVENT_COMPONENT_TYPE etype = npc->dialog[dialog_node][event_cursor].type;
 	std::string who;
@@ -202,24 +201,29 @@ void MenuTalker::createBuffer() {
 	label_name->set(window_area.x+text_pos.x+text_offset.x, window_area.y+text_pos.y+text_offset.y, JUSTIFY_LEFT, VALIGN_TOP, who, color_normal, font_who);
 
 
-	line = substituteVarsInString(npc->dialog[dialog_node][event_cursor].s, pc);
+	dialog_text = substituteVarsInString(npc->dialog[dialog_node][event_cursor].getString(), pc);
 
-	// render dialog text to the scrollbox buffer
-	Point line_size = font->calc_size(line,textbox->pos.w-(text_offset.x*2));
+	// the scroll box draws the dialog text as it comes into view
+	Point line_size = font->calc_size(dialog_text,textbox->pos.w-(text_offset.x*2));
 	textbox->resize(textbox->pos.w, line_size.y);
 	textbox->line_height = font->getLineHeight();
-	font->setFont(font_dialog);
+
+	align();
+}
+
+void MenuTalker::renderDialog(void *data, Image *target, int y) {
+	MenuTalker *talker = static_cast<MenuTalker*>(data);
+
+	font->setFont(talker->font_dialog);
 	font->render(
-		line,
-		text_offset.x,
-		0,
+		talker->dialog_text,
+		talker->text_offset.x,
+		-y,
 		JUSTIFY_LEFT,
-		textbox->contents->getGraphics(),
-		text_pos.w - text_offset.x*2,
-		color_normal
+		target,
+		talker->text_pos.w - talker->text_offset.x*2,
+		talker->color_normal
 	);
-
-	align();
 }
 
 void MenuTalker::render() {
@@ -254,7 +258,7 @@ void MenuTalker::render() {
 
 				npc->npc_portrait->setClip(src);
 				npc->npc_portrait->setDest(dest);
-				render_device->render(npc->npc_portrait);
+				render_device->submit(npc->npc_portrait);
 			}
 		}
 		else if (etype == EC_NPC_DIALOG_YOU) {
@@ -265,7 +269,7 @@ void MenuTalker::render() {
 				dest.y = offset_y + portrait_you.y;
 				npc->hero_portrait->setClip(src);
 				npc->hero_portrait->setDest(dest);
-				render_device->render(npc->hero_portrait);
+				render_device->submit(npc->hero_portrait);
 			}
 			else if (portrait) {
 				src.w = dest.w = portrait_you.w;
@@ -274,7 +278,7 @@ void MenuTalker::render() {
 				dest.y = offset_y + portrait_you.y;
 				portrait->setClip(src);
 				portrait->setDest(dest);
-				render_device->render(portrait);
+				render_device->submit(portrait);
 			}
 		}
 	}
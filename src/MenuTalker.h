@@ -38,6 +38,8 @@ class WidgetScrollBox;
 
 class MenuTalker : public Menu {
 private:
+	static void renderDialog(void *data, Image *target, int y);
+
 	MenuNPCActions *npc_menu;
 
 	Sprite *portrait;
@@ -60,6 +62,7 @@ private:
 
 	WidgetLabel *label_name;
 	WidgetScrollBox *textbox;
+	std::string dialog_text;
 
 public:
 	explicit MenuTalker(MenuNPCActions *_npc_menu);
@@ -45,6 +45,8 @@ MenuVendor::MenuVendor(StatBlock *_stats)
 	, color_normal(font->getColor("menu_normal"))
 	, npc(NULL)
 	, buyback_stock() {
+	retained = true;
+
 	setBackground("images/menus/vendor.png");
 
 	tabControl->setTabTitle(VENDOR_BUY, msg->get("Inventory"));
@@ -168,6 +170,7 @@ void MenuVendor::setTab(int tab) {
 	}
 	tabControl->setActiveTab(tab);
 	activetab = tab;
+	setDirty();
 }
 
 void MenuVendor::render() {
@@ -192,6 +195,10 @@ void MenuVendor::render() {
 	stock[activetab].render();
 }
 
+void MenuVendor::prefetchIcons() {
+	stock[activetab].prefetchIcons();
+}
+
 /**
  * Start dragging a vendor item
  * Players can drag an item to their inventory to purchase.
@@ -226,6 +233,7 @@ void MenuVendor::add(ItemStack stack) {
 	items->playSound(stack.item);
 	stock[VENDOR_SELL].add(stack);
 	saveInventory();
+	setDirty();
 }
 
 TooltipData MenuVendor::checkTooltip(const Point& position) {
@@ -262,6 +270,7 @@ void MenuVendor::sort(int type) {
 
 void MenuVendor::setNPC(NPC* _npc) {
 	npc = _npc;
+	setDirty();
 
 	if (_npc == NULL) {
 		visible = false;
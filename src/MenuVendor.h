@@ -65,6 +65,7 @@ public:
 		return activetab;
 	}
 	void render();
+	void prefetchIcons();
 	ItemStack click(const Point& position);
 	void itemReturn(ItemStack stack);
 	void add(ItemStack stack);
@@ -30,33 +30,402 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "GetText.h"
 #include "SharedResources.h"
 #include "Settings.h"
+#include "UtilsFileSystem.h"
 
-MessageEngine::MessageEngine() {
-	GetText infile;
+#include <cstring>
+#include <stdio.h>
 
-	std::vector<std::string> engineFiles = mods->list("languages/engine." + LANGUAGE + ".po");
-	if (engineFiles.empty() && LANGUAGE != "en")
-		logError("MessageEngine: Unable to open basic translation files located in languages/engine.%s.po", LANGUAGE.c_str());
+/**
+ * Arguments of a get() call. Integers are printed once, up front, into fixed buffers.
+ */
+class MessageArgs {
+public:
+	char d[2][24];
+	unsigned d_count;
+	const std::string* s;
 
-	for (unsigned i = 0; i < engineFiles.size(); ++i) {
-		if (infile.open(engineFiles[i])) {
-			while (infile.next() && !infile.fuzzy)
-				messages.insert(std::pair<std::string, std::string>(infile.key, infile.val));
-			infile.close();
+	MessageArgs()
+		: d_count(0)
+		, s(NULL) {
+	}
+
+	void addInt(int i) {
+		snprintf(d[d_count++], sizeof(d[0]), "%d", i);
+	}
+
+	void addULong(unsigned long i) {
+		snprintf(d[d_count++], sizeof(d[0]), "%lu", i);
+	}
+};
+
+static const char MESSAGE_CATALOG_MAGIC[8] = {'F', 'L', 'A', 'R', 'E', 'M', 'S', 'G'};
+
+/**
+ * Little-endian reader over a catalog file held in memory
+ * Reading past the end of the data clears ok instead of failing immediately.
+ */
+class MessageCatalogReader {
+public:
+	MessageCatalogReader(const std::vector<char>& _data)
+		: data(_data)
+		, pos(0)
+		, ok(true) {
+	}
+
+	uint32_t getUnsigned() {
+		if (pos + 4 > data.size()) {
+			ok = false;
+			return 0;
+		}
+		uint32_t value = 0;
+		for (int i = 3; i >= 0; --i)
+			value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+		pos += 4;
+		return value;
+	}
+
+	time_t getTime() {
+		uint64_t low = getUnsigned();
+		uint64_t high = getUnsigned();
+		return static_cast<time_t>(low | (high << 32));
+	}
+
+	void getString(std::string& value) {
+		size_t length = getUnsigned();
+		if (!ok || pos + length > data.size()) {
+			ok = false;
+			value.clear();
+			return;
 		}
+		value.assign(&data[0] + pos, length);
+		pos += length;
 	}
 
+	const std::vector<char>& data;
+	size_t pos;
+	bool ok;
+};
+
+static void putUnsigned(std::ofstream& outfile, uint32_t value) {
+	char bytes[4];
+	for (int i = 0; i < 4; ++i)
+		bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+	outfile.write(bytes, 4);
+}
+
+static void putTime(std::ofstream& outfile, time_t value) {
+	uint64_t bits = static_cast<uint64_t>(value);
+	putUnsigned(outfile, static_cast<uint32_t>(bits & 0xFFFFFFFF));
+	putUnsigned(outfile, static_cast<uint32_t>(bits >> 32));
+}
+
+static void putString(std::ofstream& outfile, const std::string& value) {
+	putUnsigned(outfile, static_cast<uint32_t>(value.length()));
+	outfile.write(value.c_str(), value.length());
+}
+
+/**
+ * FNV-1a
+ */
+static uint32_t hashKey(const std::string& key) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < key.length(); ++i) {
+		hash ^= static_cast<unsigned char>(key[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool compareKeyHash(const std::pair<uint32_t, size_t>& a, const std::pair<uint32_t, size_t>& b) {
+	return a.first < b.first;
+}
+
+/**
+ * Splits a message into its literal text and placeholder positions.
+ * "%%" is unescaped to "%", and the first placeholders of each type are
+ * replaced by get(); any others are kept as literal text.
+ */
+void MessageFormat::compile(const std::string& src) {
+	text.clear();
+	placeholders.clear();
+	text.reserve(src.length());
+
+	for (size_t i = 0; i < src.length(); ++i) {
+		if (src[i] == '%' && i+1 < src.length()) {
+			char next = src[i+1];
+			if (next == '%') {
+				text += '%';
+				++i;
+				continue;
+			}
+			else if (next == 'd' || next == 's') {
+				placeholders.push_back(std::pair<size_t, char>(text.length(), next));
+				++i;
+				continue;
+			}
+		}
+		text += src[i];
+	}
+}
+
+MessageEngine::MessageEngine() {
+	std::vector<std::string> po_files = mods->list("languages/engine." + LANGUAGE + ".po");
+	if (po_files.empty() && LANGUAGE != "en")
+		logError("MessageEngine: Unable to open basic translation files located in languages/engine.%s.po", LANGUAGE.c_str());
+
 	std::vector<std::string> dataFiles = mods->list("languages/data." + LANGUAGE + ".po");
 	if (dataFiles.empty() && LANGUAGE != "en")
 		logError("MessageEngine: Unable to open basic translation files located in languages/data.%s.po", LANGUAGE.c_str());
 
-	for (unsigned i = 0; i < dataFiles.size(); ++i) {
-		if (infile.open(dataFiles[i])) {
+	po_files.insert(po_files.end(), dataFiles.begin(), dataFiles.end());
+	if (po_files.empty())
+		return;
+
+	if (PARSER_CACHE && loadCatalog(po_files))
+		return;
+
+	GetText infile;
+	for (unsigned i = 0; i < po_files.size(); ++i) {
+		if (infile.open(po_files[i])) {
 			while (infile.next() && !infile.fuzzy)
-				messages.insert(std::pair<std::string, std::string>(infile.key, infile.val));
+				addMessage(infile.key, infile.val);
 			infile.close();
 		}
 	}
+
+	// stable, so that the first translation of a duplicate key is found first
+	std::stable_sort(key_index.begin(), key_index.end(), compareKeyHash);
+
+	if (PARSER_CACHE)
+		saveCatalog(po_files);
+}
+
+static std::string getCatalogPath() {
+	return PATH_USER + "cache/messages." + LANGUAGE + ".dat";
+}
+
+/**
+ * Loads the catalog written by saveCatalog(), if it was built from the same .po files.
+ * Everything is read in one go and nothing needs to be parsed or compiled.
+ */
+bool MessageEngine::loadCatalog(const std::vector<std::string>& po_files) {
+	std::vector<char> data;
+	if (!readFile(getCatalogPath(), data) || data.size() < sizeof(MESSAGE_CATALOG_MAGIC))
+		return false;
+
+	if (memcmp(&data[0], MESSAGE_CATALOG_MAGIC, sizeof(MESSAGE_CATALOG_MAGIC)) != 0)
+		return false;
+
+	MessageCatalogReader reader(data);
+	reader.pos = sizeof(MESSAGE_CATALOG_MAGIC);
+
+	if (reader.getUnsigned() != MESSAGE_CATALOG_VERSION)
+		return false;
+
+	// the catalog is stale if any .po file was added, removed or changed
+	if (reader.getUnsigned() != po_files.size())
+		return false;
+
+	std::string filename;
+	for (size_t i = 0; i < po_files.size(); ++i) {
+		reader.getString(filename);
+		if (!reader.ok || filename != po_files[i] || reader.getTime() != mods->getModifiedTime(po_files[i]))
+			return false;
+	}
+
+	size_t count = reader.getUnsigned();
+	if (!reader.ok || count > data.size())
+		return false;
+
+	keys.resize(count);
+	formats.resize(count);
+	key_index.resize(count);
+	for (size_t i = 0; i < count && reader.ok; ++i) {
+		reader.getString(keys[i]);
+		reader.getString(formats[i].text);
+
+		size_t placeholder_count = reader.getUnsigned();
+		for (size_t j = 0; j < placeholder_count && reader.ok; ++j) {
+			size_t offset = reader.getUnsigned();
+			char type = static_cast<char>(reader.getUnsigned());
+			if (offset > formats[i].text.length())
+				reader.ok = false;
+			formats[i].placeholders.push_back(std::pair<size_t, char>(offset, type));
+		}
+	}
+
+	for (size_t i = 0; i < count && reader.ok; ++i) {
+		key_index[i].first = reader.getUnsigned();
+		key_index[i].second = reader.getUnsigned();
+		if (key_index[i].second >= count)
+			reader.ok = false;
+	}
+
+	if (!reader.ok) {
+		logError("MessageEngine: '%s' is damaged and will be rebuilt.", getCatalogPath().c_str());
+		keys.clear();
+		formats.clear();
+		key_index.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void MessageEngine::saveCatalog(const std::vector<std::string>& po_files) {
+	createDir(PATH_USER + "cache");
+
+	std::ofstream outfile(getCatalogPath().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!outfile.is_open()) {
+		logError("MessageEngine: Could not write '%s'.", getCatalogPath().c_str());
+		return;
+	}
+
+	outfile.write(MESSAGE_CATALOG_MAGIC, sizeof(MESSAGE_CATALOG_MAGIC));
+	putUnsigned(outfile, MESSAGE_CATALOG_VERSION);
+
+	putUnsigned(outfile, static_cast<uint32_t>(po_files.size()));
+	for (size_t i = 0; i < po_files.size(); ++i) {
+		putString(outfile, po_files[i]);
+		putTime(outfile, mods->getModifiedTime(po_files[i]));
+	}
+
+	putUnsigned(outfile, static_cast<uint32_t>(keys.size()));
+	for (size_t i = 0; i < keys.size(); ++i) {
+		putString(outfile, keys[i]);
+		putString(outfile, formats[i].text);
+		putUnsigned(outfile, static_cast<uint32_t>(formats[i].placeholders.size()));
+		for (size_t j = 0; j < formats[i].placeholders.size(); ++j) {
+			putUnsigned(outfile, static_cast<uint32_t>(formats[i].placeholders[j].first));
+			putUnsigned(outfile, static_cast<uint32_t>(formats[i].placeholders[j].second));
+		}
+	}
+
+	for (size_t i = 0; i < key_index.size(); ++i) {
+		putUnsigned(outfile, key_index[i].first);
+		putUnsigned(outfile, static_cast<uint32_t>(key_index[i].second));
+	}
+
+	if (!outfile.good())
+		logError("MessageEngine: Could not write '%s'.", getCatalogPath().c_str());
+	outfile.close();
+}
+
+/**
+ * Empty translations are the same as missing ones, so they are not stored
+ */
+void MessageEngine::addMessage(const std::string& key, const std::string& val) {
+	if (val == "")
+		return;
+
+	key_index.push_back(std::pair<uint32_t, size_t>(hashKey(key), keys.size()));
+	keys.push_back(key);
+	formats.push_back(MessageFormat());
+	formats.back().compile(val);
+}
+
+/**
+ * Returns the index of the translation of key, or formats.size() if there is none.
+ * This doesn't modify the catalog, so maps can be parsed on another thread.
+ */
+size_t MessageEngine::find(const std::string& key) const {
+	std::pair<uint32_t, size_t> target(hashKey(key), 0);
+	std::vector<std::pair<uint32_t, size_t> >::const_iterator it = std::lower_bound(key_index.begin(), key_index.end(), target, compareKeyHash);
+
+	for (; it != key_index.end() && it->first == target.first; ++it) {
+		if (keys[it->second] == key)
+			return it->second;
+	}
+	return formats.size();
+}
+
+/**
+ * Untranslated handles get a format compiled from the key itself.
+ * These are kept apart from the catalog, which other threads may be reading.
+ */
+const MessageFormat& MessageEngine::resolve(StringHandle id) {
+	if (id >= handle_index.size())
+		handle_index.resize(id + 1, 0);
+
+	if (handle_index[id] == 0) {
+		const std::string& key = getInternedString(id);
+		size_t index = find(key);
+		if (index < formats.size()) {
+			handle_index[id] = static_cast<int>(index) + 1;
+		}
+		else {
+			untranslated.push_back(MessageFormat());
+			untranslated.back().compile(key);
+			handle_index[id] = -static_cast<int>(untranslated.size());
+		}
+	}
+
+	if (handle_index[id] > 0)
+		return formats[handle_index[id] - 1];
+	else
+		return untranslated[-handle_index[id] - 1];
+}
+
+StringHandle MessageEngine::getID(const std::string& key) {
+	StringHandle id = internString(key);
+	resolve(id);
+	return id;
+}
+
+std::string MessageEngine::format(const std::string& key, const MessageArgs& args) const {
+	std::string message;
+	size_t index = find(key);
+	if (index < formats.size()) {
+		format(formats[index], args, message);
+	}
+	else {
+		MessageFormat fmt;
+		fmt.compile(key);
+		format(fmt, args, message);
+	}
+	return message;
+}
+
+std::string MessageEngine::format(StringHandle id, const MessageArgs& args) {
+	std::string message;
+	format(resolve(id), args, message);
+	return message;
+}
+
+/**
+ * The first %s is replaced by the string argument, and the %d placeholders
+ * by the integer arguments in order.
+ */
+void MessageEngine::format(const MessageFormat& fmt, const MessageArgs& args, std::string& out) {
+	size_t length = fmt.text.length();
+	if (args.s)
+		length += args.s->length();
+	out.reserve(length + args.d_count * 4);
+
+	size_t pos = 0;
+	unsigned d_used = 0;
+	bool s_used = false;
+
+	for (size_t i = 0; i < fmt.placeholders.size(); ++i) {
+		out.append(fmt.text, pos, fmt.placeholders[i].first - pos);
+		pos = fmt.placeholders[i].first;
+
+		if (fmt.placeholders[i].second == 'd') {
+			if (d_used < args.d_count)
+				out += args.d[d_used++];
+			else
+				out += "%d";
+		}
+		else {
+			if (args.s && !s_used) {
+				out += *args.s;
+				s_used = true;
+			}
+			else
+				out += "%s";
+		}
+	}
+	out.append(fmt.text, pos, std::string::npos);
 }
 
 /*
@@ -64,87 +433,74 @@ MessageEngine::MessageEngine() {
  * They differ only on which variables they replace in the string - strings replace %s, integers replace %d
  */
 std::string MessageEngine::get(const std::string& key) {
-	std::string message = messages[key];
-	if (message == "") message = key;
-	return unescape(message);
+	return format(key, MessageArgs());
 }
 
 std::string MessageEngine::get(const std::string& key, int i) {
-	std::string message = messages[key];
-	if (message == "") message = key;
-	size_t index = message.find("%d");
-	if (index != std::string::npos) message = message.replace(index, 2, str(i));
-	return unescape(message);
+	MessageArgs args;
+	args.addInt(i);
+	return format(key, args);
 }
 
 std::string MessageEngine::get(const std::string& key, const std::string& s) {
-	std::string message = messages[key];
-	if (message == "") message = key;
-	size_t index = message.find("%s");
-	if (index != std::string::npos) message = message.replace(index, 2, s);
-	return unescape(message);
+	MessageArgs args;
+	args.s = &s;
+	return format(key, args);
 }
 
 std::string MessageEngine::get(const std::string& key, int i, const std::string& s) {
-	std::string message = messages[key];
-	if (message == "") message = key;
-	size_t index = message.find("%d");
-	if (index != std::string::npos) message = message.replace(index, 2, str(i));
-	index = message.find("%s");
-	if (index != std::string::npos) message = message.replace(index, 2, s);
-	return unescape(message);
+	MessageArgs args;
+	args.addInt(i);
+	args.s = &s;
+	return format(key, args);
 }
 
 std::string MessageEngine::get(const std::string& key, int i, int j) {
-	std::string message = messages[key];
-	if (message == "") message = key;
-	size_t index = message.find("%d");
-	if (index != std::string::npos) message = message.replace(index, 2, str(i));
-	index = message.find("%d");
-	if (index != std::string::npos) message = message.replace(index, 2, str(j));
-	return unescape(message);
+	MessageArgs args;
+	args.addInt(i);
+	args.addInt(j);
+	return format(key, args);
 }
 
 std::string MessageEngine::get(const std::string& key, unsigned long i) {
-	std::string message = messages[key];
-	if (message == "") message = key;
-	size_t index = message.find("%d");
-	if (index != std::string::npos) message = message.replace(index, 2, str(i));
-	return unescape(message);
+	MessageArgs args;
+	args.addULong(i);
+	return format(key, args);
 }
 
 std::string MessageEngine::get(const std::string& key, unsigned long i, unsigned long j) {
-	std::string message = messages[key];
-	if (message == "") message = key;
-	size_t index = message.find("%d");
-	if (index != std::string::npos) message = message.replace(index, 2, str(i));
-	index = message.find("%d");
-	if (index != std::string::npos) message = message.replace(index, 2, str(j));
-	return unescape(message);
+	MessageArgs args;
+	args.addULong(i);
+	args.addULong(j);
+	return format(key, args);
 }
 
-// Changes an int into a string
-std::string MessageEngine::str(int i) {
-	std::stringstream ss;
-	ss << i;
-	return ss.str();
+std::string MessageEngine::get(StringHandle id) {
+	return format(id, MessageArgs());
 }
 
-// Changes an unsigned long into a string
-std::string MessageEngine::str(unsigned long i) {
-	std::stringstream ss;
-	ss << i;
-	return ss.str();
+std::string MessageEngine::get(StringHandle id, int i) {
+	MessageArgs args;
+	args.addInt(i);
+	return format(id, args);
 }
 
-// unescape c formatted string
-std::string MessageEngine::unescape(const std::string& _val) {
-	std::string val = _val;
+std::string MessageEngine::get(StringHandle id, const std::string& s) {
+	MessageArgs args;
+	args.s = &s;
+	return format(id, args);
+}
 
-	// unescape percentage %% to %
-	size_t pos;
-	while ((pos = val.find("%%")) != std::string::npos)
-		val = val.replace(pos, 2, "%");
+std::string MessageEngine::get(StringHandle id, int i, const std::string& s) {
+	MessageArgs args;
+	args.addInt(i);
+	args.s = &s;
+	return format(id, args);
+}
 
-	return val;
+std::string MessageEngine::get(StringHandle id, int i, int j) {
+	MessageArgs args;
+	args.addInt(i);
+	args.addInt(j);
+	return format(id, args);
 }
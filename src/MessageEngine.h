@@ -31,16 +31,58 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #define MESSAGE_ENGINE_H
 
 #include "CommonIncludes.h"
+#include "Utils.h"
+
+class MessageArgs;
+
+// bumped whenever the layout of compiled translation catalogs changes
+const uint32_t MESSAGE_CATALOG_VERSION = 1;
+
+/**
+ * A message with its escapes resolved and its %d/%s placeholders located,
+ * so that formatting is a single pass of appends.
+ */
+class MessageFormat {
+public:
+	std::string text; // literal parts of the message, placeholders removed
+	std::vector<std::pair<size_t, char> > placeholders; // offset into text, and 'd' or 's'
+
+	void compile(const std::string& src);
+};
 
 class MessageEngine {
 
 private:
-	std::map<std::string,std::string> messages;
-	std::string str(int i);
-	std::string str(unsigned long i);
-	std::string unescape(const std::string& _val);
+	// translated messages, indexed by the order they were read
+	std::vector<std::string> keys;
+	std::vector<MessageFormat> formats;
+
+	// (key hash, index into keys), sorted by hash
+	std::vector<std::pair<uint32_t, size_t> > key_index;
+
+	// keys resolved with getID() that have no translation
+	std::vector<MessageFormat> untranslated;
+
+	// for each resolved handle: formats index + 1, or -(untranslated index + 1). 0 if not resolved yet
+	std::vector<int> handle_index;
+
+	void addMessage(const std::string& key, const std::string& val);
+
+	bool loadCatalog(const std::vector<std::string>& po_files);
+	void saveCatalog(const std::vector<std::string>& po_files);
+	size_t find(const std::string& key) const;
+	const MessageFormat& resolve(StringHandle id);
+
+	std::string format(const std::string& key, const MessageArgs& args) const;
+	std::string format(StringHandle id, const MessageArgs& args);
+	static void format(const MessageFormat& fmt, const MessageArgs& args, std::string& out);
 public:
 	MessageEngine();
+
+	// returns a handle that can be passed to get() instead of the key.
+	// Handles stay valid when the language is changed. Not thread-safe.
+	StringHandle getID(const std::string& key);
+
 	std::string get(const std::string& key);
 	std::string get(const std::string& key, int i);
 	std::string get(const std::string& key, const std::string& s);
@@ -48,6 +90,13 @@ public:
 	std::string get(const std::string& key, int i, int j);
 	std::string get(const std::string& key, unsigned long i);
 	std::string get(const std::string& key, unsigned long i, unsigned long j);
+
+	// same as above, for keys resolved with getID(). Not thread-safe.
+	std::string get(StringHandle id);
+	std::string get(StringHandle id, int i);
+	std::string get(StringHandle id, const std::string& s);
+	std::string get(StringHandle id, int i, const std::string& s);
+	std::string get(StringHandle id, int i, int j);
 };
 
 #endif
@@ -0,0 +1,301 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "CommonIncludes.h"
+#include "ModArchive.h"
+#include "SharedResources.h"
+#include "UtilsFileSystem.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MOD_ARCHIVE_MAGIC[8] = {'F','L','A','R','E','P','A','K'};
+
+static uint32_t readArchiveUnsigned(const char *p) {
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; --i)
+		value = (value << 8) | static_cast<unsigned char>(p[i]);
+	return value;
+}
+
+static void writeArchiveUnsigned(std::ofstream& outfile, uint32_t value) {
+	char buf[4];
+	for (int i = 0; i < 4; ++i)
+		buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+	outfile.write(buf, 4);
+}
+
+ModArchive::ModArchive()
+	: path("")
+	, data(NULL)
+	, data_size(0)
+	, file_handle(NULL)
+	, map_handle(NULL) {
+}
+
+ModArchive::~ModArchive() {
+	close();
+}
+
+/**
+ * Maps the archive into memory and reads its table of contents
+ */
+bool ModArchive::open(const std::string& _path) {
+	close();
+	path = _path;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	file_handle = file;
+
+	DWORD size_high = 0;
+	DWORD size_low = GetFileSize(file, &size_high);
+	if (size_high != 0 || size_low == 0) {
+		close();
+		return false;
+	}
+	data_size = static_cast<size_t>(size_low);
+
+	map_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map_handle)
+		data = static_cast<const char*>(MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0));
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		data_size = static_cast<size_t>(st.st_size);
+		void *mapped = mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED)
+			data = static_cast<const char*>(mapped);
+	}
+
+	// the mapping stays valid after the file is closed
+	::close(fd);
+#endif
+
+	if (!data || !readContents()) {
+		logError("ModArchive: Could not read the archive '%s'", path.c_str());
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+bool ModArchive::readContents() {
+	if (data_size < sizeof(MOD_ARCHIVE_MAGIC) + 8 || memcmp(data, MOD_ARCHIVE_MAGIC, sizeof(MOD_ARCHIVE_MAGIC)) != 0)
+		return false;
+
+	size_t pos = sizeof(MOD_ARCHIVE_MAGIC);
+	if (readArchiveUnsigned(data + pos) != MOD_ARCHIVE_VERSION)
+		return false;
+
+	uint32_t count = readArchiveUnsigned(data + pos + 4);
+	pos += 8;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		if (pos + 4 > data_size)
+			return false;
+		uint32_t name_length = readArchiveUnsigned(data + pos);
+		pos += 4;
+
+		if (pos + name_length + 8 > data_size)
+			return false;
+		std::string name(data + pos, name_length);
+		pos += name_length;
+
+		ModArchiveEntry entry;
+		entry.offset = readArchiveUnsigned(data + pos);
+		entry.size = readArchiveUnsigned(data + pos + 4);
+		pos += 8;
+
+		if (static_cast<size_t>(entry.offset) + entry.size > data_size)
+			return false;
+
+		entries[name] = entry;
+	}
+
+	return true;
+}
+
+void ModArchive::close() {
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (map_handle)
+		CloseHandle(static_cast<HANDLE>(map_handle));
+	if (file_handle)
+		CloseHandle(static_cast<HANDLE>(file_handle));
+#else
+	if (data)
+		munmap(const_cast<char*>(data), data_size);
+#endif
+
+	data = NULL;
+	data_size = 0;
+	file_handle = NULL;
+	map_handle = NULL;
+	entries.clear();
+}
+
+const char* ModArchive::getData(const std::string& name, size_t& size) const {
+	std::map<std::string, ModArchiveEntry>::const_iterator it = entries.find(name);
+	if (it == entries.end())
+		return NULL;
+
+	size = it->second.size;
+	return data + it->second.offset;
+}
+
+bool ModArchive::write(const std::string& dir, const std::string& archive_path) {
+	std::vector<std::string> files;
+	getFileTree(dir, "", files);
+	std::sort(files.begin(), files.end());
+
+	// the table of contents has to be sized first, since it holds the data offsets
+	size_t offset = sizeof(MOD_ARCHIVE_MAGIC) + 8;
+	for (size_t i = 0; i < files.size(); ++i) {
+		offset += 12 + files[i].length();
+	}
+
+	std::vector<uint32_t> sizes(files.size(), 0);
+	for (size_t i = 0; i < files.size(); ++i) {
+		std::ifstream infile((dir + "/" + files[i]).c_str(), std::ios::in | std::ios::binary);
+		infile.seekg(0, std::ios::end);
+		sizes[i] = static_cast<uint32_t>(infile.tellg());
+	}
+
+	std::ofstream outfile(archive_path.c_str(), std::ios::out | std::ios::binary);
+	if (!outfile.is_open()) {
+		logError("ModArchive: Could not write '%s'", archive_path.c_str());
+		return false;
+	}
+
+	outfile.write(MOD_ARCHIVE_MAGIC, sizeof(MOD_ARCHIVE_MAGIC));
+	writeArchiveUnsigned(outfile, MOD_ARCHIVE_VERSION);
+	writeArchiveUnsigned(outfile, static_cast<uint32_t>(files.size()));
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		writeArchiveUnsigned(outfile, static_cast<uint32_t>(files[i].length()));
+		outfile.write(files[i].c_str(), files[i].length());
+		writeArchiveUnsigned(outfile, static_cast<uint32_t>(offset));
+		writeArchiveUnsigned(outfile, sizes[i]);
+		offset += sizes[i];
+	}
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		std::ifstream infile((dir + "/" + files[i]).c_str(), std::ios::in | std::ios::binary);
+		if (sizes[i] > 0)
+			outfile << infile.rdbuf();
+	}
+
+	bool ok = outfile.good();
+	outfile.close();
+
+	if (!ok)
+		logError("ModArchive: Could not write '%s'", archive_path.c_str());
+	return ok;
+}
+
+
+void ModArchiveBuffer::setData(const char *_data, size_t size) {
+	// the buffer is never written to, so dropping const is safe here
+	char *begin = const_cast<char*>(_data);
+	setg(begin, begin, begin + size);
+}
+
+ModArchiveBuffer::pos_type ModArchiveBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode mode) {
+	if (!(mode & std::ios_base::in))
+		return pos_type(off_type(-1));
+
+	off_type target = off;
+	if (dir == std::ios_base::cur)
+		target += gptr() - eback();
+	else if (dir == std::ios_base::end)
+		target += egptr() - eback();
+
+	if (target < 0 || target > egptr() - eback())
+		return pos_type(off_type(-1));
+
+	setg(eback(), eback() + target, egptr());
+	return pos_type(target);
+}
+
+ModArchiveBuffer::pos_type ModArchiveBuffer::seekpos(pos_type pos, std::ios_base::openmode mode) {
+	return seekoff(off_type(pos), std::ios_base::beg, mode);
+}
+
+
+ModFileStream::ModFileStream()
+	: std::istream(NULL)
+	, data_open(false) {
+	rdbuf(&archive_buf);
+}
+
+ModFileStream::~ModFileStream() {
+}
+
+void ModFileStream::open(const std::string& filename, std::ios_base::openmode mode) {
+	size_t size = 0;
+	const char *archive_data = mods ? mods->getArchiveData(filename, size) : NULL;
+	if (archive_data) {
+		openData(archive_data, size);
+		return;
+	}
+
+	// files are always read as binary; getLine() strips carriage returns
+	(void)mode;
+
+	close();
+	if (readFile(filename, file_data)) {
+		archive_buf.setData(file_data.data(), file_data.size());
+		data_open = true;
+	}
+	else {
+		setstate(std::ios_base::failbit);
+	}
+}
+
+void ModFileStream::openData(const char *data, size_t size) {
+	close();
+	archive_buf.setData(data, size);
+	data_open = true;
+}
+
+bool ModFileStream::is_open() const {
+	return data_open;
+}
+
+void ModFileStream::close() {
+	archive_buf.setData(NULL, 0);
+	std::string().swap(file_data);
+	data_open = false;
+	clear();
+}
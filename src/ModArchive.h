@@ -0,0 +1,116 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class ModArchive
+ *
+ * A mod packed into a single read-only file, which is memory-mapped once it is mounted.
+ * The file starts with a table of contents, followed by the contents of every file:
+ *
+ *   "FLAREPAK", version, file count
+ *   for each file: name length, name, offset, size
+ *   file data
+ *
+ * All numbers are little-endian uint32. Offsets are from the start of the archive.
+ * Files inside an archive are addressed as "<archive path>/<name>", the same way
+ * they would be inside a mod folder.
+ */
+
+#ifndef MOD_ARCHIVE_H
+#define MOD_ARCHIVE_H
+
+#include "CommonIncludes.h"
+
+#include <stdint.h>
+
+const std::string MOD_ARCHIVE_EXTENSION = ".pak";
+const uint32_t MOD_ARCHIVE_VERSION = 1;
+
+class ModArchiveEntry {
+public:
+	uint32_t offset;
+	uint32_t size;
+
+	ModArchiveEntry()
+		: offset(0)
+		, size(0) {
+	}
+};
+
+class ModArchive {
+private:
+	bool readContents();
+
+	std::string path;
+	const char *data;
+	size_t data_size;
+	void *file_handle;
+	void *map_handle;
+
+public:
+	ModArchive();
+	ModArchive(const ModArchive&); // not implemented
+	~ModArchive();
+
+	bool open(const std::string& _path);
+	void close();
+
+	// returns the contents of the named file, or NULL if the archive doesn't contain it
+	const char* getData(const std::string& name, size_t& size) const;
+
+	const std::string& getPath() const { return path; }
+
+	// packs every file below dir into a new archive at archive_path
+	static bool write(const std::string& dir, const std::string& archive_path);
+
+	std::map<std::string, ModArchiveEntry> entries;
+};
+
+/**
+ * Read-only stream buffer over a block of memory, such as a file in a mapped archive
+ */
+class ModArchiveBuffer : public std::streambuf {
+public:
+	void setData(const char *_data, size_t size);
+
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode mode);
+	pos_type seekpos(pos_type pos, std::ios_base::openmode mode);
+};
+
+/**
+ * Input stream for a located file. It reads from a mounted archive when the path
+ * points into one. Otherwise, the whole file is read through readFile(), so that
+ * files in the Android APK can be opened too.
+ */
+class ModFileStream : public std::istream {
+private:
+	ModArchiveBuffer archive_buf;
+	std::string file_data;
+	bool data_open;
+
+public:
+	ModFileStream();
+	~ModFileStream();
+
+	void open(const std::string& filename, std::ios_base::openmode mode = std::ios_base::in);
+	void openData(const char *data, size_t size);
+	bool is_open() const;
+	void close();
+};
+
+#endif // MOD_ARCHIVE_H
@@ -57,7 +57,10 @@ bool Mod::operator!= (const Mod &mod) const {
 }
 
 ModManager::ModManager(const std::vector<std::string> *_cmd_line_mods)
-	: cmd_line_mods(_cmd_line_mods)
+	: loc_mutex(SDL_CreateMutex())
+	, index_built(false)
+	, cmd_line_mods(_cmd_line_mods)
+	, parser_cache(this)
 {
 	loc_cache.clear();
 	mod_dirs.clear();
@@ -67,6 +70,7 @@ ModManager::ModManager(const std::vector<std::string> *_cmd_line_mods)
 	std::vector<std::string> mod_dirs_other;
 	getDirList(PATH_DATA + "mods", mod_dirs_other);
 	getDirList(PATH_USER + "mods", mod_dirs_other);
+	mountArchives(mod_dirs_other);
 
 	for (unsigned i=0; i<mod_dirs_other.size(); ++i) {
 		if (find(mod_dirs.begin(), mod_dirs.end(), mod_dirs_other[i]) == mod_dirs.end())
@@ -99,18 +103,17 @@ void ModManager::loadModList() {
 
 	// Add all other mods.
 	if (!cmd_line_mods || cmd_line_mods->empty()) {
-		std::ifstream infile;
+		ModFileStream infile;
 		std::string line;
 		std::string starts_with;
 
 		std::string place1 = PATH_CONF + "mods.txt";
 		std::string place2 = PATH_DATA + "mods/mods.txt";
 
-		infile.open(place1.c_str(), std::ios::in);
+		infile.open(place1);
 
 		if (!infile.is_open()) {
-			infile.clear();
-			infile.open(place2.c_str(), std::ios::in);
+			infile.open(place2);
 		}
 		if (!infile.is_open()) {
 			logError("ModManager: Error during loadModList() -- couldn't open mods.txt, to be located at:");
@@ -168,58 +171,143 @@ void ModManager::loadModList() {
 	}
 }
 
+/**
+ * Mounts each archive in the mods folders, and adds the mod names they provide to names
+ */
+void ModManager::mountArchives(std::vector<std::string>& names) {
+	for (size_t i = 0; i < mod_paths.size(); ++i) {
+		std::vector<std::string> files;
+		getFileList(mod_paths[i] + "mods", MOD_ARCHIVE_EXTENSION, files);
+
+		for (size_t j = 0; j < files.size(); ++j) {
+			ModArchive *archive = new ModArchive();
+			if (!archive->open(files[j])) {
+				delete archive;
+				continue;
+			}
+			archives.push_back(archive);
+
+			size_t slash = files[j].rfind('/');
+			std::string name = files[j].substr(slash + 1, files[j].length() - slash - 1 - MOD_ARCHIVE_EXTENSION.length());
+			names.push_back(name);
+		}
+	}
+}
+
+void ModManager::addToIndex(const std::string& mod_folder, const std::string& filename) {
+	index.files[filename].push_back(mod_folder);
+
+	// same filter as getFileList(), which list() used for directories
+	if (filename.length() > 3 && filename.compare(filename.length() - 3, 3, "txt") == 0) {
+		size_t slash = filename.rfind('/');
+		std::string dir = (slash == std::string::npos) ? "" : filename.substr(0, slash);
+		std::string name = (slash == std::string::npos) ? filename : filename.substr(slash + 1);
+		index.dirs[dir].push_back(std::pair<std::string, std::string>(mod_folder, name));
+	}
+}
+
+/**
+ * Walks every mod folder once, so that locate() and list() don't have to touch the disk.
+ * Folders are visited in list() order: lowest priority mod first, and within a mod,
+ * the mod paths from last to first. A mod folder overrides an archive of the same mod.
+ */
+void ModManager::buildIndex() {
+	index.files.clear();
+	index.dirs.clear();
+
+	std::vector<std::string> files;
+
+	for (size_t i = 0; i < mod_list.size(); ++i) {
+		for (size_t j = mod_paths.size(); j > 0; j--) {
+			std::string mod_folder = mod_paths[j-1] + "mods/" + mod_list[i].name;
+
+			for (size_t k = 0; k < archives.size(); ++k) {
+				if (archives[k]->getPath() != mod_folder + MOD_ARCHIVE_EXTENSION)
+					continue;
+
+				std::map<std::string, ModArchiveEntry>::const_iterator it;
+				for (it = archives[k]->entries.begin(); it != archives[k]->entries.end(); ++it) {
+					addToIndex(archives[k]->getPath() + "/", it->first);
+				}
+			}
+
+			files.clear();
+			getFileTree(mod_folder + "/", "", files);
+
+			for (size_t k = 0; k < files.size(); ++k) {
+				addToIndex(mod_folder + "/", files[k]);
+			}
+		}
+	}
+
+	index_built = true;
+}
+
 /**
  * Find the location (mod file name) for this data file.
  * Use private loc_cache to prevent excessive disk I/O
  */
 std::string ModManager::locate(const std::string& filename) {
+	SDL_LockMutex(loc_mutex);
+
 	// if we have this location already cached, return it
-	if (loc_cache.find(filename) != loc_cache.end()) {
-		return loc_cache[filename];
+	std::map<std::string,std::string>::iterator it = loc_cache.find(filename);
+	if (it != loc_cache.end()) {
+		std::string cached = it->second;
+		SDL_UnlockMutex(loc_mutex);
+		return cached;
 	}
 
-	// search through mods for the first instance of this filename
+	if (!index_built)
+		buildIndex();
+
+	// the last mod folder in the index has the highest priority
 	std::string test_path;
 
-	for (size_t i = mod_list.size(); i > 0; i--) {
-		for (size_t j = 0; j < mod_paths.size(); j++) {
-			test_path = mod_paths[j] + "mods/" + mod_list[i-1].name + "/" + filename;
-			if (fileExists(test_path)) {
-				loc_cache[filename] = test_path;
-				return test_path;
-			}
-		}
+	std::map<std::string, std::vector<std::string> >::iterator found = index.files.find(filename);
+	if (found != index.files.end()) {
+		test_path = found->second.back() + filename;
+	}
+	else {
+		// all else failing, simply return the filename if it exists
+		test_path = PATH_DATA + filename;
+		if (!fileExists(test_path))
+			test_path = "";
 	}
 
-	// all else failing, simply return the filename if it exists
-	test_path = PATH_DATA + filename;
-	if (!fileExists(test_path))
-		test_path = "";
-
+	// misses are cached too, since the mod folders have been searched already
+	loc_cache[filename] = test_path;
+	SDL_UnlockMutex(loc_mutex);
 	return test_path;
 }
 
-void amendPathToVector(const std::string &path, std::vector<std::string> &vec) {
-	if (pathExists(path)) {
-		if (isDirectory(path)) {
-			getFileList(path, "txt", vec);
-		}
-		else {
-			vec.push_back(path);
-		}
-	}
-}
-
 std::vector<std::string> ModManager::list(const std::string &path, bool full_paths) {
 	std::vector<std::string> ret;
-	std::string test_path;
 
-	for (size_t i = 0; i < mod_list.size(); ++i) {
-		for (size_t j = mod_paths.size(); j > 0; j--) {
-			test_path = mod_paths[j-1] + "mods/" + mod_list[i].name + "/" + path;
-			amendPathToVector(test_path, ret);
+	// the index is built on first use, which may be on one of the loading threads
+	SDL_LockMutex(loc_mutex);
+	if (!index_built)
+		buildIndex();
+
+	std::map<std::string, std::vector<std::string> >::iterator file = index.files.find(path);
+	if (file != index.files.end()) {
+		for (size_t i = 0; i < file->second.size(); ++i) {
+			ret.push_back(file->second[i] + path);
+		}
+	}
+	else {
+		std::string dir = path;
+		while (!dir.empty() && dir[dir.length()-1] == '/')
+			dir.erase(dir.length()-1);
+
+		std::map<std::string, std::vector<std::pair<std::string, std::string> > >::iterator found = index.dirs.find(dir);
+		if (found != index.dirs.end()) {
+			for (size_t i = 0; i < found->second.size(); ++i) {
+				ret.push_back(found->second[i].first + path + "/" + found->second[i].second);
+			}
 		}
 	}
+	SDL_UnlockMutex(loc_mutex);
 
 	// we don't need to check for duplicates if there are no paths
 	if (ret.empty()) return ret;
@@ -244,6 +332,46 @@ std::vector<std::string> ModManager::list(const std::string &path, bool full_pat
 	return ret;
 }
 
+std::vector<std::string> ModManager::listTree(const std::string &path) {
+	std::vector<std::string> ret;
+
+	SDL_LockMutex(loc_mutex);
+	if (!index_built)
+		buildIndex();
+
+	const std::string prefix = path + "/";
+	std::map<std::string, std::vector<std::string> >::const_iterator it;
+	for (it = index.files.lower_bound(prefix); it != index.files.end(); ++it) {
+		if (it->first.compare(0, prefix.length(), prefix) != 0)
+			break;
+		ret.push_back(it->first);
+	}
+	SDL_UnlockMutex(loc_mutex);
+
+	return ret;
+}
+
+/**
+ * The compiled file must belong to the mod that provides the text file, and must be newer than every part of it
+ */
+std::string ModManager::locateCompiled(const std::string& filename, const std::string& extension) {
+	const std::string compiled_file = locate(filename + extension);
+	if (compiled_file.empty())
+		return "";
+
+	std::vector<std::string> text_files = list(filename);
+	if (!text_files.empty() && text_files.back() + extension != compiled_file)
+		return "";
+
+	const time_t compiled_time = getFileModifiedTime(compiled_file);
+	for (size_t i = 0; i < text_files.size(); ++i) {
+		if (getFileModifiedTime(text_files[i]) > compiled_time)
+			return "";
+	}
+
+	return compiled_file;
+}
+
 void ModManager::setPaths() {
 	// set some flags if directories are identical
 	bool uniq_path_data = PATH_USER != PATH_DATA;
@@ -260,7 +388,7 @@ void ModManager::setPaths() {
 
 Mod ModManager::loadMod(const std::string& name) {
 	Mod mod;
-	std::ifstream infile;
+	ModFileStream infile;
 	std::string starts_with, line, key, val;
 
 	mod.name = name;
@@ -269,6 +397,13 @@ Mod ModManager::loadMod(const std::string& name) {
 		std::string path = mod_paths[i] + "mods/" + name + "/settings.txt";
 		infile.open(path.c_str(), std::ios::in);
 
+		if (!infile.is_open()) {
+			size_t size = 0;
+			const char *archive_data = getArchiveData(mod_paths[i] + "mods/" + name + MOD_ARCHIVE_EXTENSION + "/settings.txt", size);
+			if (archive_data)
+				infile.openData(archive_data, size);
+		}
+
 		while (infile.good()) {
 			line = getLine(infile);
 			key = "";
@@ -400,6 +535,10 @@ void ModManager::applyDepends() {
 
 	mod_list = new_mods;
 
+	// the mod list has changed, so anything found so far may be out of date
+	loc_cache.clear();
+	index_built = false;
+
 	// run recursivly until no more dependencies need to be met
 	if (!finished)
 		applyDepends();
@@ -443,5 +582,52 @@ void ModManager::resetModConfig() {
 	removeFile(config_path);
 }
 
+const char* ModManager::getArchiveData(const std::string& path, size_t& size) const {
+	for (size_t i = 0; i < archives.size(); ++i) {
+		const std::string& archive_path = archives[i]->getPath();
+		if (path.length() > archive_path.length() && path[archive_path.length()] == '/' && path.compare(0, archive_path.length(), archive_path) == 0)
+			return archives[i]->getData(path.substr(archive_path.length() + 1), size);
+	}
+	return NULL;
+}
+
+SDL_RWops* ModManager::openRW(const std::string& path) const {
+	size_t size = 0;
+	const char *archive_data = getArchiveData(path, size);
+	if (archive_data)
+		return SDL_RWFromConstMem(archive_data, static_cast<int>(size));
+
+	return SDL_RWFromFile(path.c_str(), "rb");
+}
+
+time_t ModManager::getModifiedTime(const std::string& path) const {
+	for (size_t i = 0; i < archives.size(); ++i) {
+		const std::string& archive_path = archives[i]->getPath();
+		if (path.length() > archive_path.length() && path[archive_path.length()] == '/' && path.compare(0, archive_path.length(), archive_path) == 0)
+			return getFileModifiedTime(archive_path);
+	}
+	return getFileModifiedTime(path);
+}
+
+bool ModManager::packMod(const std::string& name) {
+	for (size_t i = 0; i < mod_paths.size(); ++i) {
+		std::string mod_folder = mod_paths[i] + "mods/" + name;
+		if (isDirectory(mod_folder, false)) {
+			logInfo("ModManager: Packing '%s' into '%s'.", mod_folder.c_str(), (mod_folder + MOD_ARCHIVE_EXTENSION).c_str());
+			return ModArchive::write(mod_folder, mod_folder + MOD_ARCHIVE_EXTENSION);
+		}
+	}
+
+	logError("ModManager: Mod \"%s\" not found, can't pack it", name.c_str());
+	return false;
+}
+
 ModManager::~ModManager() {
+	parser_cache.save();
+
+	for (size_t i = 0; i < archives.size(); ++i) {
+		delete archives[i];
+	}
+
+	SDL_DestroyMutex(loc_mutex);
 }
@@ -30,6 +30,8 @@ mods in priority order when loading data files.
 #define FALLBACK_GAME "default"
 
 #include "CommonIncludes.h"
+#include "ModArchive.h"
+#include "ParserCache.h"
 
 class Mod {
 public:
@@ -49,14 +51,37 @@ public:
 	std::vector<std::string> depends;
 };
 
+/**
+ * Every file found in a mod folder, in the order that ModManager::list() returns them.
+ * The last entry of a file is the one that locate() picks.
+ */
+class ModFileIndex {
+public:
+	// relative filename -> mod folders containing it
+	std::map<std::string, std::vector<std::string> > files;
+
+	// relative directory -> (mod folder, filename) of the "txt" files directly inside it
+	std::map<std::string, std::vector<std::pair<std::string, std::string> > > dirs;
+};
+
 class ModManager {
 private:
 	void loadModList();
 	void setPaths();
+	void mountArchives(std::vector<std::string>& names);
+	void buildIndex();
+	void addToIndex(const std::string& mod_folder, const std::string& filename);
 
 	std::map<std::string,std::string> loc_cache;
+	SDL_mutex *loc_mutex; // guards loc_cache and index; locate() and list() may be called from the startup loading threads
 	std::vector<std::string> mod_paths;
 
+	ModFileIndex index;
+	bool index_built;
+
+	// every archive found in the mod paths, mounted once at startup so that they can be read from any thread
+	std::vector<ModArchive*> archives;
+
 	const std::vector<std::string> *cmd_line_mods;
 
 public:
@@ -81,8 +106,31 @@ public:
 	// that can be passed to locate() later
 	std::vector<std::string> list(const std::string& path, bool full_paths = true);
 
+	// Returns the generic filenames of the files anywhere below the path, in any mod
+	std::vector<std::string> listTree(const std::string& path);
+
+	// Returns the compiled version of a generic file, which is the located file with
+	// the extension appended, or an empty string if it is missing or older than any
+	// mod's copy of the text file
+	std::string locateCompiled(const std::string& filename, const std::string& extension);
+
+	// Returns the contents of a located file if it is inside a mounted archive, or NULL if it isn't.
+	// Safe to call from any thread.
+	const char* getArchiveData(const std::string& path, size_t& size) const;
+
+	// opens a located file for SDL, from a mounted archive or from the disk
+	SDL_RWops* openRW(const std::string& path) const;
+
+	// returns the modification time of a located file, or of the archive it is in
+	time_t getModifiedTime(const std::string& path) const;
+
+	// writes the folder of the named mod into a single archive next to it
+	bool packMod(const std::string& name);
+
 	std::vector<std::string> mod_dirs;
 	std::vector<Mod> mod_list;
+
+	ParserCache parser_cache;
 };
 
 #endif
@@ -80,12 +80,12 @@ void NPC::load(const std::string& npc_id) {
 					// @ATTR dialog.him|repeatable(string)|A line of dialog from the NPC.
 					// @ATTR dialog.her|repeatable(string)|A line of dialog from the NPC.
 					e.type = EC_NPC_DIALOG_THEM;
-					e.s = msg->get(infile.val);
+					e.setString(msg->get(infile.val));
 				}
 				else if (infile.key == "you") {
 					// @ATTR dialog.you|repeatable(string)|A line of dialog from the player.
 					e.type = EC_NPC_DIALOG_YOU;
-					e.s = msg->get(infile.val);
+					e.setString(msg->get(infile.val));
 				}
 				else if (infile.key == "voice") {
 					// @ATTR dialog.voice|repeatable(string)|Filename of a voice sound file to play.
@@ -95,30 +95,30 @@ void NPC::load(const std::string& npc_id) {
 				else if (infile.key == "topic") {
 					// @ATTR dialog.topic|string|The name of this dialog topic. Displayed when picking a dialog tree.
 					e.type = EC_NPC_DIALOG_TOPIC;
-					e.s = msg->get(infile.val);
+					e.setString(msg->get(infile.val));
 				}
 				else if (infile.key == "group") {
 					// @ATTR dialog.group|string|Dialog group.
 					e.type = EC_NPC_DIALOG_GROUP;
-					e.s = infile.val;
+					e.setString(infile.val);
 				}
 				else if (infile.key == "allow_movement") {
 					// @ATTR dialog.allow_movement|bool|Restrict the player's mvoement during dialog.
 					e.type = EC_NPC_ALLOW_MOVEMENT;
-					e.s = infile.val;
+					e.setString(infile.val);
 				}
 				else if (infile.key == "portrait_him" || infile.key == "portrait_her") {
 					// @ATTR dialog.portrait_him|repeatable(filename)|Filename of a portrait to display for the NPC during this dialog.
 					// @ATTR dialog.portrait_her|repeatable(filename)|Filename of a portrait to display for the NPC during this dialog.
 					e.type = EC_NPC_PORTRAIT_THEM;
-					e.s = infile.val;
-					portrait_filenames.push_back(e.s);
+					e.setString(infile.val);
+					portrait_filenames.push_back(e.getString());
 				}
 				else if (infile.key == "portrait_you") {
 					// @ATTR dialog.portrait_you|repeatable(filename)|Filename of a portrait to display for the player during this dialog.
 					e.type = EC_NPC_PORTRAIT_YOU;
-					e.s = infile.val;
-					portrait_filenames.push_back(e.s);
+					e.setString(infile.val);
+					portrait_filenames.push_back(e.getString());
 				}
 				else {
 					Event ev;
@@ -253,8 +253,7 @@ void NPC::loadGraphics() {
 
 	if (gfx != "") {
 		anim->increaseCount(gfx);
-		animationSet = anim->getAnimationSet(gfx);
-		activeAnimation = animationSet->getAnimation("");
+		setAnimationSet(anim->getAnimationSet(gfx));
 	}
 
 	portraits.resize(portrait_filenames.size(), NULL);
@@ -307,7 +306,7 @@ bool NPC::playSound(int type, int id) {
 	if (type == NPC_VOX_INTRO) {
 		int roll;
 		if (vox_intro.empty()) return false;
-		roll = rand() % static_cast<int>(vox_intro.size());
+		roll = randInt(static_cast<int>(vox_intro.size()));
 		snd->play(vox_intro[roll], "NPC_VOX");
 		return true;
 	}
@@ -319,50 +318,54 @@ bool NPC::playSound(int type, int id) {
 	return false;
 }
 
+void NPC::indexDialogs() {
+	dialog_requirements.clear();
+	dialog_requirements.resize(dialog.size());
+	dialog_groups.clear();
+	dialog_groups.resize(dialog.size());
+
+	for (size_t i=0; i<dialog.size(); i++) {
+		for (size_t j=0; j<dialog[i].size(); j++) {
+			if (dialog[i][j].type == EC_NPC_DIALOG_GROUP)
+				dialog_groups[i] = dialog[i][j].getString();
+		}
+		camp->compileRequirements(dialog[i], dialog_requirements[i]);
+	}
+}
+
 /**
  * get list of available dialogs with NPC
+ * The status requirements of each node are only checked again after a campaign status changed.
  */
 void NPC::getDialogNodes(std::vector<int> &result) {
 	result.clear();
 	if (!talker)
 		return;
 
-	std::string group;
+	if (dialog_requirements.size() != dialog.size())
+		indexDialogs();
+
 	typedef std::vector<int> Dialogs;
 	typedef std::map<std::string, Dialogs > DialogGroups;
 	DialogGroups groups;
 
 	for (size_t i=dialog.size(); i>0; i--) {
-		bool is_available = true;
-		bool is_grouped = false;
-		for (size_t j=0; j<dialog[i-1].size(); j++) {
-			if (dialog[i-1][j].type == EC_NPC_DIALOG_GROUP) {
-				is_grouped = true;
-				group = dialog[i-1][j].s;
-			}
-			else {
-				if (camp->checkAllRequirements(dialog[i-1][j]))
-					continue;
+		if (!camp->checkRequirements(dialog[i-1], dialog_requirements[i-1]))
+			continue;
 
-				is_available = false;
-				break;
-			}
+		const std::string& group = dialog_groups[i-1];
+		if (group.empty()) {
+			result.push_back(static_cast<int>(i-1));
 		}
-
-		if (is_available) {
-			if (!is_grouped) {
-				result.push_back(static_cast<int>(i-1));
+		else {
+			DialogGroups::iterator it;
+			it = groups.find(group);
+			if (it == groups.end()) {
+				groups.insert(DialogGroups::value_type(group, Dialogs()));
 			}
-			else {
-				DialogGroups::iterator it;
-				it = groups.find(group);
-				if (it == groups.end()) {
-					groups.insert(DialogGroups::value_type(group, Dialogs()));
-				}
-				else
-					it->second.push_back(static_cast<int>(i-1));
+			else
+				it->second.push_back(static_cast<int>(i-1));
 
-			}
 		}
 	}
 
@@ -374,7 +377,7 @@ void NPC::getDialogNodes(std::vector<int> &result) {
 
 	while (it != groups.end()) {
 		/* roll a dialog for this group and add to result */
-		int di = it->second[rand() % it->second.size()];
+		int di = it->second[randIndex(it->second.size())];
 		result.push_back(di);
 		++it;
 	}
@@ -386,7 +389,7 @@ std::string NPC::getDialogTopic(unsigned int dialog_node) {
 
 	for (unsigned int j=0; j<dialog[dialog_node].size(); j++) {
 		if (dialog[dialog_node][j].type == EC_NPC_DIALOG_TOPIC)
-			return dialog[dialog_node][j].s;
+			return dialog[dialog_node][j].getString();
 	}
 
 	return "";
@@ -399,7 +402,7 @@ bool NPC::checkMovement(unsigned int dialog_node) {
 	if (dialog_node < dialog.size()) {
 		for (unsigned int i=0; i<dialog[dialog_node].size(); i++) {
 			if (dialog[dialog_node][i].type == EC_NPC_ALLOW_MOVEMENT)
-				return toBool(dialog[dialog_node][i].s);
+				return toBool(dialog[dialog_node][i].getString());
 		}
 	}
 	return true;
@@ -479,7 +482,7 @@ bool NPC::processDialog(unsigned int dialog_node, unsigned int &event_cursor) {
 		else if (dialog[dialog_node][event_cursor].type == EC_NPC_PORTRAIT_THEM) {
 			npc_portrait = portraits[0];
 			for (size_t i = 0; i < portrait_filenames.size(); ++i) {
-				if (dialog[dialog_node][event_cursor].s == portrait_filenames[i]) {
+				if (dialog[dialog_node][event_cursor].getString() == portrait_filenames[i]) {
 					npc_portrait = portraits[i];
 					break;
 				}
@@ -488,7 +491,7 @@ bool NPC::processDialog(unsigned int dialog_node, unsigned int &event_cursor) {
 		else if (dialog[dialog_node][event_cursor].type == EC_NPC_PORTRAIT_YOU) {
 			hero_portrait = NULL;
 			for (size_t i = 0; i < portrait_filenames.size(); ++i) {
-				if (dialog[dialog_node][event_cursor].s == portrait_filenames[i]) {
+				if (dialog[dialog_node][event_cursor].getString() == portrait_filenames[i]) {
 					hero_portrait = portraits[i];
 					break;
 				}
@@ -522,12 +525,10 @@ void NPC::processEvent(unsigned int dialog_node, unsigned int cursor) {
 	EventManager::executeEvent(ev);
 }
 
-Renderable NPC::getRender() {
-	Renderable r = activeAnimation->getCurrentFrame(direction);
+void NPC::getRender(Renderable& r) {
+	activeAnimation->getCurrentFrame(direction, r);
 	r.map_pos.x = pos.x;
 	r.map_pos.y = pos.y;
-
-	return r;
 }
 
 bool NPC::isDialogType(const EVENT_COMPONENT_TYPE &type) {
@@ -26,6 +26,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "CommonIncludes.h"
 #include "Entity.h"
+#include "EventManager.h"
 #include "ItemStorage.h"
 #include "Utils.h"
 
@@ -42,6 +43,11 @@ private:
 
 	std::vector<std::string> portrait_filenames;
 
+	// for each dialog node: its compiled requirements, and the dialog group it belongs to ("" for none)
+	void indexDialogs();
+	std::vector<Event_Requirements> dialog_requirements;
+	std::vector<std::string> dialog_groups;
+
 public:
 	NPC();
 	~NPC();
@@ -56,7 +62,7 @@ public:
 	bool checkVendor();
 	bool processDialog(unsigned int dialog_node, unsigned int& event_cursor);
 	void processEvent(unsigned int dialog_node, unsigned int cursor);
-	virtual Renderable getRender();
+	virtual void getRender(Renderable& r);
 
 	// general info
 	std::string name;
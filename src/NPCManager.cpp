@@ -43,7 +43,10 @@ NPCManager::NPCManager(StatBlock *_stats)
 
 void NPCManager::addRenders(std::vector<Renderable> &r) {
 	for (unsigned i=0; i<npcs.size(); i++) {
-		r.push_back(npcs[i]->getRender());
+		r.push_back(Renderable());
+		npcs[i]->getRender(r.back());
+		if (!mapr->isOnScreen(r.back()))
+			r.pop_back();
 	}
 }
 
@@ -53,8 +56,10 @@ void NPCManager::handleNewMap() {
 	ItemStack item_roll;
 
 	// remove existing NPCs
-	for (unsigned i=0; i<npcs.size(); i++)
+	for (unsigned i=0; i<npcs.size(); i++) {
+		mapr->entity_registry.remove(npcs[i]);
 		delete(npcs[i]);
+	}
 
 	npcs.clear();
 
@@ -79,9 +84,11 @@ void NPCManager::handleNewMap() {
 		npc->load(mn.id);
 		npc->pos.x = mn.pos.x;
 		npc->pos.y = mn.pos.y;
+		npc->stats.pos = npc->pos;
 
 		// npc->stock.sort();
 		npcs.push_back(npc);
+		mapr->entity_registry.add(npc, ENTITY_IS_NPC);
 
 		// create a map event for this npc
 		Event ev;
@@ -103,7 +110,7 @@ void NPCManager::handleNewMap() {
 		ev.components.push_back(ec);
 
 		ec.type = EC_TOOLTIP;
-		ec.s = npc->name;
+		ec.setString(npc->name);
 		ev.components.push_back(ec);
 
 		// The hitbox for hovering/clicking on an npc is based on their first frame of animation
@@ -125,8 +132,12 @@ void NPCManager::handleNewMap() {
 }
 
 void NPCManager::logic() {
-	for (unsigned i=0; i<npcs.size(); i++) {
-		npcs[i]->logic();
+	const EntityRegistry& registry = mapr->entity_registry;
+	for (size_t i = 0; i < registry.size(); ++i) {
+		if (!(registry.flags[i] & ENTITY_IS_NPC) || calcDist(registry.pos[i], mapr->cam) > NPC_ANIMATION_DISTANCE)
+			continue;
+
+		static_cast<NPC*>(registry.entities[i])->logic();
 	}
 }
 
@@ -140,6 +151,7 @@ int NPCManager::getID(const std::string& npcName) {
 	if (n) {
 		n->load(npcName);
 		npcs.push_back(n);
+		mapr->entity_registry.add(n, ENTITY_IS_NPC);
 		return static_cast<int>(npcs.size()-1);
 	}
 
@@ -29,6 +29,9 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "CommonIncludes.h"
 #include "TooltipData.h"
 
+// NPCs further than this from the camera don't animate
+const float NPC_ANIMATION_DISTANCE = 32.0f;
+
 class StatBlock;
 class NPC;
 class WidgetTooltip;
@@ -0,0 +1,76 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "NullFontEngine.h"
+
+NullFontEngine::NullFontEngine()
+	: FontEngine() {
+}
+
+int NullFontEngine::getLineHeight() {
+	return NULL_FONT_LINE_HEIGHT;
+}
+
+int NullFontEngine::getFontHeight() {
+	return NULL_FONT_HEIGHT;
+}
+
+void NullFontEngine::setFont(const std::string&) {
+}
+
+int NullFontEngine::calc_width(const std::string& text) {
+	// count UTF-8 characters, not bytes
+	int count = 0;
+	for (size_t i = 0; i < text.length(); ++i) {
+		if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80)
+			++count;
+	}
+	return count * NULL_FONT_CHAR_WIDTH;
+}
+
+/**
+ * Same results as SDLFontEngine::trimTextToWidth(), but for a monospace font
+ */
+std::string NullFontEngine::trimTextToWidth(const std::string& text, const int width, const bool use_ellipsis) {
+	if (width >= calc_width(text))
+		return text;
+
+	size_t text_length = text.length();
+	int total_width = (use_ellipsis ? width - calc_width("...") : width);
+	size_t ret_length = static_cast<size_t>(std::max(total_width, 0) / NULL_FONT_CHAR_WIDTH);
+
+	if (!use_ellipsis)
+		return text.substr(text_length - std::min(ret_length, text_length));
+
+	if (text_length <= 3)
+		return std::string("...");
+
+	if (text_length - ret_length < 3)
+		ret_length = text_length - 3;
+
+	return text.substr(0, ret_length) + "...";
+}
+
+void NullFontEngine::clearGlyphCache() {
+}
+
+const FontStyle* NullFontEngine::getActiveFont() {
+	return NULL;
+}
+
+void NullFontEngine::renderInternal(const std::string&, int, int, int, Image*, const Color&) {
+}
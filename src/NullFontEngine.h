@@ -0,0 +1,53 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class NullFontEngine
+ *
+ * A font engine that doesn't load fonts or draw text, for running the game
+ * headless. Text is measured as if it was set in a monospace font, so that
+ * menus can still lay it out.
+ */
+
+#ifndef NULL_FONT_ENGINE_H
+#define NULL_FONT_ENGINE_H
+
+#include "FontEngine.h"
+
+// size of each character, in pixels
+const int NULL_FONT_CHAR_WIDTH = 8;
+const int NULL_FONT_HEIGHT = 12;
+const int NULL_FONT_LINE_HEIGHT = 16;
+
+class NullFontEngine : public FontEngine {
+public:
+	NullFontEngine();
+
+	int getLineHeight();
+	int getFontHeight();
+
+	void setFont(const std::string& _font);
+	int calc_width(const std::string& text);
+	std::string trimTextToWidth(const std::string& text, const int width, const bool use_ellipsis);
+	void clearGlyphCache();
+
+protected:
+	void renderInternal(const std::string& text, int x, int y, int justify, Image *target, const Color& color);
+	const FontStyle* getActiveFont();
+};
+
+#endif // NULL_FONT_ENGINE_H
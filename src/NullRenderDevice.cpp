@@ -0,0 +1,215 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "NullRenderDevice.h"
+#include "SharedResources.h"
+#include "Settings.h"
+
+NullImage::NullImage(RenderDevice *_device, int _width, int _height)
+	: Image(_device)
+	, width(_width)
+	, height(_height) {
+}
+
+NullImage::~NullImage() {
+}
+
+int NullImage::getWidth() const {
+	return width;
+}
+
+int NullImage::getHeight() const {
+	return height;
+}
+
+void NullImage::fillWithColor(const Color&) {
+}
+
+void NullImage::drawPixel(int, int, const Color&) {
+}
+
+/**
+ * Deletes the original image and returns a pointer to the resized version
+ */
+Image* NullImage::resize(int _width, int _height) {
+	if (_width <= 0 || _height <= 0)
+		return NULL;
+
+	NullImage *scaled = new NullImage(device, _width, _height);
+	this->unref();
+	return scaled;
+}
+
+void NullImage::setPixels(const Rect&, const uint32_t*, int) {
+}
+
+NullRenderDevice::NullRenderDevice()
+	: RenderDevice() {
+	// nothing is drawn, so there is no point in resizing images
+	allow_scaled_sprites = true;
+	logInfo("NullRenderDevice: Running without a window; nothing will be drawn.");
+}
+
+int NullRenderDevice::createContext(bool) {
+	is_initialized = true;
+
+	windowResize();
+
+	// load persistent resources
+	delete icons;
+	icons = new IconManager();
+	delete curs;
+	curs = new CursorManager();
+
+	return 0;
+}
+
+int NullRenderDevice::render(Renderable&, Rect&) {
+	return 0;
+}
+
+int NullRenderDevice::render(Sprite*) {
+	return 0;
+}
+
+int NullRenderDevice::renderToImage(Image*, Rect&, Image*, Rect&) {
+	return 0;
+}
+
+int NullRenderDevice::copyToImage(Image*, Rect&, Image*, Rect&) {
+	return 0;
+}
+
+int NullRenderDevice::renderText(FontStyle*, const std::string&, const Color&, Rect&) {
+	return 0;
+}
+
+Image* NullRenderDevice::renderTextToImage(FontStyle*, const std::string& text, const Color&, bool) {
+	return new NullImage(this, font->calc_width(text), font->getLineHeight());
+}
+
+void NullRenderDevice::drawPixel(int, int, const Color&) {
+}
+
+void NullRenderDevice::drawRectangle(const Point&, const Point&, const Color&) {
+}
+
+void NullRenderDevice::drawLine(int, int, int, int, const Color&) {
+}
+
+void NullRenderDevice::renderBatch(std::vector<RenderBatchItem>&) {
+}
+
+void NullRenderDevice::blankScreen() {
+}
+
+void NullRenderDevice::commitFrame() {
+	inpt->window_resized = false;
+	inpt->window_exposed = false;
+}
+
+void NullRenderDevice::destroyContext() {
+	RenderDevice::cacheRemoveAll();
+	reload_graphics = true;
+
+	if (icons) {
+		delete icons;
+		icons = NULL;
+	}
+	if (curs) {
+		delete curs;
+		curs = NULL;
+	}
+}
+
+/**
+ * There is no window, so the view is sized as if one had been opened at SCREEN_W x SCREEN_H
+ */
+void NullRenderDevice::windowResize() {
+	for (size_t i = 0; i < VIRTUAL_HEIGHTS.size(); ++i) {
+		if (SCREEN_H >= VIRTUAL_HEIGHTS[i]) {
+			VIEW_H = VIRTUAL_HEIGHTS[i];
+		}
+	}
+
+	VIEW_H_HALF = VIEW_H / 2;
+
+	float scale = static_cast<float>(VIEW_H) / static_cast<float>(SCREEN_H);
+	VIEW_W = static_cast<unsigned short>(static_cast<float>(SCREEN_W) * scale);
+
+	if (VIEW_W < MIN_SCREEN_W) {
+		VIEW_W = MIN_SCREEN_W;
+	}
+
+	VIEW_W_HALF = VIEW_W/2;
+
+	updateScreenVars();
+}
+
+void NullRenderDevice::setRenderTarget(Image*) {
+}
+
+int NullRenderDevice::getVsyncRate() {
+	return 0;
+}
+
+void NullRenderDevice::beginWorld() {
+}
+
+void NullRenderDevice::endWorld() {
+}
+
+Image *NullRenderDevice::createImage(int width, int height) {
+	return new NullImage(this, width, height);
+}
+
+void NullRenderDevice::setGamma(float) {
+}
+
+void NullRenderDevice::resetGamma() {
+}
+
+void NullRenderDevice::updateTitleBar() {
+}
+
+Image *NullRenderDevice::loadImage(const std::string& filename, const std::string& errormessage, bool IfNotFoundExit) {
+	// lookup image in cache
+	Image *img;
+	img = cacheLookup(filename);
+	if (img != NULL) return img;
+
+	// the pixels aren't needed, only the size
+	NullImage *image = NULL;
+	std::string error;
+	SDL_Surface *cleanup = decodeImage(filename, error);
+	if (!cleanup) {
+		if (!errormessage.empty())
+			logError("NullRenderDevice: [%s] %s: %s", filename.c_str(), errormessage.c_str(), error.c_str());
+		if (IfNotFoundExit) {
+			mods->resetModConfig();
+			Exit(1);
+		}
+	}
+	else {
+		image = new NullImage(this, cleanup->w, cleanup->h);
+		SDL_FreeSurface(cleanup);
+	}
+
+	// store image to cache
+	cacheStore(filename, image);
+	return image;
+}
@@ -0,0 +1,86 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class NullRenderDevice
+ *
+ * A render device without a window that doesn't draw anything, for running
+ * the game headless. Images are still decoded once to find out their size,
+ * since menus and animations are laid out with it.
+ */
+
+#ifndef NULL_RENDER_DEVICE_H
+#define NULL_RENDER_DEVICE_H
+
+#include "RenderDevice.h"
+
+class NullImage : public Image {
+public:
+	NullImage(RenderDevice *device, int _width, int _height);
+	virtual ~NullImage();
+	int getWidth() const;
+	int getHeight() const;
+
+	void fillWithColor(const Color& color);
+	void drawPixel(int x, int y, const Color& color);
+	Image* resize(int width, int height);
+	void setPixels(const Rect& area, const uint32_t* pixels, int pitch);
+
+private:
+	int width;
+	int height;
+};
+
+class NullRenderDevice : public RenderDevice {
+
+public:
+	NullRenderDevice();
+	int createContext(bool allow_fallback = true);
+
+	int render(Renderable& r, Rect& dest);
+	int render(Sprite* r);
+	int renderToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest);
+	int copyToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest);
+
+	int renderText(FontStyle *font_style, const std::string& text, const Color& color, Rect& dest);
+	Image* renderTextToImage(FontStyle* font_style, const std::string& text, const Color& color, bool blended = true);
+	void drawPixel(int x, int y, const Color& color);
+	void drawRectangle(const Point& p0, const Point& p1, const Color& color);
+	void blankScreen();
+	void commitFrame();
+	void destroyContext();
+	void windowResize();
+	void setRenderTarget(Image* image);
+	int getVsyncRate();
+	void beginWorld();
+	void endWorld();
+	Image *createImage(int width, int height);
+	void setGamma(float g);
+	void resetGamma();
+	void updateTitleBar();
+
+	Image* loadImage(const std::string& filename,
+					 const std::string& errormessage = "Couldn't load image",
+					 bool IfNotFoundExit = false);
+protected:
+	void renderBatch(std::vector<RenderBatchItem>& items);
+
+private:
+	void drawLine(int x0, int y0, int x1, int y1, const Color& color);
+};
+
+#endif // NULL_RENDER_DEVICE_H
@@ -0,0 +1,86 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "NullSoundManager.h"
+
+NullSoundManager::NullSoundManager()
+	: SoundManager() {
+}
+
+SoundManager::SoundID NullSoundManager::load(const std::string&, const std::string&) {
+	return 0;
+}
+
+void NullSoundManager::unload(SoundManager::SoundID) {
+}
+
+void NullSoundManager::play(SoundManager::SoundID, std::string, const FPoint&, bool) {
+}
+
+void NullSoundManager::pauseAll() {
+}
+
+void NullSoundManager::resumeAll() {
+}
+
+void NullSoundManager::setVolumeSFX(int) {
+}
+
+void NullSoundManager::loadMusic(const std::string&) {
+}
+
+void NullSoundManager::preloadMusic(const std::string&) {
+}
+
+void NullSoundManager::unloadMusic() {
+}
+
+void NullSoundManager::playMusic() {
+}
+
+void NullSoundManager::stopMusic() {
+}
+
+void NullSoundManager::setVolumeMusic(int) {
+}
+
+bool NullSoundManager::isPlayingMusic() {
+	return false;
+}
+
+void NullSoundManager::updateMusic() {
+}
+
+void NullSoundManager::logic(const FPoint&) {
+}
+
+void NullSoundManager::reset() {
+}
+
+SoundManager::SoundID NullSoundManager::getLastPlayedSID() {
+	return static_cast<SoundManager::SoundID>(-1);
+}
+
+void NullSoundManager::finishLoads() {
+}
+
+size_t NullSoundManager::getCacheBytes() {
+	return 0;
+}
+
+void NullSoundManager::getMemoryUsage(MemoryUsage&) {
+}
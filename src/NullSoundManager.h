@@ -0,0 +1,59 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class NullSoundManager
+ *
+ * A sound manager without an audio device, for running the game headless.
+ * Nothing is loaded or played.
+ */
+
+#ifndef NULL_SOUND_MANAGER_H
+#define NULL_SOUND_MANAGER_H
+
+#include "SoundManager.h"
+
+class NullSoundManager : public SoundManager {
+public:
+	NullSoundManager();
+
+	SoundManager::SoundID load(const std::string& filename, const std::string& errormessage);
+	void unload(SoundManager::SoundID);
+	void play(SoundManager::SoundID, std::string channel = GLOBAL_VIRTUAL_CHANNEL, const FPoint& pos = FPoint(0,0), bool loop = false);
+	void pauseAll();
+	void resumeAll();
+	void setVolumeSFX(int value);
+
+	void loadMusic(const std::string& filename);
+	void preloadMusic(const std::string& filename);
+	void unloadMusic();
+	void playMusic();
+	void stopMusic();
+	void setVolumeMusic(int value);
+	bool isPlayingMusic();
+	void updateMusic();
+
+	void logic(const FPoint& center);
+	void reset();
+	void finishLoads();
+
+	SoundManager::SoundID getLastPlayedSID();
+	size_t getCacheBytes();
+	void getMemoryUsage(MemoryUsage& usage);
+};
+
+#endif // NULL_SOUND_MANAGER_H
@@ -0,0 +1,321 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "ModManager.h"
+#include "ParserCache.h"
+#include "Settings.h"
+#include "Utils.h"
+#include "UtilsFileSystem.h"
+
+#include <cstring>
+
+static const char PARSER_CACHE_MAGIC[8] = {'F', 'L', 'A', 'R', 'E', 'D', 'A', 'T'};
+
+/**
+ * Little-endian reader over a cache file held in memory
+ * Reading past the end of the data clears ok instead of failing immediately.
+ */
+class ParserCacheReader {
+public:
+	ParserCacheReader(const std::vector<char>& _data)
+		: data(_data)
+		, pos(0)
+		, ok(true) {
+	}
+
+	uint32_t getUnsigned() {
+		if (pos + 4 > data.size()) {
+			ok = false;
+			return 0;
+		}
+		uint32_t value = 0;
+		for (int i = 3; i >= 0; --i)
+			value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+		pos += 4;
+		return value;
+	}
+
+	time_t getTime() {
+		uint64_t low = getUnsigned();
+		uint64_t high = getUnsigned();
+		return static_cast<time_t>(low | (high << 32));
+	}
+
+	void getString(std::string& value) {
+		size_t length = getUnsigned();
+		if (!ok || pos + length > data.size()) {
+			ok = false;
+			value.clear();
+			return;
+		}
+		value.assign(&data[0] + pos, length);
+		pos += length;
+	}
+
+	void getStringList(std::vector<std::string>& list) {
+		size_t count = getUnsigned();
+		for (size_t i = 0; i < count && ok; ++i) {
+			list.push_back(std::string());
+			getString(list.back());
+		}
+	}
+
+	const std::vector<char>& data;
+	size_t pos;
+	bool ok;
+};
+
+static void putUnsigned(std::ofstream& outfile, uint32_t value) {
+	char bytes[4];
+	for (int i = 0; i < 4; ++i)
+		bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+	outfile.write(bytes, 4);
+}
+
+static void putTime(std::ofstream& outfile, time_t value) {
+	uint64_t bits = static_cast<uint64_t>(value);
+	putUnsigned(outfile, static_cast<uint32_t>(bits & 0xFFFFFFFF));
+	putUnsigned(outfile, static_cast<uint32_t>(bits >> 32));
+}
+
+static void putString(std::ofstream& outfile, const std::string& value) {
+	putUnsigned(outfile, static_cast<uint32_t>(value.length()));
+	outfile.write(value.c_str(), value.length());
+}
+
+static void putStringList(std::ofstream& outfile, const std::vector<std::string>& list) {
+	putUnsigned(outfile, static_cast<uint32_t>(list.size()));
+	for (size_t i = 0; i < list.size(); ++i)
+		putString(outfile, list[i]);
+}
+
+static std::string getCachePath() {
+	return PATH_USER + "cache/parser_cache.dat";
+}
+
+void ParserCacheEntry::clear() {
+	names.clear();
+	files.clear();
+	modified.clear();
+	records.clear();
+	checked = false;
+	valid = false;
+}
+
+ParserCache::ParserCache(ModManager *_owner)
+	: owner(_owner)
+	, mod_key("")
+	, loaded(false)
+	, changed(false)
+	, mutex(SDL_CreateMutex()) {
+}
+
+ParserCache::~ParserCache() {
+	SDL_DestroyMutex(mutex);
+}
+
+/**
+ * Entries only apply to the mod list they were created with
+ */
+void ParserCache::checkModKey() {
+	if (!loaded)
+		load();
+
+	std::string key;
+	for (size_t i = 0; i < owner->mod_list.size(); ++i) {
+		key += owner->mod_list[i].name;
+		key += ',';
+	}
+
+	if (key != mod_key) {
+		entries.clear();
+		mod_key = key;
+	}
+}
+
+void ParserCache::load() {
+	loaded = true;
+
+	std::vector<char> data;
+	if (!readFile(getCachePath(), data) || data.size() < sizeof(PARSER_CACHE_MAGIC))
+		return;
+
+	if (memcmp(&data[0], PARSER_CACHE_MAGIC, sizeof(PARSER_CACHE_MAGIC)) != 0)
+		return;
+
+	ParserCacheReader reader(data);
+	reader.pos = sizeof(PARSER_CACHE_MAGIC);
+
+	if (reader.getUnsigned() != PARSER_CACHE_VERSION)
+		return;
+
+	reader.getString(mod_key);
+
+	size_t entry_count = reader.getUnsigned();
+	std::string filename;
+	for (size_t i = 0; i < entry_count && reader.ok; ++i) {
+		reader.getString(filename);
+		ParserCacheEntry& entry = entries[filename];
+
+		reader.getStringList(entry.names);
+		reader.getStringList(entry.files);
+		entry.modified.resize(entry.files.size());
+		for (size_t j = 0; j < entry.modified.size(); ++j)
+			entry.modified[j] = reader.getTime();
+
+		size_t record_count = reader.getUnsigned();
+		for (size_t j = 0; j < record_count && reader.ok; ++j) {
+			entry.records.push_back(ParserCacheRecord());
+			ParserCacheRecord& record = entry.records.back();
+			record.new_section = reader.getUnsigned() != 0;
+			reader.getString(record.section);
+			reader.getString(record.key);
+			reader.getString(record.val);
+			record.file = reader.getUnsigned();
+			record.line_number = reader.getUnsigned();
+		}
+	}
+
+	if (!reader.ok) {
+		logError("ParserCache: '%s' is damaged and will be rebuilt.", getCachePath().c_str());
+		entries.clear();
+		mod_key = "";
+	}
+}
+
+bool ParserCache::isValid(ParserCacheEntry& entry) {
+	std::vector<std::string> files;
+	for (size_t i = 0; i < entry.names.size(); ++i) {
+		std::vector<std::string> located = owner->list(entry.names[i]);
+		files.insert(files.end(), located.begin(), located.end());
+	}
+
+	if (files != entry.files || entry.modified.size() != files.size())
+		return false;
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (owner->getModifiedTime(files[i]) != entry.modified[i])
+			return false;
+	}
+
+	for (size_t i = 0; i < entry.records.size(); ++i) {
+		if (entry.records[i].file >= files.size())
+			return false;
+	}
+
+	return true;
+}
+
+const ParserCacheEntry* ParserCache::get(const std::string& filename) {
+	SDL_LockMutex(mutex);
+	checkModKey();
+
+	const ParserCacheEntry *result = NULL;
+
+	std::map<std::string, ParserCacheEntry>::iterator it = entries.find(filename);
+	if (it != entries.end()) {
+		ParserCacheEntry& entry = it->second;
+		if (!entry.checked) {
+			entry.checked = true;
+			entry.valid = isValid(entry);
+		}
+
+		if (entry.valid)
+			result = &entry;
+	}
+
+	SDL_UnlockMutex(mutex);
+	return result;
+}
+
+void ParserCache::store(const std::string& filename, const ParserCacheEntry& entry) {
+	SDL_LockMutex(mutex);
+	checkModKey();
+
+	ParserCacheEntry& stored = entries[filename];
+	stored = entry;
+	stored.modified.resize(stored.files.size());
+	for (size_t i = 0; i < stored.files.size(); ++i)
+		stored.modified[i] = owner->getModifiedTime(stored.files[i]);
+	stored.checked = true;
+	stored.valid = true;
+
+	changed = true;
+	SDL_UnlockMutex(mutex);
+}
+
+void ParserCache::recheck(const std::string& filename) {
+	SDL_LockMutex(mutex);
+
+	std::map<std::string, ParserCacheEntry>::iterator it = entries.find(filename);
+	if (it != entries.end())
+		it->second.checked = false;
+
+	SDL_UnlockMutex(mutex);
+}
+
+void ParserCache::save() {
+	if (!changed || !PARSER_CACHE)
+		return;
+
+	createDir(PATH_USER + "cache");
+
+	std::ofstream outfile(getCachePath().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!outfile.is_open()) {
+		logError("ParserCache: Could not write '%s'.", getCachePath().c_str());
+		return;
+	}
+
+	outfile.write(PARSER_CACHE_MAGIC, sizeof(PARSER_CACHE_MAGIC));
+	putUnsigned(outfile, PARSER_CACHE_VERSION);
+	putString(outfile, mod_key);
+
+	// entries that no longer match the mods are not worth keeping
+	std::vector<std::map<std::string, ParserCacheEntry>::const_iterator> valid_entries;
+	for (std::map<std::string, ParserCacheEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+		if (!it->second.checked || it->second.valid)
+			valid_entries.push_back(it);
+	}
+
+	putUnsigned(outfile, static_cast<uint32_t>(valid_entries.size()));
+	for (size_t i = 0; i < valid_entries.size(); ++i) {
+		const ParserCacheEntry& entry = valid_entries[i]->second;
+
+		putString(outfile, valid_entries[i]->first);
+		putStringList(outfile, entry.names);
+		putStringList(outfile, entry.files);
+		for (size_t j = 0; j < entry.modified.size(); ++j)
+			putTime(outfile, entry.modified[j]);
+
+		putUnsigned(outfile, static_cast<uint32_t>(entry.records.size()));
+		for (size_t j = 0; j < entry.records.size(); ++j) {
+			const ParserCacheRecord& record = entry.records[j];
+			putUnsigned(outfile, record.new_section ? 1 : 0);
+			putString(outfile, record.section);
+			putString(outfile, record.key);
+			putString(outfile, record.val);
+			putUnsigned(outfile, record.file);
+			putUnsigned(outfile, record.line_number);
+		}
+	}
+
+	if (outfile.bad())
+		logError("ParserCache: Could not write '%s'.", getCachePath().c_str());
+	outfile.close();
+
+	changed = false;
+}
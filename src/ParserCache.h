@@ -0,0 +1,117 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class ParserCache
+ *
+ * Binary cache of the key pairs read from large definition files, such as powers,
+ * items and enemies. An entry holds every key pair of one generic filename, after
+ * the files of all mods have been merged and INCLUDE lines have been resolved.
+ *
+ * An entry stays valid while the list of located files and their modification
+ * times don't change. The whole cache is dropped when the mod list changes.
+ * Entries are never removed while loading, so pointers returned by get() can be
+ * used without holding the lock.
+ */
+
+#ifndef PARSER_CACHE_H
+#define PARSER_CACHE_H
+
+#include "CommonIncludes.h"
+
+#include <stdint.h>
+#include <time.h>
+
+class ModManager;
+
+const uint32_t PARSER_CACHE_VERSION = 1;
+
+class ParserCacheRecord {
+public:
+	bool new_section;
+	std::string section;
+	std::string key;
+	std::string val;
+
+	// the file and line this key pair was read from, for error messages
+	unsigned file;
+	unsigned line_number;
+
+	ParserCacheRecord()
+		: new_section(false)
+		, file(0)
+		, line_number(0) {
+	}
+};
+
+class ParserCacheEntry {
+public:
+	// the generic filename and every file it includes, in the order they were opened
+	std::vector<std::string> names;
+
+	// the located files and their modification times
+	std::vector<std::string> files;
+	std::vector<time_t> modified;
+
+	std::vector<ParserCacheRecord> records;
+
+	// set once the files have been compared against the mods
+	bool checked;
+	bool valid;
+
+	ParserCacheEntry()
+		: checked(false)
+		, valid(false) {
+	}
+
+	void clear();
+};
+
+class ParserCache {
+private:
+	void load();
+	bool isValid(ParserCacheEntry& entry);
+	void checkModKey();
+
+	ModManager *owner;
+	std::map<std::string, ParserCacheEntry> entries;
+	std::string mod_key;
+	bool loaded;
+	bool changed;
+
+	// get() and store() may be called from the startup loading threads
+	SDL_mutex *mutex;
+
+public:
+	ParserCache(ModManager *_owner);
+	ParserCache(const ParserCache&); // not implemented
+	~ParserCache();
+
+	// returns NULL if there is no valid entry for the generic filename
+	const ParserCacheEntry* get(const std::string& filename);
+
+	// fills in the modification times of the entry and adds it to the cache
+	void store(const std::string& filename, const ParserCacheEntry& entry);
+
+	// the next get() compares the files of the entry against the mods again, for files changed while the game runs
+	void recheck(const std::string& filename);
+
+	// writes the cache to disk if any entry has changed
+	void save();
+};
+
+#endif // PARSER_CACHE_H
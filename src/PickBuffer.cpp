@@ -0,0 +1,111 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "PickBuffer.h"
+#include "RenderDevice.h"
+#include "Settings.h"
+
+PickBuffer::PickBuffer()
+	: cell_count(0, 0) {
+}
+
+PickBuffer::~PickBuffer() {
+}
+
+void PickBuffer::reset(const FPoint& cam) {
+	clear();
+
+	view.setCamera(cam);
+	view_cam = cam;
+
+	// the view size may have changed since the last frame
+	Point count((VIEW_W + PICK_BUFFER_CELL_SIZE - 1) / PICK_BUFFER_CELL_SIZE, (VIEW_H + PICK_BUFFER_CELL_SIZE - 1) / PICK_BUFFER_CELL_SIZE);
+	count.x = std::max(count.x, 1);
+	count.y = std::max(count.y, 1);
+	if (count.x != cell_count.x || count.y != cell_count.y) {
+		cell_count = count;
+		cells.clear();
+		cells.resize(cell_count.x * cell_count.y);
+	}
+}
+
+void PickBuffer::clear() {
+	rects.clear();
+	owners.clear();
+	for (size_t i = 0; i < cells.size(); ++i)
+		cells[i].clear();
+}
+
+void PickBuffer::add(const Renderable& r, Entity *e) {
+	if (cells.empty())
+		return;
+
+	Point p = view.mapToScreen(r.map_pos.x, r.map_pos.y);
+
+	Rect rect;
+	rect.x = p.x - r.offset.x;
+	rect.y = p.y - r.offset.y;
+	rect.w = r.src.w;
+	rect.h = r.src.h;
+
+	rects.push_back(rect);
+	owners.push_back(e);
+	addToCells(rects.size() - 1);
+}
+
+void PickBuffer::addToCells(size_t index) {
+	const Rect& rect = rects[index];
+
+	// sprites reaching past the edge of the view are kept in the border cells
+	int x1 = std::max(0, std::min(rect.x / PICK_BUFFER_CELL_SIZE, cell_count.x - 1));
+	int y1 = std::max(0, std::min(rect.y / PICK_BUFFER_CELL_SIZE, cell_count.y - 1));
+	int x2 = std::max(0, std::min((rect.x + rect.w) / PICK_BUFFER_CELL_SIZE, cell_count.x - 1));
+	int y2 = std::max(0, std::min((rect.y + rect.h) / PICK_BUFFER_CELL_SIZE, cell_count.y - 1));
+
+	for (int y = y1; y <= y2; ++y) {
+		for (int x = x1; x <= x2; ++x) {
+			cells[y * cell_count.x + x].push_back(index);
+		}
+	}
+}
+
+void PickBuffer::query(const Point& screen_pos, const FPoint& cam, std::vector<Entity*>& result) const {
+	result.clear();
+	if (cells.empty())
+		return;
+
+	// screen positions only shift when the camera moves, so move the point to the camera of the entries
+	Point pos = screen_pos;
+	if (cam.x != view_cam.x || cam.y != view_cam.y) {
+		ScreenTransform cam_view;
+		cam_view.setCamera(cam);
+		Point a = view.mapToScreen(0, 0);
+		Point b = cam_view.mapToScreen(0, 0);
+		pos.x += a.x - b.x;
+		pos.y += a.y - b.y;
+	}
+
+	int x = std::max(0, std::min(pos.x / PICK_BUFFER_CELL_SIZE, cell_count.x - 1));
+	int y = std::max(0, std::min(pos.y / PICK_BUFFER_CELL_SIZE, cell_count.y - 1));
+
+	// entries are added to cells in order, so the results keep that order
+	const std::vector<size_t>& cell = cells[y * cell_count.x + x];
+	for (size_t i = 0; i < cell.size(); ++i) {
+		if (isWithinRect(rects[cell[i]], pos))
+			result.push_back(owners[cell[i]]);
+	}
+}
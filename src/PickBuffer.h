@@ -0,0 +1,69 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class PickBuffer
+ *
+ * The screen rectangles of the entity sprites that were last put in the render
+ * lists, sorted into a coarse grid of screen cells. Cursor tests look up the
+ * cell under the mouse, instead of moving every entity to screen space.
+ */
+
+#ifndef PICK_BUFFER_H
+#define PICK_BUFFER_H
+
+#include "CommonIncludes.h"
+#include "Utils.h"
+
+class Entity;
+struct Renderable;
+
+// width and height of a pick buffer cell, in pixels
+const int PICK_BUFFER_CELL_SIZE = 64;
+
+class PickBuffer {
+private:
+	void addToCells(size_t index);
+
+	// the camera the rectangles were placed with
+	ScreenTransform view;
+	FPoint view_cam;
+
+	std::vector<Rect> rects;
+	std::vector<Entity*> owners;
+
+	Point cell_count;
+	std::vector<std::vector<size_t> > cells;
+
+public:
+	PickBuffer();
+	~PickBuffer();
+
+	// removes all entries; cam is the camera the next entries are rendered with
+	void reset(const FPoint& cam);
+
+	// removes all entries, e.g. when the entities are deleted
+	void clear();
+
+	void add(const Renderable& r, Entity *e);
+
+	// gets the entities whose sprite contains the screen position, in the order they were added
+	// The position may be relative to a different camera than the one the entries were placed with.
+	void query(const Point& screen_pos, const FPoint& cam, std::vector<Entity*>& result) const;
+};
+
+#endif // PICK_BUFFER_H
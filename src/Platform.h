@@ -38,4 +38,21 @@ void PlatformSetExitEventFilter();
 bool PlatformDirCreate(const std::string& path);
 bool PlatformDirRemove(const std::string& path);
 
+// flushes src to disk and renames it to dest, replacing dest if it exists
+bool PlatformFileReplace(const std::string& src, const std::string& dest);
+
+// sleeps with the best resolution the platform offers
+void PlatformSleep(float seconds);
+
+// how hot the device reports itself to be
+#define PLATFORM_THERMAL_NOMINAL 0
+#define PLATFORM_THERMAL_FAIR 1
+#define PLATFORM_THERMAL_SERIOUS 2
+#define PLATFORM_THERMAL_CRITICAL 3
+
+// these ask the OS, which can take a while, so they aren't meant to be called every frame
+// platforms that can't tell report PLATFORM_THERMAL_NOMINAL and false
+int PlatformGetThermalState();
+bool PlatformIsLowPowerMode();
+
 #endif
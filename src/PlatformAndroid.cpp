@@ -31,6 +31,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <errno.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
 
 #include <jni.h>
 
@@ -162,5 +164,113 @@ bool PlatformDirRemove(const std::string& path) {
 	return true;
 }
 
+bool PlatformFileReplace(const std::string& src, const std::string& dest) {
+	// make sure the new contents are on disk before they replace the old file
+	int fd = open(src.c_str(), O_RDONLY);
+	if (fd != -1) {
+		fsync(fd);
+		close(fd);
+	}
+
+	if (rename(src.c_str(), dest.c_str()) == -1) {
+		std::string error_msg = "replaceFile (" + dest + ")";
+		perror(error_msg.c_str());
+		return false;
+	}
+	return true;
+}
+
+void PlatformSleep(float seconds) {
+	if (seconds <= 0)
+		return;
+
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(seconds);
+	ts.tv_nsec = static_cast<long>((seconds - static_cast<float>(ts.tv_sec)) * 1000000000.f);
+
+	// nanosleep() writes the time that was left into ts if it gets interrupted
+	while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+// returns a local reference to the PowerManager, or NULL
+jobject AndroidGetPowerManager(JNIEnv* env) {
+	jobject activity = (jobject)SDL_AndroidGetActivity();
+	jclass clazz(env->GetObjectClass(activity));
+
+	jmethodID method_id = env->GetMethodID(clazz, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
+	jstring service_name = env->NewStringUTF("power");
+	jobject power_manager = env->CallObjectMethod(activity, method_id, service_name);
+	if (env->ExceptionCheck()) {
+		env->ExceptionClear();
+		power_manager = NULL;
+	}
+
+	env->DeleteLocalRef(service_name);
+	env->DeleteLocalRef(activity);
+	env->DeleteLocalRef(clazz);
+
+	return power_manager;
+}
+
+int PlatformGetThermalState() {
+	JNIEnv* env = (JNIEnv*)SDL_AndroidGetJNIEnv();
+	jobject power_manager = AndroidGetPowerManager(env);
+	if (!power_manager)
+		return PLATFORM_THERMAL_NOMINAL;
+
+	int result = PLATFORM_THERMAL_NOMINAL;
+	jclass clazz(env->GetObjectClass(power_manager));
+
+	// getCurrentThermalStatus() was added in Android 10
+	jmethodID method_id = env->GetMethodID(clazz, "getCurrentThermalStatus", "()I");
+	if (env->ExceptionCheck()) {
+		env->ExceptionClear();
+	}
+	else if (method_id) {
+		// THERMAL_STATUS_NONE, LIGHT, MODERATE, SEVERE, CRITICAL, EMERGENCY, SHUTDOWN
+		jint status = env->CallIntMethod(power_manager, method_id);
+		if (env->ExceptionCheck())
+			env->ExceptionClear();
+		else if (status >= 4)
+			result = PLATFORM_THERMAL_CRITICAL;
+		else if (status == 3)
+			result = PLATFORM_THERMAL_SERIOUS;
+		else if (status >= 1)
+			result = PLATFORM_THERMAL_FAIR;
+	}
+
+	env->DeleteLocalRef(clazz);
+	env->DeleteLocalRef(power_manager);
+
+	return result;
+}
+
+bool PlatformIsLowPowerMode() {
+	JNIEnv* env = (JNIEnv*)SDL_AndroidGetJNIEnv();
+	jobject power_manager = AndroidGetPowerManager(env);
+	if (!power_manager)
+		return false;
+
+	bool result = false;
+	jclass clazz(env->GetObjectClass(power_manager));
+
+	jmethodID method_id = env->GetMethodID(clazz, "isPowerSaveMode", "()Z");
+	if (env->ExceptionCheck()) {
+		env->ExceptionClear();
+	}
+	else if (method_id) {
+		jboolean saving = env->CallBooleanMethod(power_manager, method_id);
+		if (env->ExceptionCheck())
+			env->ExceptionClear();
+		else
+			result = (saving == JNI_TRUE);
+	}
+
+	env->DeleteLocalRef(clazz);
+	env->DeleteLocalRef(power_manager);
+
+	return result;
+}
+
 #endif // PLATFORM_CPP
 #endif // PLATFORM_CPP_INCLUDE
@@ -32,6 +32,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <errno.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
 
 PlatformOptions_t PlatformOptions = {true, false, CONFIG_MENU_TYPE_BASE, ""};
 
@@ -175,5 +177,41 @@ bool PlatformDirRemove(const std::string& path) {
 	return true;
 }
 
+bool PlatformFileReplace(const std::string& src, const std::string& dest) {
+	// make sure the new contents are on disk before they replace the old file
+	int fd = open(src.c_str(), O_RDONLY);
+	if (fd != -1) {
+		fsync(fd);
+		close(fd);
+	}
+
+	if (rename(src.c_str(), dest.c_str()) == -1) {
+		std::string error_msg = "replaceFile (" + dest + ")";
+		perror(error_msg.c_str());
+		return false;
+	}
+	return true;
+}
+
+void PlatformSleep(float seconds) {
+	if (seconds <= 0)
+		return;
+
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(seconds);
+	ts.tv_nsec = static_cast<long>((seconds - static_cast<float>(ts.tv_sec)) * 1000000000.f);
+
+	// nanosleep() writes the time that was left into ts if it gets interrupted
+	while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+int PlatformGetThermalState() {
+	return PLATFORM_THERMAL_NOMINAL;
+}
+
+bool PlatformIsLowPowerMode() {
+	return false;
+}
+
 #endif // PLATFORM_CPP
 #endif // PLATFORM_CPP_INCLUDE
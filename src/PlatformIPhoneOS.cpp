@@ -30,6 +30,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <errno.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <objc/runtime.h>
+#include <objc/message.h>
 
 PlatformOptions_t PlatformOptions = {false, true, CONFIG_MENU_TYPE_BASE, "sdl_hardware"};
 
@@ -188,5 +193,70 @@ bool PlatformDirRemove(const std::string& path) {
 	return true;
 }
 
+bool PlatformFileReplace(const std::string& src, const std::string& dest) {
+	// make sure the new contents are on disk before they replace the old file
+	int fd = open(src.c_str(), O_RDONLY);
+	if (fd != -1) {
+		fsync(fd);
+		close(fd);
+	}
+
+	if (rename(src.c_str(), dest.c_str()) == -1) {
+		std::string error_msg = "replaceFile (" + dest + ")";
+		perror(error_msg.c_str());
+		return false;
+	}
+	return true;
+}
+
+void PlatformSleep(float seconds) {
+	if (seconds <= 0)
+		return;
+
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(seconds);
+	ts.tv_nsec = static_cast<long>((seconds - static_cast<float>(ts.tv_sec)) * 1000000000.f);
+
+	// nanosleep() writes the time that was left into ts if it gets interrupted
+	while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+// this file isn't Objective-C, so NSProcessInfo is reached through the runtime
+// returns NULL if the OS is too old to have the property
+id IPhoneOSGetProcessInfo(SEL property) {
+	Class clazz = objc_getClass("NSProcessInfo");
+	if (!clazz)
+		return NULL;
+
+	id info = ((id (*)(Class, SEL))objc_msgSend)(clazz, sel_registerName("processInfo"));
+	if (!info || !class_respondsToSelector(object_getClass(info), property))
+		return NULL;
+
+	return info;
+}
+
+int PlatformGetThermalState() {
+	// iOS 11; NSProcessInfoThermalState uses the same values as PLATFORM_THERMAL_*
+	SEL property = sel_registerName("thermalState");
+	id info = IPhoneOSGetProcessInfo(property);
+	if (!info)
+		return PLATFORM_THERMAL_NOMINAL;
+
+	long state = ((long (*)(id, SEL))objc_msgSend)(info, property);
+	if (state < PLATFORM_THERMAL_NOMINAL || state > PLATFORM_THERMAL_CRITICAL)
+		return PLATFORM_THERMAL_NOMINAL;
+	return static_cast<int>(state);
+}
+
+bool PlatformIsLowPowerMode() {
+	// iOS 9
+	SEL property = sel_registerName("isLowPowerModeEnabled");
+	id info = IPhoneOSGetProcessInfo(property);
+	if (!info)
+		return false;
+
+	return ((BOOL (*)(id, SEL))objc_msgSend)(info, property) ? true : false;
+}
+
 #endif // PLATFORM_CPP
 #endif // PLATFORM_CPP_INCLUDE
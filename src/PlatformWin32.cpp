@@ -26,6 +26,10 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <stdlib.h>
 
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
 PlatformOptions_t PlatformOptions = {true, false, CONFIG_MENU_TYPE_DESKTOP, ""};
 
 void PlatformInit(struct PlatformOptions_t *options) {
@@ -91,5 +95,49 @@ bool PlatformDirRemove(const std::string& path) {
 	return true;
 }
 
+bool PlatformFileReplace(const std::string& src, const std::string& dest) {
+	if (!MoveFileExA(src.c_str(), dest.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		std::string error_msg = "replaceFile (" + dest + ")";
+		perror(error_msg.c_str());
+		return false;
+	}
+	return true;
+}
+
+void PlatformSleep(float seconds) {
+	if (seconds <= 0)
+		return;
+
+	// Sleep() is limited to the system timer tick, which is 15.6ms by default
+	static HANDLE timer = NULL;
+	if (!timer) {
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+		timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+		if (!timer)
+			timer = CreateWaitableTimer(NULL, TRUE, NULL);
+	}
+
+	if (timer) {
+		// negative values are relative, in 100 nanosecond units
+		LARGE_INTEGER due;
+		due.QuadPart = -static_cast<LONGLONG>(seconds * 10000000.f);
+		if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+			WaitForSingleObject(timer, INFINITE);
+			return;
+		}
+	}
+
+	Sleep(static_cast<DWORD>(seconds * 1000.f));
+}
+
+int PlatformGetThermalState() {
+	return PLATFORM_THERMAL_NOMINAL;
+}
+
+bool PlatformIsLowPowerMode() {
+	return false;
+}
+
 #endif // PLATFORM_CPP
 #endif // PLATFORM_CPP_INCLUDE
@@ -27,11 +27,13 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Animation.h"
 #include "AnimationManager.h"
 #include "AnimationSet.h"
+#include "EffectManager.h"
 #include "EnemyManager.h"
 #include "EventManager.h"
 #include "FileParser.h"
 #include "Hazard.h"
 #include "MapCollision.h"
+#include "MemoryUsage.h"
 #include "PowerManager.h"
 #include "Settings.h"
 #include "SharedGameResources.h"
@@ -44,6 +46,202 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <cmath>
 #include <climits>
 
+// the attributes of powers/powers.txt
+enum {
+	POWER_KEY_ID,
+	POWER_KEY_TYPE,
+	POWER_KEY_NAME,
+	POWER_KEY_DESCRIPTION,
+	POWER_KEY_ICON,
+	POWER_KEY_NEW_STATE,
+	POWER_KEY_STATE_DURATION,
+	POWER_KEY_PREVENT_INTERRUPT,
+	POWER_KEY_FACE,
+	POWER_KEY_SOURCE_TYPE,
+	POWER_KEY_BEACON,
+	POWER_KEY_COUNT,
+	POWER_KEY_PASSIVE,
+	POWER_KEY_PASSIVE_TRIGGER,
+	POWER_KEY_META_POWER,
+	POWER_KEY_REQUIRES_FLAGS,
+	POWER_KEY_REQUIRES_MP,
+	POWER_KEY_REQUIRES_HP,
+	POWER_KEY_SACRIFICE,
+	POWER_KEY_REQUIRES_LOS,
+	POWER_KEY_REQUIRES_EMPTY_TARGET,
+	POWER_KEY_REQUIRES_ITEM,
+	POWER_KEY_REQUIRES_EQUIPPED_ITEM,
+	POWER_KEY_REQUIRES_TARGETING,
+	POWER_KEY_REQUIRES_SPAWNS,
+	POWER_KEY_COOLDOWN,
+	POWER_KEY_ANIMATION,
+	POWER_KEY_SOUNDFX,
+	POWER_KEY_SOUNDFX_HIT,
+	POWER_KEY_DIRECTIONAL,
+	POWER_KEY_VISUAL_RANDOM,
+	POWER_KEY_VISUAL_OPTION,
+	POWER_KEY_AIM_ASSIST,
+	POWER_KEY_SPEED,
+	POWER_KEY_LIFESPAN,
+	POWER_KEY_FLOOR,
+	POWER_KEY_COMPLETE_ANIMATION,
+	POWER_KEY_CHARGE_SPEED,
+	POWER_KEY_ATTACK_SPEED,
+	POWER_KEY_USE_HAZARD,
+	POWER_KEY_NO_ATTACK,
+	POWER_KEY_RADIUS,
+	POWER_KEY_BASE_DAMAGE,
+	POWER_KEY_STARTING_POS,
+	POWER_KEY_RELATIVE_POS,
+	POWER_KEY_MULTITARGET,
+	POWER_KEY_MULTIHIT,
+	POWER_KEY_EXPIRE_WITH_CASTER,
+	POWER_KEY_IGNORE_ZERO_DAMAGE,
+	POWER_KEY_LOCK_TARGET_TO_DIRECTION,
+	POWER_KEY_MOVEMENT_TYPE,
+	POWER_KEY_TRAIT_ARMOR_PENETRATION,
+	POWER_KEY_TRAIT_AVOIDANCE_IGNORE,
+	POWER_KEY_TRAIT_CRITS_IMPAIRED,
+	POWER_KEY_TRAIT_ELEMENTAL,
+	POWER_KEY_TARGET_RANGE,
+	POWER_KEY_HP_STEAL,
+	POWER_KEY_MP_STEAL,
+	POWER_KEY_MISSILE_ANGLE,
+	POWER_KEY_ANGLE_VARIANCE,
+	POWER_KEY_SPEED_VARIANCE,
+	POWER_KEY_DELAY,
+	POWER_KEY_TRANSFORM_DURATION,
+	POWER_KEY_MANUAL_UNTRANSFORM,
+	POWER_KEY_KEEP_EQUIPMENT,
+	POWER_KEY_UNTRANSFORM_ON_HIT,
+	POWER_KEY_BUFF,
+	POWER_KEY_BUFF_TELEPORT,
+	POWER_KEY_BUFF_PARTY,
+	POWER_KEY_BUFF_PARTY_POWER_ID,
+	POWER_KEY_POST_EFFECT,
+	POWER_KEY_PRE_POWER,
+	POWER_KEY_POST_POWER,
+	POWER_KEY_WALL_POWER,
+	POWER_KEY_WALL_REFLECT,
+	POWER_KEY_SPAWN_TYPE,
+	POWER_KEY_TARGET_NEIGHBOR,
+	POWER_KEY_SPAWN_LIMIT,
+	POWER_KEY_SPAWN_LEVEL,
+	POWER_KEY_TARGET_PARTY,
+	POWER_KEY_TARGET_CATEGORIES,
+	POWER_KEY_MODIFIER_ACCURACY,
+	POWER_KEY_MODIFIER_DAMAGE,
+	POWER_KEY_MODIFIER_CRITICAL,
+	POWER_KEY_TARGET_MOVEMENT_NORMAL,
+	POWER_KEY_TARGET_MOVEMENT_FLYING,
+	POWER_KEY_TARGET_MOVEMENT_INTANGIBLE,
+	POWER_KEY_WALLS_BLOCK_AOE,
+	POWER_KEY_SCRIPT,
+	POWER_KEY_REMOVE_EFFECT,
+	POWER_KEY_REPLACE_BY_EFFECT,
+	POWER_KEY_REQUIRES_CORPSE,
+	POWER_KEY_TARGET_NEAREST,
+	POWER_KEYS_COUNT
+};
+
+static const char* const POWER_KEYS[POWER_KEYS_COUNT] = {
+	"id",
+	"type",
+	"name",
+	"description",
+	"icon",
+	"new_state",
+	"state_duration",
+	"prevent_interrupt",
+	"face",
+	"source_type",
+	"beacon",
+	"count",
+	"passive",
+	"passive_trigger",
+	"meta_power",
+	"requires_flags",
+	"requires_mp",
+	"requires_hp",
+	"sacrifice",
+	"requires_los",
+	"requires_empty_target",
+	"requires_item",
+	"requires_equipped_item",
+	"requires_targeting",
+	"requires_spawns",
+	"cooldown",
+	"animation",
+	"soundfx",
+	"soundfx_hit",
+	"directional",
+	"visual_random",
+	"visual_option",
+	"aim_assist",
+	"speed",
+	"lifespan",
+	"floor",
+	"complete_animation",
+	"charge_speed",
+	"attack_speed",
+	"use_hazard",
+	"no_attack",
+	"radius",
+	"base_damage",
+	"starting_pos",
+	"relative_pos",
+	"multitarget",
+	"multihit",
+	"expire_with_caster",
+	"ignore_zero_damage",
+	"lock_target_to_direction",
+	"movement_type",
+	"trait_armor_penetration",
+	"trait_avoidance_ignore",
+	"trait_crits_impaired",
+	"trait_elemental",
+	"target_range",
+	"hp_steal",
+	"mp_steal",
+	"missile_angle",
+	"angle_variance",
+	"speed_variance",
+	"delay",
+	"transform_duration",
+	"manual_untransform",
+	"keep_equipment",
+	"untransform_on_hit",
+	"buff",
+	"buff_teleport",
+	"buff_party",
+	"buff_party_power_id",
+	"post_effect",
+	"pre_power",
+	"post_power",
+	"wall_power",
+	"wall_reflect",
+	"spawn_type",
+	"target_neighbor",
+	"spawn_limit",
+	"spawn_level",
+	"target_party",
+	"target_categories",
+	"modifier_accuracy",
+	"modifier_damage",
+	"modifier_critical",
+	"target_movement_normal",
+	"target_movement_flying",
+	"target_movement_intangible",
+	"walls_block_aoe",
+	"script",
+	"remove_effect",
+	"replace_by_effect",
+	"requires_corpse",
+	"target_nearest"
+};
+
+static const ParserKeyTable power_keys(POWER_KEYS, POWER_KEYS_COUNT);
+
 /**
  * PowerManager constructor
  */
@@ -59,7 +257,7 @@ void PowerManager::loadEffects() {
 	FileParser infile;
 
 	// @CLASS Effects|Description of powers/effects.txt
-	if (!infile.open("powers/effects.txt"))
+	if (!infile.openCached("powers/effects.txt"))
 		return;
 
 	while (infile.next()) {
@@ -95,8 +293,6 @@ void PowerManager::loadEffects() {
 		else if (infile.key == "animation") {
 			// @ATTR effect.animation|filename|The filename of effect animation.
 			effects.back().animation = infile.val;
-			anim->increaseCount(effects.back().animation);
-			anim->getAnimationSet(effects.back().animation)->getAnimation("");
 		}
 		else if (infile.key == "can_stack") {
 			// @ATTR effect.can_stack|bool|Allows multiple instances of this effect
@@ -136,13 +332,19 @@ void PowerManager::loadEffects() {
 	if (!effects.empty() && effects.back().id == "") {
 		effects.pop_back();
 	}
+
+	// if an id is used more than once, the first definition is the one that gets used
+	for (size_t i = 0; i < effects.size(); ++i) {
+		EffectManager::resolveEffectDef(effects[i]);
+		effect_index.insert(std::pair<std::string, size_t>(effects[i].id, i));
+	}
 }
 
 void PowerManager::loadPowers() {
 	FileParser infile;
 
 	// @CLASS Powers|Description of powers/powers.txt
-	if (!infile.open("powers/powers.txt"))
+	if (!infile.openCached("powers/powers.txt"))
 		return;
 
 	bool clear_post_effects = true;
@@ -153,14 +355,18 @@ void PowerManager::loadPowers() {
 	while (infile.next()) {
 		// id needs to be the first component of each power.  That is how we write
 		// data to the correct power.
-		if (infile.key == "id") {
+		const int key = power_keys.get(infile.key);
+
+		if (key == POWER_KEY_ID) {
 			// @ATTR power.id|power_id|Uniq identifier for the power definition.
 			input_id = toInt(infile.val);
 			skippingEntry = input_id < 1;
 			if (skippingEntry)
 				infile.error("PowerManager: Power index out of bounds 1-%d, skipping power.", INT_MAX);
-			if (static_cast<int>(powers.size()) < input_id + 1)
+			if (static_cast<int>(powers.size()) < input_id + 1) {
 				powers.resize(input_id + 1);
+				power_text.resize(input_id + 1);
+			}
 
 			clear_post_effects = true;
 
@@ -169,502 +375,689 @@ void PowerManager::loadPowers() {
 		if (skippingEntry)
 			continue;
 
-		if (infile.key == "type") {
-			// @ATTR power.type|["fixed", "missile", "repeater", "spawn", "transform", "block"]|Defines the type of power definiton
-			if (infile.val == "fixed") powers[input_id].type = POWTYPE_FIXED;
-			else if (infile.val == "missile") powers[input_id].type = POWTYPE_MISSILE;
-			else if (infile.val == "repeater") powers[input_id].type = POWTYPE_REPEATER;
-			else if (infile.val == "spawn") powers[input_id].type = POWTYPE_SPAWN;
-			else if (infile.val == "transform") powers[input_id].type = POWTYPE_TRANSFORM;
-			else if (infile.val == "block") powers[input_id].type = POWTYPE_BLOCK;
-			else infile.error("PowerManager: Unknown type '%s'", infile.val.c_str());
-		}
-		else if (infile.key == "name")
-			// @ATTR power.name|string|The name of the power
-			powers[input_id].name = msg->get(infile.val);
-		else if (infile.key == "description")
-			// @ATTR power.description|string|Description of the power
-			powers[input_id].description = msg->get(infile.val);
-		else if (infile.key == "icon")
-			// @ATTR power.icon|icon_id|The icon to visually represent the power eg. in skill tree or action bar.
-			powers[input_id].icon = toInt(infile.val);
-		else if (infile.key == "new_state") {
-			// @ATTR power.new_state|predefined_string|When power is used, hero or enemy will change to this state. Must be one of the states ["instant", user defined]
-			if (infile.val == "instant") powers[input_id].new_state = POWSTATE_INSTANT;
-			else {
-				powers[input_id].new_state = POWSTATE_ATTACK;
-				powers[input_id].attack_anim = infile.val;
+		switch (key) {
+			case POWER_KEY_TYPE: {
+				// @ATTR power.type|["fixed", "missile", "repeater", "spawn", "transform", "block"]|Defines the type of power definiton
+				if (infile.val == "fixed") powers[input_id].type = POWTYPE_FIXED;
+				else if (infile.val == "missile") powers[input_id].type = POWTYPE_MISSILE;
+				else if (infile.val == "repeater") powers[input_id].type = POWTYPE_REPEATER;
+				else if (infile.val == "spawn") powers[input_id].type = POWTYPE_SPAWN;
+				else if (infile.val == "transform") powers[input_id].type = POWTYPE_TRANSFORM;
+				else if (infile.val == "block") powers[input_id].type = POWTYPE_BLOCK;
+				else infile.error("PowerManager: Unknown type '%s'", infile.val.c_str());
+				break;
 			}
-		}
-		else if (infile.key == "state_duration") {
-			// @ATTR power.state_duration|duration|Sets the length of time the caster is in their state animation. A time longer than the animation length will cause the animation to pause on the last frame. Times shorter than the state animation length will have no effect.
-			powers[input_id].state_duration = parse_duration(infile.val);
-		}
-		else if (infile.key == "prevent_interrupt") {
-			// @ATTR prevent_interrupt|bool|Prevents the caster from being interrupted by a hit when casting this power.
-			powers[input_id].prevent_interrupt = toBool(infile.val);
-		}
-		else if (infile.key == "face")
-			// @ATTR power.face|bool|Power will make hero or enemy to face the target location.
-			powers[input_id].face = toBool(infile.val);
-		else if (infile.key == "source_type") {
-			// @ATTR power.source_type|["hero", "neutral", "enemy"]|Determines which entities the power can effect.
-			if (infile.val == "hero") powers[input_id].source_type = SOURCE_TYPE_HERO;
-			else if (infile.val == "neutral") powers[input_id].source_type = SOURCE_TYPE_NEUTRAL;
-			else if (infile.val == "enemy") powers[input_id].source_type = SOURCE_TYPE_ENEMY;
-			else infile.error("PowerManager: Unknown source_type '%s'", infile.val.c_str());
-		}
-		else if (infile.key == "beacon")
-			// @ATTR power.beacon|bool|True if enemy is calling its allies.
-			powers[input_id].beacon = toBool(infile.val);
-		else if (infile.key == "count")
-			// @ATTR power.count|int|The count of hazards/effect or spawns to be created by this power.
-			powers[input_id].count = toInt(infile.val);
-		else if (infile.key == "passive")
-			// @ATTR power.passive|bool|If power is unlocked when the hero or enemy spawns it will be automatically activated.
-			powers[input_id].passive = toBool(infile.val);
-		else if (infile.key == "passive_trigger") {
-			// @ATTR power.passive_trigger|["on_block", "on_hit", "on_halfdeath", "on_joincombat", "on_death"]|This will only activate a passive power under a certain condition.
-			if (infile.val == "on_block") powers[input_id].passive_trigger = TRIGGER_BLOCK;
-			else if (infile.val == "on_hit") powers[input_id].passive_trigger = TRIGGER_HIT;
-			else if (infile.val == "on_halfdeath") powers[input_id].passive_trigger = TRIGGER_HALFDEATH;
-			else if (infile.val == "on_joincombat") powers[input_id].passive_trigger = TRIGGER_JOINCOMBAT;
-			else if (infile.val == "on_death") powers[input_id].passive_trigger = TRIGGER_DEATH;
-			else infile.error("PowerManager: Unknown passive trigger '%s'", infile.val.c_str());
-		}
-		else if (infile.key == "meta_power") {
-			// @ATTR power.meta_power|bool|If true, this power can not be used on it's own. Instead, it should be replaced via an item with a replace_power entry.
-			powers[input_id].meta_power = toBool(infile.val);
-		}
-		// power requirements
-		else if (infile.key == "requires_flags") {
-			// @ATTR power.requires_flags|list(predefined_string)|A comma separated list of equip flags that are required to use this power. See engine/equip_flags.txt
-			powers[input_id].requires_flags.clear();
-			std::string flag = popFirstString(infile.val);
-
-			while (flag != "") {
-				powers[input_id].requires_flags.insert(flag);
-				flag = popFirstString(infile.val);
+
+			case POWER_KEY_NAME:
+				// @ATTR power.name|string|The name of the power
+				power_text[input_id].name = msg->get(infile.val);
+				break;
+
+			case POWER_KEY_DESCRIPTION:
+				// @ATTR power.description|string|Description of the power
+				power_text[input_id].description = msg->get(infile.val);
+				break;
+
+			case POWER_KEY_ICON:
+				// @ATTR power.icon|icon_id|The icon to visually represent the power eg. in skill tree or action bar.
+				powers[input_id].icon = toInt(infile.val);
+				break;
+
+			case POWER_KEY_NEW_STATE: {
+				// @ATTR power.new_state|predefined_string|When power is used, hero or enemy will change to this state. Must be one of the states ["instant", user defined]
+				if (infile.val == "instant") powers[input_id].new_state = POWSTATE_INSTANT;
+				else {
+					powers[input_id].new_state = POWSTATE_ATTACK;
+					powers[input_id].attack_anim = infile.val;
+					powers[input_id].attack_anim_name = internString(infile.val);
+				}
+				break;
 			}
-		}
-		else if (infile.key == "requires_mp")
-			// @ATTR power.requires_mp|int|Restrict power usage to a specified MP level.
-			powers[input_id].requires_mp = toInt(infile.val);
-		else if (infile.key == "requires_hp")
-			// @ATTR power.requires_hp|int|Restrict power usage to a specified HP level.
-			powers[input_id].requires_hp = toInt(infile.val);
-		else if (infile.key == "sacrifice")
-			// @ATTR power.sacrifice|bool|If the power has requires_hp, allow it to kill the caster.
-			powers[input_id].sacrifice = toBool(infile.val);
-		else if (infile.key == "requires_los")
-			// @ATTR power.requires_los|bool|Requires a line-of-sight to target.
-			powers[input_id].requires_los = toBool(infile.val);
-		else if (infile.key == "requires_empty_target")
-			// @ATTR power.requires_empty_target|bool|The power can only be cast when target tile is empty.
-			powers[input_id].requires_empty_target = toBool(infile.val);
-		else if (infile.key == "requires_item") {
-			// @ATTR power.requires_item|item_id, int : Item, Quantity|Requires a specific item of a specific quantity in inventory.
-			powers[input_id].requires_item = popFirstInt(infile.val);
-			powers[input_id].requires_item_quantity = toInt(popFirstString(infile.val), 1);
-		}
-		else if (infile.key == "requires_equipped_item") {
-			// @ATTR power.requires_equipped_item|item_id, int : Item, Quantity|Requires a specific item of a specific quantity to be equipped on hero.
-			powers[input_id].requires_equipped_item = popFirstInt(infile.val);
-			powers[input_id].requires_equipped_item_quantity = popFirstInt(infile.val);
-
-			// a maximum of 1 equipped item can be consumed at a time
-			if (powers[input_id].requires_equipped_item_quantity > 1) {
-				infile.error("PowerManager: Only 1 equipped item can be consumed at a time.");
-				powers[input_id].requires_equipped_item_quantity = std::min(powers[input_id].requires_equipped_item_quantity, 1);
+
+			case POWER_KEY_STATE_DURATION: {
+				// @ATTR power.state_duration|duration|Sets the length of time the caster is in their state animation. A time longer than the animation length will cause the animation to pause on the last frame. Times shorter than the state animation length will have no effect.
+				powers[input_id].state_duration = parse_duration(infile.val);
+				break;
 			}
-		}
-		else if (infile.key == "requires_targeting")
-			// @ATTR power.requires_targeting|bool|Power is only used when targeting using click-to-target.
-			powers[input_id].requires_targeting = toBool(infile.val);
-		else if (infile.key == "requires_spawns")
-			// @ATTR power.requires_spawns|int|The caster must have at least this many summoned creatures to use this power.
-			powers[input_id].requires_spawns = toInt(infile.val);
-		else if (infile.key == "cooldown")
-			// @ATTR power.cooldown|duration|Specify the duration for cooldown of the power in 'ms' or 's'.
-			powers[input_id].cooldown = parse_duration(infile.val);
-		// animation info
-		else if (infile.key == "animation") {
-			// @ATTR power.animation|filename|The filename of the power animation.
-			powers[input_id].animation_name = infile.val;
-			anim->increaseCount(powers[input_id].animation_name);
-			anim->getAnimationSet(powers[input_id].animation_name)->getAnimation("");
-		}
-		else if (infile.key == "soundfx")
-			// @ATTR power.soundfx|filename|Filename of a sound effect to play when the power is used.
-			powers[input_id].sfx_index = loadSFX(infile.val);
-		else if (infile.key == "soundfx_hit") {
-			// @ATTR power.soundfx_hit|filename|Filename of a sound effect to play when the power's hazard hits a valid target.
-			int sfx_id = loadSFX(infile.val);
-			if (sfx_id != -1) {
-				powers[input_id].sfx_hit = sfx[sfx_id];
-				powers[input_id].sfx_hit_enable = true;
+
+			case POWER_KEY_PREVENT_INTERRUPT: {
+				// @ATTR prevent_interrupt|bool|Prevents the caster from being interrupted by a hit when casting this power.
+				powers[input_id].prevent_interrupt = toBool(infile.val);
+				break;
 			}
-		}
-		else if (infile.key == "directional")
-			// @ATTR power.directional|bool|The animation sprite sheet contains 8 directions, one per row.
-			powers[input_id].directional = toBool(infile.val);
-		else if (infile.key == "visual_random")
-			// @ATTR power.visual_random|int|The animation sprite sheet contains rows of random options
-			powers[input_id].visual_random = toInt(infile.val);
-		else if (infile.key == "visual_option")
-			// @ATTR power.visual_option|int|The animation sprite sheet containers rows of similar effects, use a specific option. If using visual_random, this serves as an offset for the lowest random index.
-			powers[input_id].visual_option = toInt(infile.val);
-		else if (infile.key == "aim_assist")
-			// @ATTR power.aim_assist|bool|If true, power targeting will be offset vertically by the number of pixels set with "aim_assist" in engine/misc.txt.
-			powers[input_id].aim_assist = toBool(infile.val);
-		else if (infile.key == "speed")
-			// @ATTR power.speed|float|The speed of missile hazard, the unit is defined as map units per frame.
-			powers[input_id].speed = toFloat(infile.val) / MAX_FRAMES_PER_SEC;
-		else if (infile.key == "lifespan")
-			// @ATTR power.lifespan|duration|How long the hazard/animation lasts in 'ms' or 's'.
-			powers[input_id].lifespan = parse_duration(infile.val);
-		else if (infile.key == "floor")
-			// @ATTR power.floor|bool|The hazard is drawn between the background and the object layer.
-			powers[input_id].floor = toBool(infile.val);
-		else if (infile.key == "complete_animation")
-			// @ATTR power.complete_animation|bool|For hazards; Play the entire animation, even if the hazard has hit a target.
-			powers[input_id].complete_animation = toBool(infile.val);
-		else if (infile.key == "charge_speed")
-			// @ATTR power.charge_speed|float|Moves the caster at this speed in the direction they are facing until the state animation is finished.
-			powers[input_id].charge_speed = toFloat(infile.val) / MAX_FRAMES_PER_SEC;
-		else if (infile.key == "attack_speed") {
-			// @ATTR power.attack_speed|int|Changes attack animation speed for this Power. A value of 100 is 100% speed (aka normal speed).
-			powers[input_id].attack_speed = static_cast<float>(toInt(infile.val));
-			if (powers[input_id].attack_speed < 100) {
-				logInfo("PowerManager: Attack speeds less than 100 are unsupported.");
-				powers[input_id].attack_speed = 100;
+
+			case POWER_KEY_FACE:
+				// @ATTR power.face|bool|Power will make hero or enemy to face the target location.
+				powers[input_id].face = toBool(infile.val);
+				break;
+
+			case POWER_KEY_SOURCE_TYPE: {
+				// @ATTR power.source_type|["hero", "neutral", "enemy"]|Determines which entities the power can effect.
+				if (infile.val == "hero") powers[input_id].source_type = SOURCE_TYPE_HERO;
+				else if (infile.val == "neutral") powers[input_id].source_type = SOURCE_TYPE_NEUTRAL;
+				else if (infile.val == "enemy") powers[input_id].source_type = SOURCE_TYPE_ENEMY;
+				else infile.error("PowerManager: Unknown source_type '%s'", infile.val.c_str());
+				break;
 			}
-		}
-		// hazard traits
-		else if (infile.key == "use_hazard")
-			// @ATTR power.use_hazard|bool|Power uses hazard.
-			powers[input_id].use_hazard = toBool(infile.val);
-		else if (infile.key == "no_attack")
-			// @ATTR power.no_attack|bool|Hazard won't affect other entities.
-			powers[input_id].no_attack = toBool(infile.val);
-		else if (infile.key == "radius")
-			// @ATTR power.radius|float|Radius in pixels
-			powers[input_id].radius = toFloat(infile.val);
-		else if (infile.key == "base_damage") {
-			// @ATTR power.base_damage|["melee", "ranged", "ment"]|Determines which of the three primary damage stats will be used to calculate damage.
-			if (infile.val == "none")        powers[input_id].base_damage = BASE_DAMAGE_NONE;
-			else if (infile.val == "melee")  powers[input_id].base_damage = BASE_DAMAGE_MELEE;
-			else if (infile.val == "ranged") powers[input_id].base_damage = BASE_DAMAGE_RANGED;
-			else if (infile.val == "ment")   powers[input_id].base_damage = BASE_DAMAGE_MENT;
-			else infile.error("PowerManager: Unknown base_damage '%s'", infile.val.c_str());
-		}
-		else if (infile.key == "starting_pos") {
-			// @ATTR power.starting_pos|["source", "target", "melee"]|Start position for hazard
-			if (infile.val == "source")      powers[input_id].starting_pos = STARTING_POS_SOURCE;
-			else if (infile.val == "target") powers[input_id].starting_pos = STARTING_POS_TARGET;
-			else if (infile.val == "melee")  powers[input_id].starting_pos = STARTING_POS_MELEE;
-			else infile.error("PowerManager: Unknown starting_pos '%s'", infile.val.c_str());
-		}
-		else if (infile.key == "relative_pos") {
-			// @ATTR power.relative_pos|bool|Hazard will move relative to the caster's position.
-			powers[input_id].relative_pos = toBool(infile.val);
-		}
-		else if (infile.key == "multitarget")
-			// @ATTR power.multitarget|bool|Allows a hazard power to hit more than one entity.
-			powers[input_id].multitarget = toBool(infile.val);
-		else if (infile.key == "multihit")
-			// @ATTR power.multihit|bool|Allows a hazard power to hit the same entity more than once.
-			powers[input_id].multihit = toBool(infile.val);
-		else if (infile.key == "expire_with_caster")
-			// @ATTR power.expire_with_caster|bool|If true, hazard will disappear when the caster dies.
-			powers[input_id].expire_with_caster = toBool(infile.val);
-		else if (infile.key == "ignore_zero_damage")
-			// @ATTR power.ignore_zero_damage|bool|If true, hazard can still hit the player when damage is 0, triggering post_power and post_effects.
-			powers[input_id].ignore_zero_damage = toBool(infile.val);
-		else if (infile.key == "lock_target_to_direction")
-			// @ATTR power.lock_target_to_direction|bool|If true, the target is "snapped" to one of the 8 directions.
-			powers[input_id].lock_target_to_direction = toBool(infile.val);
-		else if (infile.key == "movement_type") {
-			// @ATTR power.movement_type|["ground", "flying", "intangible"]|For moving hazards (missile/repeater), this defines which parts of the map it can collide with. The default is "flying".
-			if (infile.val == "ground")         powers[input_id].movement_type = MOVEMENT_NORMAL;
-			else if (infile.val == "flying")    powers[input_id].movement_type = MOVEMENT_FLYING;
-			else if (infile.val == "intangible") powers[input_id].movement_type = MOVEMENT_INTANGIBLE;
-			else infile.error("PowerManager: Unknown movement_type '%s'", infile.val.c_str());
-		}
-		else if (infile.key == "trait_armor_penetration")
-			// @ATTR power.trait_armor_penetration|bool|Ignores the target's Absorbtion stat
-			powers[input_id].trait_armor_penetration = toBool(infile.val);
-		else if (infile.key == "trait_avoidance_ignore")
-			// @ATTR power.trait_avoidance_ignore|bool|Ignores the target's Avoidance stat
-			powers[input_id].trait_avoidance_ignore = toBool(infile.val);
-		else if (infile.key == "trait_crits_impaired")
-			// @ATTR power.trait_crits_impaired|int|Increases critical hit percentage for slowed/immobile targets
-			powers[input_id].trait_crits_impaired = toInt(infile.val);
-		else if (infile.key == "trait_elemental") {
-			// @ATTR power.trait_elemental|predefined_string|Damage done is elemental. See engine/elements.txt
-			for (unsigned int i=0; i<ELEMENTS.size(); i++) {
-				if (infile.val == ELEMENTS[i].id) powers[input_id].trait_elemental = i;
+
+			case POWER_KEY_BEACON:
+				// @ATTR power.beacon|bool|True if enemy is calling its allies.
+				powers[input_id].beacon = toBool(infile.val);
+				break;
+
+			case POWER_KEY_COUNT:
+				// @ATTR power.count|int|The count of hazards/effect or spawns to be created by this power.
+				powers[input_id].count = toInt(infile.val);
+				break;
+
+			case POWER_KEY_PASSIVE:
+				// @ATTR power.passive|bool|If power is unlocked when the hero or enemy spawns it will be automatically activated.
+				powers[input_id].passive = toBool(infile.val);
+				break;
+
+			case POWER_KEY_PASSIVE_TRIGGER: {
+				// @ATTR power.passive_trigger|["on_block", "on_hit", "on_halfdeath", "on_joincombat", "on_death"]|This will only activate a passive power under a certain condition.
+				if (infile.val == "on_block") powers[input_id].passive_trigger = TRIGGER_BLOCK;
+				else if (infile.val == "on_hit") powers[input_id].passive_trigger = TRIGGER_HIT;
+				else if (infile.val == "on_halfdeath") powers[input_id].passive_trigger = TRIGGER_HALFDEATH;
+				else if (infile.val == "on_joincombat") powers[input_id].passive_trigger = TRIGGER_JOINCOMBAT;
+				else if (infile.val == "on_death") powers[input_id].passive_trigger = TRIGGER_DEATH;
+				else infile.error("PowerManager: Unknown passive trigger '%s'", infile.val.c_str());
+				break;
 			}
-		}
-		else if (infile.key == "target_range")
-			// @ATTR power.target_range|float|The distance from the caster that the power can be activated
-			powers[input_id].target_range = toFloat(popFirstString(infile.val));
-		//steal effects
-		else if (infile.key == "hp_steal")
-			// @ATTR power.hp_steal|int|Percentage of damage to steal into HP
-			powers[input_id].hp_steal = toInt(infile.val);
-		else if (infile.key == "mp_steal")
-			// @ATTR power.mp_steal|int|Percentage of damage to steal into MP
-			powers[input_id].mp_steal = toInt(infile.val);
-		//missile modifiers
-		else if (infile.key == "missile_angle")
-			// @ATTR power.missile_angle|int|Angle of missile
-			powers[input_id].missile_angle = toInt(infile.val);
-		else if (infile.key == "angle_variance")
-			// @ATTR power.angle_variance|int|Percentage of variance added to missile angle
-			powers[input_id].angle_variance = toInt(infile.val);
-		else if (infile.key == "speed_variance")
-			// @ATTR power.speed_variance|float|Percentage of variance added to missile speed
-			powers[input_id].speed_variance = toFloat(infile.val);
-		//repeater modifiers
-		else if (infile.key == "delay")
-			// @ATTR power.delay|duration|Delay between repeats in 'ms' or 's'.
-			powers[input_id].delay = parse_duration(infile.val);
-		// buff/debuff durations
-		else if (infile.key == "transform_duration")
-			// @ATTR power.transform_duration|duration|Duration for transform in 'ms' or 's'.
-			powers[input_id].transform_duration = parse_duration(infile.val);
-		else if (infile.key == "manual_untransform")
-			// @ATTR power.manual_untransform|bool|Force manual untranform
-			powers[input_id].manual_untransform = toBool(infile.val);
-		else if (infile.key == "keep_equipment")
-			// @ATTR power.keep_equipment|bool|Keep equipment while transformed
-			powers[input_id].keep_equipment = toBool(infile.val);
-		else if (infile.key == "untransform_on_hit")
-			// @ATTR power.untransform_on_hit|bool|Force untransform when the player is hit
-			powers[input_id].untransform_on_hit = toBool(infile.val);
-		// buffs
-		else if (infile.key == "buff")
-			// @ATTR power.buff|bool|Power is cast upon the caster.
-			powers[input_id].buff= toBool(infile.val);
-		else if (infile.key == "buff_teleport")
-			// @ATTR power.buff_teleport|bool|Power is a teleportation power.
-			powers[input_id].buff_teleport = toBool(infile.val);
-		else if (infile.key == "buff_party")
-			// @ATTR power.buff_party|bool|Power is cast upon party members
-			powers[input_id].buff_party = toBool(infile.val);
-		else if (infile.key == "buff_party_power_id")
-			// @ATTR power.buff_party_power_id|power_id|Only party members that were spawned with this power ID are affected by "buff_party=true". Setting this to 0 will affect all party members.
-			powers[input_id].buff_party_power_id = toInt(infile.val);
-		else if (infile.key == "post_effect") {
-			// @ATTR power.post_effect|predefined_string, int, duration , int: Effect ID, Magnitude, Duration, Chance to apply|Post effect. Duration is in 'ms' or 's'.
-			if (clear_post_effects) {
-				powers[input_id].post_effects.clear();
-				clear_post_effects = false;
+
+			case POWER_KEY_META_POWER: {
+				// @ATTR power.meta_power|bool|If true, this power can not be used on it's own. Instead, it should be replaced via an item with a replace_power entry.
+				powers[input_id].meta_power = toBool(infile.val);
+				break;
+			}
+
+			// power requirements
+			case POWER_KEY_REQUIRES_FLAGS: {
+				// @ATTR power.requires_flags|list(predefined_string)|A comma separated list of equip flags that are required to use this power. See engine/equip_flags.txt
+				powers[input_id].requires_flags.clear();
+				std::string flag = popFirstString(infile.val);
+
+				while (flag != "") {
+					powers[input_id].requires_flags.insert(internString(flag));
+					flag = popFirstString(infile.val);
+				}
+				break;
 			}
-			PostEffect pe;
-			pe.id = popFirstString(infile.val);
-			if (!isValidEffect(pe.id)) {
-				infile.error("PowerManager: Unknown effect '%s'", pe.id.c_str());
+
+			case POWER_KEY_REQUIRES_MP:
+				// @ATTR power.requires_mp|int|Restrict power usage to a specified MP level.
+				powers[input_id].requires_mp = toInt(infile.val);
+				break;
+
+			case POWER_KEY_REQUIRES_HP:
+				// @ATTR power.requires_hp|int|Restrict power usage to a specified HP level.
+				powers[input_id].requires_hp = toInt(infile.val);
+				break;
+
+			case POWER_KEY_SACRIFICE:
+				// @ATTR power.sacrifice|bool|If the power has requires_hp, allow it to kill the caster.
+				powers[input_id].sacrifice = toBool(infile.val);
+				break;
+
+			case POWER_KEY_REQUIRES_LOS:
+				// @ATTR power.requires_los|bool|Requires a line-of-sight to target.
+				powers[input_id].requires_los = toBool(infile.val);
+				break;
+
+			case POWER_KEY_REQUIRES_EMPTY_TARGET:
+				// @ATTR power.requires_empty_target|bool|The power can only be cast when target tile is empty.
+				powers[input_id].requires_empty_target = toBool(infile.val);
+				break;
+
+			case POWER_KEY_REQUIRES_ITEM: {
+				// @ATTR power.requires_item|item_id, int : Item, Quantity|Requires a specific item of a specific quantity in inventory.
+				powers[input_id].requires_item = popFirstInt(infile.val);
+				powers[input_id].requires_item_quantity = toInt(popFirstString(infile.val), 1);
+				break;
 			}
-			else {
-				pe.magnitude = popFirstInt(infile.val);
-				pe.duration = parse_duration(popFirstString(infile.val));
-				std::string chance = popFirstString(infile.val);
-				if (!chance.empty()) {
-					pe.chance = toInt(chance);
+
+			case POWER_KEY_REQUIRES_EQUIPPED_ITEM: {
+				// @ATTR power.requires_equipped_item|item_id, int : Item, Quantity|Requires a specific item of a specific quantity to be equipped on hero.
+				powers[input_id].requires_equipped_item = popFirstInt(infile.val);
+				powers[input_id].requires_equipped_item_quantity = popFirstInt(infile.val);
+
+				// a maximum of 1 equipped item can be consumed at a time
+				if (powers[input_id].requires_equipped_item_quantity > 1) {
+					infile.error("PowerManager: Only 1 equipped item can be consumed at a time.");
+					powers[input_id].requires_equipped_item_quantity = std::min(powers[input_id].requires_equipped_item_quantity, 1);
 				}
-				powers[input_id].post_effects.push_back(pe);
+				break;
 			}
-		}
-		// pre and post power effects
-		else if (infile.key == "pre_power") {
-			// @ATTR power.pre_power|power_id, int : Power, Chance to cast|Trigger a power immediately when casting this one.
-			powers[input_id].pre_power = popFirstInt(infile.val);
-			std::string chance = popFirstString(infile.val);
-			if (!chance.empty()) {
-				powers[input_id].pre_power_chance = toInt(chance);
+
+			case POWER_KEY_REQUIRES_TARGETING:
+				// @ATTR power.requires_targeting|bool|Power is only used when targeting using click-to-target.
+				powers[input_id].requires_targeting = toBool(infile.val);
+				break;
+
+			case POWER_KEY_REQUIRES_SPAWNS:
+				// @ATTR power.requires_spawns|int|The caster must have at least this many summoned creatures to use this power.
+				powers[input_id].requires_spawns = toInt(infile.val);
+				break;
+
+			case POWER_KEY_COOLDOWN:
+				// @ATTR power.cooldown|duration|Specify the duration for cooldown of the power in 'ms' or 's'.
+				powers[input_id].cooldown = parse_duration(infile.val);
+				break;
+
+			// animation info
+			case POWER_KEY_ANIMATION: {
+				// @ATTR power.animation|filename|The filename of the power animation.
+				powers[input_id].animation_name = infile.val;
+				break;
 			}
-		}
-		else if (infile.key == "post_power") {
-			// @ATTR power.post_power|power_id, int : Power, Chance to cast|Trigger a power if the hazard did damage.
-			powers[input_id].post_power = popFirstInt(infile.val);
-			std::string chance = popFirstString(infile.val);
-			if (!chance.empty()) {
-				powers[input_id].post_power_chance = toInt(chance);
+
+			case POWER_KEY_SOUNDFX:
+				// @ATTR power.soundfx|filename|Filename of a sound effect to play when the power is used.
+				pending_sfx.push_back(std::pair<int, std::string>(input_id, infile.val));
+				break;
+
+			case POWER_KEY_SOUNDFX_HIT:
+				// @ATTR power.soundfx_hit|filename|Filename of a sound effect to play when the power's hazard hits a valid target.
+				pending_sfx_hit.push_back(std::pair<int, std::string>(input_id, infile.val));
+				break;
+
+			case POWER_KEY_DIRECTIONAL:
+				// @ATTR power.directional|bool|The animation sprite sheet contains 8 directions, one per row.
+				powers[input_id].directional = toBool(infile.val);
+				break;
+
+			case POWER_KEY_VISUAL_RANDOM:
+				// @ATTR power.visual_random|int|The animation sprite sheet contains rows of random options
+				powers[input_id].visual_random = toInt(infile.val);
+				break;
+
+			case POWER_KEY_VISUAL_OPTION:
+				// @ATTR power.visual_option|int|The animation sprite sheet containers rows of similar effects, use a specific option. If using visual_random, this serves as an offset for the lowest random index.
+				powers[input_id].visual_option = toInt(infile.val);
+				break;
+
+			case POWER_KEY_AIM_ASSIST:
+				// @ATTR power.aim_assist|bool|If true, power targeting will be offset vertically by the number of pixels set with "aim_assist" in engine/misc.txt.
+				powers[input_id].aim_assist = toBool(infile.val);
+				break;
+
+			case POWER_KEY_SPEED:
+				// @ATTR power.speed|float|The speed of missile hazard, the unit is defined as map units per frame.
+				powers[input_id].speed = toFloat(infile.val) / MAX_FRAMES_PER_SEC;
+				break;
+
+			case POWER_KEY_LIFESPAN:
+				// @ATTR power.lifespan|duration|How long the hazard/animation lasts in 'ms' or 's'.
+				powers[input_id].lifespan = parse_duration(infile.val);
+				break;
+
+			case POWER_KEY_FLOOR:
+				// @ATTR power.floor|bool|The hazard is drawn between the background and the object layer.
+				powers[input_id].floor = toBool(infile.val);
+				break;
+
+			case POWER_KEY_COMPLETE_ANIMATION:
+				// @ATTR power.complete_animation|bool|For hazards; Play the entire animation, even if the hazard has hit a target.
+				powers[input_id].complete_animation = toBool(infile.val);
+				break;
+
+			case POWER_KEY_CHARGE_SPEED:
+				// @ATTR power.charge_speed|float|Moves the caster at this speed in the direction they are facing until the state animation is finished.
+				powers[input_id].charge_speed = toFloat(infile.val) / MAX_FRAMES_PER_SEC;
+				break;
+
+			case POWER_KEY_ATTACK_SPEED: {
+				// @ATTR power.attack_speed|int|Changes attack animation speed for this Power. A value of 100 is 100% speed (aka normal speed).
+				powers[input_id].attack_speed = static_cast<float>(toInt(infile.val));
+				if (powers[input_id].attack_speed < 100) {
+					logInfo("PowerManager: Attack speeds less than 100 are unsupported.");
+					powers[input_id].attack_speed = 100;
+				}
+				break;
 			}
-		}
-		else if (infile.key == "wall_power") {
-			// @ATTR power.wall_power|power_id, int : Power, Chance to cast|Trigger a power if the hazard hit a wall.
-			powers[input_id].wall_power = popFirstInt(infile.val);
-			std::string chance = popFirstString(infile.val);
-			if (!chance.empty()) {
-				powers[input_id].wall_power_chance = toInt(chance);
+
+			// hazard traits
+			case POWER_KEY_USE_HAZARD:
+				// @ATTR power.use_hazard|bool|Power uses hazard.
+				powers[input_id].use_hazard = toBool(infile.val);
+				break;
+
+			case POWER_KEY_NO_ATTACK:
+				// @ATTR power.no_attack|bool|Hazard won't affect other entities.
+				powers[input_id].no_attack = toBool(infile.val);
+				break;
+
+			case POWER_KEY_RADIUS:
+				// @ATTR power.radius|float|Radius in pixels
+				powers[input_id].radius = toFloat(infile.val);
+				break;
+
+			case POWER_KEY_BASE_DAMAGE: {
+				// @ATTR power.base_damage|["melee", "ranged", "ment"]|Determines which of the three primary damage stats will be used to calculate damage.
+				if (infile.val == "none")        powers[input_id].base_damage = BASE_DAMAGE_NONE;
+				else if (infile.val == "melee")  powers[input_id].base_damage = BASE_DAMAGE_MELEE;
+				else if (infile.val == "ranged") powers[input_id].base_damage = BASE_DAMAGE_RANGED;
+				else if (infile.val == "ment")   powers[input_id].base_damage = BASE_DAMAGE_MENT;
+				else infile.error("PowerManager: Unknown base_damage '%s'", infile.val.c_str());
+				break;
 			}
-		}
-		else if (infile.key == "wall_reflect")
-			// @ATTR power.wall_reflect|bool|Moving power will bounce off walls and keep going
-			powers[input_id].wall_reflect = toBool(infile.val);
-
-		// spawn info
-		else if (infile.key == "spawn_type")
-			// @ATTR power.spawn_type|predefined_string|For non-transform powers, an enemy is spawned from this category. For transform powers, the caster will transform into a creature from this category.
-			powers[input_id].spawn_type = infile.val;
-		else if (infile.key == "target_neighbor")
-			// @ATTR power.target_neighbor|int|Target is changed to an adjacent tile within a radius.
-			powers[input_id].target_neighbor = toInt(infile.val);
-		else if (infile.key == "spawn_limit") {
-			// @ATTR power.spawn_limit|["fixed", "stat", "unlimited"], [int, predefined_string] : Mode, Value|The maximum number of creatures that can be spawned and alive from this power. "fixed" takes an integer. "stat" takes a primary stat as a string (e.g. "physical").
-			std::string mode = popFirstString(infile.val);
-			if (mode == "fixed") powers[input_id].spawn_limit_mode = SPAWN_LIMIT_MODE_FIXED;
-			else if (mode == "stat") powers[input_id].spawn_limit_mode = SPAWN_LIMIT_MODE_STAT;
-			else if (mode == "unlimited") powers[input_id].spawn_limit_mode = SPAWN_LIMIT_MODE_UNLIMITED;
-			else infile.error("PowerManager: Unknown spawn_limit_mode '%s'", mode.c_str());
-
-			if(powers[input_id].spawn_limit_mode != SPAWN_LIMIT_MODE_UNLIMITED) {
-				powers[input_id].spawn_limit_qty = popFirstInt(infile.val);
-
-				if(powers[input_id].spawn_limit_mode == SPAWN_LIMIT_MODE_STAT) {
-					powers[input_id].spawn_limit_every = popFirstInt(infile.val);
-
-					std::string stat = popFirstString(infile.val);
-					size_t prim_stat_index = getPrimaryStatIndex(stat);
-
-					if (prim_stat_index != PRIMARY_STATS.size()) {
-						powers[input_id].spawn_limit_stat = prim_stat_index;
+
+			case POWER_KEY_STARTING_POS: {
+				// @ATTR power.starting_pos|["source", "target", "melee"]|Start position for hazard
+				if (infile.val == "source")      powers[input_id].starting_pos = STARTING_POS_SOURCE;
+				else if (infile.val == "target") powers[input_id].starting_pos = STARTING_POS_TARGET;
+				else if (infile.val == "melee")  powers[input_id].starting_pos = STARTING_POS_MELEE;
+				else infile.error("PowerManager: Unknown starting_pos '%s'", infile.val.c_str());
+				break;
+			}
+
+			case POWER_KEY_RELATIVE_POS: {
+				// @ATTR power.relative_pos|bool|Hazard will move relative to the caster's position.
+				powers[input_id].relative_pos = toBool(infile.val);
+				break;
+			}
+
+			case POWER_KEY_MULTITARGET:
+				// @ATTR power.multitarget|bool|Allows a hazard power to hit more than one entity.
+				powers[input_id].multitarget = toBool(infile.val);
+				break;
+
+			case POWER_KEY_MULTIHIT:
+				// @ATTR power.multihit|bool|Allows a hazard power to hit the same entity more than once.
+				powers[input_id].multihit = toBool(infile.val);
+				break;
+
+			case POWER_KEY_EXPIRE_WITH_CASTER:
+				// @ATTR power.expire_with_caster|bool|If true, hazard will disappear when the caster dies.
+				powers[input_id].expire_with_caster = toBool(infile.val);
+				break;
+
+			case POWER_KEY_IGNORE_ZERO_DAMAGE:
+				// @ATTR power.ignore_zero_damage|bool|If true, hazard can still hit the player when damage is 0, triggering post_power and post_effects.
+				powers[input_id].ignore_zero_damage = toBool(infile.val);
+				break;
+
+			case POWER_KEY_LOCK_TARGET_TO_DIRECTION:
+				// @ATTR power.lock_target_to_direction|bool|If true, the target is "snapped" to one of the 8 directions.
+				powers[input_id].lock_target_to_direction = toBool(infile.val);
+				break;
+
+			case POWER_KEY_MOVEMENT_TYPE: {
+				// @ATTR power.movement_type|["ground", "flying", "intangible"]|For moving hazards (missile/repeater), this defines which parts of the map it can collide with. The default is "flying".
+				if (infile.val == "ground")         powers[input_id].movement_type = MOVEMENT_NORMAL;
+				else if (infile.val == "flying")    powers[input_id].movement_type = MOVEMENT_FLYING;
+				else if (infile.val == "intangible") powers[input_id].movement_type = MOVEMENT_INTANGIBLE;
+				else infile.error("PowerManager: Unknown movement_type '%s'", infile.val.c_str());
+				break;
+			}
+
+			case POWER_KEY_TRAIT_ARMOR_PENETRATION:
+				// @ATTR power.trait_armor_penetration|bool|Ignores the target's Absorbtion stat
+				powers[input_id].trait_armor_penetration = toBool(infile.val);
+				break;
+
+			case POWER_KEY_TRAIT_AVOIDANCE_IGNORE:
+				// @ATTR power.trait_avoidance_ignore|bool|Ignores the target's Avoidance stat
+				powers[input_id].trait_avoidance_ignore = toBool(infile.val);
+				break;
+
+			case POWER_KEY_TRAIT_CRITS_IMPAIRED:
+				// @ATTR power.trait_crits_impaired|int|Increases critical hit percentage for slowed/immobile targets
+				powers[input_id].trait_crits_impaired = toInt(infile.val);
+				break;
+
+			case POWER_KEY_TRAIT_ELEMENTAL: {
+				// @ATTR power.trait_elemental|predefined_string|Damage done is elemental. See engine/elements.txt
+				for (unsigned int i=0; i<ELEMENTS.size(); i++) {
+					if (infile.val == ELEMENTS[i].id) powers[input_id].trait_elemental = i;
+				}
+				break;
+			}
+
+			case POWER_KEY_TARGET_RANGE:
+				// @ATTR power.target_range|float|The distance from the caster that the power can be activated
+				powers[input_id].target_range = toFloat(popFirstString(infile.val));
+				break;
+
+			//steal effects
+			case POWER_KEY_HP_STEAL:
+				// @ATTR power.hp_steal|int|Percentage of damage to steal into HP
+				powers[input_id].hp_steal = toInt(infile.val);
+				break;
+
+			case POWER_KEY_MP_STEAL:
+				// @ATTR power.mp_steal|int|Percentage of damage to steal into MP
+				powers[input_id].mp_steal = toInt(infile.val);
+				break;
+
+			//missile modifiers
+			case POWER_KEY_MISSILE_ANGLE:
+				// @ATTR power.missile_angle|int|Angle of missile
+				powers[input_id].missile_angle = toInt(infile.val);
+				break;
+
+			case POWER_KEY_ANGLE_VARIANCE:
+				// @ATTR power.angle_variance|int|Percentage of variance added to missile angle
+				powers[input_id].angle_variance = toInt(infile.val);
+				break;
+
+			case POWER_KEY_SPEED_VARIANCE:
+				// @ATTR power.speed_variance|float|Percentage of variance added to missile speed
+				powers[input_id].speed_variance = toFloat(infile.val);
+				break;
+
+			//repeater modifiers
+			case POWER_KEY_DELAY:
+				// @ATTR power.delay|duration|Delay between repeats in 'ms' or 's'.
+				powers[input_id].delay = parse_duration(infile.val);
+				break;
+
+			// buff/debuff durations
+			case POWER_KEY_TRANSFORM_DURATION:
+				// @ATTR power.transform_duration|duration|Duration for transform in 'ms' or 's'.
+				powers[input_id].transform_duration = parse_duration(infile.val);
+				break;
+
+			case POWER_KEY_MANUAL_UNTRANSFORM:
+				// @ATTR power.manual_untransform|bool|Force manual untranform
+				powers[input_id].manual_untransform = toBool(infile.val);
+				break;
+
+			case POWER_KEY_KEEP_EQUIPMENT:
+				// @ATTR power.keep_equipment|bool|Keep equipment while transformed
+				powers[input_id].keep_equipment = toBool(infile.val);
+				break;
+
+			case POWER_KEY_UNTRANSFORM_ON_HIT:
+				// @ATTR power.untransform_on_hit|bool|Force untransform when the player is hit
+				powers[input_id].untransform_on_hit = toBool(infile.val);
+				break;
+
+			// buffs
+			case POWER_KEY_BUFF:
+				// @ATTR power.buff|bool|Power is cast upon the caster.
+				powers[input_id].buff= toBool(infile.val);
+				break;
+
+			case POWER_KEY_BUFF_TELEPORT:
+				// @ATTR power.buff_teleport|bool|Power is a teleportation power.
+				powers[input_id].buff_teleport = toBool(infile.val);
+				break;
+
+			case POWER_KEY_BUFF_PARTY:
+				// @ATTR power.buff_party|bool|Power is cast upon party members
+				powers[input_id].buff_party = toBool(infile.val);
+				break;
+
+			case POWER_KEY_BUFF_PARTY_POWER_ID:
+				// @ATTR power.buff_party_power_id|power_id|Only party members that were spawned with this power ID are affected by "buff_party=true". Setting this to 0 will affect all party members.
+				powers[input_id].buff_party_power_id = toInt(infile.val);
+				break;
+
+			case POWER_KEY_POST_EFFECT: {
+				// @ATTR power.post_effect|predefined_string, int, duration , int: Effect ID, Magnitude, Duration, Chance to apply|Post effect. Duration is in 'ms' or 's'.
+				if (clear_post_effects) {
+					powers[input_id].post_effects.clear();
+					clear_post_effects = false;
+				}
+				PostEffect pe;
+				pe.id = popFirstString(infile.val);
+				if (!isValidEffect(pe.id)) {
+					infile.error("PowerManager: Unknown effect '%s'", pe.id.c_str());
+				}
+				else {
+					pe.effect_index = getEffectIndex(pe.id);
+					if (pe.effect_index == -1) {
+						// built-in effects use their id as their type
+						pe.builtin_def.id = pe.builtin_def.type = pe.id;
+						EffectManager::resolveEffectDef(pe.builtin_def);
 					}
-					else {
-						infile.error("PowerManager: '%s' is not a valid primary stat.", stat.c_str());
+
+					pe.magnitude = popFirstInt(infile.val);
+					pe.duration = parse_duration(popFirstString(infile.val));
+					std::string chance = popFirstString(infile.val);
+					if (!chance.empty()) {
+						pe.chance = toInt(chance);
 					}
+					powers[input_id].post_effects.push_back(pe);
 				}
+				break;
 			}
-		}
-		else if (infile.key == "spawn_level") {
-			// @ATTR power.spawn_level|["default", "fixed", "stat", "level"], [int, predefined_string] : Mode, Value|The level of spawned creatures. "fixed" and "level" take an integer. "stat" takes a primary stat as a string (e.g. "physical").
-			std::string mode = popFirstString(infile.val);
-			if (mode == "default") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_DEFAULT;
-			else if (mode == "fixed") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_FIXED;
-			else if (mode == "stat") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_STAT;
-			else if (mode == "level") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_LEVEL;
-			else infile.error("PowerManager: Unknown spawn_level_mode '%s'", mode.c_str());
-
-			if(powers[input_id].spawn_level_mode != SPAWN_LEVEL_MODE_DEFAULT) {
-				powers[input_id].spawn_level_qty = popFirstInt(infile.val);
-
-				if(powers[input_id].spawn_level_mode != SPAWN_LEVEL_MODE_FIXED) {
-					powers[input_id].spawn_level_every = popFirstInt(infile.val);
-
-					if(powers[input_id].spawn_level_mode == SPAWN_LEVEL_MODE_STAT) {
+
+			// pre and post power effects
+			case POWER_KEY_PRE_POWER: {
+				// @ATTR power.pre_power|power_id, int : Power, Chance to cast|Trigger a power immediately when casting this one.
+				powers[input_id].pre_power = popFirstInt(infile.val);
+				std::string chance = popFirstString(infile.val);
+				if (!chance.empty()) {
+					powers[input_id].pre_power_chance = toInt(chance);
+				}
+				break;
+			}
+
+			case POWER_KEY_POST_POWER: {
+				// @ATTR power.post_power|power_id, int : Power, Chance to cast|Trigger a power if the hazard did damage.
+				powers[input_id].post_power = popFirstInt(infile.val);
+				std::string chance = popFirstString(infile.val);
+				if (!chance.empty()) {
+					powers[input_id].post_power_chance = toInt(chance);
+				}
+				break;
+			}
+
+			case POWER_KEY_WALL_POWER: {
+				// @ATTR power.wall_power|power_id, int : Power, Chance to cast|Trigger a power if the hazard hit a wall.
+				powers[input_id].wall_power = popFirstInt(infile.val);
+				std::string chance = popFirstString(infile.val);
+				if (!chance.empty()) {
+					powers[input_id].wall_power_chance = toInt(chance);
+				}
+				break;
+			}
+
+			case POWER_KEY_WALL_REFLECT:
+				// @ATTR power.wall_reflect|bool|Moving power will bounce off walls and keep going
+				powers[input_id].wall_reflect = toBool(infile.val);
+				break;
+
+			// spawn info
+			case POWER_KEY_SPAWN_TYPE:
+				// @ATTR power.spawn_type|predefined_string|For non-transform powers, an enemy is spawned from this category. For transform powers, the caster will transform into a creature from this category.
+				powers[input_id].spawn_type = infile.val;
+				break;
+
+			case POWER_KEY_TARGET_NEIGHBOR:
+				// @ATTR power.target_neighbor|int|Target is changed to an adjacent tile within a radius.
+				powers[input_id].target_neighbor = toInt(infile.val);
+				break;
+
+			case POWER_KEY_SPAWN_LIMIT: {
+				// @ATTR power.spawn_limit|["fixed", "stat", "unlimited"], [int, predefined_string] : Mode, Value|The maximum number of creatures that can be spawned and alive from this power. "fixed" takes an integer. "stat" takes a primary stat as a string (e.g. "physical").
+				std::string mode = popFirstString(infile.val);
+				if (mode == "fixed") powers[input_id].spawn_limit_mode = SPAWN_LIMIT_MODE_FIXED;
+				else if (mode == "stat") powers[input_id].spawn_limit_mode = SPAWN_LIMIT_MODE_STAT;
+				else if (mode == "unlimited") powers[input_id].spawn_limit_mode = SPAWN_LIMIT_MODE_UNLIMITED;
+				else infile.error("PowerManager: Unknown spawn_limit_mode '%s'", mode.c_str());
+
+				if(powers[input_id].spawn_limit_mode != SPAWN_LIMIT_MODE_UNLIMITED) {
+					powers[input_id].spawn_limit_qty = popFirstInt(infile.val);
+
+					if(powers[input_id].spawn_limit_mode == SPAWN_LIMIT_MODE_STAT) {
+						powers[input_id].spawn_limit_every = popFirstInt(infile.val);
+
 						std::string stat = popFirstString(infile.val);
 						size_t prim_stat_index = getPrimaryStatIndex(stat);
 
 						if (prim_stat_index != PRIMARY_STATS.size()) {
-							powers[input_id].spawn_level_stat = prim_stat_index;
+							powers[input_id].spawn_limit_stat = prim_stat_index;
 						}
 						else {
 							infile.error("PowerManager: '%s' is not a valid primary stat.", stat.c_str());
 						}
 					}
 				}
+				break;
 			}
-		}
-		else if (infile.key == "target_party")
-			// @ATTR power.target_party|bool|Hazard will only affect party members.
-			powers[input_id].target_party = toBool(infile.val);
-		else if (infile.key == "target_categories") {
-			// @ATTR power.target_categories|list(predefined_string)|Hazard will only affect enemies in these categories.
-			powers[input_id].target_categories.clear();
-			std::string cat;
-			while ((cat = popFirstString(infile.val)) != "") {
-				powers[input_id].target_categories.push_back(cat);
+
+			case POWER_KEY_SPAWN_LEVEL: {
+				// @ATTR power.spawn_level|["default", "fixed", "stat", "level"], [int, predefined_string] : Mode, Value|The level of spawned creatures. "fixed" and "level" take an integer. "stat" takes a primary stat as a string (e.g. "physical").
+				std::string mode = popFirstString(infile.val);
+				if (mode == "default") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_DEFAULT;
+				else if (mode == "fixed") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_FIXED;
+				else if (mode == "stat") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_STAT;
+				else if (mode == "level") powers[input_id].spawn_level_mode = SPAWN_LEVEL_MODE_LEVEL;
+				else infile.error("PowerManager: Unknown spawn_level_mode '%s'", mode.c_str());
+
+				if(powers[input_id].spawn_level_mode != SPAWN_LEVEL_MODE_DEFAULT) {
+					powers[input_id].spawn_level_qty = popFirstInt(infile.val);
+
+					if(powers[input_id].spawn_level_mode != SPAWN_LEVEL_MODE_FIXED) {
+						powers[input_id].spawn_level_every = popFirstInt(infile.val);
+
+						if(powers[input_id].spawn_level_mode == SPAWN_LEVEL_MODE_STAT) {
+							std::string stat = popFirstString(infile.val);
+							size_t prim_stat_index = getPrimaryStatIndex(stat);
+
+							if (prim_stat_index != PRIMARY_STATS.size()) {
+								powers[input_id].spawn_level_stat = prim_stat_index;
+							}
+							else {
+								infile.error("PowerManager: '%s' is not a valid primary stat.", stat.c_str());
+							}
+						}
+					}
+				}
+				break;
 			}
-		}
-		else if (infile.key == "modifier_accuracy") {
-			// @ATTR power.modifier_accuracy|["multiply", "add", "absolute"], int : Mode, Value|Changes this power's accuracy.
-			std::string mode = popFirstString(infile.val);
-			if(mode == "multiply") powers[input_id].mod_accuracy_mode = STAT_MODIFIER_MODE_MULTIPLY;
-			else if(mode == "add") powers[input_id].mod_accuracy_mode = STAT_MODIFIER_MODE_ADD;
-			else if(mode == "absolute") powers[input_id].mod_accuracy_mode = STAT_MODIFIER_MODE_ABSOLUTE;
-			else infile.error("PowerManager: Unknown stat_modifier_mode '%s'", mode.c_str());
-
-			powers[input_id].mod_accuracy_value = popFirstInt(infile.val);
-		}
-		else if (infile.key == "modifier_damage") {
-			// @ATTR power.modifier_damage|["multiply", "add", "absolute"], int, int : Mode, Min, Max|Changes this power's damage. The "Max" value is ignored, except in the case of "absolute" modifiers.
-			std::string mode = popFirstString(infile.val);
-			if(mode == "multiply") powers[input_id].mod_damage_mode = STAT_MODIFIER_MODE_MULTIPLY;
-			else if(mode == "add") powers[input_id].mod_damage_mode = STAT_MODIFIER_MODE_ADD;
-			else if(mode == "absolute") powers[input_id].mod_damage_mode = STAT_MODIFIER_MODE_ABSOLUTE;
-			else infile.error("PowerManager: Unknown stat_modifier_mode '%s'", mode.c_str());
-
-			powers[input_id].mod_damage_value_min = popFirstInt(infile.val);
-			powers[input_id].mod_damage_value_max = popFirstInt(infile.val);
-		}
-		else if (infile.key == "modifier_critical") {
-			// @ATTR power.modifier_critical|["multiply", "add", "absolute"], int : Mode, Value|Changes the chance that this power will land a critical hit.
-			std::string mode = popFirstString(infile.val);
-			if(mode == "multiply") powers[input_id].mod_crit_mode = STAT_MODIFIER_MODE_MULTIPLY;
-			else if(mode == "add") powers[input_id].mod_crit_mode = STAT_MODIFIER_MODE_ADD;
-			else if(mode == "absolute") powers[input_id].mod_crit_mode = STAT_MODIFIER_MODE_ABSOLUTE;
-			else infile.error("PowerManager: Unknown stat_modifier_mode '%s'", mode.c_str());
-
-			powers[input_id].mod_crit_value = popFirstInt(infile.val);
-		}
-		else if (infile.key == "target_movement_normal") {
-			// @ATTR power.target_movement_normal|bool|Power can affect entities with normal movement (aka walking on ground)
-			powers[input_id].target_movement_normal = toBool(infile.val);
-		}
-		else if (infile.key == "target_movement_flying") {
-			// @ATTR power.target_movement_flying|bool|Power can affect flying entities
-			powers[input_id].target_movement_flying = toBool(infile.val);
-		}
-		else if (infile.key == "target_movement_intangible") {
-			// @ATTR power.target_movement_intangible|bool|Power can affect intangible entities
-			powers[input_id].target_movement_intangible = toBool(infile.val);
-		}
-		else if (infile.key == "walls_block_aoe") {
-			// @ATTR power.walls_block_aoe|bool|When true, prevents hazard aoe from hitting targets that are behind walls/pits.
-			powers[input_id].walls_block_aoe = toBool(infile.val);
-		}
-		else if (infile.key == "script") {
-			// @ATTR power.script|["on_cast", "on_hit", "on_wall"], filename : Trigger, Filename|Loads and executes a script file when the trigger is activated.
-			std::string trigger = popFirstString(infile.val);
-			if (trigger == "on_cast") powers[input_id].script_trigger = SCRIPT_TRIGGER_CAST;
-			else if (trigger == "on_hit") powers[input_id].script_trigger = SCRIPT_TRIGGER_HIT;
-			else if (trigger == "on_wall") powers[input_id].script_trigger = SCRIPT_TRIGGER_WALL;
-			else infile.error("PowerManager: Unknown script trigger '%s'", trigger.c_str());
-
-			powers[input_id].script = popFirstString(infile.val);
-		}
-		else if (infile.key == "remove_effect") {
-			// @ATTR power.remove_effect|repeatable(predefined_string, int) : Effect ID, Number of Effect instances|Removes a number of instances of a specific Effect ID. Omitting the number of instances, or setting it to zero, will remove all instances/stacks.
-			std::string first = popFirstString(infile.val);
-			int second = popFirstInt(infile.val);
-			powers[input_id].remove_effects.push_back(std::pair<std::string, int>(first, second));
-		}
-		else if (infile.key == "replace_by_effect") {
-			// @ATTR power.replace_by_effect|int, predefined_string, int : Power ID, Effect ID, Number of Effect instances|If the caster has at least the number of instances of the Effect ID, the defined Power ID will be cast instead.
-			powers[input_id].replace_by_effect_power = popFirstInt(infile.val);
-			powers[input_id].replace_by_effect_id = popFirstString(infile.val);
-			powers[input_id].replace_by_effect_count = popFirstInt(infile.val);
-		}
-		else if (infile.key == "requires_corpse") {
-			// @ATTR power.requires_corpse|["consume", bool]|If true, a corpse must be targeted for this power to be used. If "consume", then the corpse is also consumed on Power use.
-			if (infile.val == "consume") {
-				powers[input_id].requires_corpse = true;
-				powers[input_id].remove_corpse = true;
+
+			case POWER_KEY_TARGET_PARTY:
+				// @ATTR power.target_party|bool|Hazard will only affect party members.
+				powers[input_id].target_party = toBool(infile.val);
+				break;
+
+			case POWER_KEY_TARGET_CATEGORIES: {
+				// @ATTR power.target_categories|list(predefined_string)|Hazard will only affect enemies in these categories.
+				powers[input_id].target_categories.clear();
+				std::string cat;
+				while ((cat = popFirstString(infile.val)) != "") {
+					powers[input_id].target_categories.push_back(cat);
+				}
+				break;
 			}
-			else {
-				powers[input_id].requires_corpse = toBool(infile.val);
-				powers[input_id].remove_corpse = false;
+
+			case POWER_KEY_MODIFIER_ACCURACY: {
+				// @ATTR power.modifier_accuracy|["multiply", "add", "absolute"], int : Mode, Value|Changes this power's accuracy.
+				std::string mode = popFirstString(infile.val);
+				if(mode == "multiply") powers[input_id].mod_accuracy_mode = STAT_MODIFIER_MODE_MULTIPLY;
+				else if(mode == "add") powers[input_id].mod_accuracy_mode = STAT_MODIFIER_MODE_ADD;
+				else if(mode == "absolute") powers[input_id].mod_accuracy_mode = STAT_MODIFIER_MODE_ABSOLUTE;
+				else infile.error("PowerManager: Unknown stat_modifier_mode '%s'", mode.c_str());
+
+				powers[input_id].mod_accuracy_value = popFirstInt(infile.val);
+				break;
+			}
+
+			case POWER_KEY_MODIFIER_DAMAGE: {
+				// @ATTR power.modifier_damage|["multiply", "add", "absolute"], int, int : Mode, Min, Max|Changes this power's damage. The "Max" value is ignored, except in the case of "absolute" modifiers.
+				std::string mode = popFirstString(infile.val);
+				if(mode == "multiply") powers[input_id].mod_damage_mode = STAT_MODIFIER_MODE_MULTIPLY;
+				else if(mode == "add") powers[input_id].mod_damage_mode = STAT_MODIFIER_MODE_ADD;
+				else if(mode == "absolute") powers[input_id].mod_damage_mode = STAT_MODIFIER_MODE_ABSOLUTE;
+				else infile.error("PowerManager: Unknown stat_modifier_mode '%s'", mode.c_str());
+
+				powers[input_id].mod_damage_value_min = popFirstInt(infile.val);
+				powers[input_id].mod_damage_value_max = popFirstInt(infile.val);
+				break;
+			}
+
+			case POWER_KEY_MODIFIER_CRITICAL: {
+				// @ATTR power.modifier_critical|["multiply", "add", "absolute"], int : Mode, Value|Changes the chance that this power will land a critical hit.
+				std::string mode = popFirstString(infile.val);
+				if(mode == "multiply") powers[input_id].mod_crit_mode = STAT_MODIFIER_MODE_MULTIPLY;
+				else if(mode == "add") powers[input_id].mod_crit_mode = STAT_MODIFIER_MODE_ADD;
+				else if(mode == "absolute") powers[input_id].mod_crit_mode = STAT_MODIFIER_MODE_ABSOLUTE;
+				else infile.error("PowerManager: Unknown stat_modifier_mode '%s'", mode.c_str());
+
+				powers[input_id].mod_crit_value = popFirstInt(infile.val);
+				break;
+			}
+
+			case POWER_KEY_TARGET_MOVEMENT_NORMAL: {
+				// @ATTR power.target_movement_normal|bool|Power can affect entities with normal movement (aka walking on ground)
+				powers[input_id].target_movement_normal = toBool(infile.val);
+				break;
+			}
+
+			case POWER_KEY_TARGET_MOVEMENT_FLYING: {
+				// @ATTR power.target_movement_flying|bool|Power can affect flying entities
+				powers[input_id].target_movement_flying = toBool(infile.val);
+				break;
 			}
-		}
-		else if (infile.key == "target_nearest") {
-			// @ATTR power.target_nearest|float|Will automatically target the nearest enemy within the specified range.
-			powers[input_id].target_nearest = toFloat(infile.val);
-		}
 
-		else infile.error("PowerManager: '%s' is not a valid key", infile.key.c_str());
+			case POWER_KEY_TARGET_MOVEMENT_INTANGIBLE: {
+				// @ATTR power.target_movement_intangible|bool|Power can affect intangible entities
+				powers[input_id].target_movement_intangible = toBool(infile.val);
+				break;
+			}
+
+			case POWER_KEY_WALLS_BLOCK_AOE: {
+				// @ATTR power.walls_block_aoe|bool|When true, prevents hazard aoe from hitting targets that are behind walls/pits.
+				powers[input_id].walls_block_aoe = toBool(infile.val);
+				break;
+			}
+
+			case POWER_KEY_SCRIPT: {
+				// @ATTR power.script|["on_cast", "on_hit", "on_wall"], filename : Trigger, Filename|Loads and executes a script file when the trigger is activated.
+				std::string trigger = popFirstString(infile.val);
+				if (trigger == "on_cast") powers[input_id].script_trigger = SCRIPT_TRIGGER_CAST;
+				else if (trigger == "on_hit") powers[input_id].script_trigger = SCRIPT_TRIGGER_HIT;
+				else if (trigger == "on_wall") powers[input_id].script_trigger = SCRIPT_TRIGGER_WALL;
+				else infile.error("PowerManager: Unknown script trigger '%s'", trigger.c_str());
+
+				powers[input_id].script = popFirstString(infile.val);
+				break;
+			}
+
+			case POWER_KEY_REMOVE_EFFECT: {
+				// @ATTR power.remove_effect|repeatable(predefined_string, int) : Effect ID, Number of Effect instances|Removes a number of instances of a specific Effect ID. Omitting the number of instances, or setting it to zero, will remove all instances/stacks.
+				std::string first = popFirstString(infile.val);
+				int second = popFirstInt(infile.val);
+				powers[input_id].remove_effects.push_back(std::pair<StringHandle, int>(internString(first), second));
+				break;
+			}
+
+			case POWER_KEY_REPLACE_BY_EFFECT: {
+				// @ATTR power.replace_by_effect|int, predefined_string, int : Power ID, Effect ID, Number of Effect instances|If the caster has at least the number of instances of the Effect ID, the defined Power ID will be cast instead.
+				powers[input_id].replace_by_effect_power = popFirstInt(infile.val);
+				powers[input_id].replace_by_effect_id = internString(popFirstString(infile.val));
+				powers[input_id].replace_by_effect_count = popFirstInt(infile.val);
+				break;
+			}
+
+			case POWER_KEY_REQUIRES_CORPSE: {
+				// @ATTR power.requires_corpse|["consume", bool]|If true, a corpse must be targeted for this power to be used. If "consume", then the corpse is also consumed on Power use.
+				if (infile.val == "consume") {
+					powers[input_id].requires_corpse = true;
+					powers[input_id].remove_corpse = true;
+				}
+				else {
+					powers[input_id].requires_corpse = toBool(infile.val);
+					powers[input_id].remove_corpse = false;
+				}
+				break;
+			}
+
+			case POWER_KEY_TARGET_NEAREST: {
+				// @ATTR power.target_nearest|float|Will automatically target the nearest enemy within the specified range.
+				powers[input_id].target_nearest = toFloat(infile.val);
+				break;
+			}
+
+			default:
+				infile.error("PowerManager: '%s' is not a valid key", infile.key.c_str());
+				break;
+		}
 	}
 	infile.close();
 
@@ -702,6 +1095,66 @@ bool PowerManager::isValidEffect(const std::string& type) {
 	return false;
 }
 
+/**
+ * Parsing doesn't touch the animation and sound managers, so that the powers
+ * can be loaded on a worker thread. Everything they need is loaded here instead.
+ */
+void PowerManager::loadResources() {
+	for (size_t i = 0; i < effects.size(); ++i) {
+		if (effects[i].animation.empty())
+			continue;
+
+		// hazards and effects share these sets, so that spawning one doesn't look up or load anything
+		anim->increaseCount(effects[i].animation);
+		effects[i].animation_set = anim->getAnimationSet(effects[i].animation);
+		delete effects[i].animation_set->getAnimation(0);
+	}
+
+	loadPowerResources();
+}
+
+void PowerManager::loadPowerResources() {
+	for (size_t i = 0; i < powers.size(); ++i) {
+		if (powers[i].animation_name.empty())
+			continue;
+
+		anim->increaseCount(powers[i].animation_name);
+		powers[i].animation_set = anim->getAnimationSet(powers[i].animation_name);
+		delete powers[i].animation_set->getAnimation(0);
+	}
+
+	for (size_t i = 0; i < pending_sfx.size(); ++i) {
+		powers[pending_sfx[i].first].sfx_index = loadSFX(pending_sfx[i].second);
+	}
+
+	for (size_t i = 0; i < pending_sfx_hit.size(); ++i) {
+		int sfx_id = loadSFX(pending_sfx_hit[i].second);
+		if (sfx_id != -1) {
+			powers[pending_sfx_hit[i].first].sfx_hit = sfx[sfx_id];
+			powers[pending_sfx_hit[i].first].sfx_hit_enable = true;
+		}
+	}
+
+	pending_sfx.clear();
+	pending_sfx_hit.clear();
+}
+
+/**
+ * Hazards only point to their power while they are created, so the table can be replaced between frames
+ */
+void PowerManager::reloadPowers() {
+	for (size_t i = 0; i < powers.size(); ++i) {
+		if (!powers[i].animation_name.empty())
+			anim->decreaseCount(powers[i].animation_name);
+	}
+
+	powers.clear();
+	power_text.clear();
+
+	loadPowers();
+	loadPowerResources();
+}
+
 /**
  * Load the specified sound effect for this power
  *
@@ -800,7 +1253,10 @@ void PowerManager::initHazard(int power_index, StatBlock *src_stats, const FPoin
 	}
 
 	// animation properties
-	if (powers[power_index].animation_name != "") {
+	if (powers[power_index].animation_set) {
+		haz->setAnimation(powers[power_index].animation_set);
+	}
+	else if (powers[power_index].animation_name != "") {
 		haz->loadAnimation(powers[power_index].animation_name);
 	}
 
@@ -809,7 +1265,7 @@ void PowerManager::initHazard(int power_index, StatBlock *src_stats, const FPoin
 		haz->animationKind = calcDirection(src_stats->pos.x, src_stats->pos.y, target.x, target.y);
 	}
 	else if (powers[power_index].visual_random) {
-		haz->animationKind = rand() % powers[power_index].visual_random;
+		haz->animationKind = randInt(powers[power_index].visual_random, RANDOM_VISUAL);
 		haz->animationKind += powers[power_index].visual_option;
 	}
 	else if (powers[power_index].visual_option) {
@@ -931,7 +1387,7 @@ void PowerManager::buff(int power_index, StatBlock *src_stats, const FPoint& tar
 	// this is also where Effects are removed for non-hazard powers
 	if (!powers[power_index].use_hazard) {
 		src_stats->effects.removeEffectID(powers[power_index].remove_effects);
-		if (percentChance(powers[power_index].post_power_chance)) {
+		if (percentChance(powers[power_index].post_power_chance, RANDOM_COMBAT)) {
 			activate(powers[power_index].post_power, src_stats, src_stats->pos);
 		}
 	}
@@ -948,48 +1404,47 @@ void PowerManager::playSound(int power_index) {
 
 bool PowerManager::effect(StatBlock *src_stats, StatBlock *caster_stats, int power_index, int source_type) {
 	for (unsigned i=0; i<powers[power_index].post_effects.size(); i++) {
-		if (!percentChance(powers[power_index].post_effects[i].chance))
+		if (!percentChance(powers[power_index].post_effects[i].chance, RANDOM_COMBAT))
 			continue;
 
-		EffectDef effect_data;
-		EffectDef* effect_ptr = getEffectDef(powers[power_index].post_effects[i].id);
+		PostEffect& pe = powers[power_index].post_effects[i];
+		EffectDef& effect_data = (pe.effect_index != -1) ? effects[pe.effect_index] : pe.builtin_def;
 
-		int magnitude = powers[power_index].post_effects[i].magnitude;
-		int duration = powers[power_index].post_effects[i].duration;
+		int magnitude = pe.magnitude;
+		int duration = pe.duration;
 
-		if (effect_ptr != NULL) {
+		if (pe.effect_index != -1) {
 			// effects loaded from powers/effects.txt
-			effect_data = (*effect_ptr);
 
-			if (effect_data.type == "shield") {
+			if (effect_data.effect_type == EFFECT_SHIELD) {
 				// charge shield to max ment weapon damage * damage multiplier
 				if(powers[power_index].mod_damage_mode == STAT_MODIFIER_MODE_MULTIPLY)
 					magnitude = caster_stats->get(STAT_DMG_MENT_MAX) * powers[power_index].mod_damage_value_min / 100;
 				else if(powers[power_index].mod_damage_mode == STAT_MODIFIER_MODE_ADD)
 					magnitude = caster_stats->get(STAT_DMG_MENT_MAX) + powers[power_index].mod_damage_value_min;
 				else if(powers[power_index].mod_damage_mode == STAT_MODIFIER_MODE_ABSOLUTE)
-					magnitude = randBetween(powers[power_index].mod_damage_value_min, powers[power_index].mod_damage_value_max);
+					magnitude = randBetween(powers[power_index].mod_damage_value_min, powers[power_index].mod_damage_value_max, RANDOM_COMBAT);
 				else
 					magnitude = caster_stats->get(STAT_DMG_MENT_MAX);
 
 				comb->addString(msg->get("+%d Shield",magnitude), src_stats->pos, COMBAT_MESSAGE_BUFF);
 			}
-			else if (effect_data.type == "heal") {
+			else if (effect_data.effect_type == EFFECT_HEAL) {
 				// heal for ment weapon damage * damage multiplier
-				magnitude = randBetween(caster_stats->get(STAT_DMG_MENT_MIN), caster_stats->get(STAT_DMG_MENT_MAX));
+				magnitude = randBetween(caster_stats->get(STAT_DMG_MENT_MIN), caster_stats->get(STAT_DMG_MENT_MAX), RANDOM_COMBAT);
 
 				if(powers[power_index].mod_damage_mode == STAT_MODIFIER_MODE_MULTIPLY)
 					magnitude = magnitude * powers[power_index].mod_damage_value_min / 100;
 				else if(powers[power_index].mod_damage_mode == STAT_MODIFIER_MODE_ADD)
 					magnitude += powers[power_index].mod_damage_value_min;
 				else if(powers[power_index].mod_damage_mode == STAT_MODIFIER_MODE_ABSOLUTE)
-					magnitude = randBetween(powers[power_index].mod_damage_value_min, powers[power_index].mod_damage_value_max);
+					magnitude = randBetween(powers[power_index].mod_damage_value_min, powers[power_index].mod_damage_value_max, RANDOM_COMBAT);
 
 				comb->addString(msg->get("+%d HP",magnitude), src_stats->pos, COMBAT_MESSAGE_BUFF);
 				src_stats->hp += magnitude;
 				if (src_stats->hp > src_stats->get(STAT_HP_MAX)) src_stats->hp = src_stats->get(STAT_HP_MAX);
 			}
-			else if (effect_data.type == "knockback") {
+			else if (effect_data.effect_type == EFFECT_KNOCKBACK) {
 				if (src_stats->speed_default == 0) {
 					// enemies that can't move can't be knocked back
 					continue;
@@ -998,10 +1453,6 @@ bool PowerManager::effect(StatBlock *src_stats, StatBlock *caster_stats, int pow
 				src_stats->knockback_destpos = src_stats->pos;
 			}
 		}
-		else {
-			// all other effects
-			effect_data.id = effect_data.type = powers[power_index].post_effects[i].id;
-		}
 
 		int passive_id = 0;
 		if (powers[power_index].passive) passive_id = power_index;
@@ -1080,7 +1531,7 @@ bool PowerManager::missile(int power_index, StatBlock *src_stats, const FPoint&
 		float variance = 0;
 		if (powers[power_index].angle_variance != 0) {
 			//random between 0 and angle_variance away
-			variance = static_cast<float>(pow(-1.0f, (rand() % 2) - 1) * (rand() % powers[power_index].angle_variance) * M_PI / 180.0f);
+			variance = static_cast<float>(pow(-1.0f, randInt(2, RANDOM_COMBAT) - 1) * randInt(powers[power_index].angle_variance, RANDOM_COMBAT) * M_PI / 180.0f);
 		}
 		float alpha = theta + offset_angle + variance;
 
@@ -1088,7 +1539,7 @@ bool PowerManager::missile(int power_index, StatBlock *src_stats, const FPoint&
 		float speed_var = 0;
 		if (powers[power_index].speed_variance != 0) {
 			const float var = powers[power_index].speed_variance;
-			speed_var = ((var * 2.0f * static_cast<float>(rand())) / static_cast<float>(RAND_MAX)) - var;
+			speed_var = (var * 2.0f * randFloat(RANDOM_COMBAT)) - var;
 		}
 
 		// set speed and angle
@@ -1403,49 +1854,50 @@ void PowerManager::payPowerCost(int power_index, StatBlock *src_stats) {
  * Activate an entity's passive powers
  */
 void PowerManager::activatePassives(StatBlock *src_stats) {
-	bool triggered_others = false;
-	// unlocked powers
-	for (unsigned i=0; i<src_stats->powers_passive.size(); i++) {
-		activatePassiveByTrigger(src_stats->powers_passive[i], src_stats, triggered_others);
+	// the passives are sorted by trigger, so that only the ones whose trigger is set are looked at
+	src_stats->indexPassives();
+	EffectManager& fx = src_stats->effects;
+
+	// Only trigger normal passives once
+	if (!fx.triggered_others && !src_stats->getPassives(-1).empty()) {
+		activatePassiveList(-1, src_stats);
+		fx.triggered_others = true;
+	}
+
+	if (fx.triggered_block)
+		activatePassiveList(TRIGGER_BLOCK, src_stats);
+
+	if (fx.triggered_hit)
+		activatePassiveList(TRIGGER_HIT, src_stats);
+
+	if (!src_stats->getPassives(TRIGGER_HALFDEATH).empty() && (fx.triggered_halfdeath || src_stats->hp <= src_stats->get(STAT_HP_MAX)/2)) {
+		fx.triggered_halfdeath = true;
+		activatePassiveList(TRIGGER_HALFDEATH, src_stats);
 	}
 
-	// item powers
-	for (unsigned i=0; i<src_stats->powers_list_items.size(); i++) {
-		activatePassiveByTrigger(src_stats->powers_list_items[i], src_stats, triggered_others);
+	if (!src_stats->getPassives(TRIGGER_JOINCOMBAT).empty() && (fx.triggered_joincombat || src_stats->in_combat)) {
+		fx.triggered_joincombat = true;
+		activatePassiveList(TRIGGER_JOINCOMBAT, src_stats);
 	}
 
-	// Only trigger normal passives once
-	if (triggered_others) src_stats->effects.triggered_others = true;
+	if (fx.triggered_death)
+		activatePassiveList(TRIGGER_DEATH, src_stats);
 
 	// the hit/death triggers can be triggered more than once, so reset them here
 	// the block trigger is handled in the Avatar class
-	src_stats->effects.triggered_hit = false;
-	src_stats->effects.triggered_death = false;
+	fx.triggered_hit = false;
+	fx.triggered_death = false;
 }
 
-void PowerManager::activatePassiveByTrigger(int power_id, StatBlock *src_stats, bool& triggered_others) {
-	if (powers[power_id].passive) {
-		int trigger = powers[power_id].passive_trigger;
-
-		if (trigger == -1) {
-			if (src_stats->effects.triggered_others) return;
-			else triggered_others = true;
-		}
-		else if (trigger == TRIGGER_BLOCK && !src_stats->effects.triggered_block) return;
-		else if (trigger == TRIGGER_HIT && !src_stats->effects.triggered_hit) return;
-		else if (trigger == TRIGGER_HALFDEATH && !src_stats->effects.triggered_halfdeath) {
-			if (src_stats->hp > src_stats->get(STAT_HP_MAX)/2) return;
-			else src_stats->effects.triggered_halfdeath = true;
-		}
-		else if (trigger == TRIGGER_JOINCOMBAT && !src_stats->effects.triggered_joincombat) {
-			if (!src_stats->in_combat) return;
-			else src_stats->effects.triggered_joincombat = true;
-		}
-		else if (trigger == TRIGGER_DEATH && !src_stats->effects.triggered_death) return;
+void PowerManager::activatePassiveList(int trigger, StatBlock *src_stats) {
+	if (src_stats->getPassives(trigger).empty())
+		return;
 
-		activate(power_id, src_stats, src_stats->pos);
-		src_stats->refresh_stats = true;
+	// the list is looked up again each time, since a power may replace the StatBlock contents (e.g. transform)
+	for (size_t i=0; i<src_stats->getPassives(trigger).size(); i++) {
+		activate(src_stats->getPassives(trigger)[i], src_stats, src_stats->pos);
 	}
+	src_stats->refresh_stats = true;
 }
 
 /**
@@ -1462,13 +1914,24 @@ void PowerManager::activateSinglePassive(StatBlock *src_stats, int id) {
 	}
 }
 
+int PowerManager::getEffectIndex(const std::string& id) {
+	std::map<std::string, size_t>::iterator it = effect_index.find(id);
+	if (it == effect_index.end())
+		return -1;
+	return static_cast<int>(it->second);
+}
+
 EffectDef* PowerManager::getEffectDef(const std::string& id) {
-	for (unsigned i=0; i<effects.size(); ++i) {
-		if (effects[i].id == id) {
-			return &effects[i];
-		}
-	}
-	return NULL;
+	int index = getEffectIndex(id);
+	if (index == -1)
+		return NULL;
+	return &effects[index];
+}
+
+void PowerManager::getMemoryUsage(MemoryUsage& usage) const {
+	usage.addTable(powers.size(), powers.capacity() * sizeof(Power));
+	usage.addTable(power_text.size(), power_text.capacity() * sizeof(PowerText));
+	usage.addTable(effects.size(), effects.capacity() * sizeof(EffectDef));
 }
 
 int PowerManager::verifyID(int power_id, FileParser* infile, bool allow_zero) {
@@ -34,9 +34,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Map.h"
 
 #include <cassert>
+#include <map>
 
 class AnimationSet;
 class Hazard;
+class MemoryUsage;
 
 const int POWTYPE_FIXED = 0;
 const int POWTYPE_MISSILE = 1;
@@ -66,6 +68,7 @@ const int TRIGGER_HIT = 1;
 const int TRIGGER_HALFDEATH = 2;
 const int TRIGGER_JOINCOMBAT = 3;
 const int TRIGGER_DEATH = 4;
+const int TRIGGER_COUNT = 5;
 
 const int SPAWN_LIMIT_MODE_FIXED = 0;
 const int SPAWN_LIMIT_MODE_STAT = 1;
@@ -87,11 +90,17 @@ public:
 	int duration;
 	int chance;
 
+	// index into PowerManager::effects, or -1 when the effect is built-in and uses builtin_def
+	int effect_index;
+	EffectDef builtin_def;
+
 	PostEffect()
 		: id("")
 		, magnitude(0)
 		, duration(0)
-		, chance(100) {
+		, chance(100)
+		, effect_index(-1)
+		, builtin_def() {
 	}
 };
 
@@ -110,17 +119,26 @@ public:
 	}
 };
 
+/**
+ * Display text of a power. Only menus and tooltips read it, so it is kept in
+ * PowerManager::power_text instead of Power to keep the power table compact.
+ */
+class PowerText {
+public:
+	std::string name;
+	std::string description;
+};
+
 class Power {
 public:
 	// base info
 	int type; // what kind of activate() this is
-	std::string name;
-	std::string description;
 	int icon; // just the number.  The caller menu will have access to the surface.
 	int new_state; // when using this power the user (avatar/enemy) starts a new state
 	int state_duration; // can be used to extend the length of a state animation by pausing on the last frame
 	bool prevent_interrupt; // prevents hits from interrupting the casting state
 	std::string attack_anim; // name of the animation to play when using this power, if it is not block
+	StringHandle attack_anim_name; // interned attack_anim
 	bool face; // does the user turn to face the mouse cursor when using this power?
 	int source_type; //hero, neutral, or enemy
 	bool beacon; //true if it's just an ememy calling its allies
@@ -130,7 +148,7 @@ public:
 	bool meta_power; // this power can't be used on its own and must be replaced via equipment
 
 	// power requirements
-	std::set<std::string> requires_flags; // checked against equip_flags granted from items
+	std::set<StringHandle> requires_flags; // checked against equip_flags granted from items
 	int requires_mp;
 	int requires_hp;
 	bool sacrifice;
@@ -147,6 +165,7 @@ public:
 
 	// animation info
 	std::string animation_name;
+	AnimationSet *animation_set; // loaded by PowerManager::loadResources(), and kept until the powers are freed
 	int sfx_index;
 	unsigned long sfx_hit;
 	bool sfx_hit_enable;
@@ -249,10 +268,10 @@ public:
 	int script_trigger;
 	std::string script;
 
-	std::vector< std::pair<std::string, int> > remove_effects;
+	std::vector< std::pair<StringHandle, int> > remove_effects;
 
 	int replace_by_effect_power;
-	std::string replace_by_effect_id;
+	StringHandle replace_by_effect_id;
 	int replace_by_effect_count;
 
 	bool requires_corpse;
@@ -262,13 +281,12 @@ public:
 
 	Power()
 		: type(-1)
-		, name("")
-		, description("")
 		, icon(-1)
 		, new_state(-1)
 		, state_duration(0)
 		, prevent_interrupt(false)
 		, attack_anim("")
+		, attack_anim_name(0)
 		, face(false)
 		, source_type(-1)
 		, beacon(false)
@@ -292,6 +310,7 @@ public:
 		, cooldown(0)
 
 		, animation_name("")
+		, animation_set(NULL)
 		, sfx_index(-1)
 		, sfx_hit(0)
 		, sfx_hit_enable(false)
@@ -383,7 +402,7 @@ public:
 		, remove_effects()
 
 		, replace_by_effect_power(0)
-		, replace_by_effect_id("")
+		, replace_by_effect_id(0)
 		, replace_by_effect_count(0)
 
 		, requires_corpse(false)
@@ -401,10 +420,19 @@ private:
 
 	void loadEffects();
 	void loadPowers();
+	void loadPowerResources();
 
 	bool isValidEffect(const std::string& type);
+	int getEffectIndex(const std::string& id);
+
+	// effect id -> index into effects; built by loadEffects()
+	std::map<std::string, size_t> effect_index;
 	int loadSFX(const std::string& filename);
 
+	// (power id, filename) of the sounds to load in loadResources(), in the order they were parsed
+	std::vector<std::pair<int, std::string> > pending_sfx;
+	std::vector<std::pair<int, std::string> > pending_sfx_hit;
+
 	void initHazard(int powernum, StatBlock *src_stats, const FPoint& target, Hazard *haz);
 	void buff(int power_index, StatBlock *src_stats, const FPoint& target);
 	void playSound(int power_index);
@@ -418,12 +446,18 @@ private:
 
 	void payPowerCost(int power_index, StatBlock *src_stats);
 
-	void activatePassiveByTrigger(int power_id, StatBlock *src_stats, bool& triggered_others);
+	void activatePassiveList(int trigger, StatBlock *src_stats);
 
 public:
 	explicit PowerManager();
 	~PowerManager();
 
+	// loads the animations and sounds of the parsed powers; must be called on the main thread
+	void loadResources();
+
+	// parses powers/powers.txt again, for changes made while the game runs; effects are kept
+	void reloadPowers();
+
 	void handleNewMap(MapCollision *_collider);
 	bool activate(int power_index, StatBlock *src_stats, const FPoint& target);
 	bool canUsePower(unsigned id) const;
@@ -436,8 +470,11 @@ public:
 
 	EffectDef* getEffectDef(const std::string& id);
 
+	void getMemoryUsage(MemoryUsage& usage) const;
+
 	std::vector<EffectDef> effects;
 	std::vector<Power> powers;
+	std::vector<PowerText> power_text; // indexed like powers
 	std::queue<Hazard *> hazards; // output; read by HazardManager
 	std::queue<Map_Enemy> map_enemies; // output; read by PowerManager
 
@@ -0,0 +1,577 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "AllocTracker.h"
+#include "Profiler.h"
+#include "Settings.h"
+#include "Utils.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+struct ProfileZoneInfo {
+	const char* name;
+	int depth;
+};
+
+// must match the order of PROFILE_ZONE
+static const ProfileZoneInfo zone_info[PROFILE_ZONE_COUNT] = {
+	{ "input", 0 },
+	{ "logic", 0 },
+	{ "menus", 1 },
+	{ "player", 1 },
+	{ "enemies", 1 },
+	{ "hazards", 1 },
+	{ "loot", 1 },
+	{ "npcs", 1 },
+	{ "sound", 1 },
+	{ "combat text", 1 },
+	{ "map", 1 },
+	{ "render", 0 },
+	{ "map", 1 },
+	{ "background", 2 },
+	{ "sort", 2 },
+	{ "objects", 2 },
+	{ "compose", 2 },
+	{ "menus", 1 },
+	{ "commit", 0 },
+	{ "worker batch", 0 },
+	{ "worker task", 0 },
+	{ "image decode", 0 },
+	{ "sound decode", 0 },
+	{ "music load", 0 },
+	{ "map preload", 0 },
+	{ "save write", 0 }
+};
+
+/**
+ * One entry of a capture
+ * Timed scopes only set zone; markers and counters have a name instead.
+ */
+struct ProfileEvent {
+	char phase; // 'X' for a timed scope, 'i' for a marker, 'C' for a counter
+	int zone;
+	std::string name;
+	SDL_threadID thread;
+	uint64_t start;
+	uint64_t duration;
+	uint64_t value;
+
+	ProfileEvent()
+		: phase('X')
+		, zone(-1)
+		, thread(0)
+		, start(0)
+		, duration(0)
+		, value(0) {
+	}
+};
+
+static bool profiler_enabled = false;
+
+// ticks of the frame that is being recorded
+static uint64_t current[PROFILE_ZONE_COUNT];
+
+static uint64_t history[PROFILE_HISTORY][PROFILE_ZONE_COUNT];
+static uint64_t history_frames[PROFILE_HISTORY];
+static int history_pos = 0;
+static int history_count = 0;
+
+// the end of the previous frame; frame times are recorded whether the profiler is enabled or not
+static uint64_t frame_start = 0;
+static unsigned frame_index = 0;
+static float frame_times[FRAME_TIME_HISTORY];
+static int frame_time_pos = 0;
+static int frame_time_count = 0;
+
+static std::string frame_time_log_file;
+static std::vector<float> frame_time_log;
+
+static std::string run_report_file;
+static std::vector<float> run_frame_times;
+static uint64_t run_zone_total[PROFILE_MAIN_ZONE_COUNT];
+static uint64_t run_zone_peak[PROFILE_MAIN_ZONE_COUNT];
+static uint64_t run_start = 0;
+static uint64_t run_allocs_start = 0;
+
+static SDL_threadID main_thread = 0;
+
+// written by the main thread while holding capture_mutex, so other threads may read it without locking
+static SDL_atomic_t capturing;
+static SDL_mutex *capture_mutex = NULL;
+static std::vector<ProfileEvent> capture_events;
+static uint64_t capture_start = 0;
+static unsigned capture_frames = 0;
+static bool capture_truncated = false;
+
+/**
+ * Adds an event to the capture, from any thread
+ */
+static void addCaptureEvent(const ProfileEvent& event) {
+	SDL_LockMutex(capture_mutex);
+	if (SDL_AtomicGet(&capturing)) {
+		if (capture_events.size() < PROFILE_CAPTURE_EVENTS_MAX)
+			capture_events.push_back(event);
+		else
+			capture_truncated = true;
+	}
+	SDL_UnlockMutex(capture_mutex);
+}
+
+static void resetProfiler() {
+	for (int i = 0; i < PROFILE_ZONE_COUNT; ++i) {
+		current[i] = 0;
+	}
+	history_pos = 0;
+	history_count = 0;
+}
+
+static float ticksToMs(uint64_t ticks) {
+	return static_cast<float>(ticks) * 1000.f / static_cast<float>(SDL_GetPerformanceFrequency());
+}
+
+/**
+ * Main thread zones are timed while they are shown, or so that hitches can name their cause
+ */
+static bool isTimingZones() {
+	return profiler_enabled || HITCH_THRESHOLD > 0 || !run_report_file.empty();
+}
+
+/**
+ * Returns e.g. "render/map/objects", since child zones may share their name
+ */
+static std::string getZonePath(int zone) {
+	std::string path = zone_info[zone].name;
+	int depth = zone_info[zone].depth;
+	for (int i = zone - 1; i >= 0 && depth > 0; --i) {
+		if (zone_info[i].depth < depth) {
+			path = std::string(zone_info[i].name) + "/" + path;
+			depth = zone_info[i].depth;
+		}
+	}
+	return path;
+}
+
+/**
+ * Logs a slow frame along with the zone that took the most time by itself, i.e. without its child zones
+ */
+static void logHitch(float ms) {
+	int worst = -1;
+	uint64_t worst_ticks = 0;
+
+	for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+		uint64_t self = current[i];
+		for (int j = i + 1; j < PROFILE_MAIN_ZONE_COUNT && zone_info[j].depth > zone_info[i].depth; ++j) {
+			if (zone_info[j].depth == zone_info[i].depth + 1)
+				self -= std::min(self, current[j]);
+		}
+		if (self > worst_ticks) {
+			worst = i;
+			worst_ticks = self;
+		}
+	}
+
+	if (worst >= 0)
+		logInfo("Profiler: Frame %u took %.1f ms, mostly in '%s' (%.1f ms).", frame_index, ms, getZonePath(worst).c_str(), ticksToMs(worst_ticks));
+	else
+		logInfo("Profiler: Frame %u took %.1f ms.", frame_index, ms);
+
+	addProfileMarker("hitch");
+}
+
+float calcPercentile(std::vector<float>& values, float percent) {
+	if (values.empty())
+		return 0;
+
+	size_t n = static_cast<size_t>(percent / 100.f * static_cast<float>(values.size() - 1) + 0.5f);
+	n = std::min(n, values.size() - 1);
+	std::nth_element(values.begin(), values.begin() + n, values.end());
+	return values[n];
+}
+
+void setProfilerEnabled(bool enabled) {
+	main_thread = SDL_ThreadID();
+
+	if (enabled && !profiler_enabled)
+		resetProfiler();
+
+	profiler_enabled = enabled;
+}
+
+bool isProfilerEnabled() {
+	return profiler_enabled;
+}
+
+void endProfileFrame() {
+	const uint64_t now = SDL_GetPerformanceCounter();
+
+	if (main_thread == 0)
+		main_thread = SDL_ThreadID();
+
+	endAllocFrame();
+
+	// the first frame has no start yet
+	if (frame_start == 0) {
+		frame_start = now;
+		return;
+	}
+
+	const float ms = ticksToMs(now - frame_start);
+
+	frame_times[frame_time_pos] = ms;
+	frame_time_pos = (frame_time_pos + 1) % FRAME_TIME_HISTORY;
+	frame_time_count = std::min(frame_time_count + 1, FRAME_TIME_HISTORY);
+
+	if (!frame_time_log_file.empty())
+		frame_time_log.push_back(ms);
+
+	if (!run_report_file.empty()) {
+		run_frame_times.push_back(ms);
+		for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+			run_zone_total[i] += current[i];
+			run_zone_peak[i] = std::max(run_zone_peak[i], current[i]);
+		}
+	}
+
+	if (HITCH_THRESHOLD > 0 && ms > static_cast<float>(HITCH_THRESHOLD))
+		logHitch(ms);
+
+	if (isProfileCapturing()) {
+		ProfileEvent event;
+		event.name = "frame";
+		event.thread = main_thread;
+		event.start = frame_start;
+		event.duration = now - frame_start;
+		event.value = capture_frames++;
+		addCaptureEvent(event);
+	}
+
+	if (profiler_enabled) {
+		for (int i = 0; i < PROFILE_ZONE_COUNT; ++i) {
+			history[history_pos][i] = current[i];
+		}
+		history_frames[history_pos] = now - frame_start;
+
+		history_pos = (history_pos + 1) % PROFILE_HISTORY;
+		history_count = std::min(history_count + 1, PROFILE_HISTORY);
+	}
+
+	for (int i = 0; i < PROFILE_ZONE_COUNT; ++i) {
+		current[i] = 0;
+	}
+
+	frame_start = now;
+	frame_index++;
+}
+
+float getFrameTimePercentile(float percent) {
+	std::vector<float> values(frame_times, frame_times + frame_time_count);
+	return calcPercentile(values, percent);
+}
+
+float getFrameTimeMax() {
+	float peak = 0;
+	for (int i = 0; i < frame_time_count; ++i) {
+		peak = std::max(peak, frame_times[i]);
+	}
+	return peak;
+}
+
+unsigned getFrameCount() {
+	return frame_index;
+}
+
+float getLastFrameTime() {
+	if (frame_time_count == 0)
+		return 0;
+
+	return frame_times[(frame_time_pos + FRAME_TIME_HISTORY - 1) % FRAME_TIME_HISTORY];
+}
+
+void startFrameTimeLog(const std::string& filename) {
+	frame_time_log_file = filename;
+	frame_time_log.clear();
+}
+
+bool writeFrameTimeLog() {
+	if (frame_time_log_file.empty())
+		return false;
+
+	std::ofstream outfile(frame_time_log_file.c_str());
+	if (!outfile.is_open()) {
+		logError("Profiler: Could not write frame times to '%s'.", frame_time_log_file.c_str());
+		return false;
+	}
+
+	outfile << "frame,ms\n";
+	for (size_t i = 0; i < frame_time_log.size(); ++i) {
+		outfile << i << "," << frame_time_log[i] << "\n";
+	}
+
+	if (outfile.bad()) {
+		logError("Profiler: Could not write frame times to '%s'.", frame_time_log_file.c_str());
+		return false;
+	}
+
+	std::vector<float> values(frame_time_log);
+	float p50 = calcPercentile(values, 50);
+	float p95 = calcPercentile(values, 95);
+	float p99 = calcPercentile(values, 99);
+	float peak = calcPercentile(values, 100);
+	logInfo("Profiler: %u frames, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms.", static_cast<unsigned>(frame_time_log.size()), p50, p95, p99, peak);
+
+	return true;
+}
+
+void startRunReport(const std::string& filename) {
+	run_report_file = filename;
+	run_frame_times.clear();
+	for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+		run_zone_total[i] = 0;
+		run_zone_peak[i] = 0;
+	}
+	run_start = SDL_GetPerformanceCounter();
+	run_allocs_start = getAllocTotal(ALLOC_ZONE_FRAME);
+}
+
+/**
+ * The report is a list of key=value lines; times are in milliseconds
+ */
+bool writeRunReport() {
+	if (run_report_file.empty())
+		return false;
+
+	std::ofstream outfile(run_report_file.c_str());
+	if (!outfile.is_open()) {
+		logError("Profiler: Could not write the run report to '%s'.", run_report_file.c_str());
+		return false;
+	}
+
+	const size_t frames = run_frame_times.size();
+	const float seconds = ticksToMs(SDL_GetPerformanceCounter() - run_start) / 1000.f;
+
+	std::vector<float> values(run_frame_times);
+	outfile << "frames=" << frames << "\n";
+	outfile << "seconds=" << seconds << "\n";
+	outfile << "frame_ms=" << calcPercentile(values, 50) << "," << calcPercentile(values, 95) << "," << calcPercentile(values, 99) << "," << calcPercentile(values, 100) << "\n";
+
+	if (isAllocTrackingBuilt() && frames > 0)
+		outfile << "allocs_per_frame=" << static_cast<float>(getAllocTotal(ALLOC_ZONE_FRAME) - run_allocs_start) / static_cast<float>(frames) << "\n";
+
+	for (int i = 0; i < PROFILE_MAIN_ZONE_COUNT; ++i) {
+		const float average = (frames > 0 ? ticksToMs(run_zone_total[i]) / static_cast<float>(frames) : 0);
+		outfile << "zone=" << getZonePath(i) << "," << average << "," << ticksToMs(run_zone_peak[i]) << "\n";
+	}
+
+	if (outfile.bad()) {
+		logError("Profiler: Could not write the run report to '%s'.", run_report_file.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+const char* getProfileZoneName(PROFILE_ZONE zone) {
+	return zone_info[zone].name;
+}
+
+int getProfileZoneDepth(PROFILE_ZONE zone) {
+	return zone_info[zone].depth;
+}
+
+float getProfileAverage(PROFILE_ZONE zone) {
+	if (history_count == 0)
+		return 0;
+
+	uint64_t total = 0;
+	for (int i = 0; i < history_count; ++i) {
+		total += history[i][zone];
+	}
+	return ticksToMs(total) / static_cast<float>(history_count);
+}
+
+float getProfilePeak(PROFILE_ZONE zone) {
+	uint64_t peak = 0;
+	for (int i = 0; i < history_count; ++i) {
+		peak = std::max(peak, history[i][zone]);
+	}
+	return ticksToMs(peak);
+}
+
+float getProfileFrameAverage() {
+	if (history_count == 0)
+		return 0;
+
+	uint64_t total = 0;
+	for (int i = 0; i < history_count; ++i) {
+		total += history_frames[i];
+	}
+	return ticksToMs(total) / static_cast<float>(history_count);
+}
+
+void startProfileCapture() {
+	if (!capture_mutex)
+		capture_mutex = SDL_CreateMutex();
+
+	SDL_LockMutex(capture_mutex);
+	main_thread = SDL_ThreadID();
+	capture_events.clear();
+	capture_start = SDL_GetPerformanceCounter();
+	capture_frames = 0;
+	capture_truncated = false;
+	SDL_AtomicSet(&capturing, 1);
+	SDL_UnlockMutex(capture_mutex);
+}
+
+bool isProfileCapturing() {
+	return SDL_AtomicGet(&capturing) != 0;
+}
+
+void addProfileMarker(const std::string& name) {
+	if (!isProfileCapturing())
+		return;
+
+	ProfileEvent event;
+	event.phase = 'i';
+	event.name = name;
+	event.thread = SDL_ThreadID();
+	event.start = SDL_GetPerformanceCounter();
+	addCaptureEvent(event);
+}
+
+void addProfileCounter(const std::string& name, uint64_t value) {
+	if (!isProfileCapturing())
+		return;
+
+	ProfileEvent event;
+	event.phase = 'C';
+	event.name = name;
+	event.thread = SDL_ThreadID();
+	event.start = SDL_GetPerformanceCounter();
+	event.value = value;
+	addCaptureEvent(event);
+}
+
+static std::string escapeJSON(const std::string& s) {
+	std::string out;
+	for (size_t i = 0; i < s.length(); ++i) {
+		if (s[i] == '"' || s[i] == '\\')
+			out += '\\';
+		if (static_cast<unsigned char>(s[i]) >= 0x20)
+			out += s[i];
+	}
+	return out;
+}
+
+/**
+ * Trace timestamps are in microseconds since the start of the capture
+ */
+static double ticksToUs(uint64_t ticks) {
+	return static_cast<double>(ticks) * 1000000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+bool stopProfileCapture(const std::string& filename) {
+	if (!isProfileCapturing())
+		return false;
+
+	SDL_LockMutex(capture_mutex);
+	SDL_AtomicSet(&capturing, 0);
+	SDL_UnlockMutex(capture_mutex);
+
+	// no other thread touches the events once capturing is unset
+	std::vector<ProfileEvent> events;
+	events.swap(capture_events);
+
+	std::ofstream outfile(filename.c_str());
+	if (!outfile.is_open()) {
+		logError("Profiler: Could not write trace file '%s'.", filename.c_str());
+		return false;
+	}
+
+	outfile.setf(std::ios::fixed);
+	outfile.precision(3);
+
+	outfile << "{\"traceEvents\":[\n";
+	outfile << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << main_thread << ",\"args\":{\"name\":\"main\"}}";
+
+	for (size_t i = 0; i < events.size(); ++i) {
+		const ProfileEvent& event = events[i];
+		const std::string name = event.zone >= 0 ? getProfileZoneName(static_cast<PROFILE_ZONE>(event.zone)) : escapeJSON(event.name);
+		const double ts = event.start > capture_start ? ticksToUs(event.start - capture_start) : 0;
+
+		outfile << ",\n{\"name\":\"" << name << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << ts;
+
+		if (event.phase == 'X') {
+			outfile << ",\"dur\":" << ticksToUs(event.duration);
+			if (event.zone < 0)
+				outfile << ",\"args\":{\"frame\":" << event.value << "}";
+		}
+		else if (event.phase == 'i') {
+			outfile << ",\"s\":\"g\"";
+		}
+		else if (event.phase == 'C') {
+			outfile << ",\"args\":{\"value\":" << event.value << "}";
+		}
+		outfile << "}";
+	}
+
+	outfile << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	if (outfile.bad()) {
+		logError("Profiler: Could not write trace file '%s'.", filename.c_str());
+		return false;
+	}
+
+	if (capture_truncated)
+		logInfo("Profiler: The capture reached %u events and was cut short.", static_cast<unsigned>(PROFILE_CAPTURE_EVENTS_MAX));
+	logInfo("Profiler: Wrote %u events to '%s'.", static_cast<unsigned>(events.size()), filename.c_str());
+
+	return true;
+}
+
+ProfileScope::ProfileScope(PROFILE_ZONE _zone)
+	: zone(_zone)
+	, start(isTimingZones() || isProfileCapturing() ? SDL_GetPerformanceCounter() : 0)
+	, alloc_zone(enterAllocZone(_zone)) {
+}
+
+ProfileScope::~ProfileScope() {
+	if (alloc_zone)
+		leaveAllocZone();
+
+	if (start == 0)
+		return;
+
+	const uint64_t end = SDL_GetPerformanceCounter();
+	const SDL_threadID thread = SDL_ThreadID();
+
+	// the profiler may have been toggled inside of this scope
+	if (isTimingZones() && thread == main_thread)
+		current[zone] += end - start;
+
+	if (isProfileCapturing()) {
+		ProfileEvent event;
+		event.zone = zone;
+		event.thread = thread;
+		event.start = start;
+		event.duration = end - start;
+		addCaptureEvent(event);
+	}
+}
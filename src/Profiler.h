@@ -0,0 +1,153 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * Frame profiler
+ *
+ * The main loop stages are wrapped in ProfileScope objects. While the profiler
+ * is enabled, each scope adds the time it took to its zone, and the totals of
+ * every frame are kept in a ring buffer of the last PROFILE_HISTORY frames.
+ * Zones form a fixed tree: nested zones are counted in their parent too.
+ *
+ * A capture additionally records every timed scope, including the ones on
+ * worker threads, along with frame boundaries, markers and counters. It is
+ * written out in the trace event format that Chrome's about:tracing and
+ * Perfetto can open.
+ *
+ * Frame times are always recorded. Frames that take longer than the
+ * hitch_threshold setting are logged along with the zone that took the most
+ * time. Apart from the scopes, all of this is meant for the main
+ * thread only.
+ *
+ * With ALLOC_TRACKING, the scopes also count heap allocations; see AllocTracker.h.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum PROFILE_ZONE {
+	PROFILE_INPUT = 0,
+	PROFILE_LOGIC,
+	PROFILE_LOGIC_MENUS,
+	PROFILE_LOGIC_PLAYER,
+	PROFILE_LOGIC_ENEMIES,
+	PROFILE_LOGIC_HAZARDS,
+	PROFILE_LOGIC_LOOT,
+	PROFILE_LOGIC_NPCS,
+	PROFILE_LOGIC_SOUND,
+	PROFILE_LOGIC_COMBAT_TEXT,
+	PROFILE_LOGIC_MAP,
+	PROFILE_RENDER,
+	PROFILE_RENDER_MAP,
+	PROFILE_RENDER_MAP_BACKGROUND,
+	PROFILE_RENDER_MAP_SORT,
+	PROFILE_RENDER_MAP_OBJECTS,
+	PROFILE_RENDER_MAP_COMPOSE,
+	PROFILE_RENDER_MENUS,
+	PROFILE_COMMIT,
+
+	// these run on other threads, so they only show up in captures
+	PROFILE_WORKER_BATCH,
+	PROFILE_WORKER_TASK,
+	PROFILE_IMAGE_DECODE,
+	PROFILE_SOUND_DECODE,
+	PROFILE_MUSIC_LOAD,
+	PROFILE_MAP_PRELOAD,
+	PROFILE_SAVE_WRITE,
+	PROFILE_ZONE_COUNT
+};
+
+// the zones before this one are timed on the main thread
+const int PROFILE_MAIN_ZONE_COUNT = PROFILE_WORKER_BATCH;
+
+// number of frames kept for the averages
+const int PROFILE_HISTORY = 120;
+
+// number of frames kept for the frame time percentiles
+const int FRAME_TIME_HISTORY = 600;
+
+// a capture stops recording once it has this many events
+const size_t PROFILE_CAPTURE_EVENTS_MAX = 1000000;
+
+void setProfilerEnabled(bool enabled);
+bool isProfilerEnabled();
+
+// called once per displayed frame, after the frame has been committed
+void endProfileFrame();
+
+const char* getProfileZoneName(PROFILE_ZONE zone);
+int getProfileZoneDepth(PROFILE_ZONE zone);
+
+// in milliseconds, over the recorded history
+float getProfileAverage(PROFILE_ZONE zone);
+float getProfilePeak(PROFILE_ZONE zone);
+
+// in milliseconds, the whole frame including the time spent waiting
+float getProfileFrameAverage();
+
+// in milliseconds, over the last FRAME_TIME_HISTORY frames; these are recorded even while the profiler is disabled
+float getFrameTimePercentile(float percent);
+float getFrameTimeMax();
+
+// the number of frames so far, and the time of the last one in milliseconds
+unsigned getFrameCount();
+float getLastFrameTime();
+
+// returns the value at percent (0-100) of the sorted values; values is reordered
+float calcPercentile(std::vector<float>& values, float percent);
+
+// records the time of every frame from now on, to be written to filename as CSV
+void startFrameTimeLog(const std::string& filename);
+bool writeFrameTimeLog();
+
+// Times the main thread zones from now on, to write a summary of the whole run to filename:
+// the frame time percentiles, the allocations per frame and the average and peak of each zone.
+// flare_batch reads these to compare runs.
+void startRunReport(const std::string& filename);
+bool writeRunReport();
+
+void startProfileCapture();
+bool isProfileCapturing();
+
+// writes the capture to filename and discards it; returns false if there was nothing to write or it failed
+bool stopProfileCapture(const std::string& filename);
+
+// an instant event, e.g. a map load
+void addProfileMarker(const std::string& name);
+
+// a value that is graphed over time, e.g. the size of a cache
+void addProfileCounter(const std::string& name, uint64_t value);
+
+/**
+ * Times the enclosing block while the profiler is enabled
+ */
+class ProfileScope {
+public:
+	explicit ProfileScope(PROFILE_ZONE _zone);
+	~ProfileScope();
+
+private:
+	PROFILE_ZONE zone;
+	uint64_t start;
+	bool alloc_zone;
+};
+
+#endif // PROFILER_H
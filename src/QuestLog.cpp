@@ -34,7 +34,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsParsing.h"
 #include "SharedGameResources.h"
 
-QuestLog::QuestLog(MenuLog *_log) {
+QuestLog::QuestLog(MenuLog *_log)
+	: check_all_quests(true) {
 	log = _log;
 
 	newQuestNotification = false;
@@ -53,6 +54,36 @@ void QuestLog::loadAll() {
 	std::sort(files.begin(), files.end());
 	for (unsigned int i = 0; i < files.size(); i++)
 		load(files[i]);
+
+	subscribe();
+}
+
+/**
+ * Compile the quest requirements and register each quest with the statuses it depends on
+ */
+void QuestLog::subscribe() {
+	quest_requirements.clear();
+	quest_requirements.resize(quests.size());
+	quest_active.assign(quests.size(), false);
+	check_all_quests = true;
+	status_subscribers.clear();
+	volatile_quests.clear();
+
+	for (size_t i=0; i<quests.size(); i++) {
+		camp->compileRequirements(quests[i], quest_requirements[i]);
+
+		const std::vector<Event_Requirement> &status_checks = quest_requirements[i].status_checks;
+		for (size_t j=0; j<status_checks.size(); j++) {
+			StringHandle s = status_checks[j].s;
+			if (s >= status_subscribers.size())
+				status_subscribers.resize(s + 1);
+			if (status_subscribers[s].empty() || status_subscribers[s].back() != i)
+				status_subscribers[s].push_back(i);
+		}
+
+		if (!quest_requirements[i].other_checks.empty())
+			volatile_quests.push_back(i);
+	}
 }
 
 /**
@@ -134,7 +165,7 @@ void QuestLog::load(const std::string& filename) {
 			// @ATTR quest.quest_text|string|Text that gets displayed in the Quest log when this quest is active.
 			Event_Component ec;
 			ec.type = EC_QUEST_TEXT;
-			ec.s = msg->get(infile.val);
+			ec.setString(msg->get(infile.val));
 
 			// quest group id
 			ec.x = static_cast<int>(quest_names.size()-1);
@@ -153,41 +184,69 @@ void QuestLog::load(const std::string& filename) {
 	infile.close();
 }
 
+/**
+ * Only the quests that depend on a changed status, or on something that can't be tracked, are re-checked
+ */
 void QuestLog::logic() {
-	createQuestList();
+	if (check_all_quests) {
+		createQuestList();
+		return;
+	}
+
+	camp->takeStatusChanges(status_changes);
+
+	bool changed = false;
+
+	for (size_t i=0; i<status_changes.size(); i++) {
+		StringHandle s = status_changes[i];
+		if (s >= status_subscribers.size())
+			continue;
+
+		for (size_t j=0; j<status_subscribers[s].size(); j++)
+			changed |= updateQuest(status_subscribers[s][j]);
+	}
+
+	for (size_t i=0; i<volatile_quests.size(); i++)
+		changed |= updateQuest(volatile_quests[i]);
+
+	if (changed)
+		refreshQuestList();
+}
+
+/**
+ * Returns true if the quest has become active or inactive
+ */
+bool QuestLog::updateQuest(size_t quest_id) {
+	// quests without any requirement are never shown
+	bool requirements_met = camp->checkRequirements(quests[quest_id], quest_requirements[quest_id]) && !quest_requirements[quest_id].empty();
+
+	if (requirements_met == quest_active[quest_id])
+		return false;
+
+	quest_active[quest_id] = requirements_met;
+	return true;
 }
 
 /**
  * All active quests are placed in the Quest tab of the Log Menu
  */
 void QuestLog::createQuestList() {
-	std::vector<size_t> temp_quest_ids;
+	// pending changes are covered by checking every quest
+	camp->takeStatusChanges(status_changes);
 
-	// check quest requirements
-	for (size_t i=0; i<quests.size(); i++) {
-		bool requirements_met = false;
+	for (size_t i=0; i<quests.size(); i++)
+		updateQuest(i);
 
-		for (size_t j=0; j<quests[i].size(); j++) {
-			if (quests[i][j].type == EC_QUEST_TEXT) {
-				continue;
-			}
-			else {
-				// check requirements
-				// break (skip to next dialog node) if any requirement fails
-				// if we reach an event that is not a requirement, succeed
-				if (!camp->checkAllRequirements(quests[i][j])) {
-					requirements_met = false;
-					break;
-				}
-			}
+	check_all_quests = false;
+	refreshQuestList();
+}
 
-			requirements_met = true;
-		}
+void QuestLog::refreshQuestList() {
+	std::vector<size_t> temp_quest_ids;
 
-		if (requirements_met) {
-			// passed requirement checks, add ID to active quest list
+	for (size_t i=0; i<quests.size(); i++) {
+		if (quest_active[i])
 			temp_quest_ids.push_back(i);
-		}
 	}
 
 	// check if we actually need to update the quest log
@@ -228,7 +287,7 @@ void QuestLog::createQuestList() {
 
 			for (size_t j=0; j<quests[k].size(); j++) {
 				if (quests[k][j].type == EC_QUEST_TEXT) {
-					log->add(quests[k][j].s, LOG_TYPE_QUESTS, false);
+					log->add(quests[k][j].getString(), LOG_TYPE_QUESTS, false);
 
 					if (next_quest_id != quests[k][j].x) {
 						if (quest_names[quests[k][j].x] != "")
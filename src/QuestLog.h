@@ -26,6 +26,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #define QUEST_LOG_H
 
 #include "CommonIncludes.h"
+#include "EventManager.h"
 #include "Utils.h"
 
 class MenuLog;
@@ -37,6 +38,23 @@ private:
 	// inner vector is a chain of events per quest, outer vector is a
 	// list of quests.
 	std::vector<std::vector<Event_Component> >quests;
+	std::vector<Event_Requirements> quest_requirements;
+	std::vector<bool> quest_active;
+
+	// quests to re-check when a status changes, indexed by status handle
+	std::vector<std::vector<size_t> > status_subscribers;
+
+	// quests with currency, item, level or class requirements, re-checked every frame
+	std::vector<size_t> volatile_quests;
+
+	std::vector<StringHandle> status_changes;
+
+	// set until every quest has been checked once
+	bool check_all_quests;
+
+	void subscribe();
+	bool updateQuest(size_t quest_id);
+	void refreshQuestList();
 
 	std::vector<size_t> active_quest_ids;
 	std::vector<std::string> quest_names;
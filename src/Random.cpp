@@ -0,0 +1,93 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "Random.h"
+
+static RandomStream streams[RANDOM_STREAM_COUNT];
+static uint32_t random_seed = 0;
+
+static inline uint32_t rotl(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+/**
+ * Spreads the bits of x, so that similar seeds give unrelated states
+ */
+static inline uint32_t mix(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+RandomStream::RandomStream() {
+	seed(0);
+}
+
+void RandomStream::seed(uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		state[i] = mix(value + 0x9e3779b9U * static_cast<uint32_t>(i + 1));
+	}
+
+	// the all-zero state would only ever produce zeros
+	if (!state[0] && !state[1] && !state[2] && !state[3])
+		state[0] = 1;
+}
+
+uint32_t RandomStream::next() {
+	const uint32_t result = rotl(state[1] * 5, 7) * 9;
+	const uint32_t t = state[1] << 9;
+
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 11);
+
+	return result;
+}
+
+int RandomStream::nextInt(int n) {
+	if (n <= 0)
+		return 0;
+
+	// scales instead of taking the remainder, which would favor low numbers
+	return static_cast<int>((static_cast<uint64_t>(next()) * static_cast<uint64_t>(n)) >> 32);
+}
+
+float RandomStream::nextFloat() {
+	// the top 24 bits fit exactly in a float
+	return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f);
+}
+
+void seedRandom(uint32_t seed) {
+	random_seed = seed;
+	for (int i = 0; i < RANDOM_STREAM_COUNT; ++i) {
+		streams[i].seed(mix(seed ^ mix(static_cast<uint32_t>(i + 1))));
+	}
+}
+
+uint32_t getRandomSeed() {
+	return random_seed;
+}
+
+RandomStream& getRandomStream(RANDOM_STREAM stream) {
+	return streams[stream];
+}
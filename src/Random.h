@@ -0,0 +1,90 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * Random numbers for the engine
+ *
+ * Each subsystem draws from its own stream, so that for example the number of
+ * visual effects on screen can't change the outcome of a loot roll. All streams
+ * are derived from a single seed, which makes a session reproducible given the
+ * same seed and the same input. A stream isn't locked, so it must only be used
+ * from one thread at a time.
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstddef>
+#include <stdint.h>
+
+enum RANDOM_STREAM {
+	RANDOM_GENERAL = 0, // events, menus, spawning and anything else without its own stream
+	RANDOM_LOOT = 1,
+	RANDOM_AI = 2,
+	RANDOM_COMBAT = 3,
+	RANDOM_VISUAL = 4, // effects that don't change the game state, like shaky cam
+	RANDOM_STREAM_COUNT = 5
+};
+
+/**
+ * xoshiro128** generator
+ */
+class RandomStream {
+public:
+	RandomStream();
+
+	void seed(uint32_t value);
+	uint32_t next();
+
+	// returns a number in [0, n), or 0 if n is not positive
+	int nextInt(int n);
+
+	// returns a number in [0, 1)
+	float nextFloat();
+
+private:
+	uint32_t state[4];
+};
+
+// seeds every stream from one value
+void seedRandom(uint32_t seed);
+uint32_t getRandomSeed();
+
+RandomStream& getRandomStream(RANDOM_STREAM stream);
+
+/**
+ * Returns a random number in [0, n)
+ */
+inline int randInt(int n, RANDOM_STREAM stream = RANDOM_GENERAL) {
+	return getRandomStream(stream).nextInt(n);
+}
+
+/**
+ * Returns a random index into a container of the given size
+ */
+inline size_t randIndex(size_t size, RANDOM_STREAM stream = RANDOM_GENERAL) {
+	return static_cast<size_t>(randInt(static_cast<int>(size), stream));
+}
+
+/**
+ * Returns a random number in [0, 1)
+ */
+inline float randFloat(RANDOM_STREAM stream = RANDOM_GENERAL) {
+	return getRandomStream(stream).nextFloat();
+}
+
+#endif // RANDOM_H
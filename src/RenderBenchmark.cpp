@@ -0,0 +1,234 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class RenderBenchmark
+ */
+
+#include "EnemyManager.h"
+#include "InputState.h"
+#include "MapRenderer.h"
+#include "PowerManager.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "RenderBenchmark.h"
+#include "SharedGameResources.h"
+#include "SharedResources.h"
+#include "Settings.h"
+#include "UtilsMath.h"
+#include "UtilsParsing.h"
+
+#include <stdio.h>
+
+// the population is placed with its own seed, so that it doesn't depend on what happened before the run
+const uint32_t RENDER_BENCHMARK_SEED = 1;
+
+// enemies and hazards are placed within this many tiles of the camera path
+const int RENDER_BENCHMARK_SPREAD = 3;
+
+RenderBenchmark::RenderBenchmark()
+	: enemy_count(0)
+	, power_id(0)
+	, hazards_per_second(0)
+	, state(STATE_IDLE)
+	, ticks(0)
+	, hazard_timer(0)
+	, path_length(0)
+	, path_dist(0)
+	, last_frame(0)
+	, first_draws(0)
+	, first_batches(0)
+{
+	source.hero_ally = true;
+}
+
+void RenderBenchmark::parseConfig() {
+	std::string config = BENCHMARK_RENDER;
+	map_filename = popFirstString(config);
+	enemy_category = popFirstString(config);
+	enemy_count = std::max(0, popFirstInt(config));
+	power_id = std::max(0, popFirstInt(config));
+	hazards_per_second = std::max(0, popFirstInt(config));
+}
+
+/**
+ * A rectangle through the middle of each quarter of the map, starting and ending at the hero
+ */
+void RenderBenchmark::buildPath() {
+	const float x0 = static_cast<float>(mapr->w) * 0.25f;
+	const float y0 = static_cast<float>(mapr->h) * 0.25f;
+	const float x1 = static_cast<float>(mapr->w) * 0.75f;
+	const float y1 = static_cast<float>(mapr->h) * 0.75f;
+
+	path.clear();
+	path.push_back(mapr->cam);
+	path.push_back(FPoint(x0, y0));
+	path.push_back(FPoint(x1, y0));
+	path.push_back(FPoint(x1, y1));
+	path.push_back(FPoint(x0, y1));
+	path.push_back(FPoint(x0, y0));
+	path.push_back(mapr->cam);
+
+	path_length = 0;
+	for (size_t i = 1; i < path.size(); ++i)
+		path_length += calcDist(path[i-1], path[i]);
+	path_dist = 0;
+}
+
+FPoint RenderBenchmark::getPathPos(float dist) {
+	if (path_length <= 0)
+		return path.empty() ? mapr->cam : path[0];
+
+	dist = fmodf(dist, path_length);
+	for (size_t i = 1; i < path.size(); ++i) {
+		const float length = calcDist(path[i-1], path[i]);
+		if (dist <= length && length > 0) {
+			const float t = dist / length;
+			return FPoint(path[i-1].x + (path[i].x - path[i-1].x) * t, path[i-1].y + (path[i].y - path[i-1].y) * t);
+		}
+		dist -= length;
+	}
+	return path.back();
+}
+
+/**
+ * The enemies are spread evenly along the path; they are created by the EnemyManager on its next logic()
+ */
+void RenderBenchmark::populate() {
+	seedRandom(RENDER_BENCHMARK_SEED);
+
+	if (enemy_category.empty())
+		return;
+
+	for (int i = 0; i < enemy_count; ++i) {
+		const FPoint pos = getPathPos(path_length * static_cast<float>(i) / static_cast<float>(enemy_count));
+		const FPoint spawn_pos = mapr->collider.get_random_neighbor(FPointToPoint(pos), RENDER_BENCHMARK_SPREAD, false);
+		enemies->spawn(enemy_category, FPointToPoint(spawn_pos));
+	}
+}
+
+/**
+ * Hazards are fired across the part of the path the camera is on
+ */
+void RenderBenchmark::fireHazard() {
+	source.pos = getPathPos(path_dist);
+	source.pos.x += static_cast<float>(randBetween(-RENDER_BENCHMARK_SPREAD, RENDER_BENCHMARK_SPREAD));
+	source.pos.y += static_cast<float>(randBetween(-RENDER_BENCHMARK_SPREAD, RENDER_BENCHMARK_SPREAD));
+
+	FPoint target = source.pos;
+	target.x += static_cast<float>(randBetween(-RENDER_BENCHMARK_SPREAD, RENDER_BENCHMARK_SPREAD));
+	target.y += static_cast<float>(randBetween(-RENDER_BENCHMARK_SPREAD, RENDER_BENCHMARK_SPREAD));
+	source.direction = calcDirection(source.pos.x, source.pos.y, target.x, target.y);
+
+	powers->activate(power_id, &source, target);
+}
+
+void RenderBenchmark::report() {
+	const unsigned frames = static_cast<unsigned>(frame_times.size());
+
+	float total = 0;
+	for (size_t i = 0; i < frame_times.size(); ++i)
+		total += frame_times[i];
+	const float avg = frames > 0 ? total / static_cast<float>(frames) : 0;
+
+	std::vector<float> values(frame_times);
+	const float p99 = calcPercentile(values, 99);
+	const float peak = calcPercentile(values, 100);
+
+	const float draws = frames > 0 ? static_cast<float>(render_device->getDrawCount() - first_draws) / static_cast<float>(frames) : 0;
+	const float batches = frames > 0 ? static_cast<float>(render_device->getBatchCount() - first_batches) / static_cast<float>(frames) : 0;
+
+	char buf[512];
+	snprintf(buf, sizeof(buf), "%s at %dx%d, %d enemies, %d hazards/s: %u frames, avg %.2f ms, p99 %.2f ms, max %.2f ms, %.0f draws/frame, %.0f batches/frame",
+		map_filename.c_str(), VIEW_W, VIEW_H, enemy_count, hazards_per_second,
+		frames, avg, p99, peak, draws, batches);
+
+	logInfo("RenderBenchmark: %s", buf);
+	printf("%s\n", buf);
+}
+
+void RenderBenchmark::logic() {
+	if (state == STATE_DONE || BENCHMARK_RENDER.empty())
+		return;
+
+	if (state == STATE_IDLE) {
+		parseConfig();
+		if (map_filename.empty() || mods->locate(map_filename).empty()) {
+			logError("RenderBenchmark: Map '%s' could not be found.", map_filename.c_str());
+			state = STATE_DONE;
+			inpt->done = true;
+			return;
+		}
+
+		mapr->teleportation = true;
+		mapr->teleport_mapname = map_filename;
+		mapr->teleport_destination = FPoint(-1, -1);
+		state = STATE_LOADING;
+		return;
+	}
+
+	if (mapr->teleportation)
+		return;
+
+	if (state == STATE_LOADING) {
+		if (mapr->getFilename() != map_filename)
+			return;
+
+		buildPath();
+		populate();
+		ticks = RENDER_BENCHMARK_WARMUP_FRAMES;
+		hazard_timer = 0;
+		state = STATE_WARMUP;
+	}
+
+	// hazards are fired at an even rate, including during the warmup
+	if (hazards_per_second > 0 && power_id > 0) {
+		hazard_timer += hazards_per_second;
+		while (hazard_timer >= MAX_FRAMES_PER_SEC) {
+			hazard_timer -= MAX_FRAMES_PER_SEC;
+			fireHazard();
+		}
+	}
+
+	if (state == STATE_WARMUP) {
+		if (--ticks <= 0) {
+			last_frame = getFrameCount();
+			first_draws = render_device->getDrawCount();
+			first_batches = render_device->getBatchCount();
+			frame_times.clear();
+			state = STATE_RUNNING;
+		}
+	}
+	else if (state == STATE_RUNNING) {
+		path_dist += RENDER_BENCHMARK_SPEED;
+
+		// several logic ticks may run for a single frame
+		if (getFrameCount() != last_frame) {
+			last_frame = getFrameCount();
+			frame_times.push_back(getLastFrameTime());
+		}
+
+		if (frame_times.size() >= RENDER_BENCHMARK_FRAMES) {
+			report();
+			state = STATE_DONE;
+			inpt->done = true;
+		}
+	}
+
+	// the hero stays where they are, only the camera moves
+	mapr->cam = getPathPos(path_dist);
+}
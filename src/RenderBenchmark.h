@@ -0,0 +1,93 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class RenderBenchmark
+ *
+ * Started with --benchmark-render, for comparing render devices and settings on
+ * the same machine. The hero is sent to the chosen map, a fixed population of
+ * enemies and hazards is added, and the camera flies along a loop through the
+ * map while the game runs uncapped. The frame times and draw counts of a fixed
+ * number of frames are reported, and the game quits.
+ *
+ * The run is repeatable for the same map, save, random seed and mods. Each run
+ * measures the render device the game was started with.
+ */
+
+#ifndef RENDER_BENCHMARK_H
+#define RENDER_BENCHMARK_H
+
+#include "CommonIncludes.h"
+#include "StatBlock.h"
+#include "Utils.h"
+
+// the number of frames that are measured
+const unsigned RENDER_BENCHMARK_FRAMES = 2000;
+
+// frames for enemies and images to load before measuring starts
+const int RENDER_BENCHMARK_WARMUP_FRAMES = 120;
+
+// how far the camera moves each logic frame, in tiles
+const float RENDER_BENCHMARK_SPEED = 0.1f;
+
+class RenderBenchmark {
+private:
+	enum {
+		STATE_IDLE = 0,
+		STATE_LOADING,
+		STATE_WARMUP,
+		STATE_RUNNING,
+		STATE_DONE
+	};
+
+	void parseConfig();
+	void buildPath();
+	FPoint getPathPos(float dist);
+	void populate();
+	void fireHazard();
+	void report();
+
+	// from BENCHMARK_RENDER: map, enemy category, enemy count, power id, hazards per second
+	std::string map_filename;
+	std::string enemy_category;
+	int enemy_count;
+	int power_id;
+	int hazards_per_second;
+
+	int state;
+	int ticks;
+	int hazard_timer;
+
+	// the camera path is a closed loop of straight lines
+	std::vector<FPoint> path;
+	float path_length;
+	float path_dist;
+
+	// the hazards need a source that lasts as long as they do
+	StatBlock source;
+
+	unsigned last_frame;
+	std::vector<float> frame_times;
+	unsigned long first_draws;
+	unsigned long first_batches;
+
+public:
+	RenderBenchmark();
+	void logic();
+};
+
+#endif // RENDER_BENCHMARK_H
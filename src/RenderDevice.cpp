@@ -18,7 +18,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <assert.h>
 #include <stdio.h>
+#include <algorithm>
+#include "MemoryUsage.h"
 #include "RenderDevice.h"
+#include "SharedResources.h"
+#include "Settings.h"
 
 
 /*
@@ -26,7 +30,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  */
 Image::Image(RenderDevice *_device)
 	: device(_device)
-	, ref_counter(1) {
+	, ref_counter(1)
+	, pin_counter(0) {
 }
 
 Image::~Image() {
@@ -73,7 +78,8 @@ Sprite::Sprite(Image *_image)
 	, image(_image)
 	, src(Rect())
 	, offset()
-	, dest() {
+	, dest()
+	, scaled_size() {
 	image->ref();
 }
 
@@ -126,6 +132,15 @@ void Sprite::setClipH(const int h) {
 Rect Sprite::getClip() {
 	return src;
 }
+
+void Sprite::setScaledSize(int w, int h) {
+	scaled_size.x = w;
+	scaled_size.y = h;
+}
+
+Point Sprite::getScaledSize() {
+	return scaled_size;
+}
 void Sprite::setDest(const Rect& _dest) {
 	dest.x = static_cast<float>(_dest.x);
 	dest.y = static_cast<float>(_dest.y);
@@ -166,6 +181,29 @@ Image * Sprite::getGraphics() {
 }
 
 
+/*
+ * RenderBatchItem
+ */
+bool RenderBatchItem::sameState(const RenderBatchItem& other) const {
+	if (image != other.image || use_mods != other.use_mods)
+		return false;
+	if (!use_mods)
+		return true;
+	return blend_mode == other.blend_mode && alpha_mod == other.alpha_mod &&
+		   color_mod.r == other.color_mod.r && color_mod.g == other.color_mod.g && color_mod.b == other.color_mod.b;
+}
+
+/*
+ * RenderImageCache
+ */
+bool RenderImageCache::isIdle(const Entry& entry) const {
+	return entry.resource->getRefCount() <= 1;
+}
+
+void RenderImageCache::freeResource(Image *image) {
+	image->unref();
+}
+
 /*
  * RenderDevice
  */
@@ -176,60 +214,158 @@ RenderDevice::RenderDevice()
 	, texture_filter(false)
 	, min_screen(640, 480)
 	, is_initialized(false)
-	, reload_graphics(false) {
+	, reload_graphics(false)
+	, lost_render_targets(false)
+	, allow_low_res_images(false)
+	, allow_scaled_sprites(false)
+	, world_scale(1)
+	, world_frame_avg(0)
+	, world_scale_hold(0)
+	, world_scale_probe(0)
+	, atlas(this)
+	, batching(false)
+	, draw_count(0)
+	, batch_count(0) {
 }
 
 RenderDevice::~RenderDevice() {
 }
 
 void RenderDevice::destroyContext() {
-	if (!cache.empty()) {
-		IMAGE_CACHE_CONTAINER_ITER it;
-		logError("RenderDevice: Image cache still holding these images:");
-		it = cache.begin();
-		while (it != cache.end()) {
-			logError("%s %d", it->first.c_str(), it->second->getRefCount());
-			++it;
+	bool in_use = false;
+	for (RenderImageCache::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+		if (it->second.resource->getRefCount() > 1) {
+			if (!in_use)
+				logError("RenderDevice: Image cache still holding these images:");
+			logError("%s %d", it->first.c_str(), it->second.resource->getRefCount() - 1);
+			in_use = true;
 		}
 	}
-	assert(cache.empty());
+	assert(!in_use);
+}
+
+void RenderDevice::requestImage(const std::string& filename) {
+	if (cache.get(filename) || atlas.contains(filename))
+		return;
+
+	decoder.request(filename, locateImage(filename));
+}
+
+bool RenderDevice::isImagePending(const std::string& filename) {
+	return decoder.isPending(filename);
+}
+
+void RenderDevice::cancelImageRequests() {
+	decoder.clear();
+}
+
+Image* RenderDevice::loadAtlasImage(const std::string& filename, Rect& bounds, const std::string& errormessage, bool IfNotFoundExit) {
+	return atlas.load(filename, bounds, errormessage, IfNotFoundExit);
+}
+
+void RenderDevice::freeUnusedImages() {
+	cache.trim(0);
+}
+
+size_t RenderDevice::getImageCacheBytes() const {
+	return cache.getTotalBytes();
+}
+
+void RenderDevice::pinImage(Image *image) {
+	if (!image || image->pin_counter++ > 0)
+		return;
+
+	RenderImageCache::Entry *entry = cache.find(image);
+	if (entry)
+		cache.setBytes(entry, 0);
+}
+
+void RenderDevice::unpinImage(Image *image) {
+	if (!image || image->pin_counter == 0 || --image->pin_counter > 0)
+		return;
+
+	RenderImageCache::Entry *entry = cache.find(image);
+	if (entry) {
+		cache.setBytes(entry, getCacheBytes(image));
+		cache.trim(static_cast<size_t>(TEXTURE_CACHE_MB) * 1024 * 1024);
+	}
+}
+
+void RenderDevice::getMemoryUsage(MemoryUsage& usage) const {
+	for (RenderImageCache::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+		usage.add(it->first, it->second.bytes);
+	}
+	atlas.getMemoryUsage(usage);
+}
+
+SDL_Surface* RenderDevice::decodeImage(const std::string& filename, std::string& error) {
+	return decoder.take(filename, locateImage(filename), error);
+}
+
+bool RenderDevice::isLowResImage(const std::string& filename) {
+	if (!LOW_RES_IMAGES || !allow_low_res_images)
+		return false;
+
+	std::string low_res = getLowResFilename(filename);
+	return !low_res.empty() && !mods->locate(low_res).empty();
+}
+
+std::string RenderDevice::locateImage(const std::string& filename) {
+	if (isLowResImage(filename))
+		return mods->locate(getLowResFilename(filename));
+
+	return mods->locate(filename);
+}
+
+/**
+ * "images/a.png" becomes "images/a.half.png"
+ */
+std::string RenderDevice::getLowResFilename(const std::string& filename) {
+	size_t ext = filename.rfind('.');
+	if (ext == std::string::npos || filename.find('/', ext) != std::string::npos)
+		return "";
+
+	return filename.substr(0, ext) + LOW_RES_IMAGE_SUFFIX + filename.substr(ext);
 }
 
 Image * RenderDevice::cacheLookup(const std::string &filename) {
-	IMAGE_CACHE_CONTAINER_ITER it;
-	it = cache.find(filename);
-	if (it != cache.end()) {
-		it->second->ref();
-		return it->second;
+	RenderImageCache::Entry *entry = cache.get(filename);
+	if (entry) {
+		entry->resource->ref();
+		return entry->resource;
 	}
 	return NULL;
 }
 
 void RenderDevice::cacheStore(const std::string &filename, Image *image) {
 	if (image == NULL) return;
-	cache[filename] = image;
+
+	// the cache keeps its own reference, so the image outlives its last user
+	image->ref();
+	cache.add(filename, image, getCacheBytes(image));
+	cache.trim(static_cast<size_t>(TEXTURE_CACHE_MB) * 1024 * 1024);
+}
+
+size_t RenderDevice::getCacheBytes(Image *image) {
+	if (image->pin_counter > 0)
+		return 0;
+	return static_cast<size_t>(image->getWidth()) * static_cast<size_t>(image->getHeight()) * 4;
 }
 
 void RenderDevice::cacheRemove(Image *image) {
-	IMAGE_CACHE_CONTAINER_ITER it = cache.begin();
-	while (it != cache.end()) {
-		if (it->second == image)
-			break;
-		++it;
-	}
+	cache.forget(image);
+}
 
-	if (it != cache.end()) {
-		cache.erase(it);
-	}
+void RenderDevice::cacheRemove(const std::string &filename) {
+	cache.remove(filename);
 }
 
 void RenderDevice::cacheRemoveAll() {
-	IMAGE_CACHE_CONTAINER_ITER it = cache.begin();
+	// decoded surfaces that were never loaded would otherwise outlive the context
+	decoder.clear();
+	atlas.clear();
 
-	while (it != cache.end()) {
-		cacheRemove(it->second);
-		it = cache.begin();
-	}
+	cache.clear();
 }
 
 bool RenderDevice::localToGlobal(Sprite *r) {
@@ -274,6 +410,17 @@ bool RenderDevice::localToGlobal(Sprite *r) {
 	m_dest.x = left + r->local_frame.x;
 	m_dest.y = up + r->local_frame.y;
 
+	// scaled sprites are only used for whole images, which aren't clipped to a local frame
+	const Point scaled = r->getScaledSize();
+	if (scaled.x > 0 && scaled.y > 0 && !r->local_frame.w && !r->local_frame.h) {
+		m_dest.w = scaled.x;
+		m_dest.h = scaled.y;
+	}
+	else {
+		m_dest.w = m_clip.w;
+		m_dest.h = m_clip.h;
+	}
+
 	return true;
 }
 
@@ -286,9 +433,242 @@ bool RenderDevice::reloadGraphics() {
 	return false;
 }
 
+/**
+ * Devices that draw to surfaces in memory have nothing to restore
+ */
+void RenderDevice::restoreContext(bool) {
+}
+
+bool RenderDevice::lostRenderTargets() {
+	if (lost_render_targets) {
+		lost_render_targets = false;
+		return true;
+	}
+
+	return false;
+}
+
+void RenderDevice::restoreRenderTargets() {
+	atlas.restore();
+	lost_render_targets = true;
+}
+
+Sprite* RenderDevice::createScaledSprite(Image *image, int width, int height) {
+	if (!image || width <= 0 || height <= 0)
+		return NULL;
+
+	if (allow_scaled_sprites) {
+		Sprite *sprite = image->createSprite();
+		if (width != image->getWidth() || height != image->getHeight())
+			sprite->setScaledSize(width, height);
+		return sprite;
+	}
+
+	// resize() releases a reference to the image it is called on, so counter that here
+	image->ref();
+	Image *resized = image->resize(width, height);
+	if (!resized) {
+		image->unref();
+		return NULL;
+	}
+
+	Sprite *sprite = resized->createSprite();
+	resized->unref();
+	return sprite;
+}
+
 void RenderDevice::freeImage(Image *image) {
 	if (!image) return;
 
 	cacheRemove(image);
 }
 
+
+void RenderDevice::updateWorldScale(float frame_seconds, float target_seconds) {
+	const float max_scale = std::max(WORLD_SCALE_MIN, std::min(RENDER_SCALE, 1.f));
+
+	if (!DYNAMIC_RENDER_SCALE) {
+		world_scale = max_scale;
+		return;
+	}
+
+	const float min_scale = std::max(WORLD_SCALE_MIN, std::min(RENDER_SCALE_MIN, max_scale));
+	world_scale = std::max(min_scale, std::min(world_scale, max_scale));
+
+	// very long frames are loading screens, not slow rendering
+	if (frame_seconds > target_seconds * 4)
+		return;
+
+	if (world_frame_avg == 0)
+		world_frame_avg = frame_seconds;
+	else
+		world_frame_avg = world_frame_avg * 0.9f + frame_seconds * 0.1f;
+
+	if (world_scale_hold > 0) {
+		world_scale_hold--;
+		return;
+	}
+
+	if (world_frame_avg > target_seconds * WORLD_SCALE_SLOW) {
+		if (world_scale > min_scale) {
+			world_scale = std::max(min_scale, world_scale - WORLD_SCALE_STEP);
+			world_scale_hold = WORLD_SCALE_HOLD;
+			world_frame_avg = target_seconds;
+		}
+		world_scale_probe = 0;
+	}
+	else if (world_scale < max_scale && (world_frame_avg < target_seconds * WORLD_SCALE_FAST || ++world_scale_probe >= WORLD_SCALE_PROBE)) {
+		world_scale = std::min(max_scale, world_scale + WORLD_SCALE_STEP);
+		world_scale_hold = WORLD_SCALE_HOLD;
+		world_frame_avg = target_seconds;
+		world_scale_probe = 0;
+	}
+}
+
+float RenderDevice::getWorldScale() const {
+	return world_scale;
+}
+
+void RenderDevice::beginBatch() {
+	drawBatch();
+	batching = true;
+}
+
+int RenderDevice::submit(Sprite* r) {
+	if (!batching) {
+		draw_count++;
+		batch_count++;
+		return render(r);
+	}
+
+	if (r == NULL || !localToGlobal(r))
+		return -1;
+
+	RenderBatchItem item;
+	item.image = r->getGraphics();
+	item.src = m_clip;
+	item.dest = m_dest;
+
+	// the image must stay alive until the batch is drawn
+	item.image->ref();
+	batch.push_back(item);
+	return 0;
+}
+
+int RenderDevice::submit(Renderable& r, Rect& dest) {
+	if (!batching) {
+		draw_count++;
+		batch_count++;
+		return render(r, dest);
+	}
+
+	if (r.image == NULL)
+		return -1;
+
+	dest.w = r.src.w;
+	dest.h = r.src.h;
+
+	RenderBatchItem item;
+	item.image = r.image;
+	item.src = r.src;
+	item.dest = dest;
+	item.use_mods = true;
+	item.blend_mode = r.blend_mode;
+	item.color_mod = r.color_mod;
+	item.alpha_mod = r.alpha_mod;
+
+	item.image->ref();
+	batch.push_back(item);
+	return 0;
+}
+
+int RenderDevice::submit(Image* image, const Rect& src, const Point& dest) {
+	if (image == NULL)
+		return -1;
+
+	RenderBatchItem item;
+	item.image = image;
+	item.src = src;
+	item.dest.x = dest.x;
+	item.dest.y = dest.y;
+	item.dest.w = src.w;
+	item.dest.h = src.h;
+
+	item.image->ref();
+	batch.push_back(item);
+
+	// outside of a batch, the item is drawn on its own right away
+	if (!batching)
+		drawBatch();
+	return 0;
+}
+
+void RenderDevice::flushBatch() {
+	drawBatch();
+	batching = false;
+}
+
+
+static bool batchRectsOverlap(const Rect& a, const Rect& b) {
+	return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+void RenderDevice::drawBatch() {
+	if (batch.empty())
+		return;
+
+	// take ownership of the queue, in case drawing causes another flush
+	std::vector<RenderBatchItem> items;
+	items.swap(batch);
+
+	// How many groups back an item can be moved to join a group with the same state.
+	// Each step back requires that the item doesn't overlap anything it would be moved in front of.
+	const size_t SEARCH_DEPTH = 8;
+
+	std::vector<std::vector<size_t> > groups;
+	std::vector<Rect> bounds;
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		size_t target = groups.size();
+
+		for (size_t g = groups.size(); g > 0 && groups.size() - g < SEARCH_DEPTH; --g) {
+			if (items[groups[g-1][0]].sameState(items[i])) {
+				target = g-1;
+				break;
+			}
+			if (batchRectsOverlap(bounds[g-1], items[i].dest))
+				break;
+		}
+
+		if (target == groups.size()) {
+			groups.push_back(std::vector<size_t>());
+			bounds.push_back(items[i].dest);
+		}
+		else {
+			Rect &b = bounds[target];
+			int right = std::max(b.x + b.w, items[i].dest.x + items[i].dest.w);
+			int bottom = std::max(b.y + b.h, items[i].dest.y + items[i].dest.h);
+			b.x = std::min(b.x, items[i].dest.x);
+			b.y = std::min(b.y, items[i].dest.y);
+			b.w = right - b.x;
+			b.h = bottom - b.y;
+		}
+		groups[target].push_back(i);
+	}
+
+	std::vector<RenderBatchItem> sorted;
+	sorted.reserve(items.size());
+	for (size_t g = 0; g < groups.size(); ++g) {
+		for (size_t i = 0; i < groups[g].size(); ++i) {
+			sorted.push_back(items[groups[g][i]]);
+		}
+	}
+
+	draw_count += sorted.size();
+	batch_count += groups.size();
+	renderBatch(sorted);
+
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		sorted[i].image->unref();
+	}
+}
@@ -23,9 +23,13 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <vector>
 #include <map>
+#include "ImageDecoder.h"
+#include "ResourceCache.h"
+#include "TextureAtlas.h"
 #include "Utils.h"
 
 class Image;
+class MemoryUsage;
 class RenderDevice;
 class FontStyle;
 
@@ -78,6 +82,10 @@ public:
 	FPoint getDest();
 	int getGraphicsWidth();
 	int getGraphicsHeight();
+
+	// draws the clip at this size instead of its own; only devices that can scale while drawing honor it (see RenderDevice::createScaledSprite())
+	void setScaledSize(int w, int h);
+	Point getScaledSize();
 private:
 	explicit Sprite(Image *);
 	friend class Image;
@@ -88,6 +96,7 @@ protected:
 	Rect src; // location on the sprite in pixel coordinates.
 	Point offset;      // offset from map_pos to topleft corner of sprite
 	FPoint dest;
+	Point scaled_size; // 0 draws at the size of src
 };
 
 /** An image representation
@@ -125,6 +134,9 @@ public:
 	virtual void drawPixel(int x, int y, const Color& color) = 0;
 	virtual Image* resize(int width, int height) = 0;
 
+	/* Replaces the pixels in area. pixels are ARGB8888, with pitch pixels per row */
+	virtual void setPixels(const Rect& area, const uint32_t* pixels, int pitch) = 0;
+
 	class Sprite *createSprite(bool clipToSize = true);
 
 private:
@@ -132,10 +144,13 @@ private:
 	virtual ~Image();
 	friend class SDLSoftwareImage;
 	friend class SDLHardwareImage;
+	friend class NullImage;
+	friend class RenderDevice;
 
 private:
 	RenderDevice *device;
 	uint32_t ref_counter;
+	uint32_t pin_counter;
 };
 
 struct Renderable {
@@ -164,6 +179,59 @@ public:
 };
 
 
+/** A queued draw call
+ *
+ * Items are stored in screen coordinates. Sprites are drawn without changing
+ * the blend state of their image, so use_mods is false for them.
+ */
+class RenderBatchItem {
+public:
+	Image *image;
+	Rect src;
+	Rect dest;
+	bool use_mods;
+	uint8_t blend_mode;
+	Color color_mod;
+	uint8_t alpha_mod;
+
+	RenderBatchItem()
+		: image(NULL)
+		, use_mods(false)
+		, blend_mode(RENDERABLE_BLEND_NORMAL)
+		, color_mod(255, 255, 255)
+		, alpha_mod(255) {
+	}
+
+	bool sameState(const RenderBatchItem& other) const;
+};
+
+// low resolution copies of images are named "name.half.png", and are this much smaller than the original
+const std::string LOW_RES_IMAGE_SUFFIX = ".half";
+const float LOW_RES_IMAGE_SCALE = 0.5f;
+
+// the world scale changes in steps of this size, and never goes below WORLD_SCALE_MIN
+const float WORLD_SCALE_STEP = 0.05f;
+const float WORLD_SCALE_MIN = 0.25f;
+
+// the scale is lowered when frames take this much longer than they should, on average
+const float WORLD_SCALE_SLOW = 1.2f;
+// and raised when they take this much of the time they should
+const float WORLD_SCALE_FAST = 0.75f;
+// after a change, the scale stays for this many frames
+const int WORLD_SCALE_HOLD = 30;
+// a higher scale is tried after this many frames, since vsync can hide that frames would be fast enough
+const int WORLD_SCALE_PROBE = 300;
+
+/** Loaded images by filename
+ *
+ * The cache holds its own reference to each image, so an image is unused
+ * when that is the only reference left.
+ */
+class RenderImageCache : public ResourceCache<std::string, Image*> {
+protected:
+	bool isIdle(const Entry& entry) const;
+	void freeResource(Image *image);
+};
 
 /** Provide abstract interface for FLARE engine rendering devices.
  *
@@ -202,10 +270,54 @@ public:
 	virtual Image *createImage(int width, int height) = 0;
 	void freeImage(Image *image);
 
+	/* Returns a sprite that draws all of image at width by height. Devices that can scale while drawing use image as it is,
+	 * the others get a resized copy. The caller keeps its own reference to image either way.
+	 */
+	Sprite* createScaledSprite(Image *image, int width, int height);
+
+	/* Starts decoding an image in the background, so that a later loadImage() of it is quicker.
+	 * Requesting several images before loading any of them lets them decode in parallel.
+	 */
+	void requestImage(const std::string& filename);
+
+	/* Returns true while a requested image is still being decoded, so that loading it would have to wait */
+	bool isImagePending(const std::string& filename);
+
+	/* Waits for the background decoder and drops the images it hasn't handed over yet.
+	 * The decoder opens files through mods, so this must be called before mods is replaced.
+	 */
+	void cancelImageRequests();
+
+	/* Like loadImage(), but small images may be packed into a shared atlas page.
+	 * bounds is set to the area of the file within the returned image, which must be treated as read-only.
+	 */
+	Image *loadAtlasImage(const std::string& filename, Rect& bounds,
+						  const std::string& errormessage = "Couldn't load image",
+						  bool IfNotFoundExit = false);
+
+	/* Unused images stay cached until TEXTURE_CACHE_MB is reached. This frees all of them now,
+	 * e.g. when the mod list changes and the same filenames refer to different files.
+	 */
+	void freeUnusedImages();
+
+	/* A pinned image isn't counted against TEXTURE_CACHE_MB, because its owner already counts it
+	 * against a budget of its own, like the sprite-sheet of a cached AnimationSet. Calls must be paired.
+	 */
+	void pinImage(Image *image);
+	void unpinImage(Image *image);
+
+	/* Size of the cached images, in bytes */
+	size_t getImageCacheBytes() const;
+
+	/* Adds every cached image and atlas page to usage */
+	void getMemoryUsage(MemoryUsage& usage) const;
+
 	/** Screen operations */
 	virtual int render(Sprite* r) = 0;
 	virtual int render(Renderable& r, Rect& dest) = 0;
 	virtual int renderToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest) = 0;
+	// like renderToImage(), but replaces the destination pixels instead of blending with them
+	virtual int copyToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest) = 0;
 	virtual int renderText(FontStyle *font_style, const std::string& text, const Color& color, Rect& dest) = 0;
 	virtual Image* renderTextToImage(FontStyle* font_style, const std::string& text, const Color& color, bool blended = true) = 0;
 	virtual void blankScreen() = 0;
@@ -214,9 +326,60 @@ public:
 	virtual void drawRectangle(const Point& p0, const Point& p1, const Color& color) = 0;
 	virtual void windowResize() = 0;
 
+	/* Redirects screen drawing to an image made by createImage(), with the same coordinates as the screen.
+	 * Passing NULL draws to the screen again.
+	 */
+	virtual void setRenderTarget(Image* image) = 0;
+
+	/* Returns the display refresh rate that commitFrame() waits for, or 0 if it doesn't wait for vsync */
+	virtual int getVsyncRate() = 0;
+
+	/* Draws between these two calls make up the map, and may be rendered at a lower resolution
+	 * (see getWorldScale()) and then scaled up to the view. Everything else stays at full resolution.
+	 */
+	virtual void beginWorld() = 0;
+	virtual void endWorld() = 0;
+
+	/* Adapts the world scale to how long the last frame took, if the dynamic render scale is enabled */
+	void updateWorldScale(float frame_seconds, float target_seconds);
+	float getWorldScale() const;
+
 	bool reloadGraphics();
 
+	/* Called when the renderer lost its textures (device_lost) or only what was drawn into its render targets,
+	 * e.g. when a mobile app comes back from the background. Loaded images come back as they were, while
+	 * render targets come back blank, and lostRenderTargets() returns true once so the game can draw them again.
+	 */
+	virtual void restoreContext(bool device_lost);
+	bool lostRenderTargets();
+
+	/** Batch operations
+	 *
+	 * Between beginBatch() and flushBatch(), calls to submit() are queued and
+	 * drawn in groups that share the same image and blend state. Draws are only
+	 * reordered when they don't overlap, so the result is the same as calling
+	 * render() directly. Any other drawing operation flushes the queue first.
+	 * Outside of a batch, submit() is the same as render().
+	 */
+	void beginBatch();
+	int submit(Sprite* r);
+	int submit(Renderable& r, Rect& dest);
+
+	// draws the src area of image with its top left corner at dest, for images without a Sprite of their own
+	int submit(Image* image, const Rect& src, const Point& dest);
+	void flushBatch();
+
+	/* Draws any queued items without ending the batch */
+	void drawBatch();
+
+	// running totals of the items drawn through submit(), and of the groups they were drawn in
+	unsigned long getDrawCount() const { return draw_count; }
+	unsigned long getBatchCount() const { return batch_count; }
+
 protected:
+	/* Draws items that have been grouped by drawBatch() */
+	virtual void renderBatch(std::vector<RenderBatchItem>& items) = 0;
+
 	/* Compute clipping and global position from local frame. */
 	bool localToGlobal(Sprite *r);
 
@@ -224,8 +387,21 @@ protected:
 	Image *cacheLookup(const std::string &filename);
 	void cacheStore(const std::string &filename, Image *);
 	void cacheRemove(Image *image);
+	void cacheRemove(const std::string &filename);
 	void cacheRemoveAll();
 
+	/* Size an image counts against TEXTURE_CACHE_MB, which is 0 while it is pinned */
+	size_t getCacheBytes(Image *image);
+
+	/* Decodes an image file, collecting it from the background decoder if it was requested */
+	SDL_Surface* decodeImage(const std::string& filename, std::string& error);
+
+	/* Returns true if decodeImage() picks the low resolution copy of this image */
+	bool isLowResImage(const std::string& filename);
+
+	/* Draws the packed atlas images into their pages again, and flags the other render targets as lost */
+	void restoreRenderTargets();
+
 	bool fullscreen;
 	bool hwsurface;
 	bool vsync;
@@ -234,6 +410,18 @@ protected:
 
 	bool is_initialized;
 	bool reload_graphics;
+	bool lost_render_targets;
+
+	// set by devices that can draw a low resolution image at the size of the original
+	bool allow_low_res_images;
+
+	// set by devices that draw sprites at their scaled size, instead of needing a resized copy of the image
+	bool allow_scaled_sprites;
+
+	float world_scale;
+	float world_frame_avg;
+	int world_scale_hold;
+	int world_scale_probe;
 
 	Rect m_clip;
 	Rect m_dest;
@@ -244,12 +432,22 @@ protected:
 	uint16_t gamma_b[256];
 
 private:
-	typedef std::map<std::string, Image *> IMAGE_CACHE_CONTAINER;
-	typedef IMAGE_CACHE_CONTAINER::iterator IMAGE_CACHE_CONTAINER_ITER;
+	friend class TextureAtlas;
 
-	IMAGE_CACHE_CONTAINER cache;
+	RenderImageCache cache;
+
+	ImageDecoder decoder;
+	TextureAtlas atlas;
+
+	bool batching;
+	std::vector<RenderBatchItem> batch;
+	unsigned long draw_count;
+	unsigned long batch_count;
 
 	virtual void drawLine(int x0, int y0, int x1, int y1, const Color& color) = 0;
+
+	std::string locateImage(const std::string& filename);
+	std::string getLowResFilename(const std::string& filename);
 };
 
 #endif // RENDERDEVICE_H
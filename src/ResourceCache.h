@@ -0,0 +1,192 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class ResourceCache
+ *
+ * Keeps loaded resources by key, along with the number of users and an
+ * estimate of their size. Resources without users are not freed right away;
+ * they stay cached until the total size goes over budget, and then the least
+ * recently used of them are evicted first.
+ *
+ * Subclasses decide how a resource is freed, and may override when it's idle.
+ */
+
+#ifndef RESOURCE_CACHE_H
+#define RESOURCE_CACHE_H
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+template <class T>
+class ResourceCacheEntry {
+public:
+	T resource;
+	int refs;
+	size_t bytes;
+	unsigned long last_used;
+
+	ResourceCacheEntry()
+		: resource()
+		, refs(0)
+		, bytes(0)
+		, last_used(0) {
+	}
+};
+
+template <class Key, class T>
+class ResourceCache {
+public:
+	typedef ResourceCacheEntry<T> Entry;
+	typedef std::map<Key, Entry> EntryMap;
+	typedef typename EntryMap::iterator iterator;
+	typedef typename EntryMap::const_iterator const_iterator;
+
+	ResourceCache()
+		: total_bytes(0)
+		, clock(0) {
+	}
+
+	virtual ~ResourceCache() {
+	}
+
+	// returns the entry for key and marks it as used, or NULL if it isn't cached
+	Entry* get(const Key& key) {
+		iterator it = entries.find(key);
+		if (it == entries.end())
+			return NULL;
+
+		it->second.last_used = ++clock;
+		return &it->second;
+	}
+
+	// adds key if it isn't cached yet; returns its entry either way
+	Entry* add(const Key& key, T resource, size_t bytes) {
+		iterator it = entries.find(key);
+		if (it == entries.end()) {
+			it = entries.insert(std::pair<Key, Entry>(key, Entry())).first;
+			it->second.resource = resource;
+			it->second.bytes = bytes;
+			total_bytes += bytes;
+		}
+
+		it->second.last_used = ++clock;
+		return &it->second;
+	}
+
+	// returns the entry holding resource, or NULL if it isn't cached
+	Entry* find(T resource) {
+		for (iterator it = entries.begin(); it != entries.end(); ++it) {
+			if (it->second.resource == resource)
+				return &it->second;
+		}
+		return NULL;
+	}
+
+	void setBytes(Entry* entry, size_t bytes) {
+		total_bytes = total_bytes - entry->bytes + bytes;
+		entry->bytes = bytes;
+	}
+
+	// returns false if key isn't cached
+	bool ref(const Key& key) {
+		Entry *entry = get(key);
+		if (!entry)
+			return false;
+
+		++entry->refs;
+		return true;
+	}
+
+	// Drops a reference. The resource stays cached until it is evicted by trim().
+	bool unref(const Key& key) {
+		Entry *entry = get(key);
+		if (!entry)
+			return false;
+
+		--entry->refs;
+		return true;
+	}
+
+	// frees idle resources, least recently used first, until the total size fits in budget
+	void trim(size_t budget) {
+		if (total_bytes <= budget)
+			return;
+
+		std::vector<std::pair<unsigned long, Key> > idle;
+		for (iterator it = entries.begin(); it != entries.end(); ++it) {
+			if (isIdle(it->second))
+				idle.push_back(std::pair<unsigned long, Key>(it->second.last_used, it->first));
+		}
+		std::sort(idle.begin(), idle.end());
+
+		for (size_t i = 0; i < idle.size() && total_bytes > budget; ++i) {
+			remove(idle[i].second);
+		}
+	}
+
+	// frees the resource of key right away, regardless of its users
+	void remove(const Key& key) {
+		iterator it = entries.find(key);
+		if (it == entries.end())
+			return;
+
+		// erase before freeing, in case freeing the resource calls back into the cache
+		T resource = it->second.resource;
+		total_bytes -= it->second.bytes;
+		entries.erase(it);
+		freeResource(resource);
+	}
+
+	// forgets resource without freeing it
+	void forget(T resource) {
+		for (iterator it = entries.begin(); it != entries.end(); ++it) {
+			if (it->second.resource == resource) {
+				total_bytes -= it->second.bytes;
+				entries.erase(it);
+				return;
+			}
+		}
+	}
+
+	void clear() {
+		while (!entries.empty()) {
+			remove(entries.begin()->first);
+		}
+	}
+
+	bool empty() const { return entries.empty(); }
+	size_t getTotalBytes() const { return total_bytes; }
+
+	const_iterator begin() const { return entries.begin(); }
+	const_iterator end() const { return entries.end(); }
+
+protected:
+	virtual bool isIdle(const Entry& entry) const {
+		return entry.refs <= 0;
+	}
+
+	virtual void freeResource(T resource) = 0;
+
+private:
+	EntryMap entries;
+	size_t total_bytes;
+	unsigned long clock;
+};
+
+#endif // RESOURCE_CACHE_H
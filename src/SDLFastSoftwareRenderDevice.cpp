@@ -0,0 +1,603 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include <algorithm>
+
+#include <string.h>
+
+#include "SDLFastSoftwareRenderDevice.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FAST_BLIT_SSE2
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define FAST_BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+ * Pixels are ARGB8888, so in memory they are B, G, R, A on little endian machines.
+ * The scalar kernels only use shifts, which works on either byte order.
+ */
+static inline Uint32 packARGB(Uint32 r, Uint32 g, Uint32 b, Uint32 a) {
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// x / 255, rounded. Exact for x <= 255 * 255
+static inline Uint32 div255(Uint32 x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static bool isKernelSurface(SDL_Surface* surface) {
+	return surface && surface->format->format == SDL_PIXELFORMAT_ARGB8888 && !SDL_MUSTLOCK(surface);
+}
+
+// with render_16bit, the screen and the images without soft edges are RGB565
+static bool is565Surface(SDL_Surface* surface) {
+	return surface && surface->format->format == SDL_PIXELFORMAT_RGB565 && !SDL_MUSTLOCK(surface);
+}
+
+static inline Uint16 pack565(Uint32 r, Uint32 g, Uint32 b) {
+	return static_cast<Uint16>(((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3));
+}
+
+// the low bits are filled from the high ones, so that white stays white
+static inline void unpack565(Uint16 p, Uint32& r, Uint32& g, Uint32& b) {
+	r = (p >> 11) & 0x1f;
+	g = (p >> 5) & 0x3f;
+	b = p & 0x1f;
+	r = (r << 3) | (r >> 2);
+	g = (g << 2) | (g >> 4);
+	b = (b << 3) | (b >> 2);
+}
+
+/**
+ * The row kernels draw w pixels of src onto dest.
+ * mod is the color mod with the alpha mod in the alpha channel. It is skipped when it is 0xffffffff.
+ * i is the first pixel to draw, so that the SIMD versions can leave the remainder to the scalar ones.
+ */
+static void blendRowScalar(const Uint32* src, Uint32* dest, int i, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+
+	for (; i < w; ++i) {
+		const Uint32 s = src[i];
+		Uint32 a = s >> 24;
+		Uint32 r = (s >> 16) & 0xff;
+		Uint32 g = (s >> 8) & 0xff;
+		Uint32 b = s & 0xff;
+
+		if (modulate) {
+			a = div255(a * (mod >> 24));
+			r = div255(r * ((mod >> 16) & 0xff));
+			g = div255(g * ((mod >> 8) & 0xff));
+			b = div255(b * (mod & 0xff));
+		}
+
+		if (a == 0)
+			continue;
+
+		if (a == 255) {
+			dest[i] = packARGB(r, g, b, 255);
+			continue;
+		}
+
+		const Uint32 d = dest[i];
+		const Uint32 inv = 255 - a;
+		dest[i] = packARGB(div255(r * a + ((d >> 16) & 0xff) * inv),
+						   div255(g * a + ((d >> 8) & 0xff) * inv),
+						   div255(b * a + (d & 0xff) * inv),
+						   div255(255 * a + (d >> 24) * inv));
+	}
+}
+
+static void addRowScalar(const Uint32* src, Uint32* dest, int i, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+
+	for (; i < w; ++i) {
+		const Uint32 s = src[i];
+		Uint32 a = s >> 24;
+		Uint32 r = (s >> 16) & 0xff;
+		Uint32 g = (s >> 8) & 0xff;
+		Uint32 b = s & 0xff;
+
+		if (modulate) {
+			a = div255(a * (mod >> 24));
+			r = div255(r * ((mod >> 16) & 0xff));
+			g = div255(g * ((mod >> 8) & 0xff));
+			b = div255(b * (mod & 0xff));
+		}
+
+		if (a == 0)
+			continue;
+
+		const Uint32 d = dest[i];
+		dest[i] = packARGB(std::min(255u, ((d >> 16) & 0xff) + div255(r * a)),
+						   std::min(255u, ((d >> 8) & 0xff) + div255(g * a)),
+						   std::min(255u, (d & 0xff) + div255(b * a)),
+						   d >> 24);
+	}
+}
+
+/**
+ * The 16-bit kernels draw ARGB8888 images with soft edges, and RGB565 images, onto an RGB565 target.
+ * These are meant for low-end devices without SIMD, so there are only scalar versions.
+ */
+static void blendRowTo565(const Uint32* src, Uint16* dest, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+
+	for (int i = 0; i < w; ++i) {
+		const Uint32 s = src[i];
+		Uint32 a = s >> 24;
+		Uint32 r = (s >> 16) & 0xff;
+		Uint32 g = (s >> 8) & 0xff;
+		Uint32 b = s & 0xff;
+
+		if (modulate) {
+			a = div255(a * (mod >> 24));
+			r = div255(r * ((mod >> 16) & 0xff));
+			g = div255(g * ((mod >> 8) & 0xff));
+			b = div255(b * (mod & 0xff));
+		}
+
+		if (a == 0)
+			continue;
+
+		if (a == 255) {
+			dest[i] = pack565(r, g, b);
+			continue;
+		}
+
+		Uint32 dr, dg, db;
+		unpack565(dest[i], dr, dg, db);
+		const Uint32 inv = 255 - a;
+		dest[i] = pack565(div255(r * a + dr * inv), div255(g * a + dg * inv), div255(b * a + db * inv));
+	}
+}
+
+static void addRowTo565(const Uint32* src, Uint16* dest, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+
+	for (int i = 0; i < w; ++i) {
+		const Uint32 s = src[i];
+		Uint32 a = s >> 24;
+		Uint32 r = (s >> 16) & 0xff;
+		Uint32 g = (s >> 8) & 0xff;
+		Uint32 b = s & 0xff;
+
+		if (modulate) {
+			a = div255(a * (mod >> 24));
+			r = div255(r * ((mod >> 16) & 0xff));
+			g = div255(g * ((mod >> 8) & 0xff));
+			b = div255(b * (mod & 0xff));
+		}
+
+		if (a == 0)
+			continue;
+
+		Uint32 dr, dg, db;
+		unpack565(dest[i], dr, dg, db);
+		dest[i] = pack565(std::min(255u, dr + div255(r * a)), std::min(255u, dg + div255(g * a)), std::min(255u, db + div255(b * a)));
+	}
+}
+
+static void keyRow565(const Uint16* src, Uint16* dest, int w, Uint16 key) {
+	for (int i = 0; i < w; ++i) {
+		if (src[i] != key)
+			dest[i] = src[i];
+	}
+}
+
+#if defined(FAST_BLIT_SSE2)
+
+/**
+ * The SSE2 kernels work on 4 pixels at a time, split into two registers of
+ * 16 bit channels: B0 G0 R0 A0 B1 G1 R1 A1
+ */
+static inline __m128i div255SSE2(__m128i x) {
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static inline __m128i alphaSSE2(__m128i x) {
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static inline __m128i blendSSE2(__m128i s, __m128i d, bool modulate, __m128i mod) {
+	const __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	const __m128i alpha_full = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+	if (modulate)
+		s = div255SSE2(_mm_mullo_epi16(s, mod));
+
+	const __m128i a = alphaSSE2(s);
+	const __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+
+	// treating the source alpha as 255 gives a + dest_a * (1 - a) for the alpha channel
+	s = _mm_or_si128(_mm_and_si128(s, rgb_mask), alpha_full);
+	return div255SSE2(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inv)));
+}
+
+static inline __m128i addSSE2(__m128i s, bool modulate, __m128i mod) {
+	const __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+
+	if (modulate)
+		s = div255SSE2(_mm_mullo_epi16(s, mod));
+
+	// the alpha channel is 0 here, so the dest alpha is kept
+	return div255SSE2(_mm_mullo_epi16(_mm_and_si128(s, rgb_mask), alphaSSE2(s)));
+}
+
+static void blendRow(const Uint32* src, Uint32* dest, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000));
+	const __m128i mod16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(mod)), zero);
+
+	int i = 0;
+	for (; i + 4 <= w; i += 4) {
+		const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		const __m128i s_alpha = _mm_and_si128(s, alpha_mask);
+
+		// skip fully transparent pixels, and copy fully opaque ones
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, zero)) == 0xffff)
+			continue;
+		if (!modulate && _mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, alpha_mask)) == 0xffff) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), s);
+			continue;
+		}
+
+		const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+		const __m128i lo = blendSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), modulate, mod16);
+		const __m128i hi = blendSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), modulate, mod16);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packus_epi16(lo, hi));
+	}
+
+	blendRowScalar(src, dest, i, w, mod);
+}
+
+static void addRow(const Uint32* src, Uint32* dest, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000));
+	const __m128i mod16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(mod)), zero);
+
+	int i = 0;
+	for (; i + 4 <= w; i += 4) {
+		const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), zero)) == 0xffff)
+			continue;
+
+		const __m128i lo = addSSE2(_mm_unpacklo_epi8(s, zero), modulate, mod16);
+		const __m128i hi = addSSE2(_mm_unpackhi_epi8(s, zero), modulate, mod16);
+		const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_adds_epu8(d, _mm_packus_epi16(lo, hi)));
+	}
+
+	addRowScalar(src, dest, i, w, mod);
+}
+
+#elif defined(FAST_BLIT_NEON)
+
+/**
+ * The NEON kernels work on 8 pixels at a time, with each channel in its own register
+ */
+static inline uint8x8_t div255NEON(uint16x8_t x) {
+	return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+static inline void modulateNEON(uint8x8x4_t& s, Uint32 mod) {
+	s.val[0] = div255NEON(vmull_u8(s.val[0], vdup_n_u8(static_cast<uint8_t>(mod & 0xff))));
+	s.val[1] = div255NEON(vmull_u8(s.val[1], vdup_n_u8(static_cast<uint8_t>((mod >> 8) & 0xff))));
+	s.val[2] = div255NEON(vmull_u8(s.val[2], vdup_n_u8(static_cast<uint8_t>((mod >> 16) & 0xff))));
+	s.val[3] = div255NEON(vmull_u8(s.val[3], vdup_n_u8(static_cast<uint8_t>(mod >> 24))));
+}
+
+static void blendRow(const Uint32* src, Uint32* dest, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+
+	int i = 0;
+	for (; i + 8 <= w; i += 8) {
+		uint8x8x4_t s = vld4_u8(reinterpret_cast<const uint8_t*>(src + i));
+		uint8x8x4_t d = vld4_u8(reinterpret_cast<const uint8_t*>(dest + i));
+
+		if (modulate)
+			modulateNEON(s, mod);
+
+		const uint8x8_t a = s.val[3];
+		const uint8x8_t inv = vmvn_u8(a);
+		for (int c = 0; c < 3; ++c) {
+			d.val[c] = div255NEON(vmlal_u8(vmull_u8(s.val[c], a), d.val[c], inv));
+		}
+		d.val[3] = div255NEON(vmlal_u8(vmull_u8(vdup_n_u8(255), a), d.val[3], inv));
+
+		vst4_u8(reinterpret_cast<uint8_t*>(dest + i), d);
+	}
+
+	blendRowScalar(src, dest, i, w, mod);
+}
+
+static void addRow(const Uint32* src, Uint32* dest, int w, Uint32 mod) {
+	const bool modulate = (mod != 0xffffffff);
+
+	int i = 0;
+	for (; i + 8 <= w; i += 8) {
+		uint8x8x4_t s = vld4_u8(reinterpret_cast<const uint8_t*>(src + i));
+		uint8x8x4_t d = vld4_u8(reinterpret_cast<const uint8_t*>(dest + i));
+
+		if (modulate)
+			modulateNEON(s, mod);
+
+		for (int c = 0; c < 3; ++c) {
+			d.val[c] = vqadd_u8(d.val[c], div255NEON(vmull_u8(s.val[c], s.val[3])));
+		}
+
+		vst4_u8(reinterpret_cast<uint8_t*>(dest + i), d);
+	}
+
+	addRowScalar(src, dest, i, w, mod);
+}
+
+#else
+
+static void blendRow(const Uint32* src, Uint32* dest, int w, Uint32 mod) {
+	blendRowScalar(src, dest, 0, w, mod);
+}
+
+static void addRow(const Uint32* src, Uint32* dest, int w, Uint32 mod) {
+	addRowScalar(src, dest, 0, w, mod);
+}
+
+#endif
+
+/**
+ * Fills the inclusive rectangle (x0, y0) - (x1, y1), clipped to the clip rect of the surface
+ */
+static void fillRect(SDL_Surface* surface, int x0, int y0, int x1, int y1, Uint32 pixel) {
+	const SDL_Rect& clip = surface->clip_rect;
+	x0 = std::max(x0, static_cast<int>(clip.x));
+	y0 = std::max(y0, static_cast<int>(clip.y));
+	x1 = std::min(x1, clip.x + clip.w - 1);
+	y1 = std::min(y1, clip.y + clip.h - 1);
+
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	Uint8 *row = static_cast<Uint8*>(surface->pixels) + y0 * surface->pitch + x0 * 4;
+	for (int y = y0; y <= y1; ++y) {
+		std::fill_n(reinterpret_cast<Uint32*>(row), x1 - x0 + 1, pixel);
+		row += surface->pitch;
+	}
+}
+
+SDLFastSoftwareRenderDevice::SDLFastSoftwareRenderDevice()
+	: SDLSoftwareRenderDevice() {
+#if defined(FAST_BLIT_SSE2)
+	logInfo("SDLFastSoftwareRenderDevice: Using SSE2 blitters.");
+#elif defined(FAST_BLIT_NEON)
+	logInfo("SDLFastSoftwareRenderDevice: Using NEON blitters.");
+#else
+	logInfo("SDLFastSoftwareRenderDevice: Using generic blitters.");
+#endif
+}
+
+int SDLFastSoftwareRenderDevice::blit(SDL_Surface* src_surface, const Rect& src, SDL_Surface* dest_surface, const Rect& dest, uint8_t blend_mode, const Color& color_mod, uint8_t alpha_mod) {
+	const Uint32 mod = packARGB(color_mod.r, color_mod.g, color_mod.b, alpha_mod);
+
+	enum { KERNEL_32, KERNEL_32_TO_16, KERNEL_16 } kernel;
+	if (isKernelSurface(src_surface) && isKernelSurface(dest_surface))
+		kernel = KERNEL_32;
+	else if (isKernelSurface(src_surface) && is565Surface(dest_surface))
+		kernel = KERNEL_32_TO_16;
+	else if (is565Surface(src_surface) && is565Surface(dest_surface) && blend_mode == RENDERABLE_BLEND_NORMAL && mod == 0xffffffff)
+		kernel = KERNEL_16; // RGB565 images are opaque apart from their color key, so there is nothing to blend
+	else
+		return -1;
+
+	// clip the same way as SDL_BlitSurface(): first to the source surface, then to the clip rect of the destination
+	int sx = src.x;
+	int sy = src.y;
+	int w = src.w;
+	int h = src.h;
+	int dx = dest.x;
+	int dy = dest.y;
+
+	if (sx < 0) {
+		w += sx;
+		dx -= sx;
+		sx = 0;
+	}
+	if (sy < 0) {
+		h += sy;
+		dy -= sy;
+		sy = 0;
+	}
+	w = std::min(w, src_surface->w - sx);
+	h = std::min(h, src_surface->h - sy);
+
+	const SDL_Rect& clip = dest_surface->clip_rect;
+	if (dx < clip.x) {
+		w -= clip.x - dx;
+		sx += clip.x - dx;
+		dx = clip.x;
+	}
+	if (dy < clip.y) {
+		h -= clip.y - dy;
+		sy += clip.y - dy;
+		dy = clip.y;
+	}
+	w = std::min(w, clip.x + clip.w - dx);
+	h = std::min(h, clip.y + clip.h - dy);
+
+	if (w <= 0 || h <= 0)
+		return 0;
+
+	const int src_bpp = src_surface->format->BytesPerPixel;
+	const int dest_bpp = dest_surface->format->BytesPerPixel;
+	const Uint8 *src_row = static_cast<const Uint8*>(src_surface->pixels) + sy * src_surface->pitch + sx * src_bpp;
+	Uint8 *dest_row = static_cast<Uint8*>(dest_surface->pixels) + dy * dest_surface->pitch + dx * dest_bpp;
+
+	Uint32 key = 0;
+	const bool keyed = (kernel == KERNEL_16 && SDL_GetColorKey(src_surface, &key) == 0);
+
+	for (int y = 0; y < h; ++y) {
+		if (kernel == KERNEL_32) {
+			if (blend_mode == RENDERABLE_BLEND_ADD)
+				addRow(reinterpret_cast<const Uint32*>(src_row), reinterpret_cast<Uint32*>(dest_row), w, mod);
+			else // RENDERABLE_BLEND_NORMAL
+				blendRow(reinterpret_cast<const Uint32*>(src_row), reinterpret_cast<Uint32*>(dest_row), w, mod);
+		}
+		else if (kernel == KERNEL_32_TO_16) {
+			if (blend_mode == RENDERABLE_BLEND_ADD)
+				addRowTo565(reinterpret_cast<const Uint32*>(src_row), reinterpret_cast<Uint16*>(dest_row), w, mod);
+			else // RENDERABLE_BLEND_NORMAL
+				blendRowTo565(reinterpret_cast<const Uint32*>(src_row), reinterpret_cast<Uint16*>(dest_row), w, mod);
+		}
+		else if (keyed) {
+			keyRow565(reinterpret_cast<const Uint16*>(src_row), reinterpret_cast<Uint16*>(dest_row), w, static_cast<Uint16>(key));
+		}
+		else {
+			memcpy(dest_row, src_row, static_cast<size_t>(w) * 2);
+		}
+
+		src_row += src_surface->pitch;
+		dest_row += dest_surface->pitch;
+	}
+
+	SDL_Rect rect = {dx, dy, w, h};
+	addDamage(dest_surface, rect);
+
+	return 0;
+}
+
+int SDLFastSoftwareRenderDevice::blitSurface(SDL_Surface* src_surface, const Rect& src, SDL_Surface* dest_surface, const Rect& dest) {
+	SDL_BlendMode blend_mode;
+	SDL_GetSurfaceBlendMode(src_surface, &blend_mode);
+
+	// RGB565 images have no alpha, so not blending them is the same as blending them
+	if (blend_mode == SDL_BLENDMODE_BLEND || blend_mode == SDL_BLENDMODE_ADD || (blend_mode == SDL_BLENDMODE_NONE && is565Surface(src_surface))) {
+		Color color_mod;
+		Uint8 alpha_mod;
+		SDL_GetSurfaceColorMod(src_surface, &color_mod.r, &color_mod.g, &color_mod.b);
+		SDL_GetSurfaceAlphaMod(src_surface, &alpha_mod);
+
+		uint8_t mode = (blend_mode == SDL_BLENDMODE_ADD ? RENDERABLE_BLEND_ADD : RENDERABLE_BLEND_NORMAL);
+		if (blit(src_surface, src, dest_surface, dest, mode, color_mod, alpha_mod) == 0)
+			return 0;
+	}
+
+	SDL_Rect _src = src;
+	SDL_Rect _dest = dest;
+	return SDL_BlitSurface(src_surface, &_src, dest_surface, &_dest);
+}
+
+int SDLFastSoftwareRenderDevice::render(Renderable& r, Rect& dest) {
+	drawBatch();
+
+	SDL_Surface *surface = static_cast<SDLSoftwareImage *>(r.image)->surface;
+	if (blit(surface, r.src, currentTarget(), dest, r.blend_mode, r.color_mod, r.alpha_mod) == 0)
+		return 0;
+
+	return SDLSoftwareRenderDevice::render(r, dest);
+}
+
+int SDLFastSoftwareRenderDevice::render(Sprite *r) {
+	drawBatch();
+
+	if (r == NULL) {
+		return -1;
+	}
+
+	if ( !localToGlobal(r) ) {
+		return -1;
+	}
+
+	return blitSurface(static_cast<SDLSoftwareImage *>(r->getGraphics())->surface, m_clip, currentTarget(), m_dest);
+}
+
+void SDLFastSoftwareRenderDevice::renderBatch(std::vector<RenderBatchItem>& items) {
+	SDL_Surface *target = currentTarget();
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		RenderBatchItem &item = items[i];
+		SDL_Surface *surface = static_cast<SDLSoftwareImage *>(item.image)->surface;
+
+		if (!item.use_mods) {
+			blitSurface(surface, item.src, target, item.dest);
+		}
+		else if (blit(surface, item.src, target, item.dest, item.blend_mode, item.color_mod, item.alpha_mod) != 0) {
+			if (item.blend_mode == RENDERABLE_BLEND_ADD) {
+				SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_ADD);
+			}
+			else { // RENDERABLE_BLEND_NORMAL
+				SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_BLEND);
+			}
+
+			SDL_SetSurfaceColorMod(surface, item.color_mod.r, item.color_mod.g, item.color_mod.b);
+			SDL_SetSurfaceAlphaMod(surface, item.alpha_mod);
+
+			SDL_Rect src = item.src;
+			SDL_Rect dest = item.dest;
+			SDL_BlitSurface(surface, &src, target, &dest);
+		}
+	}
+}
+
+void SDLFastSoftwareRenderDevice::drawPixel(int x, int y, const Color& color) {
+	SDL_Surface *target = currentTarget();
+	if (!isKernelSurface(target)) {
+		SDLSoftwareRenderDevice::drawPixel(x, y, color);
+		return;
+	}
+
+	drawBatch();
+
+	if (x < 0 || y < 0 || x >= target->w || y >= target->h)
+		return;
+
+	Uint32 *p = reinterpret_cast<Uint32*>(static_cast<Uint8*>(target->pixels) + y * target->pitch) + x;
+	*p = packARGB(color.r, color.g, color.b, color.a);
+
+	SDL_Rect rect = {x, y, 1, 1};
+	addDamage(target, rect);
+}
+
+void SDLFastSoftwareRenderDevice::drawRectangle(const Point& p0, const Point& p1, const Color& color) {
+	SDL_Surface *target = currentTarget();
+	if (!isKernelSurface(target)) {
+		SDLSoftwareRenderDevice::drawRectangle(p0, p1, color);
+		return;
+	}
+
+	drawBatch();
+
+	const int x0 = std::min(p0.x, p1.x);
+	const int x1 = std::max(p0.x, p1.x);
+	const int y0 = std::min(p0.y, p1.y);
+	const int y1 = std::max(p0.y, p1.y);
+	const Uint32 pixel = packARGB(color.r, color.g, color.b, color.a);
+
+	fillRect(target, x0, y0, x1, y0, pixel);
+	fillRect(target, x0, y1, x1, y1, pixel);
+	fillRect(target, x0, y0, x0, y1, pixel);
+	fillRect(target, x1, y0, x1, y1, pixel);
+
+	SDL_Rect rect = {x0, y0, x1 - x0 + 1, y1 - y0 + 1};
+	addDamage(target, rect);
+}
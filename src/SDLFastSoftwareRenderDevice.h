@@ -0,0 +1,61 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#ifndef SDLFASTSOFTWARERENDERDEVICE_H
+#define SDLFASTSOFTWARERENDERDEVICE_H
+
+#include "SDLSoftwareRenderDevice.h"
+
+/** Software rendering device with its own blitters.
+ *
+ * All images of the software device are ARGB8888, so instead of going
+ * through SDL_BlitSurface() this device blends them with kernels written for
+ * that one layout. The color and alpha mods of a Renderable are passed to the
+ * kernels directly, rather than being set on the surface before every blit.
+ * SSE2 and NEON versions are used where the compiler provides them.
+ *
+ * With render_16bit, the screen is RGB565, and so are the images without soft
+ * edges. Those are copied to the screen row by row, skipping their color key,
+ * and the ARGB8888 images are blended onto it by scalar 16-bit kernels.
+ *
+ * Surfaces in any other format fall back to SDLSoftwareRenderDevice.
+ *
+ * @class SDLFastSoftwareRenderDevice
+ * @see SDLSoftwareRenderDevice
+ */
+class SDLFastSoftwareRenderDevice : public SDLSoftwareRenderDevice {
+public:
+	SDLFastSoftwareRenderDevice();
+
+	virtual int render(Renderable& r, Rect& dest);
+	virtual int render(Sprite* r);
+
+	void drawPixel(int x, int y, const Color& color);
+	void drawRectangle(const Point& p0, const Point& p1, const Color& color);
+
+protected:
+	void renderBatch(std::vector<RenderBatchItem>& items);
+
+private:
+	// returns -1 if the surfaces can't be drawn by the kernels
+	int blit(SDL_Surface* src_surface, const Rect& src, SDL_Surface* dest_surface, const Rect& dest, uint8_t blend_mode, const Color& color_mod, uint8_t alpha_mod);
+
+	// uses the blend state that is set on the surface, like SDL_BlitSurface()
+	int blitSurface(SDL_Surface* src_surface, const Rect& src, SDL_Surface* dest_surface, const Rect& dest);
+};
+
+#endif // SDLFASTSOFTWARERENDERDEVICE_H
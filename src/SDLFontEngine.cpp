@@ -29,7 +29,41 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Settings.h"
 #include "UtilsParsing.h"
 
-SDLFontStyle::SDLFontStyle() : FontStyle(), ttfont(NULL) {
+SDLFontStyle::SDLFontStyle() : FontStyle(), ttfont(NULL), glyph_row_height(0) {
+}
+
+/**
+ * Reads the UTF-8 character starting at text[pos]
+ * Returns the length of the character in bytes
+ */
+static size_t decodeUTF8(const std::string& text, size_t pos, Uint32& codepoint) {
+	const unsigned char c = static_cast<unsigned char>(text[pos]);
+	size_t len = 1;
+	codepoint = c;
+
+	if (c >= 0xF0) {
+		len = 4;
+		codepoint = c & 0x07;
+	}
+	else if (c >= 0xE0) {
+		len = 3;
+		codepoint = c & 0x0F;
+	}
+	else if (c >= 0xC0) {
+		len = 2;
+		codepoint = c & 0x1F;
+	}
+
+	if (pos + len > text.size()) {
+		codepoint = 0xFFFD;
+		return text.size() - pos;
+	}
+
+	for (size_t i = 1; i < len; ++i) {
+		codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[pos+i]) & 0x3F);
+	}
+
+	return len;
 }
 
 SDLFontEngine::SDLFontEngine() : FontEngine(), active_font(NULL) {
@@ -84,7 +118,7 @@ SDLFontEngine::SDLFontEngine() : FontEngine(), active_font(NULL) {
 					style->ptsize = popFirstInt(infile.val);
 					style->blend = toBool(popFirstString(infile.val));
 
-					style->ttfont = TTF_OpenFont(mods->locate("fonts/" + style->path).c_str(), style->ptsize);
+					style->ttfont = TTF_OpenFontRW(mods->openRW(mods->locate("fonts/" + style->path)), 1, style->ptsize);
 					if(style->ttfont == NULL) {
 						logError("FontEngine: TTF_OpenFont: %s", TTF_GetError());
 					}
@@ -206,6 +240,10 @@ void SDLFontEngine::setFont(const std::string& _font) {
 	}
 }
 
+const FontStyle* SDLFontEngine::getActiveFont() {
+	return active_font;
+}
+
 void SDLFontEngine::setFontFallback(const std::string& _font) {
 	for (unsigned int i=0; i<font_styles_fallback.size(); i++) {
 		if (font_styles_fallback[i].name == _font) {
@@ -226,32 +264,129 @@ bool SDLFontEngine::hasMissingGlyph(const std::string& text) {
 }
 
 /**
- * Render the given text at (x,y) on the target image.
- * Justify is left, right, or center
+ * Get a glyph from the style's glyph atlas
+ * The glyph is rasterized and packed into the atlas the first time it is used
  */
-void SDLFontEngine::renderInternal(const std::string& text, int x, int y, int justify, Image *target, const Color& color) {
-	Image *graphics;
+const SDLFontGlyph& SDLFontEngine::getGlyph(SDLFontStyle *style, const std::string& glyph_text, Uint32 codepoint, const Color& color, bool blended) {
+	Uint32 color_key = (blended ? 0x1000000 : 0) | (color.r << 16) | (color.g << 8) | color.b;
+	std::pair<Uint32, Uint32> key(codepoint, color_key);
 
-	Rect dest_rect = position(text, x, y, justify);
+	std::map<std::pair<Uint32, Uint32>, SDLFontGlyph>::iterator it = style->glyphs.find(key);
+	if (it != style->glyphs.end())
+		return it->second;
 
-	// Render text directly onto screen
-	if (!target) {
-		render_device->renderText(active_font, text, color, dest_rect);
-		return;
-	}
+	SDLFontGlyph glyph;
+	int h;
+	TTF_SizeUTF8(style->ttfont, glyph_text.c_str(), &glyph.advance, &h);
+
+	Image *graphics = NULL;
+	if (glyph_text != " ")
+		graphics = render_device->renderTextToImage(style, glyph_text, color, blended);
+
+	if (!graphics)
+		return style->glyphs[key] = glyph;
 
-	// Render text into target
-	graphics = render_device->renderTextToImage(active_font, text, color, active_font->blend);
 	Rect clip;
 	clip.w = graphics->getWidth();
 	clip.h = graphics->getHeight();
-	render_device->renderToImage(graphics, clip, target, dest_rect);
 
-	// text is cached, we can free temp resource
+	if (clip.w > 0 && clip.h > 0 && clip.w <= GLYPH_PAGE_SIZE && clip.h <= GLYPH_PAGE_SIZE) {
+		// shelf packing: fill rows left to right, then start a new row or page
+		if (style->glyph_cursor.x + clip.w > GLYPH_PAGE_SIZE) {
+			style->glyph_cursor.x = 0;
+			style->glyph_cursor.y += style->glyph_row_height;
+			style->glyph_row_height = 0;
+		}
+
+		if (style->glyph_pages.empty() || style->glyph_cursor.y + clip.h > GLYPH_PAGE_SIZE) {
+			if (style->glyph_pages.size() >= GLYPH_PAGE_MAX)
+				clearGlyphCache(style);
+
+			Image *page = render_device->createImage(GLYPH_PAGE_SIZE, GLYPH_PAGE_SIZE);
+			if (page)
+				style->glyph_pages.push_back(page);
+
+			style->glyph_cursor = Point();
+			style->glyph_row_height = 0;
+		}
+
+		if (!style->glyph_pages.empty()) {
+			glyph.page = style->glyph_pages.back();
+			glyph.src.x = style->glyph_cursor.x;
+			glyph.src.y = style->glyph_cursor.y;
+			render_device->copyToImage(graphics, clip, glyph.page, glyph.src);
+
+			style->glyph_cursor.x += clip.w;
+			style->glyph_row_height = std::max(style->glyph_row_height, clip.h);
+		}
+	}
+
+	// the glyph is in the atlas now, so we can free the temp resource
 	graphics->unref();
+
+	return style->glyphs[key] = glyph;
+}
+
+void SDLFontEngine::clearGlyphCache(SDLFontStyle *style) {
+	for (size_t i = 0; i < style->glyph_pages.size(); ++i) {
+		style->glyph_pages[i]->unref();
+	}
+	style->glyph_pages.clear();
+	style->glyphs.clear();
+	style->glyph_cursor = Point();
+	style->glyph_row_height = 0;
+}
+
+void SDLFontEngine::clearGlyphCache() {
+	for (size_t i = 0; i < font_styles.size(); ++i) {
+		clearGlyphCache(&font_styles[i]);
+	}
+	for (size_t i = 0; i < font_styles_fallback.size(); ++i) {
+		clearGlyphCache(&font_styles_fallback[i]);
+	}
+}
+
+/**
+ * Render the given text at (x,y) on the target image.
+ * Justify is left, right, or center
+ */
+void SDLFontEngine::renderInternal(const std::string& text, int x, int y, int justify, Image *target, const Color& color) {
+	Rect dest_rect = position(text, x, y, justify);
+
+	// text on the screen is always blended
+	bool blended = (target ? active_font->blend : true);
+
+	Renderable r;
+	size_t pos = 0;
+	while (pos < text.size()) {
+		Uint32 codepoint;
+		size_t len = decodeUTF8(text, pos, codepoint);
+		const SDLFontGlyph& glyph = getGlyph(active_font, text.substr(pos, len), codepoint, color, blended);
+		pos += len;
+
+		if (glyph.page) {
+			Rect dest;
+			dest.x = dest_rect.x;
+			dest.y = dest_rect.y;
+
+			if (!target) {
+				// glyphs share atlas pages, so the render device can batch them
+				r.image = glyph.page;
+				r.src = glyph.src;
+				render_device->submit(r, dest);
+			}
+			else {
+				Rect clip = glyph.src;
+				render_device->renderToImage(glyph.page, clip, target, dest);
+			}
+		}
+
+		dest_rect.x += glyph.advance;
+	}
 }
 
 SDLFontEngine::~SDLFontEngine() {
+	clearGlyphCache();
 	for (unsigned int i=0; i<font_styles.size(); ++i) TTF_CloseFont(font_styles[i].ttfont);
 	TTF_Quit();
 }
@@ -23,12 +23,41 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "FontEngine.h"
 #include <SDL_ttf.h>
 
+// width and height of a glyph atlas page
+const int GLYPH_PAGE_SIZE = 512;
+
+// when a font style needs more pages than this, its glyph cache is rebuilt
+const size_t GLYPH_PAGE_MAX = 8;
+
+/**
+ * A single rasterized glyph stored in a glyph atlas page.
+ * Glyphs with nothing to draw (e.g. spaces) have a NULL page.
+ */
+class SDLFontGlyph {
+public:
+	Image *page;
+	Rect src;
+	int advance;
+
+	SDLFontGlyph()
+		: page(NULL)
+		, src()
+		, advance(0) {
+	}
+};
+
 class SDLFontStyle : public FontStyle {
 public:
 	SDLFontStyle();
 	~SDLFontStyle() {};
 
 	TTF_Font *ttfont;
+
+	// glyphs are keyed by codepoint and packed color/blend mode
+	std::map<std::pair<Uint32, Uint32>, SDLFontGlyph> glyphs;
+	std::vector<Image*> glyph_pages;
+	Point glyph_cursor;
+	int glyph_row_height;
 };
 
 /**
@@ -47,8 +76,12 @@ private:
 	void setFontFallback(const std::string& _font);
 	bool hasMissingGlyph(const std::string& text);
 
+	const SDLFontGlyph& getGlyph(SDLFontStyle *style, const std::string& glyph_text, Uint32 codepoint, const Color& color, bool blended);
+	void clearGlyphCache(SDLFontStyle *style);
+
 protected:
 	void renderInternal(const std::string& text, int x, int y, int justify, Image *target, const Color& color);
+	const FontStyle* getActiveFont();
 
 public:
 	SDLFontEngine();
@@ -61,6 +94,8 @@ public:
 
 	int calc_width(const std::string& text);
 	std::string trimTextToWidth(const std::string& text, const int width, const bool use_ellipsis);
+
+	void clearGlyphCache();
 };
 
 #endif
@@ -19,6 +19,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <SDL_image.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include <stdio.h>
@@ -31,37 +32,121 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "SDLHardwareRenderDevice.h"
 #include "SDLFontEngine.h"
 
+// a header word with this bit is followed by one pixel that repeats, otherwise by that many different pixels
+const Uint32 PACKED_PIXELS_RUN = 0x80000000;
+
+static void packPixels(const Uint32* pixels, int count, std::vector<Uint32>& packed) {
+	int i = 0;
+	while (i < count) {
+		int run = 1;
+		while (i + run < count && pixels[i + run] == pixels[i])
+			run++;
+
+		if (run >= 3) {
+			packed.push_back(PACKED_PIXELS_RUN | static_cast<Uint32>(run));
+			packed.push_back(pixels[i]);
+			i += run;
+			continue;
+		}
+
+		// different pixels go up to the start of the next run
+		size_t header = packed.size();
+		packed.push_back(0);
+		Uint32 literal = 0;
+		while (i < count && !(i + 2 < count && pixels[i] == pixels[i + 1] && pixels[i] == pixels[i + 2])) {
+			packed.push_back(pixels[i]);
+			i++;
+			literal++;
+		}
+		packed[header] = literal;
+	}
+}
+
+static void unpackPixels(const std::vector<Uint32>& packed, std::vector<Uint32>& pixels) {
+	size_t i = 0;
+	while (i < packed.size()) {
+		const Uint32 header = packed[i++];
+		const Uint32 count = header & ~PACKED_PIXELS_RUN;
+
+		if (header & PACKED_PIXELS_RUN) {
+			if (i >= packed.size())
+				return;
+			pixels.insert(pixels.end(), count, packed[i]);
+			i++;
+		}
+		else {
+			if (i + count > packed.size())
+				return;
+			pixels.insert(pixels.end(), packed.begin() + i, packed.begin() + i + count);
+			i += count;
+		}
+	}
+}
+
+// text and the images in these folders make up the interface, which is restored first
+static bool isInterfaceImage(const std::string& filename) {
+	return filename.empty() || filename.compare(0, 13, "images/menus/") == 0 || filename.compare(0, 13, "images/icons/") == 0;
+}
+
 SDLHardwareImage::SDLHardwareImage(RenderDevice *_device, SDL_Renderer *_renderer)
 	: Image(_device)
 	, renderer(_renderer)
-	, surface(NULL) {
+	, surface(NULL)
+	, texture_scale(1)
+	, is_target(false)
+	, lost(false)
+	, drawn_frame(0) {
+	static_cast<SDLHardwareRenderDevice *>(device)->addImage(this);
 }
 
 SDLHardwareImage::~SDLHardwareImage() {
+	static_cast<SDLHardwareRenderDevice *>(device)->removeImage(this);
 	if (surface)
 		SDL_DestroyTexture(surface);
 }
 
+SDL_Texture* SDLHardwareImage::getTexture() {
+	SDLHardwareRenderDevice *hw_device = static_cast<SDLHardwareRenderDevice *>(device);
+	if (lost)
+		hw_device->restoreImage(this);
+
+	drawn_frame = hw_device->getFrame();
+	return surface;
+}
+
 int SDLHardwareImage::getWidth() const {
 	int w, h;
 	SDL_QueryTexture(surface, NULL, NULL, &w, &h);
-	return (surface ? w : 0);
+	return (surface ? static_cast<int>(static_cast<float>(w) / texture_scale + 0.5f) : 0);
 }
 
 int SDLHardwareImage::getHeight() const {
 	int w, h;
 	SDL_QueryTexture(surface, NULL, NULL, &w, &h);
-	return (surface ? h : 0);
+	return (surface ? static_cast<int>(static_cast<float>(h) / texture_scale + 0.5f) : 0);
+}
+
+SDL_Rect SDLHardwareImage::textureRect(const Rect& r) const {
+	SDL_Rect tr = r;
+	if (texture_scale == 1)
+		return tr;
+
+	tr.x = static_cast<int>(static_cast<float>(r.x) * texture_scale + 0.5f);
+	tr.y = static_cast<int>(static_cast<float>(r.y) * texture_scale + 0.5f);
+	tr.w = static_cast<int>(static_cast<float>(r.x + r.w) * texture_scale + 0.5f) - tr.x;
+	tr.h = static_cast<int>(static_cast<float>(r.y + r.h) * texture_scale + 0.5f) - tr.y;
+	return tr;
 }
 
 void SDLHardwareImage::fillWithColor(const Color& color) {
 	if (!surface) return;
 
-	SDL_SetRenderTarget(renderer, surface);
+	SDLHardwareRenderDevice *hw_device = static_cast<SDLHardwareRenderDevice *>(device);
+	hw_device->drawBatch();
+	hw_device->setTarget(surface);
 	SDL_SetTextureBlendMode(surface, SDL_BLENDMODE_BLEND);
-	SDL_SetRenderDrawColor(renderer, color.r, color.g , color.b, color.a);
+	hw_device->setDrawColor(color);
 	SDL_RenderClear(renderer);
-	SDL_SetRenderTarget(renderer, NULL);
 }
 
 /*
@@ -70,11 +155,35 @@ void SDLHardwareImage::fillWithColor(const Color& color) {
 void SDLHardwareImage::drawPixel(int x, int y, const Color& color) {
 	if (!surface) return;
 
-	SDL_SetRenderTarget(renderer, surface);
+	SDLHardwareRenderDevice *hw_device = static_cast<SDLHardwareRenderDevice *>(device);
+	hw_device->drawBatch();
+	hw_device->setTarget(surface);
 	SDL_SetTextureBlendMode(surface, SDL_BLENDMODE_BLEND);
-	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+	hw_device->setDrawColor(color);
 	SDL_RenderDrawPoint(renderer, x, y);
-	SDL_SetRenderTarget(renderer, NULL);
+}
+
+void SDLHardwareImage::setPixels(const Rect& area, const uint32_t* pixels, int pitch) {
+	if (!surface || area.w <= 0 || area.h <= 0) return;
+
+	device->drawBatch();
+
+	Uint32 format;
+	SDL_QueryTexture(getTexture(), &format, NULL, NULL, NULL);
+
+	if (format == SDL_PIXELFORMAT_ARGB8888) {
+		SDL_Rect rect = area;
+		SDL_UpdateTexture(surface, &rect, pixels, pitch * 4);
+	}
+	else {
+		// only images from createImage() are known to be ARGB8888
+		for (int y = 0; y < area.h; ++y) {
+			for (int x = 0; x < area.w; ++x) {
+				const uint32_t p = pixels[y * pitch + x];
+				drawPixel(area.x + x, area.y + y, Color(static_cast<Uint8>((p >> 16) & 0xff), static_cast<Uint8>((p >> 8) & 0xff), static_cast<Uint8>(p & 0xff), static_cast<Uint8>(p >> 24)));
+			}
+		}
+	}
 }
 
 Image* SDLHardwareImage::resize(int width, int height) {
@@ -85,12 +194,13 @@ Image* SDLHardwareImage::resize(int width, int height) {
 	if (!scaled) return NULL;
 
 	scaled->surface = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+	scaled->is_target = true;
 
 	if (scaled->surface != NULL) {
 		// copy the source texture to the new texture, stretching it in the process
-		SDL_SetRenderTarget(renderer, scaled->surface);
-		SDL_RenderCopyEx(renderer, surface, NULL, NULL, 0, NULL, SDL_FLIP_NONE);
-		SDL_SetRenderTarget(renderer, NULL);
+		SDL_Texture *src_texture = getTexture();
+		static_cast<SDLHardwareRenderDevice *>(device)->setTarget(scaled->surface);
+		SDL_RenderCopyEx(renderer, src_texture, NULL, NULL, 0, NULL, SDL_FLIP_NONE);
 
 		// Remove the old surface
 		this->unref();
@@ -107,11 +217,22 @@ SDLHardwareRenderDevice::SDLHardwareRenderDevice()
 	: window(NULL)
 	, renderer(NULL)
 	, texture(NULL)
+	, render_target(NULL)
+	, world_texture(NULL)
+	, world_active(false)
+	, world_draw_scale(1)
+	, bound_world_scale(1)
+	, backup_bytes(0)
+	, frame(0)
 	, titlebar_icon(NULL)
 	, title(NULL)
 {
 	logInfo("Using Render Device: SDLHardwareRenderDevice (hardware, SDL 2)");
 
+	// textures are drawn with their own scale, so low resolution images end up at the original size
+	allow_low_res_images = true;
+	allow_scaled_sprites = true;
+
 	fullscreen = FULLSCREEN;
 	hwsurface = HWSURFACE;
 	vsync = VSYNC;
@@ -256,13 +377,16 @@ int SDLHardwareRenderDevice::createContext(bool allow_fallback) {
 }
 
 int SDLHardwareRenderDevice::render(Renderable& r, Rect& dest) {
+	drawBatch();
+
 	dest.w = r.src.w;
 	dest.h = r.src.h;
-    SDL_Rect src = r.src;
-    SDL_Rect _dest = dest;
-	SDL_SetRenderTarget(renderer, texture);
+	SDLHardwareImage *image = static_cast<SDLHardwareImage *>(r.image);
+	SDL_Rect src = image->textureRect(r.src);
+	SDL_Rect _dest = dest;
+	bindTarget();
 
-	SDL_Texture *surface = static_cast<SDLHardwareImage *>(r.image)->surface;
+	SDL_Texture *surface = image->getTexture();
 
 	if (r.blend_mode == RENDERABLE_BLEND_ADD) {
 		SDL_SetTextureBlendMode(surface, SDL_BLENDMODE_ADD);
@@ -278,6 +402,8 @@ int SDLHardwareRenderDevice::render(Renderable& r, Rect& dest) {
 }
 
 int SDLHardwareRenderDevice::render(Sprite *r) {
+	drawBatch();
+
 	if (r == NULL) {
 		return -1;
 	}
@@ -289,39 +415,106 @@ int SDLHardwareRenderDevice::render(Sprite *r) {
 	// adjust for that here
 	if (m_clip.x < 0) {
 		m_clip.w -= abs(m_clip.x);
+		m_dest.w -= abs(m_clip.x);
 		m_dest.x += abs(m_clip.x);
 		m_clip.x = 0;
 	}
 	if (m_clip.y < 0) {
 		m_clip.h -= abs(m_clip.y);
+		m_dest.h -= abs(m_clip.y);
 		m_dest.y += abs(m_clip.y);
 		m_clip.y = 0;
 	}
 
-	m_dest.w = m_clip.w;
-	m_dest.h = m_clip.h;
+	SDLHardwareImage *image = static_cast<SDLHardwareImage *>(r->getGraphics());
+	SDL_Rect src = image->textureRect(m_clip);
+	SDL_Rect dest = m_dest;
+	bindTarget();
+	return SDL_RenderCopy(renderer, image->getTexture(), &src, &dest);
+}
+
+void SDLHardwareRenderDevice::renderBatch(std::vector<RenderBatchItem>& items) {
+	bindTarget();
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		RenderBatchItem &item = items[i];
+		SDLHardwareImage *image = static_cast<SDLHardwareImage *>(item.image);
+		SDL_Texture *surface = image->getTexture();
 
-    SDL_Rect src = m_clip;
-    SDL_Rect dest = m_dest;
-	SDL_SetRenderTarget(renderer, texture);
-	return SDL_RenderCopy(renderer, static_cast<SDLHardwareImage *>(r->getGraphics())->surface, &src, &dest);
+		// only change the texture state when it differs from the previous draw
+		if (item.use_mods && (i == 0 || !item.sameState(items[i-1]))) {
+			if (item.blend_mode == RENDERABLE_BLEND_ADD) {
+				SDL_SetTextureBlendMode(surface, SDL_BLENDMODE_ADD);
+			}
+			else { // RENDERABLE_BLEND_NORMAL
+				SDL_SetTextureBlendMode(surface, SDL_BLENDMODE_BLEND);
+			}
+
+			SDL_SetTextureColorMod(surface, item.color_mod.r, item.color_mod.g, item.color_mod.b);
+			SDL_SetTextureAlphaMod(surface, item.alpha_mod);
+		}
+
+		// negative x and y clip on Sprites causes weird stretching
+		// adjust for that here
+		if (!item.use_mods) {
+			if (item.src.x < 0) {
+				item.src.w -= abs(item.src.x);
+				item.dest.x += abs(item.src.x);
+				item.src.x = 0;
+				item.dest.w = item.src.w;
+			}
+			if (item.src.y < 0) {
+				item.src.h -= abs(item.src.y);
+				item.dest.y += abs(item.src.y);
+				item.src.y = 0;
+				item.dest.h = item.src.h;
+			}
+		}
+
+		SDL_Rect src = image->textureRect(item.src);
+		SDL_Rect dest = item.dest;
+		SDL_RenderCopy(renderer, surface, &src, &dest);
+	}
 }
 
 int SDLHardwareRenderDevice::renderToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest) {
 	if (!src_image || !dest_image)
 		return -1;
 
-	if (SDL_SetRenderTarget(renderer, static_cast<SDLHardwareImage *>(dest_image)->surface) != 0)
+	drawBatch();
+
+	SDL_Texture *src_texture = static_cast<SDLHardwareImage *>(src_image)->getTexture();
+	if (setTarget(static_cast<SDLHardwareImage *>(dest_image)->surface) != 0)
 		return -1;
 
 	dest.w = src.w;
 	dest.h = src.h;
-    SDL_Rect _src = src;
-    SDL_Rect _dest = dest;
+	SDL_Rect _src = static_cast<SDLHardwareImage *>(src_image)->textureRect(src);
+	SDL_Rect _dest = dest;
 
 	SDL_SetTextureBlendMode(static_cast<SDLHardwareImage *>(dest_image)->surface, SDL_BLENDMODE_BLEND);
-	SDL_RenderCopy(renderer, static_cast<SDLHardwareImage *>(src_image)->surface, &_src, &_dest);
-	SDL_SetRenderTarget(renderer, NULL);
+	SDL_RenderCopy(renderer, src_texture, &_src, &_dest);
+	return 0;
+}
+
+int SDLHardwareRenderDevice::copyToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest) {
+	if (!src_image || !dest_image)
+		return -1;
+
+	drawBatch();
+
+	SDL_Texture *src_texture = static_cast<SDLHardwareImage *>(src_image)->getTexture();
+	if (setTarget(static_cast<SDLHardwareImage *>(dest_image)->surface) != 0)
+		return -1;
+
+	dest.w = src.w;
+	dest.h = src.h;
+	SDL_Rect _src = static_cast<SDLHardwareImage *>(src_image)->textureRect(src);
+	SDL_Rect _dest = dest;
+
+	SDL_SetTextureBlendMode(src_texture, SDL_BLENDMODE_NONE);
+	SDL_RenderCopy(renderer, src_texture, &_src, &_dest);
+	SDL_SetTextureBlendMode(src_texture, SDL_BLENDMODE_BLEND);
 	return 0;
 }
 
@@ -334,6 +527,8 @@ int SDLHardwareRenderDevice::renderText(
 	int ret = 0;
 	SDL_Texture *surface = NULL;
 
+	drawBatch();
+
 	SDL_Surface *cleanup = TTF_RenderUTF8_Blended(static_cast<SDLFontStyle *>(font_style)->ttfont, text.c_str(), color);
 	if (cleanup) {
 		surface = SDL_CreateTextureFromSurface(renderer,cleanup);
@@ -355,7 +550,7 @@ int SDLHardwareRenderDevice::renderText(
 	dest.h = clip.h;
 	SDL_Rect _dest = dest;
 
-	SDL_SetRenderTarget(renderer, texture);
+	bindTarget();
 	ret = SDL_RenderCopy(renderer, surface, &clip, &_dest);
 
 	SDL_DestroyTexture(surface);
@@ -377,6 +572,7 @@ Image * SDLHardwareRenderDevice::renderTextToImage(FontStyle* font_style, const
 
 	if (cleanup) {
 		image->surface = SDL_CreateTextureFromSurface(renderer, cleanup);
+		backupImage(image, cleanup);
 		SDL_FreeSurface(cleanup);
 		return image;
 	}
@@ -386,12 +582,16 @@ Image * SDLHardwareRenderDevice::renderTextToImage(FontStyle* font_style, const
 }
 
 void SDLHardwareRenderDevice::drawPixel(int x, int y, const Color& color) {
-	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+	drawBatch();
+	bindTarget();
+	setDrawColor(color);
 	SDL_RenderDrawPoint(renderer, x, y);
 }
 
 void SDLHardwareRenderDevice::drawLine(int x0, int y0, int x1, int y1, const Color& color) {
-	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+	drawBatch();
+	bindTarget();
+	setDrawColor(color);
 	SDL_RenderDrawLine(renderer, x0, y0, x1, y1);
 }
 
@@ -403,17 +603,30 @@ void SDLHardwareRenderDevice::drawRectangle(const Point& p0, const Point& p1, co
 }
 
 void SDLHardwareRenderDevice::blankScreen() {
-	SDL_SetRenderTarget(renderer, texture);
-	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	drawBatch();
+	setTarget(texture);
+	setDrawColor(Color(0, 0, 0, 255));
 	SDL_RenderClear(renderer);
 	return;
 }
 
 void SDLHardwareRenderDevice::commitFrame() {
-	SDL_SetRenderTarget(renderer, NULL);
+	drawBatch();
+	setTarget(NULL);
 	SDL_RenderCopy(renderer, texture, NULL, NULL);
 	SDL_RenderPresent(renderer);
 	inpt->window_resized = false;
+	inpt->window_exposed = false;
+
+	frame++;
+
+	// textures that weren't needed right after the context was lost are restored a few at a time
+	if (!lost_images.empty()) {
+		const Uint64 start = SDL_GetPerformanceCounter();
+		const Uint64 budget = static_cast<Uint64>(TEXTURE_RESTORE_SECONDS * static_cast<float>(SDL_GetPerformanceFrequency()));
+		while (!lost_images.empty() && SDL_GetPerformanceCounter() - start < budget)
+			restoreImage(*lost_images.begin());
+	}
 
 	return;
 }
@@ -437,6 +650,12 @@ void SDLHardwareRenderDevice::destroyContext() {
 	SDL_FreeSurface(titlebar_icon);
 	titlebar_icon = NULL;
 
+	if (world_texture) {
+		SDL_DestroyTexture(world_texture);
+		world_texture = NULL;
+	}
+	world_active = false;
+
 	SDL_DestroyRenderer(renderer);
 	renderer = NULL;
 
@@ -463,15 +682,15 @@ Image *SDLHardwareRenderDevice::createImage(int width, int height) {
 
 	if (width > 0 && height > 0) {
 		image->surface = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+		image->is_target = true;
 		if(image->surface == NULL) {
 			logError("SDLHardwareRenderDevice: SDL_CreateTexture failed: %s", SDL_GetError());
 		}
 		else {
-				SDL_SetRenderTarget(renderer, image->surface);
+				setTarget(image->surface);
 				SDL_SetTextureBlendMode(image->surface, SDL_BLENDMODE_BLEND);
-				SDL_SetRenderDrawColor(renderer, 0,0,0,0);
+				setDrawColor(Color(0,0,0,0));
 				SDL_RenderClear(renderer);
-				SDL_SetRenderTarget(renderer, NULL);
 		}
 	}
 
@@ -497,7 +716,7 @@ void SDLHardwareRenderDevice::updateTitleBar() {
 	if (!window) return;
 
 	title = strdup(msg->get(WINDOW_TITLE).c_str());
-	titlebar_icon = IMG_Load(mods->locate("images/logo/icon.png").c_str());
+	titlebar_icon = IMG_Load_RW(mods->openRW(mods->locate("images/logo/icon.png")), 1);
 
 	if (title) SDL_SetWindowTitle(window, title);
 	if (titlebar_icon) SDL_SetWindowIcon(window, titlebar_icon);
@@ -513,12 +732,24 @@ Image *SDLHardwareRenderDevice::loadImage(const std::string&filename, const std:
 	SDLHardwareImage *image = new SDLHardwareImage(this, renderer);
 	if (!image) return NULL;
 
-	image->surface = IMG_LoadTexture(renderer, mods->locate(filename).c_str());
+	// only the texture upload has to happen here; decoding may already be done in the background
+	std::string error;
+	SDL_Surface *cleanup = decodeImage(filename, error);
+	if (cleanup) {
+		image->surface = SDL_CreateTextureFromSurface(renderer, cleanup);
+		if (image->surface == NULL)
+			error = SDL_GetError();
+		else if (isLowResImage(filename))
+			image->texture_scale = LOW_RES_IMAGE_SCALE;
+		image->filename = filename;
+		backupImage(image, cleanup);
+		SDL_FreeSurface(cleanup);
+	}
 
 	if(image->surface == NULL) {
 		delete image;
 		if (!errormessage.empty())
-			logError("SDLHardwareRenderDevice: [%s] %s: %s", filename.c_str(), errormessage.c_str(), IMG_GetError());
+			logError("SDLHardwareRenderDevice: [%s] %s: %s", filename.c_str(), errormessage.c_str(), error.c_str());
 		if (IfNotFoundExit) {
 			mods->resetModConfig();
 			Exit(1);
@@ -531,6 +762,100 @@ Image *SDLHardwareRenderDevice::loadImage(const std::string&filename, const std:
 	return image;
 }
 
+void SDLHardwareRenderDevice::setRenderTarget(Image* image) {
+	drawBatch();
+	render_target = image ? static_cast<SDLHardwareImage *>(image)->surface : NULL;
+}
+
+SDL_Texture* SDLHardwareRenderDevice::currentTarget() {
+	if (render_target)
+		return render_target;
+	return world_active ? world_texture : texture;
+}
+
+/**
+ * Changing the render target resets the render scale, so the world scale is set again here
+ */
+void SDLHardwareRenderDevice::bindTarget() {
+	SDL_Texture *target = currentTarget();
+	setTarget(target);
+
+	if (target == world_texture && bound_world_scale != world_draw_scale) {
+		SDL_RenderSetScale(renderer, world_draw_scale, world_draw_scale);
+		bound_world_scale = world_draw_scale;
+	}
+}
+
+/**
+ * Switching targets makes SDL flush the queued draw commands, so it is skipped when the target is already bound.
+ * Asking SDL for its target, instead of remembering the last one set, stays right when a bound texture is destroyed.
+ */
+int SDLHardwareRenderDevice::setTarget(SDL_Texture *target) {
+	if (!renderer)
+		return -1;
+	if (SDL_GetRenderTarget(renderer) == target)
+		return 0;
+
+	// a new target starts out at a scale of 1
+	bound_world_scale = 1;
+	return SDL_SetRenderTarget(renderer, target);
+}
+
+void SDLHardwareRenderDevice::setDrawColor(const Color& color) {
+	Uint8 r, g, b, a;
+	if (SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a) == 0 && r == color.r && g == color.g && b == color.b && a == color.a)
+		return;
+
+	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+}
+
+void SDLHardwareRenderDevice::beginWorld() {
+	drawBatch();
+
+	world_draw_scale = getWorldScale();
+	if (world_draw_scale >= 1 || !world_texture)
+		return;
+
+	world_active = true;
+	bindTarget();
+	setDrawColor(Color(0, 0, 0, 255));
+	SDL_RenderClear(renderer);
+}
+
+void SDLHardwareRenderDevice::endWorld() {
+	if (!world_active)
+		return;
+
+	drawBatch();
+	world_active = false;
+
+	// the world is drawn first, so it replaces the blank screen instead of blending with it
+	SDL_Rect src;
+	src.x = 0;
+	src.y = 0;
+	src.w = std::max(1, static_cast<int>(static_cast<float>(VIEW_W) * world_draw_scale + 0.5f));
+	src.h = std::max(1, static_cast<int>(static_cast<float>(VIEW_H) * world_draw_scale + 0.5f));
+
+	bindTarget();
+	SDL_SetTextureBlendMode(world_texture, SDL_BLENDMODE_NONE);
+	SDL_RenderCopy(renderer, world_texture, &src, NULL);
+}
+
+int SDLHardwareRenderDevice::getVsyncRate() {
+	if (!window || !renderer)
+		return 0;
+
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(renderer, &info) != 0 || !(info.flags & SDL_RENDERER_PRESENTVSYNC))
+		return 0;
+
+	SDL_DisplayMode mode;
+	if (SDL_GetWindowDisplayMode(window, &mode) != 0)
+		return 0;
+
+	return mode.refresh_rate;
+}
+
 void SDLHardwareRenderDevice::windowResize() {
 	int w,h;
 	SDL_GetWindowSize(window, &w, &h);
@@ -559,7 +884,161 @@ void SDLHardwareRenderDevice::windowResize() {
 
 	if (texture) SDL_DestroyTexture(texture);
 	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, VIEW_W, VIEW_H);
-	SDL_SetRenderTarget(renderer, texture);
+
+	if (world_texture) SDL_DestroyTexture(world_texture);
+	world_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, VIEW_W, VIEW_H);
+	world_active = false;
+
+	setTarget(texture);
 
 	updateScreenVars();
 }
+
+void SDLHardwareRenderDevice::addImage(SDLHardwareImage *image) {
+	images.insert(image);
+}
+
+void SDLHardwareRenderDevice::removeImage(SDLHardwareImage *image) {
+	images.erase(image);
+	lost_images.erase(image);
+	backup_bytes -= image->backup.size() * sizeof(Uint32);
+}
+
+void SDLHardwareRenderDevice::backupImage(SDLHardwareImage *image, SDL_Surface *surface) {
+	if (!surface || surface->w <= 0 || surface->h <= 0 || TEXTURE_BACKUP_MB <= 0)
+		return;
+
+	const size_t budget = static_cast<size_t>(TEXTURE_BACKUP_MB) * 1024 * 1024;
+	if (backup_bytes >= budget)
+		return;
+
+	SDL_Surface *argb = surface;
+	if (surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+		argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+	if (!argb)
+		return;
+
+	std::vector<Uint32> packed;
+	if (SDL_LockSurface(argb) == 0) {
+		for (int y = 0; y < argb->h; ++y) {
+			const Uint32 *row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(argb->pixels) + y * argb->pitch);
+			packPixels(row, argb->w, packed);
+		}
+		SDL_UnlockSurface(argb);
+	}
+
+	const size_t bytes = packed.size() * sizeof(Uint32);
+	if (!packed.empty() && backup_bytes + bytes <= budget) {
+		backup_bytes -= image->backup.size() * sizeof(Uint32);
+		image->backup.swap(packed);
+		image->backup_size = Point(argb->w, argb->h);
+		backup_bytes += bytes;
+	}
+
+	if (argb != surface)
+		SDL_FreeSurface(argb);
+}
+
+void SDLHardwareRenderDevice::restoreImage(SDLHardwareImage *image) {
+	lost_images.erase(image);
+	image->lost = false;
+
+	if (!image->surface)
+		return;
+
+	int w, h;
+	SDL_QueryTexture(image->surface, NULL, NULL, &w, &h);
+
+	SDL_Texture *restored = NULL;
+	SDL_Surface *cleanup = NULL;
+
+	if (image->is_target) {
+		restored = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+		if (restored) {
+			setTarget(restored);
+			SDL_SetTextureBlendMode(restored, SDL_BLENDMODE_BLEND);
+			setDrawColor(Color(0,0,0,0));
+			SDL_RenderClear(renderer);
+		}
+	}
+	else if (!image->backup.empty()) {
+		std::vector<Uint32> pixels;
+		pixels.reserve(static_cast<size_t>(image->backup_size.x) * static_cast<size_t>(image->backup_size.y));
+		unpackPixels(image->backup, pixels);
+
+		if (pixels.size() == static_cast<size_t>(image->backup_size.x) * static_cast<size_t>(image->backup_size.y)) {
+			cleanup = SDL_CreateRGBSurfaceFrom(&pixels[0], image->backup_size.x, image->backup_size.y, 32, image->backup_size.x * 4, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+			if (cleanup)
+				restored = SDL_CreateTextureFromSurface(renderer, cleanup);
+		}
+	}
+	else if (!image->filename.empty()) {
+		std::string error;
+		cleanup = decodeImage(image->filename, error);
+		if (cleanup)
+			restored = SDL_CreateTextureFromSurface(renderer, cleanup);
+	}
+
+	if (cleanup)
+		SDL_FreeSurface(cleanup);
+
+	if (!restored) {
+		logError("SDLHardwareRenderDevice: Couldn't restore texture [%s]: %s", image->filename.c_str(), SDL_GetError());
+		return;
+	}
+
+	if (render_target == image->surface)
+		render_target = restored;
+
+	SDL_DestroyTexture(image->surface);
+	image->surface = restored;
+}
+
+/**
+ * Render targets are recreated blank right away, then the interface and what was on screen
+ * in the last frames are restored. Everything else is restored when it is drawn, or a few
+ * textures per frame in commitFrame().
+ */
+void SDLHardwareRenderDevice::restoreContext(bool device_lost) {
+	drawBatch();
+	const Uint64 start = SDL_GetPerformanceCounter();
+
+	// the screen and world textures are made for the view size
+	if (device_lost)
+		windowResize();
+
+	std::set<SDLHardwareImage*>::iterator it;
+	unsigned restored = 0;
+
+	for (it = images.begin(); it != images.end(); ++it) {
+		SDLHardwareImage *image = *it;
+		if (image->is_target) {
+			restoreImage(image);
+			restored++;
+		}
+		else if (device_lost && image->surface) {
+			image->lost = true;
+			lost_images.insert(image);
+		}
+	}
+
+	if (device_lost) {
+		for (it = images.begin(); it != images.end(); ++it) {
+			if ((*it)->lost && isInterfaceImage((*it)->filename)) {
+				restoreImage(*it);
+				restored++;
+			}
+		}
+		for (it = images.begin(); it != images.end(); ++it) {
+			if ((*it)->lost && frame - (*it)->drawn_frame <= 2) {
+				restoreImage(*it);
+				restored++;
+			}
+		}
+	}
+
+	restoreRenderTargets();
+
+	const float ms = static_cast<float>(SDL_GetPerformanceCounter() - start) * 1000.f / static_cast<float>(SDL_GetPerformanceFrequency());
+	logInfo("SDLHardwareRenderDevice: Restored %u textures in %.1f ms; %u more are restored as they are needed.", restored, ms, static_cast<unsigned>(lost_images.size()));
+}
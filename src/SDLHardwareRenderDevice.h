@@ -22,6 +22,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "RenderDevice.h"
 
+#include <set>
+
 /** Provide rendering device using SDL_BlitSurface backend.
  *
  * Provide an SDL_BlitSurface implementation for renderning a Renderable to
@@ -41,6 +43,9 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #define SDL_JoystickName SDL_JoystickNameForIndex
 
+// after the context is lost, the textures that aren't needed right away are restored for at most this long each frame
+const float TEXTURE_RESTORE_SECONDS = 0.002f;
+
 
 /** SDL Image */
 class SDLHardwareImage : public Image {
@@ -53,9 +58,34 @@ public:
 	void fillWithColor(const Color& color);
 	void drawPixel(int x, int y, const Color& color);
 	Image* resize(int width, int height);
+	void setPixels(const Rect& area, const uint32_t* pixels, int pitch);
+
+	// converts a rectangle in image coordinates to texture coordinates
+	SDL_Rect textureRect(const Rect& r) const;
+
+	// returns the texture to draw from, restoring it first if the context was lost
+	SDL_Texture* getTexture();
 
 	SDL_Renderer *renderer;
 	SDL_Texture *surface;
+
+	// texture pixels per image pixel, less than 1 for low resolution images
+	float texture_scale;
+
+	/* Used to rebuild the texture after the context is lost. Images made from pixels keep
+	 * a run-length packed ARGB8888 copy of them, within TEXTURE_BACKUP_MB; loaded images
+	 * past that are decoded from their file again. Render targets come back blank.
+	 */
+	std::vector<Uint32> backup;
+	Point backup_size;
+	std::string filename;
+	bool is_target;
+
+	// the texture is stale, and has to be restored before it is drawn
+	bool lost;
+
+	// the frame this was last drawn in, to restore what is on screen first
+	unsigned drawn_frame;
 };
 
 class SDLHardwareRenderDevice : public RenderDevice {
@@ -68,6 +98,7 @@ public:
 	virtual int render(Renderable& r, Rect& dest);
 	virtual int render(Sprite* r);
 	virtual int renderToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest);
+	virtual int copyToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest);
 
 	int renderText(FontStyle *font_style, const std::string& text, const Color& color, Rect& dest);
 	Image *renderTextToImage(FontStyle* font_style, const std::string& text, const Color& color, bool blended = true);
@@ -77,6 +108,10 @@ public:
 	void commitFrame();
 	void destroyContext();
 	void windowResize();
+	void setRenderTarget(Image* image);
+	int getVsyncRate();
+	void beginWorld();
+	void endWorld();
 	Image *createImage(int width, int height);
 	void setGamma(float g);
 	void resetGamma();
@@ -85,12 +120,55 @@ public:
 	Image* loadImage(const std::string& filename,
 					 const std::string& errormessage = "Couldn't load image",
 					 bool IfNotFoundExit = false);
+
+	/* The render target and draw color are only set when they differ from the renderer's current ones,
+	 * so that a run of draws to the same image switches to it once. Nothing switches back afterwards;
+	 * every draw sets the target it needs. setTarget() returns non-zero if the target couldn't be set.
+	 */
+	int setTarget(SDL_Texture *target);
+	void setDrawColor(const Color& color);
+
+	void restoreContext(bool device_lost);
+
+	/* Every image of this device is known to it, so that it can restore them. They add and remove themselves. */
+	void addImage(SDLHardwareImage *image);
+	void removeImage(SDLHardwareImage *image);
+
+	// keeps a copy of the pixels of surface in image, if they fit into TEXTURE_BACKUP_MB
+	void backupImage(SDLHardwareImage *image, SDL_Surface *surface);
+
+	// creates a new texture for image, from its backup or file, or a blank one for render targets
+	void restoreImage(SDLHardwareImage *image);
+
+	unsigned getFrame() const {
+		return frame;
+	}
+
+protected:
+	void renderBatch(std::vector<RenderBatchItem>& items);
+
 private:
 	void drawLine(int x0, int y0, int x1, int y1, const Color& color);
+	SDL_Texture* currentTarget();
+	void bindTarget();
 
 	SDL_Window *window;
 	SDL_Renderer *renderer;
 	SDL_Texture *texture;
+	SDL_Texture *render_target;
+
+	// view sized; while the world is drawn, only the top-left world_draw_scale of it is used
+	SDL_Texture *world_texture;
+	bool world_active;
+	float world_draw_scale;
+
+	// the render scale set for the world texture since it was last bound
+	float bound_world_scale;
+
+	std::set<SDLHardwareImage*> images;
+	std::set<SDLHardwareImage*> lost_images;
+	size_t backup_bytes;
+	unsigned frame;
 	SDL_Surface* titlebar_icon;
 	char* title;
 };
@@ -34,6 +34,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsParsing.h"
 
 #include <math.h>
+#include <SDL_image.h>
 
 SDLInputState::SDLInputState(void)
 	: InputState()
@@ -168,6 +169,20 @@ void SDLInputState::handle() {
 			std::cout << event << std::endl;
 		}
 
+		pending_events.push_back(event);
+	}
+
+	/* Process the queued events in the order they arrived */
+	while (!pending_events.empty()) {
+		event = pending_events.front();
+
+		// a press of a key that was already released during this frame would be lost,
+		// so it and everything after it waits for the next logic frame
+		if (isRepeatedPress(event))
+			break;
+
+		pending_events.pop_front();
+
 		// grab symbol keys
 		if (event.type == SDL_TEXTINPUT) {
 			inkeys += event.text.text;
@@ -224,6 +239,9 @@ void SDLInputState::handle() {
 				if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
 					resize_ticks = MAX_FRAMES_PER_SEC/4;
 				}
+				else if (event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+					window_exposed = true;
+				}
 				else if (PlatformOptions.is_mobile_device) {
 					// detect restoring hidden Mobile app to bypass frameskip
 					if (event.window.event == SDL_WINDOWEVENT_MINIMIZED) {
@@ -490,6 +508,13 @@ void SDLInputState::handle() {
 				ENABLE_JOYSTICK = false;
 				initJoystick();
 				break;
+			case SDL_RENDER_TARGETS_RESET:
+			case SDL_RENDER_DEVICE_RESET:
+				// e.g. when a mobile app comes back from the background
+				logInfo("SDLInputState: Restoring graphics after the render context was lost.");
+				render_device->restoreContext(event.type == SDL_RENDER_DEVICE_RESET);
+				window_resized = true;
+				break;
 			case SDL_QUIT:
 				done = 1;
 				break;
@@ -513,6 +538,96 @@ void SDLInputState::handle() {
 		joystick_init = true;
 }
 
+/**
+ * Returns true if event presses a key that has already been released since the last handle()
+ */
+bool SDLInputState::isRepeatedPress(const SDL_Event& event) {
+	int bind_button = 0;
+
+	switch (event.type) {
+		case SDL_MOUSEBUTTONDOWN:
+			if (PlatformOptions.is_mobile_device)
+				return false;
+
+			bind_button = (event.button.button + MOUSE_BIND_OFFSET) * (-1);
+			for (int key=0; key<key_count; key++) {
+				if (un_press[key] && (bind_button == binding[key] || bind_button == binding_alt[key]))
+					return true;
+			}
+			break;
+		case SDL_FINGERDOWN:
+			return PlatformOptions.is_mobile_device && un_press[MAIN1];
+		case SDL_KEYDOWN:
+			for (int key=0; key<key_count; key++) {
+				if (un_press[key] && (event.key.keysym.sym == binding[key] || event.key.keysym.sym == binding_alt[key]))
+					return true;
+			}
+			break;
+		case SDL_JOYBUTTONDOWN:
+			if (!joy || SDL_JoystickInstanceID(joy) != event.jbutton.which || !ENABLE_JOYSTICK)
+				return false;
+
+			for (int key=0; key<key_count; key++) {
+				if (un_press[key] && event.jbutton.button == binding_joy[key])
+					return true;
+			}
+			break;
+		default:
+			break;
+	}
+
+	return false;
+}
+
+Point SDLInputState::getLatestMouse() {
+	if (PlatformOptions.is_mobile_device || last_is_joystick)
+		return mouse;
+
+	Point latest = mouse;
+
+	// the queued motion events already have the render device's scaling applied,
+	// so they're peeked at instead of asking SDL for the window position
+	SDL_PumpEvents();
+	SDL_Event events[MOUSE_PEEK_EVENTS];
+	int count = SDL_PeepEvents(events, MOUSE_PEEK_EVENTS, SDL_PEEKEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+	if (count > 0) {
+		latest.x = events[count-1].motion.x;
+		latest.y = events[count-1].motion.y;
+	}
+
+	return latest;
+}
+
+int SDLInputState::createHardwareCursor(const std::string& filename, const Point& hotspot) {
+	SDL_Surface *surface = IMG_Load_RW(mods->openRW(mods->locate(filename)), 1);
+	if (!surface) {
+		logError("SDLInputState: Could not load cursor image %s: %s", filename.c_str(), IMG_GetError());
+		return -1;
+	}
+
+	// SDL refuses hotspots outside of the image
+	int hot_x = std::max(0, std::min(hotspot.x, surface->w - 1));
+	int hot_y = std::max(0, std::min(hotspot.y, surface->h - 1));
+
+	SDL_Cursor *cursor = SDL_CreateColorCursor(surface, hot_x, hot_y);
+	SDL_FreeSurface(surface);
+
+	if (!cursor) {
+		logError("SDLInputState: Could not create a hardware cursor from %s: %s", filename.c_str(), SDL_GetError());
+		return -1;
+	}
+
+	hardware_cursors.push_back(cursor);
+	return static_cast<int>(hardware_cursors.size()) - 1;
+}
+
+void SDLInputState::setHardwareCursor(int id) {
+	if (id < 0 || static_cast<size_t>(id) >= hardware_cursors.size())
+		SDL_SetCursor(SDL_GetDefaultCursor());
+	else
+		SDL_SetCursor(hardware_cursors[id]);
+}
+
 void SDLInputState::hideCursor() {
 	SDL_ShowCursor(SDL_DISABLE);
 }
@@ -655,4 +770,9 @@ bool SDLInputState::usingMouse() {
 SDLInputState::~SDLInputState() {
 	if (joy)
 		SDL_JoystickClose(joy);
+
+	SDL_SetCursor(SDL_GetDefaultCursor());
+	for (size_t i = 0; i < hardware_cursors.size(); ++i) {
+		SDL_FreeCursor(hardware_cursors[i]);
+	}
 }
@@ -21,6 +21,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "InputState.h"
 
+#include <deque>
+
+// the most mouse motion events looked at by getLatestMouse()
+const int MOUSE_PEEK_EVENTS = 64;
+
 /**
  * class SDLInputState
  *
@@ -44,8 +49,13 @@ public:
 	std::string getContinueString();
 	int getNumJoysticks();
 	bool usingMouse();
+	Point getLatestMouse();
+	int createHardwareCursor(const std::string& filename, const Point& hotspot);
+	void setHardwareCursor(int id);
 
 private:
+	bool isRepeatedPress(const SDL_Event& event);
+
 	SDL_Joystick* joy;
 	int joy_num;
 	int joy_axis_num;
@@ -54,6 +64,11 @@ private:
 
 	std::vector<int> joy_axis_prev;
 	std::vector<int> joy_axis_deltas;
+
+	// polled events that haven't been processed yet, in the order SDL timestamped them
+	std::deque<SDL_Event> pending_events;
+
+	std::vector<SDL_Cursor*> hardware_cursors;
 };
 
 #endif
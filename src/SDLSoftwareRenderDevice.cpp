@@ -20,6 +20,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <SDL_image.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include <stdio.h>
@@ -53,6 +54,7 @@ int SDLSoftwareImage::getHeight() const {
 void SDLSoftwareImage::fillWithColor(const Color& color) {
 	if (!surface) return;
 
+	device->drawBatch();
 	SDL_FillRect(surface, NULL, MapRGBA(color.r, color.g, color.b, color.a));
 }
 
@@ -66,6 +68,8 @@ void SDLSoftwareImage::fillWithColor(const Color& color) {
 void SDLSoftwareImage::drawPixel(int x, int y, const Color& color) {
 	if (!surface) return;
 
+	device->drawBatch();
+
 	Uint32 pixel = MapRGBA(color.r, color.g, color.b, color.a);
 
 	int bpp = surface->format->BytesPerPixel;
@@ -105,6 +109,21 @@ void SDLSoftwareImage::drawPixel(int x, int y, const Color& color) {
 	}
 }
 
+void SDLSoftwareImage::setPixels(const Rect& area, const uint32_t* pixels, int pitch) {
+	if (!surface || area.w <= 0 || area.h <= 0) return;
+
+	device->drawBatch();
+
+	// wrap the pixels in a surface, so that SDL can convert them to the format of this image
+	SDL_Surface *source = SDL_CreateRGBSurfaceFrom(const_cast<uint32_t *>(pixels), area.w, area.h, 32, pitch * 4, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+	if (!source) return;
+
+	SDL_SetSurfaceBlendMode(source, SDL_BLENDMODE_NONE);
+	SDL_Rect dest = area;
+	SDL_BlitSurface(source, NULL, surface, &dest);
+	SDL_FreeSurface(source);
+}
+
 Uint32 SDLSoftwareImage::MapRGBA(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
 	if (!surface) return 0;
 	return SDL_MapRGBA(surface->format, r, g, b, a);
@@ -129,6 +148,13 @@ Image* SDLSoftwareImage::resize(int width, int height) {
 											   surface->format->Amask);
 
 		if (scaled->surface) {
+			// keyed pixels are skipped, so the new image has to start out as the key
+			Uint32 key;
+			if (SDL_GetColorKey(surface, &key) == 0) {
+				SDL_FillRect(scaled->surface, NULL, key);
+				SDL_SetColorKey(scaled->surface, SDL_TRUE, key);
+			}
+
 			SDL_BlitScaled(surface, NULL, scaled->surface, NULL);
 
 			// delete the old image and return the new one
@@ -145,9 +171,14 @@ Image* SDLSoftwareImage::resize(int width, int height) {
 
 SDLSoftwareRenderDevice::SDLSoftwareRenderDevice()
 	: screen(NULL)
+	, render_target(NULL)
 	, window(NULL)
 	, renderer(NULL)
 	, texture(NULL)
+	, presented(NULL)
+	, full_present(true)
+	, damage_cols(0)
+	, damage_rows(0)
 	, titlebar_icon(NULL)
 	, title(NULL) {
 	logInfo("Using Render Device: SDLSoftwareRenderDevice (software, SDL 2)");
@@ -292,6 +323,8 @@ int SDLSoftwareRenderDevice::createContext(bool allow_fallback) {
 }
 
 int SDLSoftwareRenderDevice::render(Renderable& r, Rect& dest) {
+	drawBatch();
+
 	SDL_Rect src = r.src;
 	SDL_Rect _dest = dest;
 
@@ -307,10 +340,16 @@ int SDLSoftwareRenderDevice::render(Renderable& r, Rect& dest) {
 	SDL_SetSurfaceColorMod(surface, r.color_mod.r, r.color_mod.g, r.color_mod.b);
 	SDL_SetSurfaceAlphaMod(surface, r.alpha_mod);
 
-	return SDL_BlitSurface(surface, &src, screen, &_dest);
+	SDL_Surface *target = currentTarget();
+	int ret = SDL_BlitSurface(surface, &src, target, &_dest);
+	addDamage(target, _dest);
+
+	return ret;
 }
 
 int SDLSoftwareRenderDevice::render(Sprite *r) {
+	drawBatch();
+
 	if (r == NULL) {
 		return -1;
 	}
@@ -321,12 +360,45 @@ int SDLSoftwareRenderDevice::render(Sprite *r) {
 
 	SDL_Rect src = m_clip;
 	SDL_Rect dest = m_dest;
-	return SDL_BlitSurface(static_cast<SDLSoftwareImage *>(r->getGraphics())->surface, &src, screen, &dest);
+	SDL_Surface *target = currentTarget();
+	int ret = SDL_BlitSurface(static_cast<SDLSoftwareImage *>(r->getGraphics())->surface, &src, target, &dest);
+	addDamage(target, dest);
+
+	return ret;
+}
+
+void SDLSoftwareRenderDevice::renderBatch(std::vector<RenderBatchItem>& items) {
+	SDL_Surface *target = currentTarget();
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		RenderBatchItem &item = items[i];
+		SDL_Surface *surface = static_cast<SDLSoftwareImage *>(item.image)->surface;
+
+		// only change the surface state when it differs from the previous draw
+		if (item.use_mods && (i == 0 || !item.sameState(items[i-1]))) {
+			if (item.blend_mode == RENDERABLE_BLEND_ADD) {
+				SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_ADD);
+			}
+			else { // RENDERABLE_BLEND_NORMAL
+				SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_BLEND);
+			}
+
+			SDL_SetSurfaceColorMod(surface, item.color_mod.r, item.color_mod.g, item.color_mod.b);
+			SDL_SetSurfaceAlphaMod(surface, item.alpha_mod);
+		}
+
+		SDL_Rect src = item.src;
+		SDL_Rect dest = item.dest;
+		SDL_BlitSurface(surface, &src, target, &dest);
+		addDamage(target, dest);
+	}
 }
 
 int SDLSoftwareRenderDevice::renderToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest) {
 	if (!src_image || !dest_image) return -1;
 
+	drawBatch();
+
 	SDL_Rect _src = src;
 	SDL_Rect _dest = dest;
 
@@ -334,6 +406,24 @@ int SDLSoftwareRenderDevice::renderToImage(Image* src_image, Rect& src, Image* d
 						   static_cast<SDLSoftwareImage *>(dest_image)->surface, &_dest);
 }
 
+int SDLSoftwareRenderDevice::copyToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest) {
+	if (!src_image || !dest_image) return -1;
+
+	drawBatch();
+
+	SDL_Rect _src = src;
+	SDL_Rect _dest = dest;
+
+	SDL_Surface *src_surface = static_cast<SDLSoftwareImage *>(src_image)->surface;
+	SDL_BlendMode blend_mode;
+	SDL_GetSurfaceBlendMode(src_surface, &blend_mode);
+	SDL_SetSurfaceBlendMode(src_surface, SDL_BLENDMODE_NONE);
+	int ret = SDL_BlitSurface(src_surface, &_src, static_cast<SDLSoftwareImage *>(dest_image)->surface, &_dest);
+	SDL_SetSurfaceBlendMode(src_surface, blend_mode);
+
+	return ret;
+}
+
 int SDLSoftwareRenderDevice::renderText(
 	FontStyle *font_style,
 	const std::string& text,
@@ -343,13 +433,17 @@ int SDLSoftwareRenderDevice::renderText(
 	int ret = 0;
 	SDL_Color _color = color;
 
+	drawBatch();
+
 	SDL_Surface *surface = TTF_RenderUTF8_Blended(static_cast<SDLFontStyle *>(font_style)->ttfont, text.c_str(), _color);
 
 	if (surface == NULL)
 		return -1;
 
 	SDL_Rect _dest = dest;
-	ret = SDL_BlitSurface(surface, NULL, screen, &_dest);
+	SDL_Surface *target = currentTarget();
+	ret = SDL_BlitSurface(surface, NULL, target, &_dest);
+	addDamage(target, _dest);
 
 	SDL_FreeSurface(surface);
 
@@ -375,14 +469,17 @@ Image* SDLSoftwareRenderDevice::renderTextToImage(FontStyle* font_style, const s
 }
 
 void SDLSoftwareRenderDevice::drawPixel(int x, int y, const Color& color) {
+	drawBatch();
+
 	Uint32 pixel = MapRGBA(color.r, color.g, color.b, color.a);
 
-	int bpp = screen->format->BytesPerPixel;
+	SDL_Surface *target = currentTarget();
+	int bpp = target->format->BytesPerPixel;
 	/* Here p is the address to the pixel we want to set */
-	Uint8 *p = (Uint8 *)screen->pixels + y * screen->pitch + x * bpp;
+	Uint8 *p = (Uint8 *)target->pixels + y * target->pitch + x * bpp;
 
-	if (SDL_MUSTLOCK(screen)) {
-		SDL_LockSurface(screen);
+	if (SDL_MUSTLOCK(target)) {
+		SDL_LockSurface(target);
 	}
 	switch(bpp) {
 		case 1:
@@ -409,10 +506,13 @@ void SDLSoftwareRenderDevice::drawPixel(int x, int y, const Color& color) {
 			*(Uint32 *)p = pixel;
 			break;
 	}
-	if (SDL_MUSTLOCK(screen)) {
-		SDL_UnlockSurface(screen);
+	if (SDL_MUSTLOCK(target)) {
+		SDL_UnlockSurface(target);
 	}
 
+	SDL_Rect rect = {x, y, 1, 1};
+	addDamage(target, rect);
+
 	return;
 }
 
@@ -443,33 +543,125 @@ void SDLSoftwareRenderDevice::drawLine(int x0, int y0, int x1, int y1, const Col
 }
 
 void SDLSoftwareRenderDevice::drawRectangle(const Point& p0, const Point& p1, const Color& color) {
-	if (SDL_MUSTLOCK(screen)) {
-		SDL_LockSurface(screen);
+	drawBatch();
+
+	SDL_Surface *target = currentTarget();
+
+	if (SDL_MUSTLOCK(target)) {
+		SDL_LockSurface(target);
 	}
 	this->drawLine(p0.x, p0.y, p1.x, p0.y, color);
 	this->drawLine(p1.x, p0.y, p1.x, p1.y, color);
 	this->drawLine(p0.x, p0.y, p0.x, p1.y, color);
 	this->drawLine(p0.x, p1.y, p1.x, p1.y, color);
-	if (SDL_MUSTLOCK(screen)) {
-		SDL_UnlockSurface(screen);
+	if (SDL_MUSTLOCK(target)) {
+		SDL_UnlockSurface(target);
 	}
 }
 
 void SDLSoftwareRenderDevice::blankScreen() {
-	SDL_FillRect(screen, NULL, 0);
+	drawBatch();
+
+	// everything outside of the filled tiles is still blank
+	for (int row = 0; row < damage_rows; ++row) {
+		int col = 0;
+		while (col < damage_cols) {
+			if (!(damage[row * damage_cols + col] & DAMAGE_FILLED)) {
+				++col;
+				continue;
+			}
+
+			int first = col;
+			for (; col < damage_cols && (damage[row * damage_cols + col] & DAMAGE_FILLED); ++col) {
+				damage[row * damage_cols + col] = DAMAGE_DRAWN;
+			}
+
+			SDL_Rect rect = {first * SOFTWARE_DAMAGE_TILE_SIZE, row * SOFTWARE_DAMAGE_TILE_SIZE, (col - first) * SOFTWARE_DAMAGE_TILE_SIZE, SOFTWARE_DAMAGE_TILE_SIZE};
+			SDL_FillRect(screen, &rect, 0);
+		}
+	}
 	return;
 }
 
 void SDLSoftwareRenderDevice::commitFrame() {
-	SDL_UpdateTexture(texture, NULL, screen->pixels, screen->pitch);
-	SDL_RenderClear(renderer);
-	SDL_RenderCopy(renderer, texture, NULL, NULL);
-	SDL_RenderPresent(renderer);
+	drawBatch();
+
+	if (full_present || inpt->window_resized || inpt->window_exposed) {
+		SDL_UpdateTexture(texture, NULL, screen->pixels, screen->pitch);
+		memcpy(presented->pixels, screen->pixels, screen->h * screen->pitch);
+
+		for (size_t i = 0; i < damage.size(); ++i) {
+			damage[i] &= static_cast<uint8_t>(~DAMAGE_DRAWN);
+		}
+
+		full_present = false;
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+	}
+	else {
+		presentDamage();
+	}
+
 	inpt->window_resized = false;
+	inpt->window_exposed = false;
 
 	return;
 }
 
+/**
+ * Uploads the drawn tiles that differ from what was presented last, and only
+ * presents the frame if there were any
+ */
+void SDLSoftwareRenderDevice::presentDamage() {
+	bool changed = false;
+	const int bpp = screen->format->BytesPerPixel;
+
+	for (int row = 0; row < damage_rows; ++row) {
+		const int y = row * SOFTWARE_DAMAGE_TILE_SIZE;
+		const int h = std::min(SOFTWARE_DAMAGE_TILE_SIZE, screen->h - y);
+
+		int first = -1;
+		for (int col = 0; col <= damage_cols; ++col) {
+			bool tile_changed = false;
+
+			if (col < damage_cols && (damage[row * damage_cols + col] & DAMAGE_DRAWN)) {
+				damage[row * damage_cols + col] &= static_cast<uint8_t>(~DAMAGE_DRAWN);
+
+				const int x = col * SOFTWARE_DAMAGE_TILE_SIZE;
+				const size_t len = static_cast<size_t>(std::min(SOFTWARE_DAMAGE_TILE_SIZE, screen->w - x) * bpp);
+				for (int i = y; i < y + h; ++i) {
+					Uint8 *src = static_cast<Uint8 *>(screen->pixels) + i * screen->pitch + x * bpp;
+					Uint8 *dest = static_cast<Uint8 *>(presented->pixels) + i * presented->pitch + x * bpp;
+					if (memcmp(src, dest, len) != 0) {
+						memcpy(dest, src, len);
+						tile_changed = true;
+					}
+				}
+			}
+
+			if (tile_changed) {
+				if (first == -1)
+					first = col;
+			}
+			else if (first != -1) {
+				// upload the run of changed tiles that just ended
+				const int x = first * SOFTWARE_DAMAGE_TILE_SIZE;
+				SDL_Rect rect = {x, y, std::min(col * SOFTWARE_DAMAGE_TILE_SIZE, screen->w) - x, h};
+				SDL_UpdateTexture(texture, &rect, static_cast<Uint8 *>(screen->pixels) + y * screen->pitch + x * bpp, screen->pitch);
+				first = -1;
+				changed = true;
+			}
+		}
+	}
+
+	if (changed) {
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+	}
+}
+
 void SDLSoftwareRenderDevice::destroyContext() {
 	resetGamma();
 
@@ -497,6 +689,10 @@ void SDLSoftwareRenderDevice::destroyContext() {
 		SDL_FreeSurface(screen);
 		screen = NULL;
 	}
+	if (presented) {
+		SDL_FreeSurface(presented);
+		presented = NULL;
+	}
 	if (texture) {
 		SDL_DestroyTexture(texture);
 		texture = NULL;
@@ -513,6 +709,31 @@ void SDLSoftwareRenderDevice::destroyContext() {
 	return;
 }
 
+void SDLSoftwareRenderDevice::setRenderTarget(Image* image) {
+	drawBatch();
+	render_target = image ? static_cast<SDLSoftwareImage *>(image)->surface : NULL;
+}
+
+SDL_Surface* SDLSoftwareRenderDevice::currentTarget() {
+	return render_target ? render_target : screen;
+}
+
+void SDLSoftwareRenderDevice::addDamage(SDL_Surface* target, const SDL_Rect& rect) {
+	if (target != screen || rect.w <= 0 || rect.h <= 0)
+		return;
+
+	const int x0 = std::max(rect.x, 0) / SOFTWARE_DAMAGE_TILE_SIZE;
+	const int y0 = std::max(rect.y, 0) / SOFTWARE_DAMAGE_TILE_SIZE;
+	const int x1 = std::min((rect.x + rect.w - 1) / SOFTWARE_DAMAGE_TILE_SIZE, damage_cols - 1);
+	const int y1 = std::min((rect.y + rect.h - 1) / SOFTWARE_DAMAGE_TILE_SIZE, damage_rows - 1);
+
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			damage[y * damage_cols + x] = DAMAGE_DRAWN | DAMAGE_FILLED;
+		}
+	}
+}
+
 Uint32 SDLSoftwareRenderDevice::MapRGBA(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
 	return SDL_MapRGBA(screen->format, r, g, b, a);
 }
@@ -564,7 +785,7 @@ void SDLSoftwareRenderDevice::updateTitleBar() {
 	if (!window) return;
 
 	title = strdup(msg->get(WINDOW_TITLE).c_str());
-	titlebar_icon = IMG_Load(mods->locate("images/logo/icon.png").c_str());
+	titlebar_icon = IMG_Load_RW(mods->openRW(mods->locate("images/logo/icon.png")), 1);
 
 	if (title) SDL_SetWindowTitle(window, title);
 	if (titlebar_icon) SDL_SetWindowIcon(window, titlebar_icon);
@@ -579,10 +800,11 @@ Image *SDLSoftwareRenderDevice::loadImage(const std::string& filename, const std
 	// load image
 	SDLSoftwareImage *image;
 	image = NULL;
-	SDL_Surface *cleanup = IMG_Load(mods->locate(filename).c_str());
+	std::string error;
+	SDL_Surface *cleanup = decodeImage(filename, error);
 	if(!cleanup) {
 		if (!errormessage.empty())
-			logError("SDLSoftwareRenderDevice: [%s] %s: %s", filename.c_str(), errormessage.c_str(), IMG_GetError());
+			logError("SDLSoftwareRenderDevice: [%s] %s: %s", filename.c_str(), errormessage.c_str(), error.c_str());
 		if (IfNotFoundExit) {
 			mods->resetModConfig();
 			Exit(1);
@@ -590,8 +812,7 @@ Image *SDLSoftwareRenderDevice::loadImage(const std::string& filename, const std
 	}
 	else {
 		image = new SDLSoftwareImage(this);
-		image->surface = SDL_ConvertSurfaceFormat(cleanup, SDL_PIXELFORMAT_ARGB8888, 0);
-		SDL_FreeSurface(cleanup);
+		image->surface = convertImage(cleanup);
 	}
 
 	// store image to cache
@@ -599,6 +820,62 @@ Image *SDLSoftwareRenderDevice::loadImage(const std::string& filename, const std
 	return image;
 }
 
+/**
+ * Images are ARGB8888. With render_16bit, images without soft edges are stored as RGB565
+ * instead, the format of the screen, so that drawing them is a plain copy. Their fully
+ * transparent pixels become a color key. Images with soft edges stay ARGB8888 and are
+ * blended onto the screen.
+ */
+SDL_Surface* SDLSoftwareRenderDevice::convertImage(SDL_Surface* decoded) {
+	SDL_Surface *argb = SDL_ConvertSurfaceFormat(decoded, SDL_PIXELFORMAT_ARGB8888, 0);
+	SDL_FreeSurface(decoded);
+
+	if (!argb || !RENDER_16BIT || SDL_MUSTLOCK(argb))
+		return argb;
+
+	bool transparent = false;
+	for (int y = 0; y < argb->h; ++y) {
+		const Uint32 *row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(argb->pixels) + y * argb->pitch);
+		for (int x = 0; x < argb->w; ++x) {
+			const Uint32 a = row[x] >> 24;
+			if (a == 0)
+				transparent = true;
+			else if (a != 255)
+				return argb;
+		}
+	}
+
+	Uint32 rmask, gmask, bmask, amask;
+	int bpp = 16;
+	SDL_PixelFormatEnumToMasks(SDL_PIXELFORMAT_RGB565, &bpp, &rmask, &gmask, &bmask, &amask);
+	SDL_Surface *rgb = SDL_CreateRGBSurface(0, argb->w, argb->h, bpp, rmask, gmask, bmask, amask);
+	if (!rgb)
+		return argb;
+
+	for (int y = 0; y < argb->h; ++y) {
+		const Uint32 *src = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(argb->pixels) + y * argb->pitch);
+		Uint16 *dest = reinterpret_cast<Uint16*>(static_cast<Uint8*>(rgb->pixels) + y * rgb->pitch);
+		for (int x = 0; x < argb->w; ++x) {
+			const Uint32 s = src[x];
+			if ((s >> 24) == 0) {
+				dest[x] = SOFTWARE_COLOR_KEY_565;
+				continue;
+			}
+
+			Uint16 pixel = static_cast<Uint16>(((s >> 8) & 0xf800) | ((s >> 5) & 0x07e0) | ((s >> 3) & 0x001f));
+			if (pixel == SOFTWARE_COLOR_KEY_565)
+				pixel--;
+			dest[x] = pixel;
+		}
+	}
+
+	if (transparent)
+		SDL_SetColorKey(rgb, SDL_TRUE, SOFTWARE_COLOR_KEY_565);
+
+	SDL_FreeSurface(argb);
+	return rgb;
+}
+
 void SDLSoftwareRenderDevice::setSDL_RGBA(Uint32 *rmask, Uint32 *gmask, Uint32 *bmask, Uint32 *amask) {
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
 	*rmask = 0xff000000;
@@ -613,6 +890,39 @@ void SDLSoftwareRenderDevice::setSDL_RGBA(Uint32 *rmask, Uint32 *gmask, Uint32 *
 #endif
 }
 
+/**
+ * Every blit would have to be scaled in software, which costs more than it saves,
+ * so the world is always drawn at full resolution
+ */
+void SDLSoftwareRenderDevice::beginWorld() {
+}
+
+void SDLSoftwareRenderDevice::endWorld() {
+}
+
+int SDLSoftwareRenderDevice::getVsyncRate() {
+	if (!window || !renderer)
+		return 0;
+
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(renderer, &info) != 0 || !(info.flags & SDL_RENDERER_PRESENTVSYNC))
+		return 0;
+
+	SDL_DisplayMode mode;
+	if (SDL_GetWindowDisplayMode(window, &mode) != 0)
+		return 0;
+
+	return mode.refresh_rate;
+}
+
+/**
+ * The images are surfaces in memory, so only the streaming texture has to be created again
+ */
+void SDLSoftwareRenderDevice::restoreContext(bool device_lost) {
+	if (device_lost)
+		windowResize();
+}
+
 void SDLSoftwareRenderDevice::windowResize() {
 	int w,h;
 	SDL_GetWindowSize(window, &w, &h);
@@ -641,12 +951,23 @@ void SDLSoftwareRenderDevice::windowResize() {
 
 	if (texture) SDL_DestroyTexture(texture);
 	if (screen) SDL_FreeSurface(screen);
+	if (presented) SDL_FreeSurface(presented);
+
+	// a 16-bit screen halves the memory every blit and upload goes through
+	const Uint32 screen_format = RENDER_16BIT ? SDL_PIXELFORMAT_RGB565 : SDL_PIXELFORMAT_ARGB8888;
 
 	Uint32 rmask, gmask, bmask, amask;
 	int bpp = static_cast<int>(BITS_PER_PIXEL);
-	SDL_PixelFormatEnumToMasks(SDL_PIXELFORMAT_ARGB8888, &bpp, &rmask, &gmask, &bmask, &amask);
+	SDL_PixelFormatEnumToMasks(screen_format, &bpp, &rmask, &gmask, &bmask, &amask);
 	screen = SDL_CreateRGBSurface(0, VIEW_W, VIEW_H, bpp, rmask, gmask, bmask, amask);
-	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, VIEW_W, VIEW_H);
+	presented = SDL_CreateRGBSurface(0, VIEW_W, VIEW_H, bpp, rmask, gmask, bmask, amask);
+	texture = SDL_CreateTexture(renderer, screen_format, SDL_TEXTUREACCESS_STREAMING, VIEW_W, VIEW_H);
+
+	// the new screen is blank, and the texture has to be uploaded in full
+	damage_cols = (VIEW_W + SOFTWARE_DAMAGE_TILE_SIZE - 1) / SOFTWARE_DAMAGE_TILE_SIZE;
+	damage_rows = (VIEW_H + SOFTWARE_DAMAGE_TILE_SIZE - 1) / SOFTWARE_DAMAGE_TILE_SIZE;
+	damage.assign(damage_cols * damage_rows, 0);
+	full_present = true;
 
 	updateScreenVars();
 }
@@ -39,6 +39,12 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  */
 
 
+// the screen is split into square tiles of this size to track which parts of it have changed
+const int SOFTWARE_DAMAGE_TILE_SIZE = 32;
+
+// the color key of RGB565 images; opaque pixels of this color are moved to the next shade of blue
+const Uint16 SOFTWARE_COLOR_KEY_565 = 0xf81f;
+
 /** SDL Image */
 class SDLSoftwareImage : public Image {
 public:
@@ -50,6 +56,7 @@ public:
 	void fillWithColor(const Color& color);
 	void drawPixel(int x, int y, const Color& color);
 	Image* resize(int width, int height);
+	void setPixels(const Rect& area, const uint32_t* pixels, int pitch);
 
 	SDL_Surface *surface;
 
@@ -67,6 +74,7 @@ public:
 	virtual int render(Renderable& r, Rect& dest);
 	virtual int render(Sprite* r);
 	virtual int renderToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest);
+	virtual int copyToImage(Image* src_image, Rect& src, Image* dest_image, Rect& dest);
 
 	int renderText(FontStyle *font_style, const std::string& text, const Color& color, Rect& dest);
 	Image* renderTextToImage(FontStyle* font_style, const std::string& text, const Color& color, bool blended = true);
@@ -76,6 +84,11 @@ public:
 	void commitFrame();
 	void destroyContext();
 	void windowResize();
+	void restoreContext(bool device_lost);
+	void setRenderTarget(Image* image);
+	int getVsyncRate();
+	void beginWorld();
+	void endWorld();
 	Image *createImage(int width, int height);
 	void setGamma(float g);
 	void resetGamma();
@@ -84,15 +97,42 @@ public:
 	Image* loadImage(const std::string& filename,
 					 const std::string& errormessage = "Couldn't load image",
 					 bool IfNotFoundExit = false);
+protected:
+	void renderBatch(std::vector<RenderBatchItem>& items);
+	SDL_Surface* currentTarget();
+
+	// marks the area as changed if target is the screen
+	void addDamage(SDL_Surface* target, const SDL_Rect& rect);
+
+	// converts a decoded image to the format it is drawn from, and frees the decoded one
+	SDL_Surface* convertImage(SDL_Surface* decoded);
+
+	SDL_Surface* screen;
+
 private:
+	enum {
+		DAMAGE_DRAWN = 1, // changed since the last commitFrame()
+		DAMAGE_FILLED = 2 // changed since the last blankScreen()
+	};
+
+	void presentDamage();
+
 	Uint32 MapRGBA(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
 	void drawLine(int x0, int y0, int x1, int y1, const Color& color);
 	void setSDL_RGBA(Uint32 *rmask, Uint32 *gmask, Uint32 *bmask, Uint32 *amask);
 
-	SDL_Surface* screen;
+	SDL_Surface* render_target;
 	SDL_Window* window;
 	SDL_Renderer* renderer;
 	SDL_Texture* texture;
+
+	// a copy of what the texture holds, to find out which of the drawn tiles actually changed
+	SDL_Surface* presented;
+	bool full_present;
+	int damage_cols;
+	int damage_rows;
+	std::vector<uint8_t> damage;
+
 	SDL_Surface* titlebar_icon;
 	char* title;
 };
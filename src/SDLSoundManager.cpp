@@ -24,6 +24,9 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 **/
 
 #include "CommonIncludes.h"
+#include "FrameArena.h"
+#include "MemoryUsage.h"
+#include "Profiler.h"
 #include "Settings.h"
 #include "SharedResources.h"
 #include "SDLSoundManager.h"
@@ -32,19 +35,24 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <locale>
 #include <math.h>
 
-class Sound {
-public:
-	Mix_Chunk *chunk;
-	Sound() :  chunk(0), refCnt(0) {}
-private:
-	friend class SDLSoundManager;
-	int refCnt;
-};
+void SDLSoundCache::freeResource(Mix_Chunk *chunk) {
+	// sounds that are still being decoded have no chunk yet
+	if (chunk)
+		Mix_FreeChunk(chunk);
+}
 
 SDLSoundManager::SDLSoundManager()
 	: SoundManager()
 	, music(NULL)
 	, music_filename("")
+	, music_thread(NULL)
+	, music_thread_filename("")
+	, music_thread_path("")
+	, music_thread_error("")
+	, music_thread_result(NULL)
+	, next_music(NULL)
+	, next_music_filename("")
+	, music_request("")
 	, last_played_sid(-1)
 {
 	if (AUDIO && Mix_OpenAudio(22050, AUDIO_S16SYS, 2, 1024)) {
@@ -52,29 +60,42 @@ SDLSoundManager::SDLSoundManager()
 		AUDIO = false;
 	}
 
-	Mix_AllocateChannels(128);
+	SDL_AtomicSet(&music_thread_done, 0);
+
+	Mix_AllocateChannels(SOUND_VOICES_MAX);
 	setVolumeSFX(SOUND_VOLUME);
 }
 
 SDLSoundManager::~SDLSoundManager() {
 	unloadMusic();
 
-	SDLSoundManager::SoundMapIterator it;
-	while((it = sounds.begin()) != sounds.end())
-		unload(it->first);
+	if (music_thread) {
+		SDL_WaitThread(music_thread, NULL);
+		music_thread = NULL;
+		if (music_thread_result) Mix_FreeMusic(music_thread_result);
+	}
+	if (next_music) Mix_FreeMusic(next_music);
+
+	decoder.clear();
+	pending.clear();
+	sounds.clear();
 
 	Mix_CloseAudio();
 }
 
 void SDLSoundManager::logic(const FPoint& center) {
 
+	finishDecodedLoads();
+	frame_sids.clear();
+
+	lastPos = center;
+
 	PlaybackMapIterator it = playback.begin();
 	if (it == playback.end())
 		return;
 
-	lastPos = center;
-
-	std::vector<int> cleanup;
+	std::vector<int, FrameAllocator<int> > cleanup;
+	cleanup.reserve(playback.size());
 
 	while(it != playback.end()) {
 
@@ -116,20 +137,88 @@ void SDLSoundManager::logic(const FPoint& center) {
 
 	/* clenaup finished soundplayback */
 	while (!cleanup.empty()) {
+		removePlayback(playback.find(cleanup.back()));
+		cleanup.pop_back();
+	}
+}
 
-		it = playback.find(cleanup.back());
+void SDLSoundManager::removePlayback(PlaybackMapIterator it) {
+	unload(it->second.sid);
 
-		unload(it->second.sid);
+	/* find and erase virtual channel for playback if exists */
+	VirtualChannelMapIterator vcit = channels.find(it->second.virtual_channel);
+	if (vcit != channels.end() && vcit->second == it->first)
+		channels.erase(vcit);
 
-		/* find and erase virtual channel for playback if exists */
-		VirtualChannelMapIterator vcit = channels.find(it->second.virtual_channel);
-		if (vcit != channels.end())
-			channels.erase(vcit);
+	playback.erase(it);
+}
 
-		playback.erase(it);
+/**
+ * How much a sound at pos matters, from 0 (out of hearing range) upwards.
+ * Sounds without a location, like the ones of menus, always win over positional ones.
+ */
+float SDLSoundManager::getPriority(const FPoint& pos) {
+	if (pos.x == 0 && pos.y == 0)
+		return 2;
+
+	float v = calcDist(lastPos, pos) / static_cast<float>(SOUND_FALLOFF);
+	return std::max<float>(1 - v, 0);
+}
 
-		cleanup.pop_back();
+/**
+ * Makes room for a new voice of sid. If the voice budget or the limit for sid
+ * is used up, the least important one-shot sound is stopped, but only if it
+ * matters less than the new one. Looped sounds are never stopped.
+ * Returns false if the new sound shouldn't be played.
+ */
+bool SDLSoundManager::reserveVoice(SoundManager::SoundID sid, float priority) {
+	int voices = 0;
+	int instances = 0;
+	PlaybackMapIterator lowest_voice = playback.end();
+	PlaybackMapIterator lowest_instance = playback.end();
+	float lowest_voice_priority = 0;
+	float lowest_instance_priority = 0;
+
+	for (PlaybackMapIterator it = playback.begin(); it != playback.end(); ++it) {
+		if (it->second.finished)
+			continue;
+
+		++voices;
+		if (it->second.sid == sid)
+			++instances;
+
+		if (it->second.loop)
+			continue;
+
+		float p = getPriority(it->second.location);
+		if (lowest_voice == playback.end() || p < lowest_voice_priority) {
+			lowest_voice = it;
+			lowest_voice_priority = p;
+		}
+		if (it->second.sid == sid && (lowest_instance == playback.end() || p < lowest_instance_priority)) {
+			lowest_instance = it;
+			lowest_instance_priority = p;
+		}
+	}
+
+	PlaybackMapIterator victim = playback.end();
+	if (instances >= SOUND_INSTANCES_MAX) {
+		if (lowest_instance == playback.end() || lowest_instance_priority >= priority)
+			return false;
+		victim = lowest_instance;
+	}
+	else if (voices >= SOUND_VOICES_MAX) {
+		if (lowest_voice == playback.end() || lowest_voice_priority >= priority)
+			return false;
+		victim = lowest_voice;
 	}
+
+	if (victim != playback.end()) {
+		Mix_HaltChannel(victim->first);
+		removePlayback(victim);
+	}
+
+	return true;
 }
 
 void SDLSoundManager::reset() {
@@ -150,9 +239,7 @@ void SDLSoundManager::reset() {
 
 SoundManager::SoundID SDLSoundManager::load(const std::string& filename, const std::string& errormessage) {
 
-	Sound lsnd;
 	SoundID sid = 0;
-	SoundMapIterator it;
 	std::locale loc;
 
 	if (!AUDIO)
@@ -163,48 +250,85 @@ SoundManager::SoundID SDLSoundManager::load(const std::string& filename, const s
 
 	/* create sid hash and check if already loaded */
 	sid = coll.hash(realfilename.data(), realfilename.data()+realfilename.length());
-	it = sounds.find(sid);
-	if (it != sounds.end()) {
-		it->second->refCnt++;
+	if (sounds.ref(sid))
 		return sid;
-	}
 
-	/* load non existing sound */
-	lsnd.chunk = Mix_LoadWAV(realfilename.c_str());
-	lsnd.refCnt = 1;
-	if (!lsnd.chunk) {
-		logError("SoundManager: %s: Loading sound %s (%s) failed: %s", errormessage.c_str(),
-				realfilename.c_str(), filename.c_str(), Mix_GetError());
-		return 0;
-	}
+	/* decode the sound in the background; the cache entry gets its chunk once that's done */
+	sounds.add(sid, NULL, 0)->refs = 1;
+	sound_names[sid] = filename;
 
-	/* instantiate and add sound to manager */
-	Sound *psnd = new Sound;
-	*psnd = lsnd;
-	sounds.insert(std::pair<SoundID,Sound *>(sid, psnd));
+	SDLPendingSound &p = pending[sid];
+	p.filename = filename;
+	p.path = realfilename;
+	p.errormessage = errormessage;
+
+	decoder.request(sid, realfilename);
 
 	return sid;
 }
 
-void SDLSoundManager::unload(SoundManager::SoundID sid) {
+void SDLSoundManager::finishLoad(PendingMapIterator it) {
+	std::string error;
+	Mix_Chunk *chunk = decoder.take(it->first, it->second.path, error);
 
-	SoundMapIterator it;
-	it = sounds.find(sid);
-	if (it == sounds.end())
-		return;
+	SDLSoundCache::Entry *sound = sounds.get(it->first);
+	if (!chunk) {
+		logError("SoundManager: %s: Loading sound %s (%s) failed: %s", it->second.errormessage.c_str(),
+				it->second.path.c_str(), it->second.filename.c_str(), error.c_str());
+		if (sound)
+			sounds.remove(it->first);
+	}
+	else if (!sound) {
+		/* every user unloaded the sound while it was being decoded */
+		Mix_FreeChunk(chunk);
+	}
+	else {
+		sound->resource = chunk;
+		sounds.setBytes(sound, chunk->alen);
+	}
+
+	pending.erase(it);
+}
 
-	if (--it->second->refCnt == 0) {
-		Mix_FreeChunk(it->second->chunk);
-		delete it->second;
-		sounds.erase(it);
+void SDLSoundManager::finishDecodedLoads() {
+	bool finished = false;
+
+	PendingMapIterator it = pending.begin();
+	while (it != pending.end()) {
+		PendingMapIterator next = it;
+		++next;
+
+		if (!decoder.isPending(it->first)) {
+			finishLoad(it);
+			finished = true;
+		}
+
+		it = next;
 	}
+
+	if (finished)
+		sounds.trim(static_cast<size_t>(SOUND_CACHE_MB) * 1024 * 1024);
+}
+
+void SDLSoundManager::finishLoads() {
+	/* sounds the decoder hasn't started yet are decoded right here */
+	while (!pending.empty())
+		finishLoad(pending.begin());
+
+	sounds.trim(static_cast<size_t>(SOUND_CACHE_MB) * 1024 * 1024);
+}
+
+void SDLSoundManager::unload(SoundManager::SoundID sid) {
+
+	/* unused sounds are kept around until the cache goes over budget */
+	if (sounds.unref(sid))
+		sounds.trim(static_cast<size_t>(SOUND_CACHE_MB) * 1024 * 1024);
 }
 
 
 
 void SDLSoundManager::play(SoundManager::SoundID sid, std::string channel, const FPoint& pos, bool loop) {
 
-	SoundMapIterator it;
 	VirtualChannelMapIterator vcit = channels.end();
 
 	// since last_played_sid is primarily used for subtitles, it doesn't make sense to count looped sounds
@@ -214,8 +338,35 @@ void SDLSoundManager::play(SoundManager::SoundID sid, std::string channel, const
 	if (!sid || !AUDIO || !SOUND_VOLUME)
 		return;
 
-	it = sounds.find(sid);
-	if (it == sounds.end())
+	/* only sounds played right after loading still need to be waited for */
+	PendingMapIterator pit = pending.find(sid);
+	if (pit != pending.end())
+		finishLoad(pit);
+
+	SDLSoundCache::Entry *sound = sounds.get(sid);
+	if (!sound || !sound->resource)
+		return;
+
+	float priority = getPriority(pos);
+	if (!loop) {
+		/* one-shot sounds out of hearing range are dropped before they take a channel */
+		if (priority <= 0)
+			return;
+
+		/* identical sounds triggered in the same frame are only played once */
+		if (channel == GLOBAL_VIRTUAL_CHANNEL) {
+			if (std::find(frame_sids.begin(), frame_sids.end(), sid) != frame_sids.end())
+				return;
+			frame_sids.push_back(sid);
+		}
+	}
+
+	if (!reserveVoice(sid, priority))
+		return;
+
+	/* stopping another sound may have evicted this one if it had no users */
+	sound = sounds.get(sid);
+	if (!sound)
 		return;
 
 	/* create playback object and start playback of sound chunk */
@@ -238,13 +389,24 @@ void SDLSoundManager::play(SoundManager::SoundID sid, std::string channel, const
 
 	// Let playback own a reference to prevent unloading playbacked sound.
 	if (!loop)
-		it->second->refCnt++;
+		sound->refs++;
 
 	Mix_ChannelFinished(&channel_finished);
-	int c = Mix_PlayChannel(-1, it->second->chunk, (loop ? -1 : 0));
+	int c = Mix_PlayChannel(-1, sound->resource, (loop ? -1 : 0));
 
-	if (c == -1)
+	if (c == -1) {
 		logError("SoundManager: Failed to play sound, no more channels available.");
+		if (!loop)
+			sound->refs--;
+		if (vcit != channels.end())
+			channels.erase(vcit);
+		return;
+	}
+
+	/* a stopped sound may not have been cleaned up yet when its channel gets reused */
+	PlaybackMapIterator stale = playback.find(c);
+	if (stale != playback.end())
+		removePlayback(stale);
 
 	// precalculate mixing volume if sound has a location
 	Uint8 d = 0;
@@ -290,29 +452,125 @@ void SDLSoundManager::setVolumeSFX(int value) {
 	Mix_Volume(-1, value);
 }
 
+/**
+ * Switch to the music in filename. The file is opened on a background thread,
+ * and updateMusic() fades over to it once it's ready.
+ */
 void SDLSoundManager::loadMusic(const std::string& filename) {
 	if (!AUDIO)
 		return;
 
 	if (filename == music_filename) {
-		if (!isPlayingMusic())
+		music_request = "";
+		if (!isPlayingMusic() || Mix_FadingMusic() == MIX_FADING_OUT)
 			playMusic();
 		return;
 	}
 
-	unloadMusic();
+	if (filename == "") {
+		unloadMusic();
+		return;
+	}
+
+	music_request = filename;
+	updateMusic();
+}
 
-	if (filename == "")
+/**
+ * Open the music in filename ahead of time, so that a later loadMusic() can switch to it right away
+ */
+void SDLSoundManager::preloadMusic(const std::string& filename) {
+	if (!AUDIO || filename.empty() || filename == music_filename || filename == next_music_filename)
 		return;
 
-	music = Mix_LoadMUS(mods->locate(filename).c_str());
-	if (music) {
-		music_filename = filename;
-		playMusic();
+	startMusicLoad(filename);
+}
+
+int SDLSoundManager::runMusicLoad(void *data) {
+	SDLSoundManager *manager = static_cast<SDLSoundManager*>(data);
+
+	{
+		ProfileScope scope(PROFILE_MUSIC_LOAD);
+		manager->music_thread_result = Mix_LoadMUS_RW(mods->openRW(manager->music_thread_path), 1);
+		manager->music_thread_error = manager->music_thread_result ? "" : Mix_GetError();
 	}
-	else {
-		logError("SoundManager: Couldn't load music file '%s': %s", filename.c_str(), Mix_GetError());
+
+	SDL_AtomicSet(&manager->music_thread_done, 1);
+	return 0;
+}
+
+void SDLSoundManager::startMusicLoad(const std::string& filename) {
+	// only one file is opened at a time; updateMusic() starts the requested one afterwards
+	if (music_thread)
+		return;
+
+	music_thread_filename = filename;
+	music_thread_result = NULL;
+	music_thread_error = "";
+	SDL_AtomicSet(&music_thread_done, 0);
+
+	// mods->locate() caches its results, so it is only called from the main thread
+	music_thread_path = mods->locate(filename);
+
+	music_thread = SDL_CreateThread(runMusicLoad, "MusicLoader", this);
+	if (!music_thread) {
+		logError("SoundManager: Could not create thread: %s", SDL_GetError());
+		runMusicLoad(this);
+		finishMusicLoad();
+	}
+}
+
+void SDLSoundManager::finishMusicLoad() {
+	if (music_thread) {
+		SDL_WaitThread(music_thread, NULL);
+		music_thread = NULL;
+	}
+
+	if (next_music) Mix_FreeMusic(next_music);
+	next_music = music_thread_result;
+	next_music_filename = music_thread_filename;
+	music_thread_result = NULL;
+
+	if (!next_music)
+		logError("SoundManager: Couldn't load music file '%s': %s", music_thread_filename.c_str(), music_thread_error.c_str());
+}
+
+void SDLSoundManager::updateMusic() {
+	if (!AUDIO)
+		return;
+
+	if (music_thread && SDL_AtomicGet(&music_thread_done))
+		finishMusicLoad();
+
+	if (music_request.empty())
+		return;
+
+	if (next_music_filename != music_request) {
+		startMusicLoad(music_request);
+		return;
+	}
+
+	if (!next_music) {
+		music_request = "";
+		return;
+	}
+
+	/* let the current music fade out before the next one starts */
+	if (music && Mix_PlayingMusic() && !Mix_PausedMusic()) {
+		if (Mix_FadingMusic() != MIX_FADING_OUT)
+			Mix_FadeOutMusic(MUSIC_FADE_MS);
+		return;
 	}
+
+	unloadMusic();
+
+	music = next_music;
+	music_filename = next_music_filename;
+	next_music = NULL;
+	next_music_filename = "";
+
+	Mix_VolumeMusic(MUSIC_VOLUME);
+	Mix_FadeInMusic(music, -1, MUSIC_FADE_MS);
 }
 
 void SDLSoundManager::unloadMusic() {
@@ -330,6 +588,8 @@ void SDLSoundManager::playMusic() {
 }
 
 void SDLSoundManager::stopMusic() {
+	music_request = "";
+
 	if (!AUDIO || !music) return;
 
 	Mix_HaltMusic();
@@ -342,7 +602,8 @@ void SDLSoundManager::setVolumeMusic(int value) {
 }
 
 bool SDLSoundManager::isPlayingMusic() {
-	return (AUDIO && music && MUSIC_VOLUME > 0 && Mix_PlayingMusic());
+	// music that is about to be switched to counts as playing
+	return (AUDIO && MUSIC_VOLUME > 0 && (!music_request.empty() || (music && Mix_PlayingMusic())));
 }
 
 SoundManager::SoundID SDLSoundManager::getLastPlayedSID() {
@@ -350,3 +611,14 @@ SoundManager::SoundID SDLSoundManager::getLastPlayedSID() {
 	last_played_sid = -1;
 	return ret;
 }
+
+size_t SDLSoundManager::getCacheBytes() {
+	return sounds.getTotalBytes();
+}
+
+void SDLSoundManager::getMemoryUsage(MemoryUsage& usage) {
+	for (SDLSoundCache::const_iterator it = sounds.begin(); it != sounds.end(); ++it) {
+		std::map<SoundID, std::string>::const_iterator name = sound_names.find(it->first);
+		usage.add(name != sound_names.end() ? name->second : "?", it->second.bytes);
+	}
+}
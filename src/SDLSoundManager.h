@@ -25,8 +25,32 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include <SDL_mixer.h>
 
+#include "ResourceCache.h"
+#include "SoundDecoder.h"
 #include "SoundManager.h"
 
+class SDLSoundCache : public ResourceCache<SoundManager::SoundID, Mix_Chunk*> {
+protected:
+	void freeResource(Mix_Chunk *chunk);
+};
+
+// the most sounds that are mixed at once
+const int SOUND_VOICES_MAX = 32;
+
+// the most copies of one sound that are mixed at once
+const int SOUND_INSTANCES_MAX = 4;
+
+// time for the old music to fade out and the new one to fade in, in milliseconds
+const int MUSIC_FADE_MS = 500;
+
+// a sound that is still being decoded; its cache entry has no chunk yet
+class SDLPendingSound {
+public:
+	std::string filename;
+	std::string path;
+	std::string errormessage;
+};
+
 class SDLSoundManager : public SoundManager {
 public:
 	SDLSoundManager();
@@ -40,38 +64,78 @@ public:
 	void setVolumeSFX(int value);
 
 	void loadMusic(const std::string& filename);
+	void preloadMusic(const std::string& filename);
 	void unloadMusic();
 	void playMusic();
 	void stopMusic();
 	void setVolumeMusic(int value);
 	bool isPlayingMusic();
+	void updateMusic();
 
 	void logic(const FPoint& center);
 	void reset();
+	void finishLoads();
 
 	SoundManager::SoundID getLastPlayedSID();
+	size_t getCacheBytes();
+	void getMemoryUsage(MemoryUsage& usage);
 
 private:
 	typedef std::map<std::string, int> VirtualChannelMap;
 	typedef VirtualChannelMap::iterator VirtualChannelMapIterator;
 
-	typedef std::map<SoundID, class Sound *> SoundMap;
-	typedef SoundMap::iterator SoundMapIterator;
-
 	typedef std::map<int, class Playback> PlaybackMap;
 	typedef PlaybackMap::iterator PlaybackMapIterator;
 
+	typedef std::map<SoundManager::SoundID, SDLPendingSound> PendingMap;
+	typedef PendingMap::iterator PendingMapIterator;
+
+	// moves the decoded chunk into the cache, waiting for it if needed
+	void finishLoad(PendingMapIterator it);
+	void finishDecodedLoads();
+
+	void removePlayback(PlaybackMapIterator it);
+	float getPriority(const FPoint& pos);
+	bool reserveVoice(SoundManager::SoundID sid, float priority);
+
+	static int runMusicLoad(void *data);
+	void startMusicLoad(const std::string& filename);
+	void finishMusicLoad();
+
 	static void channel_finished(int channel);
 	void on_channel_finished(int channel);
 
-	SoundMap sounds;
+	SDLSoundCache sounds;
+	SoundDecoder decoder;
+
+	// the filenames of loaded sounds, for the memory report
+	std::map<SoundID, std::string> sound_names;
+	PendingMap pending;
 	VirtualChannelMap channels;
 	PlaybackMap playback;
+
+	// sounds that were started in the current frame
+	std::vector<SoundID> frame_sids;
 	FPoint lastPos;
 
 	Mix_Music* music;
 	std::string music_filename;
 
+	// music that is opened on a background thread
+	SDL_Thread *music_thread;
+	SDL_atomic_t music_thread_done;
+	std::string music_thread_filename;
+	std::string music_thread_path;
+	std::string music_thread_error;
+	Mix_Music* music_thread_result;
+
+	// opened music that isn't playing yet
+	Mix_Music* next_music;
+	std::string next_music_filename;
+
+	// the music that should play once it's opened and the current one has faded out
+	std::string music_request;
+
 	SoundID last_played_sid;
 };
 
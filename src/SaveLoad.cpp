@@ -48,13 +48,124 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsParsing.h"
 #include "SharedGameResources.h"
 
+SavePreview::SavePreview()
+	: xp(0)
+	, permadeath(false) {
+}
+
+void SavePreview::writeInt(std::string& out, unsigned long value) {
+	// stored as 4 bytes, little endian
+	for (int i = 0; i < 4; ++i) {
+		out += static_cast<char>(value & 0xff);
+		value >>= 8;
+	}
+}
+
+void SavePreview::writeString(std::string& out, const std::string& s) {
+	writeInt(out, static_cast<unsigned long>(s.size()));
+	out += s;
+}
+
+bool SavePreview::readInt(const std::string& in, size_t& pos, unsigned long& value) {
+	if (pos + 4 > in.size())
+		return false;
+
+	value = 0;
+	for (int i = 3; i >= 0; --i) {
+		value = (value << 8) | static_cast<unsigned char>(in[pos + static_cast<size_t>(i)]);
+	}
+	pos += 4;
+	return true;
+}
+
+bool SavePreview::readString(const std::string& in, size_t& pos, std::string& s) {
+	unsigned long size;
+	if (!readInt(in, pos, size) || pos + size > in.size())
+		return false;
+
+	s = in.substr(pos, size);
+	pos += size;
+	return true;
+}
+
+std::string SavePreview::write() const {
+	std::string out = "FSP";
+	writeInt(out, SAVE_PREVIEW_VERSION);
+
+	writeString(out, name);
+	writeString(out, character_class);
+	writeString(out, character_subclass);
+	writeInt(out, xp);
+
+	writeInt(out, static_cast<unsigned long>(primary.size()));
+	for (size_t i = 0; i < primary.size(); ++i)
+		writeInt(out, static_cast<unsigned long>(primary[i]));
+
+	writeString(out, gfx_base);
+	writeString(out, gfx_head);
+	writeString(out, gfx_portrait);
+	writeInt(out, permadeath);
+	writeString(out, spawn_map);
+	writeString(out, map_title);
+
+	writeInt(out, static_cast<unsigned long>(equipped.size()));
+	for (size_t i = 0; i < equipped.size(); ++i)
+		writeInt(out, static_cast<unsigned long>(equipped[i]));
+
+	return out;
+}
+
+bool SavePreview::read(const std::string& filename) {
+	std::string in;
+	if (!readFile(filename, in))
+		return false;
+
+	size_t pos = 3;
+	unsigned long value;
+
+	if (in.compare(0, 3, "FSP") != 0 || !readInt(in, pos, value) || value != SAVE_PREVIEW_VERSION)
+		return false;
+
+	if (!readString(in, pos, name) || !readString(in, pos, character_class) || !readString(in, pos, character_subclass) || !readInt(in, pos, xp))
+		return false;
+
+	if (!readInt(in, pos, value))
+		return false;
+	primary.resize(value);
+	for (size_t i = 0; i < primary.size(); ++i) {
+		if (!readInt(in, pos, value))
+			return false;
+		primary[i] = static_cast<int>(value);
+	}
+
+	if (!readString(in, pos, gfx_base) || !readString(in, pos, gfx_head) || !readString(in, pos, gfx_portrait) || !readInt(in, pos, value))
+		return false;
+	permadeath = (value != 0);
+
+	if (!readString(in, pos, spawn_map) || !readString(in, pos, map_title) || !readInt(in, pos, value))
+		return false;
+	equipped.resize(value);
+	for (size_t i = 0; i < equipped.size(); ++i) {
+		if (!readInt(in, pos, value))
+			return false;
+		equipped[i] = static_cast<int>(value);
+	}
+
+	return true;
+}
+
 SaveLoad::SaveLoad()
-	: game_slot(0) {
+	: game_slot(0)
+	, writer() {
 }
 
 SaveLoad::~SaveLoad() {
 }
 
+void SaveLoad::waitForSave() {
+	writer.wait();
+}
+
 /**
  * Before exiting the game, save to file
  */
@@ -62,6 +173,15 @@ void SaveLoad::saveGame() {
 
 	if (game_slot <= 0) return;
 
+	// replays start from a save, so it must not change
+	if (replay && replay->isPlaying()) return;
+
+	// a benchmark leaves the save as it found it
+	if (!BENCHMARK_RENDER.empty()) return;
+
+	// the stress scene map only exists in memory
+	if (stress && stress->isActive()) return;
+
 	// if needed, create the save file structure
 	createSaveDir(game_slot);
 
@@ -69,134 +189,144 @@ void SaveLoad::saveGame() {
 	menu->inv->inventory[EQUIPMENT].clean();
 	menu->inv->inventory[CARRIED].clean();
 
-	std::ofstream outfile;
+	// the files are written by a background thread, only their contents are created here
+	std::stringstream outfile;
 
 	std::stringstream ss;
 	ss << PATH_USER << "saves/" << SAVE_PREFIX << "/" << game_slot << "/avatar.txt";
 
-	outfile.open(path(&ss).c_str(), std::ios::out);
-
-	if (outfile.is_open()) {
+	// comment
+	outfile << "## flare-engine save file ##" << "\n";
 
-		// comment
-		outfile << "## flare-engine save file ##" << "\n";
+	// hero name
+	outfile << "name=" << pc->stats.name << "\n";
 
-		// hero name
-		outfile << "name=" << pc->stats.name << "\n";
+	// permadeath
+	outfile << "permadeath=" << pc->stats.permadeath << "\n";
 
-		// permadeath
-		outfile << "permadeath=" << pc->stats.permadeath << "\n";
+	// hero visual option
+	outfile << "option=" << pc->stats.gfx_base << "," << pc->stats.gfx_head << "," << pc->stats.gfx_portrait << "\n";
 
-		// hero visual option
-		outfile << "option=" << pc->stats.gfx_base << "," << pc->stats.gfx_head << "," << pc->stats.gfx_portrait << "\n";
+	// hero class
+	outfile << "class=" << pc->stats.character_class << "," << pc->stats.character_subclass << "\n";
 
-		// hero class
-		outfile << "class=" << pc->stats.character_class << "," << pc->stats.character_subclass << "\n";
+	// current experience
+	outfile << "xp=" << pc->stats.xp << "\n";
 
-		// current experience
-		outfile << "xp=" << pc->stats.xp << "\n";
+	// hp and mp
+	if (SAVE_HPMP) outfile << "hpmp=" << pc->stats.hp << "," << pc->stats.mp << "\n";
 
-		// hp and mp
-		if (SAVE_HPMP) outfile << "hpmp=" << pc->stats.hp << "," << pc->stats.mp << "\n";
-
-		// stat spec
-		outfile << "build=";
-		for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
-			outfile << pc->stats.primary[i];
-			if (i < PRIMARY_STATS.size() - 1)
-				outfile << ",";
+	// stat spec
+	outfile << "build=";
+	for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
+		outfile << pc->stats.primary[i];
+		if (i < PRIMARY_STATS.size() - 1)
+			outfile << ",";
+	}
+	outfile << "\n";
+
+	// equipped gear
+	outfile << "equipped_quantity=" << menu->inv->inventory[EQUIPMENT].getQuantities() << "\n";
+	outfile << "equipped=" << menu->inv->inventory[EQUIPMENT].getItems() << "\n";
+
+	// carried items
+	outfile << "carried_quantity=" << menu->inv->inventory[CARRIED].getQuantities() << "\n";
+	outfile << "carried=" << menu->inv->inventory[CARRIED].getItems() << "\n";
+
+	// spawn point
+	outfile << "spawn=" << mapr->respawn_map << "," << static_cast<int>(mapr->respawn_point.x) << "," << static_cast<int>(mapr->respawn_point.y) << "\n";
+
+	// action bar
+	outfile << "actionbar=";
+	for (unsigned i = 0; i < static_cast<unsigned>(ACTIONBAR_MAX); i++) {
+		if (i < menu->act->slots_count)
+		{
+			if (pc->stats.transformed) outfile << menu->act->hotkeys_temp[i];
+			else outfile << menu->act->hotkeys[i];
 		}
-		outfile << "\n";
-
-		// equipped gear
-		outfile << "equipped_quantity=" << menu->inv->inventory[EQUIPMENT].getQuantities() << "\n";
-		outfile << "equipped=" << menu->inv->inventory[EQUIPMENT].getItems() << "\n";
-
-		// carried items
-		outfile << "carried_quantity=" << menu->inv->inventory[CARRIED].getQuantities() << "\n";
-		outfile << "carried=" << menu->inv->inventory[CARRIED].getItems() << "\n";
-
-		// spawn point
-		outfile << "spawn=" << mapr->respawn_map << "," << static_cast<int>(mapr->respawn_point.x) << "," << static_cast<int>(mapr->respawn_point.y) << "\n";
-
-		// action bar
-		outfile << "actionbar=";
-		for (unsigned i = 0; i < static_cast<unsigned>(ACTIONBAR_MAX); i++) {
-			if (i < menu->act->slots_count)
-			{
-				if (pc->stats.transformed) outfile << menu->act->hotkeys_temp[i];
-				else outfile << menu->act->hotkeys[i];
-			}
-			else
-			{
-				outfile << 0;
-			}
-			if (i < ACTIONBAR_MAX - 1) outfile << ",";
+		else
+		{
+			outfile << 0;
 		}
-		outfile << "\n";
+		if (i < ACTIONBAR_MAX - 1) outfile << ",";
+	}
+	outfile << "\n";
 
-		//shapeshifter value
-		if (pc->stats.transform_type == "untransform" || pc->stats.transform_duration != -1) outfile << "transformed=" << "\n";
-		else outfile << "transformed=" << pc->stats.transform_type << "," << pc->stats.manual_untransform << "\n";
+	//shapeshifter value
+	if (pc->stats.transform_type == "untransform" || pc->stats.transform_duration != -1) outfile << "transformed=" << "\n";
+	else outfile << "transformed=" << pc->stats.transform_type << "," << pc->stats.manual_untransform << "\n";
 
-		// restore hero powers
-		if (pc->stats.transformed && pc->hero_stats) {
-			pc->stats.powers_list = pc->hero_stats->powers_list;
-		}
+	// restore hero powers
+	if (pc->stats.transformed && pc->hero_stats) {
+		pc->stats.powers_list = pc->hero_stats->powers_list;
+	}
 
-		// enabled powers
-		outfile << "powers=";
-		for (unsigned int i=0; i<pc->stats.powers_list.size(); i++) {
-			if (i < pc->stats.powers_list.size()-1) {
-				if (pc->stats.powers_list[i] > 0)
-					outfile << pc->stats.powers_list[i] << ",";
-			}
-			else {
-				if (pc->stats.powers_list[i] > 0)
-					outfile << pc->stats.powers_list[i];
-			}
+	// enabled powers
+	outfile << "powers=";
+	for (unsigned int i=0; i<pc->stats.powers_list.size(); i++) {
+		if (i < pc->stats.powers_list.size()-1) {
+			if (pc->stats.powers_list[i] > 0)
+				outfile << pc->stats.powers_list[i] << ",";
 		}
-		outfile << "\n";
-
-		// restore transformed powers
-		if (pc->stats.transformed && pc->charmed_stats) {
-			pc->stats.powers_list = pc->charmed_stats->powers_list;
+		else {
+			if (pc->stats.powers_list[i] > 0)
+				outfile << pc->stats.powers_list[i];
 		}
+	}
+	outfile << "\n";
 
-		// campaign data
-		outfile << "campaign=";
-		outfile << camp->getAll();
+	// restore transformed powers
+	if (pc->stats.transformed && pc->charmed_stats) {
+		pc->stats.powers_list = pc->charmed_stats->powers_list;
+	}
 
-		outfile << std::endl;
+	// campaign data
+	outfile << "campaign=";
+	outfile << camp->getAll();
+
+	outfile << std::endl;
+
+	writer.write(path(&ss), outfile.str());
+
+	// Save the summary for the load screen
+	SavePreview preview;
+	preview.name = pc->stats.name;
+	preview.character_class = pc->stats.character_class;
+	preview.character_subclass = pc->stats.character_subclass;
+	preview.xp = pc->stats.xp;
+	preview.primary = pc->stats.primary;
+	preview.gfx_base = pc->stats.gfx_base;
+	preview.gfx_head = pc->stats.gfx_head;
+	preview.gfx_portrait = pc->stats.gfx_portrait;
+	preview.permadeath = pc->stats.permadeath;
+	preview.spawn_map = mapr->respawn_map;
+	if (mapr->respawn_map == mapr->getFilename())
+		preview.map_title = mapr->title;
+	for (int i = 0; i < menu->inv->inventory[EQUIPMENT].getSlotNumber(); ++i)
+		preview.equipped.push_back(menu->inv->inventory[EQUIPMENT][i].item);
 
-		if (outfile.bad()) logError("SaveLoad: Unable to save the game. No write access or disk is full!");
-		outfile.close();
-		outfile.clear();
-	}
+	ss.str("");
+	ss << PATH_USER << "saves/" << SAVE_PREFIX << "/" << game_slot << "/preview.dat";
+	writer.write(path(&ss), preview.write());
 
 	// Save stash
+	outfile.str("");
 	ss.str("");
 	if (pc->stats.permadeath)
 		ss << PATH_USER << "saves/" << SAVE_PREFIX << "/" << game_slot << "/stash_HC.txt";
 	else
 		ss << PATH_USER << "saves/" << SAVE_PREFIX << "/stash.txt";
 
-	outfile.open(path(&ss).c_str(), std::ios::out);
+	// comment
+	outfile << "## flare-engine stash file ##" << "\n";
 
-	if (outfile.is_open()) {
+	outfile << "quantity=" << menu->stash->stock.getQuantities() << "\n";
+	outfile << "item=" << menu->stash->stock.getItems() << "\n";
 
-		// comment
-		outfile << "## flare-engine stash file ##" << "\n";
+	outfile << std::endl;
 
-		outfile << "quantity=" << menu->stash->stock.getQuantities() << "\n";
-		outfile << "item=" << menu->stash->stock.getItems() << "\n";
-
-		outfile << std::endl;
-
-		if (outfile.bad()) logError("SaveLoad: Unable to save stash. No write access or disk is full!");
-		outfile.close();
-		outfile.clear();
-	}
+	// skipped if the stash didn't change since it was last saved
+	writer.write(path(&ss), outfile.str());
 
 	// display a log message saying that we saved the game
 	menu->questlog->add(msg->get("Game saved."), LOG_TYPE_MESSAGES);
@@ -209,6 +339,8 @@ void SaveLoad::saveGame() {
 void SaveLoad::loadGame() {
 	if (game_slot <= 0) return;
 
+	waitForSave();
+
 	int saved_hp = 0;
 	int saved_mp = 0;
 	int currency = 0;
@@ -267,7 +399,7 @@ void SaveLoad::loadGame() {
 			}
 			else if (infile.key == "spawn") {
 				mapr->teleport_mapname = popFirstString(infile.val);
-				if (mapr->teleport_mapname != "" && fileExists(mods->locate(mapr->teleport_mapname))) {
+				if (mapr->teleport_mapname != "" && !mods->locate(mapr->teleport_mapname).empty()) {
 					mapr->teleport_destination.x = static_cast<float>(popFirstInt(infile.val)) + 0.5f;
 					mapr->teleport_destination.y = static_cast<float>(popFirstInt(infile.val)) + 0.5f;
 					mapr->teleportation = true;
@@ -293,7 +425,7 @@ void SaveLoad::loadGame() {
 						logError("SaveLoad: Hotkey power id (%d) out of bounds 1-%d, skipping", hotkeys[i], static_cast<int>(powers->powers.size()));
 						hotkeys[i] = 0;
 					}
-					else if (hotkeys[i] != 0 && static_cast<unsigned>(hotkeys[i]) < powers->powers.size() && powers->powers[hotkeys[i]].name == "") {
+					else if (hotkeys[i] != 0 && static_cast<unsigned>(hotkeys[i]) < powers->powers.size() && powers->power_text[hotkeys[i]].name == "") {
 						logError("SaveLoad: Hotkey power with id=%d, found on position %d does not exist, skipping", hotkeys[i], i);
 						hotkeys[i] = 0;
 					}
@@ -400,6 +532,8 @@ void SaveLoad::loadClass(int index) {
  * This is used to load the stash when starting a new game
  */
 void SaveLoad::loadStash() {
+	waitForSave();
+
 	// Load stash
 	FileParser infile;
 	std::stringstream ss;
@@ -25,6 +25,46 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #ifndef SAVELOAD_H
 #define SAVELOAD_H
 
+#include "SaveWriter.h"
+
+#include <string>
+#include <vector>
+
+const unsigned SAVE_PREVIEW_VERSION = 1;
+
+/**
+ * A binary summary of a save slot, written next to avatar.txt as preview.dat
+ * The load screen reads this instead of parsing the save and the title of its spawn map.
+ */
+class SavePreview {
+private:
+	static void writeInt(std::string& out, unsigned long value);
+	static void writeString(std::string& out, const std::string& s);
+	bool readInt(const std::string& in, size_t& pos, unsigned long& value);
+	bool readString(const std::string& in, size_t& pos, std::string& s);
+
+public:
+	SavePreview();
+
+	std::string name;
+	std::string character_class;
+	std::string character_subclass;
+	unsigned long xp;
+	std::vector<int> primary;
+	std::string gfx_base;
+	std::string gfx_head;
+	std::string gfx_portrait;
+	bool permadeath;
+	std::string spawn_map;
+	std::string map_title; // empty if the hero didn't save on the spawn map
+	std::vector<int> equipped;
+
+	std::string write() const;
+
+	// returns false if the file is missing or was written by a different version
+	bool read(const std::string& filename);
+};
+
 class SaveLoad {
 public:
 	SaveLoad();
@@ -42,11 +82,15 @@ public:
 	void loadClass(int index);
 	void loadStash();
 
+	// blocks until the last save has been written to disk
+	void waitForSave();
+
 private:
 	void applyPlayerData();
 	void loadPowerTree();
 
 	int game_slot;
+	SaveWriter writer;
 };
 
 #endif
@@ -0,0 +1,201 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class SaveWriter
+ */
+
+#include "Platform.h"
+#include "Profiler.h"
+#include "SaveWriter.h"
+#include "Utils.h"
+#include "UtilsFileSystem.h"
+
+#include <stdio.h>
+
+SaveWriter::SaveWriter()
+	: thread(NULL)
+	, mutex(NULL)
+	, job_added(NULL)
+	, job_done(NULL)
+	, quit(false)
+	, busy(false)
+	, started(false) {
+}
+
+SaveWriter::~SaveWriter() {
+	if (thread) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(job_added);
+		SDL_UnlockMutex(mutex);
+
+		// the thread finishes the queued files before quitting
+		SDL_WaitThread(thread, NULL);
+		thread = NULL;
+	}
+
+	if (job_done) SDL_DestroyCond(job_done);
+	if (job_added) SDL_DestroyCond(job_added);
+	if (mutex) SDL_DestroyMutex(mutex);
+}
+
+/**
+ * FNV-1a
+ */
+unsigned long SaveWriter::getHash(const std::string& s) {
+	unsigned long hash = 2166136261UL;
+	for (size_t i = 0; i < s.size(); ++i) {
+		hash ^= static_cast<unsigned char>(s[i]);
+		hash = (hash * 16777619UL) & 0xffffffffUL;
+	}
+	return hash;
+}
+
+void SaveWriter::start() {
+	started = true;
+
+	mutex = SDL_CreateMutex();
+	job_added = SDL_CreateCond();
+	job_done = SDL_CreateCond();
+	if (!mutex || !job_added || !job_done) {
+		logError("SaveWriter: Could not create thread synchronization: %s", SDL_GetError());
+		return;
+	}
+
+	thread = SDL_CreateThread(run, "SaveWriter", this);
+	if (!thread)
+		logError("SaveWriter: Could not create thread: %s", SDL_GetError());
+}
+
+/**
+ * Writer thread loop; writes queued files until quit is set and the queue is empty
+ */
+int SaveWriter::run(void *data) {
+	SaveWriter *writer = static_cast<SaveWriter*>(data);
+
+	SDL_LockMutex(writer->mutex);
+	while (true) {
+		while (!writer->quit && writer->jobs.empty())
+			SDL_CondWait(writer->job_added, writer->mutex);
+
+		if (writer->jobs.empty())
+			break;
+
+		SaveWriterJob job = writer->jobs.front();
+		writer->jobs.pop_front();
+		writer->busy = true;
+		SDL_UnlockMutex(writer->mutex);
+
+		bool success;
+		{
+			ProfileScope scope(PROFILE_SAVE_WRITE);
+			success = writer->writeFile(job);
+		}
+
+		SDL_LockMutex(writer->mutex);
+		writer->busy = false;
+
+		// try again next time, even if the contents don't change
+		if (!success && writer->hashes[job.filename] == job.hash)
+			writer->hashes.erase(job.filename);
+
+		if (writer->jobs.empty())
+			SDL_CondBroadcast(writer->job_done);
+	}
+	SDL_UnlockMutex(writer->mutex);
+
+	return 0;
+}
+
+/**
+ * Runs on the writer thread
+ */
+bool SaveWriter::writeFile(const SaveWriterJob& job) {
+	std::string temp_filename = job.filename + ".tmp";
+
+	FILE *file = fopen(temp_filename.c_str(), "wb");
+	if (!file) {
+		logError("SaveWriter: Unable to save '%s'. No write access!", job.filename.c_str());
+		return false;
+	}
+
+	bool success = fwrite(job.contents.data(), 1, job.contents.size(), file) == job.contents.size();
+	success = (fclose(file) == 0) && success;
+
+	if (success)
+		success = PlatformFileReplace(temp_filename, job.filename);
+
+	if (!success) {
+		logError("SaveWriter: Unable to save '%s'. No write access or disk is full!", job.filename.c_str());
+		removeFile(temp_filename);
+	}
+
+	return success;
+}
+
+void SaveWriter::write(const std::string& filename, const std::string& contents) {
+	if (!started)
+		start();
+
+	unsigned long hash = getHash(contents);
+
+	if (!thread) {
+		// no thread, so write directly
+		SaveWriterJob job;
+		job.filename = filename;
+		job.contents = contents;
+		job.hash = hash;
+		writeFile(job);
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+
+	std::map<std::string, unsigned long>::iterator it = hashes.find(filename);
+	if (it != hashes.end() && it->second == hash && fileExists(filename)) {
+		SDL_UnlockMutex(mutex);
+		return;
+	}
+	hashes[filename] = hash;
+
+	// a queued older version of the file doesn't need to be written anymore
+	for (std::deque<SaveWriterJob>::iterator job_it = jobs.begin(); job_it != jobs.end(); ++job_it) {
+		if (job_it->filename == filename) {
+			jobs.erase(job_it);
+			break;
+		}
+	}
+
+	jobs.push_back(SaveWriterJob());
+	jobs.back().filename = filename;
+	jobs.back().contents = contents;
+	jobs.back().hash = hash;
+
+	SDL_CondBroadcast(job_added);
+	SDL_UnlockMutex(mutex);
+}
+
+void SaveWriter::wait() {
+	if (!thread)
+		return;
+
+	SDL_LockMutex(mutex);
+	while (busy || !jobs.empty())
+		SDL_CondWait(job_done, mutex);
+	SDL_UnlockMutex(mutex);
+}
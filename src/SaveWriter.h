@@ -0,0 +1,75 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class SaveWriter
+ *
+ * Writes save files on a background thread, so that saving doesn't stall the game.
+ * The contents are prepared on the main thread and handed over as strings.
+ * Each file is written to a temporary file first, flushed to disk and then
+ * renamed over the old one, so an interrupted save leaves the previous file intact.
+ */
+
+#ifndef SAVE_WRITER_H
+#define SAVE_WRITER_H
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include <SDL.h>
+
+class SaveWriterJob {
+public:
+	std::string filename;
+	std::string contents;
+	unsigned long hash;
+};
+
+class SaveWriter {
+private:
+	static int run(void *data);
+	static unsigned long getHash(const std::string& s);
+	void start();
+	bool writeFile(const SaveWriterJob& job);
+
+	SDL_Thread *thread;
+	SDL_mutex *mutex;
+	SDL_cond *job_added;
+	SDL_cond *job_done;
+	bool quit;
+	bool busy;
+	bool started;
+
+	std::deque<SaveWriterJob> jobs;
+
+	// hash of the last contents queued for each file
+	std::map<std::string, unsigned long> hashes;
+
+public:
+	SaveWriter();
+	SaveWriter(const SaveWriter&); // not implemented
+	~SaveWriter();
+
+	// queues the file to be written, unless it already has these contents
+	void write(const std::string& filename, const std::string& contents);
+
+	// blocks until all queued files have been written
+	void wait();
+};
+
+#endif // SAVE_WRITER_H
@@ -22,6 +22,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
  * Settings
  */
 
+#include <cassert>
 #include <cstring>
 #include <typeinfo>
 #include <cmath>
@@ -69,7 +70,14 @@ ConfigEntry config[] = {
 	{ "vsync",             &typeid(VSYNC),              "1",   &VSYNC,              NULL},
 	{ "texture_filter",    &typeid(TEXTURE_FILTER),     "1",   &TEXTURE_FILTER,     "texture filter quality. 0 nearest neighbor (worst), 1 linear (best)"},
 	{ "max_fps",           &typeid(MAX_FRAMES_PER_SEC), "60",  &MAX_FRAMES_PER_SEC, "maximum frames per second. default is 60"},
-	{ "renderer",          &typeid(RENDER_DEVICE),      "sdl", &RENDER_DEVICE,      "default render device. 'sdl' is the default setting"},
+	{ "max_render_fps",    &typeid(MAX_RENDER_FPS),     "0",   &MAX_RENDER_FPS,     "maximum frames drawn per second. Above max_fps, movement is smoothed between logic frames. 0 draws once per logic frame"},
+	{ "battery_saver_fps", &typeid(BATTERY_SAVER_FPS),  "0",   &BATTERY_SAVER_FPS,  "draw at most this many frames per second to save battery. The game logic still runs at max_fps. 0 disables"},
+	{ "render_scale",      &typeid(RENDER_SCALE),       "1.0", &RENDER_SCALE,       "resolution the map is drawn at, relative to the view (0.25 - 1.0). Only used by the 'sdl_hardware' renderer"},
+	{ "dynamic_render_scale", &typeid(DYNAMIC_RENDER_SCALE), "0", &DYNAMIC_RENDER_SCALE, "lower the map resolution, down to render_scale_min, while frames take too long. 1 enable, 0 disable."},
+	{ "render_scale_min",  &typeid(RENDER_SCALE_MIN),   "0.5", &RENDER_SCALE_MIN,   NULL},
+	{ "dynamic_visual_quality", &typeid(DYNAMIC_VISUAL_QUALITY), "0", &DYNAMIC_VISUAL_QUALITY, "draw fewer combat texts, tile animations and effects while frames take too long. 1 enable, 0 disable."},
+	{ "renderer",          &typeid(RENDER_DEVICE),      "sdl", &RENDER_DEVICE,      "default render device. 'sdl' is the default setting, 'sdl_hardware' and 'sdl_fast' are also available"},
+	{ "render_16bit",      &typeid(RENDER_16BIT),       "0",   &RENDER_16BIT,       "draw in 16-bit color with the 'sdl' and 'sdl_fast' renderers, which is faster on low-end devices. 1 enable, 0 disable."},
 	{ "enable_joystick",   &typeid(ENABLE_JOYSTICK),    "0",   &ENABLE_JOYSTICK,    "joystick settings."},
 	{ "joystick_device",   &typeid(JOYSTICK_DEVICE),    "0",   &JOYSTICK_DEVICE,    NULL},
 	{ "joystick_deadzone", &typeid(JOY_DEADZONE),       "100", &JOY_DEADZONE,       NULL},
@@ -80,13 +88,25 @@ ConfigEntry config[] = {
 	{ "no_mouse",          &typeid(NO_MOUSE),           "0",   &NO_MOUSE,           "make using mouse secondary, give full control to keyboard. 1 enable, 0 disable."},
 	{ "show_fps",          &typeid(SHOW_FPS),           "0",   &SHOW_FPS,           "show frames per second. 1 enable, 0 disable."},
 	{ "colorblind",        &typeid(COLORBLIND),         "0",   &COLORBLIND,         "enable colorblind tooltips. 1 enable, 0 disable"},
-	{ "hardware_cursor",   &typeid(HARDWARE_CURSOR),    "0",   &HARDWARE_CURSOR,    "use the system mouse cursor. 1 enable, 0 disable"},
+	{ "hardware_cursor",   &typeid(HARDWARE_CURSOR),    "0",   &HARDWARE_CURSOR,    "let the OS draw the mouse cursor, using the cursor images when possible. 1 enable, 0 disable"},
 	{ "dev_mode",          &typeid(DEV_MODE),           "0",   &DEV_MODE,           "allow opening the developer console. 1 enable, 0 disable"},
 	{ "dev_hud",           &typeid(DEV_HUD),            "1",   &DEV_HUD,            "shows some additional information on-screen when developer mode is enabled. 1 enable, 0 disable"},
 	{ "loot_tooltips",     &typeid(LOOT_TOOLTIPS),      "1",   &LOOT_TOOLTIPS,      "always show loot tooltips. 1 enable, 0 disable"},
 	{ "statbar_labels",    &typeid(STATBAR_LABELS),     "0",   &STATBAR_LABELS,     "always show labels on HP/MP/XP bars. 1 enable, 0 disable"},
 	{ "auto_equip",        &typeid(AUTO_EQUIP),         "1",   &AUTO_EQUIP,         "automatically equip items. 1 enable, 0 disable"},
-	{ "subtitles",         &typeid(SUBTITLES),          "0",   &SUBTITLES,          "displays subtitles. 1 enable, 0 disable"}
+	{ "subtitles",         &typeid(SUBTITLES),          "0",   &SUBTITLES,          "displays subtitles. 1 enable, 0 disable"},
+	{ "cache_map_layers",  &typeid(CACHE_MAP_LAYERS),   "1",   &CACHE_MAP_LAYERS,   "pre-render the static map layers below objects in large chunks. 1 enable, 0 disable"},
+	{ "texture_atlas",     &typeid(TEXTURE_ATLAS),      "1",   &TEXTURE_ATLAS,      "pack small sprite-sheets and icons into shared textures. 1 enable, 0 disable"},
+	{ "composite_avatar",  &typeid(COMPOSITE_AVATAR),   "0",   &COMPOSITE_AVATAR,   "flatten the hero's equipment layers into one cached image per animation frame. Semi-transparent edges may look slightly darker. 1 enable, 0 disable"},
+	{ "low_res_images",    &typeid(LOW_RES_IMAGES),     "0",   &LOW_RES_IMAGES,     "load the half resolution copies of images ('name.half.png') that mods ship, to save texture memory. Only used by the 'sdl_hardware' renderer. 1 enable, 0 disable."},
+	{ "texture_cache_mb",  &typeid(TEXTURE_CACHE_MB),   "128", &TEXTURE_CACHE_MB,   "megabytes of images and animations to keep loaded. Unused ones past this are freed, oldest first."},
+	{ "texture_backup_mb", &typeid(TEXTURE_BACKUP_MB),  "32",  &TEXTURE_BACKUP_MB,  "megabytes of compressed image copies the 'sdl_hardware' renderer keeps, to rebuild its textures quickly when the graphics context is lost. Images past this are loaded from disk again."},
+	{ "sound_cache_mb",    &typeid(SOUND_CACHE_MB),     "32",  &SOUND_CACHE_MB,     "megabytes of sound effects to keep loaded. Unused ones past this are freed, oldest first."},
+	{ "parser_cache",      &typeid(PARSER_CACHE),       "1",   &PARSER_CACHE,       "keep a cache of the parsed power, item and enemy definitions and of the translations to speed up loading. 1 enable, 0 disable"},
+	{ "enemy_load_distance", &typeid(ENEMY_LOAD_DISTANCE), "24", &ENEMY_LOAD_DISTANCE, "enemy graphics and sounds are loaded once an enemy is this many tiles from the camera. 0 loads them with the map"},
+	{ "worker_threads",    &typeid(WORKER_THREADS),     "0",   &WORKER_THREADS,     "the number of threads used for game logic, including the main thread. 0 uses one per CPU core, 1 disables the worker threads"},
+	{ "render_pipeline",   &typeid(RENDER_PIPELINE),    "0",   &RENDER_PIPELINE,    "collect the next frame's sprites on a worker thread while the last frame is drawn. The world is shown one frame late. 1 enable, 0 disable"},
+	{ "hitch_threshold",   &typeid(HITCH_THRESHOLD),    "0",   &HITCH_THRESHOLD,    "frames that take longer than this many milliseconds are written to the log, along with their slowest part. 0 disables"}
 };
 const int config_size = sizeof(config) / sizeof(ConfigEntry);
 
@@ -121,6 +141,14 @@ unsigned short ICON_SIZE;
 bool FULLSCREEN;
 unsigned char BITS_PER_PIXEL = 32;
 unsigned short MAX_FRAMES_PER_SEC;
+unsigned short MAX_RENDER_FPS;
+unsigned short BATTERY_SAVER_FPS;
+float RENDER_SCALE;
+bool DYNAMIC_RENDER_SCALE;
+float RENDER_SCALE_MIN;
+bool DYNAMIC_VISUAL_QUALITY;
+bool RENDER_16BIT;
+float FRAME_INTERPOLATION = 1;
 unsigned short VIEW_W = 0;
 unsigned short VIEW_H = 0;
 unsigned short VIEW_W_HALF = 0;
@@ -137,11 +165,18 @@ bool CHANGE_GAMMA;
 float GAMMA;
 std::string RENDER_DEVICE;
 std::vector<unsigned short> VIRTUAL_HEIGHTS;
+bool CACHE_MAP_LAYERS;
+bool TEXTURE_ATLAS;
+bool COMPOSITE_AVATAR;
+int TEXTURE_CACHE_MB;
+int TEXTURE_BACKUP_MB;
+bool LOW_RES_IMAGES;
 
 // Audio Settings
 bool AUDIO = true;
 unsigned short MUSIC_VOLUME;
 unsigned short SOUND_VOLUME;
+int SOUND_CACHE_MB;
 
 // Interface Settings
 bool COMBAT_TEXT;
@@ -154,7 +189,17 @@ bool LOOT_TOOLTIPS;
 bool STATBAR_LABELS;
 bool AUTO_EQUIP;
 bool SUBTITLES;
+bool PARSER_CACHE;
+float ENEMY_LOAD_DISTANCE;
+int WORKER_THREADS;
+bool RENDER_PIPELINE;
+int HITCH_THRESHOLD;
 bool SHOW_HUD = true;
+bool DEV_SKIP_AI = false;
+bool DEV_SKIP_HAZARDS = false;
+bool DEV_SKIP_LOOT = false;
+bool DEV_SKIP_SOUND = false;
+bool DEV_SKIP_LAYERS = false;
 
 // Input Settings
 bool MOUSE_MOVE;
@@ -221,12 +266,14 @@ int TOOLTIP_BACKGROUND_BORDER;
 // Command-line settings
 std::string LOAD_SLOT;
 std::string LOAD_SCRIPT;
+std::string BENCHMARK_RENDER;
 
 // Other Settings
 bool MENUS_PAUSE;
 bool SAVE_HPMP;
 bool ENABLE_PLAYGAME;
 int CORPSE_TIMEOUT;
+int CORPSE_LIMIT;
 bool SELL_WITHOUT_VENDOR;
 int AIM_ASSIST;
 std::string SAVE_PREFIX = "";
@@ -235,16 +282,64 @@ int SOUND_FALLOFF;
 int PARTY_EXP_PERCENTAGE;
 bool ENABLE_ALLY_COLLISION_AI;
 bool ENABLE_ALLY_COLLISION;
+bool ENABLE_PATH_HIERARCHY;
+bool ENABLE_FLOW_FIELD;
+int PATH_NODE_BUDGET;
+float AI_THROTTLE_DISTANCE;
+int AI_THROTTLE_INTERVAL;
+float AI_SLEEP_DISTANCE;
 int CURRENCY_ID;
 float INTERACT_RANGE;
 bool SAVE_ONLOAD = true;
 bool SAVE_ONEXIT = true;
 float ENCOUNTER_DIST;
 
-static ConfigEntry * getConfigEntry(const char * name) {
+static unsigned settings_revision = 1;
+
+// open addressing hash table of config indexes (-1 for empty slots), built on first use
+// CONFIG_INDEX_SIZE must be a power of two, and well above config_size
+static const unsigned CONFIG_INDEX_SIZE = 128;
+static int config_index[CONFIG_INDEX_SIZE];
+static bool config_index_built = false;
+
+/**
+ * FNV-1a hash of a config key
+ */
+static unsigned hashConfigName(const char * name) {
+	unsigned hash = 2166136261u;
+	for (; *name; ++name) {
+		hash ^= static_cast<unsigned char>(*name);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void buildConfigIndex() {
+	assert(static_cast<unsigned>(config_size) * 2 <= CONFIG_INDEX_SIZE);
+
+	for (unsigned i = 0; i < CONFIG_INDEX_SIZE; i++) {
+		config_index[i] = -1;
+	}
 
 	for (int i = 0; i < config_size; i++) {
-		if (std::strcmp(config[i].name, name) == 0) return config + i;
+		unsigned slot = hashConfigName(config[i].name) & (CONFIG_INDEX_SIZE - 1);
+		while (config_index[slot] != -1)
+			slot = (slot + 1) & (CONFIG_INDEX_SIZE - 1);
+		config_index[slot] = i;
+	}
+
+	config_index_built = true;
+}
+
+static ConfigEntry * getConfigEntry(const char * name) {
+	if (!config_index_built)
+		buildConfigIndex();
+
+	unsigned slot = hashConfigName(name) & (CONFIG_INDEX_SIZE - 1);
+	while (config_index[slot] != -1) {
+		ConfigEntry * entry = config + config_index[slot];
+		if (std::strcmp(entry->name, name) == 0) return entry;
+		slot = (slot + 1) & (CONFIG_INDEX_SIZE - 1);
 	}
 
 	logError("Settings: '%s' is not a valid configuration key.", name);
@@ -360,6 +455,7 @@ void loadMiscSettings() {
 	SAVE_HPMP = false;
 	ENABLE_PLAYGAME = false;
 	CORPSE_TIMEOUT = 60*MAX_FRAMES_PER_SEC;
+	CORPSE_LIMIT = 0;
 	SELL_WITHOUT_VENDOR = true;
 	AIM_ASSIST = 0;
 	SAVE_PREFIX = "";
@@ -368,6 +464,12 @@ void loadMiscSettings() {
 	PARTY_EXP_PERCENTAGE = 100;
 	ENABLE_ALLY_COLLISION_AI = true;
 	ENABLE_ALLY_COLLISION = true;
+	ENABLE_PATH_HIERARCHY = true;
+	ENABLE_FLOW_FIELD = true;
+	PATH_NODE_BUDGET = 2048;
+	AI_THROTTLE_DISTANCE = 32;
+	AI_THROTTLE_INTERVAL = 4;
+	AI_SLEEP_DISTANCE = 64;
 	CURRENCY_ID = 1;
 	INTERACT_RANGE = 3;
 	SAVE_ONLOAD = true;
@@ -388,6 +490,9 @@ void loadMiscSettings() {
 			// @ATTR corpse_timeout|duration|Duration that a corpse can exist on the map in 'ms' or 's'.
 			else if (infile.key == "corpse_timeout")
 				CORPSE_TIMEOUT = parse_duration(infile.val);
+			// @ATTR corpse_limit|int|The number of corpses that can be visible on the map at once. When there are more, the oldest ones disappear early. 0 means no limit.
+			else if (infile.key == "corpse_limit")
+				CORPSE_LIMIT = std::max(toInt(infile.val), 0);
 			// @ATTR sell_without_vendor|bool|Allows selling items when not at a vendor via CTRL-Click.
 			else if (infile.key == "sell_without_vendor")
 				SELL_WITHOUT_VENDOR = toBool(infile.val);
@@ -412,6 +517,23 @@ void loadMiscSettings() {
 			// @ATTR enable_ally_collision_ai|bool|Allows allies to block the path of other AI creatures.
 			else if (infile.key == "enable_ally_collision_ai")
 				ENABLE_ALLY_COLLISION_AI = toBool(infile.val);
+			// @ATTR hierarchical_pathfinding|bool|Use a coarse cluster graph to speed up long-range pathfinding. Paths may be slightly less direct.
+			else if (infile.key == "hierarchical_pathfinding")
+				ENABLE_PATH_HIERARCHY = toBool(infile.val);
+			// @ATTR flow_field_pursuit|bool|Creatures chasing the hero share a single distance field instead of computing their own paths.
+			else if (infile.key == "flow_field_pursuit")
+				ENABLE_FLOW_FIELD = toBool(infile.val);
+			// @ATTR path_budget|int|The number of pathfinding nodes that creatures may search through per frame. Creatures keep following their old path while waiting for a new one. 0 removes the limit.
+			else if (infile.key == "path_budget")
+				PATH_NODE_BUDGET = std::max(toInt(infile.val), 0);
+			else if (infile.key == "ai_throttle") {
+				// @ATTR ai_throttle|float, int : Distance, Interval|Creatures that aren't in combat and are farther than this many tiles from both the hero and the camera only make decisions once per interval of frames. A distance of 0 disables this.
+				AI_THROTTLE_DISTANCE = toFloat(popFirstString(infile.val));
+				AI_THROTTLE_INTERVAL = std::max(popFirstInt(infile.val), 1);
+			}
+			// @ATTR ai_sleep_distance|float|Creatures that aren't in combat and are farther than this many tiles from both the hero and the camera don't act at all. 0 disables this.
+			else if (infile.key == "ai_sleep_distance")
+				AI_SLEEP_DISTANCE = toFloat(infile.val);
 			else if (infile.key == "currency_id") {
 				// @ATTR currency_id|item_id|An item id that will be used as currency.
 				CURRENCY_ID = toInt(infile.val);
@@ -797,6 +919,8 @@ void loadMiscSettings() {
 		}
 		infile.close();
 	}
+
+	notifySettingsChanged();
 }
 
 bool loadSettings() {
@@ -828,6 +952,7 @@ bool loadSettings() {
 	infile.close();
 
 	loadMobileDefaults();
+	notifySettingsChanged();
 
 	return true;
 }
@@ -861,6 +986,9 @@ bool saveSettings() {
 		outfile.close();
 		outfile.clear();
 	}
+
+	// the options menu applies its changes by saving them
+	notifySettingsChanged();
 	return true;
 }
 
@@ -876,10 +1004,19 @@ bool loadDefaults() {
 	}
 
 	loadMobileDefaults();
+	notifySettingsChanged();
 
 	return true;
 }
 
+unsigned getSettingsRevision() {
+	return settings_revision;
+}
+
+void notifySettingsChanged() {
+	settings_revision++;
+}
+
 /**
  * Return a string of version name + version number
  */
@@ -87,9 +87,18 @@ extern unsigned short ICON_SIZE;
 extern bool AUDIO;					// initialize the audio subsystem at all?
 extern unsigned short MUSIC_VOLUME;
 extern unsigned short SOUND_VOLUME;
+extern int SOUND_CACHE_MB;
 extern bool FULLSCREEN;
 extern unsigned char BITS_PER_PIXEL;
 extern unsigned short MAX_FRAMES_PER_SEC;
+extern unsigned short MAX_RENDER_FPS;
+extern unsigned short BATTERY_SAVER_FPS;
+extern float RENDER_SCALE;
+extern bool DYNAMIC_RENDER_SCALE;
+extern float RENDER_SCALE_MIN;
+extern bool DYNAMIC_VISUAL_QUALITY;
+extern bool RENDER_16BIT;
+extern float FRAME_INTERPOLATION; // how far the frame being drawn is between the previous logic frame (0) and the current one (1)
 extern unsigned short VIEW_W;
 extern unsigned short VIEW_H;
 extern unsigned short VIEW_W_HALF;
@@ -106,6 +115,12 @@ extern bool CHANGE_GAMMA;
 extern float GAMMA;
 extern std::string RENDER_DEVICE;
 extern std::vector<unsigned short> VIRTUAL_HEIGHTS;
+extern bool CACHE_MAP_LAYERS;
+extern bool TEXTURE_ATLAS;
+extern bool COMPOSITE_AVATAR;
+extern int TEXTURE_CACHE_MB;
+extern int TEXTURE_BACKUP_MB;
+extern bool LOW_RES_IMAGES;
 
 // Input Settings
 extern bool MOUSE_MOVE;
@@ -127,13 +142,26 @@ extern bool LOOT_TOOLTIPS;
 extern bool STATBAR_LABELS;
 extern bool AUTO_EQUIP;
 extern bool SUBTITLES;
+extern bool PARSER_CACHE;
+extern float ENEMY_LOAD_DISTANCE;
+extern int WORKER_THREADS;
+extern bool RENDER_PIPELINE;
+extern int HITCH_THRESHOLD;
 extern bool SHOW_HUD;
 
+// subsystems the developer console can switch off, to see how much of a frame they cost; these are never saved
+extern bool DEV_SKIP_AI;
+extern bool DEV_SKIP_HAZARDS;
+extern bool DEV_SKIP_LOOT;
+extern bool DEV_SKIP_SOUND;
+extern bool DEV_SKIP_LAYERS;
+
 // Engine Settings
 extern bool MENUS_PAUSE;
 extern bool SAVE_HPMP;
 extern bool ENABLE_PLAYGAME;
 extern int CORPSE_TIMEOUT;
+extern int CORPSE_LIMIT;
 extern bool SELL_WITHOUT_VENDOR;
 extern int AIM_ASSIST;
 extern std::string WINDOW_TITLE;
@@ -142,6 +170,12 @@ extern int SOUND_FALLOFF;
 extern int PARTY_EXP_PERCENTAGE;
 extern bool ENABLE_ALLY_COLLISION_AI;
 extern bool ENABLE_ALLY_COLLISION;
+extern bool ENABLE_PATH_HIERARCHY;
+extern bool ENABLE_FLOW_FIELD;
+extern int PATH_NODE_BUDGET;
+extern float AI_THROTTLE_DISTANCE;
+extern int AI_THROTTLE_INTERVAL;
+extern float AI_SLEEP_DISTANCE;
 extern int CURRENCY_ID;
 extern float INTERACT_RANGE;
 extern bool SAVE_ONLOAD;
@@ -215,6 +249,7 @@ extern int TOOLTIP_BACKGROUND_BORDER;
 // Command-line settings
 extern std::string LOAD_SLOT;
 extern std::string LOAD_SCRIPT;
+extern std::string BENCHMARK_RENDER; // see RenderBenchmark
 
 void loadTilesetSettings();
 void loadMiscSettings();
@@ -223,6 +258,11 @@ bool saveSettings();
 bool loadDefaults();
 void loadMobileDefaults();
 void updateScreenVars();
+
+// changes whenever the settings have been loaded, reset or saved, so that derived values can be cached
+unsigned getSettingsRevision();
+void notifySettingsChanged();
+
 size_t getPrimaryStatIndex(const std::string& id_str);
 
 // version information
@@ -29,3 +29,4 @@ MapRenderer *mapr = NULL;
 MenuActionBar *menu_act= NULL;
 MenuPowers *menu_powers = NULL;
 PowerManager *powers = NULL;
+StressScene *stress = NULL;
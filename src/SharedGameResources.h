@@ -26,6 +26,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "MenuActionBar.h"
 #include "MenuPowers.h"
 #include "PowerManager.h"
+#include "StressScene.h"
 
 extern MenuActionBar *menu_act;
 extern MenuPowers *menu_powers;
@@ -42,5 +43,6 @@ extern ItemManager *items;
 extern LootManager *loot;
 extern MapRenderer *mapr;
 extern PowerManager *powers;
+extern StressScene *stress;
 
 #endif // SHAREDGAMEOBJECTS_H
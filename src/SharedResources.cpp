@@ -35,8 +35,10 @@ CursorManager *curs;
 FontEngine *font;
 IconManager *icons;
 InputState *inpt;
+InputReplay *replay;
 MessageEngine *msg;
 ModManager *mods;
 RenderDevice *render_device;
 SoundManager *snd;
 SaveLoad *save_load;
+WorkerPool *workers;
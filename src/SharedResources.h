@@ -36,12 +36,14 @@ Created and destroyed by main.cpp
 #include "CursorManager.h"
 #include "FontEngine.h"
 #include "IconManager.h"
+#include "InputReplay.h"
 #include "InputState.h"
 #include "MessageEngine.h"
 #include "ModManager.h"
 #include "SoundManager.h"
 #include "RenderDevice.h"
 #include "SaveLoad.h"
+#include "WorkerPool.h"
 
 extern AnimationManager *anim;
 extern CombatText *comb;
@@ -49,10 +51,12 @@ extern CursorManager *curs;
 extern FontEngine *font;
 extern IconManager *icons;
 extern InputState *inpt;
+extern InputReplay *replay;
 extern MessageEngine *msg;
 extern ModManager *mods;
 extern SoundManager *snd;
 extern RenderDevice *render_device;
 extern SaveLoad *save_load;
+extern WorkerPool *workers;
 
 #endif
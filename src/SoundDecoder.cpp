@@ -0,0 +1,203 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "CommonIncludes.h"
+#include "Profiler.h"
+#include "SharedResources.h"
+#include "SoundDecoder.h"
+#include "Utils.h"
+
+SoundDecoder::SoundDecoder()
+	: thread(NULL)
+	, mutex(NULL)
+	, job_added(NULL)
+	, job_done(NULL)
+	, quit(false) {
+}
+
+SoundDecoder::~SoundDecoder() {
+	clear();
+	stopThread();
+}
+
+/**
+ * Worker thread loop; decodes queued jobs until quit is set
+ */
+int SoundDecoder::run(void *data) {
+	SoundDecoder *decoder = static_cast<SoundDecoder*>(data);
+
+	SDL_LockMutex(decoder->mutex);
+	while (true) {
+		while (decoder->queue.empty() && !decoder->quit)
+			SDL_CondWait(decoder->job_added, decoder->mutex);
+
+		if (decoder->quit)
+			break;
+
+		SoundDecodeJob *job = decoder->queue.front();
+		decoder->queue.pop_front();
+		SDL_UnlockMutex(decoder->mutex);
+
+		Mix_Chunk *chunk;
+		std::string error;
+		{
+			ProfileScope scope(PROFILE_SOUND_DECODE);
+			chunk = Mix_LoadWAV_RW(mods->openRW(job->path), 1);
+			error = chunk ? "" : Mix_GetError();
+		}
+
+		SDL_LockMutex(decoder->mutex);
+		job->chunk = chunk;
+		job->error = error;
+		job->done = true;
+		SDL_CondBroadcast(decoder->job_done);
+	}
+	SDL_UnlockMutex(decoder->mutex);
+
+	return 0;
+}
+
+void SoundDecoder::startThread() {
+	if (thread)
+		return;
+
+	mutex = SDL_CreateMutex();
+	job_added = SDL_CreateCond();
+	job_done = SDL_CreateCond();
+	if (!mutex || !job_added || !job_done) {
+		logError("SoundDecoder: Could not create thread synchronization: %s", SDL_GetError());
+		return;
+	}
+
+	thread = SDL_CreateThread(run, "SoundDecoder", this);
+	if (!thread)
+		logError("SoundDecoder: Could not create thread: %s", SDL_GetError());
+}
+
+void SoundDecoder::stopThread() {
+	if (thread) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(job_added);
+		SDL_UnlockMutex(mutex);
+
+		SDL_WaitThread(thread, NULL);
+		thread = NULL;
+	}
+
+	if (job_done) SDL_DestroyCond(job_done);
+	if (job_added) SDL_DestroyCond(job_added);
+	if (mutex) SDL_DestroyMutex(mutex);
+	job_done = job_added = NULL;
+	mutex = NULL;
+}
+
+void SoundDecoder::request(SoundManager::SoundID sid, const std::string& path) {
+	startThread();
+
+	// without a thread, sounds are decoded in take() as usual
+	if (!thread)
+		return;
+
+	SDL_LockMutex(mutex);
+	if (jobs.find(sid) == jobs.end()) {
+		SoundDecodeJob *job = new SoundDecodeJob();
+		job->path = path;
+		jobs[sid] = job;
+		queue.push_back(job);
+		SDL_CondSignal(job_added);
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+Mix_Chunk* SoundDecoder::take(SoundManager::SoundID sid, const std::string& path, std::string& error) {
+	SoundDecodeJob *job = NULL;
+
+	if (thread) {
+		SDL_LockMutex(mutex);
+		std::map<SoundManager::SoundID, SoundDecodeJob*>::iterator it = jobs.find(sid);
+		if (it != jobs.end()) {
+			job = it->second;
+			jobs.erase(it);
+
+			// if the worker hasn't picked this job yet, decode it here instead of waiting
+			std::deque<SoundDecodeJob*>::iterator queued = std::find(queue.begin(), queue.end(), job);
+			if (queued != queue.end()) {
+				queue.erase(queued);
+				delete job;
+				job = NULL;
+			}
+			else {
+				while (!job->done)
+					SDL_CondWait(job_done, mutex);
+			}
+		}
+		SDL_UnlockMutex(mutex);
+	}
+
+	Mix_Chunk *chunk = NULL;
+	if (job) {
+		chunk = job->chunk;
+		error = job->error;
+		delete job;
+	}
+	else {
+		chunk = Mix_LoadWAV_RW(mods->openRW(path), 1);
+		if (!chunk)
+			error = Mix_GetError();
+	}
+
+	return chunk;
+}
+
+bool SoundDecoder::isPending(SoundManager::SoundID sid) {
+	if (!thread)
+		return false;
+
+	SDL_LockMutex(mutex);
+	std::map<SoundManager::SoundID, SoundDecodeJob*>::iterator it = jobs.find(sid);
+	bool pending = (it != jobs.end() && !it->second->done);
+	SDL_UnlockMutex(mutex);
+
+	return pending;
+}
+
+void SoundDecoder::clear() {
+	if (!thread)
+		return;
+
+	SDL_LockMutex(mutex);
+
+	// jobs that the worker hasn't picked up won't be started anymore
+	for (size_t i = 0; i < queue.size(); ++i) {
+		queue[i]->done = true;
+	}
+	queue.clear();
+
+	std::map<SoundManager::SoundID, SoundDecodeJob*>::iterator it;
+	for (it = jobs.begin(); it != jobs.end(); ++it) {
+		SoundDecodeJob *job = it->second;
+		while (!job->done)
+			SDL_CondWait(job_done, mutex);
+
+		if (job->chunk)
+			Mix_FreeChunk(job->chunk);
+		delete job;
+	}
+	jobs.clear();
+	SDL_UnlockMutex(mutex);
+}
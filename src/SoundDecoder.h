@@ -0,0 +1,90 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class SoundDecoder
+ *
+ * Decodes sound effects into Mix_Chunks on a background thread, so that
+ * loading a set of sounds doesn't stall the main thread on disk reads.
+ * Sounds are requested with request(), and collected with take() once
+ * isPending() returns false.
+ */
+
+#ifndef SOUND_DECODER_H
+#define SOUND_DECODER_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+
+#include "SoundManager.h"
+
+class SoundDecodeJob {
+public:
+	std::string path;
+	Mix_Chunk *chunk;
+	std::string error;
+	bool done;
+
+	SoundDecodeJob()
+		: path("")
+		, chunk(NULL)
+		, error("")
+		, done(false) {
+	}
+};
+
+class SoundDecoder {
+private:
+	static int run(void *data);
+	void startThread();
+	void stopThread();
+
+	SDL_Thread *thread;
+	SDL_mutex *mutex;
+	SDL_cond *job_added;
+	SDL_cond *job_done;
+	bool quit;
+
+	// jobs by sound id; queue only holds the ones that haven't been started
+	std::map<SoundManager::SoundID, SoundDecodeJob*> jobs;
+	std::deque<SoundDecodeJob*> queue;
+
+public:
+	SoundDecoder();
+	SoundDecoder(const SoundDecoder&); // not implemented
+	~SoundDecoder();
+
+	// starts decoding the file at path in the background
+	void request(SoundManager::SoundID sid, const std::string& path);
+
+	// returns the decoded chunk, which the caller must free
+	// If sid wasn't requested, it is decoded right away on the calling thread.
+	Mix_Chunk* take(SoundManager::SoundID sid, const std::string& path, std::string& error);
+
+	// returns true if sid was requested and is still being decoded
+	bool isPending(SoundManager::SoundID sid);
+
+	// waits for the running job and frees every decoded chunk that wasn't taken
+	void clear();
+};
+
+#endif // SOUND_DECODER_H
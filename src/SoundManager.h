@@ -32,6 +32,8 @@ const std::string GLOBAL_VIRTUAL_CHANNEL = "__global__";
  * sound is already loaded, the SoundID for currently loaded sound
  * will be returned by SoundManager::load().
 **/
+class MemoryUsage;
+
 class SoundManager {
 public:
 	typedef unsigned long SoundID;
@@ -46,16 +48,27 @@ public:
 	virtual void setVolumeSFX(int value) = 0;
 
 	virtual void loadMusic(const std::string& filename) = 0;
+	virtual void preloadMusic(const std::string& filename) = 0;
 	virtual void unloadMusic() = 0;
 	virtual void playMusic() = 0;
 	virtual void stopMusic() = 0;
 	virtual void setVolumeMusic(int value) = 0;
 	virtual bool isPlayingMusic() = 0;
 
+	// called once per frame; switches to music requested by loadMusic() once it's ready
+	virtual void updateMusic() = 0;
+
 	virtual void logic(const FPoint& center) = 0;
 	virtual void reset() = 0;
 
+	// finishes the sounds still being decoded in the background; called before mods is replaced
+	virtual void finishLoads() = 0;
+
 	virtual SoundID getLastPlayedSID() = 0;
+
+	// size of the decoded sounds, in bytes
+	virtual size_t getCacheBytes() = 0;
+	virtual void getMemoryUsage(MemoryUsage& usage) = 0;
 };
 
 /**
@@ -37,8 +37,81 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "UtilsMath.h"
 #include <limits>
 
+// the attributes of enemy definitions, besides the core and sound effect stats
+enum {
+	ENEMY_KEY_NAME,
+	ENEMY_KEY_HUMANOID,
+	ENEMY_KEY_LEVEL,
+	ENEMY_KEY_XP,
+	ENEMY_KEY_LOOT,
+	ENEMY_KEY_LOOT_COUNT,
+	ENEMY_KEY_DEFEAT_STATUS,
+	ENEMY_KEY_CONVERT_STATUS,
+	ENEMY_KEY_FIRST_DEFEAT_LOOT,
+	ENEMY_KEY_QUEST_LOOT,
+	ENEMY_KEY_FLYING,
+	ENEMY_KEY_INTANGIBLE,
+	ENEMY_KEY_FACING,
+	ENEMY_KEY_WAYPOINT_PAUSE,
+	ENEMY_KEY_TURN_DELAY,
+	ENEMY_KEY_CHANCE_PURSUE,
+	ENEMY_KEY_CHANCE_FLEE,
+	ENEMY_KEY_POWER,
+	ENEMY_KEY_PASSIVE_POWERS,
+	ENEMY_KEY_MELEE_RANGE,
+	ENEMY_KEY_THREAT_RANGE,
+	ENEMY_KEY_FLEE_RANGE,
+	ENEMY_KEY_COMBAT_STYLE,
+	ENEMY_KEY_ANIMATIONS,
+	ENEMY_KEY_SUPPRESS_HP,
+	ENEMY_KEY_CATEGORIES,
+	ENEMY_KEY_FLEE_DURATION,
+	ENEMY_KEY_FLEE_COOLDOWN,
+	ENEMY_KEY_RARITY,
+	ENEMY_KEYS_COUNT
+};
+
+static const char* const ENEMY_KEYS[ENEMY_KEYS_COUNT] = {
+	"name",
+	"humanoid",
+	"level",
+	"xp",
+	"loot",
+	"loot_count",
+	"defeat_status",
+	"convert_status",
+	"first_defeat_loot",
+	"quest_loot",
+	"flying",
+	"intangible",
+	"facing",
+	"waypoint_pause",
+	"turn_delay",
+	"chance_pursue",
+	"chance_flee",
+	"power",
+	"passive_powers",
+	"melee_range",
+	"threat_range",
+	"flee_range",
+	"combat_style",
+	"animations",
+	"suppress_hp",
+	"categories",
+	"flee_duration",
+	"flee_cooldown",
+	"rarity"
+};
+
+static const ParserKeyTable enemy_keys(ENEMY_KEYS, ENEMY_KEYS_COUNT);
+
 StatBlock::StatBlock()
 	: statsLoaded(false)
+	, ai_ticks(0)
+	, ai_next_ready(0)
+	, powers_ai_indexed(0)
+	, power_reqs_level(0)
+	, power_reqs_class("")
 	, alive(true)
 	, corpse(false)
 	, corpse_ticks(0)
@@ -101,6 +174,7 @@ StatBlock::StatBlock()
 	, effects()
 	, blocking(false) // hero only
 	, pos()
+	, prev_pos()
 	, knockback_speed()
 	, knockback_srcpos()
 	, knockback_destpos()
@@ -309,7 +383,7 @@ bool StatBlock::loadSfxStat(FileParser *infile) {
 void StatBlock::load(const std::string& filename) {
 	// @CLASS StatBlock: Enemies|Description of enemies in enemies/
 	FileParser infile;
-	if (!infile.open(filename))
+	if (!infile.openCached(filename))
 		return;
 
 	bool clear_loot = true;
@@ -324,166 +398,234 @@ void StatBlock::load(const std::string& filename) {
 		int num = toInt(infile.val);
 		float fnum = toFloat(infile.val);
 		bool valid = loadCoreStat(&infile) || loadSfxStat(&infile);
+		const int key = enemy_keys.get(infile.key);
+
+		switch (key) {
+			// @ATTR name|string|Name
+			case ENEMY_KEY_NAME:
+				name = msg->get(infile.val);
+				break;
+
+			// @ATTR humanoid|bool|This creature gives human traits when transformed into, such as the ability to talk with NPCs.
+			case ENEMY_KEY_HUMANOID:
+				humanoid = toBool(infile.val);
+				break;
 
-		// @ATTR name|string|Name
-		if (infile.key == "name") name = msg->get(infile.val);
-		// @ATTR humanoid|bool|This creature gives human traits when transformed into, such as the ability to talk with NPCs.
-		else if (infile.key == "humanoid") humanoid = toBool(infile.val);
+			// @ATTR level|int|Level
+			case ENEMY_KEY_LEVEL:
+				level = num;
+				break;
 
-		// @ATTR level|int|Level
-		else if (infile.key == "level") level = num;
+			// enemy death rewards and events
+			// @ATTR xp|int|XP awarded upon death.
+			case ENEMY_KEY_XP:
+				xp = num;
+				break;
 
-		// enemy death rewards and events
-		// @ATTR xp|int|XP awarded upon death.
-		else if (infile.key == "xp") xp = num;
-		else if (infile.key == "loot") {
-			// @ATTR loot|repeatable(loot)|Possible loot that can be dropped on death.
+			case ENEMY_KEY_LOOT: {
+				// @ATTR loot|repeatable(loot)|Possible loot that can be dropped on death.
 
-			// loot entries format:
-			// loot=[id],[percent_chance]
-			// optionally allow range:
-			// loot=[id],[percent_chance],[count_min],[count_max]
+				// loot entries format:
+				// loot=[id],[percent_chance]
+				// optionally allow range:
+				// loot=[id],[percent_chance],[count_min],[count_max]
 
-			if (clear_loot) {
-				loot_table.clear();
-				clear_loot = false;
+				if (clear_loot) {
+					loot_table.clear();
+					clear_loot = false;
+				}
+
+				loot_table.push_back(Event_Component());
+				loot->parseLoot(infile.val, &loot_table.back(), &loot_table);
+				break;
 			}
 
-			loot_table.push_back(Event_Component());
-			loot->parseLoot(infile.val, &loot_table.back(), &loot_table);
-		}
-		else if (infile.key == "loot_count") {
-			// @ATTR loot_count|int, int : Min, Max|Sets the minimum (and optionally, the maximum) amount of loot this creature can drop. Overrides the global drop_max setting.
-			loot_count.x = popFirstInt(infile.val);
-			loot_count.y = popFirstInt(infile.val);
-			if (loot_count.x != 0 || loot_count.y != 0) {
-				loot_count.x = std::max(loot_count.x, 1);
-				loot_count.y = std::max(loot_count.y, loot_count.x);
+			case ENEMY_KEY_LOOT_COUNT: {
+				// @ATTR loot_count|int, int : Min, Max|Sets the minimum (and optionally, the maximum) amount of loot this creature can drop. Overrides the global drop_max setting.
+				loot_count.x = popFirstInt(infile.val);
+				loot_count.y = popFirstInt(infile.val);
+				if (loot_count.x != 0 || loot_count.y != 0) {
+					loot_count.x = std::max(loot_count.x, 1);
+					loot_count.y = std::max(loot_count.y, loot_count.x);
+				}
+				break;
 			}
-		}
-		// @ATTR defeat_status|string|Campaign status to set upon death.
-		else if (infile.key == "defeat_status") defeat_status = infile.val;
-		// @ATTR convert_status|string|Campaign status to set upon being converted to a player ally.
-		else if (infile.key == "convert_status") convert_status = infile.val;
-		// @ATTR first_defeat_loot|item_id|Drops this item upon first death.
-		else if (infile.key == "first_defeat_loot") first_defeat_loot = num;
-		// @ATTR quest_loot|string, string, item_id : Required status, Required not status, Item|Drops this item when campaign status is met.
-		else if (infile.key == "quest_loot") {
-			quest_loot_requires_status = popFirstString(infile.val);
-			quest_loot_requires_not_status = popFirstString(infile.val);
-			quest_loot_id = popFirstInt(infile.val);
-		}
 
-		// behavior stats
-		// @ATTR flying|bool|Creature can move over gaps/water.
-		else if (infile.key == "flying") flying = toBool(infile.val);
-		// @ATTR intangible|bool|Creature can move through walls.
-		else if (infile.key == "intangible") intangible = toBool(infile.val);
-		// @ATTR facing|bool|Creature can turn to face their target.
-		else if (infile.key == "facing") facing = toBool(infile.val);
-
-		// @ATTR waypoint_pause|duration|Duration to wait at each waypoint in 'ms' or 's'.
-		else if (infile.key == "waypoint_pause") waypoint_pause = parse_duration(infile.val);
-
-		// @ATTR turn_delay|duration|Duration it takes for this creature to turn and face their target in 'ms' or 's'.
-		else if (infile.key == "turn_delay") turn_delay = parse_duration(infile.val);
-		// @ATTR chance_pursue|int|Percentage change that the creature will chase their target.
-		else if (infile.key == "chance_pursue") chance_pursue = num;
-		// @ATTR chance_flee|int|Percentage chance that the creature will run away from their target.
-		else if (infile.key == "chance_flee") chance_flee = num;
-
-		else if (infile.key == "power") {
-			// @ATTR power|["melee", "ranged", "beacon", "on_hit", "on_death", "on_half_dead", "on_join_combat", "on_debuff"], power_id, int : State, Power, Chance|A power that has a chance of being triggered in a certain state.
-			AIPower ai_power;
-
-			std::string ai_type = popFirstString(infile.val);
-
-			ai_power.id = powers->verifyID(popFirstInt(infile.val), &infile, false);
-			if (ai_power.id == 0)
-				continue; // verifyID() will print our error message
-
-			ai_power.chance = popFirstInt(infile.val);
-
-			if (ai_type == "melee") ai_power.type = AI_POWER_MELEE;
-			else if (ai_type == "ranged") ai_power.type = AI_POWER_RANGED;
-			else if (ai_type == "beacon") ai_power.type = AI_POWER_BEACON;
-			else if (ai_type == "on_hit") ai_power.type = AI_POWER_HIT;
-			else if (ai_type == "on_death") ai_power.type = AI_POWER_DEATH;
-			else if (ai_type == "on_half_dead") ai_power.type = AI_POWER_HALF_DEAD;
-			else if (ai_type == "on_join_combat") ai_power.type = AI_POWER_JOIN_COMBAT;
-			else if (ai_type == "on_debuff") ai_power.type = AI_POWER_DEBUFF;
-			else {
-				infile.error("StatBlock: '%s' is not a valid enemy power type.", ai_type.c_str());
-				continue;
+			// @ATTR defeat_status|string|Campaign status to set upon death.
+			case ENEMY_KEY_DEFEAT_STATUS:
+				defeat_status = infile.val;
+				break;
+
+			// @ATTR convert_status|string|Campaign status to set upon being converted to a player ally.
+			case ENEMY_KEY_CONVERT_STATUS:
+				convert_status = infile.val;
+				break;
+
+			// @ATTR first_defeat_loot|item_id|Drops this item upon first death.
+			case ENEMY_KEY_FIRST_DEFEAT_LOOT:
+				first_defeat_loot = num;
+				break;
+
+			// @ATTR quest_loot|string, string, item_id : Required status, Required not status, Item|Drops this item when campaign status is met.
+			case ENEMY_KEY_QUEST_LOOT: {
+				quest_loot_requires_status = popFirstString(infile.val);
+				quest_loot_requires_not_status = popFirstString(infile.val);
+				quest_loot_id = popFirstInt(infile.val);
+				break;
 			}
 
-			if (ai_power.type == AI_POWER_HALF_DEAD)
-				half_dead_power = true;
+			// behavior stats
+			// @ATTR flying|bool|Creature can move over gaps/water.
+			case ENEMY_KEY_FLYING:
+				flying = toBool(infile.val);
+				break;
 
-			powers_ai.push_back(ai_power);
-		}
+			// @ATTR intangible|bool|Creature can move through walls.
+			case ENEMY_KEY_INTANGIBLE:
+				intangible = toBool(infile.val);
+				break;
+
+			// @ATTR facing|bool|Creature can turn to face their target.
+			case ENEMY_KEY_FACING:
+				facing = toBool(infile.val);
+				break;
+
+			// @ATTR waypoint_pause|duration|Duration to wait at each waypoint in 'ms' or 's'.
+			case ENEMY_KEY_WAYPOINT_PAUSE:
+				waypoint_pause = parse_duration(infile.val);
+				break;
 
-		else if (infile.key == "passive_powers") {
-			// @ATTR passive_powers|list(power_id)|A list of passive powers this creature has.
-			powers_passive.clear();
-			std::string p = popFirstString(infile.val);
-			while (p != "") {
-				powers_passive.push_back(toInt(p));
-				p = popFirstString(infile.val);
+			// @ATTR turn_delay|duration|Duration it takes for this creature to turn and face their target in 'ms' or 's'.
+			case ENEMY_KEY_TURN_DELAY:
+				turn_delay = parse_duration(infile.val);
+				break;
+
+			// @ATTR chance_pursue|int|Percentage change that the creature will chase their target.
+			case ENEMY_KEY_CHANCE_PURSUE:
+				chance_pursue = num;
+				break;
+
+			// @ATTR chance_flee|int|Percentage chance that the creature will run away from their target.
+			case ENEMY_KEY_CHANCE_FLEE:
+				chance_flee = num;
+				break;
+
+			case ENEMY_KEY_POWER: {
+				// @ATTR power|["melee", "ranged", "beacon", "on_hit", "on_death", "on_half_dead", "on_join_combat", "on_debuff"], power_id, int : State, Power, Chance|A power that has a chance of being triggered in a certain state.
+				AIPower ai_power;
+
+				std::string ai_type = popFirstString(infile.val);
+
+				ai_power.id = powers->verifyID(popFirstInt(infile.val), &infile, false);
+				if (ai_power.id == 0)
+					continue; // verifyID() will print our error message
+
+				ai_power.chance = popFirstInt(infile.val);
+
+				if (ai_type == "melee") ai_power.type = AI_POWER_MELEE;
+				else if (ai_type == "ranged") ai_power.type = AI_POWER_RANGED;
+				else if (ai_type == "beacon") ai_power.type = AI_POWER_BEACON;
+				else if (ai_type == "on_hit") ai_power.type = AI_POWER_HIT;
+				else if (ai_type == "on_death") ai_power.type = AI_POWER_DEATH;
+				else if (ai_type == "on_half_dead") ai_power.type = AI_POWER_HALF_DEAD;
+				else if (ai_type == "on_join_combat") ai_power.type = AI_POWER_JOIN_COMBAT;
+				else if (ai_type == "on_debuff") ai_power.type = AI_POWER_DEBUFF;
+				else {
+					infile.error("StatBlock: '%s' is not a valid enemy power type.", ai_type.c_str());
+					continue;
+				}
+
+				if (ai_power.type == AI_POWER_HALF_DEAD)
+					half_dead_power = true;
+
+				powers_ai.push_back(ai_power);
+				break;
 			}
-		}
 
-		// @ATTR melee_range|float|Minimum distance from target required to use melee powers.
-		else if (infile.key == "melee_range") melee_range = fnum;
-		// @ATTR threat_range|float, float: Engage distance, Stop distance|The first value is the radius of the area this creature will be able to start chasing the hero. The second, optional, value is the radius at which this creature will stop pursuing their target and defaults to double the first value.
-		else if (infile.key == "threat_range") {
-			threat_range = toFloat(popFirstString(infile.val));
-
-			std::string tr_far = popFirstString(infile.val);
-			if (!tr_far.empty())
-				threat_range_far = toFloat(tr_far);
-			else
-				threat_range_far = threat_range * 2;
-		}
-		// @ATTR flee_range|float|The radius at which this creature will start moving to a safe distance. Defaults to half of the threat_range.
-		else if (infile.key == "flee_range") {
-			flee_range = fnum;
-			flee_range_defined = true;
-		}
-		// @ATTR combat_style|["default", "aggressive", "passive"]|How the creature will enter combat. Default is within range of the hero; Aggressive is always in combat; Passive must be attacked to enter combat.
-		else if (infile.key == "combat_style") {
-			if (infile.val == "default") combat_style = COMBAT_DEFAULT;
-			else if (infile.val == "aggressive") combat_style = COMBAT_AGGRESSIVE;
-			else if (infile.val == "passive") combat_style = COMBAT_PASSIVE;
-			else infile.error("StatBlock: Unknown combat style '%s'", infile.val.c_str());
-		}
+			case ENEMY_KEY_PASSIVE_POWERS: {
+				// @ATTR passive_powers|list(power_id)|A list of passive powers this creature has.
+				powers_passive.clear();
+				std::string p = popFirstString(infile.val);
+				while (p != "") {
+					powers_passive.push_back(toInt(p));
+					p = popFirstString(infile.val);
+				}
+				break;
+			}
+
+			// @ATTR melee_range|float|Minimum distance from target required to use melee powers.
+			case ENEMY_KEY_MELEE_RANGE:
+				melee_range = fnum;
+				break;
 
-		// @ATTR animations|filename|Filename of an animation definition.
-		else if (infile.key == "animations") animations = infile.val;
+			// @ATTR threat_range|float, float: Engage distance, Stop distance|The first value is the radius of the area this creature will be able to start chasing the hero. The second, optional, value is the radius at which this creature will stop pursuing their target and defaults to double the first value.
+			case ENEMY_KEY_THREAT_RANGE: {
+				threat_range = toFloat(popFirstString(infile.val));
 
-		// @ATTR suppress_hp|bool|Hides the enemy HP bar for this creature.
-		else if (infile.key == "suppress_hp") suppress_hp = toBool(infile.val);
+				std::string tr_far = popFirstString(infile.val);
+				if (!tr_far.empty())
+					threat_range_far = toFloat(tr_far);
+				else
+					threat_range_far = threat_range * 2;
+				break;
+			}
 
-		else if (infile.key == "categories") {
-			// @ATTR categories|list(string)|Categories that this enemy belongs to.
-			categories.clear();
-			std::string cat;
-			while ((cat = popFirstString(infile.val)) != "") {
-				categories.push_back(cat);
+			// @ATTR flee_range|float|The radius at which this creature will start moving to a safe distance. Defaults to half of the threat_range.
+			case ENEMY_KEY_FLEE_RANGE: {
+				flee_range = fnum;
+				flee_range_defined = true;
+				break;
 			}
-		}
 
-		// @ATTR flee_duration|duration|The minimum amount of time that this creature will flee. They may flee longer than the specified time.
-		else if (infile.key == "flee_duration") flee_duration = parse_duration(infile.val);
-		// @ATTR flee_cooldown|duration|The amount of time this creature must wait before they can start fleeing again.
-		else if (infile.key == "flee_cooldown") flee_cooldown = parse_duration(infile.val);
+			// @ATTR combat_style|["default", "aggressive", "passive"]|How the creature will enter combat. Default is within range of the hero; Aggressive is always in combat; Passive must be attacked to enter combat.
+			case ENEMY_KEY_COMBAT_STYLE: {
+				if (infile.val == "default") combat_style = COMBAT_DEFAULT;
+				else if (infile.val == "aggressive") combat_style = COMBAT_AGGRESSIVE;
+				else if (infile.val == "passive") combat_style = COMBAT_PASSIVE;
+				else infile.error("StatBlock: Unknown combat style '%s'", infile.val.c_str());
+				break;
+			}
+
+			// @ATTR animations|filename|Filename of an animation definition.
+			case ENEMY_KEY_ANIMATIONS:
+				animations = infile.val;
+				break;
+
+			// @ATTR suppress_hp|bool|Hides the enemy HP bar for this creature.
+			case ENEMY_KEY_SUPPRESS_HP:
+				suppress_hp = toBool(infile.val);
+				break;
+
+			case ENEMY_KEY_CATEGORIES: {
+				// @ATTR categories|list(string)|Categories that this enemy belongs to.
+				categories.clear();
+				std::string cat;
+				while ((cat = popFirstString(infile.val)) != "") {
+					categories.push_back(cat);
+				}
+				break;
+			}
+
+			// @ATTR flee_duration|duration|The minimum amount of time that this creature will flee. They may flee longer than the specified time.
+			case ENEMY_KEY_FLEE_DURATION:
+				flee_duration = parse_duration(infile.val);
+				break;
+
+			// @ATTR flee_cooldown|duration|The amount of time this creature must wait before they can start fleeing again.
+			case ENEMY_KEY_FLEE_COOLDOWN:
+				flee_cooldown = parse_duration(infile.val);
+				break;
 
-		// this is only used for EnemyGroupManager
-		// we check for them here so that we don't get an error saying they are invalid
-		else if (infile.key == "rarity") ; // but do nothing
+			// this is only used for EnemyGroupManager
+			// we check for them here so that we don't get an error saying they are invalid
+			case ENEMY_KEY_RARITY:
+				// but do nothing
+				break;
 
-		else if (!valid) {
-			infile.error("StatBlock: '%s' is not a valid key.", infile.key.c_str());
+			default:
+				if (!valid)
+					infile.error("StatBlock: '%s' is not a valid key.", infile.key.c_str());
+				break;
 		}
 	}
 	infile.close();
@@ -572,10 +714,30 @@ void StatBlock::calcBase() {
 	base[STAT_ABS_MAX] = std::max(base[STAT_ABS_MAX], base[STAT_ABS_MIN]);
 }
 
+void StatBlock::getDerivedInputs(std::vector<int>& inputs) {
+	inputs.clear();
+	inputs.push_back(level);
+	inputs.push_back(dmg_melee_min_add);
+	inputs.push_back(dmg_melee_max_add);
+	inputs.push_back(dmg_ment_min_add);
+	inputs.push_back(dmg_ment_max_add);
+	inputs.push_back(dmg_ranged_min_add);
+	inputs.push_back(dmg_ranged_max_add);
+	inputs.push_back(absorb_min_add);
+	inputs.push_back(absorb_max_add);
+	inputs.insert(inputs.end(), primary.begin(), primary.end());
+	inputs.insert(inputs.end(), starting.begin(), starting.end());
+	inputs.insert(inputs.end(), vulnerable_base.begin(), vulnerable_base.end());
+	inputs.insert(inputs.end(), effects.bonus.begin(), effects.bonus.end());
+	inputs.insert(inputs.end(), effects.bonus_resist.begin(), effects.bonus_resist.end());
+	inputs.insert(inputs.end(), effects.bonus_primary.begin(), effects.bonus_primary.end());
+}
+
 /**
  * Recalc derived stats from base stats + effect bonuses
  */
 void StatBlock::applyEffects() {
+	getDerivedInputs(derived_inputs);
 
 	// preserve hp/mp states
 	prev_maxhp = get(STAT_HP_MAX);
@@ -640,7 +802,20 @@ void StatBlock::logic() {
 	effects.logic();
 
 	// apply bonuses from items/effects to base stats
-	applyEffects();
+	// if none of them changed, only the bookkeeping of applyEffects() is needed
+	getDerivedInputs(derived_inputs_check);
+	if (derived_inputs_check != derived_inputs) {
+		applyEffects();
+	}
+	else {
+		prev_maxhp = get(STAT_HP_MAX);
+		prev_maxmp = get(STAT_MP_MAX);
+		pres_hp = hp;
+		pres_mp = mp;
+		if (hp > prev_maxhp) hp = prev_maxhp;
+		if (mp > prev_maxmp) mp = prev_maxmp;
+		speed = speed_default;
+	}
 
 	if (hero && effects.refresh_stats) {
 		refresh_stats = true;
@@ -661,9 +836,7 @@ void StatBlock::logic() {
 	// handle cooldowns
 	if (cooldown_ticks > 0) cooldown_ticks--; // global cooldown
 
-	for (size_t i=0; i<powers_ai.size(); ++i) { // NPC/enemy powerslot cooldown
-		if (powers_ai[i].ticks > 0) powers_ai[i].ticks--;
-	}
+	ai_ticks++; // NPC/enemy powerslot cooldown
 
 	// HP regen
 	if (get(STAT_HP_REGEN) > 0 && hp < get(STAT_HP_MAX) && hp > 0) {
@@ -788,17 +961,58 @@ bool StatBlock::canUsePower(const Power &power, int powerid) const {
 			&& (power.sacrifice || hp > power.requires_hp)
 			&& (!power.requires_corpse || (power.requires_corpse && ((target_corpse && target_corpse->corpse_ticks > 0) || (target_nearest_corpse && powers->checkNearestTargeting(power, this, true) && target_nearest_corpse->corpse_ticks > 0))))
 			&& (checkRequiredSpawns(power.requires_spawns))
-			&& (menu_powers && menu_powers->meetsUsageStats(powerid))
 			&& (power.type == POWTYPE_SPAWN ? !summonLimitReached(powerid) : true)
 			&& !(power.spawn_type == "untransform" && !transformed)
-			&& std::includes(equip_flags.begin(), equip_flags.end(), power.requires_flags.begin(), power.requires_flags.end())
 			&& (!power.buff_party || (power.buff_party && enemies && enemies->checkPartyMembers()))
-			&& (power.requires_item == -1 || (power.requires_item > 0 && items->requirementsMet(this, power.requires_item)))
+			&& meetsPowerRequirements(power, powerid)
 		);
 	}
 
 }
 
+bool StatBlock::meetsPowerRequirements(const Power &power, int powerid) const {
+	// the power menu is where the stat requirements come from, so nothing can be cached without it
+	if (!menu_powers)
+		return false;
+
+	bool unchanged = power_reqs_level == level && power_reqs_class == character_class && power_reqs_primary.size() == PRIMARY_STATS.size();
+	for (size_t i = 0; unchanged && i < PRIMARY_STATS.size(); ++i) {
+		unchanged = power_reqs_primary[i] == get_primary(i);
+	}
+
+	if (!unchanged) {
+		clearPowerRequirements();
+		power_reqs_level = level;
+		power_reqs_class = character_class;
+		power_reqs_primary.resize(PRIMARY_STATS.size());
+		for (size_t i = 0; i < PRIMARY_STATS.size(); ++i) {
+			power_reqs_primary[i] = get_primary(i);
+		}
+	}
+
+	const size_t index = static_cast<size_t>(powerid);
+	if (index < power_reqs_checked.size() && power_reqs_checked[index])
+		return power_reqs_met[index];
+
+	const bool met = menu_powers->meetsUsageStats(powerid)
+		&& std::includes(equip_flags.begin(), equip_flags.end(), power.requires_flags.begin(), power.requires_flags.end())
+		&& (power.requires_item == -1 || (power.requires_item > 0 && items->requirementsMet(this, power.requires_item)));
+
+	if (index >= power_reqs_checked.size()) {
+		power_reqs_checked.resize(powers->powers.size(), false);
+		power_reqs_met.resize(powers->powers.size(), false);
+	}
+	if (index < power_reqs_checked.size()) {
+		power_reqs_checked[index] = true;
+		power_reqs_met[index] = met;
+	}
+	return met;
+}
+
+void StatBlock::clearPowerRequirements() const {
+	power_reqs_checked.assign(power_reqs_checked.size(), false);
+}
+
 void StatBlock::loadHeroStats() {
 	// set the default global cooldown
 	cooldown = parse_duration("66ms");
@@ -985,18 +1199,36 @@ void StatBlock::addXP(int amount) {
 		xp = xp_table.back();
 }
 
+void StatBlock::indexAIPowers() {
+	for (int i=0; i<AI_POWER_TYPE_COUNT; ++i)
+		powers_ai_by_type[i].clear();
+
+	for (size_t i=0; i<powers_ai.size(); ++i)
+		powers_ai_by_type[powers_ai[i].type].push_back(i);
+
+	powers_ai_indexed = powers_ai.size();
+}
+
 AIPower* StatBlock::getAIPower(AI_POWER ai_type) {
-	std::vector<size_t> possible_ids;
-	int chance = rand() % 100;
+	if (powers_ai_indexed != powers_ai.size())
+		indexAIPowers();
 
-	for (size_t i=0; i<powers_ai.size(); ++i) {
-		if (ai_type != powers_ai[i].type)
-			continue;
+	const std::vector<size_t> &candidates = powers_ai_by_type[ai_type];
+	int chance = randInt(100, RANDOM_AI);
+
+	if (candidates.empty() || !hasReadyAIPower())
+		return NULL;
+
+	std::vector<size_t> &possible_ids = possible_ai_powers;
+	possible_ids.clear();
+
+	for (size_t j=0; j<candidates.size(); ++j) {
+		size_t i = candidates[j];
 
 		if (chance > powers_ai[i].chance)
 			continue;
 
-		if (powers_ai[i].ticks > 0)
+		if (!isAIPowerReady(i))
 			continue;
 
 		if (powers->powers[powers_ai[i].id].type == POWTYPE_SPAWN) {
@@ -1011,13 +1243,62 @@ AIPower* StatBlock::getAIPower(AI_POWER ai_type) {
 	}
 
 	if (!possible_ids.empty()) {
-		size_t index = static_cast<size_t>(rand()) % possible_ids.size();
+		size_t index = randIndex(possible_ids.size(), RANDOM_AI);
 		return &powers_ai[possible_ids[index]];
 	}
 
 	return NULL;
 }
 
+bool StatBlock::isAIPowerReady(size_t index) const {
+	return powers_ai[index].ready_tick <= ai_ticks;
+}
+
+/**
+ * True if any of the AI powers is off cooldown
+ */
+bool StatBlock::hasReadyAIPower() const {
+	return !powers_ai.empty() && ai_next_ready <= ai_ticks;
+}
+
+void StatBlock::setAIPowerCooldown(size_t index, int ticks) {
+	powers_ai[index].ready_tick = ai_ticks + static_cast<unsigned>(std::max(0, ticks));
+
+	ai_next_ready = powers_ai[0].ready_tick;
+	for (size_t i=1; i<powers_ai.size(); ++i)
+		ai_next_ready = std::min(ai_next_ready, powers_ai[i].ready_tick);
+}
+
+void StatBlock::indexPassives() {
+	if (!passives_by_trigger.empty() && powers_passive == passives_indexed && powers_list_items == passives_indexed_items)
+		return;
+
+	passives_by_trigger.clear();
+	passives_by_trigger.resize(TRIGGER_COUNT + 1);
+
+	// unlocked powers first, then item powers, in the order the lists have them
+	for (size_t j=0; j<2; ++j) {
+		const std::vector<int>& list = (j == 0) ? powers_passive : powers_list_items;
+		for (size_t i=0; i<list.size(); ++i) {
+			const Power& pow = powers->powers[list[i]];
+			if (pow.passive && pow.passive_trigger >= -1 && pow.passive_trigger < TRIGGER_COUNT)
+				passives_by_trigger[pow.passive_trigger + 1].push_back(list[i]);
+		}
+	}
+
+	passives_indexed = powers_passive;
+	passives_indexed_items = powers_list_items;
+}
+
+const std::vector<int>& StatBlock::getPassives(int trigger) const {
+	// a StatBlock copied from one that was never indexed has no lists yet
+	static const std::vector<int> none;
+	if (passives_by_trigger.empty())
+		return none;
+
+	return passives_by_trigger[trigger + 1];
+}
+
 bool StatBlock::checkRequiredSpawns(int req_amount) const {
 	if (req_amount <= 0)
 		return true;
@@ -45,6 +45,7 @@ typedef enum {
 	AI_POWER_JOIN_COMBAT = 6,
 	AI_POWER_DEBUFF = 7
 } AI_POWER;
+const int AI_POWER_TYPE_COUNT = 8;
 
 // active states
 const int ENEMY_STANCE = 0;
@@ -67,13 +68,13 @@ public:
 	AI_POWER type;
 	int id;
 	int chance;
-	int ticks;
+	unsigned ready_tick; // the StatBlock's ai_ticks value at which the cooldown of this power is over
 
 	AIPower()
 		: type(AI_POWER_MELEE)
 		, id(0)
 		, chance(0)
-		, ticks(0)
+		, ready_tick(0)
 	{}
 };
 
@@ -85,6 +86,37 @@ private:
 	bool checkRequiredSpawns(int req_amount) const;
 	bool statsLoaded;
 
+	// everything the derived stats are calculated from, as of the last applyEffects()
+	// logic() skips recalculating them while this stays the same
+	void getDerivedInputs(std::vector<int>& inputs);
+	std::vector<int> derived_inputs;
+	std::vector<int> derived_inputs_check;
+
+	// AI power cooldowns end at a tick of this counter, so logic() doesn't need to count each of them down
+	unsigned ai_ticks;
+	unsigned ai_next_ready; // the earliest ready_tick in powers_ai
+
+	// indexes of powers_ai, by AI power type; rebuilt when the size of powers_ai changes
+	void indexAIPowers();
+	std::vector<size_t> powers_ai_by_type[AI_POWER_TYPE_COUNT];
+	size_t powers_ai_indexed;
+	std::vector<size_t> possible_ai_powers;
+
+	// the passive powers of powers_passive and powers_list_items, by passive trigger + 1 (passives without a trigger come first)
+	// rebuilt when either list differs from the copy it was made from
+	std::vector< std::vector<int> > passives_by_trigger;
+	std::vector<int> passives_indexed;
+	std::vector<int> passives_indexed_items;
+
+	// the parts of canUsePower() that only depend on equipment, level, class and primary stats, one bit per power
+	// dropped by clearPowerRequirements() and when the level, class or primary stats differ from the copies below
+	bool meetsPowerRequirements(const Power &power, int powerid) const;
+	mutable std::vector<bool> power_reqs_checked;
+	mutable std::vector<bool> power_reqs_met;
+	mutable int power_reqs_level;
+	mutable std::string power_reqs_class;
+	mutable std::vector<int> power_reqs_primary;
+
 public:
 	StatBlock();
 	~StatBlock();
@@ -105,6 +137,15 @@ public:
 	void addXP(int amount);
 	AIPower* getAIPower(AI_POWER ai_type);
 
+	bool isAIPowerReady(size_t index) const;
+	bool hasReadyAIPower() const;
+	void setAIPowerCooldown(size_t index, int ticks);
+
+	// sorts the passive powers by trigger if the power lists have changed; see getPassives()
+	void indexPassives();
+	// the passive powers with this trigger, or -1 for the ones without a trigger
+	const std::vector<int>& getPassives(int trigger) const;
+
 	bool alive;
 	bool corpse; // creature is dead and done animating
 	int corpse_ticks;
@@ -193,7 +234,7 @@ public:
 	float speed;
 	float charge_speed;
 
-	std::set<std::string> equip_flags;
+	std::set<StringHandle> equip_flags;
 	std::vector<int> vulnerable;
 	std::vector<int> vulnerable_base;
 
@@ -207,6 +248,7 @@ public:
 	bool blocking;
 
 	FPoint pos;
+	FPoint prev_pos; // pos at the start of the current logic frame
 	FPoint knockback_speed;
 	FPoint knockback_srcpos;
 	FPoint knockback_destpos;
@@ -241,6 +283,9 @@ public:
 
 	bool canUsePower(const Power &power, int powerid) const;
 
+	// called when equip_flags change
+	void clearPowerRequirements() const;
+
 	float melee_range;
 	float threat_range;
 	float threat_range_far;
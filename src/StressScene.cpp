@@ -0,0 +1,208 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class StressScene
+ */
+
+#include "Avatar.h"
+#include "EnemyManager.h"
+#include "LootManager.h"
+#include "MapRenderer.h"
+#include "PowerManager.h"
+#include "Profiler.h"
+#include "SharedGameResources.h"
+#include "SharedResources.h"
+#include "Settings.h"
+#include "StressScene.h"
+#include "UtilsMath.h"
+
+#include <stdio.h>
+
+// time for enemies to load and spread out before measuring starts
+const int STRESS_SCENE_WARMUP_SECONDS = 2;
+
+// hazards are aimed at a spot this many tiles from where they are fired
+const int STRESS_SCENE_HAZARD_RANGE = 6;
+
+StressScene::StressScene()
+	: state(STATE_IDLE)
+	, ticks(0)
+	, hazard_timer(0)
+	, last_frame(0)
+{
+	source.hero_ally = true;
+}
+
+StressScene::~StressScene() {
+}
+
+bool StressScene::start(const StressSceneConfig& _config) {
+	if (state != STATE_IDLE)
+		return false;
+
+	config = _config;
+	config.size = std::max(16, std::min(config.size, STRESS_SCENE_SIZE_MAX));
+	config.layers = std::max(1, config.layers);
+	config.seconds = std::max(1, config.seconds);
+
+	return_map = mapr->getFilename();
+	return_pos = pc->stats.pos;
+
+	mapr->teleportation = true;
+	mapr->teleport_mapname = STRESS_SCENE_MAP;
+	mapr->teleport_destination = FPoint(-1, -1);
+
+	state = STATE_LOADING;
+	return true;
+}
+
+bool StressScene::isActive() {
+	return state != STATE_IDLE;
+}
+
+void StressScene::generateMap() {
+	mapr->generate(STRESS_SCENE_MAP, Point(config.size, config.size), config.layers, config.seed);
+}
+
+FPoint StressScene::getRandomPos() {
+	// the border is solid, so a free tile is found quickly unless the map is very crowded
+	for (int i = 0; i < 100; ++i) {
+		FPoint pos(static_cast<float>(randInt(config.size)) + 0.5f, static_cast<float>(randInt(config.size)) + 0.5f);
+		if (mapr->collider.is_empty(pos.x, pos.y))
+			return pos;
+	}
+	return mapr->hero_pos;
+}
+
+/**
+ * Queue the enemies and drop the loot
+ * The enemies are created by the EnemyManager on its next logic()
+ */
+void StressScene::populate() {
+	for (int i = 0; i < config.enemy_count; ++i) {
+		enemies->spawn(config.enemy_category, FPointToPoint(getRandomPos()));
+	}
+
+	std::vector<int> item_ids;
+	for (size_t i = 1; i < items->items.size(); ++i) {
+		if (items->items[i].has_name)
+			item_ids.push_back(static_cast<int>(i));
+	}
+
+	if (!item_ids.empty()) {
+		for (int i = 0; i < config.loot_count; ++i) {
+			ItemStack stack;
+			stack.item = item_ids[static_cast<size_t>(randInt(static_cast<int>(item_ids.size())))];
+			stack.quantity = 1;
+			loot->addLoot(stack, getRandomPos());
+		}
+	}
+}
+
+void StressScene::fireHazard() {
+	source.pos = getRandomPos();
+
+	FPoint target = source.pos;
+	target.x += static_cast<float>(randBetween(-STRESS_SCENE_HAZARD_RANGE, STRESS_SCENE_HAZARD_RANGE));
+	target.y += static_cast<float>(randBetween(-STRESS_SCENE_HAZARD_RANGE, STRESS_SCENE_HAZARD_RANGE));
+	source.direction = calcDirection(source.pos.x, source.pos.y, target.x, target.y);
+
+	powers->activate(config.power_id, &source, target);
+}
+
+void StressScene::report() {
+	std::vector<float> values(frame_times);
+	float p50 = calcPercentile(values, 50);
+	float p95 = calcPercentile(values, 95);
+	float p99 = calcPercentile(values, 99);
+	float peak = calcPercentile(values, 100);
+
+	char buf[256];
+	snprintf(buf, sizeof(buf), "%dx%d, %d layers, %d enemies, %d hazards/s, %d loot: %u frames, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms",
+		config.size, config.size, config.layers, config.enemy_count, config.hazards_per_second, config.loot_count,
+		static_cast<unsigned>(frame_times.size()), p50, p95, p99, peak);
+
+	logInfo("StressScene: %s", buf);
+	pc->logMsg(msg->get("Stress scene: %s", buf), false);
+}
+
+/**
+ * Send the hero back to the map they started the scene from
+ */
+void StressScene::finish() {
+	state = STATE_IDLE;
+	frame_times.clear();
+
+	if (!return_map.empty()) {
+		mapr->teleportation = true;
+		mapr->teleport_mapname = return_map;
+		mapr->teleport_destination = return_pos;
+	}
+}
+
+void StressScene::logic() {
+	if (state == STATE_IDLE || mapr->teleportation)
+		return;
+
+	// the hero left the scene, most likely by dying
+	if (mapr->getFilename() != STRESS_SCENE_MAP) {
+		if (state != STATE_LOADING) {
+			logInfo("StressScene: The scene was left before it finished.");
+			state = STATE_IDLE;
+			frame_times.clear();
+		}
+		return;
+	}
+
+	if (state == STATE_LOADING) {
+		populate();
+		ticks = STRESS_SCENE_WARMUP_SECONDS * MAX_FRAMES_PER_SEC;
+		hazard_timer = 0;
+		state = STATE_WARMUP;
+	}
+
+	// hazards are fired at an even rate, including during the warmup
+	if (config.hazards_per_second > 0 && config.power_id > 0) {
+		hazard_timer += config.hazards_per_second;
+		while (hazard_timer >= MAX_FRAMES_PER_SEC) {
+			hazard_timer -= MAX_FRAMES_PER_SEC;
+			fireHazard();
+		}
+	}
+
+	if (state == STATE_WARMUP) {
+		if (--ticks <= 0) {
+			ticks = config.seconds * MAX_FRAMES_PER_SEC;
+			last_frame = getFrameCount();
+			frame_times.clear();
+			state = STATE_RUNNING;
+		}
+	}
+	else if (state == STATE_RUNNING) {
+		// several logic ticks may run for a single frame
+		if (getFrameCount() != last_frame) {
+			last_frame = getFrameCount();
+			frame_times.push_back(getLastFrameTime());
+		}
+
+		if (--ticks <= 0) {
+			report();
+			finish();
+		}
+	}
+}
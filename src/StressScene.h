@@ -0,0 +1,109 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class StressScene
+ *
+ * A generated map filled with enemies, hazards and loot, for measuring how the
+ * engine scales with the number of entities. The scene is started from the
+ * developer console. After a short warmup, the frame times of a fixed
+ * duration are recorded and reported, and the hero is sent back to where they
+ * came from.
+ */
+
+#ifndef STRESS_SCENE_H
+#define STRESS_SCENE_H
+
+#include "CommonIncludes.h"
+#include "StatBlock.h"
+#include "Utils.h"
+
+// the name of the generated map; it is never read from a file
+const std::string STRESS_SCENE_MAP = "maps/stress_scene.txt";
+
+// maps can't be generated larger than this
+const int STRESS_SCENE_SIZE_MAX = 1024;
+
+class StressSceneConfig {
+public:
+	int size;
+	int layers;
+	std::string enemy_category;
+	int enemy_count;
+	int power_id;
+	int hazards_per_second;
+	int loot_count;
+	int seconds;
+	unsigned seed;
+
+	StressSceneConfig()
+		: size(128)
+		, layers(2)
+		, enemy_category("")
+		, enemy_count(0)
+		, power_id(0)
+		, hazards_per_second(0)
+		, loot_count(0)
+		, seconds(30)
+		, seed(1) {
+	}
+};
+
+class StressScene {
+private:
+	enum {
+		STATE_IDLE = 0,
+		STATE_LOADING,
+		STATE_WARMUP,
+		STATE_RUNNING
+	};
+
+	FPoint getRandomPos();
+	void populate();
+	void fireHazard();
+	void report();
+	void finish();
+
+	StressSceneConfig config;
+	int state;
+	int ticks;
+	int hazard_timer;
+
+	// the hazards need a source that lasts as long as they do
+	StatBlock source;
+
+	unsigned last_frame;
+	std::vector<float> frame_times;
+
+	std::string return_map;
+	FPoint return_pos;
+
+public:
+	StressScene();
+	~StressScene();
+
+	// teleports the hero to a new scene; does nothing if one is already running
+	bool start(const StressSceneConfig& _config);
+	bool isActive();
+
+	// called by GameStatePlay in place of loading the map
+	void generateMap();
+
+	void logic();
+};
+
+#endif // STRESS_SCENE_H
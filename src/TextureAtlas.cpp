@@ -0,0 +1,177 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "CommonIncludes.h"
+#include "MemoryUsage.h"
+#include "RenderDevice.h"
+#include "Settings.h"
+#include "TextureAtlas.h"
+
+TextureAtlas::TextureAtlas(RenderDevice *_device)
+	: device(_device) {
+}
+
+TextureAtlas::~TextureAtlas() {
+	clear();
+}
+
+Image* TextureAtlas::load(const std::string& filename, Rect& bounds, const std::string& errormessage, bool IfNotFoundExit) {
+	std::map<std::string, TextureAtlasEntry>::iterator it = entries.find(filename);
+	if (it != entries.end()) {
+		bounds = it->second.bounds;
+		it->second.page->ref();
+		return it->second.page;
+	}
+
+	Image *graphics = device->loadImage(filename, errormessage, IfNotFoundExit);
+	if (!graphics)
+		return NULL;
+
+	bounds.x = bounds.y = 0;
+	bounds.w = graphics->getWidth();
+	bounds.h = graphics->getHeight();
+
+	if (!TEXTURE_ATLAS)
+		return graphics;
+
+	TextureAtlasEntry entry;
+	entry.bounds = bounds;
+	if (!pack(graphics, entry))
+		return graphics;
+
+	// the pixels are in the atlas now, so the original texture can go
+	graphics->unref();
+	device->cacheRemove(filename);
+
+	entries[filename] = entry;
+	bounds = entry.bounds;
+	entry.page->ref();
+	return entry.page;
+}
+
+/**
+ * Copies graphics into the current page, starting a new page if it doesn't fit.
+ * Uses the same shelf packing as the font glyph cache.
+ */
+bool TextureAtlas::pack(Image *graphics, TextureAtlasEntry& entry) {
+	const int w = entry.bounds.w + ATLAS_PADDING;
+	const int h = entry.bounds.h + ATLAS_PADDING;
+
+	if (entry.bounds.w <= 0 || entry.bounds.h <= 0 || entry.bounds.w > ATLAS_IMAGE_MAX || entry.bounds.h > ATLAS_IMAGE_MAX)
+		return false;
+
+	if (!pages.empty()) {
+		TextureAtlasPage &page = pages.back();
+		if (page.cursor.x + w > ATLAS_PAGE_SIZE) {
+			page.cursor.x = 0;
+			page.cursor.y += page.row_height;
+			page.row_height = 0;
+		}
+	}
+
+	if (pages.empty() || pages.back().cursor.y + h > ATLAS_PAGE_SIZE) {
+		releaseUnused();
+
+		Image *image = device->createImage(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+		if (!image)
+			return false;
+		if (image->getWidth() != ATLAS_PAGE_SIZE || image->getHeight() != ATLAS_PAGE_SIZE) {
+			// the renderer can't create textures this large
+			image->unref();
+			return false;
+		}
+
+		pages.push_back(TextureAtlasPage());
+		pages.back().image = image;
+	}
+
+	TextureAtlasPage &page = pages.back();
+
+	Rect src = entry.bounds;
+	entry.page = page.image;
+	entry.bounds.x = page.cursor.x;
+	entry.bounds.y = page.cursor.y;
+
+	Rect dest = entry.bounds;
+	device->copyToImage(graphics, src, page.image, dest);
+
+	page.cursor.x += w;
+	page.row_height = std::max(page.row_height, h);
+
+	return true;
+}
+
+/**
+ * Frees the pages that are only referenced by the atlas itself
+ */
+void TextureAtlas::releaseUnused() {
+	for (size_t i = pages.size(); i > 0; --i) {
+		Image *image = pages[i-1].image;
+		if (image->getRefCount() > 1)
+			continue;
+
+		std::map<std::string, TextureAtlasEntry>::iterator it = entries.begin();
+		while (it != entries.end()) {
+			if (it->second.page == image)
+				entries.erase(it++);
+			else
+				++it;
+		}
+
+		image->unref();
+		pages.erase(pages.begin() + (i-1));
+	}
+}
+
+void TextureAtlas::getMemoryUsage(MemoryUsage& usage) const {
+	const size_t page_bytes = static_cast<size_t>(ATLAS_PAGE_SIZE) * static_cast<size_t>(ATLAS_PAGE_SIZE) * 4;
+
+	for (size_t i = 0; i < pages.size(); ++i) {
+		std::stringstream ss;
+		ss << "atlas page " << i;
+		usage.add(ss.str(), page_bytes);
+	}
+}
+
+/**
+ * The packed images were only kept in the pages, so their files are loaded again
+ */
+void TextureAtlas::restore() {
+	std::map<std::string, TextureAtlasEntry>::iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it) {
+		Image *graphics = device->loadImage(it->first, "Couldn't restore atlas image", false);
+		if (!graphics)
+			continue;
+
+		Rect src;
+		src.w = graphics->getWidth();
+		src.h = graphics->getHeight();
+		Rect dest = it->second.bounds;
+		device->copyToImage(graphics, src, it->second.page, dest);
+
+		graphics->unref();
+		device->cacheRemove(it->first);
+	}
+}
+
+void TextureAtlas::clear() {
+	for (size_t i = 0; i < pages.size(); ++i) {
+		pages[i].image->unref();
+	}
+	pages.clear();
+	entries.clear();
+}
@@ -0,0 +1,103 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class TextureAtlas
+ *
+ * Packs small, read-only images into a few large pages, so that sprites from
+ * different files share the same texture and can be drawn in one batch.
+ * Packed images are addressed by their bounds within the returned page.
+ * Pages are released once nothing outside of the atlas refers to them.
+ */
+
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Utils.h"
+
+class Image;
+class MemoryUsage;
+class RenderDevice;
+
+// width and height of an atlas page
+const int ATLAS_PAGE_SIZE = 2048;
+
+// images wider or taller than this are left on their own texture
+const int ATLAS_IMAGE_MAX = 1024;
+
+// transparent gap between packed images, so that texture filtering doesn't pick up their neighbors
+const int ATLAS_PADDING = 1;
+
+class TextureAtlasPage {
+public:
+	Image *image;
+	Point cursor;
+	int row_height;
+
+	TextureAtlasPage()
+		: image(NULL)
+		, cursor()
+		, row_height(0) {
+	}
+};
+
+class TextureAtlasEntry {
+public:
+	Image *page;
+	Rect bounds;
+
+	TextureAtlasEntry()
+		: page(NULL)
+		, bounds() {
+	}
+};
+
+class TextureAtlas {
+private:
+	void releaseUnused();
+	bool pack(Image *graphics, TextureAtlasEntry& entry);
+
+	RenderDevice *device;
+	std::vector<TextureAtlasPage> pages;
+	std::map<std::string, TextureAtlasEntry> entries;
+
+public:
+	explicit TextureAtlas(RenderDevice *_device);
+	~TextureAtlas();
+
+	// Returns a new reference to the image holding filename, which is either an atlas page or the file's own image.
+	// bounds is set to the area of the file within the returned image.
+	Image* load(const std::string& filename, Rect& bounds, const std::string& errormessage, bool IfNotFoundExit);
+
+	bool contains(const std::string& filename) const {
+		return entries.find(filename) != entries.end();
+	}
+
+	// drops every page; images already handed out stay valid until they are unref'd
+	void clear();
+
+	// copies the packed images into their pages again, after the renderer lost what was drawn into them
+	void restore();
+
+	void getMemoryUsage(MemoryUsage& usage) const;
+};
+
+#endif // TEXTURE_ATLAS_H
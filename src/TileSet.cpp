@@ -30,23 +30,20 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "FileParser.h"
 #include "UtilsParsing.h"
 #include "Settings.h"
+#include "VisualQuality.h"
 
 #include <cstdio>
 
 TileSet::TileSet()
-	: sprites(NULL) {
+	: graphics(NULL) {
 	reset();
 }
 
 void TileSet::reset() {
 
-	if (sprites) {
-		delete sprites;
-		sprites = NULL;
-	}
-
-	for (unsigned i = 0; i < tiles.size(); i++) {
-		if (tiles[i].tile) delete tiles[i].tile;
+	if (graphics) {
+		graphics->unref();
+		graphics = NULL;
 	}
 
 	alpha_background = true;
@@ -56,28 +53,20 @@ void TileSet::reset() {
 
 	tiles.clear();
 	anim.clear();
+	frame_clock = 0;
 
 	max_size_x = 0;
 	max_size_y = 0;
 }
 
 void TileSet::loadGraphics(const std::string& filename) {
-	if (sprites) {
-		delete sprites;
-		sprites = NULL;
-	}
-
-	for (unsigned i = 0; i < tiles.size(); i++) {
-		if (tiles[i].tile) delete tiles[i].tile;
+	if (graphics) {
+		graphics->unref();
+		graphics = NULL;
 	}
 	tiles.clear();
 
-	Image *graphics = NULL;
 	graphics = render_device->loadImage(filename);
-	if (graphics) {
-		sprites = graphics->createSprite();
-		graphics->unref();
-	}
 }
 
 void TileSet::load(const std::string& filename) {
@@ -98,7 +87,7 @@ void TileSet::load(const std::string& filename) {
 				// @ATTR tile|int, int, int, int, int, int, int : Index, X, Y, Width, Height, X offset, Y offset|A single tile definition.
 
 				// Verify that we have graphics for tiles
-				if (!sprites) {
+				if (!graphics) {
 					std::cerr << "No graphics for tileset definition '" << filename << "', aborting." << std::endl;
 					mods->resetModConfig();
 					Exit(1);
@@ -109,16 +98,16 @@ void TileSet::load(const std::string& filename) {
 				if (index >= tiles.size())
 					tiles.resize(index + 1);
 
-				tiles[index].tile = sprites->getGraphics()->createSprite();
-
-				tiles[index].tile->setClipX(popFirstInt(infile.val));
-				tiles[index].tile->setClipY(popFirstInt(infile.val));
-				tiles[index].tile->setClipW(popFirstInt(infile.val));
-				tiles[index].tile->setClipH(popFirstInt(infile.val));
+				tiles[index].image = graphics;
+				tiles[index].src.x = popFirstInt(infile.val);
+				tiles[index].src.y = popFirstInt(infile.val);
+				tiles[index].src.w = popFirstInt(infile.val);
+				tiles[index].src.h = popFirstInt(infile.val);
 				tiles[index].offset.x = popFirstInt(infile.val);
 				tiles[index].offset.y = popFirstInt(infile.val);
-				max_size_x = std::max(max_size_x, (tiles[index].tile->getClip().w / TILE_W) + 1);
-				max_size_y = std::max(max_size_y, (tiles[index].tile->getClip().h / TILE_H) + 1);
+				const Point extent = getTileExtent(index);
+				max_size_x = std::max(max_size_x, extent.x);
+				max_size_y = std::max(max_size_y, extent.y);
 			}
 			else if (infile.key == "transparency") {
 				// @ATTR transparency|color|An RGB color to key out and treat as transparent.
@@ -146,9 +135,14 @@ void TileSet::load(const std::string& filename) {
 					anim[TILE_ID].pos[frame].y = popFirstInt(infile.val);
 					anim[TILE_ID].frame_duration[frame] = static_cast<unsigned short>(parse_duration(popFirstString(infile.val)));
 
+					anim[TILE_ID].total_duration += std::max<unsigned>(anim[TILE_ID].frame_duration[frame], 1);
+
 					frame++;
 					repeat_val = popFirstString(infile.val);
 				}
+
+				// make sure the first frame is applied when the tile is drawn
+				anim[TILE_ID].last_update = static_cast<unsigned>(-1);
 			}
 			else {
 				infile.error("TileSet: '%s' is not a valid key.", infile.key.c_str());
@@ -161,23 +155,62 @@ void TileSet::load(const std::string& filename) {
 }
 
 void TileSet::logic() {
-	for (unsigned i = 0; i < anim.size() ; i++) {
-		Tile_Anim &an = anim[i];
-		if (!an.frames)
-			continue;
-		if (an.duration >= an.frame_duration[an.current_frame]) {
-			tiles[i].tile->setClipX(an.pos[an.current_frame].x);
-			tiles[i].tile->setClipY(an.pos[an.current_frame].y);
-			an.duration = 0;
-			an.current_frame = static_cast<unsigned short>((an.current_frame + 1) % an.frames);
-		}
-		an.duration++;
+	frame_clock++;
+}
+
+void TileSet::updateAnimation(unsigned index) {
+	// under load, the frames change less often, so that cached map chunks are redrawn less often too
+	unsigned clock = frame_clock;
+	if (getVisualQuality() == VISUAL_QUALITY_REDUCED)
+		clock -= clock % TILE_ANIM_REDUCED_STEP;
+	else if (getVisualQuality() == VISUAL_QUALITY_LOW)
+		clock -= clock % TILE_ANIM_LOW_STEP;
+
+	Tile_Anim &an = anim[index];
+	if (an.last_update == clock)
+		return;
+
+	an.last_update = clock;
+
+	unsigned t = clock % an.total_duration;
+	unsigned short frame = 0;
+	while (frame < an.frames - 1) {
+		unsigned d = std::max<unsigned>(an.frame_duration[frame], 1);
+		if (t < d)
+			break;
+		t -= d;
+		frame++;
 	}
+
+	an.current_frame = frame;
+
+	if (index < tiles.size()) {
+		tiles[index].src.x = an.pos[frame].x;
+		tiles[index].src.y = an.pos[frame].y;
+	}
+}
+
+const Tile_Def& TileSet::getTile(unsigned index) {
+	if (index < anim.size() && anim[index].frames > 0)
+		updateAnimation(index);
+	return tiles[index];
+}
+
+Point TileSet::getTileExtent(unsigned index) const {
+	if (index >= tiles.size() || tiles[index].image == NULL)
+		return Point();
+
+	const Rect& src = tiles[index].src;
+	return Point((src.w / TILE_W) + 1, (src.h / TILE_H) + 1);
+}
+
+unsigned short TileSet::getAnimFrame(unsigned index) {
+	if (index >= anim.size() || anim[index].frames == 0)
+		return 0;
+	updateAnimation(index);
+	return anim[index].current_frame;
 }
 
 TileSet::~TileSet() {
-	if (sprites) delete sprites;
-	for (unsigned i = 0; i < tiles.size(); i++) {
-		if (tiles[i].tile) delete tiles[i].tile;
-	}
+	if (graphics) graphics->unref();
 }
@@ -30,33 +30,42 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Utils.h"
 
 /**
- * Describes a tile by its location \a src in the tileset sprite and
+ * Describes a tile by its location \a src in the tileset image and
  * by the \a offset to be applied when rendering it on screen.
  * The offset is measured from upper left corner to the logical midpoint
  * of the tile at groundlevel.
+ * Tiles are drawn straight from the image, so they don't need a Sprite each.
  */
 class Tile_Def {
 public:
+	Image *image; // the image of the tileset, NULL for undefined tiles
+	Rect src;
 	Point offset;
-	Sprite *tile;// inside graphics not used
 	Tile_Def()
-		: tile(NULL) {
+		: image(NULL) {
 	}
 };
 
+/**
+ * The current frame of a tile animation is derived from the tileset's frame
+ * clock. It is only brought up to date when the tile is about to be drawn, so
+ * tiles that aren't on screen cost nothing.
+ */
 class Tile_Anim {
 public:
 	// Number of frames in this animation. if 0 no animation.
 	// 1 makes no sense as it would produce astatic animation.
 	unsigned short frames;
 	unsigned short current_frame; // is in range 0..(frames-1)
-	unsigned short duration; // how long the current frame is already displayed in ticks.
+	unsigned total_duration; // the length of one full loop in ticks
+	unsigned last_update; // the frame clock value when current_frame was last computed
 	std::vector<Point> pos; // position of each image.
 	std::vector<unsigned short> frame_duration; // duration of each image in ticks. 0 will be treated the same as 1.
 	Tile_Anim() {
 		frames = 0;
 		current_frame = 0;
-		duration = 0;
+		total_duration = 0;
+		last_update = 0;
 	}
 };
 
@@ -64,6 +73,7 @@ class TileSet {
 private:
 	void loadGraphics(const std::string& filename);
 	void reset();
+	void updateAnimation(unsigned index);
 
 	Uint8 trans_r;
 	Uint8 trans_g;
@@ -71,6 +81,9 @@ private:
 	bool alpha_background;
 	std::string current_map;
 
+	// ticks since the tileset was loaded, drives all tile animations
+	unsigned frame_clock;
+
 public:
 	// functions
 	TileSet();
@@ -78,9 +91,18 @@ public:
 	void load(const std::string& filename);
 	void logic();
 
+	// returns the tile definition, with src set to the current animation frame
+	const Tile_Def& getTile(unsigned index);
+
+	// returns the current animation frame of a tile, 0 if it isn't animated
+	unsigned short getAnimFrame(unsigned index);
+
+	// oversize of a single tile, in number of tiles; (0, 0) for undefined tiles
+	Point getTileExtent(unsigned index) const;
+
 	std::vector<Tile_Def> tiles;
 	std::vector<Tile_Anim> anim;
-	Sprite *sprites;
+	Image *graphics;
 
 	// oversize of the largest tile available, in number of tiles.
 	int max_size_x;
@@ -24,6 +24,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 TooltipData::TooltipData()
 	: default_color(font->getColor("widget_normal"))
 	, tip_buffer(NULL)
+	, hash(2166136261UL)
 {}
 
 TooltipData::~TooltipData() {
@@ -31,7 +32,8 @@ TooltipData::~TooltipData() {
 }
 
 TooltipData::TooltipData(const TooltipData &tdSource)
-	: tip_buffer(NULL) {
+	: tip_buffer(NULL)
+	, hash(tdSource.hash) {
 
 	// DO NOT copy the buffered text render
 	// Allow the new copy to create its own buffer
@@ -62,6 +64,7 @@ TooltipData& TooltipData::operator= (const TooltipData &tdSource) {
 		lines.push_back(tdSource.lines[i]);
 		colors.push_back(tdSource.colors[i]);
 	}
+	hash = tdSource.hash;
 
 	return *this;
 }
@@ -69,6 +72,7 @@ TooltipData& TooltipData::operator= (const TooltipData &tdSource) {
 void TooltipData::clear() {
 	lines.clear();
 	colors.clear();
+	hash = 2166136261UL;
 	if (tip_buffer) {
 		delete tip_buffer;
 		tip_buffer = NULL;
@@ -76,6 +80,16 @@ void TooltipData::clear() {
 }
 
 void TooltipData::addColoredText(const std::string &text, const Color& color) {
+	addHash(color.r);
+	addHash(color.g);
+	addHash(color.b);
+	addHash(color.a);
+	for (size_t i=0; i<text.length(); i++) {
+		addHash(static_cast<unsigned char>(text[i]));
+	}
+	// separates this text from the color of the next call
+	addHash(0);
+
 	lines.push_back("");
 	colors.push_back(color);
 	for (unsigned int i=0; i<lines.size(); i++) {
@@ -112,7 +126,7 @@ bool TooltipData::compareFirstLine(const std::string &text) {
 }
 
 bool TooltipData::compare(const TooltipData *tip) {
-	if (lines.size() != tip->lines.size())
+	if (hash != tip->hash || lines.size() != tip->lines.size())
 		return false;
 
 	for (unsigned int i=0; i<lines.size(); i++) {
@@ -122,3 +136,7 @@ bool TooltipData::compare(const TooltipData *tip) {
 	return true;
 }
 
+void TooltipData::addHash(unsigned char c) {
+	hash ^= c;
+	hash = (hash * 16777619UL) & 0xffffffffUL;
+}
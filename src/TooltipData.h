@@ -46,6 +46,9 @@ public:
 	Color default_color;
 	Sprite *tip_buffer;
 
+	// FNV-1a hash of everything added since the last clear(); tooltips built from the same calls have the same hash
+	unsigned long hash;
+
 	TooltipData();
 	~TooltipData();
 
@@ -65,6 +68,9 @@ public:
 
 	// compare all lines
 	bool compare(const TooltipData *tip);
+
+private:
+	void addHash(unsigned char c);
 };
 
 #endif // TOOLTIPDATA_H
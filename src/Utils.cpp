@@ -20,6 +20,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 */
 
 #include "Avatar.h"
+#include "Logger.h"
 #include "Settings.h"
 #include "SharedResources.h"
 #include "Utils.h"
@@ -30,6 +31,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <stdarg.h>
 #include <ctype.h>
 #include <iomanip>
+#include <deque>
+#include <map>
 
 Point FPointToPoint(const FPoint& fp) {
 	Point result;
@@ -77,6 +80,77 @@ Point map_to_screen(float x, float y, float camx, float camy) {
 	return r;
 }
 
+ScreenTransform::ScreenTransform()
+	: cam()
+	, adjust_x(0)
+	, adjust_y(0)
+	, isometric(false)
+	, configured(false)
+	, tile_origin() {
+}
+
+void ScreenTransform::setCamera(const FPoint& _cam) {
+	cam = _cam;
+
+	// the same terms as in map_to_screen(), so that the results are identical
+	adjust_x = (VIEW_W_HALF + 0.5f) * UNITS_PER_PIXEL_X;
+	adjust_y = (VIEW_H_HALF + 0.5f) * UNITS_PER_PIXEL_Y;
+	isometric = (TILESET_ORIENTATION == TILESET_ISOMETRIC);
+	configured = true;
+
+	tile_origin = mapToScreen(0, 0);
+	if (isometric) {
+		tile_origin.y += TILE_H_HALF;
+	}
+	else {
+		tile_origin.x += TILE_W_HALF;
+		tile_origin.y += TILE_H_HALF;
+	}
+}
+
+bool ScreenTransform::isCurrent(const FPoint& _cam) const {
+	return configured && cam.x == _cam.x && cam.y == _cam.y
+		&& adjust_x == (VIEW_W_HALF + 0.5f) * UNITS_PER_PIXEL_X
+		&& adjust_y == (VIEW_H_HALF + 0.5f) * UNITS_PER_PIXEL_Y
+		&& isometric == (TILESET_ORIENTATION == TILESET_ISOMETRIC);
+}
+
+Point ScreenTransform::mapToScreen(float x, float y) const {
+	Point r;
+	if (isometric) {
+		r.x = int(floor(((x - cam.x - y + cam.y + adjust_x)/UNITS_PER_PIXEL_X)+0.5f));
+		r.y = int(floor(((x - cam.x + y - cam.y + adjust_y)/UNITS_PER_PIXEL_Y)+0.5f));
+	}
+	else {
+		r.x = int((x - cam.x + adjust_x)/UNITS_PER_PIXEL_X);
+		r.y = int((y - cam.y + adjust_y)/UNITS_PER_PIXEL_Y);
+	}
+	return r;
+}
+
+void ScreenTransform::mapToScreen(const float *x, const float *y, size_t count, int *out_x, int *out_y) const {
+	// the orientation is checked once, so that each loop is a plain pass over the arrays
+	if (isometric) {
+		for (size_t i = 0; i < count; ++i) {
+			out_x[i] = int(floor(((x[i] - cam.x - y[i] + cam.y + adjust_x)/UNITS_PER_PIXEL_X)+0.5f));
+			out_y[i] = int(floor(((x[i] - cam.x + y[i] - cam.y + adjust_y)/UNITS_PER_PIXEL_Y)+0.5f));
+		}
+	}
+	else {
+		for (size_t i = 0; i < count; ++i) {
+			out_x[i] = int((x[i] - cam.x + adjust_x)/UNITS_PER_PIXEL_X);
+			out_y[i] = int((y[i] - cam.y + adjust_y)/UNITS_PER_PIXEL_Y);
+		}
+	}
+}
+
+Point ScreenTransform::tileToScreen(int x, int y) const {
+	if (isometric)
+		return Point(tile_origin.x + (x - y) * TILE_W_HALF, tile_origin.y + (x + y) * TILE_H_HALF);
+	else
+		return Point(tile_origin.x + x * TILE_W, tile_origin.y + y * TILE_H);
+}
+
 FPoint collision_to_map(const Point& p) {
 	FPoint ret;
 	ret.x = static_cast<float>(p.x) + 0.5f;
@@ -139,6 +213,20 @@ float calcDist(const FPoint& p1, const FPoint& p2) {
 	return static_cast<float>(sqrt((p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y)));
 }
 
+/**
+ * The position to draw something that moved from prev_pos to pos during the last logic frame
+ * Jumps such as teleports are not smoothed
+ */
+FPoint calcInterpolatedPos(const FPoint& prev_pos, const FPoint& pos) {
+	if (FRAME_INTERPOLATION >= 1 || calcDist(prev_pos, pos) > INTERPOLATION_MAX_DISTANCE)
+		return pos;
+
+	FPoint p;
+	p.x = prev_pos.x + (pos.x - prev_pos.x) * FRAME_INTERPOLATION;
+	p.y = prev_pos.y + (pos.y - prev_pos.y) * FRAME_INTERPOLATION;
+	return p;
+}
+
 /**
  * is target within the area defined by center and radius?
  */
@@ -246,6 +334,12 @@ void alignFPoint(FPoint *pos) {
 }
 
 
+// created on first use, since messages can be logged during static initialization
+static Logger& getLogger() {
+	static Logger logger;
+	return logger;
+}
+
 /**
  * These functions provide a unified way to log messages, printf-style
  */
@@ -254,7 +348,7 @@ void logInfo(const char* format, ...) {
 
 	va_start(args, format);
 
-	SDL_LogMessageV(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, format, args);
+	getLogger().add(SDL_LOG_PRIORITY_INFO, format, args);
 
 	va_end(args);
 }
@@ -264,16 +358,27 @@ void logError(const char* format, ...) {
 
 	va_start(args, format);
 
-	SDL_LogMessageV(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_ERROR, format, args);
+	getLogger().add(SDL_LOG_PRIORITY_ERROR, format, args);
 
 	va_end(args);
 }
 
 void logErrorDialog(const char* dialog_text) {
+	// the messages that led to the error are written before the dialog waits for the user
+	stopLogging();
 	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "FLARE", dialog_text, NULL);
 }
 
+void startLogging() {
+	getLogger().start();
+}
+
+void stopLogging() {
+	getLogger().stop();
+}
+
 void Exit(int code) {
+	stopLogging();
 	SDL_Quit();
 	exit(code);
 }
@@ -453,3 +558,53 @@ int rotateDirection(int direction, int val) {
 
 	return direction;
 }
+
+/**
+ * A deque is used for storage so that references returned by getInternedString()
+ * stay valid as it grows. The startup loading threads intern strings too, so
+ * access is guarded by a spin lock.
+ */
+static SDL_SpinLock intern_lock = 0;
+
+static std::deque<std::string>& getInternTable() {
+	static std::deque<std::string> table(1, std::string());
+	return table;
+}
+
+static std::map<std::string, StringHandle>& getInternIndex() {
+	static std::map<std::string, StringHandle> index;
+	return index;
+}
+
+StringHandle internString(const std::string& s) {
+	if (s.empty())
+		return 0;
+
+	SDL_AtomicLock(&intern_lock);
+
+	StringHandle handle;
+	std::map<std::string, StringHandle>& index = getInternIndex();
+	std::map<std::string, StringHandle>::iterator it = index.find(s);
+	if (it != index.end()) {
+		handle = it->second;
+	}
+	else {
+		std::deque<std::string>& table = getInternTable();
+		handle = static_cast<StringHandle>(table.size());
+		table.push_back(s);
+		index[s] = handle;
+	}
+
+	SDL_AtomicUnlock(&intern_lock);
+	return handle;
+}
+
+const std::string& getInternedString(StringHandle handle) {
+	SDL_AtomicLock(&intern_lock);
+
+	std::deque<std::string>& table = getInternTable();
+	const std::string& s = (handle < table.size()) ? table[handle] : table[0];
+
+	SDL_AtomicUnlock(&intern_lock);
+	return s;
+}
@@ -32,8 +32,22 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <stdint.h>
 #include <string>
 
+class AnimationSet;
 class Avatar;
 
+// moving further than this many tiles in one logic frame is drawn as a jump instead of being smoothed
+const float INTERPOLATION_MAX_DISTANCE = 2;
+
+/**
+ * Interned strings are stored once and referred to by a small integer handle,
+ * so that frequently compared identifiers (animation names, effect ids, etc)
+ * can be compared without touching the string data. Handle 0 is the empty string.
+ */
+typedef unsigned StringHandle;
+
+StringHandle internString(const std::string& s);
+const std::string& getInternedString(StringHandle handle);
+
 class Point {
 public:
 	int x, y;
@@ -78,10 +92,10 @@ public:
 		c.a = a;
 		return c;
 	}
-	bool operator ==(const Color &other) {
+	bool operator ==(const Color &other) const {
 		return r == other.r && g == other.g && b == other.b && a == other.a;
 	}
-	bool operator !=(const Color &other) {
+	bool operator !=(const Color &other) const {
 		return !((*this) == other);
 	}
 };
@@ -151,13 +165,19 @@ typedef enum {
 	EC_NPC_PORTRAIT_THEM = 49,
 	EC_NPC_PORTRAIT_YOU = 50,
 	EC_QUEST_TEXT = 51,
-	EC_WAS_INSIDE_EVENT_AREA = 52
+	EC_WAS_INSIDE_EVENT_AREA = 52,
+	EC_COUNT = 53 // the number of component types
 }EVENT_COMPONENT_TYPE;
 
+/**
+ * Most components only use one or two of these fields, so the string is interned and
+ * only its handle is kept here. This keeps the components of large maps small enough
+ * to scan quickly. For the campaign status components, s is the status that is compared.
+ */
 class Event_Component {
 public:
 	EVENT_COMPONENT_TYPE type;
-	std::string s;
+	StringHandle s; // see getString() and setString()
 	int x;
 	int y;
 	int z;
@@ -167,7 +187,7 @@ public:
 
 	Event_Component()
 		: type(EC_NONE)
-		, s("")
+		, s(0)
 		, x(0)
 		, y(0)
 		, z(0)
@@ -175,6 +195,14 @@ public:
 		, b(0)
 		, c(0) {
 	}
+
+	const std::string& getString() const {
+		return getInternedString(s);
+	}
+
+	void setString(const std::string& _s) {
+		s = internString(_s);
+	}
 };
 
 class EffectDef {
@@ -192,6 +220,15 @@ public:
 	uint8_t alpha_mod;
 	std::string attack_speed_anim;
 
+	// filled in by EffectManager::resolveEffectDef(), so that adding the effect doesn't look up strings
+	bool resolved;
+	int effect_type;
+	StringHandle id_handle;
+	StringHandle attack_speed_anim_handle;
+
+	// the loaded set of animation, kept by PowerManager for as long as the definition exists
+	AnimationSet *animation_set;
+
 	EffectDef()
 		: id("")
 		, type("")
@@ -204,7 +241,12 @@ public:
 		, render_above(false)
 		, color_mod(255, 255, 255)
 		, alpha_mod(255)
-		, attack_speed_anim("") {
+		, attack_speed_anim("")
+		, resolved(false)
+		, effect_type(0)
+		, id_handle(0)
+		, attack_speed_anim_handle(0)
+		, animation_set(NULL) {
 	}
 };
 
@@ -213,8 +255,40 @@ FPoint screen_to_map(int x, int y, float camx, float camy);
 Point map_to_screen(float x, float y, float camx, float camy);
 Point map_to_collision(const FPoint& p);
 FPoint collision_to_map(const Point& p);
+
+/**
+ * map_to_screen() for a single camera position, with the constants that don't depend
+ * on the map position worked out once. Meant to be set up once per frame and reused
+ * for every tile and renderable drawn with that camera.
+ */
+class ScreenTransform {
+public:
+	ScreenTransform();
+	void setCamera(const FPoint& _cam);
+
+	// true if setCamera() was last called with this camera, and the view hasn't been resized since
+	bool isCurrent(const FPoint& _cam) const;
+
+	// same result as map_to_screen(x, y, cam.x, cam.y)
+	Point mapToScreen(float x, float y) const;
+
+	// transforms count positions at once
+	void mapToScreen(const float *x, const float *y, size_t count, int *out_x, int *out_y) const;
+
+	// the centered screen position of a tile, using integer steps from the tile at (0,0)
+	Point tileToScreen(int x, int y) const;
+
+private:
+	FPoint cam;
+	float adjust_x;
+	float adjust_y;
+	bool isometric;
+	bool configured;
+	Point tile_origin;
+};
 FPoint calcVector(const FPoint& pos, int direction, float dist);
 float calcDist(const FPoint& p1, const FPoint& p2);
+FPoint calcInterpolatedPos(const FPoint& prev_pos, const FPoint& pos);
 float calcTheta(float x1, float y1, float x2, float y2);
 unsigned char calcDirection(float x0, float y0, float x1, float y1);
 bool isWithinRadius(const FPoint& center, float radius, const FPoint& target);
@@ -227,6 +301,10 @@ void alignFPoint(FPoint *pos);
 void logInfo(const char* format, ...);
 void logError(const char* format, ...);
 void logErrorDialog(const char* dialog_text);
+
+// messages are written on a background thread between these; see Logger
+void startLogging();
+void stopLogging();
 void Exit(int code);
 
 void createSaveDir(int slot);
@@ -78,11 +78,64 @@ bool isDirectory(const std::string &path, bool show_error) {
 bool fileExists(const std::string &filename) {
 	if (isDirectory(filename, false)) return false;
 
-	std::ifstream infile(filename.c_str());
-	bool exists = infile.is_open();
-	if (exists) infile.close();
+	SDL_RWops *file = SDL_RWFromFile(filename.c_str(), "rb");
+	if (!file)
+		return false;
+
+	SDL_RWclose(file);
+	return true;
+}
+
+/**
+ * SDL_RWFromFile() reads from the APK assets on Android, and from regular files everywhere else.
+ * The whole file is read at once into a buffer of its size, so there is no per-line stream overhead.
+ */
+template <typename T>
+static bool readFileData(const std::string &filename, T &data) {
+	data.clear();
+
+	SDL_RWops *file = SDL_RWFromFile(filename.c_str(), "rb");
+	if (!file)
+		return false;
+
+	Sint64 size = SDL_RWsize(file);
+	bool success = size >= 0;
+	if (size > 0) {
+		data.resize(static_cast<size_t>(size));
+		size_t done = 0;
+		while (done < data.size()) {
+			size_t count = SDL_RWread(file, &data[done], 1, data.size() - done);
+			if (count == 0) {
+				success = false;
+				break;
+			}
+			done += count;
+		}
+	}
+	SDL_RWclose(file);
+
+	if (!success)
+		data.clear();
+	return success;
+}
+
+bool readFile(const std::string &filename, std::string &data) {
+	return readFileData(filename, data);
+}
 
-	return exists;
+bool readFile(const std::string &filename, std::vector<char> &data) {
+	return readFileData(filename, data);
+}
+
+/**
+ * Returns the last modification time of a file, or 0 if it can't be read
+ */
+time_t getFileModifiedTime(const std::string &filename) {
+	struct stat st;
+	if (stat(filename.c_str(), &st) == -1)
+		return 0;
+
+	return st.st_mtime;
 }
 
 /**
@@ -136,6 +189,52 @@ int getDirList(const std::string &dir, std::vector<std::string> &dirs) {
 	return 0;
 }
 
+/**
+ * Appends the paths of all files below dir, relative to dir and starting with prefix.
+ * Directories are searched recursively.
+ */
+void getFileTree(const std::string &dir, const std::string &prefix, std::vector<std::string> &files) {
+
+	DIR *dp;
+	struct dirent *dirp;
+
+	if((dp  = opendir(dir.c_str())) == NULL)
+		return;
+
+	std::vector<std::string> subdirs;
+
+	while ((dirp = readdir(dp)) != NULL) {
+		std::string name = std::string(dirp->d_name);
+		if (name == "." || name == "..")
+			continue;
+
+		bool is_dir;
+#ifdef _DIRENT_HAVE_D_TYPE
+		// saves a stat() per file where the type is known, which is most of them
+		if (dirp->d_type != DT_UNKNOWN && dirp->d_type != DT_LNK) {
+			is_dir = (dirp->d_type == DT_DIR);
+		}
+		else
+#endif
+		{
+			struct stat st;
+			if (stat((dir + "/" + name).c_str(), &st) == -1)
+				continue;
+			is_dir = S_ISDIR(st.st_mode);
+		}
+
+		if (is_dir)
+			subdirs.push_back(name);
+		else
+			files.push_back(prefix + name);
+	}
+	closedir(dp);
+
+	for (size_t i = 0; i < subdirs.size(); ++i) {
+		getFileTree(dir + "/" + subdirs[i], prefix + subdirs[i] + "/", files);
+	}
+}
+
 bool removeFile(const std::string &file) {
 	if (remove(file.c_str()) != 0) {
 		std::string error_msg = "removeFile (" + file + ")";
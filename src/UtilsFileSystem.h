@@ -27,12 +27,19 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "CommonIncludes.h"
 
+#include <ctime>
+
 bool dirExists(const std::string &path);
 bool pathExists(const std::string &path);
 void createDir(const std::string &path);
 bool fileExists(const std::string &filename);
+// reads a whole file through SDL_RWops, which also finds files packed into the Android APK
+bool readFile(const std::string &filename, std::string &data);
+bool readFile(const std::string &filename, std::vector<char> &data);
+time_t getFileModifiedTime(const std::string &filename);
 int getFileList(const std::string &dir, const std::string &ext, std::vector<std::string> &files);
 int getDirList(const std::string &dir, std::vector<std::string> &dirs);
+void getFileTree(const std::string &dir, const std::string &prefix, std::vector<std::string> &files);
 
 
 bool isDirectory(const std::string &path, bool show_error = true);
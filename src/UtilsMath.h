@@ -24,6 +24,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <cstdlib>
 #include <algorithm> // for std::min()/std::max()
 #include "math.h"
+#include "Random.h"
 
 #ifndef M_PI
 #define M_PI 3.1415926535898f
@@ -39,17 +40,17 @@ inline int signum(const int value) {
 /**
  * Returns random number between minVal and maxVal.
  */
-inline int randBetween(int minVal, int maxVal) {
+inline int randBetween(int minVal, int maxVal, RANDOM_STREAM stream = RANDOM_GENERAL) {
 	if (minVal == maxVal) return minVal;
 	int d = maxVal - minVal;
-	return minVal + (rand() % (d + signum(d)));
+	return minVal + randInt(abs(d) + 1, stream);
 }
 
 /**
  * Returns true with random percent chance.
  */
-inline bool percentChance(int percent) {
-	return rand() % 100 < percent;
+inline bool percentChance(int percent, RANDOM_STREAM stream = RANDOM_GENERAL) {
+	return randInt(100, stream) < percent;
 }
 
 #endif // UTILS_MATH_H
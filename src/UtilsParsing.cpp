@@ -21,10 +21,15 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "CommonIncludes.h"
 #include "UtilsParsing.h"
 #include "Settings.h"
+#include <cerrno>
+#include <climits>
 #include <cstdlib>
+#include <cstring>
 #include <typeinfo>
 #include <math.h>
 
+static const char* WHITESPACE = " \f\n\r\t\v";
+
 std::string trim(std::string s, const std::string& delimiters) {
 	return trim_left_inplace(trim_right_inplace(s, delimiters), delimiters);
 }
@@ -126,16 +131,36 @@ std::string parse_section_title(const std::string& s) {
 }
 
 void parse_key_pair(const std::string& s, std::string &key, std::string &val) {
-	size_t separator = s.find_first_of('=');
-	if (separator == std::string::npos) {
-		key = "";
-		val = "";
+	parse_key_pair(s.data(), s.data() + s.length(), key, val);
+}
+
+/**
+ * Same as above, but for a line that is still part of a larger buffer.
+ * key and val are assigned in place, so they can reuse their storage between lines.
+ */
+void parse_key_pair(const char* begin, const char* end, std::string &key, std::string &val) {
+	const char* separator = std::find(begin, end, '=');
+	if (separator == end) {
+		key.clear();
+		val.clear();
 		return; // not found
 	}
-	key = s.substr(0, separator);
-	val = s.substr(separator+1, s.length());
-	key = trim(key);
-	val = trim(val);
+	const char* key_end = separator;
+	const char* val_begin = separator+1;
+	trim_range(begin, key_end);
+	trim_range(val_begin, end);
+	key.assign(begin, key_end);
+	val.assign(val_begin, end);
+}
+
+/**
+ * Moves the bounds of a range of characters inwards, past any whitespace
+ */
+void trim_range(const char*& begin, const char*& end) {
+	while (begin < end && strchr(WHITESPACE, *begin))
+		++begin;
+	while (end > begin && strchr(WHITESPACE, *(end-1)))
+		--end;
 }
 
 /**
@@ -144,33 +169,43 @@ void parse_key_pair(const std::string& s, std::string &key, std::string &val) {
  *
  * This is basically a really lazy "split" replacement
  */
+static size_t findSeparator(const std::string &s, char separator) {
+	if (separator == 0) {
+		// return the first ',' or ';'
+		return s.find_first_of(",;");
+	}
+	return s.find_first_of(separator);
+}
+
 int popFirstInt(std::string &s, char separator) {
-	return toInt(popFirstString(s, separator));
+	size_t seppos = findSeparator(s, separator);
+
+	// parse the number in place instead of copying it out first
+	const char* begin = s.c_str();
+	char* end;
+	errno = 0;
+	long result = strtol(begin, &end, 10);
+	if (end == begin || (seppos != std::string::npos && end > begin + seppos) || errno == ERANGE || result > INT_MAX || result < INT_MIN)
+		result = 0;
+
+	if (seppos == std::string::npos)
+		s.clear();
+	else
+		s.erase(0, seppos+1);
+
+	return static_cast<int>(result);
 }
 
 std::string popFirstString(std::string &s, char separator) {
-	std::string outs = "";
-	size_t seppos;
-
-	if (separator == 0) {
-		seppos = s.find_first_of(',');
-		size_t alt_seppos = s.find_first_of(';');
-
-		if (alt_seppos != std::string::npos && alt_seppos < seppos) {
-			seppos = alt_seppos; // return the first ',' or ';'
-		}
-	}
-	else {
-		seppos = s.find_first_of(separator);
-	}
+	std::string outs;
+	size_t seppos = findSeparator(s, separator);
 
 	if (seppos == std::string::npos) {
-		outs = s;
-		s = "";
+		outs.swap(s);
 	}
 	else {
-		outs = s.substr(0, seppos);
-		s = s.substr(seppos+1, s.length());
+		outs.assign(s, 0, seppos);
+		s.erase(0, seppos+1);
 	}
 	return outs;
 }
@@ -197,7 +232,7 @@ std::string stripCarriageReturn(const std::string& line) {
 	return line;
 }
 
-std::string getLine(std::ifstream &infile) {
+std::string getLine(std::istream &infile) {
 	std::string line;
 	// This is the standard way to check whether a read failed.
 	if (!getline(infile, line))
@@ -289,23 +324,37 @@ std::string toString(const std::type_info & type, void * value) {
 }
 
 int toInt(const std::string& s, int default_value) {
-	int result;
-	if (!(std::stringstream(s) >> result))
-		result = default_value;
-	return result;
+	return toInt(s.c_str(), default_value);
+}
+
+int toInt(const char* s, int default_value) {
+	char* end;
+	errno = 0;
+	long result = strtol(s, &end, 10);
+	if (end == s || errno == ERANGE || result > INT_MAX || result < INT_MIN)
+		return default_value;
+	return static_cast<int>(result);
 }
 
 float toFloat(const std::string& s, float default_value) {
-	float result;
-	if (!(std::stringstream(s) >> result))
-		result = default_value;
-	return result;
+	return toFloat(s.c_str(), default_value);
+}
+
+float toFloat(const char* s, float default_value) {
+	char* end;
+	errno = 0;
+	double result = strtod(s, &end);
+	if (end == s || errno == ERANGE)
+		return default_value;
+	return static_cast<float>(result);
 }
 
 unsigned long toUnsignedLong(const std::string& s, unsigned long  default_value) {
-	unsigned long result;
-	if (!(std::stringstream(s) >> result))
-		result = default_value;
+	char* end;
+	errno = 0;
+	unsigned long result = strtoul(s.c_str(), &end, 10);
+	if (end == s.c_str() || errno == ERANGE)
+		return default_value;
 	return result;
 }
 
@@ -356,3 +405,50 @@ Color toRGBA(std::string value) {
 	c.a = static_cast<Uint8>(popFirstInt(value));
 	return c;
 }
+
+ParserKeyTable::ParserKeyTable(const char* const* _keys, int count)
+	: keys(_keys)
+	, mask(0) {
+	// keep the table at most a quarter full, so that probe sequences stay short
+	size_t size = 16;
+	while (size < static_cast<size_t>(count) * 4)
+		size *= 2;
+
+	slots.resize(size, 0);
+	mask = static_cast<unsigned>(size - 1);
+
+	for (int i = 0; i < count; ++i) {
+		if (get(keys[i]) != -1) {
+			logError("ParserKeyTable: Duplicate key '%s'", keys[i]);
+			continue;
+		}
+
+		unsigned slot = hash(keys[i], strlen(keys[i])) & mask;
+		while (slots[slot] != 0)
+			slot = (slot + 1) & mask;
+		slots[slot] = i + 1;
+	}
+}
+
+int ParserKeyTable::get(const std::string& key) const {
+	unsigned slot = hash(key.c_str(), key.size()) & mask;
+	while (slots[slot] != 0) {
+		const int index = slots[slot] - 1;
+		if (key == keys[index])
+			return index;
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+/**
+ * FNV-1a
+ */
+unsigned ParserKeyTable::hash(const char* s, size_t len) {
+	unsigned h = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		h ^= static_cast<unsigned char>(s[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
@@ -32,16 +32,20 @@ int parse_direction(const std::string& s);
 ALIGNMENT parse_alignment(const std::string& s);
 std::string parse_section_title(const std::string& s);
 void parse_key_pair(const std::string& s, std::string& key, std::string& val);
+void parse_key_pair(const char* begin, const char* end, std::string& key, std::string& val);
+void trim_range(const char*& begin, const char*& end);
 int popFirstInt(std::string& s, char separator = 0);
 std::string popFirstString(std::string& s, char separator = 0);
 std::string getNextToken(const std::string& s, size_t& cursor, char separator);
 std::string stripCarriageReturn(const std::string& line);
-std::string getLine(std::ifstream& infile);
+std::string getLine(std::istream& infile);
 bool tryParseValue(const std::type_info & type, const char * value, void * output);
 bool tryParseValue(const std::type_info & type, const std::string & value, void * output);
 std::string toString(const std::type_info & type, void * value);
 int toInt(const std::string& s, int default_value = 0);
+int toInt(const char* s, int default_value = 0);
 float toFloat(const std::string &s, float default_value = 0.0);
+float toFloat(const char* s, float default_value = 0.0);
 unsigned long toUnsignedLong(const std::string& s, unsigned long default_value = 0);
 bool toBool(std::string value);
 Point toPoint(std::string value);
@@ -49,4 +53,27 @@ Rect toRect(std::string value);
 Color toRGB(std::string value);
 Color toRGBA(std::string value);
 
+/**
+ * Maps the keys of a definition file to the ids that its loader switches on
+ *
+ * Loaders used to compare each key against all of their attribute names in turn.
+ * The table is built once, so that a lookup costs one hash and usually one string compare.
+ */
+class ParserKeyTable {
+public:
+	ParserKeyTable(const char* const* _keys, int count);
+
+	// the index of key in the list the table was built from, or -1 if it isn't in the list
+	int get(const std::string& key) const;
+
+private:
+	static unsigned hash(const char* s, size_t len);
+
+	const char* const* keys;
+
+	// open addressing, with key index + 1 in each used slot
+	std::vector<int> slots;
+	unsigned mask;
+};
+
 #endif
@@ -0,0 +1,68 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "Profiler.h"
+#include "Settings.h"
+#include "VisualQuality.h"
+
+#include <vector>
+
+static int visual_quality = VISUAL_QUALITY_FULL;
+static int fast_windows = 0;
+
+// frame times relative to the budget, since the last level check
+static std::vector<float> window;
+
+void updateVisualQuality(float frame_seconds, float target_seconds) {
+	if (!DYNAMIC_VISUAL_QUALITY || target_seconds <= 0) {
+		visual_quality = VISUAL_QUALITY_FULL;
+		fast_windows = 0;
+		window.clear();
+		return;
+	}
+
+	// very long frames are loading screens, not slow rendering
+	if (frame_seconds > target_seconds * 4)
+		return;
+
+	window.push_back(frame_seconds / target_seconds);
+	if (window.size() < VISUAL_QUALITY_WINDOW)
+		return;
+
+	// most of the frames have to be slow, not just a few
+	const float typical = calcPercentile(window, 75);
+	window.clear();
+
+	if (typical > VISUAL_QUALITY_SLOW) {
+		if (visual_quality < VISUAL_QUALITY_LOW)
+			visual_quality++;
+		fast_windows = 0;
+	}
+	else if (typical < VISUAL_QUALITY_FAST) {
+		if (visual_quality > VISUAL_QUALITY_FULL && ++fast_windows >= VISUAL_QUALITY_RECOVER) {
+			visual_quality--;
+			fast_windows = 0;
+		}
+	}
+	else {
+		fast_windows = 0;
+	}
+}
+
+int getVisualQuality() {
+	return visual_quality;
+}
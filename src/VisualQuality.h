@@ -0,0 +1,64 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * Visual quality
+ *
+ * While the dynamic_visual_quality setting is on, frames that take too long
+ * for a while lower the detail of the purely visual parts of the game: combat
+ * text, tile animations, overlapping hazard sprites and the effect animations
+ * of distant enemies. What is hit and what can be seen stays the same.
+ *
+ * The level is picked from the frame times of the last second, rather than
+ * from single frames, so that one slow frame doesn't change it. It only goes
+ * back up after several fast seconds in a row.
+ */
+
+#ifndef VISUAL_QUALITY_H
+#define VISUAL_QUALITY_H
+
+const int VISUAL_QUALITY_FULL = 0;
+const int VISUAL_QUALITY_REDUCED = 1;
+const int VISUAL_QUALITY_LOW = 2;
+
+// the number of frames the level is picked from
+const unsigned VISUAL_QUALITY_WINDOW = 60;
+
+// relative to the frame budget; the level goes down above VISUAL_QUALITY_SLOW and up below VISUAL_QUALITY_FAST
+const float VISUAL_QUALITY_SLOW = 1.1f;
+const float VISUAL_QUALITY_FAST = 0.7f;
+
+// the number of fast windows in a row before the level goes back up
+const int VISUAL_QUALITY_RECOVER = 5;
+
+// the newest combat text items that are drawn at each level
+const unsigned COMBAT_TEXT_REDUCED_MAX = 32;
+const unsigned COMBAT_TEXT_LOW_MAX = 12;
+
+// tile animations only change frame every this many frames
+const unsigned TILE_ANIM_REDUCED_STEP = 2;
+const unsigned TILE_ANIM_LOW_STEP = 4;
+
+// at VISUAL_QUALITY_LOW, enemies further than this from the hero are drawn without their effect animations
+const float VISUAL_QUALITY_EFFECT_DISTANCE = 8;
+
+// called once per drawn frame with the time it took, not counting the wait for the next one
+void updateVisualQuality(float frame_seconds, float target_seconds);
+
+int getVisualQuality();
+
+#endif // VISUAL_QUALITY_H
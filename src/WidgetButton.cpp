@@ -138,7 +138,7 @@ void WidgetButton::render() {
 			buttons->getClip().h
 		);
 		buttons->setDest(pos);
-		render_device->render(buttons);
+		render_device->submit(buttons);
 	}
 
 	// render label
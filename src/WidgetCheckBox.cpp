@@ -108,7 +108,7 @@ void WidgetCheckBox::render() {
 		cb->local_frame = local_frame;
 		cb->setOffset(local_offset);
 		cb->setDest(pos);
-		render_device->render(cb);
+		render_device->submit(cb);
 	}
 
 	if (in_focus) {
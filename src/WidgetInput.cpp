@@ -148,7 +148,7 @@ void WidgetInput::render() {
 		background->setOffset(local_offset);
 		background->setClip(src);
 		background->setDest(pos);
-		render_device->render(background);
+		render_device->submit(background);
 	}
 
 	font->setFont("font_regular");
@@ -86,7 +86,7 @@ void WidgetLabel::render() {
 	if (label) {
 		label->local_frame = local_frame;
 		label->setOffset(local_offset);
-		render_device->render(label);
+		render_device->submit(label);
 	}
 }
 
@@ -249,21 +249,10 @@ void WidgetLabel::recacheTextSprite() {
 	if (text.empty())
 		return;
 
-	std::string temp_text = text;
-
-	font->setFont(font_style);
-	bounds.w = font->calc_width(temp_text);
-	bounds.h = font->getFontHeight();
-
-	if (max_width > 0 && bounds.w > max_width) {
-		temp_text = font->trimTextToWidth(text, max_width, true);
-		bounds.w = font->calc_width(temp_text);
-	}
-
-	image = render_device->createImage(bounds.w, bounds.h);
+	// labels with the same text and style share one image
+	image = font->renderLabel(text, font_style, color, max_width, bounds.w, bounds.h);
 	if (!image) return;
 
-	font->renderShadowed(temp_text, 0, 0, JUSTIFY_LEFT, image, 0, color);
 	label = image->createSprite();
 	image->unref();
 
@@ -35,8 +35,8 @@ WidgetListBox::WidgetListBox(int height, const std::string& _fileName)
 	, cursor(0)
 	, has_scroll_bar(false)
 	, any_selected(false)
-	, vlabels(std::vector<WidgetLabel>(height,WidgetLabel()))
 	, rows(std::vector<Rect>(height,Rect()))
+	, row_labels(std::vector<WidgetLabel*>(height, static_cast<WidgetLabel*>(NULL)))
 	, tip(new WidgetTooltip())
 	, scrollbar(new WidgetScrollBar())
 	, color_normal(font->getColor("widget_normal"))
@@ -59,9 +59,45 @@ WidgetListBox::WidgetListBox(int height, const std::string& _fileName)
 		graphics->unref();
 	}
 
+	for (int i = 0; i < height + LISTBOX_LABEL_MARGIN * 2; ++i) {
+		labels.push_back(new WidgetLabel());
+		label_items.push_back(-1);
+	}
+
 	scroll_type = VERTICAL;
 }
 
+/**
+ * Returns the label showing the item, recycling a label outside of the visible area if there is none
+ */
+WidgetLabel* WidgetListBox::getLabel(int item_index) {
+	int unused = -1;
+
+	for (size_t i = 0; i < labels.size(); ++i) {
+		if (label_items[i] == item_index)
+			return labels[i];
+
+		if (label_items[i] == -1 || label_items[i] < cursor - LISTBOX_LABEL_MARGIN || label_items[i] >= cursor + static_cast<int>(rows.size()) + LISTBOX_LABEL_MARGIN)
+			unused = static_cast<int>(i);
+	}
+
+	// the margin keeps at least one label outside of the visible rows
+	if (unused == -1)
+		unused = 0;
+
+	label_items[unused] = item_index;
+	return labels[unused];
+}
+
+/**
+ * Forget which item each label shows, after items have been moved around
+ */
+void WidgetListBox::clearLabels() {
+	for (size_t i = 0; i < label_items.size(); ++i) {
+		label_items[i] = -1;
+	}
+}
+
 bool WidgetListBox::checkClick() {
 	return checkClick(inpt->mouse.x,inpt->mouse.y);
 }
@@ -207,6 +243,7 @@ void WidgetListBox::set(unsigned index, const std::string& value, const std::str
 
 	items[index].value = value;
 	items[index].tooltip = tooltip;
+	items[index].trimmed_width = -1;
 	refresh();
 }
 
@@ -215,6 +252,7 @@ void WidgetListBox::set(unsigned index, const std::string& value, const std::str
  */
 void WidgetListBox::remove(int index) {
 	items.erase(items.begin()+index);
+	clearLabels();
 	scrollUp();
 	refresh();
 }
@@ -224,6 +262,7 @@ void WidgetListBox::remove(int index) {
  */
 void WidgetListBox::clear() {
 	items.clear();
+	clearLabels();
 	refresh();
 }
 
@@ -243,6 +282,7 @@ void WidgetListBox::shiftUp() {
 			}
 		}
 		if (any_selected) {
+			clearLabels();
 			scrollUp();
 		}
 	}
@@ -264,6 +304,7 @@ void WidgetListBox::shiftDown() {
 			}
 		}
 		if (any_selected) {
+			clearLabels();
 			scrollDown();
 		}
 	}
@@ -345,13 +386,13 @@ void WidgetListBox::render() {
 		if (listboxs) {
 			listboxs->setClip(src);
 			listboxs->setDest(rows[i]);
-			render_device->render(listboxs);
+			render_device->submit(listboxs);
 		}
 
-		if (i<items.size()) {
-			vlabels[i].local_frame = local_frame;
-			vlabels[i].local_offset = local_offset;
-			vlabels[i].render();
+		if (i<items.size() && row_labels[i]) {
+			row_labels[i]->local_frame = local_frame;
+			row_labels[i]->local_offset = local_offset;
+			row_labels[i]->render();
 		}
 	}
 
@@ -428,18 +469,31 @@ void WidgetListBox::refresh() {
 
 		int padding = font->getFontHeight();
 
-		if (i+cursor < items.size()) {
+		if (i+cursor >= items.size()) {
+			row_labels[i] = NULL;
+			continue;
+		}
+
+		ListBoxItem &item = items[i+cursor];
+		int trim_width = disable_text_trim ? 0 : pos.w-right_margin-padding;
+
+		if (item.trimmed_width != trim_width) {
 			if (disable_text_trim)
-				temp = items[i+cursor].value;
+				item.trimmed_value = item.value;
 			else
-				temp = font->trimTextToWidth(items[i+cursor].value, pos.w-right_margin-padding, true);
+				item.trimmed_value = font->trimTextToWidth(item.value, trim_width, true);
+			item.trimmed_width = trim_width;
 		}
+		temp = item.trimmed_value;
+
+		// only re-renders the text if the label was showing a different item
+		row_labels[i] = getLabel(i+cursor);
 
-		if(i+cursor < items.size() && items[i+cursor].selected) {
-			vlabels[i].set(font_x, font_y, JUSTIFY_LEFT, VALIGN_CENTER, temp, color_normal);
+		if(item.selected) {
+			row_labels[i]->set(font_x, font_y, JUSTIFY_LEFT, VALIGN_CENTER, temp, color_normal);
 		}
-		else if (i < items.size()) {
-			vlabels[i].set(font_x, font_y, JUSTIFY_LEFT, VALIGN_CENTER, temp, color_disabled);
+		else {
+			row_labels[i]->set(font_x, font_y, JUSTIFY_LEFT, VALIGN_CENTER, temp, color_disabled);
 		}
 	}
 
@@ -509,11 +563,34 @@ bool WidgetListBox::isSelected(int index) {
 	return items[index].selected;
 }
 
+/**
+ * Sorts a list of indices, so that the labels can follow their items to the new positions
+ */
 void WidgetListBox::sort() {
-	std::sort(items.begin(), items.end());
+	std::vector<std::pair<std::string, int> > order;
+	for (size_t i = 0; i < items.size(); ++i) {
+		order.push_back(std::pair<std::string, int>(items[i].value, static_cast<int>(i)));
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<ListBoxItem> sorted_items(items.size());
+	std::vector<int> new_index(items.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		sorted_items[i] = items[order[i].second];
+		new_index[order[i].second] = static_cast<int>(i);
+	}
+	items.swap(sorted_items);
+
+	for (size_t i = 0; i < label_items.size(); ++i) {
+		if (label_items[i] >= 0 && label_items[i] < static_cast<int>(new_index.size()))
+			label_items[i] = new_index[label_items[i]];
+	}
 }
 
 WidgetListBox::~WidgetListBox() {
+	for (size_t i = 0; i < labels.size(); ++i) {
+		delete labels[i];
+	}
 	if (listboxs) delete listboxs;
 	if (tip) delete tip;
 	if (scrollbar) delete scrollbar;
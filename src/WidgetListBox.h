@@ -33,10 +33,14 @@ class WidgetLabel;
 class WidgetScrollBar;
 class WidgetTooltip;
 
+// labels are kept for this many rows above and below the visible ones
+const int LISTBOX_LABEL_MARGIN = 4;
+
 class ListBoxItem {
 public:
 	ListBoxItem()
 		: selected(false)
+		, trimmed_width(-1)
 	{}
 	~ListBoxItem() {}
 	bool operator< (const ListBoxItem& other) const {
@@ -45,6 +49,10 @@ public:
 	std::string value;
 	std::string tooltip;
 	bool selected;
+
+	// value trimmed to fit the row, cached for trimmed_width; -1 if it needs to be trimmed again
+	std::string trimmed_value;
+	int trimmed_width;
 };
 
 class WidgetListBox : public Widget {
@@ -58,8 +66,16 @@ private:
 	bool has_scroll_bar;
 	bool any_selected;
 	std::vector<ListBoxItem> items;
-	std::vector<WidgetLabel> vlabels;
 	std::vector<Rect> rows;
+
+	// Only the visible rows, plus a margin around them, have a label.
+	// Each label remembers the item it shows, so scrolling only renders the text of new rows.
+	std::vector<WidgetLabel*> labels;
+	std::vector<int> label_items;
+	std::vector<WidgetLabel*> row_labels;
+
+	WidgetLabel* getLabel(int item_index);
+	void clearLabels();
 	WidgetTooltip *tip;
 	WidgetScrollBar *scrollbar;
 	Color color_normal;
@@ -29,16 +29,21 @@ WidgetLog::WidgetLog (int width, int height)
 	: scroll_box(new WidgetScrollBox(width, height))
 	, padding(4)
 	, max_messages(WIDGETLOG_MAX_MESSAGES)
+	, separator(NULL)
+	, separator_width(0)
 	, updated(false)
 {
 	setFont(WIDGETLOG_FONT_REGULAR);
 	color_normal = font->getColor("menu_normal");
 	color_disabled = font->getColor("widget_disabled");
+	scroll_box->setRenderer(renderTile, this);
 }
 
 WidgetLog::~WidgetLog () {
 	delete scroll_box;
 	clear();
+	if (separator)
+		separator->unref();
 }
 
 void WidgetLog::setBasePos(int x, int y, ALIGNMENT a) {
@@ -79,80 +84,141 @@ void WidgetLog::setPosition(int x, int y) {
 	scroll_box->pos.y = y;
 }
 
+/**
+ * Renders the wrapped text of a message into its own image, if it isn't already for this width
+ */
+void WidgetLog::cacheMessage(WidgetLogMessage& message, int content_width) {
+	if (message.cache_width == content_width)
+		return;
+
+	if (message.cache) {
+		message.cache->unref();
+		message.cache = NULL;
+	}
+
+	setFont(message.style);
+	message.cache_size = font->calc_size(message.text, content_width);
+	message.cache_width = content_width;
+	message.spacing = paragraph_spacing;
+
+	if (message.cache_size.x > 0 && message.cache_size.y > 0) {
+		message.cache = render_device->createImage(message.cache_size.x, message.cache_size.y);
+		if (message.cache)
+			font->renderShadowed(message.text, 0, 0, JUSTIFY_LEFT, message.cache, content_width, message.color);
+	}
+}
+
+void WidgetLog::freeMessage(WidgetLogMessage& message) {
+	if (message.cache) {
+		message.cache->unref();
+		message.cache = NULL;
+	}
+}
+
+/**
+ * Only new messages are rendered through the font engine. The scroll box copies them from their cache
+ * into its tiles as they come into view.
+ */
 void WidgetLog::refresh() {
-	int y,y2;
-	y = y2 = padding;
+	int y = padding;
 
 	int content_width = scroll_box->pos.w-(padding*2);
 
-	// Resize the scrollbox content area first
-	for (size_t i=0; i<messages.size(); i++) {
-		setFont(styles[i]);
-		Point size = font->calc_size(messages[i], content_width);
-		y += size.y+paragraph_spacing;
+	message_y.resize(messages.size());
+	for (size_t i = messages.size(); i > 0; i--) {
+		WidgetLogMessage &message = messages[i-1];
+
+		cacheMessage(message, content_width);
+		message_y[i-1] = y;
+		y += message.cache_size.y+message.spacing;
 
-		if (separators[i])
-			y += paragraph_spacing+1;
+		if (message.separator)
+			y += message.spacing;
 	}
 	y+=(padding*2);
+
+	if (separator_width != content_width) {
+		if (separator)
+			separator->unref();
+		separator = (content_width > 0 ? render_device->createImage(content_width, 1) : NULL);
+		if (separator)
+			separator->fillWithColor(color_disabled);
+		separator_width = content_width;
+	}
+
 	scroll_box->resize(scroll_box->pos.w, y);
+}
 
-	// Render messages into the scrollbox area
-	for (size_t i = messages.size(); i > 0; i--) {
-		setFont(styles[i-1]);
-		Point size = font->calc_size(messages[i-1], content_width);
-		Image* render_target = scroll_box->contents->getGraphics();
+void WidgetLog::renderTile(void *data, Image *target, int y) {
+	WidgetLog *log = static_cast<WidgetLog*>(data);
+	int bottom = y + target->getHeight();
+
+	for (size_t i = 0; i < log->messages.size() && i < log->message_y.size(); ++i) {
+		WidgetLogMessage &message = log->messages[i];
+		int top = log->message_y[i];
+		int text_top = top + (message.separator ? message.spacing : 0);
+
+		if (top >= bottom || text_top + message.cache_size.y < y)
+			continue;
 
-		if (!separators.empty() && separators[i-1]) {
-			for (int j=padding; j<padding+content_width; ++j) {
-				render_target->drawPixel(j, y2, color_disabled);
-			}
+		if (message.separator && log->separator) {
+			Rect src;
+			src.w = log->separator_width;
+			src.h = 1;
 
-			y2 += paragraph_spacing;
+			Rect dest;
+			dest.x = log->padding;
+			dest.y = top - y;
+
+			render_device->renderToImage(log->separator, src, target, dest);
 		}
-		font->renderShadowed(messages[i-1], padding, y2, JUSTIFY_LEFT, render_target, content_width, colors[i-1]);
-		y2 += size.y+paragraph_spacing;
 
+		if (message.cache) {
+			Rect src;
+			src.w = message.cache_size.x;
+			src.h = message.cache_size.y;
+
+			Rect dest;
+			dest.x = log->padding;
+			dest.y = text_top - y;
+			dest.w = src.w;
+			dest.h = src.h;
+
+			render_device->renderToImage(message.cache, src, target, dest);
+		}
 	}
 }
 
 void WidgetLog::add(const std::string &s, bool prevent_spam, Color* color, int style) {
 	// First, make sure we're not repeating the last log message, to avoid spam
-	if (messages.empty() || messages.back() != s || !prevent_spam) {
+	if (messages.empty() || messages.back().text != s || !prevent_spam) {
 		// If we have too many messages, remove the oldest ones
 		while (messages.size() >= max_messages) {
 			remove(0);
 		}
 
 		// Add the new message.
-		messages.push_back(s);
-		if (color == NULL) {
-			colors.push_back(color_normal);
-		}
-		else {
-			colors.push_back(*color);
-		}
-		styles.push_back(style);
-		separators.resize(messages.size(), false);
+		messages.push_back(WidgetLogMessage());
+		messages.back().text = s;
+		messages.back().color = (color == NULL) ? color_normal : *color;
+		messages.back().style = style;
 		updated = true;
 	}
 }
 
 void WidgetLog::remove(unsigned msg_index) {
 	if (msg_index < messages.size()) {
+		freeMessage(messages[msg_index]);
 		messages.erase(messages.begin()+msg_index);
-		colors.erase(colors.begin()+msg_index);
-		styles.erase(styles.begin()+msg_index);
-		separators.erase(separators.begin()+msg_index);
 		updated = true;
 	}
 }
 
 void WidgetLog::clear() {
+	for (size_t i = 0; i < messages.size(); ++i) {
+		freeMessage(messages[i]);
+	}
 	messages.clear();
-	colors.clear();
-	styles.clear();
-	separators.clear();
 	updated = true;
 }
 
@@ -166,6 +232,6 @@ void WidgetLog::setMaxMessages(unsigned count) {
 void WidgetLog::addSeparator() {
 	if (messages.empty()) return;
 
-	separators.back() = true;
+	messages.back().separator = true;
 	updated = true;
 }
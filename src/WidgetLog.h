@@ -24,6 +24,8 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 #include "CommonIncludes.h"
 
+#include <deque>
+
 const unsigned WIDGETLOG_MAX_MESSAGES = 50;
 
 enum {
@@ -31,13 +33,40 @@ enum {
 	WIDGETLOG_FONT_BOLD = 1
 };
 
+class Image;
 class Widget;
 class WidgetScrollBox;
 
+class WidgetLogMessage {
+public:
+	std::string text;
+	Color color;
+	int style;
+	bool separator;
+
+	// the wrapped text, rendered once for cache_width
+	Image *cache;
+	Point cache_size;
+	int cache_width;
+	int spacing; // paragraph spacing of the message's font
+
+	WidgetLogMessage()
+		: style(WIDGETLOG_FONT_REGULAR)
+		, separator(false)
+		, cache(NULL)
+		, cache_width(-1)
+		, spacing(0) {
+	}
+};
+
 class WidgetLog : public Widget {
 private:
+	static void renderTile(void *data, Image *target, int y);
+
 	void refresh();
 	void setFont(int style);
+	void cacheMessage(WidgetLogMessage& message, int content_width);
+	void freeMessage(WidgetLogMessage& message);
 
 	WidgetScrollBox *scroll_box;
 	int line_height;
@@ -47,10 +76,14 @@ private:
 	Color color_normal;
 	Color color_disabled;
 
-	std::vector<std::string> messages;
-	std::vector<Color> colors;
-	std::vector<int> styles;
-	std::vector<bool> separators;
+	// oldest first; the oldest messages are dropped once max_messages is reached
+	std::deque<WidgetLogMessage> messages;
+
+	// where each message starts in the scroll box, from the top; the newest message is at the top
+	std::vector<int> message_y;
+
+	Image *separator;
+	int separator_width;
 
 	bool updated;
 
@@ -153,15 +153,15 @@ void WidgetScrollBar::render() {
 		scrollbars->setOffset(local_offset);
 		scrollbars->setClip(src_up);
 		scrollbars->setDest(pos_up);
-		render_device->render(scrollbars);
+		render_device->submit(scrollbars);
 
 		scrollbars->setClip(src_down);
 		scrollbars->setDest(pos_down);
-		render_device->render(scrollbars);
+		render_device->submit(scrollbars);
 
 		scrollbars->setClip(src_knob);
 		scrollbars->setDest(pos_knob);
-		render_device->render(scrollbars);
+		render_device->submit(scrollbars);
 	}
 }
 
@@ -26,7 +26,9 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "WidgetScrollBox.h"
 
 WidgetScrollBox::WidgetScrollBox(int width, int height)
-	: contents(NULL) {
+	: content_height(height)
+	, renderer(NULL)
+	, renderer_data(NULL) {
 	pos.x = pos.y = 0;
 	pos.w = width;
 	pos.h = height;
@@ -46,16 +48,15 @@ WidgetScrollBox::WidgetScrollBox(int width, int height)
 }
 
 WidgetScrollBox::~WidgetScrollBox() {
-	if (contents) delete contents;
+	clearTiles();
 	delete scrollbar;
 }
 
 void WidgetScrollBox::setPos(int offset_x, int offset_y) {
 	Widget::setPos(offset_x, offset_y);
 
-	if (contents && scrollbar) {
-		scrollbar->refresh(pos.x+pos.w, pos.y, pos.h-scrollbar->pos_down.h, cursor,
-						   contents->getGraphicsHeight()-pos.h);
+	if (scrollbar) {
+		scrollbar->refresh(pos.x+pos.w, pos.y, pos.h-scrollbar->pos_down.h, cursor, content_height-pos.h);
 	}
 }
 
@@ -79,8 +80,8 @@ void WidgetScrollBox::scroll(int amount) {
 	if (cursor < 0) {
 		cursor = 0;
 	}
-	else if (contents && cursor > contents->getGraphicsHeight() - pos.h) {
-		cursor = contents->getGraphicsHeight() - pos.h;
+	else if (cursor > content_height - pos.h) {
+		cursor = std::max(content_height - pos.h, 0);
 	}
 	refresh();
 }
@@ -90,8 +91,8 @@ void WidgetScrollBox::scrollTo(int amount) {
 	if (cursor < 0) {
 		cursor = 0;
 	}
-	else if (contents && cursor > contents->getGraphicsHeight() - pos.h) {
-		cursor = contents->getGraphicsHeight() - pos.h;
+	else if (cursor > content_height - pos.h) {
+		cursor = std::max(content_height - pos.h, 0);
 	}
 	refresh();
 }
@@ -135,7 +136,7 @@ void WidgetScrollBox::logic(int x, int y) {
 	}
 
 	// check ScrollBar clicks
-	if (contents && contents->getGraphicsHeight() > pos.h && scrollbar) {
+	if (content_height > pos.h && scrollbar) {
 		switch (scrollbar->checkClick(mouse.x,mouse.y)) {
 			case 1:
 				scrollUp();
@@ -157,71 +158,122 @@ void WidgetScrollBox::resize(int w, int h) {
 	pos.w = w;
 
 	if (pos.h > h) h = pos.h;
+	content_height = h;
 
-	if (contents) {
-		delete contents;
-		contents = NULL;
-	}
+	cursor = 0;
+	update = true;
+	refresh();
+}
 
-	Image *graphics;
-	graphics = render_device->createImage(pos.w,h);
-	if (graphics) {
-		contents = graphics->createSprite();
-		graphics->unref();
-	}
+void WidgetScrollBox::refresh() {
+	if (update)
+		clearTiles();
 
-	if (contents && !transparent) {
-		contents->getGraphics()->fillWithColor(bg);
+	if (scrollbar) {
+		scrollbar->refresh(pos.x+pos.w, pos.y, pos.h-scrollbar->pos_down.h, cursor, content_height-pos.h);
 	}
+}
 
-	cursor = 0;
-	refresh();
+void WidgetScrollBox::setRenderer(ScrollBoxRenderer _renderer, void *data) {
+	renderer = _renderer;
+	renderer_data = data;
+	update = true;
 }
 
-void WidgetScrollBox::refresh() {
-	if (update) {
-		int h = pos.h;
-		if (contents) {
-			h = contents->getGraphicsHeight();
-		}
+void WidgetScrollBox::clearTiles() {
+	for (size_t i = 0; i < tiles.size(); ++i) {
+		delete tiles[i].sprite;
+	}
+	tiles.clear();
+}
 
-		if (contents) {
-			delete contents;
-			contents = NULL;
+/**
+ * Drops the tiles that scrolled out of range, and draws the ones that scrolled into it
+ */
+void WidgetScrollBox::updateTiles() {
+	if (update)
+		clearTiles();
+
+	// without a renderer or a background, there is nothing to draw
+	if (transparent && !renderer)
+		return;
+
+	int first = std::max(cursor / SCROLLBOX_TILE_HEIGHT - SCROLLBOX_TILE_MARGIN, 0);
+	int last = std::min((cursor + pos.h - 1) / SCROLLBOX_TILE_HEIGHT + SCROLLBOX_TILE_MARGIN, (content_height - 1) / SCROLLBOX_TILE_HEIGHT);
+
+	size_t i = 0;
+	while (i < tiles.size()) {
+		if (tiles[i].index < first || tiles[i].index > last) {
+			delete tiles[i].sprite;
+			tiles[i] = tiles.back();
+			tiles.pop_back();
 		}
-
-		Image *graphics;
-		graphics = render_device->createImage(pos.w,h);
-		if (graphics) {
-			contents = graphics->createSprite();
-			graphics->unref();
+		else {
+			++i;
 		}
+	}
 
-		if (contents && !transparent) {
-			contents->getGraphics()->fillWithColor(bg);
+	for (int index = first; index <= last; ++index) {
+		bool found = false;
+		for (i = 0; i < tiles.size(); ++i) {
+			if (tiles[i].index == index) {
+				found = true;
+				break;
+			}
 		}
+		if (!found)
+			createTile(index);
 	}
+}
 
-	if (contents && scrollbar) {
-		scrollbar->refresh(pos.x+pos.w, pos.y, pos.h-scrollbar->pos_down.h, cursor,
-						   contents->getGraphicsHeight()-pos.h);
-	}
+void WidgetScrollBox::createTile(int index) {
+	int top = index * SCROLLBOX_TILE_HEIGHT;
+	int h = std::min(SCROLLBOX_TILE_HEIGHT, content_height - top);
+	if (pos.w <= 0 || h <= 0)
+		return;
+
+	Image *graphics = render_device->createImage(pos.w, h);
+	if (!graphics)
+		return;
+
+	if (!transparent)
+		graphics->fillWithColor(bg);
+	if (renderer)
+		renderer(renderer_data, graphics, top);
+
+	WidgetScrollBoxTile tile;
+	tile.index = index;
+	tile.sprite = graphics->createSprite();
+	graphics->unref();
+	tiles.push_back(tile);
 }
 
 void WidgetScrollBox::render() {
-	Rect src,dest;
-	dest = pos;
-	src.x = 0;
-	src.y = cursor;
-	src.w = pos.w;
-	src.h = pos.h;
-
-	if (contents) {
-		contents->local_frame = local_frame;
-		contents->setOffset(local_offset);
-		contents->setClip(src);
-		contents->setDest(dest);
-		render_device->render(contents);
+	updateTiles();
+
+	for (size_t i = 0; i < tiles.size(); ++i) {
+		Sprite *sprite = tiles[i].sprite;
+		int top = tiles[i].index * SCROLLBOX_TILE_HEIGHT;
+		int y1 = std::max(top, cursor);
+		int y2 = std::min(top + sprite->getGraphicsHeight(), cursor + pos.h);
+		if (y1 >= y2)
+			continue;
+
+		Rect src, dest;
+		src.x = 0;
+		src.y = y1 - top;
+		src.w = pos.w;
+		src.h = y2 - y1;
+		dest.x = pos.x;
+		dest.y = pos.y + y1 - cursor;
+		dest.w = src.w;
+		dest.h = src.h;
+
+		sprite->local_frame = local_frame;
+		sprite->setOffset(local_offset);
+		sprite->setClip(src);
+		sprite->setDest(dest);
+		render_device->submit(sprite);
 	}
 
 	for (unsigned i = 0; i < children.size(); i++) {
@@ -230,7 +282,7 @@ void WidgetScrollBox::render() {
 		children[i]->render();
 	}
 
-	if (contents && contents->getGraphicsHeight() > pos.h && scrollbar) {
+	if (content_height > pos.h && scrollbar) {
 		scrollbar->local_frame = local_frame;
 		scrollbar->local_offset = local_offset;
 		scrollbar->render();
@@ -241,10 +293,10 @@ void WidgetScrollBox::render() {
 		Point topLeft;
 		Point bottomRight;
 
-		topLeft.x = dest.x + local_frame.x - local_offset.x;
-		topLeft.y = dest.y + local_frame.y - local_offset.y;
-		bottomRight.x = topLeft.x + dest.w;
-		bottomRight.y = topLeft.y + dest.h;
+		topLeft.x = pos.x + local_frame.x - local_offset.x;
+		topLeft.y = pos.y + local_frame.y - local_offset.y;
+		bottomRight.x = topLeft.x + pos.w;
+		bottomRight.y = topLeft.y + pos.h;
 		Color color = Color(255,248,220,255);
 
 		// Only draw rectangle if it fits in local frame
@@ -19,6 +19,11 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 /**
  * class WidgetScrollBox
+ *
+ * The content is drawn into tiles of SCROLLBOX_TILE_HEIGHT, which only exist for
+ * the visible part and a margin around it. Tiles are drawn when they scroll into
+ * view, by the renderer given to setRenderer(), so the texture memory doesn't grow
+ * with the height of the content. Setting update redraws them.
  */
 
 #ifndef WIDGET_SCROLLBOX_H
@@ -28,8 +33,23 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "Widget.h"
 #include "WidgetScrollBar.h"
 
+class Image;
 class Widget;
 
+const int SCROLLBOX_TILE_HEIGHT = 128;
+
+// the number of tiles kept above and below the visible ones
+const int SCROLLBOX_TILE_MARGIN = 1;
+
+// draws the content from y down into target, a tile as wide as the scroll box
+typedef void (*ScrollBoxRenderer)(void *data, Image *target, int y);
+
+class WidgetScrollBoxTile {
+public:
+	int index;
+	Sprite *sprite;
+};
+
 class WidgetScrollBox : public Widget {
 public:
 	WidgetScrollBox (int width, int height);
@@ -44,7 +64,12 @@ public:
 	void refresh();
 	void render();
 
-	Sprite *contents;
+	// data is passed along to _renderer, and must outlive the scroll box
+	void setRenderer(ScrollBoxRenderer _renderer, void *data);
+	int getContentHeight() {
+		return content_height;
+	}
+
 	bool update;
 	Color bg;
 	bool transparent;
@@ -63,6 +88,15 @@ private:
 	void scrollTo(int amount);
 	void scrollDown();
 	void scrollUp();
+	void clearTiles();
+	void updateTiles();
+	void createTile(int index);
+
+	std::vector<WidgetScrollBoxTile> tiles;
+	int content_height;
+	ScrollBoxRenderer renderer;
+	void *renderer_data;
+
 	std::vector<Widget*> children;
 	int currentChild;
 
@@ -164,10 +164,10 @@ void WidgetSlider::render () {
 		sl->setOffset(local_offset);
 		sl->setClip(base);
 		sl->setDest(pos);
-		render_device->render(sl);
+		render_device->submit(sl);
 		sl->setClip(knob);
 		sl->setDest(pos_knob);
-		render_device->render(sl);
+		render_device->submit(sl);
 	}
 
 	if (in_focus) {
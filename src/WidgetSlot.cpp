@@ -162,6 +162,10 @@ void WidgetSlot::setIcon(int _icon_id) {
 }
 
 void WidgetSlot::setAmount(int _amount, int _max_amount) {
+	// storage menus set this for every slot each frame, so the text is only rebuilt when it changes
+	if (amount == _amount && max_amount == _max_amount && !amount_str.empty())
+		return;
+
 	amount = _amount;
 	max_amount = _max_amount;
 
@@ -176,9 +180,7 @@ void WidgetSlot::render() {
 		icons->render();
 
 		if (amount > 1 || max_amount > 1) {
-			std::stringstream ss;
-			ss << amount_str;
-			label_amount.set(pos.x + icons->text_offset.x, pos.y + icons->text_offset.y, JUSTIFY_LEFT, VALIGN_TOP, ss.str(), font->getColor("widget_normal"));
+			label_amount.set(pos.x + icons->text_offset.x, pos.y + icons->text_offset.y, JUSTIFY_LEFT, VALIGN_TOP, amount_str, font->getColor("widget_normal"));
 			label_amount.local_frame = local_frame;
 			label_amount.local_offset = local_offset;
 			label_amount.render();
@@ -196,13 +198,13 @@ void WidgetSlot::renderSelection() {
 			slot_checked->local_frame = local_frame;
 			slot_checked->setOffset(local_offset);
 			slot_checked->setDest(pos);
-			render_device->render(slot_checked);
+			render_device->submit(slot_checked);
 		}
 		else if (slot_selected) {
 			slot_selected->local_frame = local_frame;
 			slot_selected->setOffset(local_offset);
 			slot_selected->setDest(pos);
-			render_device->render(slot_selected);
+			render_device->submit(slot_selected);
 		}
 	}
 }
@@ -221,12 +221,12 @@ void WidgetTabControl::renderTab(unsigned number) {
 	if (i == active_tab) {
 		active_tab_surface->setClip(src);
 		active_tab_surface->setDest(dest);
-		render_device->render(active_tab_surface);
+		render_device->submit(active_tab_surface);
 	}
 	else {
 		inactive_tab_surface->setClip(src);
 		inactive_tab_surface->setDest(dest);
-		render_device->render(inactive_tab_surface);
+		render_device->submit(inactive_tab_surface);
 	}
 
 	// Draw tab’s right edge.
@@ -237,12 +237,12 @@ void WidgetTabControl::renderTab(unsigned number) {
 	if (i == active_tab) {
 		active_tab_surface->setClip(src);
 		active_tab_surface->setDest(dest);
-		render_device->render(active_tab_surface);
+		render_device->submit(active_tab_surface);
 	}
 	else {
 		inactive_tab_surface->setClip(src);
 		inactive_tab_surface->setDest(dest);
-		render_device->render(inactive_tab_surface);
+		render_device->submit(inactive_tab_surface);
 	}
 
 	// Render labels
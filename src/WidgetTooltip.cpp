@@ -29,13 +29,18 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 
 int TOOLTIP_CONTEXT = TOOLTIP_NONE;
 
-WidgetTooltip::WidgetTooltip() {
+WidgetTooltip::WidgetTooltip()
+	: buffer_ticks(0) {
 	background = render_device->loadImage("images/menus/tooltips.png", "", false);
 }
 
 WidgetTooltip::~WidgetTooltip() {
 	if (background)
 		background->unref();
+
+	for (size_t i=0; i<buffers.size(); i++) {
+		buffers[i].graphics->unref();
+	}
 }
 
 /**
@@ -93,8 +98,9 @@ Point WidgetTooltip::calcPosition(STYLE style, const Point& pos, const Point& si
  * Draw the buffered tooltip if it exists, else render the tooltip and buffer it
  */
 void WidgetTooltip::render(TooltipData &tip, const Point& pos, STYLE style) {
-	if (tip.tip_buffer == NULL) {
+	if (tip.tip_buffer == NULL && !loadBuffer(tip)) {
 		if (!createBuffer(tip)) return;
+		storeBuffer(tip);
 	}
 
 	Point size;
@@ -111,7 +117,7 @@ void WidgetTooltip::render(TooltipData &tip, const Point& pos, STYLE style) {
 	bounds.w = size.x;
 	bounds.h = size.y;
 
-	render_device->render(tip.tip_buffer);
+	render_device->submit(tip.tip_buffer);
 }
 
 /**
@@ -213,3 +219,36 @@ bool WidgetTooltip::createBuffer(TooltipData &tip) {
 	return true;
 }
 
+bool WidgetTooltip::loadBuffer(TooltipData &tip) {
+	for (size_t i=0; i<buffers.size(); i++) {
+		if (buffers[i].data.compare(&tip)) {
+			buffers[i].last_used = ++buffer_ticks;
+			tip.tip_buffer = buffers[i].graphics->createSprite();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WidgetTooltip::storeBuffer(TooltipData &tip) {
+	if (!tip.tip_buffer) return;
+
+	size_t index = 0;
+	if (buffers.size() < TOOLTIP_BUFFER_CACHE_SIZE) {
+		index = buffers.size();
+		buffers.resize(index+1);
+	}
+	else {
+		// replace the least recently used buffer
+		for (size_t i=1; i<buffers.size(); i++) {
+			if (buffers[i].last_used < buffers[index].last_used)
+				index = i;
+		}
+		buffers[index].graphics->unref();
+	}
+
+	buffers[index].data = tip;
+	buffers[index].graphics = tip.tip_buffer->getGraphics();
+	buffers[index].graphics->ref();
+	buffers[index].last_used = ++buffer_ticks;
+}
@@ -36,6 +36,18 @@ const int TOOLTIP_NONE = 0;
 const int TOOLTIP_MAP = 1;
 const int TOOLTIP_MENU = 2;
 
+// number of recently rendered tooltips that each WidgetTooltip keeps
+const size_t TOOLTIP_BUFFER_CACHE_SIZE = 8;
+
+class WidgetTooltipBuffer {
+public:
+	WidgetTooltipBuffer() : graphics(NULL), last_used(0) {}
+
+	TooltipData data;
+	Image *graphics;
+	unsigned long last_used;
+};
+
 class WidgetTooltip {
 public:
 	WidgetTooltip();
@@ -47,7 +59,14 @@ public:
 	Rect bounds;
 
 private:
+	// reuses a previously rendered image with the same contents as tip
+	bool loadBuffer(TooltipData &tip);
+	void storeBuffer(TooltipData &tip);
+
 	Image *background;
+
+	std::vector<WidgetTooltipBuffer> buffers;
+	unsigned long buffer_ticks;
 };
 
 #endif
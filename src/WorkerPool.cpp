@@ -0,0 +1,307 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class WorkerPool
+ */
+
+#include "Profiler.h"
+#include "Settings.h"
+#include "Utils.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool()
+	: mutex(NULL)
+	, job_added(NULL)
+	, job_done(NULL)
+	, quit(false)
+	, started(false)
+	, job(NULL)
+	, job_data(NULL)
+	, job_count(0)
+	, job_next(0)
+	, job_batch(1)
+	, job_running(0)
+	, next_task_id(1) {
+}
+
+WorkerPool::~WorkerPool() {
+	stopThreads();
+}
+
+/**
+ * Worker thread loop; helps with the current job until quit is set
+ */
+int WorkerPool::run(void *data) {
+	WorkerPool *pool = static_cast<WorkerPool*>(data);
+
+	SDL_LockMutex(pool->mutex);
+	while (true) {
+		// loops come first, since the main thread is waiting for them
+		if (pool->runBatch() || pool->runTask())
+			continue;
+
+		// tasks that were already added are still run before quitting
+		if (pool->quit && pool->tasks.empty())
+			break;
+
+		SDL_CondWait(pool->job_added, pool->mutex);
+	}
+	SDL_UnlockMutex(pool->mutex);
+
+	return 0;
+}
+
+bool WorkerPool::runBatch() {
+	if (!job || job_next >= job_count)
+		return false;
+
+	const size_t begin = job_next;
+	const size_t end = std::min(begin + job_batch, job_count);
+	WorkerJob current_job = job;
+	void *current_data = job_data;
+
+	job_next = end;
+	job_running++;
+	SDL_UnlockMutex(mutex);
+
+	{
+		ProfileScope scope(PROFILE_WORKER_BATCH);
+		current_job(current_data, begin, end);
+	}
+
+	SDL_LockMutex(mutex);
+	job_running--;
+	if (job_next >= job_count && job_running == 0)
+		SDL_CondBroadcast(job_done);
+
+	return true;
+}
+
+bool WorkerPool::isTaskActive(WorkerTaskID id) {
+	if (std::find(tasks_running.begin(), tasks_running.end(), id) != tasks_running.end())
+		return true;
+
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		if (tasks[i].id == id)
+			return true;
+	}
+	return false;
+}
+
+bool WorkerPool::runTask() {
+	size_t index = 0;
+	while (index < tasks.size() && tasks[index].after != 0 && isTaskActive(tasks[index].after))
+		index++;
+
+	if (index >= tasks.size())
+		return false;
+
+	Task task = tasks[index];
+	tasks.erase(tasks.begin() + index);
+	tasks_running.push_back(task.id);
+	SDL_UnlockMutex(mutex);
+
+	if (task.run) {
+		ProfileScope scope(PROFILE_WORKER_TASK);
+		task.run(task.data);
+	}
+
+	SDL_LockMutex(mutex);
+	tasks_running.erase(std::find(tasks_running.begin(), tasks_running.end(), task.id));
+	tasks_done.push_back(task);
+	SDL_CondBroadcast(job_done);
+
+	// tasks that were waiting for this one can start now
+	if (!tasks.empty())
+		SDL_CondBroadcast(job_added);
+
+	return true;
+}
+
+void WorkerPool::startThreads() {
+	started = true;
+
+	int thread_count = (WORKER_THREADS > 0) ? WORKER_THREADS : SDL_GetCPUCount();
+	thread_count = std::min(thread_count, WORKER_THREADS_MAX + 1) - 1;
+	if (thread_count <= 0)
+		return;
+
+	mutex = SDL_CreateMutex();
+	job_added = SDL_CreateCond();
+	job_done = SDL_CreateCond();
+	if (!mutex || !job_added || !job_done) {
+		logError("WorkerPool: Could not create thread synchronization: %s", SDL_GetError());
+		return;
+	}
+
+	for (int i = 0; i < thread_count; ++i) {
+		SDL_Thread *thread = SDL_CreateThread(run, "WorkerPool", this);
+		if (!thread) {
+			logError("WorkerPool: Could not create thread: %s", SDL_GetError());
+			break;
+		}
+		threads.push_back(thread);
+	}
+}
+
+void WorkerPool::stopThreads() {
+	if (!threads.empty()) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(job_added);
+		SDL_UnlockMutex(mutex);
+
+		for (size_t i = 0; i < threads.size(); ++i) {
+			SDL_WaitThread(threads[i], NULL);
+		}
+		threads.clear();
+	}
+
+	if (job_done) SDL_DestroyCond(job_done);
+	if (job_added) SDL_DestroyCond(job_added);
+	if (mutex) SDL_DestroyMutex(mutex);
+	job_done = job_added = NULL;
+	mutex = NULL;
+}
+
+/**
+ * The calling thread works on batches too, and waits for the workers to finish theirs.
+ * Small jobs, or a pool without threads, run directly on the calling thread.
+ * So does a job started while the pool is busy with another thread's job.
+ */
+void WorkerPool::parallelFor(WorkerJob _job, void *data, size_t count, size_t min_batch) {
+	if (count == 0)
+		return;
+
+	if (!started)
+		startThreads();
+
+	min_batch = std::max(min_batch, static_cast<size_t>(1));
+	if (threads.empty() || count < min_batch * 2) {
+		_job(data, 0, count);
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+
+	// the pool only runs one job at a time; another thread's job, e.g. from the MapPreloader, runs on that thread
+	if (job) {
+		SDL_UnlockMutex(mutex);
+		_job(data, 0, count);
+		return;
+	}
+
+	job = _job;
+	job_data = data;
+	job_count = count;
+	job_next = 0;
+	job_batch = std::max(min_batch, count / ((threads.size() + 1) * 4));
+	SDL_CondBroadcast(job_added);
+
+	while (runBatch()) {}
+
+	while (job_running > 0)
+		SDL_CondWait(job_done, mutex);
+
+	job = NULL;
+	job_data = NULL;
+	SDL_UnlockMutex(mutex);
+}
+
+WorkerTaskID WorkerPool::addTask(WorkerTask _run, WorkerTask _done, void *data, WorkerTaskID after) {
+	if (!started)
+		startThreads();
+
+	Task task;
+	task.after = after;
+	task.run = _run;
+	task.done = _done;
+	task.data = data;
+
+	if (threads.empty()) {
+		task.id = next_task_id++;
+		if (task.run)
+			task.run(task.data);
+		tasks_done.push_back(task);
+		return task.id;
+	}
+
+	SDL_LockMutex(mutex);
+	task.id = next_task_id++;
+	if (next_task_id == 0)
+		next_task_id = 1;
+	tasks.push_back(task);
+	SDL_CondSignal(job_added);
+	SDL_UnlockMutex(mutex);
+
+	return task.id;
+}
+
+/**
+ * done is called outside of the lock, so it may add new tasks
+ */
+void WorkerPool::finishTasks() {
+	std::vector<Task> finished;
+
+	if (threads.empty()) {
+		finished.swap(tasks_done);
+	}
+	else {
+		SDL_LockMutex(mutex);
+		finished.swap(tasks_done);
+		SDL_UnlockMutex(mutex);
+	}
+
+	for (size_t i = 0; i < finished.size(); ++i) {
+		if (finished[i].done)
+			finished[i].done(finished[i].data);
+	}
+}
+
+bool WorkerPool::isTaskPending(WorkerTaskID id) {
+	if (id == 0)
+		return false;
+
+	if (!threads.empty())
+		SDL_LockMutex(mutex);
+
+	bool pending = isTaskActive(id);
+
+	// finished tasks are pending until their done has been called
+	for (size_t i = 0; i < tasks_done.size() && !pending; ++i) {
+		if (tasks_done[i].id == id)
+			pending = true;
+	}
+
+	if (!threads.empty())
+		SDL_UnlockMutex(mutex);
+
+	return pending;
+}
+
+void WorkerPool::waitForTask(WorkerTaskID id) {
+	if (id == 0 || threads.empty())
+		return;
+
+	SDL_LockMutex(mutex);
+	while (isTaskActive(id))
+		SDL_CondWait(job_done, mutex);
+	SDL_UnlockMutex(mutex);
+}
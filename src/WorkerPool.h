@@ -0,0 +1,115 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * class WorkerPool
+ *
+ * A few threads that help the main thread with loops whose iterations don't
+ * depend on each other. parallelFor() splits the range into batches and only
+ * returns once every batch is done, so the job may read game state freely as
+ * long as it doesn't write to anything that other batches read.
+ *
+ * The same threads also run background tasks from addTask() while no loop
+ * needs them. A task's result is handed back on the main thread by
+ * finishTasks(), which is where anything touching SDL or game state belongs.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+#include <SDL.h>
+
+// the most worker threads used, regardless of the number of CPUs
+const int WORKER_THREADS_MAX = 8;
+
+// processes the items in [begin, end)
+typedef void (*WorkerJob)(void *data, size_t begin, size_t end);
+
+// a background task, or the main thread part that finishes it
+typedef void (*WorkerTask)(void *data);
+
+// identifies a task for addTask(), so that other tasks can wait for it; 0 is no task
+typedef unsigned WorkerTaskID;
+
+class WorkerPool {
+private:
+	class Task {
+	public:
+		WorkerTaskID id;
+		WorkerTaskID after;
+		WorkerTask run;
+		WorkerTask done;
+		void *data;
+	};
+
+	static int run(void *data);
+	void startThreads();
+	void stopThreads();
+
+	// runs one batch of the current job; the mutex must be locked, and is locked again on return
+	bool runBatch();
+
+	// runs the first task whose dependency has finished; the mutex must be locked, and is locked again on return
+	bool runTask();
+	bool isTaskActive(WorkerTaskID id);
+
+	std::vector<SDL_Thread*> threads;
+	SDL_mutex *mutex;
+	SDL_cond *job_added;
+	SDL_cond *job_done;
+	bool quit;
+	bool started;
+
+	WorkerJob job;
+	void *job_data;
+	size_t job_count;
+	size_t job_next;
+	size_t job_batch;
+	size_t job_running;
+
+	std::vector<Task> tasks; // waiting to run, oldest first
+	std::vector<WorkerTaskID> tasks_running;
+	std::vector<Task> tasks_done; // waiting for finishTasks()
+	WorkerTaskID next_task_id;
+
+public:
+	WorkerPool();
+	WorkerPool(const WorkerPool&); // not implemented
+	~WorkerPool();
+
+	// calls job for every item in [0, count), in batches of at least min_batch items
+	void parallelFor(WorkerJob _job, void *data, size_t count, size_t min_batch);
+
+	// calls _run on a worker thread once the task after has finished, and _done on the main thread afterwards
+	// Either can be NULL. Without worker threads, run is called right away.
+	// Tasks still waiting when the pool is deleted are run, but their _done is not called.
+	WorkerTaskID addTask(WorkerTask _run, WorkerTask _done, void *data, WorkerTaskID after = 0);
+
+	// calls done for the tasks that have finished running; only on the main thread
+	void finishTasks();
+
+	// true until the task has been run and finished
+	bool isTaskPending(WorkerTaskID id);
+
+	// returns once the task has run; its done is still left to finishTasks()
+	void waitForTask(WorkerTaskID id);
+};
+
+#endif // WORKER_POOL_H
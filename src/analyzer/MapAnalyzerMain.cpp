@@ -0,0 +1,400 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * The flare_mapanalyzer executable
+ *
+ * Usage: flare_mapanalyzer [--mods=<MOD>,...] [--data-path=<PATH>] [MAP]...
+ * Loads each map with the engine's Map and TileSet loaders and prints what it
+ * costs to draw and simulate: tiles per layer, draw calls per screen, tile
+ * extents, event density, enemy spawns and walkable regions. Anything known
+ * to be expensive is printed as a warning. Without a MAP, every map of the
+ * enabled mods is analyzed. The exit code is 1 if there were any warnings.
+ */
+
+#include "AnimationManager.h"
+#include "DeviceList.h"
+#include "FontEngine.h"
+#include "ItemManager.h"
+#include "LootManager.h"
+#include "Map.h"
+#include "MapCollision.h"
+#include "MessageEngine.h"
+#include "ModManager.h"
+#include "RenderDevice.h"
+#include "Settings.h"
+#include "SharedGameResources.h"
+#include "SharedResources.h"
+#include "SoundManager.h"
+#include "Stats.h"
+#include "TileSet.h"
+#include "UtilsParsing.h"
+#include "WorkerPool.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+// the engine's platform functions are compiled along with the main() that uses them
+#define PLATFORM_CPP_INCLUDE
+
+#ifdef _WIN32
+#include "PlatformWin32.cpp"
+#elif __ANDROID__
+#include "PlatformAndroid.cpp"
+#elif __IPHONEOS__
+#include "PlatformIPhoneOS.cpp"
+#elif __GCW0__
+#include "PlatformGCW0.cpp"
+#else
+#include "PlatformLinux.cpp"
+#endif
+
+// a layer whose largest tile covers more tiles than this widens its render scan noticeably
+const int ANALYZER_MAX_TILE_EXTENT = 4;
+
+// tiles drawn on one screen, over all layers
+const int ANALYZER_MAX_DRAWS_PER_SCREEN = 2500;
+
+// animated tiles below the object layer make their prerendered chunks redraw on every frame change
+const int ANALYZER_MAX_CACHED_ANIMATED = 64;
+
+// event trigger areas within one screen
+const int ANALYZER_MAX_EVENTS_PER_SCREEN = 48;
+
+// the most enemies that the enemy groups of a map can spawn
+const int ANALYZER_MAX_SPAWNS = 200;
+
+static int warning_count = 0;
+
+static void warn(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	printf("  WARNING: ");
+	vprintf(format, args);
+	printf("\n");
+	va_end(args);
+	warning_count++;
+}
+
+/**
+ * The largest sum of counts in any size x size window, using a summed area table
+ */
+static int getPeakWindow(const std::vector<int>& counts, int w, int h, int size) {
+	if (w <= 0 || h <= 0)
+		return 0;
+
+	std::vector<int> sums(static_cast<size_t>((w + 1) * (h + 1)), 0);
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			sums[(y + 1) * (w + 1) + x + 1] = counts[y * w + x]
+				+ sums[y * (w + 1) + x + 1]
+				+ sums[(y + 1) * (w + 1) + x]
+				- sums[y * (w + 1) + x];
+		}
+	}
+
+	const int size_x = std::min(size, w);
+	const int size_y = std::min(size, h);
+	int peak = 0;
+	for (int y = size_y; y <= h; ++y) {
+		for (int x = size_x; x <= w; ++x) {
+			const int sum = sums[y * (w + 1) + x]
+				- sums[(y - size_y) * (w + 1) + x]
+				- sums[y * (w + 1) + x - size_x]
+				+ sums[(y - size_y) * (w + 1) + x - size_x];
+			peak = std::max(peak, sum);
+		}
+	}
+	return peak;
+}
+
+/**
+ * Labels the walkable tiles by the region they can be walked to from, with 8 neighbours as A* uses
+ * Blocked tiles get -1. Returns the number of tiles in each region.
+ */
+static std::vector<int> findRegions(const MapCollision& collider, int w, int h, std::vector<int>& labels) {
+	std::vector<int> sizes;
+	std::vector<Point> open;
+	labels.assign(static_cast<size_t>(w * h), -1);
+
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			if (labels[y * w + x] != -1 || !collider.is_static_walkable(x, y, MOVEMENT_NORMAL))
+				continue;
+
+			const int region = static_cast<int>(sizes.size());
+			sizes.push_back(0);
+			labels[y * w + x] = region;
+			open.push_back(Point(x, y));
+
+			while (!open.empty()) {
+				const Point p = open.back();
+				open.pop_back();
+				sizes[region]++;
+
+				for (int dy = -1; dy <= 1; ++dy) {
+					for (int dx = -1; dx <= 1; ++dx) {
+						const int nx = p.x + dx;
+						const int ny = p.y + dy;
+						if (nx < 0 || ny < 0 || nx >= w || ny >= h || labels[ny * w + nx] != -1)
+							continue;
+						if (!collider.is_static_walkable(nx, ny, MOVEMENT_NORMAL))
+							continue;
+						labels[ny * w + nx] = region;
+						open.push_back(Point(nx, ny));
+					}
+				}
+			}
+		}
+	}
+	return sizes;
+}
+
+static void analyzeMap(const std::string& filename) {
+	printf("%s\n", filename.c_str());
+
+	Map map;
+	map.load(filename);
+	if (map.w == 0 || map.h == 0) {
+		warn("The map could not be loaded.");
+		return;
+	}
+
+	TileSet tset;
+	tset.load(map.getTileset());
+
+	const int w = map.w;
+	const int h = map.h;
+	const int map_tiles = w * h;
+
+	// seen from the middle of the map, the screen covers this many tiles
+	const int tile_area = TILESET_ORIENTATION == TILESET_ISOMETRIC ? (TILE_W * TILE_H) / 2 : TILE_W * TILE_H;
+	const int screen_tiles = std::max(1, (VIEW_W * VIEW_H) / std::max(1, tile_area));
+	const int screen_size = std::max(1, static_cast<int>(sqrtf(static_cast<float>(screen_tiles))));
+
+	printf("  size %dx%d, tileset %s (largest tile %dx%d), %d tiles per %dx%d screen\n",
+		w, h, map.getTileset().c_str(), tset.max_size_x, tset.max_size_y, screen_tiles, VIEW_W, VIEW_H);
+
+	// layers
+	std::vector<int> all_tiles(static_cast<size_t>(map_tiles), 0);
+	std::vector<int> layer_tiles(static_cast<size_t>(map_tiles), 0);
+	bool below_objects = true;
+	int cached_animated = 0;
+	int collision_index = -1;
+
+	for (size_t i = 0; i < map.layers.size(); ++i) {
+		const std::string& name = i < map.layernames.size() ? map.layernames[i] : "";
+		if (name == "collision") {
+			collision_index = static_cast<int>(i);
+			continue;
+		}
+		if (name == "object")
+			below_objects = false;
+
+		const Map_Layer& layer = map.layers[i];
+		int count = 0;
+		int animated = 0;
+		Point extent;
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				const unsigned short tile = layer.at(x, y);
+				layer_tiles[y * w + x] = tile ? 1 : 0;
+				if (!tile)
+					continue;
+
+				count++;
+				all_tiles[y * w + x]++;
+				const Point tile_extent = tset.getTileExtent(tile);
+				extent.x = std::max(extent.x, tile_extent.x);
+				extent.y = std::max(extent.y, tile_extent.y);
+				if (tile < tset.anim.size() && tset.anim[tile].frames > 0)
+					animated++;
+			}
+		}
+
+		printf("  layer %-12s %7d tiles (%3d%%), %5d per screen at most, largest tile %dx%d, %d animated\n",
+			name.c_str(), count, count * 100 / std::max(map_tiles, 1),
+			getPeakWindow(layer_tiles, w, h, screen_size), extent.x, extent.y, animated);
+
+		if (extent.x > ANALYZER_MAX_TILE_EXTENT || extent.y > ANALYZER_MAX_TILE_EXTENT)
+			warn("Layer '%s' has a tile covering %dx%d tiles, so every tile of the layer within that distance of the screen is visited.", name.c_str(), extent.x, extent.y);
+		if (below_objects)
+			cached_animated += animated;
+	}
+
+	const int draws = getPeakWindow(all_tiles, w, h, screen_size);
+	printf("  draw calls: up to %d tiles per screen\n", draws);
+	if (draws > ANALYZER_MAX_DRAWS_PER_SCREEN)
+		warn("Up to %d tiles are drawn on one screen.", draws);
+	if (cached_animated > ANALYZER_MAX_CACHED_ANIMATED)
+		warn("%d animated tiles are below the object layer, so their prerendered chunks are drawn again on every frame change.", cached_animated);
+
+	// events
+	std::vector<int> event_tiles(static_cast<size_t>(map_tiles), 0);
+	int hotspots = 0;
+	for (size_t i = 0; i < map.events.size(); ++i) {
+		const Event& evnt = map.events[i];
+		if (evnt.hotspot.w > 0 && evnt.hotspot.h > 0)
+			hotspots++;
+
+		const int x = std::max(0, std::min(evnt.location.x, w - 1));
+		const int y = std::max(0, std::min(evnt.location.y, h - 1));
+		event_tiles[y * w + x]++;
+	}
+	const int event_peak = getPeakWindow(event_tiles, w, h, screen_size);
+	printf("  events: %d, %d with a hotspot, up to %d per screen\n", static_cast<int>(map.events.size()), hotspots, event_peak);
+	if (event_peak > ANALYZER_MAX_EVENTS_PER_SCREEN)
+		warn("Up to %d events are within one screen.", event_peak);
+
+	// enemies
+	std::queue<Map_Group> groups = map.enemy_groups;
+	const int single_enemies = static_cast<int>(map.enemies.size());
+	int group_count = 0;
+	int spawn_total = single_enemies;
+	int spawn_largest = 0;
+	std::vector<Point> spawn_points;
+	while (!groups.empty()) {
+		const Map_Group& group = groups.front();
+		group_count++;
+		spawn_total += group.numbermax;
+		spawn_largest = std::max(spawn_largest, group.numbermax);
+		spawn_points.push_back(Point(group.pos.x + group.area.x / 2, group.pos.y + group.area.y / 2));
+		groups.pop();
+	}
+	printf("  enemies: %d placed, %d groups spawning up to %d (largest group %d), %d npcs\n",
+		single_enemies, group_count, spawn_total - single_enemies, spawn_largest, static_cast<int>(map.npcs.size()));
+	if (spawn_total > ANALYZER_MAX_SPAWNS)
+		warn("Up to %d enemies can be on this map.", spawn_total);
+
+	// collision
+	if (collision_index == -1) {
+		warn("The map has no collision layer.");
+		return;
+	}
+
+	MapCollision collider;
+	collider.setmap(map.layers[collision_index]);
+
+	std::vector<int> labels;
+	const std::vector<int> regions = findRegions(collider, w, h, labels);
+	int walkable = 0;
+	int largest = 0;
+	for (size_t i = 0; i < regions.size(); ++i) {
+		walkable += regions[i];
+		largest = std::max(largest, regions[i]);
+	}
+
+	int hero_region = -1;
+	const Point hero_tile(static_cast<int>(map.hero_pos.x), static_cast<int>(map.hero_pos.y));
+	if (hero_tile.x >= 0 && hero_tile.y >= 0 && hero_tile.x < w && hero_tile.y < h)
+		hero_region = labels[hero_tile.y * w + hero_tile.x];
+
+	printf("  pathing: %d walkable tiles in %d regions, the largest has %d\n", walkable, static_cast<int>(regions.size()), largest);
+	if (hero_region == -1)
+		warn("The hero spawns on a blocked tile.");
+
+	// enemies that can't walk to the hero search paths until they run into the node limit
+	int unreachable = 0;
+	for (size_t i = 0; i < spawn_points.size(); ++i) {
+		const Point& p = spawn_points[i];
+		if (p.x < 0 || p.y < 0 || p.x >= w || p.y >= h)
+			continue;
+		const int region = labels[p.y * w + p.x];
+		if (hero_region != -1 && region != -1 && region != hero_region)
+			unreachable++;
+	}
+	if (unreachable > 0)
+		warn("%d enemy groups spawn where the hero's spawn can't be walked to, so their path searches never succeed.", unreachable);
+}
+
+int main(int argc, char *argv[]) {
+	std::vector<std::string> mod_list;
+	std::vector<std::string> map_files;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg.compare(0, 7, "--mods=") == 0) {
+			std::string mod_list_str = arg.substr(7);
+			while (!mod_list_str.empty())
+				mod_list.push_back(popFirstString(mod_list_str));
+		}
+		else if (arg.compare(0, 12, "--data-path=") == 0) {
+			CUSTOM_PATH_DATA = arg.substr(12);
+			if (!CUSTOM_PATH_DATA.empty() && CUSTOM_PATH_DATA.at(CUSTOM_PATH_DATA.length()-1) != '/')
+				CUSTOM_PATH_DATA += "/";
+		}
+		else {
+			map_files.push_back(arg);
+		}
+	}
+
+	PlatformInit(&PlatformOptions);
+	PlatformSetPaths();
+
+	if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+		logError("MapAnalyzer: Could not initialize SDL: %s", SDL_GetError());
+		return 1;
+	}
+
+	// the same set-up as a headless game, as far as loading maps needs it
+	mods = new ModManager(&mod_list);
+	if (!mods->haveFallbackMod()) {
+		logError("MapAnalyzer: Could not find the default mod.");
+		return 1;
+	}
+	loadSettings();
+
+	msg = new MessageEngine();
+	font = getFontEngine(true);
+	anim = new AnimationManager();
+	workers = new WorkerPool();
+
+	loadTilesetSettings();
+	loadMiscSettings();
+	setStatNames();
+
+	render_device = getRenderDevice("null");
+	render_device->createContext();
+	snd = getSoundManager(true);
+
+	// loot tables referenced by map events are expanded while parsing
+	items = new ItemManager();
+	loot = new LootManager();
+
+	if (map_files.empty())
+		map_files = mods->list("maps", false);
+
+	for (size_t i = 0; i < map_files.size(); ++i) {
+		analyzeMap(map_files[i]);
+	}
+	printf("%d maps, %d warnings\n", static_cast<int>(map_files.size()), warning_count);
+
+	delete loot;
+	delete items;
+	delete snd;
+	render_device->destroyContext();
+	delete render_device;
+	delete workers;
+	delete anim;
+	delete font;
+	delete msg;
+	delete mods;
+	SDL_Quit();
+
+	return warning_count > 0 ? 1 : 0;
+}
@@ -18,7 +18,7 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include "MapSaver.h"
 #include "Settings.h"
 
-MapSaver::MapSaver(Map *_map) : map(_map)
+MapSaver::MapSaver(Map *_map) : rle_layers(false), incremental(false), map(_map), events_cached(false)
 {
 	EVENT_COMPONENT_NAME[EC_TOOLTIP] = "tooltip";
 	EVENT_COMPONENT_NAME[EC_POWER_PATH] = "power_path";
@@ -60,6 +60,8 @@ MapSaver::MapSaver(Map *_map) : map(_map)
 	EVENT_COMPONENT_NAME[EC_BOOK] = "book";
 
 	dest_file = map->getFilename();
+
+	file_buffer.resize(1 << 16);
 }
 
 
@@ -77,6 +79,8 @@ bool MapSaver::saveMap(std::string tileset_definitions)
 {
 	std::ofstream outfile;
 
+	// the buffer has to be set before the file is opened
+	outfile.rdbuf()->pubsetbuf(&file_buffer[0], static_cast<std::streamsize>(file_buffer.size()));
 	outfile.open(dest_file.c_str(), std::ios::out);
 
 	if (outfile.is_open()) {
@@ -87,7 +91,18 @@ bool MapSaver::saveMap(std::string tileset_definitions)
 		writeTilesets(outfile, tileset_definitions);
 		writeLayers(outfile);
 
-		writeEvents(outfile);
+		if (!incremental) {
+			writeEvents(outfile);
+		}
+		else {
+			if (!events_cached) {
+				std::ostringstream events;
+				writeEvents(events);
+				events_cache = events.str();
+				events_cached = true;
+			}
+			outfile << events_cache;
+		}
 		writeNPCs(outfile);
 		writeEnemies(outfile);
 
@@ -114,100 +129,200 @@ bool MapSaver::saveMap(std::string file, std::string tileset_definitions)
 	return saveMap(tileset_definitions);
 }
 
+void MapSaver::setLayerChanged(unsigned index)
+{
+	if (index < layer_cache.size())
+		layer_cache[index].clear();
+}
 
-void MapSaver::writeHeader(std::ofstream& map_file)
+void MapSaver::setEventsChanged()
 {
-	map_file << "[header]" << std::endl;
-	map_file << "width=" << map->w << std::endl;
-	map_file << "height=" << map->h << std::endl;
-	map_file << "tilewidth=" << "64" << std::endl;
-	map_file << "tileheight=" << "32" << std::endl;
-	map_file << "orientation=" << "isometric" << std::endl;
-	map_file << "music=" << map->music_filename << std::endl;
-	map_file << "tileset=" << map->getTileset() << std::endl;
-	map_file << "title=" << map->title << std::endl;
-	map_file << "hero_pos" << static_cast<int>(map->hero_pos.x) << "," << static_cast<int>(map->hero_pos.y) << std::endl;
-
-	map_file << std::endl;
+	events_cached = false;
+	events_cache.clear();
 }
 
-void MapSaver::writeTilesets(std::ofstream& map_file, std::string tileset_definitions)
+/*
+ * Needed after the layers were resized, or when a different map was loaded
+ */
+void MapSaver::setAllChanged()
 {
-	map_file << "[tilesets]" << std::endl;
+	layer_cache.clear();
+	setEventsChanged();
+}
 
-	map_file << tileset_definitions << std::endl;
 
-	map_file << std::endl;
+void MapSaver::writeHeader(std::ostream& map_file)
+{
+	map_file << "[header]" << "\n";
+	map_file << "width=" << map->w << "\n";
+	map_file << "height=" << map->h << "\n";
+	map_file << "tilewidth=" << "64" << "\n";
+	map_file << "tileheight=" << "32" << "\n";
+	map_file << "orientation=" << "isometric" << "\n";
+	map_file << "music=" << map->music_filename << "\n";
+	map_file << "tileset=" << map->getTileset() << "\n";
+	map_file << "title=" << map->title << "\n";
+	map_file << "hero_pos" << static_cast<int>(map->hero_pos.x) << "," << static_cast<int>(map->hero_pos.y) << "\n";
+	if (map->populate_range > 0)
+		map_file << "populate_range=" << map->populate_range << "\n";
+
+	map_file << "\n";
 }
 
+void MapSaver::writeTilesets(std::ostream& map_file, std::string tileset_definitions)
+{
+	map_file << "[tilesets]" << "\n";
+
+	map_file << tileset_definitions << "\n";
+
+	map_file << "\n";
+}
 
-void MapSaver::writeLayers(std::ofstream& map_file)
+
+void MapSaver::writeLayers(std::ostream& map_file)
 {
-	for (unsigned short i = 0; i < map->layernames.size(); i++)
+	if (!incremental)
 	{
-		map_file << "[layer]" << std::endl;
+		for (unsigned i = 0; i < map->layers.size(); i++)
+			writeLayer(map_file, i);
+		return;
+	}
 
-		map_file << "type=" << map->layernames[i] << std::endl;
-		map_file << "data=" << std::endl;
+	if (layer_cache.size() != map->layers.size())
+	{
+		layer_cache.clear();
+		layer_cache.resize(map->layers.size());
+	}
 
-		std::string layer = "";
-		for (int line = 0; line < map->h; line++)
+	for (unsigned i = 0; i < map->layers.size(); i++)
+	{
+		if (layer_cache[i].empty())
 		{
-			std::stringstream map_row;
-			for (int tile = 0; tile < map->w; tile++)
+			std::ostringstream layer;
+			writeLayer(layer, i);
+			layer_cache[i] = layer.str();
+		}
+		map_file << layer_cache[i];
+	}
+}
+
+void MapSaver::writeLayer(std::ostream& map_file, unsigned index)
+{
+	map_file << "[layer]" << "\n";
+
+	map_file << "type=" << map->layernames[index] << "\n";
+	if (rle_layers)
+		map_file << "format=rle" << "\n";
+	map_file << "data=" << "\n";
+
+	for (int line = 0; line < map->h; line++)
+	{
+		writeLayerRow(map_file, map->layers[index].row(line), line == map->h - 1);
+	}
+
+	map_file << "\n";
+}
+
+/*
+ * Appends the decimal digits of value to buf
+ */
+static void appendNumber(std::vector<char>& buf, unsigned value)
+{
+	char digits[10];
+	int count = 0;
+	do
+	{
+		digits[count++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	while (count > 0)
+		buf.push_back(digits[--count]);
+}
+
+/*
+ * Rows are formatted without going through the stream, then written at once.
+ * The last row of a layer has no trailing comma.
+ */
+void MapSaver::writeLayerRow(std::ostream& map_file, const unsigned short *row, bool last)
+{
+	row_buffer.clear();
+
+	for (int tile = 0; tile < map->w; )
+	{
+		int run = 1;
+		if (rle_layers)
+		{
+			while (tile + run < map->w && row[tile + run] == row[tile])
+				run++;
+		}
+
+		// short runs are no smaller than writing the tiles
+		if (run > 2)
+		{
+			appendNumber(row_buffer, run);
+			row_buffer.push_back('*');
+			appendNumber(row_buffer, row[tile]);
+			row_buffer.push_back(',');
+		}
+		else
+		{
+			for (int k = 0; k < run; k++)
 			{
-				map_row << map->layers[i][tile][line] << ",";
+				appendNumber(row_buffer, row[tile]);
+				row_buffer.push_back(',');
 			}
-			layer += map_row.str();
-			layer += '\n';
 		}
-		layer.erase(layer.end()-2, layer.end());
-		layer += '\n';
-
-		map_file << layer << std::endl;
+		tile += run;
 	}
+
+	if (last && !row_buffer.empty())
+		row_buffer.pop_back();
+	row_buffer.push_back('\n');
+
+	map_file.write(&row_buffer[0], static_cast<std::streamsize>(row_buffer.size()));
 }
 
 
-void MapSaver::writeEnemies(std::ofstream& map_file)
+void MapSaver::writeEnemies(std::ostream& map_file)
 {
 	std::queue<Map_Group> group = map->enemy_groups;
 
 	while (!group.empty())
 	{
-		map_file << "[enemy]" << std::endl;
+		map_file << "[enemy]" << "\n";
 
 		if (group.front().type == "")
 		{
-			map_file << "type=enemy" << std::endl;
+			map_file << "type=enemy" << "\n";
 		}
 		else
 		{
-			map_file << "type=" << group.front().type << std::endl;
+			map_file << "type=" << group.front().type << "\n";
 		}
 
-		map_file << "location=" << group.front().pos.x << "," << group.front().pos.y << "," << group.front().area.x << "," << group.front().area.y << std::endl;
+		map_file << "location=" << group.front().pos.x << "," << group.front().pos.y << "," << group.front().area.x << "," << group.front().area.y << "\n";
 
-		map_file << "category=" << group.front().category << std::endl;
+		map_file << "category=" << group.front().category << "\n";
 
 		if (group.front().levelmin != 0 || group.front().levelmax != 0)
 		{
-			map_file << "level=" << group.front().levelmin << "," << group.front().levelmax << std::endl;
+			map_file << "level=" << group.front().levelmin << "," << group.front().levelmax << "\n";
 		}
 
 		if (group.front().numbermin != 1 || group.front().numbermax != 1)
 		{
-			map_file << "number=" << group.front().numbermin << "," << group.front().numbermax << std::endl;
+			map_file << "number=" << group.front().numbermin << "," << group.front().numbermax << "\n";
 		}
 
 		if (group.front().chance != 1.0f)
 		{
-			map_file << "chance=" << group.front().chance*100 << std::endl;
+			map_file << "chance=" << group.front().chance*100 << "\n";
 		}
 
 		if (group.front().direction != -1)
 		{
-			map_file << "direction=" << group.front().direction << std::endl;
+			map_file << "direction=" << group.front().direction << "\n";
 		}
 
 		if (!group.front().waypoints.empty() && group.front().wander_radius == 0)
@@ -223,112 +338,112 @@ void MapSaver::writeEnemies(std::ofstream& map_file)
 					map_file << ";";
 				}
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 
 		if ((group.front().wander_radius != 4 && group.front().waypoints.empty()))
 		{
-			map_file << "wander_radius=" << group.front().wander_radius << std::endl;
+			map_file << "wander_radius=" << group.front().wander_radius << "\n";
 		}
 
 		for (unsigned i = 0; i < group.front().requires_status.size(); i++)
 		{
-			map_file << "requires_status=" << group.front().requires_status[i] << std::endl;
+			map_file << "requires_status=" << group.front().requires_status[i] << "\n";
 		}
 
 		for (unsigned i = 0; i < group.front().requires_status.size(); i++)
 		{
-			map_file << "requires_not_status=" << group.front().requires_not_status[i] << std::endl;
+			map_file << "requires_not_status=" << group.front().requires_not_status[i] << "\n";
 		}
 
-		map_file << std::endl;
+		map_file << "\n";
 		group.pop();
 	}
 }
 
 
-void MapSaver::writeNPCs(std::ofstream& map_file)
+void MapSaver::writeNPCs(std::ostream& map_file)
 {
 	std::queue<Map_NPC> npcs = map->npcs;
 
 	while (!npcs.empty())
 	{
-		map_file << "[npc]" << std::endl;
+		map_file << "[npc]" << "\n";
 
 		if (npcs.front().type == "")
 		{
-			map_file << "type=npc" << std::endl;
+			map_file << "type=npc" << "\n";
 		}
 		else
 		{
-			map_file << "type=" << npcs.front().type << std::endl;
+			map_file << "type=" << npcs.front().type << "\n";
 		}
 
-		map_file << "location=" << npcs.front().pos.x - 0.5f << "," << npcs.front().pos.y - 0.5f << ",1,1" << std::endl;
-		map_file << "filename=" << npcs.front.id << std::endl;
+		map_file << "location=" << npcs.front().pos.x - 0.5f << "," << npcs.front().pos.y - 0.5f << ",1,1" << "\n";
+		map_file << "filename=" << npcs.front.id << "\n";
 
 		for (unsigned j = 0; j < npcs.front().requires_status.size(); j++)
 		{
-			map_file << "requires_status=" << npcs.front().requires_status[j] << std::endl;
+			map_file << "requires_status=" << npcs.front().requires_status[j] << "\n";
 		}
 		for (unsigned j = 0; j < npcs.front().requires_not_status.size(); j++)
 		{
-			map_file << "requires_not_status=" << npcs.front().requires_not_status[j] << std::endl;
+			map_file << "requires_not_status=" << npcs.front().requires_not_status[j] << "\n";
 		}
 
-		map_file << std::endl;
+		map_file << "\n";
 
 		npcs.pop();
 	}
 }
 
-void MapSaver::writeEvents(std::ofstream& map_file)
+void MapSaver::writeEvents(std::ostream& map_file)
 {
 	for (unsigned i = 0; i < map->events.size(); i++)
 	{
-		map_file << "[event]" << std::endl;
+		map_file << "[event]" << "\n";
 
 		if (map->events[i].type == "")
 		{
-			map_file << "type=event" << std::endl;
+			map_file << "type=event" << "\n";
 		}
 		else
 		{
-			map_file << "type=" << map->events[i].type << std::endl;
+			map_file << "type=" << map->events[i].type << "\n";
 		}
 
 		Rect location = map->events[i].location;
-		map_file << "location=" << location.x << "," << location.y << "," << location.w << "," << location.h  << std::endl;
+		map_file << "location=" << location.x << "," << location.y << "," << location.w << "," << location.h  << "\n";
 
 		if (map->events[i].activate_type == EVENT_ON_TRIGGER)
 		{
-			map_file << "activate=on_trigger" << std::endl;
+			map_file << "activate=on_trigger" << "\n";
 		}
 		else if (map->events[i].activate_type == EVENT_ON_MAPEXIT)
 		{
-			map_file << "activate=on_mapexit" << std::endl;
+			map_file << "activate=on_mapexit" << "\n";
 		}
 		else if (map->events[i].activate_type == EVENT_ON_LEAVE)
 		{
-			map_file << "activate=on_leave" << std::endl;
+			map_file << "activate=on_leave" << "\n";
 		}
 		else if (map->events[i].activate_type == EVENT_ON_LOAD)
 		{
-			map_file << "activate=on_load" << std::endl;
+			map_file << "activate=on_load" << "\n";
 		}
 		else if (map->events[i].activate_type == EVENT_ON_CLEAR)
 		{
-			map_file << "activate=on_clear" << std::endl;
+			map_file << "activate=on_clear" << "\n";
 		}
 
 		Rect hotspot = map->events[i].hotspot;
 		if (hotspot.x == location.x && hotspot.y == location.y && hotspot.w == location.w && hotspot.h == location.h)
 		{
-			map_file << "hotspot=" << "location" << std::endl;
+			map_file << "hotspot=" << "location" << "\n";
 		}
 		else if (hotspot.x != 0 && hotspot.y != 0 && hotspot.w != 0 && hotspot.h != 0)
 		{
-			map_file << "hotspot=" << hotspot.x << "," << hotspot.y << "," << hotspot.w << "," << hotspot.h << std::endl;
+			map_file << "hotspot=" << hotspot.x << "," << hotspot.y << "," << hotspot.w << "," << hotspot.h << "\n";
 		}
 
 		if (map->events[i].cooldown != 0)
@@ -340,23 +455,23 @@ void MapSaver::writeEvents(std::ofstream& map_file)
 				value = map->events[i].cooldown / MAX_FRAMES_PER_SEC;
 				suffix = "s";
 			}
-			map_file << "cooldown=" << value << suffix << std::endl;
+			map_file << "cooldown=" << value << suffix << "\n";
 		}
 
 		Rect reachable_from = map->events[i].reachable_from;
 		if (reachable_from.x != 0 && reachable_from.y != 0 && reachable_from.w != 0 && reachable_from.h != 0)
 		{
-			map_file << "reachable_from=" << reachable_from.x << "," << reachable_from.y << "," << reachable_from.w << "," << reachable_from.h << std::endl;
+			map_file << "reachable_from=" << reachable_from.x << "," << reachable_from.y << "," << reachable_from.w << "," << reachable_from.h << "\n";
 		}
 		writeEventComponents(map_file, i);
 
-		map_file << std::endl;
+		map_file << "\n";
 	}
 }
 
-void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
+void MapSaver::writeEventComponents(std::ostream &map_file, int eventID)
 {
-	std::vector<Event_Component> components = map->events[eventID].components;
+	const std::vector<Event_Component>& components = map->events[eventID].components;
 	for (unsigned i = 0; i < components.size(); i++)
 	{
 		Event_Component e = components[i];
@@ -371,46 +486,46 @@ void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
 		}
 
 		if (e.type == EC_TOOLTIP) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_POWER_PATH) {
 			map_file << e.x << "," << e.y << ",";
-			if (e.s == "hero")
+			if (e.getString() == "hero")
 			{
-				map_file << e.s << std::endl;
+				map_file << e.getString() << "\n";
 			}
 			else
 			{
-				map_file << e.a << "," << e.b << std::endl;
+				map_file << e.a << "," << e.b << "\n";
 			}
 		}
 		else if (e.type == EC_POWER_DAMAGE) {
-			map_file << e.a << "," << e.b << std::endl;
+			map_file << e.a << "," << e.b << "\n";
 		}
 		else if (e.type == EC_INTERMAP) {
-			map_file << e.s << "," << e.x << "," << e.y << std::endl;
+			map_file << e.getString() << "," << e.x << "," << e.y << "\n";
 		}
 		else if (e.type == EC_INTRAMAP) {
-			map_file << e.x << "," << e.y << std::endl;
+			map_file << e.x << "," << e.y << "\n";
 		}
 		else if (e.type == EC_MAPMOD) {
-			map_file << e.s << "," << e.x << "," << e.y << "," << e.z;
+			map_file << e.getString() << "," << e.x << "," << e.y << "," << e.z;
 
 			while (i+1 < components.size() && components[i+1].type == EC_MAPMOD)
 			{
 				i++;
 				e = components[i];
-				map_file << ";" << e.s << "," << e.x << "," << e.y << "," << e.z;
+				map_file << ";" << e.getString() << "," << e.x << "," << e.y << "," << e.z;
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_SOUNDFX) {
-			map_file << e.s;
+			map_file << e.getString();
 			if (e.x != -1 && e.y != -1)
 			{
 				map_file << "," << e.x << "," << e.y;
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_LOOT) {
 
@@ -421,7 +536,7 @@ void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
 			else
 				chance << e.z;
 
-			map_file << e.s << "," << chance.str() << "," << e.a << "," << e.b;
+			map_file << e.getString() << "," << chance.str() << "," << e.a << "," << e.b;
 
 			while (i+1 < components.size() && components[i+1].type == EC_LOOT)
 			{
@@ -433,19 +548,19 @@ void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
 				else
 					chance << e.z;
 
-				map_file << ";" << e.s << "," << chance.str() << "," << e.a << "," << e.b;
+				map_file << ";" << e.getString() << "," << chance.str() << "," << e.a << "," << e.b;
 			}
-			map_file << std::endl;
+			map_file << "\n";
 			// UNIMPLEMENTED
 			// Loot tables not supported
 		}
 		else if (e.type == EC_LOOT_COUNT) {
 			// UNIMPLEMENTED
 			// Loot count not supported
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_MSG) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_SHAKYCAM) {
 			std::string suffix = "ms";
@@ -455,41 +570,41 @@ void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
 				value = e.x / MAX_FRAMES_PER_SEC;
 				suffix = "s";
 			}
-			map_file << value << suffix << std::endl;
+			map_file << value << suffix << "\n";
 		}
 		else if (e.type == EC_REQUIRES_STATUS) {
-			map_file << e.s;
+			map_file << e.getString();
 
 			while (i+1 < components.size() && components[i+1].type == EC_REQUIRES_STATUS)
 			{
 				i++;
 				e = components[i];
-				map_file << ";" << e.s;
+				map_file << ";" << e.getString();
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_REQUIRES_NOT_STATUS) {
-			map_file << e.s;
+			map_file << e.getString();
 
 			while (i+1 < components.size() && components[i+1].type == EC_REQUIRES_NOT_STATUS)
 			{
 				i++;
 				e = components[i];
-				map_file << ";" << e.s;
+				map_file << ";" << e.getString();
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_REQUIRES_LEVEL) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_REQUIRES_NOT_LEVEL) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_REQUIRES_CURRENCY) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_REQUIRES_NOT_CURRENCY) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_REQUIRES_ITEM) {
 			map_file << e.x;
@@ -500,7 +615,7 @@ void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
 				e = components[i];
 				map_file << "," << e.x;
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_REQUIRES_NOT_ITEM) {
 			map_file << e.x;
@@ -511,38 +626,38 @@ void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
 				e = components[i];
 				map_file << "," << e.x;
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_REQUIRES_CLASS) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_REQUIRES_NOT_CLASS) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_SET_STATUS) {
-			map_file << e.s;
+			map_file << e.getString();
 
 			while (i+1 < components.size() && components[i+1].type == EC_SET_STATUS)
 			{
 				i++;
 				e = components[i];
-				map_file << "," << e.s;
+				map_file << "," << e.getString();
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_UNSET_STATUS) {
-			map_file << e.s;
+			map_file << e.getString();
 
 			while (i+1 < components.size() && components[i+1].type == EC_UNSET_STATUS)
 			{
 				i++;
 				e = components[i];
-				map_file << "," << e.s;
+				map_file << "," << e.getString();
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_REMOVE_CURRENCY) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_REMOVE_ITEM) {
 			map_file << e.x;
@@ -553,55 +668,55 @@ void MapSaver::writeEventComponents(std::ofstream &map_file, int eventID)
 				e = components[i];
 				map_file << "," << e.x;
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_REWARD_XP) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_REWARD_CURRENCY) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_REWARD_ITEM) {
 			map_file << e.x << ",";
-			map_file << e.y << std::endl;
+			map_file << e.y << "\n";
 		}
 		else if (e.type == EC_RESTORE) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_POWER) {
-			map_file << e.x << std::endl;
+			map_file << e.x << "\n";
 		}
 		else if (e.type == EC_SPAWN) {
-			map_file << e.s << "," << e.x << "," << e.y;
+			map_file << e.getString() << "," << e.x << "," << e.y;
 
 			while (i+1 < components.size() && components[i+1].type == EC_SPAWN)
 			{
 				i++;
 				e = components[i];
-				map_file << ";" << e.s << "," << e.x << "," << e.y;
+				map_file << ";" << e.getString() << "," << e.x << "," << e.y;
 			}
-			map_file << std::endl;
+			map_file << "\n";
 		}
 		else if (e.type == EC_STASH) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_NPC) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_MUSIC) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_CUTSCENE) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_REPEAT) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_SAVE_GAME) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 		else if (e.type == EC_BOOK) {
-			map_file << e.s << std::endl;
+			map_file << e.getString() << "\n";
 		}
 	}
 }
@@ -32,18 +32,39 @@ public:
 	bool saveMap(std::string tileset_definitions);
 	bool saveMap(std::string file, std::string tileset_definitions);
 
+	// when set, runs of equal tiles are written as "count*tile" (the "rle" layer format)
+	bool rle_layers;
+
+	// when set, the text of the layers and events is kept after saving, and the next
+	// save only serializes the parts marked as changed since then
+	bool incremental;
+	void setLayerChanged(unsigned index);
+	void setEventsChanged();
+	void setAllChanged();
+
 private:
-	void writeHeader(std::ofstream& map_file);
-	void writeTilesets(std::ofstream& map_file, std::string tileset_definitions);
-	void writeLayers(std::ofstream& map_file);
-	void writeEnemies(std::ofstream& map_file);
-	void writeNPCs(std::ofstream& map_file);
-	void writeEvents(std::ofstream& map_file);
-	void writeEventComponents(std::ofstream& map_file, int eventID);
+	void writeHeader(std::ostream& map_file);
+	void writeTilesets(std::ostream& map_file, std::string tileset_definitions);
+	void writeLayers(std::ostream& map_file);
+	void writeLayer(std::ostream& map_file, unsigned index);
+	void writeLayerRow(std::ostream& map_file, const unsigned short *row, bool last);
+	void writeEnemies(std::ostream& map_file);
+	void writeNPCs(std::ostream& map_file);
+	void writeEvents(std::ostream& map_file);
+	void writeEventComponents(std::ostream& map_file, int eventID);
 
 	Map* map;
 	std::string dest_file;
 
+	// the output is buffered in large blocks, and rows are formatted here before being written
+	std::vector<char> file_buffer;
+	std::vector<char> row_buffer;
+
+	// used when incremental is set; an empty layer_cache entry has to be serialized again
+	std::vector<std::string> layer_cache;
+	std::string events_cache;
+	bool events_cached;
+
 	std::string EVENT_COMPONENT_NAME[39];
 };
 
@@ -0,0 +1,526 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * The flare_batch executable
+ *
+ * Usage: flare_batch [--flare=<PATH>] [--jobs=<N>] [--out=<DIR>] [--mods=<MOD>,...] [--data-path=<PATH>] <BATCH FILE>
+ * Runs the simulations listed in BATCH FILE as headless flare processes, up to
+ * N of them at once, and prints one report of their frame times, allocations
+ * and profiler zones. Each run's log and report are kept in DIR. The batch
+ * file has one run per line:
+ *
+ *     replay=<NAME>,<REPLAY FILE>
+ *     map=<NAME>,<MAP>[,<SEED>]
+ *
+ * A replay run plays a recording from --record as fast as possible. A map run
+ * flies the camera through MAP like --benchmark-render, with a fixed seed.
+ * The exit code is 1 if any run failed.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE ProcessHandle;
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+typedef pid_t ProcessHandle;
+#endif
+
+class BatchZone {
+public:
+	std::string name;
+	float average; // ms per frame
+	float peak;
+
+	BatchZone()
+		: average(0)
+		, peak(0) {
+	}
+};
+
+class BatchRun {
+public:
+	std::string name;
+	std::vector<std::string> args;
+	std::string log_file;
+	std::string report_file;
+	int exit_code;
+
+	// read from the report
+	bool has_report;
+	unsigned frames;
+	float seconds;
+	float frame_ms[4]; // p50, p95, p99, max
+	float allocs_per_frame; // -1 without ALLOC_TRACKING
+	std::vector<BatchZone> zones;
+
+	BatchRun()
+		: exit_code(-1)
+		, has_report(false)
+		, frames(0)
+		, seconds(0)
+		, allocs_per_frame(-1) {
+		for (int i = 0; i < 4; ++i)
+			frame_ms[i] = 0;
+	}
+};
+
+static std::string trim(const std::string& s) {
+	size_t first = s.find_first_not_of(" \t\r\n");
+	if (first == std::string::npos)
+		return "";
+	size_t last = s.find_last_not_of(" \t\r\n");
+	return s.substr(first, last - first + 1);
+}
+
+static std::vector<std::string> split(const std::string& s, char separator) {
+	std::vector<std::string> result;
+	std::stringstream ss(s);
+	std::string item;
+	while (std::getline(ss, item, separator))
+		result.push_back(trim(item));
+	return result;
+}
+
+static std::string getArgValue(const std::string& arg) {
+	size_t pos = arg.find('=');
+	return (pos == std::string::npos ? "" : arg.substr(pos + 1));
+}
+
+static bool startsWith(const std::string& s, const std::string& prefix) {
+	return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+static unsigned getCPUCount() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return std::max(1u, static_cast<unsigned>(info.dwNumberOfProcessors));
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0 ? static_cast<unsigned>(count) : 1u);
+#endif
+}
+
+static void createDir(const std::string& path) {
+#ifdef _WIN32
+	CreateDirectoryA(path.c_str(), NULL);
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+#ifdef _WIN32
+/**
+ * Quotes an argument the way CommandLineToArgvW() splits it again
+ */
+static std::string quoteArg(const std::string& arg) {
+	std::string result = "\"";
+	size_t backslashes = 0;
+	for (size_t i = 0; i < arg.size(); ++i) {
+		if (arg[i] == '\\') {
+			backslashes++;
+			continue;
+		}
+		if (arg[i] == '"')
+			result.append(backslashes * 2 + 1, '\\');
+		else
+			result.append(backslashes, '\\');
+		backslashes = 0;
+		result += arg[i];
+	}
+	result.append(backslashes * 2, '\\');
+	result += "\"";
+	return result;
+}
+#endif
+
+/**
+ * Starts args[0] with the other args, writing its output to log_file
+ */
+static bool startProcess(const std::vector<std::string>& args, const std::string& log_file, ProcessHandle& handle) {
+#ifdef _WIN32
+	SECURITY_ATTRIBUTES security;
+	security.nLength = sizeof(security);
+	security.lpSecurityDescriptor = NULL;
+	security.bInheritHandle = TRUE;
+
+	HANDLE log = CreateFileA(log_file.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &security, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (log == INVALID_HANDLE_VALUE)
+		return false;
+
+	std::string command_line;
+	for (size_t i = 0; i < args.size(); ++i) {
+		if (i > 0)
+			command_line += " ";
+		command_line += quoteArg(args[i]);
+	}
+	std::vector<char> buffer(command_line.begin(), command_line.end());
+	buffer.push_back('\0');
+
+	STARTUPINFOA startup;
+	ZeroMemory(&startup, sizeof(startup));
+	startup.cb = sizeof(startup);
+	startup.dwFlags = STARTF_USESTDHANDLES;
+	startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+	startup.hStdOutput = log;
+	startup.hStdError = log;
+
+	PROCESS_INFORMATION process;
+	BOOL started = CreateProcessA(NULL, &buffer[0], NULL, NULL, TRUE, 0, NULL, NULL, &startup, &process);
+	CloseHandle(log);
+	if (!started)
+		return false;
+
+	CloseHandle(process.hThread);
+	handle = process.hProcess;
+	return true;
+#else
+	int log = open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (log < 0)
+		return false;
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(log);
+		return false;
+	}
+
+	if (pid == 0) {
+		dup2(log, STDOUT_FILENO);
+		dup2(log, STDERR_FILENO);
+		close(log);
+
+		std::vector<char*> argv;
+		for (size_t i = 0; i < args.size(); ++i)
+			argv.push_back(const_cast<char*>(args[i].c_str()));
+		argv.push_back(NULL);
+
+		execv(argv[0], &argv[0]);
+		fprintf(stderr, "flare_batch: Could not start '%s'.\n", argv[0]);
+		_exit(127);
+	}
+
+	close(log);
+	handle = pid;
+	return true;
+#endif
+}
+
+/**
+ * Waits until one of the running processes exits, and removes it from running
+ * Returns the index it was started with, or -1 if there was nothing to wait for.
+ */
+static int waitForProcess(std::vector<ProcessHandle>& running, std::vector<int>& running_runs, int& exit_code) {
+	if (running.empty())
+		return -1;
+
+	size_t index = 0;
+#ifdef _WIN32
+	DWORD result = WaitForMultipleObjects(static_cast<DWORD>(running.size()), &running[0], FALSE, INFINITE);
+	if (result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + running.size())
+		return -1;
+	index = result - WAIT_OBJECT_0;
+
+	DWORD code = 1;
+	GetExitCodeProcess(running[index], &code);
+	CloseHandle(running[index]);
+	exit_code = static_cast<int>(code);
+#else
+	int status = 0;
+	pid_t pid = waitpid(-1, &status, 0);
+	if (pid < 0)
+		return -1;
+
+	while (index < running.size() && running[index] != pid)
+		index++;
+	if (index == running.size())
+		return waitForProcess(running, running_runs, exit_code);
+
+	exit_code = (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0));
+#endif
+
+	int run = running_runs[index];
+	running.erase(running.begin() + index);
+	running_runs.erase(running_runs.begin() + index);
+	return run;
+}
+
+static bool readReport(BatchRun& run) {
+	std::ifstream infile(run.report_file.c_str());
+	if (!infile.is_open())
+		return false;
+
+	std::string line;
+	while (std::getline(infile, line)) {
+		size_t pos = line.find('=');
+		if (pos == std::string::npos)
+			continue;
+
+		const std::string key = line.substr(0, pos);
+		const std::vector<std::string> values = split(line.substr(pos + 1), ',');
+
+		if (key == "frames" && !values.empty()) {
+			run.frames = static_cast<unsigned>(strtoul(values[0].c_str(), NULL, 10));
+		}
+		else if (key == "seconds" && !values.empty()) {
+			run.seconds = static_cast<float>(atof(values[0].c_str()));
+		}
+		else if (key == "frame_ms" && values.size() >= 4) {
+			for (int i = 0; i < 4; ++i)
+				run.frame_ms[i] = static_cast<float>(atof(values[i].c_str()));
+		}
+		else if (key == "allocs_per_frame" && !values.empty()) {
+			run.allocs_per_frame = static_cast<float>(atof(values[0].c_str()));
+		}
+		else if (key == "zone" && values.size() >= 3) {
+			BatchZone zone;
+			zone.name = values[0];
+			zone.average = static_cast<float>(atof(values[1].c_str()));
+			zone.peak = static_cast<float>(atof(values[2].c_str()));
+			run.zones.push_back(zone);
+		}
+	}
+
+	run.has_report = true;
+	return true;
+}
+
+static std::string formatFloat(float value, int precision) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.*f", precision, value);
+	return buf;
+}
+
+/**
+ * One line per run, then the zones over all runs, weighted by their frame counts
+ */
+static std::string writeSummary(const std::vector<BatchRun>& runs, float wall_seconds) {
+	std::stringstream out;
+	out << "run,status,frames,seconds,p50 ms,p95 ms,p99 ms,max ms,allocs per frame\n";
+
+	unsigned total_frames = 0;
+	size_t failed = 0;
+	std::vector<BatchZone> zones;
+	std::vector<double> zone_weighted;
+
+	for (size_t i = 0; i < runs.size(); ++i) {
+		const BatchRun& run = runs[i];
+		const bool ok = run.exit_code == 0 && run.has_report;
+		if (!ok)
+			failed++;
+
+		out << run.name << "," << (ok ? "ok" : "failed");
+		if (run.has_report) {
+			out << "," << run.frames << "," << formatFloat(run.seconds, 1);
+			for (int j = 0; j < 4; ++j)
+				out << "," << formatFloat(run.frame_ms[j], 2);
+			out << "," << (run.allocs_per_frame < 0 ? "-" : formatFloat(run.allocs_per_frame, 1));
+		}
+		out << "\n";
+
+		if (!run.has_report)
+			continue;
+
+		total_frames += run.frames;
+		for (size_t j = 0; j < run.zones.size(); ++j) {
+			size_t k = 0;
+			while (k < zones.size() && zones[k].name != run.zones[j].name)
+				k++;
+			if (k == zones.size()) {
+				zones.push_back(run.zones[j]);
+				zones.back().average = 0;
+				zone_weighted.push_back(0);
+			}
+			zone_weighted[k] += static_cast<double>(run.zones[j].average) * run.frames;
+			zones[k].peak = std::max(zones[k].peak, run.zones[j].peak);
+		}
+	}
+
+	out << "\nzone,average ms,peak ms\n";
+	for (size_t i = 0; i < zones.size(); ++i) {
+		const double average = (total_frames > 0 ? zone_weighted[i] / total_frames : 0);
+		out << zones[i].name << "," << formatFloat(static_cast<float>(average), 3) << "," << formatFloat(zones[i].peak, 2) << "\n";
+	}
+
+	out << "\n" << runs.size() << " runs, " << failed << " failed, " << total_frames << " frames in " << formatFloat(wall_seconds, 1) << " seconds\n";
+	return out.str();
+}
+
+static bool loadBatch(const std::string& filename, std::vector<BatchRun>& runs) {
+	std::ifstream infile(filename.c_str());
+	if (!infile.is_open()) {
+		fprintf(stderr, "flare_batch: Could not open '%s'.\n", filename.c_str());
+		return false;
+	}
+
+	std::string line;
+	int line_number = 0;
+	while (std::getline(infile, line)) {
+		line_number++;
+		line = trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		size_t pos = line.find('=');
+		const std::string key = trim(line.substr(0, pos));
+		const std::vector<std::string> values = split(pos == std::string::npos ? "" : line.substr(pos + 1), ',');
+
+		BatchRun run;
+		if (key == "replay" && values.size() >= 2) {
+			run.name = values[0];
+			run.args.push_back("--replay=" + values[1]);
+			run.args.push_back("--replay-fast");
+		}
+		else if (key == "map" && values.size() >= 2) {
+			run.name = values[0];
+			run.args.push_back("--benchmark-render=" + values[1]);
+			run.args.push_back("--seed=" + (values.size() >= 3 ? values[2] : std::string("1")));
+		}
+		else {
+			fprintf(stderr, "flare_batch: %s:%d: expected replay=<NAME>,<FILE> or map=<NAME>,<MAP>[,<SEED>].\n", filename.c_str(), line_number);
+			return false;
+		}
+
+		runs.push_back(run);
+	}
+
+	return true;
+}
+
+static double getSeconds() {
+#ifdef _WIN32
+	return static_cast<double>(GetTickCount()) / 1000.0;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) / 1e9;
+#endif
+}
+
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+	std::string flare = "flare.exe";
+#else
+	std::string flare = "./flare";
+#endif
+	unsigned jobs = getCPUCount();
+	std::string out_dir = "batch";
+	std::string batch_file;
+	std::vector<std::string> engine_args;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (startsWith(arg, "--flare="))
+			flare = getArgValue(arg);
+		else if (startsWith(arg, "--jobs="))
+			jobs = std::max(1, atoi(getArgValue(arg).c_str()));
+		else if (startsWith(arg, "--out="))
+			out_dir = getArgValue(arg);
+		else if (startsWith(arg, "--mods=") || startsWith(arg, "--data-path="))
+			engine_args.push_back(arg);
+		else if (!startsWith(arg, "--"))
+			batch_file = arg;
+	}
+
+	if (batch_file.empty()) {
+		printf("Usage: flare_batch [--flare=<PATH>] [--jobs=<N>] [--out=<DIR>] [--mods=<MOD>,...] [--data-path=<PATH>] <BATCH FILE>\n");
+		return 1;
+	}
+
+#ifdef _WIN32
+	// WaitForMultipleObjects() can't wait for more
+	jobs = std::min(jobs, static_cast<unsigned>(MAXIMUM_WAIT_OBJECTS));
+#endif
+
+	std::vector<BatchRun> runs;
+	if (!loadBatch(batch_file, runs))
+		return 1;
+
+	createDir(out_dir);
+
+	const double start = getSeconds();
+	std::vector<ProcessHandle> running;
+	std::vector<int> running_runs;
+	size_t next = 0;
+
+	while (next < runs.size() || !running.empty()) {
+		while (next < runs.size() && running.size() < jobs) {
+			BatchRun& run = runs[next];
+			run.log_file = out_dir + "/" + run.name + ".log";
+			run.report_file = out_dir + "/" + run.name + ".report";
+			remove(run.report_file.c_str());
+
+			std::vector<std::string> args;
+			args.push_back(flare);
+			args.push_back("--headless");
+			args.insert(args.end(), engine_args.begin(), engine_args.end());
+			args.insert(args.end(), run.args.begin(), run.args.end());
+			args.push_back("--run-report=" + run.report_file);
+
+			ProcessHandle handle;
+			if (startProcess(args, run.log_file, handle)) {
+				running.push_back(handle);
+				running_runs.push_back(static_cast<int>(next));
+				printf("flare_batch: Started '%s'.\n", run.name.c_str());
+			}
+			else {
+				fprintf(stderr, "flare_batch: Could not start '%s'.\n", run.name.c_str());
+			}
+			next++;
+		}
+
+		int exit_code = -1;
+		int finished = waitForProcess(running, running_runs, exit_code);
+		if (finished < 0)
+			break;
+
+		BatchRun& run = runs[finished];
+		run.exit_code = exit_code;
+		readReport(run);
+		printf("flare_batch: '%s' %s.\n", run.name.c_str(), (exit_code == 0 && run.has_report ? "finished" : "failed, see its log"));
+	}
+
+	const std::string summary = writeSummary(runs, static_cast<float>(getSeconds() - start));
+	printf("\n%s", summary.c_str());
+
+	const std::string report_file = out_dir + "/report.csv";
+	std::ofstream outfile(report_file.c_str());
+	if (outfile.is_open())
+		outfile << summary;
+	else
+		fprintf(stderr, "flare_batch: Could not write '%s'.\n", report_file.c_str());
+
+	for (size_t i = 0; i < runs.size(); ++i) {
+		if (runs[i].exit_code != 0 || !runs[i].has_report)
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+#include "Benchmark.h"
+
+#include <SDL.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if __cplusplus < 201103L
+#define BENCHMARK_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define BENCHMARK_NOTHROW throw()
+#else
+#define BENCHMARK_THROW_BAD_ALLOC
+#define BENCHMARK_NOTHROW noexcept
+#endif
+
+// engine code may allocate on the worker threads too
+static SDL_atomic_t allocations;
+
+static std::string benchmark_filter;
+
+static void* countedAlloc(size_t size) {
+	SDL_AtomicIncRef(&allocations);
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		abort();
+	return p;
+}
+
+void* operator new(size_t size) BENCHMARK_THROW_BAD_ALLOC {
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size) BENCHMARK_THROW_BAD_ALLOC {
+	return countedAlloc(size);
+}
+
+void operator delete(void *p) BENCHMARK_NOTHROW {
+	free(p);
+}
+
+void operator delete[](void *p) BENCHMARK_NOTHROW {
+	free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	free(p);
+}
+#endif
+
+size_t getAllocationCount() {
+	return static_cast<size_t>(static_cast<unsigned>(SDL_AtomicGet(&allocations)));
+}
+
+static volatile size_t benchmark_sink = 0;
+
+void benchmarkUse(size_t value) {
+	benchmark_sink = benchmark_sink + value;
+}
+
+void setBenchmarkFilter(const std::string& filter) {
+	benchmark_filter = filter;
+}
+
+void runBenchmark(const std::string& name, BenchmarkFunc func, void *data) {
+	if (!benchmark_filter.empty() && name.find(benchmark_filter) == std::string::npos)
+		return;
+
+	const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+	// the first call fills caches and scratch buffers, which later calls reuse
+	func(data, 0);
+
+	size_t op = 1;
+	size_t batch = 1;
+	size_t ops = 0;
+	size_t allocs = 0;
+	double seconds = 0;
+
+	while (seconds < BENCHMARK_MIN_SECONDS) {
+		const size_t allocs_start = getAllocationCount();
+		const uint64_t start = SDL_GetPerformanceCounter();
+
+		for (size_t i = 0; i < batch; ++i) {
+			func(data, op++);
+		}
+
+		seconds += static_cast<double>(SDL_GetPerformanceCounter() - start) / frequency;
+		allocs += getAllocationCount() - allocs_start;
+		ops += batch;
+		batch *= 2;
+	}
+
+	printf("%-40s %12.1f ns/op %10.2f allocs/op %10lu ops\n", name.c_str(),
+		   seconds * 1000000000.0 / static_cast<double>(ops),
+		   static_cast<double>(allocs) / static_cast<double>(ops),
+		   static_cast<unsigned long>(ops));
+	fflush(stdout);
+}
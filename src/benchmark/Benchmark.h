@@ -0,0 +1,51 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * Micro-benchmarks for the engine's hot paths
+ *
+ * Each benchmark is a function that performs one operation. runBenchmark()
+ * calls it in growing batches until BENCHMARK_MIN_SECONDS have passed, then
+ * prints the time and the number of heap allocations per operation.
+ * Allocations are counted by replacing the global operator new, so they are
+ * only meaningful in the benchmark executable.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+#include <string>
+
+// a benchmark keeps running until it has taken at least this long
+const float BENCHMARK_MIN_SECONDS = 0.5f;
+
+// performs operation number op; data is whatever was passed to runBenchmark()
+typedef void (*BenchmarkFunc)(void *data, size_t op);
+
+// only benchmarks with filter in their name are run; an empty filter runs all of them
+void setBenchmarkFilter(const std::string& filter);
+
+void runBenchmark(const std::string& name, BenchmarkFunc func, void *data);
+
+// returns the number of heap allocations since the program started
+size_t getAllocationCount();
+
+// keeps the compiler from removing a computation whose result isn't used
+void benchmarkUse(size_t value);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,355 @@
+/*
+Copyright © 2016 Justin Jacobs
+
+This file is part of FLARE.
+
+FLARE is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+FLARE is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+FLARE.  If not, see http://www.gnu.org/licenses/
+*/
+
+/**
+ * The flare_benchmark executable
+ *
+ * Usage: flare_benchmark [FILTER]
+ * Only the benchmarks with FILTER in their name are run.
+ */
+
+#include "Benchmark.h"
+#include "Entity.h"
+#include "EntityGrid.h"
+#include "FileParser.h"
+#include "MapCollision.h"
+#include "MapRenderer.h"
+#include "Random.h"
+#include "Settings.h"
+#include "Utils.h"
+#include "UtilsParsing.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+// the engine's platform functions are compiled along with the main() that uses them
+#define PLATFORM_CPP_INCLUDE
+
+#ifdef _WIN32
+#include "PlatformWin32.cpp"
+#elif __ANDROID__
+#include "PlatformAndroid.cpp"
+#elif __IPHONEOS__
+#include "PlatformIPhoneOS.cpp"
+#elif __GCW0__
+#include "PlatformGCW0.cpp"
+#else
+#include "PlatformLinux.cpp"
+#endif
+
+// width and height of the generated maps, in tiles
+const int BENCHMARK_MAP_SIZE = 256;
+
+// each benchmark cycles through this many precomputed inputs
+const size_t BENCHMARK_INPUTS = 1024;
+
+/**
+ * A map with scattered obstacles and long walls with gaps, so that paths have to go around
+ */
+static void generateMap(Map_Layer& layer, RandomStream& rng) {
+	layer.resize(BENCHMARK_MAP_SIZE, BENCHMARK_MAP_SIZE, BLOCKS_NONE);
+
+	for (int y = 0; y < BENCHMARK_MAP_SIZE; ++y) {
+		for (int x = 0; x < BENCHMARK_MAP_SIZE; ++x) {
+			int roll = rng.nextInt(100);
+			if (x == 0 || y == 0 || x == BENCHMARK_MAP_SIZE-1 || y == BENCHMARK_MAP_SIZE-1 || roll < 8)
+				layer.at(x, y) = BLOCKS_ALL;
+			else if (roll < 10)
+				layer.at(x, y) = BLOCKS_MOVEMENT;
+		}
+	}
+
+	for (int x = 32; x < BENCHMARK_MAP_SIZE - 1; x += 32) {
+		for (int y = 1; y < BENCHMARK_MAP_SIZE - 1; ++y) {
+			if (y % 64 < 56)
+				layer.at(x, y) = BLOCKS_ALL;
+		}
+	}
+}
+
+static FPoint randomEmptyPos(MapCollision& collider, RandomStream& rng) {
+	while (true) {
+		FPoint pos(static_cast<float>(rng.nextInt(BENCHMARK_MAP_SIZE)) + 0.5f, static_cast<float>(rng.nextInt(BENCHMARK_MAP_SIZE)) + 0.5f);
+		if (collider.is_empty(pos.x, pos.y))
+			return pos;
+	}
+}
+
+static FPoint randomNearbyPos(MapCollision& collider, RandomStream& rng, const FPoint& center, int range) {
+	while (true) {
+		FPoint pos(center.x + static_cast<float>(rng.nextInt(range * 2 + 1) - range), center.y + static_cast<float>(rng.nextInt(range * 2 + 1) - range));
+		if (!collider.is_outside_map(pos.x, pos.y) && collider.is_empty(pos.x, pos.y))
+			return pos;
+	}
+}
+
+/**
+ * MapCollision: compute_path(), line_of_sight() and move()
+ */
+class CollisionData {
+public:
+	MapCollision collider;
+	std::vector<FPoint> starts;
+	std::vector<FPoint> ends;
+	std::vector<FPoint> path;
+	FPoint mover;
+	std::vector<FPoint> steps;
+
+	CollisionData(int range) {
+		RandomStream rng;
+		rng.seed(1);
+
+		Map_Layer layer;
+		generateMap(layer, rng);
+		collider.setmap(layer);
+
+		for (size_t i = 0; i < BENCHMARK_INPUTS; ++i) {
+			FPoint start = randomEmptyPos(collider, rng);
+			starts.push_back(start);
+			ends.push_back(range > 0 ? randomNearbyPos(collider, rng, start, range) : randomEmptyPos(collider, rng));
+
+			float angle = rng.nextFloat() * 6.2831853f;
+			steps.push_back(FPoint(cosf(angle) * 0.1f, sinf(angle) * 0.1f));
+		}
+		mover = starts[0];
+	}
+};
+
+static void benchComputePath(void *data, size_t op) {
+	CollisionData *d = static_cast<CollisionData*>(data);
+	size_t i = op % BENCHMARK_INPUTS;
+	d->collider.compute_path(d->starts[i], d->ends[i], d->path, MOVEMENT_NORMAL);
+	benchmarkUse(d->path.size());
+}
+
+static void benchLineOfSight(void *data, size_t op) {
+	CollisionData *d = static_cast<CollisionData*>(data);
+	size_t i = op % BENCHMARK_INPUTS;
+	benchmarkUse(d->collider.line_of_sight(d->starts[i].x, d->starts[i].y, d->ends[i].x, d->ends[i].y));
+}
+
+static void benchMove(void *data, size_t op) {
+	CollisionData *d = static_cast<CollisionData*>(data);
+	const FPoint& step = d->steps[(op / 32) % BENCHMARK_INPUTS];
+	benchmarkUse(d->collider.move(d->mover.x, d->mover.y, step.x, step.y, MOVEMENT_NORMAL, false));
+}
+
+/**
+ * FileParser and UtilsParsing: a generated definition file, parsed the way powers are
+ */
+class ParserData {
+public:
+	std::string filename;
+	std::string line;
+
+	ParserData(int sections)
+		: filename("flare_benchmark_definitions.txt") {
+		std::ofstream outfile(filename.c_str());
+		outfile << "# generated by flare_benchmark\n\n";
+		for (int i = 0; i < sections; ++i) {
+			outfile << "[power]\n";
+			outfile << "id=" << i << "\n";
+			outfile << "name=Benchmark Power " << i << "\n";
+			outfile << "type=missile\n";
+			outfile << "icon=" << i % 200 << "\n";
+			outfile << "description=A power that only exists to be parsed, number " << i << "\n";
+			outfile << "new_state=swing\n";
+			outfile << "requires_mp=" << i % 20 << "\n";
+			outfile << "cooldown=" << i % 5 << "s\n";
+			outfile << "base_damage=melee\n";
+			outfile << "animation=animations/powers/fireball.txt\n";
+			outfile << "soundfx=soundfx/powers/fireball.ogg\n";
+			outfile << "post_effect=speed," << i % 100 << ",3s\n";
+			outfile << "post_effect=burn," << i % 10 << ",5s," << i % 7 << "\n";
+			outfile << "modifier_damage=multiply," << 100 + i % 50 << ",0\n";
+			outfile << "requires_flags=mainhand,offhand\n\n";
+		}
+
+		line = "speed,50,3s,burn,10,5s,multiply,150,0,mainhand,offhand";
+	}
+
+	~ParserData() {
+		remove(filename.c_str());
+	}
+};
+
+static void benchFileParser(void *data, size_t) {
+	ParserData *d = static_cast<ParserData*>(data);
+
+	FileParser infile;
+	size_t values = 0;
+	if (infile.open(d->filename, false, "")) {
+		while (infile.next()) {
+			std::string val = infile.val;
+			while (!val.empty()) {
+				std::string s = popFirstString(val);
+				values += static_cast<size_t>(toInt(s));
+			}
+		}
+		infile.close();
+	}
+	benchmarkUse(values);
+}
+
+static void benchPopFirstString(void *data, size_t) {
+	ParserData *d = static_cast<ParserData*>(data);
+
+	std::string val = d->line;
+	size_t values = 0;
+	while (!val.empty()) {
+		values += popFirstString(val).length();
+	}
+	benchmarkUse(values);
+}
+
+/**
+ * The broadphase of HazardManager: entities near a hazard, then the radius check
+ */
+class HazardData {
+public:
+	EntityGrid grid;
+	std::vector<Entity*> entities;
+	std::vector<FPoint> hazards;
+	std::vector<Entity*> nearby;
+
+	HazardData(size_t count) {
+		RandomStream rng;
+		rng.seed(2);
+
+		grid.reset(Point(BENCHMARK_MAP_SIZE, BENCHMARK_MAP_SIZE));
+
+		// entities gather in the middle of the map, like a fight would
+		const float spread = static_cast<float>(BENCHMARK_MAP_SIZE) / 4;
+		const float offset = static_cast<float>(BENCHMARK_MAP_SIZE) * 3 / 8;
+		for (size_t i = 0; i < count; ++i) {
+			Entity *e = new Entity();
+			e->stats.pos = FPoint(offset + rng.nextFloat() * spread, offset + rng.nextFloat() * spread);
+			grid.add(e);
+			entities.push_back(e);
+		}
+
+		for (size_t i = 0; i < BENCHMARK_INPUTS; ++i) {
+			hazards.push_back(FPoint(offset + rng.nextFloat() * spread, offset + rng.nextFloat() * spread));
+		}
+	}
+
+	~HazardData() {
+		for (size_t i = 0; i < entities.size(); ++i) {
+			delete entities[i];
+		}
+	}
+};
+
+static void benchHazardCollision(void *data, size_t op) {
+	HazardData *d = static_cast<HazardData*>(data);
+	const FPoint& pos = d->hazards[op % BENCHMARK_INPUTS];
+	const float radius = 1.5f;
+
+	d->grid.query(pos, radius, d->nearby);
+
+	size_t hits = 0;
+	for (size_t i = 0; i < d->nearby.size(); ++i) {
+		if (isWithinRadius(pos, radius, d->nearby[i]->stats.pos))
+			hits++;
+	}
+	benchmarkUse(hits);
+}
+
+/**
+ * RenderableSorter: a few renderables move each frame, or all of them do
+ */
+class SortData {
+public:
+	RenderableSorter sorter;
+	std::vector<Renderable> renderables;
+	RandomStream rng;
+	ScreenTransform view;
+	size_t moving;
+
+	SortData(size_t count, size_t _moving)
+		: moving(_moving) {
+		rng.seed(3);
+		view.setCamera(FPoint(BENCHMARK_MAP_SIZE / 2.f, BENCHMARK_MAP_SIZE / 2.f));
+		renderables.resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			renderables[i].map_pos = FPoint(rng.nextFloat() * BENCHMARK_MAP_SIZE, rng.nextFloat() * BENCHMARK_MAP_SIZE);
+		}
+	}
+};
+
+static void benchSortRenderables(void *data, size_t) {
+	SortData *d = static_cast<SortData*>(data);
+
+	for (size_t i = 0; i < d->moving; ++i) {
+		Renderable& r = d->renderables[static_cast<size_t>(d->rng.nextInt(static_cast<int>(d->renderables.size())))];
+		r.map_pos.x = std::max(0.f, r.map_pos.x + (d->rng.nextFloat() - 0.5f) * 0.5f);
+		r.map_pos.y = std::max(0.f, r.map_pos.y + (d->rng.nextFloat() - 0.5f) * 0.5f);
+	}
+
+	d->sorter.sort(d->renderables, true, d->view);
+	benchmarkUse(d->sorter.sorted.size());
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1)
+		setBenchmarkFilter(argv[1]);
+
+	// the engine defaults, as loadMiscSettings() would set them without a mod
+	ENABLE_PATH_HIERARCHY = true;
+	ENABLE_FLOW_FIELD = true;
+	ENABLE_ALLY_COLLISION = true;
+
+	printf("%-40s %18s %20s %14s\n", "benchmark", "time", "allocations", "");
+
+	{
+		CollisionData near(12);
+		runBenchmark("MapCollision::compute_path short", benchComputePath, &near);
+		runBenchmark("MapCollision::line_of_sight", benchLineOfSight, &near);
+		runBenchmark("MapCollision::move", benchMove, &near);
+
+		CollisionData far(0);
+		runBenchmark("MapCollision::compute_path long", benchComputePath, &far);
+
+		ENABLE_PATH_HIERARCHY = false;
+		CollisionData far_flat(0);
+		runBenchmark("MapCollision::compute_path long no HPA*", benchComputePath, &far_flat);
+		ENABLE_PATH_HIERARCHY = true;
+	}
+
+	{
+		ParserData parser(1000);
+		runBenchmark("FileParser 1000 sections", benchFileParser, &parser);
+		runBenchmark("UtilsParsing popFirstString", benchPopFirstString, &parser);
+	}
+
+	{
+		HazardData few(100);
+		runBenchmark("HazardManager collision 100 enemies", benchHazardCollision, &few);
+		HazardData many(1000);
+		runBenchmark("HazardManager collision 1000 enemies", benchHazardCollision, &many);
+	}
+
+	{
+		SortData steady(2000, 20);
+		runBenchmark("RenderableSorter 2000 steady", benchSortRenderables, &steady);
+		SortData shuffled(2000, 2000);
+		runBenchmark("RenderableSorter 2000 shuffled", benchSortRenderables, &shuffled);
+	}
+
+	return 0;
+}
@@ -25,16 +25,30 @@ FLARE.  If not, see http://www.gnu.org/licenses/
 #include <ctime>
 #include <limits.h>
 
+#include "AnimationSet.h"
+#include "DevicePower.h"
+#include "FrameArena.h"
+#include "FramePacer.h"
 #include "Settings.h"
 #include "Stats.h"
 #include "GameSwitcher.h"
+#include "Map.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "SharedGameResources.h"
 #include "SharedResources.h"
 #include "UtilsFileSystem.h"
 #include "SDLFontEngine.h"
 #include "UtilsParsing.h"
+#include "VisualQuality.h"
 
 GameSwitcher *gswitch;
 
+// logic frames that catch up after a slow frame may take this long together
+// If the logic can't keep up, the rest is dropped and the game runs in slow motion,
+// instead of each catch-up making the next frame later still.
+const float LOGIC_CATCHUP_SECONDS = 0.1f;
+
 #define PLATFORM_CPP_INCLUDE
 
 #ifdef _WIN32
@@ -54,8 +68,15 @@ class CmdLineArgs {
 public:
 	std::string render_device_name;
 	std::vector<std::string> mod_list;
+	bool headless;
+
+	CmdLineArgs()
+		: render_device_name("")
+		, headless(false) {
+	}
 };
 
+
 /**
  * Game initialization.
  */
@@ -71,12 +92,15 @@ static void init(const CmdLineArgs& cmd_line_args) {
 	PlatformSetPaths();
 
 	// SDL Inits
-	if ( SDL_Init (SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK) < 0 ) {
+	Uint32 sdl_flags = cmd_line_args.headless ? SDL_INIT_EVENTS : (SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK);
+	if ( SDL_Init (sdl_flags) < 0 ) {
 		logError("main: Could not initialize SDL: %s", SDL_GetError());
 		logErrorDialog("ERROR: Could not initialize SDL.");
 		Exit(1);
 	}
 
+	startLogging();
+
 	// Shared Resources set-up
 
 	mods = new ModManager(&(cmd_line_args.mod_list));
@@ -100,9 +124,10 @@ static void init(const CmdLineArgs& cmd_line_args) {
 
 	save_load = new SaveLoad();
 	msg = new MessageEngine();
-	font = getFontEngine();
+	font = getFontEngine(cmd_line_args.headless);
 	anim = new AnimationManager();
 	comb = new CombatText();
+	workers = new WorkerPool();
 	inpt = getInputManager();
 	icons = NULL;
 
@@ -114,7 +139,9 @@ static void init(const CmdLineArgs& cmd_line_args) {
 	setStatNames();
 
 	// Create render Device and Rendering Context.
-	if (PlatformOptions.default_renderer != "")
+	if (cmd_line_args.headless)
+		render_device = getRenderDevice("null");
+	else if (PlatformOptions.default_renderer != "")
 		render_device = getRenderDevice(PlatformOptions.default_renderer);
 	else if (cmd_line_args.render_device_name != "")
 		render_device = getRenderDevice(cmd_line_args.render_device_name);
@@ -129,7 +156,7 @@ static void init(const CmdLineArgs& cmd_line_args) {
 		Exit(1);
 	}
 
-	snd = getSoundManager();
+	snd = getSoundManager(cmd_line_args.headless);
 
 	inpt->initJoystick();
 
@@ -140,19 +167,44 @@ static float getSecondsElapsed(uint64_t prev_ticks, uint64_t now_ticks) {
 	return (static_cast<float>(now_ticks - prev_ticks) / static_cast<float>(SDL_GetPerformanceFrequency()));
 }
 
-static void mainLoop () {
+static void mainLoop(bool headless) {
 	bool done = false;
 
 	float seconds_per_frame = 1.f/static_cast<float>(MAX_FRAMES_PER_SEC);
+	const uint64_t logic_step = static_cast<uint64_t>(seconds_per_frame * static_cast<float>(SDL_GetPerformanceFrequency()));
+
+	FramePacer pacer;
 
 	uint64_t prev_ticks = SDL_GetPerformanceCounter();
 	uint64_t logic_ticks = SDL_GetPerformanceCounter();
 
 	float last_fps = -1;
 
+	// logic frames dropped since the fps counter was last shown
+	unsigned slowed_frames = 0;
+
 	while ( !done ) {
+		// scratch memory from the previous iteration is no longer in use
+		resetFrameArena();
+
 		int loops = 0;
 		uint64_t now_ticks = SDL_GetPerformanceCounter();
+		const uint64_t catchup_start = now_ticks;
+		unsigned dropped_frames = 0;
+
+		// fast replays and headless runs do one logic frame per loop, as soon as possible
+		const bool uncapped = headless || replay->isFast() || !BENCHMARK_RENDER.empty();
+
+		// drawing faster than the logic runs shows positions between the last two logic frames
+		// drawing slower, for menus, battery saving or a hot device, runs several logic frames per drawn one
+		// these are worked out every frame, since the developer console can change the frame cap
+		int render_fps = std::max(MAX_RENDER_FPS, MAX_FRAMES_PER_SEC);
+		if (!uncapped)
+			render_fps = getDeviceRenderFPS(render_fps, gswitch->isIdle());
+		const bool interpolate = render_fps > MAX_FRAMES_PER_SEC;
+		float seconds_per_render = 1.f/static_cast<float>(render_fps);
+		if (uncapped)
+			logic_ticks = now_ticks;
 
 		while (now_ticks >= logic_ticks && loops < MAX_FRAMES_PER_SEC) {
 			// Frames where data loading happens (GameState switching and map loading)
@@ -164,21 +216,29 @@ static void mainLoop () {
 				break;
 			}
 
-			SDL_PumpEvents();
-			inpt->handle();
+			{
+				ProfileScope scope(PROFILE_INPUT);
+				SDL_PumpEvents();
+				inpt->handle();
+				replay->update(inpt);
+			}
 
 			// Skip game logic when minimized on Mobile device
 			if (inpt->window_minimized && !inpt->window_restored)
 				break;
 
-			gswitch->logic();
+			{
+				ProfileScope scope(PROFILE_LOGIC);
+				workers->finishTasks();
+				gswitch->logic();
+			}
 			inpt->resetScroll();
 
 			// Engine done means the user escapes the main game menu.
 			// Input done means the user closes the window.
 			done = gswitch->done || inpt->done;
 
-			logic_ticks += static_cast<uint64_t>(seconds_per_frame * static_cast<float>(SDL_GetPerformanceFrequency()));
+			logic_ticks += logic_step;
 			loops++;
 
 			// Android and IOS only
@@ -196,23 +256,68 @@ static void mainLoop () {
 				logic_ticks = now_ticks;
 				break;
 			}
+
+			// the logic frames that are still due past the catch-up budget are dropped
+			if (now_ticks >= logic_ticks && getSecondsElapsed(catchup_start, SDL_GetPerformanceCounter()) >= LOGIC_CATCHUP_SECONDS) {
+				dropped_frames = static_cast<unsigned>((now_ticks - logic_ticks) / logic_step) + 1;
+				logic_ticks = now_ticks + logic_step;
+				break;
+			}
+		}
+
+		if (interpolate) {
+			// logic_ticks is when the next logic frame is due, so the last one was due one step earlier
+			uint64_t frame_ticks = logic_ticks - logic_step;
+			uint64_t render_ticks = SDL_GetPerformanceCounter();
+			if (render_ticks <= frame_ticks)
+				FRAME_INTERPOLATION = 0;
+			else
+				FRAME_INTERPOLATION = std::min(1.f, static_cast<float>(render_ticks - frame_ticks) / static_cast<float>(logic_step));
+		}
+		else {
+			FRAME_INTERPOLATION = 1;
 		}
 
-		render_device->blankScreen();
-		gswitch->render();
+		{
+			ProfileScope scope(PROFILE_RENDER);
+			render_device->blankScreen();
+			gswitch->render();
 
-		// display the FPS counter
-		if (last_fps != -1) {
-		    gswitch->showFPS(last_fps);
+			// display the FPS counter
+			slowed_frames += dropped_frames;
+			if (last_fps != -1) {
+			    gswitch->showFPS(last_fps, pacer.takeMissedFrames(), slowed_frames);
+			    slowed_frames = 0;
+			}
+		}
+
+		{
+			ProfileScope scope(PROFILE_COMMIT);
+			render_device->commitFrame();
+		}
+		endProfileFrame();
+
+		if (isProfileCapturing()) {
+			addProfileCounter("image cache bytes", render_device->getImageCacheBytes());
+			addProfileCounter("animation cache bytes", anim->getCacheBytes());
+			addProfileCounter("sound cache bytes", snd->getCacheBytes());
+			addProfileCounter("dropped logic frames", dropped_frames);
+			addProfileCounter("frame arena bytes", getFrameArenaUsed());
 		}
 
-		render_device->commitFrame();
+		// frames that take too long to draw lower the resolution the world is drawn at, and the visual detail
+		// a benchmark measures the settings as they are, so they are left alone
+		if (BENCHMARK_RENDER.empty()) {
+			const float frame_seconds = getSecondsElapsed(prev_ticks, SDL_GetPerformanceCounter());
+			render_device->updateWorldScale(frame_seconds, seconds_per_render);
+			updateVisualQuality(frame_seconds, seconds_per_render);
+		}
 
 		// calculate the FPS
 		// if the frame completed quickly, we estimate the delay here
 		float fps_delay;
-		if (getSecondsElapsed(prev_ticks, SDL_GetPerformanceCounter()) < seconds_per_frame) {
-			fps_delay = seconds_per_frame;
+		if (getSecondsElapsed(prev_ticks, SDL_GetPerformanceCounter()) < seconds_per_render) {
+			fps_delay = seconds_per_render;
 		} else {
 			fps_delay = getSecondsElapsed(prev_ticks, SDL_GetPerformanceCounter());
 		}
@@ -223,17 +328,13 @@ static void mainLoop () {
 		}
 
 		// delay quick frames
-		// thanks to David Gow: https://davidgow.net/handmadepenguin/ch18.html
-		if (getSecondsElapsed(prev_ticks, SDL_GetPerformanceCounter()) < seconds_per_frame) {
-			int32_t delay_ms = static_cast<int32_t>((seconds_per_frame - getSecondsElapsed(prev_ticks, SDL_GetPerformanceCounter())) * 1000.f) - 1;
-			if (delay_ms > 0) {
-				SDL_Delay(delay_ms);
-			}
-			while (getSecondsElapsed(prev_ticks, SDL_GetPerformanceCounter()) < seconds_per_frame) {
-				// Waiting...
-			}
-		}
+		// if presenting waits for a display that refreshes no faster than we draw, vsync already paced the frame
+		int vsync_rate = render_device->getVsyncRate();
+		if (!uncapped)
+			pacer.wait(seconds_per_render, vsync_rate > 0 && vsync_rate <= render_fps);
+
 		prev_ticks = SDL_GetPerformanceCounter();
+		pacer.startFrame();
 	}
 }
 
@@ -244,18 +345,72 @@ static void cleanup() {
 	delete comb;
 	delete font;
 	delete inpt;
-	delete mods;
+	delete replay;
 	delete msg;
 	delete snd;
 	delete save_load;
 
+	// the image decoder thread opens files through mods
+	if (render_device)
+		render_device->cancelImageRequests();
+	delete mods;
+	delete workers;
+
 	if (render_device)
 		render_device->destroyContext();
 	delete render_device;
 
+	stopLogging();
 	SDL_Quit();
 }
 
+/**
+ * Write compiled versions of every map, so that they don't need to be parsed at runtime
+ */
+static void compileMaps() {
+	std::vector<std::string> map_files = mods->list("maps", false);
+	int compiled = 0;
+
+	// loot tables referenced by map events are expanded while parsing
+	items = new ItemManager();
+	loot = new LootManager();
+
+	for (size_t i = 0; i < map_files.size(); ++i) {
+		Map map;
+		if (map.compile(map_files[i]))
+			compiled++;
+	}
+
+	delete loot;
+	loot = NULL;
+	delete items;
+	items = NULL;
+
+	logInfo("main: Compiled %d of %d maps.", compiled, static_cast<int>(map_files.size()));
+}
+
+/**
+ * Write compiled versions of every animation definition, so that they don't need to be parsed at runtime
+ */
+static void compileAnimations() {
+	std::vector<std::string> files = mods->listTree("animations");
+	int total = 0;
+	int compiled = 0;
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		const std::string& fname = files[i];
+		if (fname.length() < 4 || fname.compare(fname.length() - 4, 4, ".txt") != 0)
+			continue;
+
+		total++;
+		AnimationSet animset(fname);
+		if (animset.compile())
+			compiled++;
+	}
+
+	logInfo("main: Compiled %d of %d animations.", compiled, total);
+}
+
 std::string parseArg(const std::string &arg) {
 	std::string result = "";
 
@@ -286,7 +441,17 @@ std::string parseArgValue(const std::string &arg) {
 
 int main(int argc, char *argv[]) {
 	bool debug_event = false;
+	bool compile_maps = false;
+	bool compile_animations = false;
+	std::string pack_mod = "";
 	bool done = false;
+	bool has_seed = false;
+	uint32_t seed = 0;
+	std::string record_file = "";
+	std::string replay_file = "";
+	bool replay_fast = false;
+	std::string frame_times_file = "";
+	std::string run_report_file = "";
 	CmdLineArgs cmd_line_args;
 
 	for (int i = 1 ; i < argc; i++) {
@@ -310,6 +475,9 @@ int main(int argc, char *argv[]) {
 		else if (arg == "no-audio") {
 			AUDIO = false;
 		}
+		else if (arg == "headless") {
+			cmd_line_args.headless = true;
+		}
 		else if (arg == "mods") {
 			std::string mod_list_str = parseArgValue(arg_full);
 			while (!mod_list_str.empty()) {
@@ -322,6 +490,37 @@ int main(int argc, char *argv[]) {
 		else if (arg == "load-script") {
 			LOAD_SCRIPT = parseArgValue(arg_full);
 		}
+		else if (arg == "benchmark-render") {
+			BENCHMARK_RENDER = parseArgValue(arg_full);
+		}
+		else if (arg == "compile-maps") {
+			compile_maps = true;
+		}
+		else if (arg == "compile-animations") {
+			compile_animations = true;
+		}
+		else if (arg == "pack-mod") {
+			pack_mod = parseArgValue(arg_full);
+		}
+		else if (arg == "record") {
+			record_file = parseArgValue(arg_full);
+		}
+		else if (arg == "replay") {
+			replay_file = parseArgValue(arg_full);
+		}
+		else if (arg == "replay-fast") {
+			replay_fast = true;
+		}
+		else if (arg == "frame-times") {
+			frame_times_file = parseArgValue(arg_full);
+		}
+		else if (arg == "run-report") {
+			run_report_file = parseArgValue(arg_full);
+		}
+		else if (arg == "seed") {
+			seed = static_cast<uint32_t>(strtoul(parseArgValue(arg_full).c_str(), NULL, 10));
+			has_seed = true;
+		}
 		else if (arg == "help") {
 			printf("\
 --help                   Prints this message.\n\
@@ -331,10 +530,34 @@ int main(int argc, char *argv[]) {
 --renderer=<RENDERER>    Specifies the rendering backend to use.\n\
                          The default is 'sdl'.\n\
 --no-audio               Disables sound effects and music.\n\
+--headless               Runs without a window or audio, and without\n\
+                         waiting between frames. Best used with --replay.\n\
 --mods=<MOD>,...         Starts the game with only these mods enabled.\n\
 --load-slot=<SLOT>       Loads a save slot by numerical index.\n\
 --load-script=<SCRIPT>   Execute's a script upon loading a saved game.\n\
-                         The script path is mod-relative.\n");
+                         The script path is mod-relative.\n\
+--benchmark-render=<MAP>[,<CATEGORY>,<ENEMIES>,<POWER>,<HAZARDS>]\n\
+                         Flies the camera through MAP with the save of\n\
+                         --load-slot, uncapped, and prints the frame times\n\
+                         and draw counts, then exits. Optionally adds\n\
+                         ENEMIES of an enemy CATEGORY, and fires HAZARDS\n\
+                         of a POWER id per second.\n\
+--compile-maps           Writes a compiled copy of every map next to its\n\
+                         text file, then exits.\n\
+--compile-animations     Writes a compiled copy of every animation\n\
+                         definition next to its text file, then exits.\n\
+--pack-mod=<MOD>         Packs the folder of a mod into a single archive\n\
+                         next to it, then exits.\n\
+--seed=<SEED>            Seeds the random number generator, so that a\n\
+                         session can be reproduced.\n\
+--record=<FILE>          Records the input of every logic frame to FILE.\n\
+--replay=<FILE>          Plays back the input recorded in FILE, then exits.\n\
+--replay-fast            Plays back the replay as fast as possible.\n\
+--frame-times=<FILE>     Writes the time of every frame to FILE as CSV\n\
+                         on exit, and logs the frame time percentiles.\n\
+--run-report=<FILE>      Writes a summary of the frame times, allocations\n\
+                         and profiler zones of the whole run to FILE on\n\
+                         exit, as read by flare_batch.\n");
 			done = true;
 		}
 		else {
@@ -343,16 +566,54 @@ int main(int argc, char *argv[]) {
 	}
 
 	if (!done) {
-		srand(static_cast<unsigned int>(time(NULL)));
+		if (!has_seed)
+			seed = static_cast<uint32_t>(time(NULL));
+		seedRandom(seed);
+
+		// a replay brings its own random seed and save slot
+		replay = new InputReplay();
+		if (!replay_file.empty()) {
+			if (!replay->startPlayback(replay_file, replay_fast))
+				Exit(1);
+		}
+		else {
+			logInfo("main: Random seed is %u.", seed);
+			if (!record_file.empty())
+				replay->startRecording(record_file);
+		}
+
+		// the benchmark needs a hero to fly the camera around
+		if (!BENCHMARK_RENDER.empty() && LOAD_SLOT.empty())
+			LOAD_SLOT = "1";
+
 		init(cmd_line_args);
 
-		if (debug_event)
-			inpt->enableEventLog();
+		if (compile_maps || compile_animations) {
+			if (compile_maps)
+				compileMaps();
+			if (compile_animations)
+				compileAnimations();
+		}
+		else if (!pack_mod.empty()) {
+			mods->packMod(pack_mod);
+		}
+		else {
+			if (debug_event)
+				inpt->enableEventLog();
+
+			if (!frame_times_file.empty())
+				startFrameTimeLog(frame_times_file);
+			if (!run_report_file.empty())
+				startRunReport(run_report_file);
 
-		mainLoop();
+			mainLoop(cmd_line_args.headless);
 
-		if (gswitch)
-			gswitch->saveUserSettings();
+			writeFrameTimeLog();
+			writeRunReport();
+
+			if (gswitch)
+				gswitch->saveUserSettings();
+		}
 
 		cleanup();
 	}